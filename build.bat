@@ -1,13 +1,18 @@
 @echo off
 
-@rem Default to release build
+@rem Default to release build without instrumentation
 set is_debug=0
+set is_profile=0
 
-@rem Check first argument
+@rem Check arguments: build [debug] [profile]
 if /i "%1" EQU "debug" (
     set is_debug=1
     shift
 )
+if /i "%1" EQU "profile" (
+    set is_profile=1
+    shift
+)
 
 @rem /Oi generates intrinsic functions
 @rem /Fc displays the full path to files in error messages
@@ -16,6 +21,10 @@ set common_flags=/nologo /Oi /FC /WX /W4 /wd4201 /wd4505
 set output_names=/Fograpple.obj /Fegrapple.exe /Fmgrapple.map
 set common_defs=/D_CRT_SECURE_NO_WARNINGS /DVC_EXTRALEAN /DWIN32_LEAN_AND_MEAN /DNOMINMAX /DGRAPPLE_WIN32
 
+@rem GRAPPLE_PROFILE compiles in the instrumentation profiler (overlay breakdown and grapple_trace.json on exit), and
+@rem arena telemetry (overlay and grapple_arenas.txt on exit), which debug builds always have
+if "%is_profile%"=="1" set common_defs=%common_defs% /DGRAPPLE_PROFILE
+
 @rem /Zi generates a PDB
 @rem /Od disables optimization
 @rem /MTd uses the debug multithreaded C library
@@ -54,4 +63,9 @@ pushd build
 cl %compiler_flags% /c /I..\src ..\src\renderer\d3d11\d3d11_font.cpp
 lib /nologo /out:font.lib d3d11_font.obj
 cl %compiler_flags% /I.. /I..\src ..\src\main.c %output_names% %linker_flags% %libs% font.lib
+
+@rem Headless benchmark, replay and bake tools use the null renderer, so they need no D3D libraries (see build.sh)
+cl %compiler_flags% /DGRAPPLE_RENDERER_NULL /I.. /I..\src ..\src\bench\bench_main.c /Fograpple_bench.obj /Fegrapple_bench.exe /link /opt:ref /incremental:no /subsystem:console kernel32.lib
+cl %compiler_flags% /DGRAPPLE_RENDERER_NULL /I.. /I..\src ..\src\replay\replay_main.c /Fograpple_replay.obj /Fegrapple_replay.exe /link /opt:ref /incremental:no /subsystem:console kernel32.lib
+cl %compiler_flags% /DGRAPPLE_RENDERER_NULL /I.. /I..\src ..\src\bake\bake_main.c /Fograpple_bake.obj /Fegrapple_bake.exe /link /opt:ref /incremental:no /subsystem:console kernel32.lib
 popd
@@ -0,0 +1,44 @@
+#!/bin/sh
+# Portable build of the headless targets (grapple_bench, grapple_replay and grapple_bake). The GUI is built with
+# build.bat.
+# Usage: ./build.sh [debug] [profile]
+set -e
+
+cd "$(dirname "$0")"
+
+cc=${CC:-cc}
+is_debug=0
+is_profile=0
+
+for arg in "$@"; do
+    case "$arg" in
+        debug) is_debug=1 ;;
+        profile) is_profile=1 ;;
+        *) echo "Unknown argument: $arg"; exit 1 ;;
+    esac
+done
+
+# -Wno-missing-braces: {0} initializers on structs whose first member is an aggregate
+common_flags="-std=gnu11 -Wall -Wextra -Werror -Wno-unused-function -Wno-missing-braces"
+common_defs="-DGRAPPLE_LINUX"
+
+# -g generates debug info, -O0 disables optimization
+debug_flags="-DGRAPPLE_DEBUG -g -O0"
+release_flags="-O2"
+
+if [ "$is_debug" = "1" ]; then
+    compiler_flags="$common_flags $common_defs $debug_flags"
+else
+    compiler_flags="$common_flags $common_defs $release_flags"
+fi
+
+if [ "$is_profile" = "1" ]; then
+    compiler_flags="$compiler_flags -DGRAPPLE_PROFILE"
+fi
+
+libs="-lm -lpthread -lrt" # rt for shm_open on older glibc
+
+mkdir -p build
+$cc $compiler_flags -DGRAPPLE_RENDERER_NULL -I. -Isrc src/bench/bench_main.c -o build/grapple_bench $libs
+$cc $compiler_flags -DGRAPPLE_RENDERER_NULL -I. -Isrc src/replay/replay_main.c -o build/grapple_replay $libs
+$cc $compiler_flags -DGRAPPLE_RENDERER_NULL -I. -Isrc src/bake/bake_main.c -o build/grapple_bake $libs
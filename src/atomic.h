@@ -0,0 +1,108 @@
+#pragma once
+
+#include "types.h"
+
+// NOTE(lucas): Only the handful of operations the engine needs. Loads have acquire semantics and stores have
+// release semantics; read-modify-write operations are full barriers.
+#if defined(_MSC_VER)
+    #include <intrin.h>
+
+    internal inline u32 atomic_add_u32(volatile u32* value, u32 addend)
+    {
+        u32 result = (u32)_InterlockedExchangeAdd((volatile long*)value, (long)addend) + addend;
+        return result;
+    }
+
+    internal inline u64 atomic_add_u64(volatile u64* value, u64 addend)
+    {
+        u64 result = (u64)_InterlockedExchangeAdd64((volatile __int64*)value, (__int64)addend) + addend;
+        return result;
+    }
+
+    // Returns true if value held expected and was replaced with new_value
+    internal inline b32 atomic_compare_exchange_u32(volatile u32* value, u32 expected, u32 new_value)
+    {
+        b32 result = ((u32)_InterlockedCompareExchange((volatile long*)value, (long)new_value, (long)expected) ==
+                      expected);
+        return result;
+    }
+
+    /*
+     * NOTE(lucas): x86 and x64 don't reorder a load with a later load or store, so an aligned plain load is already
+     * an acquire and only the compiler has to be kept from moving things across it. That doesn't hold on ARM64, and
+     * a u64 load isn't even atomic on 32-bit x86, so those read through an interlocked operation that changes
+     * nothing. Stores always go through _InterlockedExchange, which is a full barrier everywhere.
+     */
+    internal inline u32 atomic_load_u32(volatile u32* value)
+    {
+    #if defined(_M_IX86) || defined(_M_X64)
+        u32 result = *value;
+        _ReadWriteBarrier();
+    #else
+        u32 result = (u32)_InterlockedOr((volatile long*)value, 0);
+    #endif
+        return result;
+    }
+
+    internal inline u64 atomic_load_u64(volatile u64* value)
+    {
+    #if defined(_M_X64)
+        u64 result = *value;
+        _ReadWriteBarrier();
+    #else
+        u64 result = (u64)_InterlockedCompareExchange64((volatile __int64*)value, 0, 0);
+    #endif
+        return result;
+    }
+
+    internal inline void atomic_store_u32(volatile u32* value, u32 new_value)
+    {
+        _InterlockedExchange((volatile long*)value, (long)new_value);
+    }
+
+    internal inline void atomic_store_u64(volatile u64* value, u64 new_value)
+    {
+        _InterlockedExchange64((volatile __int64*)value, (__int64)new_value);
+    }
+#else
+    internal inline u32 atomic_add_u32(volatile u32* value, u32 addend)
+    {
+        u32 result = __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+        return result;
+    }
+
+    internal inline u64 atomic_add_u64(volatile u64* value, u64 addend)
+    {
+        u64 result = __atomic_add_fetch(value, addend, __ATOMIC_SEQ_CST);
+        return result;
+    }
+
+    internal inline b32 atomic_compare_exchange_u32(volatile u32* value, u32 expected, u32 new_value)
+    {
+        b32 result = __atomic_compare_exchange_n(value, &expected, new_value, false,
+                                                 __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+        return result;
+    }
+
+    internal inline u32 atomic_load_u32(volatile u32* value)
+    {
+        u32 result = __atomic_load_n(value, __ATOMIC_ACQUIRE);
+        return result;
+    }
+
+    internal inline u64 atomic_load_u64(volatile u64* value)
+    {
+        u64 result = __atomic_load_n(value, __ATOMIC_ACQUIRE);
+        return result;
+    }
+
+    internal inline void atomic_store_u32(volatile u32* value, u32 new_value)
+    {
+        __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+    }
+
+    internal inline void atomic_store_u64(volatile u64* value, u64 new_value)
+    {
+        __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+    }
+#endif
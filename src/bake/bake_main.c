@@ -0,0 +1,143 @@
+#include "grapple_math.h"
+#include "profiler.h"
+#include "types.h"
+#include "str.h"
+
+#include "grapple_memory.c"
+#include "timer.c"
+#include "profiler.c"
+#include "inflate.c"
+#include "renderer/renderer.c"
+#include "renderer/texture.c"
+#include "thread.c"
+
+#include <stdio.h> // printf
+#include <string.h> // strcmp
+
+/*
+ * NOTE(lucas): grapple_bake converts an image (BMP, PNG or QOI) to a block-compressed DDS for the renderer to upload
+ * as is, optionally with a full mip chain for images that are drawn small. It reports the encode time and the PSNR
+ * of the base level against the source, so formats can be compared on real assets.
+ */
+
+internal void bake_print_usage(void)
+{
+    printf("Usage: grapple_bake INPUT OUTPUT.dds [--format bc1|bc3|bc7] [--mips] [--serial]\n");
+}
+
+// PSNR over the source's pixels, ignoring the padding that rounds the encoded texture up to whole blocks. Colors are
+// compared premultiplied by alpha, since BC1 stores transparent pixels as black whatever their color was.
+internal f64 bake_psnr(Texture* source, Texture* decoded, u32 channel_count)
+{
+    f64 squared_error = 0.0;
+    for (i32 y = 0; y < source->height; ++y)
+    {
+        u8* a = source->data + (size)y*source->width*4;
+        u8* b = decoded->data + (size)y*decoded->width*4;
+        for (i32 x = 0; x < source->width*4; x += 4)
+        {
+            for (u32 c = 0; c < channel_count; ++c)
+            {
+                f64 d = (c == 3) ? (f64)a[x+3] - (f64)b[x+3] : ((f64)a[x+c]*a[x+3] - (f64)b[x+c]*b[x+3]) / 255.0;
+                squared_error += d*d;
+            }
+        }
+    }
+
+    f64 mse = squared_error / ((f64)source->width*source->height*channel_count);
+    return (mse > 0.0) ? 10.0*log10(255.0*255.0 / mse) : 99.0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        bake_print_usage();
+        return 1;
+    }
+
+    char* input_filename = argv[1];
+    char* output_filename = argv[2];
+    TextureFormat format = TextureFormat_BC7;
+    b32 serial = false;
+    b32 mips = false;
+    for (int i = 3; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            char* name = argv[++i];
+            if (strcmp(name, "bc1") == 0)
+                format = TextureFormat_BC1;
+            else if (strcmp(name, "bc3") == 0)
+                format = TextureFormat_BC3;
+            else if (strcmp(name, "bc7") == 0)
+                format = TextureFormat_BC7;
+            else
+            {
+                bake_print_usage();
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--mips") == 0)
+        {
+            mips = true;
+        }
+        else if (strcmp(argv[i], "--serial") == 0)
+        {
+            serial = true;
+        }
+        else
+        {
+            bake_print_usage();
+            return 1;
+        }
+    }
+
+    PROFILE_INIT();
+
+    Arena arena = arena_alloc(MEGABYTES(512));
+    Texture source = texture_read_from_file(input_filename, &arena);
+    if (!source.data || source.format != TextureFormat_RGBA8 || source.channels != 4)
+    {
+        printf("Could not load %s as an RGBA8 image\n", input_filename);
+        return 1;
+    }
+
+    WorkQueue* queue = 0;
+    if (!serial)
+    {
+        u32 processor_count = thread_get_processor_count();
+        queue = work_queue_create(&arena, processor_count > 1 ? processor_count - 1 : 1);
+    }
+
+    u64 frequency = timer_estimate_cpu_frequency(100);
+    u64 start = timer_read_cpu();
+    if (mips)
+        source = texture_generate_mips(&source, &arena);
+    Texture encoded = texture_encode_bc(&source, format, &arena, queue);
+    f64 encode_ms = 1000.0*(f64)(timer_read_cpu() - start) / (f64)frequency;
+    if (!encoded.data)
+    {
+        printf("Out of memory encoding %s\n", input_filename);
+        return 1;
+    }
+
+    if (!dds_write(output_filename, &encoded, &arena))
+    {
+        printf("Could not write %s\n", output_filename);
+        return 1;
+    }
+
+    Texture decoded = texture_decode_bc(&encoded, &arena);
+    const char* format_names[] = {"rgba8", "bc1", "bc3", "bc7"};
+    size source_size = texture_data_size(&source);
+    size encoded_size = texture_data_size(&encoded);
+    printf("%s: %dx%d %s, %d mips, %.2f ms (%.1f Mpixel/s), %lld -> %lld bytes (%.1fx)\n", output_filename,
+           source.width, source.height, format_names[format], encoded.mip_count > 1 ? encoded.mip_count : 1, encode_ms,
+           (f64)source.width*source.height / (encode_ms*1000.0), (long long)source_size, (long long)encoded_size,
+           (f64)source_size / (f64)encoded_size);
+    if (decoded.data)
+        printf("PSNR: rgb %.2f dB, rgba %.2f dB\n", bake_psnr(&source, &decoded, 3), bake_psnr(&source, &decoded, 4));
+
+    return 0;
+}
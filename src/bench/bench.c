@@ -0,0 +1,142 @@
+#include "bench/bench.h"
+#include "file.h"
+#include "str.h"
+#include "timer.h"
+
+#include <stdio.h> // printf
+#include <stdlib.h> // qsort
+#include <string.h> // strstr
+
+void bench_harness_init(BenchHarness* harness, Arena* arena, u32 warmup, u32 repetitions)
+{
+    harness->warmup = warmup;
+    harness->repetitions = repetitions;
+    harness->arena = arena;
+    harness->samples = push_array(arena, repetitions, u64);
+    harness->cpu_frequency = timer_estimate_cpu_frequency(100);
+    harness->result_count = 0;
+}
+
+internal int bench_compare_u64(const void* a, const void* b)
+{
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    int result = (x > y) - (x < y);
+    return result;
+}
+
+internal f64 bench_cycles_to_ns(BenchHarness* harness, u64 cycles)
+{
+    f64 result = 0.0;
+    if (harness->cpu_frequency)
+        result = 1.0e9*(f64)cycles / (f64)harness->cpu_frequency;
+    return result;
+}
+
+void bench_print_header(BenchHarness* harness)
+{
+    printf("CPU timer frequency: %.3f GHz, %u warmup, %u repetitions\n\n",
+           (f64)harness->cpu_frequency / 1.0e9, harness->warmup, harness->repetitions);
+    printf("%-40s %12s %12s %12s %10s %10s %10s\n",
+           "benchmark", "min ns", "median ns", "p99 ns", "cyc/byte", "ns/item", "GB/s");
+}
+
+void bench_run(BenchHarness* harness, Bench* bench)
+{
+    char full_name[256];
+    snprintf(full_name, sizeof(full_name), "%s/%s", bench->suite, bench->name);
+    if (harness->filter && !strstr(full_name, harness->filter))
+        return;
+
+    ASSERT(harness->result_count < BENCH_MAX_RESULTS, "Too many benchmarks");
+    if (harness->result_count >= BENCH_MAX_RESULTS)
+        return;
+
+    for (u32 i = 0; i < harness->warmup; ++i)
+    {
+        if (bench->reset)
+            bench->reset(bench->data);
+        bench->run(bench->data);
+    }
+
+    u32 reps = harness->repetitions;
+    for (u32 i = 0; i < reps; ++i)
+    {
+        if (bench->reset)
+            bench->reset(bench->data);
+
+        u64 start = timer_read_cpu();
+        bench->run(bench->data);
+        u64 end = timer_read_cpu();
+
+        harness->samples[i] = end - start;
+    }
+
+    qsort(harness->samples, reps, sizeof(u64), bench_compare_u64);
+
+    BenchResult* result = &harness->results[harness->result_count++];
+    result->suite = bench->suite;
+    result->name = bench->name;
+    result->repetitions = reps;
+    result->bytes = bench->bytes;
+    result->items = bench->items;
+    result->min_cycles = harness->samples[0];
+    result->median_cycles = harness->samples[reps/2];
+    result->p99_cycles = harness->samples[((u64)reps*99)/100];
+    result->max_cycles = harness->samples[reps-1];
+
+    // Per-byte and per-item figures use the median; min is too optimistic to track over time
+    f64 median_ns = bench_cycles_to_ns(harness, result->median_cycles);
+    f64 cycles_per_byte = result->bytes ? (f64)result->median_cycles / (f64)result->bytes : 0.0;
+    f64 ns_per_item = result->items ? median_ns / (f64)result->items : 0.0;
+    f64 gb_per_second = (result->bytes && median_ns > 0.0) ? (f64)result->bytes / median_ns : 0.0;
+
+    printf("%-40s %12.0f %12.0f %12.0f %10.3f %10.3f %10.3f\n", full_name,
+           bench_cycles_to_ns(harness, result->min_cycles), median_ns,
+           bench_cycles_to_ns(harness, result->p99_cycles), cycles_per_byte, ns_per_item, gb_per_second);
+}
+
+b32 bench_write_json(BenchHarness* harness, char* filename)
+{
+    void* file = file_open(filename, FileMode_Write|FileMode_Create);
+    if (!file)
+        return false;
+
+    Arena* arena = harness->arena;
+    size arena_mark = arena->used;
+
+    s8 header = s8_format(arena, "{\n  \"cpu_frequency\": %llu,\n  \"warmup\": %u,\n  \"repetitions\": %u,\n"
+                          "  \"results\": [\n", (unsigned long long)harness->cpu_frequency,
+                          harness->warmup, harness->repetitions);
+    file_write(file, header.data, header.len);
+
+    for (u32 i = 0; i < harness->result_count; ++i)
+    {
+        BenchResult* result = &harness->results[i];
+        f64 cycles_per_byte = result->bytes ? (f64)result->median_cycles / (f64)result->bytes : 0.0;
+        f64 ns_per_item = result->items ?
+            bench_cycles_to_ns(harness, result->median_cycles) / (f64)result->items : 0.0;
+
+        s8 entry = s8_format(arena,
+            "    {\"suite\": \"%s\", \"name\": \"%s\", \"repetitions\": %u, \"bytes\": %llu, \"items\": %llu, "
+            "\"min_cycles\": %llu, \"median_cycles\": %llu, \"p99_cycles\": %llu, \"max_cycles\": %llu, "
+            "\"min_ns\": %.1f, \"median_ns\": %.1f, \"p99_ns\": %.1f, "
+            "\"cycles_per_byte\": %.4f, \"ns_per_item\": %.4f}%s\n",
+            result->suite, result->name, result->repetitions,
+            (unsigned long long)result->bytes, (unsigned long long)result->items,
+            (unsigned long long)result->min_cycles, (unsigned long long)result->median_cycles,
+            (unsigned long long)result->p99_cycles, (unsigned long long)result->max_cycles,
+            bench_cycles_to_ns(harness, result->min_cycles), bench_cycles_to_ns(harness, result->median_cycles),
+            bench_cycles_to_ns(harness, result->p99_cycles), cycles_per_byte, ns_per_item,
+            (i + 1 < harness->result_count) ? "," : "");
+        file_write(file, entry.data, entry.len);
+        arena_pop(arena, entry.len);
+    }
+
+    s8 footer = s8("  ]\n}\n");
+    file_write(file, footer.data, footer.len);
+    file_close(file);
+
+    arena->used = arena_mark;
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "grapple_memory.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Minimal benchmark harness.
+ * Each benchmark runs a number of untimed warmup repetitions, then timed repetitions. Every repetition is timed
+ * with the CPU timer, and the harness reports min/median/p99 along with cycles per byte and nanoseconds per item
+ * when the benchmark says how much work one repetition does.
+ * Benchmarks that are too short to time on their own should loop internally and report the loop count as items.
+ */
+
+typedef void BenchFn(void* data);
+
+typedef struct
+{
+    const char* suite;
+    const char* name;
+    BenchFn* run;
+    BenchFn* reset; // Optional, runs before every repetition and is not timed
+    void* data;
+    u64 bytes;      // Bytes processed per repetition, 0 if not meaningful
+    u64 items;      // Operations per repetition, 0 if not meaningful
+} Bench;
+
+typedef struct
+{
+    const char* suite;
+    const char* name;
+    u32 repetitions;
+    u64 bytes;
+    u64 items;
+    u64 min_cycles;
+    u64 median_cycles;
+    u64 p99_cycles;
+    u64 max_cycles;
+} BenchResult;
+
+#define BENCH_MAX_RESULTS 256
+
+typedef struct
+{
+    u32 warmup;
+    u32 repetitions;
+    const char* filter; // Only run benchmarks whose "suite/name" contains this
+    u64 cpu_frequency;
+
+    Arena* arena;
+    u64* samples;
+
+    u32 result_count;
+    BenchResult results[BENCH_MAX_RESULTS];
+} BenchHarness;
+
+void bench_harness_init(BenchHarness* harness, Arena* arena, u32 warmup, u32 repetitions);
+void bench_run(BenchHarness* harness, Bench* bench);
+void bench_print_header(BenchHarness* harness);
+b32 bench_write_json(BenchHarness* harness, char* filename);
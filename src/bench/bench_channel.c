@@ -0,0 +1,111 @@
+#include "bench/bench.h"
+#include "channel.h"
+#include "thread.h"
+
+#define BENCH_CHANNEL_ITEMS (1 << 20)
+#define BENCH_CHANNEL_MAX_PRODUCERS 4
+
+// Roughly the size of a search match
+typedef struct
+{
+    u64 file_index;
+    u32 line;
+    u32 column;
+} BenchChannelItem;
+
+typedef struct
+{
+    Channel* channel;
+    u64 first_item;
+    u64 item_count;
+} BenchChannelProducer;
+
+typedef struct
+{
+    WorkQueue* queue;
+    Channel* channel;
+    u32 producer_count;
+    BenchChannelProducer producers[BENCH_CHANNEL_MAX_PRODUCERS];
+    u64 consumed;
+    u64 checksum;
+} BenchChannel;
+
+internal void bench_channel_produce(void* data)
+{
+    BenchChannelProducer* producer = (BenchChannelProducer*)data;
+    ChannelBatch* batch = channel_acquire(producer->channel, 0);
+    for (u64 i = producer->first_item; i < producer->first_item + producer->item_count; ++i)
+    {
+        BenchChannelItem* item = (BenchChannelItem*)channel_batch_push(batch);
+        if (!item)
+        {
+            channel_publish(producer->channel, batch);
+            batch = channel_acquire(producer->channel, 0);
+            item = (BenchChannelItem*)channel_batch_push(batch);
+        }
+        item->file_index = i;
+        item->line = (u32)i;
+        item->column = 0;
+    }
+    channel_publish(producer->channel, batch);
+}
+
+internal void bench_channel_consume(ChannelBatch* batch, void* data)
+{
+    BenchChannel* b = (BenchChannel*)data;
+    BenchChannelItem* items = (BenchChannelItem*)batch->items;
+    for (u32 i = 0; i < batch->count; ++i)
+        b->checksum += items[i].file_index;
+}
+
+internal void bench_channel_run(void* data)
+{
+    BenchChannel* b = (BenchChannel*)data;
+    b->consumed = 0;
+    b->checksum = 0;
+    for (u32 i = 0; i < b->producer_count; ++i)
+        work_queue_add(b->queue, bench_channel_produce, &b->producers[i]);
+
+    while (b->consumed < BENCH_CHANNEL_ITEMS)
+        b->consumed += channel_drain(b->channel, bench_channel_consume, b, 0);
+    work_queue_complete_all(b->queue);
+
+    ASSERT(b->checksum == (u64)BENCH_CHANNEL_ITEMS*(BENCH_CHANNEL_ITEMS - 1) / 2, "Channel lost or repeated items");
+}
+
+internal BenchChannel* bench_make_channel(Arena* arena, WorkQueue* queue, b32 multi_producer, u32 producer_count)
+{
+    BenchChannel* b = push_struct(arena, BenchChannel);
+    zero_struct(*b);
+    b->queue = queue;
+    b->channel = channel_create(arena, multi_producer, 64, 1024, sizeof(BenchChannelItem));
+    b->producer_count = producer_count;
+    u64 items_per_producer = BENCH_CHANNEL_ITEMS / producer_count;
+    for (u32 i = 0; i < producer_count; ++i)
+    {
+        b->producers[i].channel = b->channel;
+        b->producers[i].first_item = i*items_per_producer;
+        b->producers[i].item_count = items_per_producer;
+    }
+    return b;
+}
+
+internal void bench_suite_channel(BenchHarness* harness, Arena* arena)
+{
+    u32 processor_count = thread_get_processor_count();
+    WorkQueue* queue = work_queue_create(arena, processor_count > 1 ? processor_count - 1 : 1);
+
+    Bench bench = {0};
+    bench.suite = "channel";
+    bench.run = bench_channel_run;
+    bench.items = BENCH_CHANNEL_ITEMS;
+    bench.bytes = (u64)BENCH_CHANNEL_ITEMS*sizeof(BenchChannelItem);
+
+    bench.name = "spsc_1m_items";
+    bench.data = bench_make_channel(arena, queue, false, 1);
+    bench_run(harness, &bench);
+
+    bench.name = "mpsc_4_producers_1m_items";
+    bench.data = bench_make_channel(arena, queue, true, BENCH_CHANNEL_MAX_PRODUCERS);
+    bench_run(harness, &bench);
+}
@@ -0,0 +1,114 @@
+#include "bench/bench.h"
+#include "containers.h"
+#include "str.h"
+
+HASH_MAP_DEFINE(BenchU64Map, bench_u64_map, u64, u32, hash_u64, hash_u64_equal)
+HASH_MAP_DEFINE(BenchStrMap, bench_str_map, s8, u32, s8_hash, s8_equal)
+
+#define BENCH_MAP_KEYS 65536
+
+typedef struct
+{
+    BenchU64Map u64_map;
+    BenchStrMap str_map;
+    u64* keys;
+    s8* str_keys;
+    Arena churn_arena;
+    u32 key_count;
+    u32 found;
+} BenchMap;
+
+internal void bench_map_hit_run(void* data)
+{
+    BenchMap* b = (BenchMap*)data;
+    u32 found = 0;
+    for (u32 i = 0; i < b->key_count; ++i)
+        found += bench_u64_map_get(&b->u64_map, b->keys[i]) != 0;
+    b->found = found;
+}
+
+// Keys with the low bit flipped were never inserted, so every probe runs to the end of its chain
+internal void bench_map_miss_run(void* data)
+{
+    BenchMap* b = (BenchMap*)data;
+    u32 found = 0;
+    for (u32 i = 0; i < b->key_count; ++i)
+        found += bench_u64_map_get(&b->u64_map, b->keys[i] ^ 1) != 0;
+    b->found = found;
+}
+
+internal void bench_map_str_hit_run(void* data)
+{
+    BenchMap* b = (BenchMap*)data;
+    u32 found = 0;
+    for (u32 i = 0; i < b->key_count; ++i)
+        found += bench_str_map_get(&b->str_map, b->str_keys[i]) != 0;
+    b->found = found;
+}
+
+internal void bench_map_churn_reset(void* data)
+{
+    BenchMap* b = (BenchMap*)data;
+    arena_clear(&b->churn_arena);
+}
+
+// Insert every key into a fresh map that has to grow, then remove them all
+internal void bench_map_churn_run(void* data)
+{
+    BenchMap* b = (BenchMap*)data;
+    BenchU64Map map;
+    bench_u64_map_init(&map, &b->churn_arena, 16);
+    for (u32 i = 0; i < b->key_count; ++i)
+        bench_u64_map_put(&map, b->keys[i], i);
+    for (u32 i = 0; i < b->key_count; ++i)
+        bench_u64_map_remove(&map, b->keys[i]);
+    b->found = map.core.count;
+}
+
+internal void bench_suite_containers(BenchHarness* harness, Arena* arena)
+{
+    BenchMap* b = push_struct(arena, BenchMap);
+    zero_struct(*b);
+    b->key_count = BENCH_MAP_KEYS;
+    b->keys = push_array(arena, b->key_count, u64);
+    b->str_keys = push_array(arena, b->key_count, s8);
+    b->churn_arena = arena_alloc(MEGABYTES(16));
+
+    // Sized up front so filling never grows the maps
+    bench_u64_map_init(&b->u64_map, arena, b->key_count + b->key_count/8);
+    bench_str_map_init(&b->str_map, arena, b->key_count + b->key_count/8);
+    u64 state = 0x2545F4914F6CDD1Dull;
+    for (u32 i = 0; i < b->key_count; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        b->keys[i] = state & ~1ull;
+        b->str_keys[i] = s8_format(arena, "res/icons/icon_%u.bmp", i);
+        bench_u64_map_put(&b->u64_map, b->keys[i], i);
+        bench_str_map_put(&b->str_map, b->str_keys[i], i);
+    }
+
+    Bench bench = {0};
+    bench.suite = "containers";
+    bench.data = b;
+    bench.items = b->key_count;
+
+    bench.name = "hash_map_u64_hit";
+    bench.run = bench_map_hit_run;
+    bench_run(harness, &bench);
+
+    bench.name = "hash_map_u64_miss";
+    bench.run = bench_map_miss_run;
+    bench_run(harness, &bench);
+
+    bench.name = "hash_map_s8_hit";
+    bench.run = bench_map_str_hit_run;
+    bench_run(harness, &bench);
+
+    bench.name = "hash_map_u64_insert_remove";
+    bench.run = bench_map_churn_run;
+    bench.reset = bench_map_churn_reset;
+    bench.items = 2*b->key_count;
+    bench_run(harness, &bench);
+}
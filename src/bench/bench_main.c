@@ -0,0 +1,98 @@
+#include "grapple_math.h"
+#include "profiler.h"
+#include "types.h"
+#include "str.h"
+
+#include "grapple_memory.c"
+#include "timer.c"
+#include "profiler.c"
+#include "inflate.c"
+#include "renderer/renderer.c"
+#include "renderer/texture.c"
+#include "renderer/thumbnail.c"
+#include "thread.c"
+#include "channel.c"
+#include "ipc.c"
+#include "zstd.c"
+#include "search/search.c"
+#include "search/ignore.c"
+#include "search/walk.c"
+#include "search/fuzzy.c"
+#include "search/snapshot.c"
+#include "search/query.c"
+#include "search/replace.c"
+#include "search/daemon.c"
+#include "search/search_cli.c"
+
+#include "bench/bench.c"
+#include "bench/bench_channel.c"
+#include "bench/bench_containers.c"
+#include "bench/bench_math.c"
+#include "bench/bench_memory.c"
+#include "bench/bench_renderer.c"
+#include "bench/bench_str.c"
+#include "bench/bench_texture.c"
+#include "bench/bench_search.c" // Compresses its data with bench_deflate_fixed
+
+#include <stdio.h> // printf
+#include <stdlib.h> // atoi
+#include <string.h> // strcmp
+
+internal void bench_print_usage(void)
+{
+    printf("Usage: grapple_bench [--warmup N] [--reps N] [--filter SUBSTRING] [--json FILE]\n");
+}
+
+int main(int argc, char** argv)
+{
+    u32 warmup = 10;
+    u32 repetitions = 200;
+    const char* filter = 0;
+    char* json_filename = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        b32 has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--warmup") == 0 && has_value)
+            warmup = (u32)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--reps") == 0 && has_value)
+            repetitions = (u32)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && has_value)
+            filter = argv[++i];
+        else if (strcmp(argv[i], "--json") == 0 && has_value)
+            json_filename = argv[++i];
+        else
+        {
+            bench_print_usage();
+            return 1;
+        }
+    }
+    if (repetitions == 0)
+        repetitions = 1;
+
+    PROFILE_INIT();
+
+    Arena arena = arena_alloc(MEGABYTES(64));
+
+    BenchHarness* harness = push_struct(&arena, BenchHarness);
+    bench_harness_init(harness, &arena, warmup, repetitions);
+    harness->filter = filter;
+    bench_print_header(harness);
+
+    bench_suite_memory(harness, &arena);
+    bench_suite_containers(harness, &arena);
+    bench_suite_math(harness, &arena);
+    bench_suite_texture(harness, &arena);
+    bench_suite_renderer(harness, &arena);
+    bench_suite_str(harness, &arena);
+    bench_suite_channel(harness, &arena);
+    bench_suite_search(harness, &arena);
+
+    if (json_filename && !bench_write_json(harness, json_filename))
+    {
+        printf("Failed to write %s\n", json_filename);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "bench/bench.h"
+#include "grapple_math.h"
+#include "renderer/renderer.h"
+
+typedef struct
+{
+    QuadsSoA quads;
+    size count;
+    f32* out;
+    m2x3* transform;
+    rect* clip;
+} BenchQuadsExpand;
+
+internal void bench_quads_expand_run(void* data)
+{
+    BenchQuadsExpand* b = (BenchQuadsExpand*)data;
+    quads_expand(b->out, b->quads, b->count, b->transform, b->clip);
+}
+
+internal void bench_suite_math(BenchHarness* harness, Arena* arena)
+{
+    size count = 8192;
+
+    // A glyph-like grid: small quads laid out in rows, with per-glyph UV rects
+    QuadsSoA quads = quads_soa_alloc(arena, count);
+    for (size i = 0; i < count; ++i)
+    {
+        quads.x[i] = (f32)(i % 128)*9.0f;
+        quads.y[i] = (f32)(i / 128)*18.0f;
+        quads.w[i] = 8.0f;
+        quads.h[i] = 16.0f;
+        quads.u0[i] = (f32)(i % 16)/16.0f;
+        quads.v0[i] = 1.0f;
+        quads.u1[i] = (f32)(i % 16 + 1)/16.0f;
+        quads.v1[i] = 0.0f;
+    }
+
+    m2x3* transform = push_struct(arena, m2x3);
+    *transform = m2x3_translate_scale(v2(10.0f, 20.0f), v2(1.25f, 1.25f));
+    rect* clip = push_struct(arena, rect);
+    *clip = rect_min_max(v2(100.0f, 100.0f), v2(700.0f, 500.0f));
+
+    BenchQuadsExpand* plain = push_struct(arena, BenchQuadsExpand);
+    plain->quads = quads;
+    plain->count = count;
+    plain->out = push_array(arena, count*16, f32);
+    plain->transform = 0;
+    plain->clip = 0;
+
+    BenchQuadsExpand* clipped = push_struct(arena, BenchQuadsExpand);
+    *clipped = *plain;
+    clipped->clip = clip;
+
+    BenchQuadsExpand* transformed = push_struct(arena, BenchQuadsExpand);
+    *transformed = *plain;
+    transformed->clip = clip;
+    transformed->transform = transform;
+
+    // Bytes written, which is what the kernel should be bound by
+    Bench bench = {0};
+    bench.suite = "math";
+    bench.run = bench_quads_expand_run;
+    bench.items = (u64)count;
+    bench.bytes = (u64)count*16*sizeof(f32);
+
+    bench.name = "quads_expand_8192";
+    bench.data = plain;
+    bench_run(harness, &bench);
+
+    bench.name = "quads_expand_clip_8192";
+    bench.data = clipped;
+    bench_run(harness, &bench);
+
+    bench.name = "quads_expand_transform_clip_8192";
+    bench.data = transformed;
+    bench_run(harness, &bench);
+}
@@ -0,0 +1,50 @@
+#include "bench/bench.h"
+#include "grapple_memory.h"
+
+typedef struct
+{
+    Arena arena;
+    size push_bytes;
+    u32 push_count;
+} BenchPushSize;
+
+internal void bench_push_size_reset(void* data)
+{
+    BenchPushSize* b = (BenchPushSize*)data;
+    arena_clear(&b->arena);
+}
+
+internal void bench_push_size_run(void* data)
+{
+    BenchPushSize* b = (BenchPushSize*)data;
+    for (u32 i = 0; i < b->push_count; ++i)
+    {
+        u8* p = (u8*)push_size_(&b->arena, b->push_bytes);
+        // Touch the allocation so the push can't be optimized away
+        p[0] = (u8)i;
+    }
+}
+
+internal void bench_suite_memory(BenchHarness* harness, Arena* arena)
+{
+    persist size push_sizes[] = {16, 256, 4096};
+    u32 push_count = 4096;
+
+    for (u32 i = 0; i < countof(push_sizes); ++i)
+    {
+        BenchPushSize* b = push_struct(arena, BenchPushSize);
+        b->push_bytes = push_sizes[i];
+        b->push_count = push_count;
+        b->arena = arena_alloc(b->push_bytes*push_count);
+
+        persist const char* names[] = {"push_size_16", "push_size_256", "push_size_4096"};
+        Bench bench = {0};
+        bench.suite = "memory";
+        bench.name = names[i];
+        bench.run = bench_push_size_run;
+        bench.reset = bench_push_size_reset;
+        bench.data = b;
+        bench.items = push_count;
+        bench_run(harness, &bench);
+    }
+}
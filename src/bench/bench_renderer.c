@@ -0,0 +1,156 @@
+#include "bench/bench.h"
+#include "renderer/renderer.h"
+#include "thread.h"
+
+typedef struct
+{
+    Renderer* renderer;
+    Texture* textures[2];
+    u32 quad_count;
+    b32 alternate_textures;
+    QuadsSoA quads;
+} BenchQuads;
+
+internal void bench_quads_run(void* data)
+{
+    BenchQuads* b = (BenchQuads*)data;
+    Renderer* renderer = b->renderer;
+
+    renderer_invalidate_all(renderer);
+    renderer_begin_frame(renderer, 0);
+    v2 tex_size = v2_full(32.0f);
+    for (u32 i = 0; i < b->quad_count; ++i)
+    {
+        Texture* texture = b->textures[b->alternate_textures ? ((i >> 4) & 1) : 0];
+        v2 pos = v2((f32)(i & 63)*8.0f, (f32)(i >> 6)*8.0f);
+        renderer_draw_texture(renderer, texture, pos, tex_size);
+    }
+    renderer_end_frame(renderer);
+}
+
+internal void bench_draw_quads_run(void* data)
+{
+    BenchQuads* b = (BenchQuads*)data;
+    Renderer* renderer = b->renderer;
+
+    renderer_invalidate_all(renderer);
+    renderer_begin_frame(renderer, 0);
+    renderer_draw_quads(renderer, b->textures[0], b->quads, b->quad_count, 0, 0);
+    renderer_end_frame(renderer);
+}
+
+#define BENCH_DRAW_LIST_COUNT 8
+
+typedef struct
+{
+    DrawList* list;
+    Texture* texture;
+    Renderer* renderer;
+    QuadsSoA quads;
+    size count;
+} BenchDrawListJob;
+
+typedef struct
+{
+    Renderer* renderer;
+    WorkQueue* queue;
+    BenchDrawListJob jobs[BENCH_DRAW_LIST_COUNT];
+} BenchDrawLists;
+
+internal void bench_draw_list_job(void* data)
+{
+    BenchDrawListJob* job = (BenchDrawListJob*)data;
+    draw_list_quads(job->list, job->texture, job->quads, job->count, 0, 0);
+    renderer_submit_draw_list(job->renderer, job->list);
+}
+
+internal void bench_draw_lists_run(void* data)
+{
+    BenchDrawLists* b = (BenchDrawLists*)data;
+    Renderer* renderer = b->renderer;
+
+    renderer_invalidate_all(renderer);
+    renderer_begin_frame(renderer, 0);
+    for (u32 i = 0; i < BENCH_DRAW_LIST_COUNT; ++i)
+    {
+        draw_list_reset(b->jobs[i].list, renderer, i);
+        work_queue_add(b->queue, bench_draw_list_job, &b->jobs[i]);
+    }
+    work_queue_complete_all(b->queue);
+    renderer_end_frame(renderer);
+}
+
+internal void bench_suite_renderer(BenchHarness* harness, Arena* arena)
+{
+    Renderer* renderer = renderer_create(0, arena);
+
+    Texture* textures = push_array(arena, 2, Texture);
+    zero_array(textures, 2, Texture);
+    renderer_upload_texture(renderer, &textures[0]);
+    renderer_upload_texture(renderer, &textures[1]);
+
+    BenchQuads* b = push_struct(arena, BenchQuads);
+    b->renderer = renderer;
+    b->textures[0] = &textures[0];
+    b->textures[1] = &textures[1];
+    b->quad_count = 8000; // Same load as the demo scene in main.c
+
+    Bench bench = {0};
+    bench.suite = "renderer";
+    bench.run = bench_quads_run;
+    bench.data = b;
+    bench.items = b->quad_count;
+    bench.bytes = (u64)b->quad_count*4*sizeof(Vertex);
+
+    b->alternate_textures = false;
+    bench.name = "draw_texture_one_texture_8000";
+    bench_run(harness, &bench);
+
+    // Switching texture every 16 quads forces a flush each time
+    BenchQuads* switching = push_struct(arena, BenchQuads);
+    *switching = *b;
+    switching->alternate_textures = true;
+    bench.name = "draw_texture_switching_8000";
+    bench.data = switching;
+    bench_run(harness, &bench);
+
+    // Same scene through the batched SoA path
+    BenchQuads* batched = push_struct(arena, BenchQuads);
+    *batched = *b;
+    batched->quads = quads_soa_alloc(arena, b->quad_count);
+    for (u32 i = 0; i < b->quad_count; ++i)
+    {
+        batched->quads.x[i] = (f32)(i & 63)*8.0f;
+        batched->quads.y[i] = (f32)(i >> 6)*8.0f;
+        batched->quads.w[i] = 32.0f;
+        batched->quads.h[i] = 32.0f;
+        batched->quads.u0[i] = 0.0f;
+        batched->quads.v0[i] = 1.0f;
+        batched->quads.u1[i] = 1.0f;
+        batched->quads.v1[i] = 0.0f;
+    }
+    bench.name = "draw_quads_8000";
+    bench.run = bench_draw_quads_run;
+    bench.data = batched;
+    bench_run(harness, &bench);
+
+    // Same scene again, recorded into draw lists on worker threads and merged at the end of the frame
+    u32 processor_count = thread_get_processor_count();
+    BenchDrawLists* lists = push_struct(arena, BenchDrawLists);
+    lists->renderer = renderer;
+    lists->queue = work_queue_create(arena, processor_count > 1 ? processor_count - 1 : 1);
+    u32 quads_per_list = b->quad_count / BENCH_DRAW_LIST_COUNT;
+    for (u32 i = 0; i < BENCH_DRAW_LIST_COUNT; ++i)
+    {
+        BenchDrawListJob* job = &lists->jobs[i];
+        job->list = draw_list_create(arena, quads_per_list, 16);
+        job->texture = b->textures[0];
+        job->renderer = renderer;
+        job->quads = quads_soa_offset(batched->quads, i*quads_per_list);
+        job->count = quads_per_list;
+    }
+    bench.name = "draw_lists_8000";
+    bench.run = bench_draw_lists_run;
+    bench.data = lists;
+    bench_run(harness, &bench);
+}
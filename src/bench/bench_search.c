@@ -0,0 +1,631 @@
+#include "bench/bench.h"
+#include "search/fuzzy.h"
+#include "search/ignore.h"
+#include "search/query.h"
+#include "search/search.h"
+#include "search/search_cli.h"
+#include "search/snapshot.h"
+#include "thread.h"
+
+#include <stdio.h> // snprintf
+#include <string.h> // memcpy, memset
+
+#define BENCH_SEARCH_TEXT_SIZE MEGABYTES(4)
+#define BENCH_SEARCH_BIG_TEXT_SIZE MEGABYTES(64) // Big enough to be split between the workers
+#define BENCH_SEARCH_BGZF_BLOCK KILOBYTES(32)
+#define BENCH_CLI_OUTPUT_SIZE MEGABYTES(64)
+#define BENCH_QUERY_FILE_SIZE KILOBYTES(32) // The big text is cut into files of this size
+#define BENCH_FUZZY_PATHS 1000000
+#define BENCH_SNAPSHOT_DIRECTORIES 100
+#define BENCH_SNAPSHOT_SUBDIRECTORIES 20
+#define BENCH_SNAPSHOT_FILES 100 // Per subdirectory, so 200,000 in all
+
+typedef struct
+{
+    SearchContext* context;
+    SearchQuery query;
+    u8* data;
+    size data_size;
+    u64 expected_matches; // From searching the plain text, 0 for that bench itself
+} BenchSearch;
+
+internal void bench_search_run(void* data)
+{
+    BenchSearch* b = (BenchSearch*)data;
+    SearchFileResult result = search_memory(b->context, &b->query, b->data, b->data_size, 0);
+    ASSERT(result.status == SearchStatus_Ok, "Search failed");
+    ASSERT(!b->expected_matches || result.match_count == b->expected_matches,
+           "Search found different matches than the plain one");
+    b->expected_matches = result.match_count;
+}
+
+// Log-like lines, with the needle on a few of them
+internal size bench_make_search_text(u8* out, size out_size)
+{
+    const char* levels[] = {"INFO", "DEBUG", "WARN", "INFO", "TRACE"};
+    const char* messages[] = {
+        "request served in %u us",
+        "cache miss for key %u, fetching from backing store",
+        "connection %u closed by peer",
+        "retrying upload of chunk %u after a connection timeout",
+        "flushed %u dirty pages to disk",
+    };
+
+    u32 seed = 12345;
+    size pos = 0;
+    for (u32 line = 0;; ++line)
+    {
+        seed = seed*1664525u + 1013904223u;
+        u32 message = (seed >> 8) % countof(messages);
+        char text[160];
+        int length = snprintf(text, sizeof(text), "2024-03-%02u 12:%02u:%02u.%03u [%s] ", 1 + line % 28,
+                              (line / 60) % 60, line % 60, seed % 1000, levels[(seed >> 4) % countof(levels)]);
+        length += snprintf(text + length, sizeof(text) - (usize)length, messages[message], seed >> 12);
+        text[length++] = '\n';
+        if (pos + length > out_size)
+            break;
+        memcpy(out + pos, text, (usize)length);
+        pos += length;
+    }
+    return pos;
+}
+
+// Wraps bench_deflate_fixed's zlib stream in a gzip member. The zlib header goes where the gzip header ends.
+internal size bench_gzip_member(u8* in, size in_size, u8* out, Arena* scratch, b32 bgzf)
+{
+    size header_size = bgzf ? 18 : 10;
+    size zlib_size = bench_deflate_fixed(in, in_size, out + header_size - 2, scratch);
+
+    u8 header[18] = {0x1F, 0x8B, 8, 0, 0, 0, 0, 0, 0, 0xFF};
+    if (bgzf)
+    {
+        header[3] = 4; // FEXTRA with a BGZF "BC" subfield, whose value is filled in below
+        header[10] = 6;
+        header[12] = 'B';
+        header[13] = 'C';
+        header[14] = 2;
+    }
+    memcpy(out, header, (usize)header_size);
+
+    // Past the deflate data, replacing the Adler-32
+    size member_size = header_size + zlib_size - 2 - 4 + 8;
+    u8* trailer = out + member_size - 8;
+    u32 crc = inflate_crc32(0, in, in_size);
+    trailer[0] = (u8)crc;
+    trailer[1] = (u8)(crc >> 8);
+    trailer[2] = (u8)(crc >> 16);
+    trailer[3] = (u8)(crc >> 24);
+    trailer[4] = (u8)in_size;
+    trailer[5] = (u8)(in_size >> 8);
+    trailer[6] = (u8)(in_size >> 16);
+    trailer[7] = (u8)(in_size >> 24);
+
+    if (bgzf)
+    {
+        ASSERT(member_size <= (size)KILOBYTES(64), "BGZF members must fit in 64 KB");
+        out[16] = (u8)(member_size - 1);
+        out[17] = (u8)((member_size - 1) >> 8);
+    }
+    return member_size;
+}
+
+typedef struct
+{
+    u8* head;
+    size head_size;
+    SearchFileKind kind;
+} BenchClassify;
+
+internal void bench_classify_run(void* data)
+{
+    BenchClassify* b = (BenchClassify*)data;
+    SearchFileKind kind = search_classify(b->head, b->head_size);
+    ASSERT(kind == b->kind, "Misclassified bench data");
+    (void)kind;
+}
+
+typedef struct
+{
+    IgnoreMatcher matcher;
+    s8* paths;
+    u32 path_count;
+    u32 expected_ignored; // From the first run
+} BenchIgnore;
+
+internal void bench_ignore_run(void* data)
+{
+    BenchIgnore* b = (BenchIgnore*)data;
+    u32 ignored = 0;
+    for (u32 i = 0; i < b->path_count; ++i)
+    {
+        s8 path = b->paths[i];
+        s8 name = path;
+        for (size j = path.len; j > 0; --j)
+        {
+            if (path.data[j - 1] == '/')
+            {
+                name = (s8){path.data + j, path.len - j};
+                break;
+            }
+        }
+        ignored += (ignore_match(&b->matcher, path, name, false) == IgnoreMatch_Ignore);
+    }
+    ASSERT(!b->expected_ignored || ignored == b->expected_ignored, "Ignore rules matched differently");
+    b->expected_ignored = ignored;
+}
+
+// A .gitignore like the ones in real projects: mostly names and extensions, a few globs and anchored paths
+internal void bench_make_ignore(BenchIgnore* b, Arena* arena)
+{
+    const char* rules[] = {
+        "# Build output", "build/", "out/", "bin/", "obj/", "dist/", "target/", "*.o", "*.obj", "*.a", "*.lib",
+        "*.so", "*.dll", "*.exe", "*.pdb", "*.ilk", "*.exp", "*.d", "*.gch", "*.pch", "",
+        "# Editors", ".vscode/", ".idea/", "*.swp", "*.swo", "*~", ".DS_Store", "Thumbs.db", "*.sublime-*",
+        "# Dependencies", "node_modules/", "vendor/", "__pycache__/", "*.pyc", ".venv/", "",
+        "# Logs and data", "*.log", "logs/**/*.txt", "/data/raw/", "tmp_*", "*.tmp", "core.[0-9]*",
+        "docs/_build/", "**/generated/*.h", "!docs/_build/keep.html", "!important.log", "coverage/",
+        "*.gcda", "*.gcno", "*.profraw", "compile_commands.json", "/local.cfg",
+    };
+    const char* dirs[] = {"src", "src/renderer", "src/platform/linux", "tests", "docs", "tools/gen", "logs/2024",
+                          "third_party/lib", "src/generated", "assets/textures"};
+    const char* stems[] = {"main", "texture", "renderer", "inflate", "thread", "util", "app", "core", "debug"};
+    const char* extensions[] = {".c", ".h", ".o", ".txt", ".log", ".md", ".png", ".tmp", ".cpp", ".py"};
+
+    ignore_matcher_init(&b->matcher, arena);
+    for (u32 i = 0; i < countof(rules); ++i)
+        ignore_add_rule(&b->matcher, s8_format(arena, "%s", rules[i]));
+
+    b->path_count = 10000;
+    b->paths = push_array(arena, b->path_count, s8);
+    u32 seed = 99;
+    for (u32 i = 0; i < b->path_count; ++i)
+    {
+        seed = seed*1664525u + 1013904223u;
+        b->paths[i] = s8_format(arena, "%s/%s_%u%s", dirs[(seed >> 4) % countof(dirs)],
+                                stems[(seed >> 10) % countof(stems)], (seed >> 16) % 100,
+                                extensions[(seed >> 24) % countof(extensions)]);
+    }
+    b->expected_ignored = 0;
+}
+
+typedef struct
+{
+    FuzzyFinder* finder;
+    FuzzyTable table;
+    FuzzyQuery query;
+    FuzzyResult results[FUZZY_MAX_RESULTS];
+} BenchFuzzy;
+
+internal void bench_fuzzy_run(void* data)
+{
+    BenchFuzzy* b = (BenchFuzzy*)data;
+    FuzzyFindResult result = fuzzy_find(b->finder, &b->table, &b->query, b->results);
+    ASSERT(result.result_count > 0, "Fuzzy query found nothing");
+    (void)result;
+}
+
+// A source tree that goes a few directories deep, with the same names turning up all over it
+internal void bench_make_fuzzy_paths(FuzzyTable* table, u32 path_count)
+{
+    const char* dirs[] = {"src", "include", "renderer", "platform", "linux", "win32", "tests", "tools", "third_party",
+                          "assets", "textures", "shaders", "core", "util", "net", "audio", "ui", "build", "docs"};
+    const char* stems[] = {"main", "texture", "renderer", "inflate", "thread", "memory", "window", "input", "file",
+                           "channel", "profiler", "atlas", "sampler", "decoder", "parser", "socket", "mixer"};
+    const char* extensions[] = {".c", ".h", ".cpp", ".md", ".txt", ".png", ".glsl", ".py"};
+
+    u32 seed = 7;
+    for (u32 i = 0; i < path_count; ++i)
+    {
+        char path[256];
+        int length = 0;
+        seed = seed*1664525u + 1013904223u;
+        u32 depth = 1 + (seed >> 28) % 5;
+        for (u32 d = 0; d < depth; ++d)
+        {
+            seed = seed*1664525u + 1013904223u;
+            length += snprintf(path + length, sizeof(path) - (usize)length, "%s/", dirs[(seed >> 16) % countof(dirs)]);
+        }
+        seed = seed*1664525u + 1013904223u;
+        length += snprintf(path + length, sizeof(path) - (usize)length, "%s_%u%s", stems[(seed >> 8) % countof(stems)],
+                           (seed >> 20) % 1000, extensions[(seed >> 4) % countof(extensions)]);
+        s8 entry = {(u8*)path, length};
+        fuzzy_table_add(table, entry);
+    }
+}
+
+typedef struct
+{
+    s8 image;
+    FuzzyTable table;
+    Arena scratch;
+} BenchSnapshot;
+
+internal void bench_snapshot_add_file(s8 path, SnapshotNode* node, void* data)
+{
+    (void)node;
+    fuzzy_table_add((FuzzyTable*)data, path);
+}
+
+// What startup does with a snapshot: check it, then turn it into the table the file finder searches
+internal void bench_snapshot_run(void* data)
+{
+    BenchSnapshot* b = (BenchSnapshot*)data;
+    Snapshot snapshot;
+    b32 loaded = snapshot_from_memory(&snapshot, b->image.data, b->image.len);
+    ASSERT(loaded, "Bench snapshot didn't load");
+    (void)loaded;
+
+    fuzzy_table_clear(&b->table);
+    snapshot_for_each_file(&snapshot, &b->scratch, bench_snapshot_add_file, &b->table);
+    ASSERT(b->table.path_count == snapshot.header->file_count, "Snapshot lost files");
+}
+
+internal b32 bench_make_snapshot(BenchSnapshot* b, Arena* arena)
+{
+    SnapshotBuilder* builder = push_struct(arena, SnapshotBuilder);
+    WalkOptions options = {0};
+    snapshot_builder_init(builder, arena, s8("/home/user/project"), &options);
+
+    FileInfo info = {0};
+    info.kind = FileEntryKind_Directory;
+    snapshot_builder_add(builder, s8(""), &info, 0);
+    char path[128];
+    for (u32 i = 0; i < BENCH_SNAPSHOT_DIRECTORIES; ++i)
+    {
+        info.kind = FileEntryKind_Directory;
+        int length = snprintf(path, sizeof(path), "module_%u", i);
+        snapshot_builder_add(builder, (s8){(u8*)path, length}, &info, 0);
+        for (u32 j = 0; j < BENCH_SNAPSHOT_SUBDIRECTORIES; ++j)
+        {
+            info.kind = FileEntryKind_Directory;
+            length = snprintf(path, sizeof(path), "module_%u/src_%u", i, j);
+            snapshot_builder_add(builder, (s8){(u8*)path, length}, &info, 0);
+            for (u32 k = 0; k < BENCH_SNAPSHOT_FILES; ++k)
+            {
+                info.kind = FileEntryKind_File;
+                info.size = k*100;
+                ++info.id;
+                length = snprintf(path, sizeof(path), "module_%u/src_%u/file_%u.c", i, j, k);
+                snapshot_builder_add(builder, (s8){(u8*)path, length}, &info, 0);
+            }
+        }
+    }
+
+    b->image = snapshot_builder_finish(builder);
+    b->scratch = arena_alloc(MEGABYTES(4));
+    u32 file_count = BENCH_SNAPSHOT_DIRECTORIES*BENCH_SNAPSHOT_SUBDIRECTORIES*BENCH_SNAPSHOT_FILES;
+    return b->image.data && b->scratch.data && fuzzy_table_create(&b->table, file_count, 40);
+}
+
+typedef struct
+{
+    QueryExecutor* executor;
+    s8 needle;
+    size first_length;
+    b32 forget_first; // Otherwise the history is kept from the last run
+    b32 forget_each;
+} BenchQuery;
+
+// Types the needle a letter at a time from first_length, each query running to the end before the next one
+internal void bench_query_run(void* data)
+{
+    BenchQuery* b = (BenchQuery*)data;
+    if (b->forget_first)
+        query_forget(b->executor);
+    for (size length = b->first_length; length <= b->needle.len; ++length)
+    {
+        if (b->forget_each)
+            query_forget(b->executor);
+        s8 needle = {b->needle.data, length};
+        QueryStats stats = query_run(b->executor, needle, 0, (u32)length);
+        ASSERT(stats.files_searched > 0 && !stats.cancelled, "Query searched nothing");
+        (void)stats;
+    }
+}
+
+typedef struct
+{
+    BenchSearch* search;
+    SearchCliFileOutput output;
+} BenchCli;
+
+internal void bench_cli_on_match(SearchMatch* match, void* data)
+{
+    search_cli_write_match((SearchCliFileOutput*)data, match);
+}
+
+// Searches with the command line's output formatting, into memory instead of stdout
+internal void bench_cli_run(void* data)
+{
+    BenchCli* b = (BenchCli*)data;
+    b->output.writer->used = 0;
+    SearchQuery query = b->search->query;
+    query.on_match = bench_cli_on_match;
+    query.match_data = &b->output;
+    SearchFileResult result = search_memory(b->search->context, &query, b->search->data, b->search->data_size, 0);
+    ASSERT(result.match_count == b->search->expected_matches, "Formatted search found different matches");
+    ASSERT(!b->output.writer->overflowed, "Formatted matches didn't fit");
+    (void)result;
+}
+
+#define BENCH_RING_ROUNDS 16
+
+typedef struct
+{
+    DaemonRing* ring;
+    DaemonCell batch;
+    CancelToken token;
+} BenchRing;
+
+// Fills the daemon's result ring and drains it again, as a worker and a client taking turns
+internal void bench_ring_run(void* data)
+{
+    BenchRing* b = (BenchRing*)data;
+    u64 drained = 0;
+    for (u32 round = 0; round < BENCH_RING_ROUNDS; ++round)
+    {
+        for (u32 i = 0; i < DAEMON_RING_CELLS; ++i)
+            daemon_ring_push(b->ring, &b->batch, round, &b->token);
+        for (DaemonCell* cell = daemon_ring_peek(b->ring); cell; cell = daemon_ring_peek(b->ring))
+        {
+            drained += cell->count;
+            daemon_ring_release(b->ring, cell);
+        }
+    }
+    ASSERT(drained == (u64)BENCH_RING_ROUNDS*DAEMON_RING_CELLS*DAEMON_RING_BATCH, "Ring lost matches");
+    (void)drained;
+}
+
+internal BenchSearch* bench_make_search(Arena* arena, SearchContext* context, u8* data, size data_size)
+{
+    BenchSearch* b = push_struct(arena, BenchSearch);
+    zero_struct(*b);
+    b->context = context;
+    b->query.needle = s8("connection timeout");
+    b->data = data;
+    b->data_size = data_size;
+    return b;
+}
+
+internal void bench_suite_search(BenchHarness* harness, Arena* arena)
+{
+    u32 processor_count = thread_get_processor_count();
+    WorkQueue* queue = work_queue_create(arena, processor_count > 1 ? processor_count - 1 : 1);
+    SearchContext* context = search_context_create(arena, queue);
+
+    u8* text = push_array(arena, BENCH_SEARCH_TEXT_SIZE, u8);
+    size text_size = bench_make_search_text(text, BENCH_SEARCH_TEXT_SIZE);
+
+    // The fixed Huffman encoder never grows text by more than a few percent
+    size max_compressed = text_size + text_size/4 + KILOBYTES(64);
+    u8* gzip = push_array(arena, max_compressed, u8);
+    size gzip_size = bench_gzip_member(text, text_size, gzip, arena, false);
+
+    u8* bgzf = push_array(arena, max_compressed, u8);
+    size bgzf_size = 0;
+    for (size pos = 0; pos < text_size; pos += BENCH_SEARCH_BGZF_BLOCK)
+    {
+        size block = text_size - pos;
+        if (block > (size)BENCH_SEARCH_BGZF_BLOCK)
+            block = BENCH_SEARCH_BGZF_BLOCK;
+        bgzf_size += bench_gzip_member(text + pos, block, bgzf + bgzf_size, arena, true);
+    }
+
+    Bench bench = {0};
+    bench.suite = "search";
+    bench.run = bench_search_run;
+    bench.bytes = (u64)text_size;
+
+    BenchSearch* plain = bench_make_search(arena, context, text, text_size);
+    bench.name = "search_memory_plain_4mb";
+    bench.data = plain;
+    bench_run(harness, &bench);
+
+    // Case-insensitive, against the same matches. Without a k or an s the needle's letters only have cases in ASCII,
+    // so it gets the ASCII search, and "chunk" has the Kelvin sign as a case of its k, so it gets the Unicode one.
+    bench.name = "search_memory_icase_ascii_4mb";
+    bench.data = bench_make_search(arena, context, text, text_size);
+    ((BenchSearch*)bench.data)->query.needle = s8("Connection TIMEOUT");
+    ((BenchSearch*)bench.data)->query.match_case = SearchCase_Unicode;
+    ((BenchSearch*)bench.data)->expected_matches = plain->expected_matches;
+    bench_run(harness, &bench);
+
+    bench.name = "search_memory_icase_unicode_4mb";
+    bench.data = bench_make_search(arena, context, text, text_size);
+    ((BenchSearch*)bench.data)->query.needle = s8("Upload of CHUNK");
+    ((BenchSearch*)bench.data)->query.match_case = SearchCase_Unicode;
+    ((BenchSearch*)bench.data)->expected_matches = plain->expected_matches;
+    bench_run(harness, &bench);
+
+    // Matches are checked against the plain search, so it has to run first
+    bench.name = "search_memory_gzip_4mb";
+    bench.data = bench_make_search(arena, context, gzip, gzip_size);
+    ((BenchSearch*)bench.data)->expected_matches = plain->expected_matches;
+    bench_run(harness, &bench);
+
+    bench.name = "search_memory_bgzf_4mb";
+    bench.data = bench_make_search(arena, context, bgzf, bgzf_size);
+    ((BenchSearch*)bench.data)->expected_matches = plain->expected_matches;
+    bench_run(harness, &bench);
+
+    // The same text as UTF-16LE with a byte order mark, searched as it is for the needle in UTF-16
+    u8* utf16 = push_array(arena, text_size*2 + 2, u8);
+    utf16[0] = 0xFF;
+    utf16[1] = 0xFE;
+    for (size i = 0; i < text_size; ++i)
+    {
+        utf16[2 + i*2] = text[i];
+        utf16[2 + i*2 + 1] = 0;
+    }
+    bench.name = "search_memory_utf16_4mb";
+    bench.data = bench_make_search(arena, context, utf16, text_size*2 + 2);
+    ((BenchSearch*)bench.data)->expected_matches = plain->expected_matches;
+    bench.bytes = (u64)(text_size*2 + 2);
+    bench_run(harness, &bench);
+
+    bench.name = "search_memory_utf16_icase_4mb";
+    bench.data = bench_make_search(arena, context, utf16, text_size*2 + 2);
+    ((BenchSearch*)bench.data)->query.needle = s8("Upload of CHUNK");
+    ((BenchSearch*)bench.data)->query.match_case = SearchCase_Unicode;
+    ((BenchSearch*)bench.data)->expected_matches = plain->expected_matches;
+    bench_run(harness, &bench);
+
+    // Skipped after the head, so this is the cost of not searching a binary
+    u8* binary = push_array(arena, text_size, u8);
+    u32 seed = 1;
+    for (size i = 0; i < text_size; ++i)
+    {
+        seed = seed*1664525u + 1013904223u;
+        binary[i] = (u8)(seed >> 24);
+    }
+    bench.name = "search_memory_binary_4mb";
+    bench.data = bench_make_search(arena, context, binary, text_size);
+    bench.bytes = (u64)text_size;
+    bench_run(harness, &bench);
+
+    // Every match written out as the command line would, with the text of its line
+    Arena cli_arena = arena_alloc(BENCH_CLI_OUTPUT_SIZE);
+    SearchCliWriter* cli_writer = push_struct(arena, SearchCliWriter);
+    zero_struct(*cli_writer);
+    cli_writer->data = cli_arena.data;
+    cli_writer->capacity = cli_arena.bytes;
+    BenchCli* cli = push_struct(arena, BenchCli);
+    zero_struct(*cli);
+    cli->search = plain;
+    cli->output.format = SearchCliFormat_Plain;
+    cli->output.writer = cli_writer;
+    cli->output.path = s8("logs/2024/service.log");
+    cli->output.data = text;
+    cli->output.data_size = text_size;
+    bench.name = "search_cli_format_plain_4mb";
+    bench.run = bench_cli_run;
+    bench.data = cli;
+    bench.bytes = (u64)text_size;
+    bench_run(harness, &bench);
+
+    BenchCli* cli_json = push_struct(arena, BenchCli);
+    *cli_json = *cli;
+    cli_json->output.format = SearchCliFormat_Json;
+    bench.name = "search_cli_format_json_4mb";
+    bench.data = cli_json;
+    bench_run(harness, &bench);
+    bench.run = bench_search_run;
+
+    // One big file on one worker, then split between all of them, which has to find the same matches
+    Arena big_arena = arena_alloc(BENCH_SEARCH_BIG_TEXT_SIZE + MEGABYTES(1));
+    u8* big_text = push_array(&big_arena, BENCH_SEARCH_BIG_TEXT_SIZE, u8);
+    size big_text_size = bench_make_search_text(big_text, BENCH_SEARCH_BIG_TEXT_SIZE);
+    SearchContext* serial_context = search_context_create(&big_arena, 0);
+    BenchSearch* big_serial = bench_make_search(&big_arena, serial_context, big_text, big_text_size);
+    bench.name = "search_memory_plain_64mb_serial";
+    bench.data = big_serial;
+    bench.bytes = (u64)big_text_size;
+    bench_run(harness, &bench);
+
+    bench.name = "search_memory_plain_64mb_split";
+    bench.data = bench_make_search(&big_arena, context, big_text, big_text_size);
+    ((BenchSearch*)bench.data)->expected_matches = big_serial->expected_matches;
+    bench_run(harness, &bench);
+
+    // The big text as files, with a needle that narrows them down as it is typed
+    QueryCorpus corpus = {0};
+    corpus.file_count = (u32)(big_text_size/BENCH_QUERY_FILE_SIZE);
+    corpus.contents = push_array(&big_arena, corpus.file_count, s8);
+    for (u32 i = 0; i < corpus.file_count; ++i)
+        corpus.contents[i] = (s8){big_text + (size)i*BENCH_QUERY_FILE_SIZE, BENCH_QUERY_FILE_SIZE};
+
+    BenchQuery* query = push_struct(arena, BenchQuery);
+    query->executor = query_executor_create(&big_arena, &corpus, queue, 0);
+    query->needle = s8("chunk 4242");
+    query->first_length = 1;
+    query->forget_first = true;
+    query->forget_each = false;
+    bench.name = "query_type_10_keystrokes";
+    bench.run = bench_query_run;
+    bench.data = query;
+    bench.bytes = (u64)corpus.file_count*BENCH_QUERY_FILE_SIZE;
+    bench_run(harness, &bench);
+
+    BenchQuery* rescan = push_struct(arena, BenchQuery);
+    *rescan = *query;
+    rescan->forget_each = true;
+    bench.name = "query_type_10_keystrokes_rescan";
+    bench.data = rescan;
+    bench_run(harness, &bench);
+
+    // Deleting the last three letters and typing them again, which the history has already seen
+    BenchQuery* retype = push_struct(arena, BenchQuery);
+    *retype = *query;
+    retype->first_length = query->needle.len - 2;
+    retype->forget_first = false;
+    bench.name = "query_retype_3_keystrokes";
+    bench.data = retype;
+    bench_run(harness, &bench);
+
+    retype = push_struct(arena, BenchQuery);
+    *retype = *rescan;
+    retype->first_length = query->needle.len - 2;
+    bench.name = "query_retype_3_keystrokes_rescan";
+    bench.data = retype;
+    bench_run(harness, &bench);
+
+    // The ring is too big for the suite's arena
+    Arena ring_arena = arena_alloc((size)sizeof(BenchRing) + (size)sizeof(DaemonRing) + KILOBYTES(4));
+    BenchRing* ring = push_struct(&ring_arena, BenchRing);
+    zero_struct(*ring);
+    ring->ring = push_struct(&ring_arena, DaemonRing);
+    daemon_ring_init(ring->ring);
+    ring->batch.count = DAEMON_RING_BATCH;
+    for (u32 i = 0; i < DAEMON_RING_BATCH; ++i)
+        ring->batch.matches[i] = (SearchMatch){(u64)i*64, i + 1, 1, i};
+    bench.name = "daemon_ring_1m_matches";
+    bench.run = bench_ring_run;
+    bench.data = ring;
+    bench.bytes = (u64)BENCH_RING_ROUNDS*DAEMON_RING_CELLS*DAEMON_RING_BATCH*sizeof(SearchMatch);
+    bench_run(harness, &bench);
+
+    BenchClassify* classify = push_struct(arena, BenchClassify);
+    classify->head = text;
+    classify->head_size = SEARCH_SNIFF_SIZE;
+    classify->kind = SearchFileKind_Text;
+    bench.name = "search_classify_text_4kb";
+    bench.run = bench_classify_run;
+    bench.data = classify;
+    bench.bytes = SEARCH_SNIFF_SIZE;
+    bench_run(harness, &bench);
+
+    BenchIgnore* ignore = push_struct(arena, BenchIgnore);
+    bench_make_ignore(ignore, arena);
+    bench.name = "ignore_match_10k_paths";
+    bench.run = bench_ignore_run;
+    bench.data = ignore;
+    bench.bytes = 0;
+    bench.items = ignore->path_count;
+    bench_run(harness, &bench);
+
+    BenchFuzzy* fuzzy = push_struct(arena, BenchFuzzy);
+    zero_struct(fuzzy->query);
+    fuzzy->finder = fuzzy_finder_create(arena, queue);
+    if (fuzzy_table_create(&fuzzy->table, BENCH_FUZZY_PATHS, 48))
+    {
+        bench_make_fuzzy_paths(&fuzzy->table, BENCH_FUZZY_PATHS);
+        fuzzy->query.text = s8("rendtex");
+        bench.name = "fuzzy_find_1m_paths";
+        bench.run = bench_fuzzy_run;
+        bench.data = fuzzy;
+        bench.items = fuzzy->table.path_count;
+        bench_run(harness, &bench);
+    }
+
+    Arena snapshot_arena = arena_alloc(MEGABYTES(64));
+    BenchSnapshot* snapshot = push_struct(&snapshot_arena, BenchSnapshot);
+    if (bench_make_snapshot(snapshot, &snapshot_arena))
+    {
+        bench.name = "snapshot_load_200k_files";
+        bench.run = bench_snapshot_run;
+        bench.data = snapshot;
+        bench.bytes = (u64)snapshot->image.len;
+        bench.items = BENCH_SNAPSHOT_DIRECTORIES*BENCH_SNAPSHOT_SUBDIRECTORIES*BENCH_SNAPSHOT_FILES;
+        bench_run(harness, &bench);
+    }
+}
@@ -0,0 +1,56 @@
+#include "bench/bench.h"
+#include "str.h"
+
+typedef struct
+{
+    Arena arena;
+    u32 format_count;
+} BenchFormat;
+
+internal void bench_format_reset(void* data)
+{
+    BenchFormat* b = (BenchFormat*)data;
+    arena_clear(&b->arena);
+}
+
+internal void bench_format_int_run(void* data)
+{
+    BenchFormat* b = (BenchFormat*)data;
+    for (u32 i = 0; i < b->format_count; ++i)
+    {
+        s8 str = s8_format(&b->arena, "Num quads: %d", (int)i);
+        (void)str;
+    }
+}
+
+internal void bench_format_float_run(void* data)
+{
+    BenchFormat* b = (BenchFormat*)data;
+    for (u32 i = 0; i < b->format_count; ++i)
+    {
+        s8 str = s8_format(&b->arena, "Frame time: %.2fms", (f32)i*0.01f);
+        (void)str;
+    }
+}
+
+internal void bench_suite_str(BenchHarness* harness, Arena* arena)
+{
+    BenchFormat* b = push_struct(arena, BenchFormat);
+    b->format_count = 1000;
+    b->arena = arena_alloc(KILOBYTES(64));
+
+    // Same shapes as the overlay strings in main.c
+    Bench bench = {0};
+    bench.suite = "str";
+    bench.reset = bench_format_reset;
+    bench.data = b;
+    bench.items = b->format_count;
+
+    bench.name = "s8_format_int";
+    bench.run = bench_format_int_run;
+    bench_run(harness, &bench);
+
+    bench.name = "s8_format_float";
+    bench.run = bench_format_float_run;
+    bench_run(harness, &bench);
+}
@@ -0,0 +1,635 @@
+#include "bench/bench.h"
+#include "inflate.h"
+#include "renderer/texture.h"
+#include "thread.h"
+
+#include <string.h> // memcpy
+
+typedef struct
+{
+    u8* original;
+    u8* data;
+    size data_size;
+} BenchBmp;
+
+internal void bench_bmp_reset(void* data)
+{
+    // The decoder swizzles in place, so every repetition starts from a fresh copy
+    BenchBmp* b = (BenchBmp*)data;
+    memcpy(b->data, b->original, (usize)b->data_size);
+}
+
+internal void bench_bmp_run(void* data)
+{
+    BenchBmp* b = (BenchBmp*)data;
+    Texture tex = load_bmp_from_memory(b->data, b->data_size);
+    (void)tex;
+}
+
+// Builds a 32-bit BMP in memory. compression is 0 (BI_RGB) or 3 (BI_BITFIELDS, the format the icons use).
+internal BenchBmp* bench_make_bmp(Arena* arena, i32 width, i32 height, u32 compression)
+{
+    BenchBmp* b = push_struct(arena, BenchBmp);
+    u32 pixel_bytes = (u32)(width*height*4);
+    b->data_size = sizeof(BitmapHeader) + pixel_bytes;
+    b->original = push_array(arena, b->data_size, u8);
+    b->data = push_array(arena, b->data_size, u8);
+
+    BitmapHeader* header = (BitmapHeader*)b->original;
+    zero_struct(*header);
+    header->file_type = 0x4D42;
+    header->file_size = (u32)b->data_size;
+    header->pixel_array_offset = sizeof(BitmapHeader);
+    header->size = sizeof(BitmapHeader) - 14;
+    header->width = width;
+    header->height = height;
+    header->planes = 1;
+    header->bits_per_pixel = 32;
+    header->compression = compression;
+    header->bitmap_size = pixel_bytes;
+    header->red_mask = 0x00FF0000;
+    header->green_mask = 0x0000FF00;
+    header->blue_mask = 0x000000FF;
+
+    u32* pixels = (u32*)(b->original + header->pixel_array_offset);
+    u32 seed = 0x12345678;
+    for (i32 i = 0; i < width*height; ++i)
+    {
+        seed = seed*1664525 + 1013904223;
+        pixels[i] = seed;
+    }
+
+    return b;
+}
+
+// Procedural icon-like image: smooth gradients with some noise, so it compresses about as well as real art
+internal u8* bench_make_image(Arena* arena, i32 width, i32 height)
+{
+    u8* pixels = push_array(arena, width*height*4, u8);
+    u32 seed = 0x9E3779B9;
+    for (i32 y = 0; y < height; ++y)
+    {
+        for (i32 x = 0; x < width; ++x)
+        {
+            seed = seed*1664525 + 1013904223;
+            u8* p = pixels + (y*width + x)*4;
+            p[0] = (u8)(x + (seed >> 29));
+            p[1] = (u8)(y + (seed >> 30));
+            p[2] = (u8)((x + y) >> 1);
+            p[3] = (u8)(((x ^ y) & 16) ? 255 : 128 + (x & 127));
+        }
+    }
+    return pixels;
+}
+
+internal size bench_encode_qoi(u8* pixels, i32 width, i32 height, u8* out)
+{
+    u8* start = out;
+    u8 header[14] = {'q', 'o', 'i', 'f'};
+    for (i32 i = 0; i < 4; ++i)
+    {
+        header[4 + i] = (u8)((u32)width >> (24 - 8*i));
+        header[8 + i] = (u8)((u32)height >> (24 - 8*i));
+    }
+    header[12] = 4;
+    header[13] = 0;
+    memcpy(out, header, sizeof(header));
+    out += sizeof(header);
+
+    u32 index[64] = {0};
+    u8 prev[4] = {0, 0, 0, 255};
+    u32 run = 0;
+    i32 count = width*height;
+    for (i32 i = 0; i < count; ++i)
+    {
+        u8* p = pixels + i*4;
+        if (memcmp(p, prev, 4) == 0)
+        {
+            if (++run == 62 || i == count - 1)
+            {
+                *out++ = (u8)(0xC0 | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run)
+        {
+            *out++ = (u8)(0xC0 | (run - 1));
+            run = 0;
+        }
+
+        u32 value;
+        memcpy(&value, p, 4);
+        u32 hash = ((u32)p[0]*3 + (u32)p[1]*5 + (u32)p[2]*7 + (u32)p[3]*11) & 63;
+        if (index[hash] == value)
+        {
+            *out++ = (u8)hash;
+        }
+        else
+        {
+            index[hash] = value;
+            i32 dr = (i8)(p[0] - prev[0]);
+            i32 dg = (i8)(p[1] - prev[1]);
+            i32 db = (i8)(p[2] - prev[2]);
+            if (p[3] != prev[3])
+            {
+                *out++ = 0xFF;
+                memcpy(out, p, 4);
+                out += 4;
+            }
+            else if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+            {
+                *out++ = (u8)(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+            }
+            else if (dg >= -32 && dg <= 31 && dr - dg >= -8 && dr - dg <= 7 && db - dg >= -8 && db - dg <= 7)
+            {
+                *out++ = (u8)(0x80 | (dg + 32));
+                *out++ = (u8)(((dr - dg + 8) << 4) | (db - dg + 8));
+            }
+            else
+            {
+                *out++ = 0xFE;
+                memcpy(out, p, 3);
+                out += 3;
+            }
+        }
+        memcpy(prev, p, 4);
+    }
+
+    memset(out, 0, 7);
+    out[7] = 1;
+    out += 8;
+    return out - start;
+}
+
+typedef struct
+{
+    u8* out;
+    u64 bits;
+    u32 bit_count;
+} BenchBitWriter;
+
+internal void bench_put_bits(BenchBitWriter* w, u32 value, u32 count)
+{
+    w->bits |= (u64)value << w->bit_count;
+    w->bit_count += count;
+    while (w->bit_count >= 8)
+    {
+        *w->out++ = (u8)w->bits;
+        w->bits >>= 8;
+        w->bit_count -= 8;
+    }
+}
+
+// Huffman codes are sent most significant bit first
+internal void bench_put_code(BenchBitWriter* w, u32 code, u32 length)
+{
+    bench_put_bits(w, inflate_bit_reverse(code, length), length);
+}
+
+internal void bench_put_literal(BenchBitWriter* w, u32 symbol)
+{
+    if (symbol < 144)      bench_put_code(w, 0x30 + symbol, 8);
+    else if (symbol < 256) bench_put_code(w, 0x190 + symbol - 144, 9);
+    else if (symbol < 280) bench_put_code(w, symbol - 256, 7);
+    else                   bench_put_code(w, 0xC0 + symbol - 280, 8);
+}
+
+// NOTE(lucas): Minimal zlib encoder for bench data: greedy LZ77 over a hash of the next three bytes, written as a
+// single fixed Huffman block. It compresses worse than zlib, but exercises the same decode paths.
+internal size bench_deflate_fixed(u8* in, size in_size, u8* out, Arena* scratch)
+{
+    BenchBitWriter w = {out + 2, 0, 0};
+    out[0] = 0x78;
+    out[1] = 0x01;
+
+    size table_size = 1 << 15;
+    i32* head = push_array(scratch, table_size, i32);
+    for (size i = 0; i < table_size; ++i)
+        head[i] = -1;
+
+    bench_put_bits(&w, 1, 1); // Final block
+    bench_put_bits(&w, 1, 2); // Fixed Huffman
+
+    size pos = 0;
+    while (pos < in_size)
+    {
+        size best_length = 0;
+        size best_dist = 0;
+        if (pos + 3 <= in_size)
+        {
+            u32 hash = (((u32)in[pos] << 16) | ((u32)in[pos+1] << 8) | in[pos+2])*2654435761u >> 17;
+            i32 candidate = head[hash];
+            head[hash] = (i32)pos;
+            if (candidate >= 0 && pos - candidate <= 32768)
+            {
+                size length = 0;
+                while (length < INFLATE_MAX_MATCH && pos + length < in_size && in[candidate + length] == in[pos + length])
+                    ++length;
+                if (length >= 3)
+                {
+                    best_length = length;
+                    best_dist = pos - candidate;
+                }
+            }
+        }
+
+        if (!best_length)
+        {
+            bench_put_literal(&w, in[pos++]);
+            continue;
+        }
+
+        u32 length_code = 28;
+        while (inflate_length_base[length_code] > best_length)
+            --length_code;
+        bench_put_literal(&w, 257 + length_code);
+        bench_put_bits(&w, (u32)(best_length - inflate_length_base[length_code]), inflate_length_extra[length_code]);
+
+        u32 dist_code = 29;
+        while (inflate_dist_base[dist_code] > best_dist)
+            --dist_code;
+        bench_put_code(&w, dist_code, 5);
+        bench_put_bits(&w, (u32)(best_dist - inflate_dist_base[dist_code]), inflate_dist_extra[dist_code]);
+
+        pos += best_length;
+    }
+
+    bench_put_literal(&w, 256);
+    bench_put_bits(&w, 0, (8 - w.bit_count) & 7); // Pad to a whole byte
+
+    // Adler-32, most significant byte first
+    u32 adler = inflate_adler32(1, in, in_size);
+    for (i32 i = 3; i >= 0; --i)
+        bench_put_bits(&w, (adler >> (8*i)) & 0xFF, 8);
+
+    arena_pop(scratch, table_size*(size)sizeof(i32));
+    return w.out - out;
+}
+
+internal void bench_png_chunk(u8** out, const char* type, u8* data, u32 length)
+{
+    u8* p = *out;
+    for (i32 i = 0; i < 4; ++i)
+        p[i] = (u8)(length >> (24 - 8*i));
+    memcpy(p + 4, type, 4);
+    if (length && data != p + 8)
+        memcpy(p + 8, data, length);
+    memset(p + 8 + length, 0, 4); // CRC, which the decoder does not check
+    *out = p + 12 + length;
+}
+
+// Encodes RGBA8 or RGB8 as a PNG, cycling through all five filters row by row
+internal size bench_encode_png(u8* pixels, i32 width, i32 height, u32 channels, u8* out, Arena* scratch)
+{
+    size row_bytes = (size)width*channels;
+    size filtered_size = (row_bytes + 1)*height;
+    u8* filtered = push_array(scratch, filtered_size, u8);
+    u8* rows = push_array(scratch, row_bytes*height, u8);
+
+    for (i32 i = 0; i < width*height; ++i)
+        memcpy(rows + i*channels, pixels + i*4, channels);
+
+    for (i32 y = 0; y < height; ++y)
+    {
+        u8* row = rows + row_bytes*y;
+        u8* prior = y ? row - row_bytes : 0;
+        u8 filter = (u8)(y % 5);
+        u8* dest = filtered + (row_bytes + 1)*y;
+        dest[0] = filter;
+        for (size i = 0; i < row_bytes; ++i)
+        {
+            i32 a = (i >= channels) ? row[i - channels] : 0;
+            i32 b = prior ? prior[i] : 0;
+            i32 c = (prior && i >= channels) ? prior[i - channels] : 0;
+            i32 predictor = 0;
+            switch (filter)
+            {
+                case 1: predictor = a; break;
+                case 2: predictor = b; break;
+                case 3: predictor = (a + b) >> 1; break;
+                case 4: predictor = png_paeth(a, b, c); break;
+            }
+            dest[i + 1] = (u8)(row[i] - predictor);
+        }
+    }
+
+    u8* p = out;
+    memcpy(p, png_signature, PNG_SIGNATURE_SIZE);
+    p += PNG_SIGNATURE_SIZE;
+
+    u8 header[13] = {0};
+    for (i32 i = 0; i < 4; ++i)
+    {
+        header[i] = (u8)((u32)width >> (24 - 8*i));
+        header[4 + i] = (u8)((u32)height >> (24 - 8*i));
+    }
+    header[8] = 8;
+    header[9] = (channels == 4) ? PngColor_RGBA : PngColor_RGB;
+    bench_png_chunk(&p, "IHDR", header, sizeof(header));
+
+    // Past the chunk header, so the compressed data is written in place
+    size idat_size = bench_deflate_fixed(filtered, filtered_size, p + 8, scratch);
+    bench_png_chunk(&p, "IDAT", p + 8, (u32)idat_size);
+    bench_png_chunk(&p, "IEND", 0, 0);
+
+    arena_pop(scratch, filtered_size + row_bytes*height);
+    return p - out;
+}
+
+typedef struct
+{
+    u8* data;
+    size data_size;
+    Arena arena;
+    Texture texture;
+} BenchDecode;
+
+internal void bench_decode_reset(void* data)
+{
+    BenchDecode* b = (BenchDecode*)data;
+    arena_clear(&b->arena);
+}
+
+internal void bench_decode_run(void* data)
+{
+    BenchDecode* b = (BenchDecode*)data;
+    b->texture = texture_decode_from_memory(b->data, b->data_size, &b->arena);
+    ASSERT(b->texture.data, "Bench image failed to decode");
+}
+
+typedef struct
+{
+    Texture source;
+    Texture encoded;
+    Texture result;
+    TextureFormat format;
+    WorkQueue* queue;
+    Arena arena;
+} BenchBc;
+
+internal void bench_bc_reset(void* data)
+{
+    BenchBc* b = (BenchBc*)data;
+    arena_clear(&b->arena);
+}
+
+internal void bench_bc_encode_run(void* data)
+{
+    BenchBc* b = (BenchBc*)data;
+    b->result = texture_encode_bc(&b->source, b->format, &b->arena, b->queue);
+    ASSERT(b->result.data, "Bench image failed to encode");
+}
+
+internal void bench_bc_decode_run(void* data)
+{
+    BenchBc* b = (BenchBc*)data;
+    b->result = texture_decode_bc(&b->encoded, &b->arena);
+    ASSERT(b->result.data, "Bench image failed to decode");
+}
+
+typedef struct
+{
+    u8* pixels;
+    i32 dim;
+    Arena arena;
+    Texture texture;
+} BenchMips;
+
+// Puts the base level on top of the arena, so the chain is built in place as it is after a load
+internal void bench_mips_reset(void* data)
+{
+    BenchMips* b = (BenchMips*)data;
+    arena_clear(&b->arena);
+    zero_struct(b->texture);
+    b->texture.width = b->dim;
+    b->texture.height = b->dim;
+    b->texture.channels = 4;
+    b->texture.data = push_array(&b->arena, (size)b->dim*b->dim*4, u8);
+    memcpy(b->texture.data, b->pixels, (usize)b->dim*b->dim*4);
+}
+
+internal void bench_mips_run(void* data)
+{
+    BenchMips* b = (BenchMips*)data;
+    b->texture = texture_generate_mips(&b->texture, &b->arena);
+    ASSERT(b->texture.mip_count > 1, "Bench mips were not generated");
+}
+
+typedef struct
+{
+    Texture source;
+    i32 width;
+    i32 height;
+    Arena arena;
+} BenchDownsample;
+
+internal void bench_downsample_reset(void* data)
+{
+    BenchDownsample* b = (BenchDownsample*)data;
+    arena_clear(&b->arena);
+}
+
+internal void bench_downsample_run(void* data)
+{
+    BenchDownsample* b = (BenchDownsample*)data;
+    Texture result = texture_downsample(&b->source, b->width, b->height, &b->arena);
+    ASSERT(result.data, "Bench downsample failed");
+    (void)result;
+}
+
+#define BENCH_PARALLEL_IMAGES 16
+
+typedef struct
+{
+    WorkQueue* queue;
+    BenchDecode decodes[BENCH_PARALLEL_IMAGES];
+} BenchParallelDecode;
+
+internal void bench_parallel_decode_reset(void* data)
+{
+    BenchParallelDecode* b = (BenchParallelDecode*)data;
+    for (u32 i = 0; i < BENCH_PARALLEL_IMAGES; ++i)
+        bench_decode_reset(&b->decodes[i]);
+}
+
+internal void bench_parallel_decode_run(void* data)
+{
+    BenchParallelDecode* b = (BenchParallelDecode*)data;
+    for (u32 i = 0; i < BENCH_PARALLEL_IMAGES; ++i)
+        work_queue_add(b->queue, bench_decode_run, &b->decodes[i]);
+    work_queue_complete_all(b->queue);
+}
+
+internal void bench_serial_decode_run(void* data)
+{
+    BenchParallelDecode* b = (BenchParallelDecode*)data;
+    for (u32 i = 0; i < BENCH_PARALLEL_IMAGES; ++i)
+        bench_decode_run(&b->decodes[i]);
+}
+
+internal void bench_suite_texture(BenchHarness* harness, Arena* arena)
+{
+    i32 dim = 256;
+
+    Bench bench = {0};
+    bench.suite = "texture";
+    bench.run = bench_bmp_run;
+    bench.reset = bench_bmp_reset;
+    bench.items = (u64)(dim*dim);
+
+    BenchBmp* rgb = bench_make_bmp(arena, dim, dim, 0);
+    bench.name = "load_bmp_from_memory_rgb_256";
+    bench.data = rgb;
+    bench.bytes = (u64)rgb->data_size;
+    bench_run(harness, &bench);
+
+    BenchBmp* bitfields = bench_make_bmp(arena, dim, dim, 3);
+    bench.name = "load_bmp_from_memory_bitfields_256";
+    bench.data = bitfields;
+    bench.bytes = (u64)bitfields->data_size;
+    bench_run(harness, &bench);
+
+    // Compressed formats, reported against the compressed size
+    u8* image = bench_make_image(arena, dim, dim);
+    size max_encoded = (size)dim*dim*5 + KILOBYTES(4);
+    size decoded_size = (size)dim*dim*4;
+
+    BenchDecode* qoi = push_struct(arena, BenchDecode);
+    qoi->data = push_array(arena, max_encoded, u8);
+    qoi->data_size = bench_encode_qoi(image, dim, dim, qoi->data);
+    qoi->arena = arena_alloc(decoded_size + KILOBYTES(4));
+    bench.name = "load_qoi_from_memory_256";
+    bench.run = bench_decode_run;
+    bench.reset = bench_decode_reset;
+    bench.data = qoi;
+    bench.bytes = (u64)qoi->data_size;
+    bench_run(harness, &bench);
+
+    // The decoder needs room for the pixels, the filtered rows and the inflater on top of the pixels
+    size png_arena_size = decoded_size*2 + (size)dim + sizeof(Inflater) + KILOBYTES(4);
+    u32 png_channels[] = {4, 3};
+    const char* png_names[] = {"load_png_from_memory_rgba_256", "load_png_from_memory_rgb_256"};
+    for (u32 i = 0; i < countof(png_channels); ++i)
+    {
+        BenchDecode* png = push_struct(arena, BenchDecode);
+        png->data = push_array(arena, max_encoded, u8);
+        png->data_size = bench_encode_png(image, dim, dim, png_channels[i], png->data, arena);
+        png->arena = arena_alloc(png_arena_size);
+        bench.name = png_names[i];
+        bench.data = png;
+        bench.bytes = (u64)png->data_size;
+        bench_run(harness, &bench);
+    }
+
+    u32 processor_count = thread_get_processor_count();
+    WorkQueue* queue = work_queue_create(arena, processor_count > 1 ? processor_count - 1 : 1);
+
+    // Block compression, as grapple_bake runs it and as the null renderer decodes it
+    Texture source = {0};
+    source.data = image;
+    source.width = dim;
+    source.height = dim;
+    source.channels = 4;
+    bench.items = (u64)(dim*dim);
+    bench.bytes = (u64)decoded_size;
+    bench.reset = bench_bc_reset;
+    TextureFormat bc_formats[] = {TextureFormat_BC1, TextureFormat_BC3, TextureFormat_BC7};
+    const char* bc_encode_names[][2] = {
+        {"texture_encode_bc1_256_serial", "texture_encode_bc1_256_parallel"},
+        {"texture_encode_bc3_256_serial", "texture_encode_bc3_256_parallel"},
+        {"texture_encode_bc7_256_serial", "texture_encode_bc7_256_parallel"},
+    };
+    const char* bc_decode_names[] = {"texture_decode_bc1_256", "texture_decode_bc3_256", "texture_decode_bc7_256"};
+    for (u32 i = 0; i < countof(bc_formats); ++i)
+    {
+        BenchBc* bc = push_struct(arena, BenchBc);
+        zero_struct(*bc);
+        bc->source = source;
+        bc->format = bc_formats[i];
+        bc->arena = arena_alloc(decoded_size + KILOBYTES(4));
+        bc->encoded = texture_encode_bc(&source, bc_formats[i], arena, 0);
+        bench.data = bc;
+
+        bench.run = bench_bc_encode_run;
+        bench.name = bc_encode_names[i][0];
+        bench_run(harness, &bench);
+        bc->queue = queue;
+        bench.name = bc_encode_names[i][1];
+        bench_run(harness, &bench);
+
+        bench.run = bench_bc_decode_run;
+        bench.name = bc_decode_names[i];
+        bench_run(harness, &bench);
+    }
+
+    // Mip chains, reported against the base level
+    i32 mip_dims[] = {256, 1024};
+    const char* mip_names[] = {"texture_generate_mips_256", "texture_generate_mips_1024"};
+    for (u32 i = 0; i < countof(mip_dims); ++i)
+    {
+        BenchMips* mips = push_struct(arena, BenchMips);
+        zero_struct(*mips);
+        mips->dim = mip_dims[i];
+        mips->pixels = (mips->dim == dim) ? image : bench_make_image(arena, mips->dim, mips->dim);
+        mips->arena = arena_alloc((size)mips->dim*mips->dim*8 + KILOBYTES(4));
+        bench.name = mip_names[i];
+        bench.run = bench_mips_run;
+        bench.reset = bench_mips_reset;
+        bench.data = mips;
+        bench.items = (u64)mips->dim*mips->dim;
+        bench.bytes = (u64)mips->dim*mips->dim*4;
+        bench_run(harness, &bench);
+    }
+
+    // Thumbnails, reported against the source. 1000 doesn't divide evenly, so output pixels cover fractions of rows.
+    i32 downsample_dims[][2] = {{1024, 128}, {1000, 256}};
+    const char* downsample_names[] = {"texture_downsample_1024_to_128", "texture_downsample_1000_to_256"};
+    for (u32 i = 0; i < countof(downsample_dims); ++i)
+    {
+        i32 source_dim = downsample_dims[i][0];
+        i32 target_dim = downsample_dims[i][1];
+        BenchDownsample* downsample = push_struct(arena, BenchDownsample);
+        zero_struct(*downsample);
+        downsample->source.data = bench_make_image(arena, source_dim, source_dim);
+        downsample->source.width = source_dim;
+        downsample->source.height = source_dim;
+        downsample->source.channels = 4;
+        downsample->width = target_dim;
+        downsample->height = target_dim;
+        downsample->arena = arena_alloc((size)target_dim*(target_dim + 2)*12 + KILOBYTES(64));
+        bench.name = downsample_names[i];
+        bench.run = bench_downsample_run;
+        bench.reset = bench_downsample_reset;
+        bench.data = downsample;
+        bench.items = (u64)source_dim*source_dim;
+        bench.bytes = (u64)source_dim*source_dim*4;
+        bench_run(harness, &bench);
+    }
+
+    // Many icons at once, the case texture_load_from_files is for
+    i32 icon_dim = 64;
+    u8* icon = bench_make_image(arena, icon_dim, icon_dim);
+    BenchParallelDecode* icons = push_struct(arena, BenchParallelDecode);
+    icons->queue = queue;
+    u64 total_bytes = 0;
+    for (u32 i = 0; i < BENCH_PARALLEL_IMAGES; ++i)
+    {
+        BenchDecode* decode = &icons->decodes[i];
+        decode->data = push_array(arena, (size)icon_dim*icon_dim*5 + KILOBYTES(4), u8);
+        decode->data_size = bench_encode_png(icon, icon_dim, icon_dim, 4, decode->data, arena);
+        decode->arena = arena_alloc((size)icon_dim*icon_dim*8 + icon_dim + sizeof(Inflater) + KILOBYTES(4));
+        total_bytes += (u64)decode->data_size;
+    }
+
+    bench.reset = bench_parallel_decode_reset;
+    bench.data = icons;
+    bench.bytes = total_bytes;
+    bench.items = (u64)BENCH_PARALLEL_IMAGES*icon_dim*icon_dim;
+    bench.name = "load_png_16x64_serial";
+    bench.run = bench_serial_decode_run;
+    bench_run(harness, &bench);
+    bench.name = "load_png_16x64_parallel";
+    bench.run = bench_parallel_decode_run;
+    bench_run(harness, &bench);
+}
@@ -0,0 +1,252 @@
+#include "channel.h"
+#include "atomic.h"
+#include "profiler.h"
+#include "timer.h"
+
+internal void channel_ring_init(ChannelRing* ring, ChannelCell* cells, u32 capacity)
+{
+    ring->cells = cells;
+    ring->mask = capacity - 1;
+    ring->write = 0;
+    ring->read = 0;
+    for (u32 i = 0; i < capacity; ++i)
+    {
+        cells[i].sequence = i;
+        cells[i].batch = 0;
+    }
+}
+
+// Single producer and single consumer, so each index only has one writer
+internal void channel_ring_push_single(ChannelRing* ring, ChannelBatch* batch)
+{
+    u32 write = ring->write;
+    ASSERT(write - atomic_load_u32(&ring->read) <= ring->mask, "Channel ring overflowed");
+    ring->cells[write & ring->mask].batch = batch;
+    atomic_store_u32(&ring->write, write + 1);
+}
+
+internal ChannelBatch* channel_ring_pop_single(ChannelRing* ring)
+{
+    ChannelBatch* result = 0;
+    u32 read = ring->read;
+    if (read != atomic_load_u32(&ring->write))
+    {
+        result = ring->cells[read & ring->mask].batch;
+        atomic_store_u32(&ring->read, read + 1);
+    }
+    return result;
+}
+
+/*
+ * NOTE(lucas): Vyukov's bounded MPMC queue. A cell's sequence equals the write position that may fill it next, and
+ * becomes position + 1 once it is filled, which is the read position that may empty it. Emptying sets it to
+ * position + capacity, the write position of the next lap. Threads claim a position by compare-exchanging the
+ * shared index, then own that cell until they publish the new sequence.
+ */
+internal void channel_ring_push_multi(ChannelRing* ring, ChannelBatch* batch)
+{
+    ChannelCell* cell = 0;
+    u32 position = atomic_load_u32(&ring->write);
+    for (;;)
+    {
+        cell = &ring->cells[position & ring->mask];
+        i32 difference = (i32)(atomic_load_u32(&cell->sequence) - position);
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_u32(&ring->write, position, position + 1))
+                break;
+        }
+        ASSERT(difference >= 0, "Channel ring overflowed");
+        position = atomic_load_u32(&ring->write);
+    }
+
+    cell->batch = batch;
+    atomic_store_u32(&cell->sequence, position + 1);
+}
+
+internal ChannelBatch* channel_ring_pop_multi(ChannelRing* ring)
+{
+    ChannelCell* cell = 0;
+    u32 position = atomic_load_u32(&ring->read);
+    for (;;)
+    {
+        cell = &ring->cells[position & ring->mask];
+        i32 difference = (i32)(atomic_load_u32(&cell->sequence) - (position + 1));
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_u32(&ring->read, position, position + 1))
+                break;
+        }
+        else if (difference < 0)
+        {
+            return 0; // Empty
+        }
+        position = atomic_load_u32(&ring->read);
+    }
+
+    ChannelBatch* result = cell->batch;
+    atomic_store_u32(&cell->sequence, position + ring->mask + 1);
+    return result;
+}
+
+Channel* channel_create(Arena* arena, b32 multi_producer, u32 batch_count, u32 batch_capacity, size item_size)
+{
+    ASSERT(batch_count > 0 && batch_capacity > 0 && item_size > 0, "Channel needs batches to carry items");
+
+    u32 ring_capacity = 1;
+    while (ring_capacity < batch_count)
+        ring_capacity *= 2;
+
+    arena_align(arena, CHANNEL_CACHE_LINE);
+    Channel* channel = push_struct(arena, Channel);
+    ChannelCell* full_cells = push_array(arena, ring_capacity, ChannelCell);
+    ChannelCell* free_cells = push_array(arena, ring_capacity, ChannelCell);
+    ChannelBatch* batches = push_array(arena, batch_count, ChannelBatch);
+    if (!channel || !full_cells || !free_cells || !batches)
+        return 0;
+
+    zero_struct(*channel);
+    channel->multi_producer = multi_producer;
+    channel->batch_count = batch_count;
+    channel_ring_init(&channel->full, full_cells, ring_capacity);
+    channel_ring_init(&channel->free, free_cells, ring_capacity);
+
+    arena_align(arena, CHANNEL_CACHE_LINE);
+    for (u32 i = 0; i < batch_count; ++i)
+    {
+        ChannelBatch* batch = &batches[i];
+        zero_struct(*batch);
+        batch->capacity = batch_capacity;
+        batch->item_size = item_size;
+        batch->items = push_array(arena, (size)batch_capacity*item_size, u8);
+        if (!batch->items)
+            return 0;
+
+        // Filled at position i, as far as either kind of ring is concerned
+        channel->free.cells[i].batch = batch;
+        channel->free.cells[i].sequence = i + 1;
+    }
+    channel->free.write = batch_count;
+    channel->free_count = semaphore_create(arena, batch_count);
+
+    return channel;
+}
+
+ChannelBatch* channel_acquire(Channel* channel, CancelToken* token)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ChannelBatch* result = 0;
+    if (!cancel_token_is_cancelled(token))
+    {
+        // NOTE(lucas): The semaphore counts free batches, plus a wake-up for each producer that was waiting when
+        // channel_cancel ran. A wait that pops nothing was one of those, and waits again unless its own token is the
+        // one cancelled. Counting itself as waiting before checking the token means a cancel either sees it or is
+        // seen by it.
+        for (;;)
+        {
+            atomic_add_u32(&channel->waiting, 1);
+            b32 cancelled = cancel_token_is_cancelled(token);
+            if (!cancelled)
+                semaphore_wait(channel->free_count);
+            atomic_add_u32(&channel->waiting, (u32)-1);
+            if (cancelled)
+                break;
+
+            if (channel->multi_producer)
+                result = channel_ring_pop_multi(&channel->free);
+            else
+                result = channel_ring_pop_single(&channel->free);
+            if (result || cancel_token_is_cancelled(token))
+                break;
+        }
+
+        if (result)
+        {
+            result->token = token;
+            result->count = 0;
+
+            // Cancelled while waiting. The consumer drops the batch and frees it for the next waiter.
+            if (cancel_token_is_cancelled(token))
+            {
+                channel_publish(channel, result);
+                result = 0;
+            }
+        }
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+// NOTE(lucas): Only the consumer pushes onto the free ring, which keeps it single-producer in both kinds of channel.
+// Producers that are done with a batch, even an empty one, always publish it.
+void channel_publish(Channel* channel, ChannelBatch* batch)
+{
+    atomic_add_u64(&channel->items_published, batch->count);
+    if (channel->multi_producer)
+        channel_ring_push_multi(&channel->full, batch);
+    else
+        channel_ring_push_single(&channel->full, batch);
+
+    if (channel->wake)
+        channel->wake(channel->wake_data);
+}
+
+void channel_cancel(Channel* channel, CancelToken* token)
+{
+    // The compare-exchange is a full barrier, so the load of waiting can't move ahead of the cancel
+    atomic_compare_exchange_u32(&token->cancelled, 0, 1);
+    u32 waiting = atomic_load_u32(&channel->waiting);
+    for (u32 i = 0; i < waiting; ++i)
+        semaphore_signal(channel->free_count);
+}
+
+ChannelBatch* channel_pop(Channel* channel)
+{
+    ChannelBatch* result = 0;
+    if (channel->multi_producer)
+        result = channel_ring_pop_multi(&channel->full);
+    else
+        result = channel_ring_pop_single(&channel->full);
+    return result;
+}
+
+void channel_release(Channel* channel, ChannelBatch* batch)
+{
+    if (channel->multi_producer)
+        channel_ring_push_multi(&channel->free, batch);
+    else
+        channel_ring_push_single(&channel->free, batch);
+    semaphore_signal(channel->free_count);
+}
+
+u64 channel_drain(Channel* channel, ChannelConsumeCallback* consume, void* data, u64 deadline_ticks)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    u64 result = 0;
+    for (;;)
+    {
+        ChannelBatch* batch = channel_pop(channel);
+        if (!batch)
+            break;
+
+        if (cancel_token_is_cancelled(batch->token))
+        {
+            atomic_add_u64(&channel->items_dropped, batch->count);
+        }
+        else if (batch->count)
+        {
+            consume(batch, data);
+            result += batch->count;
+        }
+        channel_release(channel, batch);
+
+        if (deadline_ticks && timer_get_os_ticks() >= deadline_ticks)
+            break;
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
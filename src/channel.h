@@ -0,0 +1,117 @@
+#pragma once
+
+#include "atomic.h"
+#include "grapple_memory.h"
+#include "thread.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Channels carry results from worker threads to the UI thread in batches. All batches are allocated
+ * when the channel is created and circulate between two bounded lock-free rings: producers take an empty batch
+ * from the free ring, fill it and publish it to the full ring, and the consumer drains the full ring and hands
+ * batches back. Because every batch is always in exactly one place, neither ring can overflow.
+ *
+ * Backpressure falls out of the fixed batch count. When the consumer falls behind, producers run out of free
+ * batches and sleep on a semaphore until one comes back, instead of piling up memory. Cancelling their work with
+ * channel_cancel wakes them too, in case the consumer has stopped draining.
+ *
+ * A single-producer channel uses plain ring indices. A multi-producer channel uses Vyukov's bounded queue, where
+ * each cell has a sequence number, so producers can claim cells with one compare-exchange and never block each
+ * other. The consumer is always a single thread.
+ */
+
+// Ring indices are written by different threads, so they get their own cache lines
+#define CHANNEL_CACHE_LINE 64
+
+// Set by whoever started the work to tell its producers to stop. Batches are tagged with the token they were
+// filled under, so batches published after the cancel are dropped instead of shown.
+typedef struct
+{
+    volatile u32 cancelled;
+} CancelToken;
+
+internal inline void cancel_token_cancel(CancelToken* token)
+{
+    atomic_store_u32(&token->cancelled, 1);
+}
+
+internal inline b32 cancel_token_is_cancelled(CancelToken* token)
+{
+    return token && atomic_load_u32(&token->cancelled);
+}
+
+typedef struct
+{
+    CancelToken* token; // The token it was acquired with, which may be 0
+    u32 count;
+    u32 capacity;
+    size item_size;
+    u8* items;
+} ChannelBatch;
+
+typedef struct
+{
+    volatile u32 sequence; // Only used by multi-producer rings
+    ChannelBatch* batch;
+} ChannelCell;
+
+typedef struct
+{
+    ChannelCell* cells;
+    u32 mask;
+    u8 pad0[CHANNEL_CACHE_LINE];
+    volatile u32 write;
+    u8 pad1[CHANNEL_CACHE_LINE - sizeof(u32)];
+    volatile u32 read;
+    u8 pad2[CHANNEL_CACHE_LINE - sizeof(u32)];
+} ChannelRing;
+
+typedef void ChannelWakeCallback(void* data);
+typedef void ChannelConsumeCallback(ChannelBatch* batch, void* data);
+
+typedef struct
+{
+    ChannelRing full; // Producers to the consumer
+    ChannelRing free; // The consumer back to producers
+    Semaphore* free_count;
+    volatile u32 waiting; // Producers asleep on free_count, for channel_cancel to wake
+    b32 multi_producer;
+    u32 batch_count;
+
+    // Optional. Called after each publish so a UI that is waiting for input wakes up to drain the channel.
+    ChannelWakeCallback* wake;
+    void* wake_data;
+
+    volatile u64 items_published;
+    volatile u64 items_dropped; // Published under a token that was cancelled by the time they were drained
+} Channel;
+
+// batch_capacity is in items of item_size bytes
+Channel* channel_create(Arena* arena, b32 multi_producer, u32 batch_count, u32 batch_capacity, size item_size);
+
+// Producers. Acquire blocks while every batch is in use, and returns 0 once token is cancelled. Every acquired
+// batch must be published, even if it is empty, since that is how it gets back to the free ring.
+ChannelBatch* channel_acquire(Channel* channel, CancelToken* token);
+void channel_publish(Channel* channel, ChannelBatch* batch);
+
+// Cancels token and wakes the producers waiting for a free batch, so they return 0 instead of waiting for a consumer
+// that may have stopped draining. Cancelling the token on its own only stops them at their next acquire.
+void channel_cancel(Channel* channel, CancelToken* token);
+
+// Returns the next free item in the batch, or 0 when it is full and should be published
+internal inline void* channel_batch_push(ChannelBatch* batch)
+{
+    void* result = 0;
+    if (batch->count < batch->capacity)
+        result = batch->items + (size)batch->count++*batch->item_size;
+    return result;
+}
+
+// Consumer. Pop returns 0 when nothing is waiting, and every popped batch must be released.
+ChannelBatch* channel_pop(Channel* channel);
+void channel_release(Channel* channel, ChannelBatch* batch);
+
+// Hands waiting batches to consume until the channel is empty or the OS timer passes deadline_ticks, so a frame
+// only spends its budget on results and the rest wait for the next frame. A deadline of 0 drains everything.
+// Batches from cancelled work are released without being consumed. Returns the number of items consumed.
+u64 channel_drain(Channel* channel, ChannelConsumeCallback* consume, void* data, u64 deadline_ticks);
@@ -0,0 +1,350 @@
+#pragma once
+
+#include "grapple_memory.h"
+#include "types.h"
+
+#include <string.h> // memcpy, memset
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define HASH_GROUP_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+internal inline u32 count_trailing_zeros_u32(u32 value)
+{
+    ASSERT(value, "count_trailing_zeros_u32 is undefined for 0");
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return (u32)index;
+#else
+    return (u32)__builtin_ctz(value);
+#endif
+}
+
+//
+// NOTE(lucas): Growable arrays
+//
+// Declare the type with ARRAY_TYPE, zero-initialize it, and push onto it with an arena. When the array is the
+// last thing pushed onto its arena it grows in place. Otherwise it moves to a new allocation twice the size and
+// the old one stays in the arena until the arena is cleared.
+//
+
+#define ARRAY_TYPE(name, type) typedef struct {type* data; size count; size capacity;} name
+
+// Makes room for at least min_capacity items. Returns false if the arena is out of space.
+internal b32 array_grow_(Arena* arena, void** data, size* capacity, size count, size item_size, size min_capacity)
+{
+    if (*capacity >= min_capacity)
+        return true;
+
+    size new_capacity = *capacity ? *capacity*2 : 16;
+    if (new_capacity < min_capacity)
+        new_capacity = min_capacity;
+
+    u8* old_end = (u8*)*data + *capacity*item_size;
+    if (*data && old_end == arena->data + arena->used)
+    {
+        // Still the top of the arena, so just extend it
+        if (!push_size(arena, (new_capacity - *capacity)*item_size))
+            return false;
+    }
+    else
+    {
+        void* new_data = push_size(arena, new_capacity*item_size);
+        if (!new_data)
+            return false;
+        if (count)
+            memcpy(new_data, *data, (usize)(count*item_size));
+        *data = new_data;
+    }
+
+    *capacity = new_capacity;
+    return true;
+}
+
+#define array_reserve(arena, array, min_capacity) \
+    array_grow_((arena), (void**)&(array)->data, &(array)->capacity, (array)->count, \
+                (size)sizeof(*(array)->data), (min_capacity))
+
+// Returns a pointer to the new last item, or 0 if the arena is out of space
+#define array_push(arena, array) \
+    (array_reserve((arena), (array), (array)->count + 1) ? &(array)->data[(array)->count++] : 0)
+
+#define array_pop(array) ((array)->data[--(array)->count])
+#define array_clear(array) ((array)->count = 0)
+
+// Removes item index by moving the last item into its place
+#define array_remove_swap(array, index) ((array)->data[(index)] = (array)->data[--(array)->count])
+
+//
+// NOTE(lucas): Open-addressing hash map
+//
+// Linear probing over a control byte per slot. A full slot stores the top 7 bits of its hash, an empty slot is
+// HASH_CTRL_EMPTY. Lookups compare 16 control bytes at once, so most probes only touch keys that are likely to
+// match. The control array has HASH_GROUP_SIZE extra bytes mirroring the first ones, so a group starting near the
+// end can be loaded without wrapping.
+//
+// Deletion shifts later entries of the same probe chain back instead of leaving tombstones, so there is never an
+// empty slot inside a chain. Lookups stop at the first empty slot and long-lived maps don't slow down as entries
+// come and go. Full hashes are stored next to the control bytes so growing and deleting never rehash keys.
+//
+// HASH_MAP_DEFINE(Name, prefix, Key, Value, hash_fn, equal_fn) declares the map type and its functions:
+//   prefix_init(map, arena, capacity)   Capacity is rounded up to a power of two, at least HASH_GROUP_SIZE
+//   prefix_get(map, key)                Returns a pointer to the value or 0
+//   prefix_put(map, key, value)         Inserts or overwrites. Returns a pointer to the value, or 0 if out of memory
+//   prefix_remove(map, key)             Returns true if the key was present
+// Keys are stored by value. For s8 keys, the bytes must outlive the map.
+//
+
+#define HASH_GROUP_SIZE 16
+#define HASH_CTRL_EMPTY 0x80
+
+typedef struct
+{
+    Arena* arena;
+    u8* ctrl; // capacity + HASH_GROUP_SIZE bytes
+    u64* hashes;
+    u32 capacity; // Power of two
+    u32 count;
+} HashMapCore;
+
+internal inline u64 hash_u64(u64 x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDull;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+internal inline b32 hash_u64_equal(u64 a, u64 b)
+{
+    return a == b;
+}
+
+internal inline u8 hash_ctrl_tag(u64 hash)
+{
+    return (u8)(hash >> 57);
+}
+
+// Bit i is set if ctrl[i] == tag
+internal inline u32 hash_group_match(u8* ctrl, u8 tag)
+{
+#ifdef HASH_GROUP_SSE2
+    __m128i group = _mm_loadu_si128((__m128i*)ctrl);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)tag)));
+#else
+    u32 result = 0;
+    for (u32 i = 0; i < HASH_GROUP_SIZE; ++i)
+        result |= (u32)(ctrl[i] == tag) << i;
+    return result;
+#endif
+}
+
+// Bit i is set if ctrl[i] is empty. Only empty slots have the high bit set.
+internal inline u32 hash_group_match_empty(u8* ctrl)
+{
+#ifdef HASH_GROUP_SSE2
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((__m128i*)ctrl));
+#else
+    u32 result = 0;
+    for (u32 i = 0; i < HASH_GROUP_SIZE; ++i)
+        result |= (u32)(ctrl[i] >> 7) << i;
+    return result;
+#endif
+}
+
+internal inline void hash_set_ctrl(HashMapCore* map, u32 slot, u8 value)
+{
+    map->ctrl[slot] = value;
+    if (slot < HASH_GROUP_SIZE)
+        map->ctrl[map->capacity + slot] = value;
+}
+
+internal inline b32 hash_slot_is_full(HashMapCore* map, u32 slot)
+{
+    return !(map->ctrl[slot] & HASH_CTRL_EMPTY);
+}
+
+internal b32 hash_core_init(HashMapCore* map, Arena* arena, u32 capacity)
+{
+    u32 rounded = HASH_GROUP_SIZE;
+    while (rounded < capacity)
+        rounded *= 2;
+
+    map->arena = arena;
+    map->count = 0;
+    map->ctrl = push_array(arena, rounded + HASH_GROUP_SIZE, u8);
+    map->hashes = push_array(arena, rounded, u64);
+    if (!map->ctrl || !map->hashes)
+    {
+        map->capacity = 0;
+        return false;
+    }
+
+    map->capacity = rounded;
+    memset(map->ctrl, HASH_CTRL_EMPTY, rounded + HASH_GROUP_SIZE);
+    return true;
+}
+
+// Grows at 7/8 full. Linear probing chains get long past that, and a group needs an empty slot to stop a search.
+internal inline b32 hash_core_needs_grow(HashMapCore* map)
+{
+    return (u64)(map->count + 1)*8 > (u64)map->capacity*7;
+}
+
+// Finds the first empty slot in the probe chain for hash
+internal u32 hash_core_find_empty(HashMapCore* map, u64 hash)
+{
+    u32 mask = map->capacity - 1;
+    u32 pos = (u32)hash & mask;
+    for (;;)
+    {
+        u32 empty = hash_group_match_empty(map->ctrl + pos);
+        if (empty)
+            return (pos + count_trailing_zeros_u32(empty)) & mask;
+        pos = (pos + HASH_GROUP_SIZE) & mask;
+    }
+}
+
+// Empties slot and pulls later members of the probe chain back so the chain has no gap
+internal void hash_core_remove_slot(HashMapCore* map, u32 slot, void* keys, void* values, size key_size,
+                                    size value_size)
+{
+    u32 mask = map->capacity - 1;
+    u32 hole = slot;
+    u32 next = (slot + 1) & mask;
+    while (hash_slot_is_full(map, next))
+    {
+        // An entry can fill the hole if its home slot is not between the hole and where it is now
+        u32 home = (u32)map->hashes[next] & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask))
+        {
+            hash_set_ctrl(map, hole, map->ctrl[next]);
+            map->hashes[hole] = map->hashes[next];
+            memcpy((u8*)keys + hole*key_size, (u8*)keys + next*key_size, (usize)key_size);
+            memcpy((u8*)values + hole*value_size, (u8*)values + next*value_size, (usize)value_size);
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    hash_set_ctrl(map, hole, HASH_CTRL_EMPTY);
+    --map->count;
+}
+
+#define HASH_MAP_DEFINE(name, prefix, key_type, value_type, hash_fn, equal_fn)                                  \
+    typedef struct                                                                                              \
+    {                                                                                                           \
+        HashMapCore core;                                                                                       \
+        key_type* keys;                                                                                         \
+        value_type* values;                                                                                     \
+    } name;                                                                                                     \
+                                                                                                                \
+    internal b32 prefix##_init(name* map, Arena* arena, u32 capacity)                                           \
+    {                                                                                                           \
+        map->keys = 0;                                                                                          \
+        map->values = 0;                                                                                        \
+        if (!hash_core_init(&map->core, arena, capacity))                                                       \
+            return false;                                                                                       \
+        map->keys = push_array(arena, map->core.capacity, key_type);                                            \
+        map->values = push_array(arena, map->core.capacity, value_type);                                        \
+        return map->keys && map->values;                                                                        \
+    }                                                                                                           \
+                                                                                                                \
+    internal u32 prefix##_find_slot(name* map, key_type key, u64 hash)                                          \
+    {                                                                                                           \
+        HashMapCore* core = &map->core;                                                                         \
+        u32 mask = core->capacity - 1;                                                                          \
+        u32 pos = (u32)hash & mask;                                                                             \
+        u8 tag = hash_ctrl_tag(hash);                                                                           \
+        for (;;)                                                                                                \
+        {                                                                                                       \
+            u8* group = core->ctrl + pos;                                                                       \
+            u32 empty = hash_group_match_empty(group);                                                          \
+            u32 match = hash_group_match(group, tag);                                                           \
+            /* Nothing past the first empty slot belongs to this chain */                                       \
+            if (empty)                                                                                          \
+                match &= empty ^ (empty - 1);                                                                   \
+            while (match)                                                                                       \
+            {                                                                                                   \
+                u32 slot = (pos + count_trailing_zeros_u32(match)) & mask;                                      \
+                if (core->hashes[slot] == hash && equal_fn(map->keys[slot], key))                               \
+                    return slot;                                                                                \
+                match &= match - 1;                                                                             \
+            }                                                                                                   \
+            if (empty)                                                                                          \
+                return core->capacity;                                                                          \
+            pos = (pos + HASH_GROUP_SIZE) & mask;                                                               \
+        }                                                                                                       \
+    }                                                                                                           \
+                                                                                                                \
+    internal value_type* prefix##_get(name* map, key_type key)                                                  \
+    {                                                                                                           \
+        if (!map->core.count)                                                                                   \
+            return 0;                                                                                           \
+        u32 slot = prefix##_find_slot(map, key, hash_fn(key));                                                  \
+        return (slot < map->core.capacity) ? &map->values[slot] : 0;                                            \
+    }                                                                                                           \
+                                                                                                                \
+    internal b32 prefix##_grow(name* map)                                                                       \
+    {                                                                                                           \
+        name old = *map;                                                                                        \
+        if (!prefix##_init(map, old.core.arena, old.core.capacity*2))                                           \
+        {                                                                                                       \
+            *map = old;                                                                                         \
+            return false;                                                                                       \
+        }                                                                                                       \
+        for (u32 slot = 0; slot < old.core.capacity; ++slot)                                                    \
+        {                                                                                                       \
+            if (!hash_slot_is_full(&old.core, slot))                                                            \
+                continue;                                                                                       \
+            u64 hash = old.core.hashes[slot];                                                                   \
+            u32 new_slot = hash_core_find_empty(&map->core, hash);                                              \
+            hash_set_ctrl(&map->core, new_slot, hash_ctrl_tag(hash));                                           \
+            map->core.hashes[new_slot] = hash;                                                                  \
+            map->keys[new_slot] = old.keys[slot];                                                               \
+            map->values[new_slot] = old.values[slot];                                                           \
+        }                                                                                                       \
+        map->core.count = old.core.count;                                                                       \
+        return true;                                                                                            \
+    }                                                                                                           \
+                                                                                                                \
+    internal value_type* prefix##_put(name* map, key_type key, value_type value)                                \
+    {                                                                                                           \
+        ASSERT(map->core.capacity, "Hash map used before init");                                                \
+        if (!map->core.capacity)                                                                                \
+            return 0;                                                                                           \
+        u64 hash = hash_fn(key);                                                                                \
+        u32 slot = map->core.count ? prefix##_find_slot(map, key, hash) : map->core.capacity;                   \
+        if (slot == map->core.capacity)                                                                         \
+        {                                                                                                       \
+            if (hash_core_needs_grow(&map->core) && !prefix##_grow(map))                                        \
+                return 0;                                                                                       \
+            slot = hash_core_find_empty(&map->core, hash);                                                      \
+            hash_set_ctrl(&map->core, slot, hash_ctrl_tag(hash));                                               \
+            map->core.hashes[slot] = hash;                                                                      \
+            map->keys[slot] = key;                                                                              \
+            ++map->core.count;                                                                                  \
+        }                                                                                                       \
+        map->values[slot] = value;                                                                              \
+        return &map->values[slot];                                                                              \
+    }                                                                                                           \
+                                                                                                                \
+    internal b32 prefix##_remove(name* map, key_type key)                                                       \
+    {                                                                                                           \
+        if (!map->core.count)                                                                                   \
+            return false;                                                                                       \
+        u32 slot = prefix##_find_slot(map, key, hash_fn(key));                                                  \
+        if (slot == map->core.capacity)                                                                         \
+            return false;                                                                                       \
+        hash_core_remove_slot(&map->core, slot, map->keys, map->values, (size)sizeof(key_type),                 \
+                              (size)sizeof(value_type));                                                        \
+        return true;                                                                                            \
+    }
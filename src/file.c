@@ -2,6 +2,8 @@
 
 #ifdef _WIN32
     #include "platform/windows/win32_file.c"
+#elif defined(__linux__)
+    #include "platform/linux/linux_file.c"
 #else
     #error "Unsupported platform!"
 #endif
\ No newline at end of file
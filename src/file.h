@@ -6,7 +6,9 @@ typedef enum FileMode
 {
     FileMode_Read = (1 << 0),
     FileMode_Write = (1 << 1),
-    FileMode_Append = (1 << 2)
+    FileMode_Append = (1 << 2),
+    FileMode_Create = (1 << 3), // Create the file, or truncate it if it exists
+    FileMode_Private = (1 << 4) // Readable and writable by its owner alone, even if it was already there
 } FileMode;
 
 typedef enum FileSeekMethod
@@ -16,6 +18,37 @@ typedef enum FileSeekMethod
     FileSeek_End
 } FileSeekMethod;
 
+typedef enum FileEntryKind
+{
+    FileEntryKind_File = 0,
+    FileEntryKind_Directory,
+    FileEntryKind_Other // Symbolic links, devices and anything else that isn't followed
+} FileEntryKind;
+
+typedef struct
+{
+    char* name; // Only valid during the callback
+    size name_length;
+    FileEntryKind kind;
+} FileEntry;
+
+typedef void FileEntryCallback(FileEntry* entry, void* data);
+
+typedef struct
+{
+    u64 size;
+    u64 modified; // In the platform's own units, so only good for comparing with another modified
+    u64 id;       // Inode number or file index, which stays the same when the file is renamed
+    FileEntryKind kind;
+} FileInfo;
+
+// A read-only view of a whole file. The OS pages it in as it is touched, so only what is being read takes memory.
+typedef struct
+{
+    u8* data;
+    size size;
+} FileMapping;
+
 size file_get_size(char* filename);
 b32 file_exists(char* filename);
 void* file_open(char* filename, FileMode mode); // Opens file with given mode(s) and returns file handle
@@ -26,3 +59,50 @@ i64 file_seek_begin(void* file_handle);
 i64 file_seek_end(void* file_handle);
 
 int file_read(void* file_handle, void* buffer, size num_bytes_to_read);
+int file_write(void* file_handle, void* buffer, size num_bytes_to_write);
+
+// For files that aren't ours, which can be unreadable or change while they are read. Returns 0 if the file can't be
+// opened, and a read returns the number of bytes it got, fewer at the end of the file or on an error, rather than
+// asserting like file_open and file_read. Other processes can still write, rename and delete the file while it is
+// open.
+void* file_open_read(char* filename);
+size file_read_stream(void* file_handle, void* buffer, size num_bytes_to_read);
+
+// Waits until what was written is on the disk, not just in the OS's cache. A file written to replace another with
+// file_replace needs it first, or a crash can leave the new name pointing at a file that was never written out.
+b32 file_flush(void* file_handle);
+
+// Calls visit for every entry of the directory but . and .., in no particular order. Returns false if the directory
+// can't be opened.
+b32 file_list_directory(char* path, FileEntryCallback* visit, void* data);
+
+// Doesn't follow symbolic links, which are FileEntryKind_Other. Returns false if nothing is there.
+b32 file_get_info(char* path, FileInfo* info);
+
+// Moves from over to, replacing it. Readers of to see the old file or the new one, never a mix, as long as both
+// are on the same volume.
+b32 file_replace(char* from, char* to);
+b32 file_delete(char* filename);
+
+// Creates a new, empty file in the same directory as filename and with its permissions, for writing a new version
+// of it that file_replace then moves over it. Writes the new file's path to buffer. Returns 0 if it can't, and
+// unlike file_open doesn't assert.
+void* file_create_beside(char* filename, char* buffer, size capacity);
+
+// Appends bytes of from, starting at offset, to to, without moving from's position. The OS copies them itself where
+// it can, so they never pass through a buffer of ours. Returns false if not all of them were copied.
+b32 file_copy_range(void* from, u64 offset, void* to, u64 bytes);
+
+// Absolute, with . and .. resolved, so the same file gives the same path from any working directory. Returns the
+// length, or 0 if the path doesn't exist or doesn't fit.
+size file_get_full_path(char* path, char* buffer, size capacity);
+
+// Standard output and error, for running from the command line. Writing to them returns false once the reader has
+// gone away, as when the output is piped into head, rather than asserting like file_write.
+void* file_get_stdout(void);
+void* file_get_stderr(void);
+b32 file_write_stream(void* file_handle, void* buffer, size num_bytes_to_write);
+
+// Empty and missing files can't be mapped and give a mapping with no data
+FileMapping file_map(char* filename);
+void file_unmap(FileMapping* mapping);
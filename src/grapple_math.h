@@ -5,6 +5,19 @@
 // TODO(lucas): Replace standard math functions
 #include <math.h>
 
+#if defined(__AVX__)
+    #include <immintrin.h>
+    #define QUAD_LANES 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define QUAD_LANES 4
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define QUAD_LANES 4
+#else
+    #define QUAD_LANES 1
+#endif
+
 #ifdef __cplusplus
     #define v2(x, y) {(x), (y)}
     #define v3(x, y, z) {(x), (y), (z)}
@@ -89,6 +102,26 @@ typedef struct
     v2 max;
 } rect;
 
+// 2D affine transform, row major like m4: x' = m[0][0]*x + m[0][1]*y + m[0][2]
+typedef struct
+{
+    f32 m[2][3];
+} m2x3;
+
+// NOTE(lucas): Quads in structure-of-arrays form for the batched expansion kernel. (u0, v0) is the UV at the
+// top-left corner and (u1, v1) the UV at the bottom-right, so the full texture is (0, 1)-(1, 0).
+typedef struct
+{
+    f32* x;
+    f32* y;
+    f32* w;
+    f32* h;
+    f32* u0;
+    f32* v0;
+    f32* u1;
+    f32* v1;
+} QuadsSoA;
+
 //
 // NOTE(lucas): Scalar operations
 //
@@ -221,3 +254,322 @@ internal inline rect rect_min_dim(v2 min, v2 dim)
 
     return result;
 }
+
+internal inline b32 rect_overlaps(rect a, rect b)
+{
+    b32 result = (a.min.x < b.max.x && b.min.x < a.max.x &&
+                  a.min.y < b.max.y && b.min.y < a.max.y);
+    return result;
+}
+
+internal inline rect rect_union(rect a, rect b)
+{
+    rect result = {0};
+
+    result.min.x = (a.min.x < b.min.x) ? a.min.x : b.min.x;
+    result.min.y = (a.min.y < b.min.y) ? a.min.y : b.min.y;
+    result.max.x = (a.max.x > b.max.x) ? a.max.x : b.max.x;
+    result.max.y = (a.max.y > b.max.y) ? a.max.y : b.max.y;
+
+    return result;
+}
+
+internal inline rect rect_intersect(rect a, rect b)
+{
+    rect result = {0};
+
+    result.min.x = (a.min.x > b.min.x) ? a.min.x : b.min.x;
+    result.min.y = (a.min.y > b.min.y) ? a.min.y : b.min.y;
+    result.max.x = (a.max.x < b.max.x) ? a.max.x : b.max.x;
+    result.max.y = (a.max.y < b.max.y) ? a.max.y : b.max.y;
+
+    return result;
+}
+
+internal inline b32 rect_is_empty(rect r)
+{
+    b32 result = (r.max.x <= r.min.x || r.max.y <= r.min.y);
+    return result;
+}
+
+//
+// NOTE(lucas): m2x3 operations
+//
+
+internal inline m2x3 m2x3_identity(void)
+{
+    m2x3 result = {0};
+    result.m[0][0] = 1.0f;
+    result.m[1][1] = 1.0f;
+    return result;
+}
+
+internal inline m2x3 m2x3_translate_scale(v2 translation, v2 scale)
+{
+    m2x3 result = {0};
+    result.m[0][0] = scale.x;
+    result.m[0][2] = translation.x;
+    result.m[1][1] = scale.y;
+    result.m[1][2] = translation.y;
+    return result;
+}
+
+internal inline v2 m2x3_transform_point(m2x3 t, v2 p)
+{
+    v2 result = v2(t.m[0][0]*p.x + t.m[0][1]*p.y + t.m[0][2],
+                   t.m[1][0]*p.x + t.m[1][1]*p.y + t.m[1][2]);
+    return result;
+}
+
+//
+// NOTE(lucas): Wide operations. lane_f32 holds QUAD_LANES floats using the widest instruction set enabled at
+// compile time: AVX, then SSE2 or NEON, then plain scalar code.
+//
+
+#if QUAD_LANES == 8
+typedef __m256 lane_f32;
+
+internal inline lane_f32 lane_load(f32* p)                  {return _mm256_loadu_ps(p);}
+internal inline lane_f32 lane_set1(f32 x)                   {return _mm256_set1_ps(x);}
+internal inline lane_f32 lane_add(lane_f32 a, lane_f32 b)   {return _mm256_add_ps(a, b);}
+internal inline lane_f32 lane_sub(lane_f32 a, lane_f32 b)   {return _mm256_sub_ps(a, b);}
+internal inline lane_f32 lane_mul(lane_f32 a, lane_f32 b)   {return _mm256_mul_ps(a, b);}
+internal inline lane_f32 lane_min(lane_f32 a, lane_f32 b)   {return _mm256_min_ps(a, b);}
+internal inline lane_f32 lane_max(lane_f32 a, lane_f32 b)   {return _mm256_max_ps(a, b);}
+
+// 1/x where x > 0, otherwise 0
+internal inline lane_f32 lane_safe_reciprocal(lane_f32 x)
+{
+    __m256 positive = _mm256_cmp_ps(x, _mm256_setzero_ps(), _CMP_GT_OQ);
+    lane_f32 result = _mm256_and_ps(positive, _mm256_div_ps(_mm256_set1_ps(1.0f), x));
+    return result;
+}
+
+// Writes lane i as one (x, y, u, v) vertex at out + i*16, i.e. the same corner of consecutive quads
+internal inline void lane_store_vertices(f32* out, lane_f32 x, lane_f32 y, lane_f32 u, lane_f32 v)
+{
+    __m256 xy_lo = _mm256_unpacklo_ps(x, y);
+    __m256 xy_hi = _mm256_unpackhi_ps(x, y);
+    __m256 uv_lo = _mm256_unpacklo_ps(u, v);
+    __m256 uv_hi = _mm256_unpackhi_ps(u, v);
+
+    __m256 q0 = _mm256_shuffle_ps(xy_lo, uv_lo, _MM_SHUFFLE(1, 0, 1, 0)); // Quads 0 and 4
+    __m256 q1 = _mm256_shuffle_ps(xy_lo, uv_lo, _MM_SHUFFLE(3, 2, 3, 2)); // Quads 1 and 5
+    __m256 q2 = _mm256_shuffle_ps(xy_hi, uv_hi, _MM_SHUFFLE(1, 0, 1, 0)); // Quads 2 and 6
+    __m256 q3 = _mm256_shuffle_ps(xy_hi, uv_hi, _MM_SHUFFLE(3, 2, 3, 2)); // Quads 3 and 7
+
+    _mm_storeu_ps(out + 0*16, _mm256_castps256_ps128(q0));
+    _mm_storeu_ps(out + 1*16, _mm256_castps256_ps128(q1));
+    _mm_storeu_ps(out + 2*16, _mm256_castps256_ps128(q2));
+    _mm_storeu_ps(out + 3*16, _mm256_castps256_ps128(q3));
+    _mm_storeu_ps(out + 4*16, _mm256_extractf128_ps(q0, 1));
+    _mm_storeu_ps(out + 5*16, _mm256_extractf128_ps(q1, 1));
+    _mm_storeu_ps(out + 6*16, _mm256_extractf128_ps(q2, 1));
+    _mm_storeu_ps(out + 7*16, _mm256_extractf128_ps(q3, 1));
+}
+#elif QUAD_LANES == 4 && defined(__ARM_NEON)
+typedef float32x4_t lane_f32;
+
+internal inline lane_f32 lane_load(f32* p)                  {return vld1q_f32(p);}
+internal inline lane_f32 lane_set1(f32 x)                   {return vdupq_n_f32(x);}
+internal inline lane_f32 lane_add(lane_f32 a, lane_f32 b)   {return vaddq_f32(a, b);}
+internal inline lane_f32 lane_sub(lane_f32 a, lane_f32 b)   {return vsubq_f32(a, b);}
+internal inline lane_f32 lane_mul(lane_f32 a, lane_f32 b)   {return vmulq_f32(a, b);}
+internal inline lane_f32 lane_min(lane_f32 a, lane_f32 b)   {return vminq_f32(a, b);}
+internal inline lane_f32 lane_max(lane_f32 a, lane_f32 b)   {return vmaxq_f32(a, b);}
+
+internal inline lane_f32 lane_safe_reciprocal(lane_f32 x)
+{
+    uint32x4_t positive = vcgtq_f32(x, vdupq_n_f32(0.0f));
+    float32x4_t reciprocal = vdivq_f32(vdupq_n_f32(1.0f), x);
+    lane_f32 result = vreinterpretq_f32_u32(vandq_u32(positive, vreinterpretq_u32_f32(reciprocal)));
+    return result;
+}
+
+internal inline void lane_store_vertices(f32* out, lane_f32 x, lane_f32 y, lane_f32 u, lane_f32 v)
+{
+    float32x4x2_t xy = vzipq_f32(x, y);
+    float32x4x2_t uv = vzipq_f32(u, v);
+    vst1q_f32(out + 0*16, vcombine_f32(vget_low_f32(xy.val[0]),  vget_low_f32(uv.val[0])));
+    vst1q_f32(out + 1*16, vcombine_f32(vget_high_f32(xy.val[0]), vget_high_f32(uv.val[0])));
+    vst1q_f32(out + 2*16, vcombine_f32(vget_low_f32(xy.val[1]),  vget_low_f32(uv.val[1])));
+    vst1q_f32(out + 3*16, vcombine_f32(vget_high_f32(xy.val[1]), vget_high_f32(uv.val[1])));
+}
+#elif QUAD_LANES == 4
+typedef __m128 lane_f32;
+
+internal inline lane_f32 lane_load(f32* p)                  {return _mm_loadu_ps(p);}
+internal inline lane_f32 lane_set1(f32 x)                   {return _mm_set1_ps(x);}
+internal inline lane_f32 lane_add(lane_f32 a, lane_f32 b)   {return _mm_add_ps(a, b);}
+internal inline lane_f32 lane_sub(lane_f32 a, lane_f32 b)   {return _mm_sub_ps(a, b);}
+internal inline lane_f32 lane_mul(lane_f32 a, lane_f32 b)   {return _mm_mul_ps(a, b);}
+internal inline lane_f32 lane_min(lane_f32 a, lane_f32 b)   {return _mm_min_ps(a, b);}
+internal inline lane_f32 lane_max(lane_f32 a, lane_f32 b)   {return _mm_max_ps(a, b);}
+
+internal inline lane_f32 lane_safe_reciprocal(lane_f32 x)
+{
+    __m128 positive = _mm_cmpgt_ps(x, _mm_setzero_ps());
+    lane_f32 result = _mm_and_ps(positive, _mm_div_ps(_mm_set1_ps(1.0f), x));
+    return result;
+}
+
+internal inline void lane_store_vertices(f32* out, lane_f32 x, lane_f32 y, lane_f32 u, lane_f32 v)
+{
+    __m128 xy_lo = _mm_unpacklo_ps(x, y); // x0 y0 x1 y1
+    __m128 xy_hi = _mm_unpackhi_ps(x, y); // x2 y2 x3 y3
+    __m128 uv_lo = _mm_unpacklo_ps(u, v);
+    __m128 uv_hi = _mm_unpackhi_ps(u, v);
+    _mm_storeu_ps(out + 0*16, _mm_movelh_ps(xy_lo, uv_lo));
+    _mm_storeu_ps(out + 1*16, _mm_movehl_ps(uv_lo, xy_lo));
+    _mm_storeu_ps(out + 2*16, _mm_movelh_ps(xy_hi, uv_hi));
+    _mm_storeu_ps(out + 3*16, _mm_movehl_ps(uv_hi, xy_hi));
+}
+#else
+typedef f32 lane_f32;
+
+internal inline lane_f32 lane_load(f32* p)                  {return *p;}
+internal inline lane_f32 lane_set1(f32 x)                   {return x;}
+internal inline lane_f32 lane_add(lane_f32 a, lane_f32 b)   {return a + b;}
+internal inline lane_f32 lane_sub(lane_f32 a, lane_f32 b)   {return a - b;}
+internal inline lane_f32 lane_mul(lane_f32 a, lane_f32 b)   {return a*b;}
+internal inline lane_f32 lane_min(lane_f32 a, lane_f32 b)   {return (a < b) ? a : b;}
+internal inline lane_f32 lane_max(lane_f32 a, lane_f32 b)   {return (a > b) ? a : b;}
+
+internal inline lane_f32 lane_safe_reciprocal(lane_f32 x)
+{
+    lane_f32 result = (x > 0.0f) ? 1.0f/x : 0.0f;
+    return result;
+}
+
+internal inline void lane_store_vertices(f32* out, lane_f32 x, lane_f32 y, lane_f32 u, lane_f32 v)
+{
+    out[0] = x;
+    out[1] = y;
+    out[2] = u;
+    out[3] = v;
+}
+#endif
+
+//
+// NOTE(lucas): Batched quad expansion
+//
+
+internal inline QuadsSoA quads_soa_offset(QuadsSoA quads, size offset)
+{
+    QuadsSoA result = quads;
+    result.x += offset;
+    result.y += offset;
+    result.w += offset;
+    result.h += offset;
+    result.u0 += offset;
+    result.v0 += offset;
+    result.u1 += offset;
+    result.v1 += offset;
+    return result;
+}
+
+// Expands QUAD_LANES quads starting at quads[0] into out, 16 floats per quad.
+internal inline void quads_expand_block(f32* out, QuadsSoA quads, m2x3* transform, rect* clip)
+{
+    lane_f32 x0 = lane_load(quads.x);
+    lane_f32 y0 = lane_load(quads.y);
+    lane_f32 w = lane_load(quads.w);
+    lane_f32 h = lane_load(quads.h);
+    lane_f32 x1 = lane_add(x0, w);
+    lane_f32 y1 = lane_add(y0, h);
+    lane_f32 u0 = lane_load(quads.u0);
+    lane_f32 v0 = lane_load(quads.v0);
+    lane_f32 u1 = lane_load(quads.u1);
+    lane_f32 v1 = lane_load(quads.v1);
+
+    if (clip)
+    {
+        lane_f32 cx0 = lane_max(x0, lane_set1(clip->min.x));
+        lane_f32 cy0 = lane_max(y0, lane_set1(clip->min.y));
+        lane_f32 cx1 = lane_max(lane_min(x1, lane_set1(clip->max.x)), cx0);
+        lane_f32 cy1 = lane_max(lane_min(y1, lane_set1(clip->max.y)), cy0);
+
+        // Move the UVs by the same fraction of the quad that was clipped off. Fully clipped quads collapse to zero
+        // area and rasterize nothing.
+        lane_f32 du = lane_mul(lane_sub(u1, u0), lane_safe_reciprocal(w));
+        lane_f32 dv = lane_mul(lane_sub(v1, v0), lane_safe_reciprocal(h));
+        lane_f32 cu0 = lane_add(u0, lane_mul(lane_sub(cx0, x0), du));
+        lane_f32 cu1 = lane_add(u0, lane_mul(lane_sub(cx1, x0), du));
+        lane_f32 cv0 = lane_add(v0, lane_mul(lane_sub(cy0, y0), dv));
+        lane_f32 cv1 = lane_add(v0, lane_mul(lane_sub(cy1, y0), dv));
+
+        x0 = cx0;
+        y0 = cy0;
+        x1 = cx1;
+        y1 = cy1;
+        u0 = cu0;
+        u1 = cu1;
+        v0 = cv0;
+        v1 = cv1;
+    }
+
+    // Same corner order as renderer_draw_texture: top-left, top-right, bottom-left, bottom-right
+    lane_f32 px[4] = {x0, x1, x0, x1};
+    lane_f32 py[4] = {y0, y0, y1, y1};
+    lane_f32 pu[4] = {u0, u1, u0, u1};
+    lane_f32 pv[4] = {v0, v0, v1, v1};
+
+    if (transform)
+    {
+        lane_f32 m00 = lane_set1(transform->m[0][0]);
+        lane_f32 m01 = lane_set1(transform->m[0][1]);
+        lane_f32 m02 = lane_set1(transform->m[0][2]);
+        lane_f32 m10 = lane_set1(transform->m[1][0]);
+        lane_f32 m11 = lane_set1(transform->m[1][1]);
+        lane_f32 m12 = lane_set1(transform->m[1][2]);
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            lane_f32 x = px[corner];
+            lane_f32 y = py[corner];
+            px[corner] = lane_add(lane_add(lane_mul(m00, x), lane_mul(m01, y)), m02);
+            py[corner] = lane_add(lane_add(lane_mul(m10, x), lane_mul(m11, y)), m12);
+        }
+    }
+
+    for (int corner = 0; corner < 4; ++corner)
+        lane_store_vertices(out + corner*4, px[corner], py[corner], pu[corner], pv[corner]);
+}
+
+/*
+ * NOTE(lucas): Expands count quads into interleaved (x, y, u, v) vertices, 4 per quad, in out_vertices.
+ * When clip is given, each quad is clipped to it (with matching UVs) before transform is applied, so clip is
+ * in the quads' own space. Both are optional.
+ */
+internal void quads_expand(f32* out_vertices, QuadsSoA quads, size count, m2x3* transform, rect* clip)
+{
+    size full_count = count - (count % QUAD_LANES);
+    for (size i = 0; i < full_count; i += QUAD_LANES)
+        quads_expand_block(out_vertices + i*16, quads_soa_offset(quads, i), transform, clip);
+
+    // Pad the tail out to a full block so the same kernel handles it
+    size remaining = count - full_count;
+    if (remaining)
+    {
+        f32 tail[8][QUAD_LANES] = {0};
+        f32 tail_out[QUAD_LANES*16];
+        QuadsSoA src = quads_soa_offset(quads, full_count);
+        for (size i = 0; i < remaining; ++i)
+        {
+            tail[0][i] = src.x[i];
+            tail[1][i] = src.y[i];
+            tail[2][i] = src.w[i];
+            tail[3][i] = src.h[i];
+            tail[4][i] = src.u0[i];
+            tail[5][i] = src.v0[i];
+            tail[6][i] = src.u1[i];
+            tail[7][i] = src.v1[i];
+        }
+
+        QuadsSoA tail_quads = {tail[0], tail[1], tail[2], tail[3], tail[4], tail[5], tail[6], tail[7]};
+        quads_expand_block(tail_out, tail_quads, transform, clip);
+
+        f32* dest = out_vertices + full_count*16;
+        for (size i = 0; i < remaining*16; ++i)
+            dest[i] = tail_out[i];
+    }
+}
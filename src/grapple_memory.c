@@ -1,7 +1,136 @@
+#include "atomic.h"
+#include "file.h"
 #include "grapple_memory.h"
+#include "str.h"
 
 #ifdef _WIN32
     #include "platform/windows/win32_memory.c"
+#elif defined(__linux__)
+    #include "platform/linux/linux_memory.c"
 #else
     #error "Unsupported platform!"
 #endif
+
+global Arena* global_arena_registry[ARENA_MAX_REGISTERED];
+global volatile u32 global_arena_registry_count;
+
+void arena_register(Arena* arena, const char* name)
+{
+    arena->name = name;
+
+    u32 index = atomic_add_u32(&global_arena_registry_count, 1) - 1;
+    ASSERT(index < ARENA_MAX_REGISTERED, "Too many registered arenas");
+    if (index < ARENA_MAX_REGISTERED)
+        global_arena_registry[index] = arena;
+}
+
+u32 arena_get_registered(Arena*** arenas)
+{
+    u32 count = atomic_load_u32(&global_arena_registry_count);
+    if (count > ARENA_MAX_REGISTERED)
+        count = ARENA_MAX_REGISTERED;
+    *arenas = global_arena_registry;
+    return count;
+}
+
+void arena_record_site(Arena* arena, size bytes, const char* file, int line)
+{
+#ifdef GRAPPLE_DEBUG
+    ArenaSite* site = 0;
+    for (u32 i = 0; i < arena->site_count; ++i)
+    {
+        if (arena->sites[i].line == line && arena->sites[i].file == file)
+        {
+            site = &arena->sites[i];
+            break;
+        }
+    }
+
+    if (!site)
+    {
+        if (arena->site_count < ARENA_MAX_SITES)
+        {
+            site = &arena->sites[arena->site_count++];
+            site->file = file;
+            site->line = line;
+        }
+        else
+        {
+            site = &arena->sites[ARENA_MAX_SITES-1];
+            site->file = "(other)";
+            site->line = 0;
+        }
+    }
+
+    ++site->push_count;
+    site->bytes += bytes;
+#else
+    (void)arena;
+    (void)bytes;
+    (void)file;
+    (void)line;
+#endif
+}
+
+#ifdef ARENA_STATS
+// One line summary, shared by the overlay and the stats dump
+internal s8 arena_format_stats(Arena* out, Arena* arena)
+{
+    f64 percent = arena->bytes ? 100.0*(f64)arena->peak / (f64)arena->bytes : 0.0;
+    s8 result = s8_format(out, "%s: %.1f/%.1f KB, peak %.1f KB (%.0f%%), %llu pushes, max %.1f KB%s",
+                          arena->name ? arena->name : "(unnamed)", (f64)arena->used / 1024.0,
+                          (f64)arena->bytes / 1024.0, (f64)arena->peak / 1024.0, percent,
+                          (unsigned long long)arena->push_count, (f64)arena->largest_push / 1024.0,
+                          arena->failed_push_count ? ", OVERFLOWED" : "");
+    return result;
+}
+
+b32 arena_write_stats(char* filename, Arena* scratch)
+{
+    void* file = file_open(filename, FileMode_Write|FileMode_Create);
+    if (!file)
+        return false;
+
+    size scratch_mark = scratch->used;
+    Arena** arenas = 0;
+    u32 arena_count = arena_get_registered(&arenas);
+    for (u32 arena_index = 0; arena_index < arena_count; ++arena_index)
+    {
+        Arena* arena = arenas[arena_index];
+        s8 line = arena_format_stats(scratch, arena);
+        file_write(file, line.data, line.len);
+        file_write(file, "\n", 1);
+        if (arena->failed_push_count)
+        {
+            s8 failed = s8_format(scratch, "  %llu pushes did not fit\n", (unsigned long long)arena->failed_push_count);
+            file_write(file, failed.data, failed.len);
+        }
+
+#ifdef GRAPPLE_DEBUG
+        // Call sites, largest first
+        ArenaSite sites[ARENA_MAX_SITES];
+        u32 site_count = arena->site_count;
+        for (u32 i = 0; i < site_count; ++i)
+        {
+            ArenaSite site = arena->sites[i];
+            u32 j = i;
+            for (; j > 0 && sites[j-1].bytes < site.bytes; --j)
+                sites[j] = sites[j-1];
+            sites[j] = site;
+        }
+
+        for (u32 i = 0; i < site_count; ++i)
+        {
+            s8 site_line = s8_format(scratch, "  %10.1f KB in %6u pushes  %s:%d\n", (f64)sites[i].bytes / 1024.0,
+                                     sites[i].push_count, sites[i].file, sites[i].line);
+            file_write(file, site_line.data, site_line.len);
+        }
+#endif
+
+        scratch->used = scratch_mark;
+    }
+
+    file_close(file);
+    return true;
+}
+#endif
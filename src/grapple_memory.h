@@ -5,34 +5,119 @@
 #define KILOBYTES(value) ((u64)(value)*1024)
 #define MEGABYTES(value) ((u64)KILOBYTES(value)*1024)
 
+#define ARENA_MAX_SITES 16
+#define ARENA_MAX_REGISTERED 32
+
+// NOTE(lucas): Arena telemetry adds a few loads and stores to every push, so only debug and profile builds collect
+// it. Release builds still refuse pushes that don't fit and count them.
+#if defined(GRAPPLE_DEBUG) || defined(GRAPPLE_PROFILE)
+    #define ARENA_STATS 1
+#endif
+
+// A place in the code that pushes onto an arena, tracked in debug builds
+typedef struct
+{
+    const char* file;
+    int line;
+    u32 push_count;
+    size bytes;
+} ArenaSite;
+
 typedef struct
 {
     size bytes;
     size used;
     u8* data;
+
+    const char* name; // Set by arena_register
+    u64 failed_push_count; // Pushes that did not fit. They return 0 instead of running past the end.
+
+    // NOTE(lucas): Telemetry, updated on every push so arenas can be sized from measurements instead of guesses.
+    // Peak is the highest used has ever been, so it survives arena_clear and arena_pop.
+#ifdef ARENA_STATS
+    size peak;
+    size largest_push;
+    u64 push_count;
+#endif
+#ifdef GRAPPLE_DEBUG
+    ArenaSite sites[ARENA_MAX_SITES]; // Once full, pushes from new sites are added to the last one
+    u32 site_count;
+#endif
 } Arena;
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 Arena arena_alloc(size bytes);
 
-inline void arena_pop(Arena* arena, size bytes)
+// NOTE(lucas): Registered arenas show up in the overlay and in arena_write_stats. Only register arenas that
+// stay at the same address until exit.
+void arena_register(Arena* arena, const char* name);
+u32 arena_get_registered(Arena*** arenas);
+void arena_record_site(Arena* arena, size bytes, const char* file, int line);
+#ifdef ARENA_STATS
+b32 arena_write_stats(char* filename, Arena* scratch);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+internal inline void arena_pop(Arena* arena, size bytes)
 {
     arena->used -= bytes;
 }
 
-inline void arena_clear(Arena* arena)
+internal inline void arena_clear(Arena* arena)
 {
     arena->used = 0;
 }
 
-inline void* push_size_(Arena* arena, size bytes)
+// Pads the arena so the next push starts at a multiple of alignment, which must be a power of two
+internal inline void arena_align(Arena* arena, size alignment)
+{
+    usize address = (usize)(arena->data + arena->used);
+    size padding = (size)((0 - address) & (usize)(alignment - 1));
+    if (padding <= arena->bytes - arena->used)
+        arena->used += padding;
+}
+
+#ifdef GRAPPLE_DEBUG
+    #define ARENA_SITE_PARAMS , const char* site_file, int site_line
+    #define ARENA_SITE_ARGS , __FILE__, __LINE__
+#else
+    #define ARENA_SITE_PARAMS
+    #define ARENA_SITE_ARGS
+#endif
+
+internal inline void* arena_push(Arena* arena, size bytes ARENA_SITE_PARAMS)
 {
     ASSERT(bytes <= (arena->bytes - arena->used), "Arena overflow");
+    if (bytes > arena->bytes - arena->used)
+    {
+        ++arena->failed_push_count;
+        return 0;
+    }
+
     void* result = arena->data + arena->used;
     arena->used += bytes;
+
+#ifdef ARENA_STATS
+    ++arena->push_count;
+    if (arena->used > arena->peak)
+        arena->peak = arena->used;
+    if (bytes > arena->largest_push)
+        arena->largest_push = bytes;
+#endif
+#ifdef GRAPPLE_DEBUG
+    arena_record_site(arena, bytes, site_file, site_line);
+#endif
+
     return result;
 }
 
-inline void zero_size_(size bytes, void* ptr)
+internal inline void zero_size_(size bytes, void* ptr)
 {
     u8* byte = (u8*)ptr;
     while (bytes--)
@@ -40,6 +125,7 @@ inline void zero_size_(size bytes, void* ptr)
 }
 
 // Define macro to cast to correct type and get correct size
+#define push_size_(arena, bytes) arena_push(arena, bytes ARENA_SITE_ARGS)
 #define push_struct(arena, type) (type*)push_size_(arena, sizeof(type))
 #define zero_struct(instance) zero_size_(sizeof((instance)), &(instance))
 #define push_array(arena, count, type) (type*)push_size_(arena, (count)*sizeof(type))
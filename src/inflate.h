@@ -0,0 +1,103 @@
+#pragma once
+
+#include "types.h"
+
+/*
+ * NOTE(lucas): DEFLATE decoder (RFC 1951) with zlib framing (RFC 1950).
+ *
+ * The whole compressed input has to be in memory, but output can be produced in pieces: the inflater writes into
+ * a caller-provided window, and inflate_next returns each new span of output. Once the window is nearly full, the
+ * last 32 KB (the largest distance a match can reach back) are moved to the front and decoding continues. Passing a
+ * window as large as the whole output decodes everything in one call with no copying.
+ *
+ * Huffman codes up to INFLATE_FAST_BITS long are decoded with a single table lookup. The bit buffer is refilled
+ * eight bytes at a time, and matches far enough back are copied 16 bytes at a time.
+ */
+
+#define INFLATE_FAST_BITS 10
+#define INFLATE_MAX_MATCH 258
+#define INFLATE_WINDOW_HISTORY KILOBYTES(32)
+#define INFLATE_MIN_STREAMING_WINDOW KILOBYTES(64)
+
+typedef struct
+{
+    u16 fast[1 << INFLATE_FAST_BITS]; // (length << 9) | symbol, 0 if the code is longer than INFLATE_FAST_BITS
+    u16 first_code[16];
+    u16 first_symbol[16];
+    u32 max_code[17];
+    u8 sizes[288];
+    u16 values[288];
+} InflateHuffman;
+
+typedef enum
+{
+    InflateStatus_Ok = 0,    // Produced output, call again for more
+    InflateStatus_Done,      // Reached the end of the final block
+    InflateStatus_Error,     // Corrupt or truncated input, or the output did not fit
+} InflateStatus;
+
+typedef enum
+{
+    InflateBlock_Header = 0, // Between blocks
+    InflateBlock_Stored,
+    InflateBlock_Huffman,
+    InflateBlock_Done,
+} InflateBlockState;
+
+typedef struct
+{
+    u8* in;
+    size in_size;
+    size in_pos;
+    u64 bit_buffer;
+    u32 bit_count;
+    size overread; // Zero bytes shifted in past the end of the input
+
+    u8* window;
+    size window_size;
+    size out_pos;    // Next byte to write
+    size out_start;  // Start of the output not yet returned
+    b32 streaming;   // Slide the window when it fills instead of failing
+
+    InflateBlockState block_state;
+    b32 final_block;
+    u32 stored_remaining;
+
+    InflateHuffman lit_len;
+    InflateHuffman dist;
+} Inflater;
+
+typedef struct
+{
+    InflateStatus status;
+    u8* data;
+    size size;
+} InflateResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// window_size must be at least INFLATE_MIN_STREAMING_WINDOW when streaming
+void inflate_init(Inflater* inflater, u8* in, size in_size, u8* window, size window_size, b32 streaming);
+InflateResult inflate_next(Inflater* inflater);
+
+// Bytes of input the deflate stream took, once it is done. Whole bytes the bit buffer read ahead are given back,
+// so this is where whatever follows the stream (a gzip trailer, say) starts.
+size inflate_input_used(Inflater* inflater);
+
+// Running checksums of output, for the formats that wrap deflate data: Adler-32 for zlib, starting from 1, and CRC-32
+// for gzip, starting from 0
+u32 inflate_adler32(u32 adler, u8* data, size data_size);
+u32 inflate_crc32(u32 crc, u8* data, size data_size);
+
+// Strips a zlib header, returning the offset of the deflate data or -1 if the header is invalid
+size zlib_header_size(u8* in, size in_size);
+
+// One-shot decode of a zlib stream into out. Returns the number of bytes written or -1 on error, which includes
+// output that doesn't match the stream's Adler-32.
+size inflate_zlib(u8* in, size in_size, u8* out, size out_size, Inflater* scratch);
+
+#ifdef __cplusplus
+}
+#endif
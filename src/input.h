@@ -2,4 +2,10 @@
 
 #include "window.h"
 
+#define INPUT_WAIT_FOREVER 0xFFFFFFFF
+
+// Handles all pending input without blocking.
 void input_process(Window* window);
+
+// Blocks until input arrives, window_wake is called or the timeout passes, then handles all pending input.
+void input_wait(Window* window, u32 timeout_ms);
@@ -0,0 +1,9 @@
+#include "ipc.h"
+
+#ifdef _WIN32
+    #include "platform/windows/win32_ipc.c"
+#elif defined(__linux__)
+    #include "platform/linux/linux_ipc.c"
+#else
+    #error "Unsupported platform!"
+#endif
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "grapple_memory.h"
+#include "thread.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Connections between processes on the same machine, for the search daemon and its clients. They are
+ * Unix domain sockets on Linux and named pipes on Windows. Both are reliable byte streams, so messages are sent
+ * whole and received by size. Names are short, like "grapple-0123abcd", and become a socket in the user's runtime
+ * directory or a pipe under \\.\pipe\.
+ *
+ * Shared memory is for data too big to be worth sending. It is created under a name that the other process opens
+ * and maps. On Linux the name lasts until it is unlinked, so the creator unlinks it once the other side has mapped
+ * it. On Windows it goes away with the last handle, so unlinking does nothing.
+ */
+
+#define IPC_MAX_NAME 64
+#define IPC_MAX_PATH 256
+
+typedef struct
+{
+    void* handle;
+    u8* data;
+    size bytes;
+} SharedMemory;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns 0 on failure. Listening replaces a socket left behind by a server that died.
+void* ipc_listen(char* name);
+void* ipc_accept(void* listener); // Blocks until a client connects
+void* ipc_connect(char* name);    // Fails straight away if nothing is listening
+void ipc_close(void* connection);
+
+// Removes the socket a listener left on the file system, so clients stop finding it. Nothing to do on Windows, where
+// the pipe goes away with the process.
+void ipc_unlink(char* name);
+
+// Instead of ending the process, Ctrl+C and requests to terminate set interrupted and signal wake, so a server can
+// clean up after itself
+void ipc_catch_interrupt(volatile u32* interrupted, Semaphore* wake);
+
+// Send writes all of data and receive blocks until all of it has arrived. Both return false once the other side has
+// gone. One thread may send on a connection while another receives on it.
+b32 ipc_send(void* connection, void* data, size bytes);
+b32 ipc_receive(void* connection, void* data, size bytes);
+
+// Returns true once something can be received without blocking, or the other side has gone, waiting at most
+// timeout_ms
+b32 ipc_wait(void* connection, u32 timeout_ms);
+
+// A path for name in a directory that belongs to the user, for files that go with a server. Returns the length, or
+// 0 if it doesn't fit.
+size ipc_runtime_path(char* name, char* buffer, size capacity);
+
+b32 shared_memory_create(SharedMemory* memory, char* name, size bytes); // Zeroed. Replaces a leftover of the name.
+b32 shared_memory_open(SharedMemory* memory, char* name, size bytes);
+void shared_memory_unlink(char* name);
+void shared_memory_unlink_all(char* prefix); // Every name that starts with prefix, as left by a process that died
+void shared_memory_close(SharedMemory* memory);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,56 +1,209 @@
 #include "grapple_math.h"
+#include "profiler.h"
 #include "types.h"
 #include "str.h"
 
 #include "grapple_memory.c"
+#include "timer.c"
+#include "profiler.c"
+#include "inflate.c"
 #include "input.c"
 #include "window.c"
 #include "renderer/renderer.c"
 #include "renderer/texture.c"
+#include "renderer/thumbnail.c"
+#include "thread.c"
+#include "channel.c"
+#include "ipc.c"
+#include "zstd.c"
+#include "search/search.c"
+#include "search/ignore.c"
+#include "search/walk.c"
+#include "search/fuzzy.c"
+#include "search/snapshot.c"
+#include "search/query.c"
+#include "search/replace.c"
+#include "search/daemon.c"
+#include "search/search_cli.c"
 
-int main(void)
+#include <string.h> // strcmp
+
+#define ICON_DRAW_LIST_COUNT 8
+
+typedef struct
+{
+    DrawList* list;
+    Renderer* renderer;
+    Texture* texture;
+    QuadsSoA quads;
+    size count;
+} IconDrawJob;
+
+internal void icon_draw_job(void* data)
 {
+    PROFILE_FUNCTION_BEGIN();
+    IconDrawJob* job = (IconDrawJob*)data;
+    draw_list_quads(job->list, job->texture, job->quads, job->count, 0, 0);
+    renderer_submit_draw_list(job->renderer, job->list);
+    PROFILE_FUNCTION_END();
+}
+
+int main(int argc, char** argv)
+{
+    // NOTE(lucas): "grapple search ..." and "grapple replace ..." run from the command line without opening a window
+    if (argc > 1 && strcmp(argv[1], "search") == 0)
+        return search_cli_main(argc - 2, argv + 2);
+    if (argc > 1 && strcmp(argv[1], "replace") == 0)
+        return search_cli_replace_main(argc - 2, argv + 2);
+    // "grapple daemon ..." keeps a tree's search state warm for "grapple search --daemon"
+    if (argc > 1 && strcmp(argv[1], "daemon") == 0)
+        return daemon_main(argc - 2, argv + 2);
+    // "grapple files QUERY ..." is go-to-file: the paths whose names best match QUERY as a fuzzy pattern
+    if (argc > 1 && strcmp(argv[1], "files") == 0)
+        return fuzzy_main(argc - 2, argv + 2);
+
+    PROFILE_INIT();
+
+    // NOTE(lucas): By default a frame is only drawn when something is damaged, and the loop otherwise sleeps in
+    // input_wait. --continuous redraws everything every vsync, which is useful for measuring the worst case.
+    // --capture FILE records every renderer call for grapple_replay.
+    b32 continuous = false;
+    char* capture_filename = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--continuous") == 0)
+            continuous = true;
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+            capture_filename = argv[++i];
+    }
+
+    if (capture_filename && !capture_begin(capture_filename))
+        capture_filename = 0;
+
     int window_width = 800;
     int window_height = 600;
     Window* window = window_create("Grapple", window_width, window_height);
 
     Arena arena = arena_alloc(MEGABYTES(10));
     Arena scratch_arena = arena_alloc(KILOBYTES(4));
+    arena_register(&arena, "main");
+    arena_register(&scratch_arena, "frame_scratch");
 
     Renderer* renderer = renderer_create(window, &arena);
 
     m4 proj = ortho_top_left((f32)window_width, (f32)window_height);
     renderer_set_projection(renderer, proj);
-    Texture texture = texture_load_from_file("res/icons/magnifying_glass.bmp", renderer, &arena);
+    Texture texture = texture_load_from_file("res/icons/magnifying_glass.png", renderer, &arena);
+
+    // Icon grid for the demo scene, kept in SoA form for the batched quad path
+    v2 icon_positions[] = {v2(150.0f, 50.0f), v2(200.0f, 50.0f), v2(150.0f, 100.0f), v2(200.0f, 100.0f)};
+    size icon_count = 8000;
+    QuadsSoA icons = quads_soa_alloc(&arena, icon_count);
+    for (size i = 0; i < icon_count; ++i)
+    {
+        v2 pos = icon_positions[i % countof(icon_positions)];
+        icons.x[i] = pos.x;
+        icons.y[i] = pos.y;
+        icons.w[i] = 32.0f;
+        icons.h[i] = 32.0f;
+        icons.u0[i] = 0.0f;
+        icons.v0[i] = 1.0f;
+        icons.u1[i] = 1.0f;
+        icons.v1[i] = 0.0f;
+    }
+
+    // NOTE(lucas): The icons are split across draw lists that worker threads record in parallel. The lists are
+    // merged in order at the end of the frame, so the result is the same as drawing them on this thread.
+    u32 processor_count = thread_get_processor_count();
+    WorkQueue* work_queue = work_queue_create(&arena, processor_count > 1 ? processor_count - 1 : 1);
+    IconDrawJob icon_jobs[ICON_DRAW_LIST_COUNT];
+    size icons_per_job = (icon_count + ICON_DRAW_LIST_COUNT - 1) / ICON_DRAW_LIST_COUNT;
+    for (u32 i = 0; i < ICON_DRAW_LIST_COUNT; ++i)
+    {
+        size first = i*icons_per_job;
+        size count = (first + icons_per_job <= icon_count) ? icons_per_job : icon_count - first;
+
+        IconDrawJob* job = &icon_jobs[i];
+        job->list = draw_list_create(&arena, (u32)icons_per_job, 4);
+        job->renderer = renderer;
+        job->texture = &texture;
+        job->quads = quads_soa_offset(icons, first);
+        job->count = count;
+    }
+
+    u64 os_frequency = timer_get_os_frequency();
+    f32 frame_work_ms = 0.0f; // Time spent producing the last frame, not counting the wait for input
+    u32 redraw_count = 0;
+    i32 last_quad_count = 0; // Draw lists are merged in renderer_end_frame, so the overlay shows last frame's counts
+    i32 last_batch_count = 0;
+    rect overlay_rect = rect_min_dim(v2_zero(), v2(200.0f, 100.0f));
 
     while (window->open)
     {
-        input_process(window);
+        b32 idle = !continuous && !window->needs_redraw && !renderer_has_damage(renderer);
+        if (idle)
+        {
+            input_wait(window, INPUT_WAIT_FOREVER);
+        }
+        else
+        {
+            PROFILE_BEGIN("input_process");
+            input_process(window);
+            PROFILE_END("input_process");
+        }
 
         if (!window->open)
             break;
 
+        if (continuous || window->needs_redraw)
+        {
+            renderer_invalidate_all(renderer);
+            window->needs_redraw = false;
+        }
+
+        if (!renderer_has_damage(renderer))
+            continue;
+
+        u64 frame_start_ticks = timer_get_os_ticks();
         arena_clear(&scratch_arena);
         f32 delta_time = get_frame_seconds(window);
+        ++redraw_count;
+
+        // The overlay shows per-frame statistics, so it changes on every frame that gets drawn
+        renderer_invalidate(renderer, overlay_rect);
+#ifdef ARENA_STATS
+        Arena** arenas = 0;
+        u32 arena_count = arena_get_registered(&arenas);
+        v2 arena_overlay_pos = v2(240.0f, 0.0f); // Right of the icons
+        v2 arena_line_dim = v2(560.0f, 20.0f);
+        v2 arena_overlay_dim = v2(arena_line_dim.x, arena_line_dim.y*(f32)arena_count);
+        renderer_invalidate(renderer, rect_min_dim(arena_overlay_pos, arena_overlay_dim));
+#endif
+#ifdef GRAPPLE_PROFILE
+        renderer_invalidate(renderer, rect_min_dim(v2(0.0f, 260.0f), v2(400.0f, 20.0f*PROFILE_MAX_FRAME_ENTRIES)));
+#endif
 
         renderer_begin_frame(renderer, window);
         v4 clear_color = v4(0.125f, 0.125f, 0.125f, 1.0f);
         renderer_clear(renderer, clear_color);
 
-        v2 tex_size = v2_full(32.0f);
-        for (u32 i = 0; i < 2000; ++i)
+        PROFILE_BEGIN("draw_icons");
+        for (u32 i = 0; i < ICON_DRAW_LIST_COUNT; ++i)
         {
-            renderer_draw_texture(renderer, &texture, v2(150.0f, 50.0f),   tex_size);
-            renderer_draw_texture(renderer, &texture, v2(200.0f, 50.0f),  tex_size);
-            renderer_draw_texture(renderer, &texture, v2(150.0f, 100.0f),  tex_size);
-            renderer_draw_texture(renderer, &texture, v2(200.0f, 100.0f), tex_size);
+            draw_list_reset(icon_jobs[i].list, renderer, i);
+            work_queue_add(work_queue, icon_draw_job, &icon_jobs[i]);
         }
+        work_queue_complete_all(work_queue);
+        PROFILE_END("draw_icons");
+
+        PROFILE_BEGIN("draw_overlay");
 
         s8 batch_size_str = s8_format(&scratch_arena, "Batch size: %d", renderer->quads_per_batch);
-        s8 quad_count_str = s8_format(&scratch_arena, "Num quads: %d", renderer->total_quads);
-        s8 batch_count_str = s8_format(&scratch_arena, "Num batches: %d", renderer->batch_count);
-        s8 frame_ms_str = s8_format(&scratch_arena, "Frame time: %.2fms", delta_time*1000.0f);
-        s8 fps_str = s8_format(&scratch_arena, "FPS: %u", (u32)(1.0f/delta_time));
+        s8 quad_count_str = s8_format(&scratch_arena, "Num quads: %d", last_quad_count);
+        s8 batch_count_str = s8_format(&scratch_arena, "Num batches: %d", last_batch_count);
+        s8 frame_ms_str = s8_format(&scratch_arena, "Frame time: %.2fms", frame_work_ms);
+        s8 fps_str = continuous ? s8_format(&scratch_arena, "FPS: %u", (u32)(1.0f/delta_time)) :
+                                  s8_format(&scratch_arena, "Redraws: %u", redraw_count);
 
         v4 text_color = color_white();
         v2 text_bounds = v2_full(200.0f);
@@ -63,9 +216,59 @@ int main(void)
 
         text_draw(renderer, s8("Hello, Direct2D! αβγδεζηθ"), v2_full(200.0f), text_bounds, text_color);
 
+#ifdef ARENA_STATS
+        // Arena usage, so arenas can be sized from what they actually need
+        for (u32 i = 0; i < arena_count; ++i)
+        {
+            s8 arena_str = arena_format_stats(&scratch_arena, arenas[i]);
+            v2 pos = v2(arena_overlay_pos.x, arena_overlay_pos.y + arena_line_dim.y*(f32)i);
+            text_draw(renderer, arena_str, pos, arena_line_dim, text_color);
+        }
+#endif
+
+#ifdef GRAPPLE_PROFILE
+        // Breakdown of the previous frame
+        ProfileFrame* profile_frame = profiler_get_last_frame();
+        v2 profile_bounds = v2(400.0f, 20.0f);
+        f32 profile_y = 260.0f;
+        for (u32 i = 0; i < profile_frame->entry_count; ++i)
+        {
+            ProfileFrameEntry* entry = &profile_frame->entries[i];
+            s8 entry_str = s8_format(&scratch_arena, "%*s%s: %.3fms (self %.3fms) x%u", (int)entry->depth*2, "",
+                                     entry->name, profiler_ticks_to_ms(entry->inclusive_ticks),
+                                     profiler_ticks_to_ms(entry->exclusive_ticks), entry->calls);
+            text_draw(renderer, entry_str, v2(0.0f, profile_y), profile_bounds, text_color);
+            profile_y += 20.0f;
+        }
+#endif
+        PROFILE_END("draw_overlay");
+
+        PROFILE_BEGIN("end_frame");
         renderer_end_frame(renderer);
+        PROFILE_END("end_frame");
+        last_quad_count = renderer->total_quads;
+        last_batch_count = renderer->batch_count;
+
+        frame_work_ms = 1000.0f*(f32)(timer_get_os_ticks() - frame_start_ticks) / (f32)os_frequency;
+
+        PROFILE_FRAME_END();
     }
 
+#ifdef GRAPPLE_PROFILE
+    profiler_write_chrome_trace("grapple_trace.json");
+#endif
+
+    if (capture_filename && !capture_end())
+    {
+        char message[] = "The capture ran out of memory for its textures and stopped early\n";
+        file_write_stream(file_get_stderr(), message, sizeof(message) - 1);
+    }
+
+#ifdef ARENA_STATS
+    arena_clear(&scratch_arena);
+    arena_write_stats("grapple_arenas.txt", &scratch_arena);
+#endif
+
     renderer_destroy(renderer);
     return 0;
 }
@@ -0,0 +1,400 @@
+#include "file.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h> // rename, snprintf
+#include <stdlib.h> // mkstemp, realpath, free
+#include <string.h> // memcpy, strlen
+#include <sys/mman.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// NOTE(lucas): File handles are file descriptors offset by one, so that a null handle still means failure.
+internal inline int linux_fd_from_handle(void* file_handle)
+{
+    int result = (int)(intptr_t)file_handle - 1;
+    return result;
+}
+
+internal inline void* linux_handle_from_fd(int fd)
+{
+    void* result = (void*)(intptr_t)(fd + 1);
+    return result;
+}
+
+size file_get_size(char* filename)
+{
+    struct stat st;
+    if (stat(filename, &st) != 0)
+    {
+        // TODO(lucas): Log/handle error
+        return 0;
+    }
+    return (size)st.st_size;
+}
+
+b32 file_exists(char* filename)
+{
+    struct stat st;
+    b32 result = (stat(filename, &st) == 0 && !S_ISDIR(st.st_mode));
+    return result;
+}
+
+void* file_open(char* filename, FileMode mode)
+{
+    int flags = 0;
+    b32 read = (mode & FileMode_Read) != 0;
+    b32 write = (mode & (FileMode_Write|FileMode_Append|FileMode_Create)) != 0;
+    if (read && write)
+        flags = O_RDWR;
+    else if (write)
+        flags = O_WRONLY;
+    else
+        flags = O_RDONLY;
+
+    if (mode & FileMode_Write)
+        flags |= O_CREAT;
+    if (mode & FileMode_Append)
+        flags |= O_APPEND;
+    if (mode & FileMode_Create)
+        flags |= O_CREAT|O_TRUNC;
+
+    b32 private_mode = (mode & FileMode_Private) != 0;
+    int fd = open(filename, flags|O_CLOEXEC, private_mode ? 0600 : 0644);
+    ASSERT(fd >= 0, "open failed");
+    if (fd < 0)
+        return 0;
+
+    // A file that was already there keeps its permissions through O_TRUNC
+    if (private_mode)
+        fchmod(fd, 0600);
+
+    return linux_handle_from_fd(fd);
+}
+
+void file_close(void* file_handle)
+{
+    int closed = close(linux_fd_from_handle(file_handle));
+    ASSERT(closed == 0, "Failed to close file");
+    (void)closed;
+}
+
+b32 file_flush(void* file_handle)
+{
+    // The size is flushed along with the data, which is all a later read needs
+    return fdatasync(linux_fd_from_handle(file_handle)) == 0;
+}
+
+i64 file_seek(void* file_handle, i64 byte_offset, FileSeekMethod seek_method)
+{
+    ASSERT(file_handle, "Invalid file handle");
+
+    int whence = SEEK_SET;
+    switch (seek_method)
+    {
+        case FileSeek_Begin:   whence = SEEK_SET; break;
+        case FileSeek_Current: whence = SEEK_CUR; break;
+        case FileSeek_End:     whence = SEEK_END; break;
+        default: ASSERTF(0, "Invalid file seek method: %d", seek_method); break;
+    }
+
+    off_t result = lseek(linux_fd_from_handle(file_handle), (off_t)byte_offset, whence);
+    ASSERTF(result >= 0, "Failed to move file pointer %lld bytes using seek method %d",
+            (long long)byte_offset, seek_method);
+    return (i64)result;
+}
+
+i64 file_seek_begin(void* file_handle)
+{
+    return file_seek(file_handle, 0, FileSeek_Begin);
+}
+
+i64 file_seek_end(void* file_handle)
+{
+    return file_seek(file_handle, 0, FileSeek_End);
+}
+
+int file_read(void* file_handle, void* buffer, size num_bytes_to_read)
+{
+    ASSERT(file_handle, "Invalid file handle");
+    int fd = linux_fd_from_handle(file_handle);
+
+    // read() may return fewer bytes than requested, so keep going until EOF or an error
+    size num_bytes_read = 0;
+    while (num_bytes_read < num_bytes_to_read)
+    {
+        ssize_t result = read(fd, (u8*)buffer + num_bytes_read, (usize)(num_bytes_to_read - num_bytes_read));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            break;
+        num_bytes_read += result;
+    }
+    ASSERTF(num_bytes_read == num_bytes_to_read, "Number of bytes read (%lld) does not match expected (%lld)",
+            (long long)num_bytes_read, (long long)num_bytes_to_read);
+
+    return (int)num_bytes_read;
+}
+
+void* file_open_read(char* filename)
+{
+    int fd = open(filename, O_RDONLY|O_CLOEXEC);
+    if (fd < 0)
+        return 0;
+    return linux_handle_from_fd(fd);
+}
+
+size file_read_stream(void* file_handle, void* buffer, size num_bytes_to_read)
+{
+    int fd = linux_fd_from_handle(file_handle);
+    size num_bytes_read = 0;
+    while (num_bytes_read < num_bytes_to_read)
+    {
+        ssize_t result = read(fd, (u8*)buffer + num_bytes_read, (usize)(num_bytes_to_read - num_bytes_read));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            break;
+        num_bytes_read += result;
+    }
+    return num_bytes_read;
+}
+
+int file_write(void* file_handle, void* buffer, size num_bytes_to_write)
+{
+    ASSERT(file_handle, "Invalid file handle");
+    int fd = linux_fd_from_handle(file_handle);
+
+    size num_bytes_written = 0;
+    while (num_bytes_written < num_bytes_to_write)
+    {
+        ssize_t result = write(fd, (u8*)buffer + num_bytes_written,
+                               (usize)(num_bytes_to_write - num_bytes_written));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            break;
+        num_bytes_written += result;
+    }
+    ASSERTF(num_bytes_written == num_bytes_to_write, "Number of bytes written (%lld) does not match expected (%lld)",
+            (long long)num_bytes_written, (long long)num_bytes_to_write);
+
+    return (int)num_bytes_written;
+}
+
+void* file_get_stdout(void)
+{
+    // A write to a closed pipe should fail with EPIPE instead of killing the process
+    signal(SIGPIPE, SIG_IGN);
+    return linux_handle_from_fd(STDOUT_FILENO);
+}
+
+void* file_get_stderr(void)
+{
+    return linux_handle_from_fd(STDERR_FILENO);
+}
+
+b32 file_write_stream(void* file_handle, void* buffer, size num_bytes_to_write)
+{
+    int fd = linux_fd_from_handle(file_handle);
+    size num_bytes_written = 0;
+    while (num_bytes_written < num_bytes_to_write)
+    {
+        ssize_t result = write(fd, (u8*)buffer + num_bytes_written,
+                               (usize)(num_bytes_to_write - num_bytes_written));
+        if (result < 0 && errno == EINTR)
+            continue;
+        if (result <= 0)
+            return false;
+        num_bytes_written += result;
+    }
+    return true;
+}
+
+FileMapping file_map(char* filename)
+{
+    FileMapping result = {0};
+    int fd = open(filename, O_RDONLY|O_CLOEXEC);
+    if (fd < 0)
+        return result;
+
+    // The mapping keeps its own reference to the file, so the descriptor can be closed straight away
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void* data = mmap(0, (usize)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            // Mapped files are almost always read front to back, so ask for aggressive read-ahead
+            madvise(data, (usize)st.st_size, MADV_SEQUENTIAL);
+            result.data = (u8*)data;
+            result.size = (size)st.st_size;
+        }
+    }
+    close(fd);
+    return result;
+}
+
+void file_unmap(FileMapping* mapping)
+{
+    if (mapping->data)
+    {
+        int unmapped = munmap(mapping->data, (usize)mapping->size);
+        ASSERT(unmapped == 0, "Failed to unmap file");
+        (void)unmapped;
+    }
+    mapping->data = 0;
+    mapping->size = 0;
+}
+
+b32 file_list_directory(char* path, FileEntryCallback* visit, void* data)
+{
+    DIR* dir = opendir(path);
+    if (!dir)
+        return false;
+
+    struct dirent* dirent;
+    while ((dirent = readdir(dir)) != 0)
+    {
+        char* name = dirent->d_name;
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+            continue;
+
+        FileEntry entry;
+        entry.name = name;
+        entry.name_length = (size)strlen(name);
+
+        // Some file systems don't fill in d_type, so fall back to asking, without following links
+        unsigned char type = dirent->d_type;
+        if (type == DT_UNKNOWN)
+        {
+            struct stat st;
+            if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+                type = S_ISREG(st.st_mode) ? DT_REG : S_ISDIR(st.st_mode) ? DT_DIR : DT_LNK;
+        }
+        entry.kind = (type == DT_REG) ? FileEntryKind_File :
+                     (type == DT_DIR) ? FileEntryKind_Directory : FileEntryKind_Other;
+        visit(&entry, data);
+    }
+
+    closedir(dir);
+    return true;
+}
+
+b32 file_get_info(char* path, FileInfo* info)
+{
+    struct stat st;
+    if (lstat(path, &st) != 0)
+        return false;
+
+    info->size = (u64)st.st_size;
+    info->modified = (u64)st.st_mtim.tv_sec*1000000000ull + (u64)st.st_mtim.tv_nsec;
+    info->id = (u64)st.st_ino;
+    if (S_ISREG(st.st_mode))
+        info->kind = FileEntryKind_File;
+    else if (S_ISDIR(st.st_mode))
+        info->kind = FileEntryKind_Directory;
+    else
+        info->kind = FileEntryKind_Other;
+    return true;
+}
+
+b32 file_replace(char* from, char* to)
+{
+    return rename(from, to) == 0;
+}
+
+b32 file_delete(char* filename)
+{
+    return unlink(filename) == 0;
+}
+
+void* file_create_beside(char* filename, char* buffer, size capacity)
+{
+    struct stat st;
+    int length = snprintf(buffer, (usize)capacity, "%s.grapple-XXXXXX", filename);
+    if (length <= 0 || (size)length >= capacity || stat(filename, &st) != 0)
+        return 0;
+
+    // mkstemp makes the file readable and writable by its owner alone
+    int fd = mkstemp(buffer);
+    if (fd < 0)
+        return 0;
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fchmod(fd, st.st_mode & 07777);
+    return linux_handle_from_fd(fd);
+}
+
+b32 file_copy_range(void* from, u64 offset, void* to, u64 bytes)
+{
+    /*
+     * NOTE(lucas): copy_file_range can share the blocks on file systems that do copy on write, and sendfile still
+     * copies inside the kernel on the ones that don't. Either can refuse, across file systems or on older kernels,
+     * and then it falls back to the next, down to reading and writing through a buffer.
+     */
+    int in = linux_fd_from_handle(from);
+    int out = linux_fd_from_handle(to);
+    int method = 0;
+#ifndef SYS_copy_file_range
+    method = 1;
+#endif
+    while (bytes > 0)
+    {
+        usize piece = (bytes < (u64)MEGABYTES(512)) ? (usize)bytes : (usize)MEGABYTES(512);
+        ssize_t copied = -1;
+        if (method == 0)
+        {
+#ifdef SYS_copy_file_range
+            i64 position = (i64)offset;
+            copied = (ssize_t)syscall(SYS_copy_file_range, in, &position, out, NULL, piece, 0u);
+#endif
+        }
+        else if (method == 1)
+        {
+            off_t position = (off_t)offset;
+            copied = sendfile(out, in, &position, piece);
+        }
+        else
+        {
+            u8 buffer[KILOBYTES(64)];
+            copied = pread(in, buffer, (piece < sizeof(buffer)) ? piece : sizeof(buffer), (off_t)offset);
+            if (copied > 0 && !file_write_stream(to, buffer, (size)copied))
+                return false;
+        }
+
+        if (copied < 0 && errno == EINTR)
+            continue;
+        if (copied < 0 && method < 2 &&
+            (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP))
+        {
+            ++method;
+            continue;
+        }
+        if (copied <= 0)
+            return false;
+        offset += (u64)copied;
+        bytes -= (u64)copied;
+    }
+    return true;
+}
+
+size file_get_full_path(char* path, char* buffer, size capacity)
+{
+    size result = 0;
+    char* full = realpath(path, 0);
+    if (full)
+    {
+        size length = (size)strlen(full);
+        if (length < capacity)
+        {
+            memcpy(buffer, full, (usize)length + 1);
+            result = length;
+        }
+        free(full);
+    }
+    return result;
+}
@@ -0,0 +1,278 @@
+#include "ipc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h> // snprintf
+#include <stdlib.h> // getenv
+#include <string.h> // memcpy, memset, strlen, strncmp
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// NOTE(lucas): Connections are file descriptors offset by one, like file handles, so that a null one means failure
+internal inline int linux_fd_from_connection(void* connection)
+{
+    int result = (int)(intptr_t)connection - 1;
+    return result;
+}
+
+internal inline void* linux_connection_from_fd(int fd)
+{
+    void* result = (void*)(intptr_t)(fd + 1);
+    return result;
+}
+
+size ipc_runtime_path(char* name, char* buffer, size capacity)
+{
+    char* directory = getenv("XDG_RUNTIME_DIR");
+    int length = 0;
+    if (directory && directory[0])
+        length = snprintf(buffer, (usize)capacity, "%s/%s", directory, name);
+    else
+        length = snprintf(buffer, (usize)capacity, "/tmp/%s-%u", name, (unsigned)getuid());
+    return (length > 0 && (size)length < capacity) ? (size)length : 0;
+}
+
+internal b32 linux_socket_address(char* name, struct sockaddr_un* address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    char path[IPC_MAX_PATH];
+    size length = ipc_runtime_path(name, path, sizeof(path));
+    if (length == 0 || length >= (size)sizeof(address->sun_path))
+        return false;
+    memcpy(address->sun_path, path, (usize)length + 1);
+    return true;
+}
+
+void* ipc_listen(char* name)
+{
+    struct sockaddr_un address;
+    if (!linux_socket_address(name, &address))
+        return 0;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return 0;
+
+    // A socket that nobody answers on was left by a server that died, and binding fails while it is there
+    int connected = -1;
+    int probe = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if (probe >= 0)
+    {
+        connected = connect(probe, (struct sockaddr*)&address, sizeof(address));
+        close(probe);
+    }
+    if (connected == 0)
+    {
+        close(fd);
+        return 0;
+    }
+    unlink(address.sun_path);
+
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 16) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    return linux_connection_from_fd(fd);
+}
+
+void* ipc_accept(void* listener)
+{
+    int fd = -1;
+    do
+    {
+        fd = accept(linux_fd_from_connection(listener), 0, 0);
+    } while (fd < 0 && (errno == EINTR || errno == ECONNABORTED));
+    return (fd >= 0) ? linux_connection_from_fd(fd) : 0;
+}
+
+void* ipc_connect(char* name)
+{
+    struct sockaddr_un address;
+    if (!linux_socket_address(name, &address))
+        return 0;
+
+    int fd = socket(AF_UNIX, SOCK_STREAM|SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return 0;
+    if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    return linux_connection_from_fd(fd);
+}
+
+void ipc_close(void* connection)
+{
+    if (connection)
+        close(linux_fd_from_connection(connection));
+}
+
+void ipc_unlink(char* name)
+{
+    struct sockaddr_un address;
+    if (linux_socket_address(name, &address))
+        unlink(address.sun_path);
+}
+
+global volatile u32* linux_interrupted;
+global Semaphore* linux_interrupt_wake;
+
+// sem_post is one of the few calls that are safe in a signal handler
+internal void linux_interrupt_handler(int signal_number)
+{
+    *linux_interrupted = 1;
+    semaphore_signal(linux_interrupt_wake);
+    (void)signal_number;
+}
+
+void ipc_catch_interrupt(volatile u32* interrupted, Semaphore* wake)
+{
+    linux_interrupted = interrupted;
+    linux_interrupt_wake = wake;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = linux_interrupt_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, 0);
+    sigaction(SIGTERM, &action, 0);
+    sigaction(SIGHUP, &action, 0);
+}
+
+b32 ipc_send(void* connection, void* data, size bytes)
+{
+    int fd = linux_fd_from_connection(connection);
+    u8* at = (u8*)data;
+    while (bytes > 0)
+    {
+        // MSG_NOSIGNAL, since a client that went away shouldn't take the server with it
+        ssize_t sent = send(fd, at, (usize)bytes, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        at += sent;
+        bytes -= (size)sent;
+    }
+    return true;
+}
+
+b32 ipc_receive(void* connection, void* data, size bytes)
+{
+    int fd = linux_fd_from_connection(connection);
+    u8* at = (u8*)data;
+    while (bytes > 0)
+    {
+        ssize_t received = recv(fd, at, (usize)bytes, 0);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        at += received;
+        bytes -= (size)received;
+    }
+    return true;
+}
+
+b32 ipc_wait(void* connection, u32 timeout_ms)
+{
+    struct pollfd poll_fd = {0};
+    poll_fd.fd = linux_fd_from_connection(connection);
+    poll_fd.events = POLLIN;
+    int ready = poll(&poll_fd, 1, (int)timeout_ms);
+    return ready > 0;
+}
+
+//
+// Shared memory
+//
+
+internal b32 linux_shared_memory_map(SharedMemory* memory, int fd, size bytes)
+{
+    void* data = mmap(NULL, (usize)bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    memory->handle = 0;
+    memory->data = (u8*)data;
+    memory->bytes = bytes;
+    return true;
+}
+
+b32 shared_memory_create(SharedMemory* memory, char* name, size bytes)
+{
+    zero_struct(*memory);
+    char path[IPC_MAX_NAME + 1];
+    snprintf(path, sizeof(path), "/%s", name);
+    shm_unlink(path);
+
+    int fd = shm_open(path, O_CREAT|O_EXCL|O_RDWR|O_CLOEXEC, 0600);
+    if (fd < 0)
+        return false;
+    if (ftruncate(fd, (off_t)bytes) != 0)
+    {
+        close(fd);
+        shm_unlink(path);
+        return false;
+    }
+    return linux_shared_memory_map(memory, fd, bytes);
+}
+
+b32 shared_memory_open(SharedMemory* memory, char* name, size bytes)
+{
+    zero_struct(*memory);
+    char path[IPC_MAX_NAME + 1];
+    snprintf(path, sizeof(path), "/%s", name);
+
+    int fd = shm_open(path, O_RDWR|O_CLOEXEC, 0);
+    struct stat st;
+    if (fd < 0)
+        return false;
+    if (fstat(fd, &st) != 0 || (size)st.st_size < bytes)
+    {
+        close(fd);
+        return false;
+    }
+    return linux_shared_memory_map(memory, fd, bytes);
+}
+
+void shared_memory_unlink(char* name)
+{
+    char path[IPC_MAX_NAME + 1];
+    snprintf(path, sizeof(path), "/%s", name);
+    shm_unlink(path);
+}
+
+void shared_memory_unlink_all(char* prefix)
+{
+    // NOTE(lucas): glibc keeps shared memory in /dev/shm, under the name without its leading slash
+    DIR* dir = opendir("/dev/shm");
+    if (!dir)
+        return;
+    size prefix_length = (size)strlen(prefix);
+    struct dirent* dirent;
+    while ((dirent = readdir(dir)) != 0)
+    {
+        if (strncmp(dirent->d_name, prefix, (usize)prefix_length) == 0 && strlen(dirent->d_name) < IPC_MAX_NAME)
+            shared_memory_unlink(dirent->d_name);
+    }
+    closedir(dir);
+}
+
+void shared_memory_close(SharedMemory* memory)
+{
+    if (memory->data)
+        munmap(memory->data, (usize)memory->bytes);
+    zero_struct(*memory);
+}
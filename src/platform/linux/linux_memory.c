@@ -0,0 +1,16 @@
+#include "grapple_memory.h"
+
+#include <sys/mman.h>
+
+Arena arena_alloc(size bytes)
+{
+    Arena arena = {0};
+    arena.used = 0;
+    void* data = mmap(NULL, (usize)bytes, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (data != MAP_FAILED)
+    {
+        arena.data = (u8*)data;
+        arena.bytes = bytes;
+    }
+    return arena;
+}
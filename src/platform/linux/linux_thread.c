@@ -0,0 +1,76 @@
+#include "thread.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdlib.h> // malloc, free
+#include <time.h> // nanosleep
+#include <unistd.h>
+
+typedef struct
+{
+    ThreadProc* proc;
+    void* data;
+} LinuxThreadStart;
+
+u32 thread_get_processor_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (u32)count : 1;
+}
+
+internal void* linux_thread_proc(void* param)
+{
+    LinuxThreadStart start = *(LinuxThreadStart*)param;
+    free(param);
+    start.proc(start.data);
+    return 0;
+}
+
+b32 thread_create(ThreadProc* proc, void* data)
+{
+    // TODO(lucas): Replace malloc. The start block has to outlive this call, so it can't live on the stack.
+    LinuxThreadStart* start = (LinuxThreadStart*)malloc(sizeof(LinuxThreadStart));
+    if (!start)
+        return false;
+    start->proc = proc;
+    start->data = data;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, linux_thread_proc, start) != 0)
+    {
+        free(start);
+        return false;
+    }
+
+    pthread_detach(thread);
+    return true;
+}
+
+void thread_sleep(u32 milliseconds)
+{
+    struct timespec duration = {(time_t)(milliseconds/1000), (long)(milliseconds % 1000)*1000000L};
+    while (nanosleep(&duration, &duration) != 0 && errno == EINTR)
+        ;
+}
+
+Semaphore* semaphore_create(Arena* arena, u32 initial_count)
+{
+    // NOTE(lucas): A misaligned sem_t makes sem_wait fail with EINVAL straight away, and every thread waiting on it
+    // spins instead of sleeping
+    arena_align(arena, 16);
+    sem_t* semaphore = push_struct(arena, sem_t);
+    sem_init(semaphore, 0, initial_count);
+    return (Semaphore*)semaphore;
+}
+
+void semaphore_wait(Semaphore* semaphore)
+{
+    while (sem_wait((sem_t*)semaphore) != 0 && errno == EINTR)
+        ;
+}
+
+void semaphore_signal(Semaphore* semaphore)
+{
+    sem_post((sem_t*)semaphore);
+}
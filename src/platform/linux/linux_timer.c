@@ -0,0 +1,16 @@
+#include "timer.h"
+
+#include <time.h>
+
+u64 timer_get_os_ticks(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    u64 result = (u64)ts.tv_sec*1000000000ull + (u64)ts.tv_nsec;
+    return result;
+}
+
+u64 timer_get_os_frequency(void)
+{
+    return 1000000000ull;
+}
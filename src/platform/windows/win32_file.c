@@ -3,11 +3,14 @@
 
 #include <windows.h>
 
+#include <stdio.h> // snprintf
 #include <stdlib.h> // malloc, free
+#include <string.h> // strlen
 
 HANDLE file_open_normal_read(char* filename)
 {
-    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
     return file;
 }
 
@@ -55,8 +58,18 @@ void* file_open(char* filename, FileMode mode)
         file_access |= FILE_APPEND_DATA;
         file_share |= FILE_SHARE_READ;
     }
+    // Reading alone shouldn't stop anyone else from writing, renaming or deleting the file
+    if (mode == FileMode_Read)
+        file_share |= FILE_SHARE_WRITE|FILE_SHARE_DELETE;
     if ((mode & FileMode_Write) && !file_exists(filename))
         creation_disposition = CREATE_NEW;
+    if (mode & FileMode_Create)
+    {
+        file_access |= GENERIC_WRITE;
+        creation_disposition = CREATE_ALWAYS;
+    }
+    // FileMode_Private needs nothing here. New files take the permissions of their directory, and the private files
+    // are all written to the user's own temporary directory.
 
     HANDLE file = CreateFileA(filename, file_access, file_share, NULL, creation_disposition, FILE_ATTRIBUTE_NORMAL, NULL);
     ASSERT(file != INVALID_HANDLE_VALUE, "CreateFileA failed");
@@ -81,6 +94,11 @@ void file_close(void* file_handle)
     }
 }
 
+b32 file_flush(void* file_handle)
+{
+    return FlushFileBuffers(file_handle) != 0;
+}
+
 char* get_filename(void* file_handle)
 {
     ASSERT(file_handle != INVALID_HANDLE_VALUE, "Invalid file handle");
@@ -178,3 +196,270 @@ int file_read(void* file_handle, void* buffer, size num_bytes_to_read)
 
     return num_bytes_read;
 }
+
+void* file_open_read(char* filename)
+{
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+    return file;
+}
+
+size file_read_stream(void* file_handle, void* buffer, size num_bytes_to_read)
+{
+    size num_bytes_read = 0;
+    while (num_bytes_read < num_bytes_to_read)
+    {
+        size remaining = num_bytes_to_read - num_bytes_read;
+        DWORD wanted = (remaining > (size)MEGABYTES(64)) ? (DWORD)MEGABYTES(64) : (DWORD)remaining;
+        DWORD got = 0;
+        if (!ReadFile(file_handle, (u8*)buffer + num_bytes_read, wanted, &got, NULL) || got == 0)
+            break;
+        num_bytes_read += got;
+    }
+    return num_bytes_read;
+}
+
+int file_write(void* file_handle, void* buffer, size num_bytes_to_write)
+{
+    ASSERT(file_handle, "Invalid file handle");
+    DWORD num_bytes_written = 0;
+    b32 success = WriteFile(file_handle, buffer, (u32)num_bytes_to_write, &num_bytes_written, NULL);
+    if (success == FALSE)
+    {
+        char* filename = get_filename(file_handle);
+        ASSERTF(0, "Failed to write to file %s", filename);
+        free(filename);
+        win32_error_callback();
+    }
+    if (num_bytes_written != num_bytes_to_write)
+    {
+        char* filename = get_filename(file_handle);
+        ASSERTF(0, "Number of bytes written (%u) does not match expected number of bytes (%u) in file %s",
+                 num_bytes_written, num_bytes_to_write, filename);
+        free(filename);
+        win32_error_callback();
+    }
+
+    return num_bytes_written;
+}
+
+FileMapping file_map(char* filename)
+{
+    FileMapping result = {0};
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL|FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return result;
+
+    // The view keeps the file and the mapping object alive, so both handles can be closed straight away
+    LARGE_INTEGER file_size = {0};
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+    {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping)
+        {
+            void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (data)
+            {
+                result.data = (u8*)data;
+                result.size = (size)file_size.QuadPart;
+            }
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    return result;
+}
+
+void file_unmap(FileMapping* mapping)
+{
+    if (mapping->data)
+    {
+        BOOL unmapped = UnmapViewOfFile(mapping->data);
+        ASSERT(unmapped, "Failed to unmap file");
+        (void)unmapped;
+    }
+    mapping->data = 0;
+    mapping->size = 0;
+}
+
+b32 file_list_directory(char* path, FileEntryCallback* visit, void* data)
+{
+    char pattern[MAX_PATH];
+    int pattern_length = snprintf(pattern, sizeof(pattern), "%s\\*", path);
+    if (pattern_length < 0 || pattern_length >= (int)sizeof(pattern))
+        return false;
+
+    // Basic info skips the 8.3 short names, and large fetches ask for more entries per call
+    WIN32_FIND_DATAA find_data;
+    HANDLE find = FindFirstFileExA(pattern, FindExInfoBasic, &find_data, FindExSearchNameMatch, NULL,
+                                   FIND_FIRST_EX_LARGE_FETCH);
+    if (find == INVALID_HANDLE_VALUE)
+        return false;
+
+    do
+    {
+        char* name = find_data.cFileName;
+        if (name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0)))
+            continue;
+
+        FileEntry entry;
+        entry.name = name;
+        entry.name_length = (size)strlen(name);
+        DWORD attributes = find_data.dwFileAttributes;
+        if (attributes & (FILE_ATTRIBUTE_REPARSE_POINT|FILE_ATTRIBUTE_DEVICE))
+            entry.kind = FileEntryKind_Other;
+        else if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+            entry.kind = FileEntryKind_Directory;
+        else
+            entry.kind = FileEntryKind_File;
+        visit(&entry, data);
+    } while (FindNextFileA(find, &find_data));
+
+    FindClose(find);
+    return true;
+}
+
+// NOTE(lucas): The GUI subsystem starts without a console. Redirected output still comes with a handle, and
+// otherwise the console of whatever started us is borrowed, if there is one.
+internal void* win32_get_std_handle(DWORD which)
+{
+    HANDLE handle = GetStdHandle(which);
+    if (!handle || handle == INVALID_HANDLE_VALUE)
+    {
+        AttachConsole(ATTACH_PARENT_PROCESS);
+        handle = GetStdHandle(which);
+        if (!handle || handle == INVALID_HANDLE_VALUE)
+            handle = CreateFileA("CONOUT$", GENERIC_WRITE, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+                                 0, NULL);
+    }
+    return (handle == INVALID_HANDLE_VALUE) ? 0 : handle;
+}
+
+void* file_get_stdout(void)
+{
+    return win32_get_std_handle(STD_OUTPUT_HANDLE);
+}
+
+void* file_get_stderr(void)
+{
+    return win32_get_std_handle(STD_ERROR_HANDLE);
+}
+
+b32 file_write_stream(void* file_handle, void* buffer, size num_bytes_to_write)
+{
+    if (!file_handle)
+        return false;
+
+    size num_bytes_written = 0;
+    while (num_bytes_written < num_bytes_to_write)
+    {
+        size remaining = num_bytes_to_write - num_bytes_written;
+        DWORD wanted = (remaining > (size)MEGABYTES(64)) ? (DWORD)MEGABYTES(64) : (DWORD)remaining;
+        DWORD written = 0;
+        if (!WriteFile(file_handle, (u8*)buffer + num_bytes_written, wanted, &written, NULL) || written == 0)
+            return false;
+        num_bytes_written += written;
+    }
+    return true;
+}
+
+b32 file_get_info(char* path, FileInfo* info)
+{
+    // No access rights are needed to read the metadata. Backup semantics let directories be opened at all.
+    HANDLE file = CreateFileA(path, 0, FILE_SHARE_READ|FILE_SHARE_WRITE|FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                              FILE_FLAG_BACKUP_SEMANTICS|FILE_FLAG_OPEN_REPARSE_POINT, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    BY_HANDLE_FILE_INFORMATION file_info;
+    b32 result = GetFileInformationByHandle(file, &file_info) != 0;
+    CloseHandle(file);
+    if (!result)
+        return false;
+
+    DWORD attributes = file_info.dwFileAttributes;
+    info->size = ((u64)file_info.nFileSizeHigh << 32) | file_info.nFileSizeLow;
+    info->modified = ((u64)file_info.ftLastWriteTime.dwHighDateTime << 32) | file_info.ftLastWriteTime.dwLowDateTime;
+    info->id = ((u64)file_info.nFileIndexHigh << 32) | file_info.nFileIndexLow;
+    if (attributes & (FILE_ATTRIBUTE_REPARSE_POINT|FILE_ATTRIBUTE_DEVICE))
+        info->kind = FileEntryKind_Other;
+    else if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+        info->kind = FileEntryKind_Directory;
+    else
+        info->kind = FileEntryKind_File;
+    return true;
+}
+
+b32 file_replace(char* from, char* to)
+{
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+b32 file_delete(char* filename)
+{
+    return DeleteFileA(filename) != 0;
+}
+
+void* file_create_beside(char* filename, char* buffer, size capacity)
+{
+    DWORD attributes = GetFileAttributesA(filename);
+    if (attributes == INVALID_FILE_ATTRIBUTES || (attributes & FILE_ATTRIBUTE_DIRECTORY))
+        return 0;
+
+    // Read-only is left off, or the new file couldn't be written. A read-only file can't be replaced anyway.
+    attributes &= FILE_ATTRIBUTE_ARCHIVE|FILE_ATTRIBUTE_HIDDEN|FILE_ATTRIBUTE_NOT_CONTENT_INDEXED|FILE_ATTRIBUTE_SYSTEM;
+    for (u32 attempt = 0; attempt < 16; ++attempt)
+    {
+        int length = snprintf(buffer, (usize)capacity, "%s.grapple-%lu-%u", filename, GetCurrentProcessId(), attempt);
+        if (length <= 0 || (size)length >= capacity)
+            break;
+
+        HANDLE file = CreateFileA(buffer, GENERIC_WRITE, 0, NULL, CREATE_NEW,
+                                  attributes ? attributes : FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file != INVALID_HANDLE_VALUE)
+            return file;
+        if (GetLastError() != ERROR_FILE_EXISTS)
+            break;
+    }
+    return 0;
+}
+
+b32 file_copy_range(void* from, u64 offset, void* to, u64 bytes)
+{
+    // NOTE(lucas): There is no copying between handles in the kernel, so it goes through a buffer. Reading at an
+    // offset moves the position of a handle that isn't overlapped, so it is put back afterwards.
+    LARGE_INTEGER zero = {0};
+    LARGE_INTEGER position;
+    if (!SetFilePointerEx(from, zero, &position, FILE_CURRENT))
+        return false;
+
+    u8 buffer[KILOBYTES(64)];
+    b32 result = true;
+    while (result && bytes > 0)
+    {
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+        DWORD wanted = (bytes < sizeof(buffer)) ? (DWORD)bytes : (DWORD)sizeof(buffer);
+        DWORD got = 0;
+        result = ReadFile(from, buffer, wanted, &got, &overlapped) && got > 0 &&
+                 file_write_stream(to, buffer, (size)got);
+        offset += got;
+        bytes -= got;
+    }
+
+    SetFilePointerEx(from, position, NULL, FILE_BEGIN);
+    return result;
+}
+
+size file_get_full_path(char* path, char* buffer, size capacity)
+{
+    size result = 0;
+    DWORD length = GetFullPathNameA(path, (DWORD)capacity, buffer, NULL);
+    if (length > 0 && (size)length < capacity && GetFileAttributesA(buffer) != INVALID_FILE_ATTRIBUTES)
+        result = (size)length;
+    return result;
+}
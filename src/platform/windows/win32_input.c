@@ -23,3 +23,11 @@ void input_process(Window* window)
         }
     }
 }
+
+void input_wait(Window* window, u32 timeout_ms)
+{
+    // MWMO_INPUTAVAILABLE returns right away if input is already queued, so nothing can get stuck waiting
+    HANDLE wake_event = (HANDLE)window->wake_event;
+    MsgWaitForMultipleObjectsEx(1, &wake_event, timeout_ms, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+    input_process(window);
+}
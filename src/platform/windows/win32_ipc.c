@@ -0,0 +1,284 @@
+#include "ipc.h"
+#include "win32_base.h"
+
+#include <windows.h>
+
+#include <stdio.h> // snprintf
+
+/*
+ * NOTE(lucas): Pipes are opened for overlapped I/O, since a pipe opened for synchronous I/O runs one call at a time
+ * and a receive waiting for the next request would hold up every send. Each call waits on its own event, so they
+ * still block like the Linux ones do.
+ */
+typedef struct
+{
+    HANDLE pipe;
+    HANDLE read_event;
+    HANDLE write_event;
+} Win32Connection;
+
+// The next pipe instance, created before the last one is handed out so a client can always connect
+typedef struct
+{
+    char path[IPC_MAX_PATH];
+    Win32Connection* pending;
+} Win32Listener;
+
+size ipc_runtime_path(char* name, char* buffer, size capacity)
+{
+    char directory[MAX_PATH + 1];
+    DWORD directory_length = GetTempPathA(sizeof(directory), directory);
+    int length = 0;
+    if (directory_length > 0 && directory_length < sizeof(directory))
+        length = snprintf(buffer, (usize)capacity, "%s%s", directory, name);
+    return (length > 0 && (size)length < capacity) ? (size)length : 0;
+}
+
+internal Win32Connection* win32_connection_create(HANDLE pipe)
+{
+    Win32Connection* result = (Win32Connection*)VirtualAlloc(NULL, sizeof(Win32Connection), MEM_COMMIT|MEM_RESERVE,
+                                                              PAGE_READWRITE);
+    if (result)
+    {
+        result->pipe = pipe;
+        result->read_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+        result->write_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    }
+    else
+    {
+        CloseHandle(pipe);
+    }
+    return result;
+}
+
+internal Win32Connection* win32_pipe_create(char* path, b32 first)
+{
+    DWORD open_mode = PIPE_ACCESS_DUPLEX|FILE_FLAG_OVERLAPPED;
+    if (first)
+        open_mode |= FILE_FLAG_FIRST_PIPE_INSTANCE;
+    DWORD pipe_mode = PIPE_TYPE_BYTE|PIPE_READMODE_BYTE|PIPE_WAIT|PIPE_REJECT_REMOTE_CLIENTS;
+    HANDLE pipe = CreateNamedPipeA(path, open_mode, pipe_mode, PIPE_UNLIMITED_INSTANCES, (DWORD)KILOBYTES(64),
+                                   (DWORD)KILOBYTES(64), 0, NULL);
+    return (pipe != INVALID_HANDLE_VALUE) ? win32_connection_create(pipe) : 0;
+}
+
+void* ipc_listen(char* name)
+{
+    Win32Listener* listener = (Win32Listener*)VirtualAlloc(NULL, sizeof(Win32Listener), MEM_COMMIT|MEM_RESERVE,
+                                                           PAGE_READWRITE);
+    if (!listener)
+        return 0;
+
+    // The first instance fails if another server has the name, and pipes go away with their server
+    snprintf(listener->path, sizeof(listener->path), "\\\\.\\pipe\\%s", name);
+    listener->pending = win32_pipe_create(listener->path, true);
+    if (!listener->pending)
+    {
+        VirtualFree(listener, 0, MEM_RELEASE);
+        return 0;
+    }
+    return listener;
+}
+
+void* ipc_accept(void* listener_handle)
+{
+    Win32Listener* listener = (Win32Listener*)listener_handle;
+    Win32Connection* result = 0;
+    while (!result && listener->pending)
+    {
+        Win32Connection* connection = listener->pending;
+        OVERLAPPED overlapped = {0};
+        overlapped.hEvent = connection->read_event;
+        DWORD transferred = 0;
+        b32 connected = ConnectNamedPipe(connection->pipe, &overlapped) != 0;
+        if (!connected)
+        {
+            DWORD error = GetLastError();
+            if (error == ERROR_IO_PENDING)
+                connected = GetOverlappedResult(connection->pipe, &overlapped, &transferred, TRUE) != 0;
+            else
+                connected = (error == ERROR_PIPE_CONNECTED);
+        }
+
+        listener->pending = win32_pipe_create(listener->path, false);
+        if (connected)
+            result = connection;
+        else
+            ipc_close(connection);
+    }
+    return result;
+}
+
+void* ipc_connect(char* name)
+{
+    char path[IPC_MAX_PATH];
+    snprintf(path, sizeof(path), "\\\\.\\pipe\\%s", name);
+    for (u32 attempt = 0; attempt < 4; ++attempt)
+    {
+        HANDLE pipe = CreateFileA(path, GENERIC_READ|GENERIC_WRITE, 0, NULL, OPEN_EXISTING, FILE_FLAG_OVERLAPPED,
+                                  NULL);
+        if (pipe != INVALID_HANDLE_VALUE)
+            return win32_connection_create(pipe);
+
+        // Busy means every instance is taken and the server is making another
+        if (GetLastError() != ERROR_PIPE_BUSY || !WaitNamedPipeA(path, 1000))
+            break;
+    }
+    return 0;
+}
+
+void ipc_close(void* connection_handle)
+{
+    Win32Connection* connection = (Win32Connection*)connection_handle;
+    if (connection)
+    {
+        CloseHandle(connection->pipe);
+        CloseHandle(connection->read_event);
+        CloseHandle(connection->write_event);
+        VirtualFree(connection, 0, MEM_RELEASE);
+    }
+}
+
+void ipc_unlink(char* name)
+{
+    (void)name;
+}
+
+global volatile u32* win32_interrupted;
+global Semaphore* win32_interrupt_wake;
+
+// Runs on a thread of its own. Closing the console ends the process once this returns, whatever it returns.
+internal BOOL WINAPI win32_interrupt_handler(DWORD type)
+{
+    *win32_interrupted = 1;
+    semaphore_signal(win32_interrupt_wake);
+    (void)type;
+    return TRUE;
+}
+
+void ipc_catch_interrupt(volatile u32* interrupted, Semaphore* wake)
+{
+    win32_interrupted = interrupted;
+    win32_interrupt_wake = wake;
+    SetConsoleCtrlHandler(win32_interrupt_handler, TRUE);
+}
+
+internal b32 win32_pipe_transfer(Win32Connection* connection, u8* data, size bytes, b32 write)
+{
+    HANDLE event = write ? connection->write_event : connection->read_event;
+    while (bytes > 0)
+    {
+        DWORD piece = (bytes < (size)MEGABYTES(1)) ? (DWORD)bytes : (DWORD)MEGABYTES(1);
+        OVERLAPPED overlapped = {0};
+        overlapped.hEvent = event;
+        DWORD transferred = 0;
+        BOOL done = write ? WriteFile(connection->pipe, data, piece, &transferred, &overlapped) :
+                            ReadFile(connection->pipe, data, piece, &transferred, &overlapped);
+        if (!done && GetLastError() == ERROR_IO_PENDING)
+            done = GetOverlappedResult(connection->pipe, &overlapped, &transferred, TRUE);
+        if (!done || transferred == 0)
+            return false;
+        data += transferred;
+        bytes -= (size)transferred;
+    }
+    return true;
+}
+
+b32 ipc_send(void* connection, void* data, size bytes)
+{
+    return win32_pipe_transfer((Win32Connection*)connection, (u8*)data, bytes, true);
+}
+
+b32 ipc_receive(void* connection, void* data, size bytes)
+{
+    return win32_pipe_transfer((Win32Connection*)connection, (u8*)data, bytes, false);
+}
+
+b32 ipc_wait(void* connection_handle, u32 timeout_ms)
+{
+    // NOTE(lucas): Pipes can't be waited on for data, so this polls. Clients only wait while a query is running.
+    Win32Connection* connection = (Win32Connection*)connection_handle;
+    u32 waited = 0;
+    for (;;)
+    {
+        DWORD available = 0;
+        if (!PeekNamedPipe(connection->pipe, NULL, 0, NULL, &available, NULL) || available > 0)
+            return true;
+        if (waited >= timeout_ms)
+            return false;
+        Sleep(1);
+        ++waited;
+    }
+}
+
+//
+// Shared memory
+//
+
+b32 shared_memory_create(SharedMemory* memory, char* name, size bytes)
+{
+    zero_struct(*memory);
+    char path[IPC_MAX_PATH];
+    snprintf(path, sizeof(path), "Local\\%s", name);
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((u64)bytes >> 32),
+                                        (DWORD)((u64)bytes & 0xFFFFFFFF), path);
+    if (!mapping)
+        return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+        // Still held open by someone, so not ours to reuse
+        CloseHandle(mapping);
+        return false;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)bytes);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+    memory->handle = mapping;
+    memory->data = (u8*)data;
+    memory->bytes = bytes;
+    return true;
+}
+
+b32 shared_memory_open(SharedMemory* memory, char* name, size bytes)
+{
+    zero_struct(*memory);
+    char path[IPC_MAX_PATH];
+    snprintf(path, sizeof(path), "Local\\%s", name);
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, path);
+    if (!mapping)
+        return false;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)bytes);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+    memory->handle = mapping;
+    memory->data = (u8*)data;
+    memory->bytes = bytes;
+    return true;
+}
+
+void shared_memory_unlink(char* name)
+{
+    (void)name;
+}
+
+void shared_memory_unlink_all(char* prefix)
+{
+    (void)prefix;
+}
+
+void shared_memory_close(SharedMemory* memory)
+{
+    if (memory->data)
+        UnmapViewOfFile(memory->data);
+    if (memory->handle)
+        CloseHandle(memory->handle);
+    zero_struct(*memory);
+}
@@ -0,0 +1,71 @@
+#include "thread.h"
+#include "win32_base.h"
+
+#include <windows.h>
+
+typedef struct
+{
+    ThreadProc* proc;
+    void* data;
+} Win32ThreadStart;
+
+u32 thread_get_processor_count(void)
+{
+    SYSTEM_INFO info = {0};
+    GetSystemInfo(&info);
+    return (u32)info.dwNumberOfProcessors;
+}
+
+internal DWORD WINAPI win32_thread_proc(LPVOID param)
+{
+    Win32ThreadStart start = *(Win32ThreadStart*)param;
+    VirtualFree(param, 0, MEM_RELEASE);
+    start.proc(start.data);
+    return 0;
+}
+
+b32 thread_create(ThreadProc* proc, void* data)
+{
+    // The start block has to outlive this call, so it can't live on the stack
+    Win32ThreadStart* start = (Win32ThreadStart*)VirtualAlloc(NULL, sizeof(Win32ThreadStart), MEM_COMMIT|MEM_RESERVE,
+                                                              PAGE_READWRITE);
+    if (!start)
+        return false;
+    start->proc = proc;
+    start->data = data;
+
+    HANDLE thread = CreateThread(NULL, 0, win32_thread_proc, start, 0, NULL);
+    if (!thread)
+    {
+        win32_error_callback();
+        VirtualFree(start, 0, MEM_RELEASE);
+        return false;
+    }
+
+    CloseHandle(thread);
+    return true;
+}
+
+void thread_sleep(u32 milliseconds)
+{
+    Sleep(milliseconds);
+}
+
+Semaphore* semaphore_create(Arena* arena, u32 initial_count)
+{
+    (void)arena;
+    HANDLE semaphore = CreateSemaphoreExA(NULL, (LONG)initial_count, MAXLONG, NULL, 0, SEMAPHORE_ALL_ACCESS);
+    if (!semaphore)
+        win32_error_callback();
+    return (Semaphore*)semaphore;
+}
+
+void semaphore_wait(Semaphore* semaphore)
+{
+    WaitForSingleObjectEx((HANDLE)semaphore, INFINITE, FALSE);
+}
+
+void semaphore_signal(Semaphore* semaphore)
+{
+    ReleaseSemaphore((HANDLE)semaphore, 1, NULL);
+}
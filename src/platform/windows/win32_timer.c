@@ -0,0 +1,17 @@
+#include "timer.h"
+
+#include <windows.h>
+
+u64 timer_get_os_ticks(void)
+{
+    LARGE_INTEGER ticks;
+    QueryPerformanceCounter(&ticks);
+    return (u64)ticks.QuadPart;
+}
+
+u64 timer_get_os_frequency(void)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (u64)frequency.QuadPart;
+}
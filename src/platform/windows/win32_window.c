@@ -63,6 +63,26 @@ internal LRESULT CALLBACK win32_main_window_callback(HWND hwnd, UINT msg, WPARAM
             PostQuitMessage(0);
         } break;
 
+        /*
+        Sent when part of the window needs repainting. The renderer presents on its own schedule, so just
+        request a redraw and validate the region to stop the message from repeating.
+        */
+        case WM_PAINT:
+        {
+            Window* window = (Window*)GetWindowLongPtrA(hwnd, GWLP_USERDATA);
+            if (window)
+                window->needs_redraw = true;
+
+            ValidateRect(hwnd, NULL);
+        } break;
+
+        case WM_SIZE:
+        {
+            Window* window = (Window*)GetWindowLongPtrA(hwnd, GWLP_USERDATA);
+            if (window)
+                window->needs_redraw = true;
+        } break;
+
         case WM_MENUCHAR:
         {
             // Don't chime when Alt+Enter is pressed
@@ -131,6 +151,12 @@ Window* window_create(const char* title, int width, int height)
 
     window->ptr = hwnd;
     window->open = true;
+    window->needs_redraw = true;
+
+    // Auto-reset, so each wake ends exactly one wait
+    window->wake_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    if (!window->wake_event)
+        win32_error_callback();
 
     // Associate window data with the window ptr
     SetWindowLongPtrA(hwnd, GWLP_USERDATA, (LONG_PTR)window);
@@ -138,6 +164,11 @@ Window* window_create(const char* title, int width, int height)
     return window;
 }
 
+void window_wake(Window* window)
+{
+    SetEvent((HANDLE)window->wake_event);
+}
+
 void* window_icon_load_from_file(const char* filename)
 {
     HICON icon = (HICON)LoadImageA(NULL, filename, IMAGE_ICON, 0, 0, LR_LOADFROMFILE|LR_DEFAULTSIZE);
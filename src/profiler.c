@@ -0,0 +1,371 @@
+#include "profiler.h"
+#include "atomic.h"
+#include "file.h"
+#include "grapple_memory.h"
+#include "timer.h"
+
+#include <stdarg.h> // varargs
+#include <stdio.h> // vsnprintf
+#include <string.h> // strcmp
+
+#ifdef GRAPPLE_PROFILE
+
+typedef struct
+{
+    ProfileEvent events[PROFILE_EVENTS_PER_THREAD];
+    volatile u64 write_index; // Only ever written by the owning thread
+    u32 id;
+    const char* name;
+} ProfileThread;
+
+// Scratch node used while building the per-frame hierarchy
+typedef struct
+{
+    const char* name;
+    u32 parent;
+    u32 first_child;
+    u32 last_child;
+    u32 next_sibling;
+    u32 calls;
+    u64 inclusive_ticks;
+    u64 child_ticks;
+} ProfileNode;
+
+typedef struct
+{
+    u64 cpu_frequency;
+    u64 base_tsc;
+
+    ProfileThread* threads[PROFILE_MAX_THREADS];
+    volatile u32 thread_count;
+
+    // Owned by the thread that calls profiler_frame_end
+    u64 frame_start_index;
+    u64 frame_start_tsc;
+    ProfileFrame last_frame;
+} Profiler;
+
+typedef struct
+{
+    void* file;
+    size used;
+    u8 data[KILOBYTES(64)];
+} TraceWriter;
+
+global Profiler global_profiler;
+global TraceWriter global_trace_writer;
+global per_thread ProfileThread* local_profile_thread;
+
+void profiler_init(void)
+{
+    global_profiler.cpu_frequency = timer_estimate_cpu_frequency(100);
+    global_profiler.base_tsc = timer_read_cpu();
+    global_profiler.frame_start_tsc = global_profiler.base_tsc;
+    profiler_set_thread_name("main");
+}
+
+internal ProfileThread* profiler_get_thread(void)
+{
+    ProfileThread* thread = local_profile_thread;
+    if (!thread)
+    {
+        u32 index = atomic_add_u32(&global_profiler.thread_count, 1) - 1;
+        ASSERT(index < PROFILE_MAX_THREADS, "Too many threads for the profiler");
+        if (index >= PROFILE_MAX_THREADS)
+            return 0;
+
+        Arena arena = arena_alloc(sizeof(ProfileThread));
+        thread = push_struct(&arena, ProfileThread);
+        thread->id = index;
+        global_profiler.threads[index] = thread;
+        local_profile_thread = thread;
+    }
+    return thread;
+}
+
+void profiler_set_thread_name(const char* name)
+{
+    ProfileThread* thread = profiler_get_thread();
+    if (thread)
+        thread->name = name;
+}
+
+internal inline void profile_record(const char* name, ProfileEventType type)
+{
+    ProfileThread* thread = profiler_get_thread();
+    if (!thread)
+        return;
+
+    u64 index = thread->write_index;
+    ProfileEvent* event = &thread->events[index & (PROFILE_EVENTS_PER_THREAD-1)];
+    event->name = name;
+    event->type = type;
+    event->tsc = timer_read_cpu();
+    atomic_store_u64(&thread->write_index, index + 1);
+}
+
+void profile_begin(const char* name)
+{
+    profile_record(name, ProfileEvent_Begin);
+}
+
+void profile_end(const char* name)
+{
+    profile_record(name, ProfileEvent_End);
+}
+
+f64 profiler_ticks_to_ms(u64 ticks)
+{
+    f64 result = 0.0;
+    if (global_profiler.cpu_frequency)
+        result = 1000.0*(f64)ticks / (f64)global_profiler.cpu_frequency;
+    return result;
+}
+
+ProfileFrame* profiler_get_last_frame(void)
+{
+    return &global_profiler.last_frame;
+}
+
+internal u32 profiler_find_or_add_child(ProfileNode* nodes, u32* node_count, u32 parent_index, const char* name)
+{
+    ProfileNode* parent = &nodes[parent_index];
+    for (u32 child = parent->first_child; child; child = nodes[child].next_sibling)
+    {
+        if (nodes[child].name == name || strcmp(nodes[child].name, name) == 0)
+            return child;
+    }
+
+    if (*node_count >= PROFILE_MAX_FRAME_ENTRIES)
+        return 0;
+
+    u32 index = (*node_count)++;
+    ProfileNode* node = &nodes[index];
+    zero_struct(*node);
+    node->name = name;
+    node->parent = parent_index;
+    if (parent->last_child)
+        nodes[parent->last_child].next_sibling = index;
+    else
+        parent->first_child = index;
+    parent->last_child = index;
+
+    return index;
+}
+
+void profiler_frame_end(void)
+{
+    ProfileThread* thread = profiler_get_thread();
+    if (!thread)
+        return;
+
+    u64 end_index = atomic_load_u64(&thread->write_index);
+    u64 end_tsc = timer_read_cpu();
+
+    ProfileFrame* frame = &global_profiler.last_frame;
+    frame->frame_ticks = end_tsc - global_profiler.frame_start_tsc;
+    frame->truncated = false;
+    frame->entry_count = 0;
+
+    u64 start_index = global_profiler.frame_start_index;
+    if (end_index - start_index > PROFILE_EVENTS_PER_THREAD)
+    {
+        start_index = end_index - PROFILE_EVENTS_PER_THREAD;
+        frame->truncated = true;
+    }
+
+    // NOTE(lucas): Node 0 is the root. Nodes are created on the first begin event for a block, so entries show
+    // up in the order blocks were first entered.
+    ProfileNode nodes[PROFILE_MAX_FRAME_ENTRIES+1];
+    zero_struct(nodes[0]);
+    u32 node_count = 1;
+
+    u32 stack[PROFILE_MAX_DEPTH];
+    u64 stack_tsc[PROFILE_MAX_DEPTH];
+    u32 depth = 0;
+    u32 skipped_depth = 0;
+
+    for (u64 index = start_index; index < end_index; ++index)
+    {
+        ProfileEvent* event = &thread->events[index & (PROFILE_EVENTS_PER_THREAD-1)];
+        if (event->type == ProfileEvent_Begin)
+        {
+            u32 node = 0;
+            if (!skipped_depth && depth < PROFILE_MAX_DEPTH)
+                node = profiler_find_or_add_child(nodes, &node_count, depth ? stack[depth-1] : 0, event->name);
+
+            if (node)
+            {
+                stack[depth] = node;
+                stack_tsc[depth] = event->tsc;
+                ++depth;
+            }
+            else
+            {
+                frame->truncated = true;
+                ++skipped_depth;
+            }
+        }
+        else if (skipped_depth)
+        {
+            --skipped_depth;
+        }
+        else if (depth)
+        {
+            // End events with no begin in this frame belong to blocks that were open when the frame started
+            u32 node_index = stack[--depth];
+            u64 elapsed = event->tsc - stack_tsc[depth];
+            nodes[node_index].inclusive_ticks += elapsed;
+            ++nodes[node_index].calls;
+            nodes[nodes[node_index].parent].child_ticks += elapsed;
+        }
+    }
+
+    // Flatten depth-first, skipping blocks that are still open
+    u32 node_index = nodes[0].first_child;
+    u32 node_depth = 0;
+    while (node_index)
+    {
+        ProfileNode* node = &nodes[node_index];
+        if (node->calls)
+        {
+            ProfileFrameEntry* entry = &frame->entries[frame->entry_count++];
+            entry->name = node->name;
+            entry->depth = node_depth;
+            entry->calls = node->calls;
+            entry->inclusive_ticks = node->inclusive_ticks;
+            entry->exclusive_ticks = node->inclusive_ticks - node->child_ticks;
+        }
+
+        if (node->first_child)
+        {
+            node_index = node->first_child;
+            ++node_depth;
+        }
+        else
+        {
+            while (node_index && !nodes[node_index].next_sibling)
+            {
+                node_index = nodes[node_index].parent;
+                --node_depth;
+            }
+            if (node_index)
+                node_index = nodes[node_index].next_sibling;
+        }
+    }
+
+    global_profiler.frame_start_index = end_index;
+    global_profiler.frame_start_tsc = end_tsc;
+}
+
+//
+// NOTE(lucas): Chrome trace export
+//
+
+internal void trace_flush(TraceWriter* writer)
+{
+    if (writer->used)
+        file_write(writer->file, writer->data, writer->used);
+    writer->used = 0;
+}
+
+internal void trace_printf(TraceWriter* writer, const char* format, ...)
+{
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        size remaining = (size)sizeof(writer->data) - writer->used;
+        va_list args;
+        va_start(args, format);
+        int len = vsnprintf((char*)writer->data + writer->used, (usize)remaining, format, args);
+        va_end(args);
+
+        if (len >= 0 && len < remaining)
+        {
+            writer->used += len;
+            return;
+        }
+
+        trace_flush(writer);
+    }
+}
+
+internal f64 profiler_tsc_to_us(u64 tsc)
+{
+    f64 result = 1000.0*profiler_ticks_to_ms(tsc - global_profiler.base_tsc);
+    return result;
+}
+
+// NOTE(lucas): Writes whatever is still in each thread's ring, so only the most recent events survive. Threads
+// may keep recording while this runs; call it after workers have stopped for an exact capture.
+b32 profiler_write_chrome_trace(char* filename)
+{
+    TraceWriter* writer = &global_trace_writer;
+    writer->file = file_open(filename, FileMode_Write|FileMode_Create);
+    if (!writer->file)
+        return false;
+    writer->used = 0;
+
+    trace_printf(writer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    b32 first = true;
+
+    u32 thread_count = atomic_load_u32(&global_profiler.thread_count);
+    if (thread_count > PROFILE_MAX_THREADS)
+        thread_count = PROFILE_MAX_THREADS;
+
+    for (u32 thread_index = 0; thread_index < thread_count; ++thread_index)
+    {
+        ProfileThread* thread = global_profiler.threads[thread_index];
+        if (!thread)
+            continue;
+
+        if (thread->name)
+        {
+            trace_printf(writer, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                         "\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", thread->id, thread->name);
+            first = false;
+        }
+
+        u64 end_index = atomic_load_u64(&thread->write_index);
+        u64 start_index = 0;
+        if (end_index > PROFILE_EVENTS_PER_THREAD)
+            start_index = end_index - PROFILE_EVENTS_PER_THREAD;
+
+        // Pair begins with ends and emit complete events. Ends whose begin was overwritten are dropped.
+        u64 stack_tsc[PROFILE_MAX_DEPTH];
+        u32 depth = 0;
+        u32 skipped_depth = 0;
+        for (u64 index = start_index; index < end_index; ++index)
+        {
+            ProfileEvent* event = &thread->events[index & (PROFILE_EVENTS_PER_THREAD-1)];
+            if (event->type == ProfileEvent_Begin)
+            {
+                if (depth < PROFILE_MAX_DEPTH && !skipped_depth)
+                    stack_tsc[depth++] = event->tsc;
+                else
+                    ++skipped_depth;
+            }
+            else if (skipped_depth)
+            {
+                --skipped_depth;
+            }
+            else if (depth)
+            {
+                u64 begin_tsc = stack_tsc[--depth];
+                f64 ts = profiler_tsc_to_us(begin_tsc);
+                f64 dur = 1000.0*profiler_ticks_to_ms(event->tsc - begin_tsc);
+                trace_printf(writer, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                             first ? "" : ",\n", event->name, thread->id, ts, dur);
+                first = false;
+            }
+        }
+    }
+
+    trace_printf(writer, "\n]}\n");
+    trace_flush(writer);
+    file_close(writer->file);
+    writer->file = 0;
+
+    return true;
+}
+
+#endif // GRAPPLE_PROFILE
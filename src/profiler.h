@@ -0,0 +1,96 @@
+#pragma once
+
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * NOTE(lucas): Instrumentation profiler.
+ * Each thread records begin/end events into its own ring buffer, so recording never takes a lock. Block names
+ * are stored by pointer and must outlive the profiler (string literals or __FUNCTION__).
+ * The thread that calls profiler_frame_end() gets a hierarchical breakdown of its own events for that frame,
+ * and profiler_write_chrome_trace() dumps whatever is still in every ring as Chrome trace-event JSON, which
+ * can be opened in Perfetto or chrome://tracing.
+ * When GRAPPLE_PROFILE is not defined, all of the macros below compile to nothing.
+ */
+
+#define PROFILE_MAX_THREADS 64
+#define PROFILE_EVENTS_PER_THREAD 65536 // Must be a power of two
+#define PROFILE_MAX_DEPTH 32
+#define PROFILE_MAX_FRAME_ENTRIES 128
+
+typedef enum ProfileEventType
+{
+    ProfileEvent_Begin = 0,
+    ProfileEvent_End
+} ProfileEventType;
+
+typedef struct
+{
+    const char* name;
+    u64 tsc;
+    ProfileEventType type;
+} ProfileEvent;
+
+// Calls to the same block under the same parent are merged into one entry.
+typedef struct
+{
+    const char* name;
+    u32 depth;
+    u32 calls;
+    u64 inclusive_ticks;
+    u64 exclusive_ticks;
+} ProfileFrameEntry;
+
+typedef struct
+{
+    u64 frame_ticks;
+    b32 truncated; // The ring wrapped, or the entry/depth limits were hit, during the frame
+    u32 entry_count;
+    ProfileFrameEntry entries[PROFILE_MAX_FRAME_ENTRIES]; // Depth-first order
+} ProfileFrame;
+
+void profiler_init(void);
+void profiler_set_thread_name(const char* name);
+void profile_begin(const char* name);
+void profile_end(const char* name);
+
+void profiler_frame_end(void);
+ProfileFrame* profiler_get_last_frame(void);
+f64 profiler_ticks_to_ms(u64 ticks);
+b32 profiler_write_chrome_trace(char* filename);
+
+#ifdef GRAPPLE_PROFILE
+    #define PROFILE_INIT() profiler_init()
+    #define PROFILE_THREAD_NAME(name) profiler_set_thread_name(name)
+    #define PROFILE_FRAME_END() profiler_frame_end()
+
+    #define PROFILE_BEGIN(name) profile_begin(name)
+    #define PROFILE_END(name) profile_end(name)
+    #define PROFILE_FUNCTION_BEGIN() profile_begin(__FUNCTION__)
+    #define PROFILE_FUNCTION_END() profile_end(__FUNCTION__)
+
+    // Times the statement or block that follows. Leaving the block with return, break or goto skips the end
+    // event, so use PROFILE_BEGIN/PROFILE_END around code with early exits.
+    #define PROFILE_SCOPE(name) PROFILE_SCOPE_(name, __LINE__)
+    #define PROFILE_SCOPE_(name, line) PROFILE_SCOPE__(name, line)
+    #define PROFILE_SCOPE__(name, line) \
+        for (int profile_scope_##line = (profile_begin(name), 0); !profile_scope_##line; \
+             profile_scope_##line = (profile_end(name), 1))
+#else
+    #define PROFILE_INIT()
+    #define PROFILE_THREAD_NAME(name)
+    #define PROFILE_FRAME_END()
+
+    #define PROFILE_BEGIN(name)
+    #define PROFILE_END(name)
+    #define PROFILE_FUNCTION_BEGIN()
+    #define PROFILE_FUNCTION_END()
+    #define PROFILE_SCOPE(name)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
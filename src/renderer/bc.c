@@ -0,0 +1,1504 @@
+#include "bc.h"
+#include "grapple_math.h"
+#include "profiler.h"
+
+#include <string.h> // memcpy, memset
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define BC_SSE2 1
+#endif
+
+#define BC_PIXELS 16
+#define BC_MAX_ENCODE_JOBS 64
+
+// Pixels of one block in channel-major order, c[channel][y*4 + x]
+typedef struct
+{
+    f32 c[4][BC_PIXELS];
+} BcBlock;
+
+typedef struct
+{
+    f32 entries[16][4];
+    u32 count;
+} BcPalette;
+
+// Interpolation weights out of 64 for BC7 indices of each size
+global const u8 bc7_weights2[4] = {0, 21, 43, 64};
+global const u8 bc7_weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+global const u8 bc7_weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Which subset each pixel is in for each BC7 partition, a bit per pixel for two subsets and two bits for three
+global const u16 bc7_partitions2[64] = {
+    0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+    0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+    0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+    0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+    0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+    0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+    0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+    0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+};
+global const u32 bc7_partitions3[64] = {
+    0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+    0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+    0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+    0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+    0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+    0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+    0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+    0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+};
+
+// The pixel whose index drops its top bit in the second and third subsets. The first subset's is always pixel 0.
+global const u8 bc7_anchors2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+    15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+    6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+};
+global const u8 bc7_anchors3_second[64] = {
+    3, 3, 15, 15, 8, 3, 15, 15, 8, 8, 6, 6, 6, 5, 3, 3,
+    3, 3, 8, 15, 3, 3, 6, 10, 5, 8, 8, 6, 8, 5, 15, 15,
+    8, 15, 3, 5, 6, 10, 8, 15, 15, 3, 15, 5, 15, 15, 15, 15,
+    3, 15, 5, 5, 5, 8, 5, 10, 5, 10, 8, 13, 15, 12, 3, 3,
+};
+global const u8 bc7_anchors3_third[64] = {
+    15, 8, 8, 3, 15, 15, 3, 8, 15, 15, 15, 15, 15, 15, 15, 8,
+    15, 8, 15, 3, 15, 8, 15, 8, 3, 15, 6, 10, 15, 15, 10, 8,
+    15, 3, 15, 10, 10, 8, 9, 10, 6, 15, 8, 15, 3, 6, 6, 8,
+    15, 3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3, 15, 15, 8,
+};
+
+// Layout of each BC7 mode. Modes 4 and 5 have separate color and alpha indices and are read on their own.
+typedef struct
+{
+    u8 subset_count;
+    u8 partition_bits;
+    u8 color_bits;
+    u8 alpha_bits;     // 0 for opaque
+    u8 endpoint_p_bit; // A p-bit per endpoint
+    u8 shared_p_bit;   // A p-bit per subset
+    u8 index_bits;
+} Bc7Mode;
+
+global const Bc7Mode bc7_modes[8] = {
+    {3, 4, 4, 0, 1, 0, 3},
+    {2, 6, 6, 0, 0, 1, 3},
+    {3, 6, 5, 0, 0, 0, 2},
+    {2, 6, 7, 0, 1, 0, 2},
+    {1, 0, 5, 6, 0, 0, 2},
+    {1, 0, 7, 8, 0, 0, 2},
+    {1, 0, 7, 7, 1, 0, 4},
+    {2, 6, 5, 5, 1, 0, 2},
+};
+
+
+u32 bc_block_bytes(TextureFormat format)
+{
+    u32 result = 0;
+    switch (format)
+    {
+        case TextureFormat_BC1: result = 8; break;
+        case TextureFormat_BC3: result = 16; break;
+        case TextureFormat_BC7: result = 16; break;
+        default: break;
+    }
+    return result;
+}
+
+internal inline f32 bc_clamp255(f32 x)
+{
+    return x < 0.0f ? 0.0f : (x > 255.0f ? 255.0f : x);
+}
+
+internal inline u32 bc_round(f32 x)
+{
+    return (u32)(x + 0.5f);
+}
+
+//
+// NOTE(lucas): Shared fitting
+//
+
+// Picks the nearest palette entry for every pixel over the first channel_count channels. Returns the total squared
+// error.
+internal f32 bc_select_indices(BcBlock* block, BcPalette* palette, u32 channel_count, u8* indices)
+{
+    f32 total_error = 0.0f;
+
+#ifdef BC_SSE2
+    for (u32 group = 0; group < BC_PIXELS; group += 4)
+    {
+        __m128i best_index = _mm_setzero_si128();
+        __m128 best_error = _mm_set1_ps(3.4e38f);
+        for (u32 entry = 0; entry < palette->count; ++entry)
+        {
+            __m128 error = _mm_setzero_ps();
+            for (u32 channel = 0; channel < channel_count; ++channel)
+            {
+                __m128 d = _mm_sub_ps(_mm_loadu_ps(&block->c[channel][group]),
+                                      _mm_set1_ps(palette->entries[entry][channel]));
+                error = _mm_add_ps(error, _mm_mul_ps(d, d));
+            }
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, best_error));
+            best_error = _mm_min_ps(error, best_error);
+            best_index = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((i32)entry)),
+                                      _mm_andnot_si128(closer, best_index));
+        }
+
+        i32 lanes[4];
+        f32 errors[4];
+        _mm_storeu_si128((__m128i*)lanes, best_index);
+        _mm_storeu_ps(errors, best_error);
+        for (u32 i = 0; i < 4; ++i)
+        {
+            indices[group + i] = (u8)lanes[i];
+            total_error += errors[i];
+        }
+    }
+#else
+    for (u32 i = 0; i < BC_PIXELS; ++i)
+    {
+        f32 best_error = 3.4e38f;
+        for (u32 entry = 0; entry < palette->count; ++entry)
+        {
+            f32 error = 0.0f;
+            for (u32 channel = 0; channel < channel_count; ++channel)
+                error += sq_f32(block->c[channel][i] - palette->entries[entry][channel]);
+            if (error < best_error)
+            {
+                best_error = error;
+                indices[i] = (u8)entry;
+            }
+        }
+        total_error += best_error;
+    }
+#endif
+
+    return total_error;
+}
+
+// Endpoints at the extremes of the block's colors along their principal axis
+internal void bc_fit_principal_axis(BcBlock* block, u32 channel_count, f32* e0, f32* e1)
+{
+    f32 mean[4] = {0};
+    for (u32 channel = 0; channel < channel_count; ++channel)
+    {
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+            mean[channel] += block->c[channel][i];
+        mean[channel] *= 1.0f / BC_PIXELS;
+    }
+
+    f32 covariance[4][4] = {0};
+    for (u32 i = 0; i < BC_PIXELS; ++i)
+    {
+        for (u32 a = 0; a < channel_count; ++a)
+        {
+            for (u32 b = a; b < channel_count; ++b)
+                covariance[a][b] += (block->c[a][i] - mean[a])*(block->c[b][i] - mean[b]);
+        }
+    }
+    for (u32 a = 0; a < channel_count; ++a)
+    {
+        for (u32 b = 0; b < a; ++b)
+            covariance[a][b] = covariance[b][a];
+    }
+
+    // NOTE(lucas): Power iteration, starting from the covariance of the channel that varies most with every channel.
+    // The bounding box diagonal would be simpler, but it can't tell a block from red to blue from one from black to
+    // magenta, and for the first it is at right angles to the real axis, which then never shows up.
+    u32 widest = 0;
+    for (u32 channel = 1; channel < channel_count; ++channel)
+    {
+        if (covariance[channel][channel] > covariance[widest][widest])
+            widest = channel;
+    }
+    f32 axis[4] = {0};
+    for (u32 channel = 0; channel < channel_count; ++channel)
+        axis[channel] = covariance[widest][channel];
+    for (u32 iteration = 0; iteration < 8; ++iteration)
+    {
+        f32 next[4] = {0};
+        f32 largest = 0.0f;
+        for (u32 a = 0; a < channel_count; ++a)
+        {
+            for (u32 b = 0; b < channel_count; ++b)
+                next[a] += covariance[a][b]*axis[b];
+            f32 magnitude = next[a] < 0.0f ? -next[a] : next[a];
+            largest = magnitude > largest ? magnitude : largest;
+        }
+        if (largest < 1e-6f)
+            break;
+        for (u32 a = 0; a < channel_count; ++a)
+            axis[a] = next[a] / largest;
+    }
+
+    f32 length_sq = 0.0f;
+    for (u32 channel = 0; channel < channel_count; ++channel)
+        length_sq += sq_f32(axis[channel]);
+    if (length_sq < 1e-12f)
+    {
+        // All pixels are the same color
+        for (u32 channel = 0; channel < channel_count; ++channel)
+        {
+            e0[channel] = mean[channel];
+            e1[channel] = mean[channel];
+        }
+        return;
+    }
+    f32 inv_length = 1.0f / sqrt_f32(length_sq);
+    for (u32 channel = 0; channel < channel_count; ++channel)
+        axis[channel] *= inv_length;
+
+    f32 t_min = 3.4e38f;
+    f32 t_max = -3.4e38f;
+    for (u32 i = 0; i < BC_PIXELS; ++i)
+    {
+        f32 t = 0.0f;
+        for (u32 channel = 0; channel < channel_count; ++channel)
+            t += (block->c[channel][i] - mean[channel])*axis[channel];
+        t_min = t < t_min ? t : t_min;
+        t_max = t > t_max ? t : t_max;
+    }
+
+    for (u32 channel = 0; channel < channel_count; ++channel)
+    {
+        e0[channel] = bc_clamp255(mean[channel] + t_min*axis[channel]);
+        e1[channel] = bc_clamp255(mean[channel] + t_max*axis[channel]);
+    }
+}
+
+// Endpoints that minimize the squared error for the chosen indices, where weights[index] is how far along from e0
+// to e1 that index is. Indices with a negative weight are left out. Returns false if the fit is degenerate.
+internal b32 bc_fit_least_squares(BcBlock* block, u32 channel_count, u8* indices, f32* weights, f32* e0, f32* e1)
+{
+    f32 aa = 0.0f;
+    f32 ab = 0.0f;
+    f32 bb = 0.0f;
+    f32 ax[4] = {0};
+    f32 bx[4] = {0};
+    for (u32 i = 0; i < BC_PIXELS; ++i)
+    {
+        f32 w = weights[indices[i]];
+        if (w < 0.0f)
+            continue;
+        f32 a = 1.0f - w;
+        aa += a*a;
+        ab += a*w;
+        bb += w*w;
+        for (u32 channel = 0; channel < channel_count; ++channel)
+        {
+            ax[channel] += a*block->c[channel][i];
+            bx[channel] += w*block->c[channel][i];
+        }
+    }
+
+    f32 determinant = aa*bb - ab*ab;
+    if (determinant < 1e-6f)
+        return false;
+
+    f32 inv_determinant = 1.0f / determinant;
+    for (u32 channel = 0; channel < channel_count; ++channel)
+    {
+        e0[channel] = bc_clamp255((ax[channel]*bb - bx[channel]*ab)*inv_determinant);
+        e1[channel] = bc_clamp255((bx[channel]*aa - ax[channel]*ab)*inv_determinant);
+    }
+    return true;
+}
+
+//
+// NOTE(lucas): BC1
+//
+
+internal inline u16 bc1_quantize565(f32* color)
+{
+    u32 r = bc_round(color[0]*31.0f/255.0f);
+    u32 g = bc_round(color[1]*63.0f/255.0f);
+    u32 b = bc_round(color[2]*31.0f/255.0f);
+    return (u16)((r << 11) | (g << 5) | b);
+}
+
+internal inline void bc1_expand565(u16 packed, u8* rgb)
+{
+    u32 r = (packed >> 11) & 31;
+    u32 g = (packed >> 5) & 63;
+    u32 b = packed & 31;
+    rgb[0] = (u8)((r << 3) | (r >> 2));
+    rgb[1] = (u8)((g << 2) | (g >> 4));
+    rgb[2] = (u8)((b << 3) | (b >> 2));
+}
+
+// The four colors of a BC1 block. The 3-color mode (c0 <= c1) has black/transparent as its last entry.
+internal void bc1_palette(u16 c0, u16 c1, b32 four_color, u8 colors[4][4])
+{
+    bc1_expand565(c0, colors[0]);
+    bc1_expand565(c1, colors[1]);
+    colors[0][3] = 255;
+    colors[1][3] = 255;
+    for (u32 channel = 0; channel < 3; ++channel)
+    {
+        u32 a = colors[0][channel];
+        u32 b = colors[1][channel];
+        if (four_color)
+        {
+            colors[2][channel] = (u8)((2*a + b) / 3);
+            colors[3][channel] = (u8)((a + 2*b) / 3);
+        }
+        else
+        {
+            colors[2][channel] = (u8)((a + b) / 2);
+            colors[3][channel] = 0;
+        }
+    }
+    colors[2][3] = 255;
+    colors[3][3] = four_color ? 255 : 0;
+}
+
+// force_four_color is set for the color half of BC3, which always decodes as four colors
+internal void bc1_encode_block(BcBlock* block, u8* out, b32 force_four_color)
+{
+    // Pixels with alpha below half are coded as transparent, which needs the 3-color mode
+    u32 transparent_mask = 0;
+    if (!force_four_color)
+    {
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+        {
+            if (block->c[3][i] < 128.0f)
+                transparent_mask |= 1u << i;
+        }
+    }
+
+    if (transparent_mask == 0xFFFF)
+    {
+        // c0 == c1 selects the 3-color mode, and index 3 is transparent
+        memset(out, 0, 4);
+        memset(out + 4, 0xFF, 4);
+        return;
+    }
+
+    b32 three_color = (transparent_mask != 0);
+    BcBlock fit = *block;
+    if (three_color)
+    {
+        // Move transparent pixels to the mean of the opaque ones so they do not pull the endpoints
+        f32 mean[3] = {0};
+        f32 opaque_count = 0.0f;
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+        {
+            if (transparent_mask & (1u << i))
+                continue;
+            for (u32 channel = 0; channel < 3; ++channel)
+                mean[channel] += fit.c[channel][i];
+            opaque_count += 1.0f;
+        }
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+        {
+            if (transparent_mask & (1u << i))
+            {
+                for (u32 channel = 0; channel < 3; ++channel)
+                    fit.c[channel][i] = mean[channel] / opaque_count;
+            }
+        }
+    }
+
+    f32 e0[4];
+    f32 e1[4];
+    bc_fit_principal_axis(&fit, 3, e0, e1);
+
+    // Weight of c1 for each index, in palette order
+    f32 four_color_weights[4] = {0.0f, 1.0f, 1.0f/3.0f, 2.0f/3.0f};
+    f32 three_color_weights[4] = {0.0f, 1.0f, 0.5f, -1.0f};
+
+    f32 best_error = 3.4e38f;
+    u16 best_c0 = 0;
+    u16 best_c1 = 0;
+    u8 best_indices[BC_PIXELS] = {0};
+
+    for (u32 iteration = 0; iteration < 2; ++iteration)
+    {
+        u16 c0 = bc1_quantize565(e0);
+        u16 c1 = bc1_quantize565(e1);
+        if (three_color ? (c0 > c1) : (c0 < c1))
+        {
+            u16 temp = c0;
+            c0 = c1;
+            c1 = temp;
+        }
+
+        u8 colors[4][4];
+        b32 four_color = !three_color;
+        bc1_palette(c0, c1, four_color, colors);
+
+        BcPalette palette = {0};
+        palette.count = (four_color && c0 != c1) ? 4 : (three_color ? 3 : 1);
+        for (u32 entry = 0; entry < palette.count; ++entry)
+        {
+            for (u32 channel = 0; channel < 3; ++channel)
+                palette.entries[entry][channel] = colors[entry][channel];
+        }
+
+        u8 indices[BC_PIXELS];
+        f32 error = bc_select_indices(&fit, &palette, 3, indices);
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+        {
+            if (transparent_mask & (1u << i))
+                indices[i] = 3;
+        }
+
+        if (error < best_error)
+        {
+            best_error = error;
+            best_c0 = c0;
+            best_c1 = c1;
+            memcpy(best_indices, indices, sizeof(indices));
+        }
+
+        f32* weights = three_color ? three_color_weights : four_color_weights;
+        f32 refit0[4];
+        f32 refit1[4];
+        if (!bc_fit_least_squares(&fit, 3, indices, weights, refit0, refit1))
+            break;
+
+        // The palette was built from c0 and c1 after any swap, so the refit is in that order too
+        memcpy(e0, refit0, sizeof(refit0));
+        memcpy(e1, refit1, sizeof(refit1));
+    }
+
+    out[0] = (u8)best_c0;
+    out[1] = (u8)(best_c0 >> 8);
+    out[2] = (u8)best_c1;
+    out[3] = (u8)(best_c1 >> 8);
+    u32 packed = 0;
+    for (u32 i = 0; i < BC_PIXELS; ++i)
+        packed |= (u32)best_indices[i] << (2*i);
+    memcpy(out + 4, &packed, 4);
+}
+
+internal void bc1_decode_block(u8* in, u8* out, size out_stride, b32 force_four_color)
+{
+    u16 c0 = (u16)(in[0] | (in[1] << 8));
+    u16 c1 = (u16)(in[2] | (in[3] << 8));
+    u8 colors[4][4];
+    bc1_palette(c0, c1, force_four_color || c0 > c1, colors);
+
+    u32 packed;
+    memcpy(&packed, in + 4, 4);
+    for (u32 y = 0; y < 4; ++y)
+    {
+        for (u32 x = 0; x < 4; ++x)
+        {
+            u32 index = (packed >> (2*(y*4 + x))) & 3;
+            memcpy(out + y*out_stride + x*4, colors[index], 4);
+        }
+    }
+}
+
+//
+// NOTE(lucas): BC3 alpha (the same block as BC4)
+//
+
+internal void bc3_alpha_palette(u8 a0, u8 a1, u8* alphas)
+{
+    alphas[0] = a0;
+    alphas[1] = a1;
+    if (a0 > a1)
+    {
+        for (u32 i = 1; i < 7; ++i)
+            alphas[i + 1] = (u8)(((7 - i)*a0 + i*a1) / 7);
+    }
+    else
+    {
+        for (u32 i = 1; i < 5; ++i)
+            alphas[i + 1] = (u8)(((5 - i)*a0 + i*a1) / 5);
+        alphas[6] = 0;
+        alphas[7] = 255;
+    }
+}
+
+internal void bc3_encode_alpha(BcBlock* block, u8* out)
+{
+    f32 lo = 255.0f;
+    f32 hi = 0.0f;
+    for (u32 i = 0; i < BC_PIXELS; ++i)
+    {
+        f32 a = block->c[3][i];
+        lo = a < lo ? a : lo;
+        hi = a > hi ? a : hi;
+    }
+
+    u8 a0 = (u8)bc_round(hi);
+    u8 a1 = (u8)bc_round(lo);
+    u64 packed = 0;
+    if (a0 > a1)
+    {
+        u8 alphas[8];
+        bc3_alpha_palette(a0, a1, alphas);
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+        {
+            f32 a = block->c[3][i];
+            u32 best_index = 0;
+            f32 best_error = 3.4e38f;
+            for (u32 entry = 0; entry < 8; ++entry)
+            {
+                f32 error = sq_f32(a - alphas[entry]);
+                if (error < best_error)
+                {
+                    best_error = error;
+                    best_index = entry;
+                }
+            }
+            packed |= (u64)best_index << (3*i);
+        }
+    }
+
+    out[0] = a0;
+    out[1] = a1;
+    for (u32 i = 0; i < 6; ++i)
+        out[2 + i] = (u8)(packed >> (8*i));
+}
+
+internal void bc3_decode_alpha(u8* in, u8* out, size out_stride)
+{
+    u8 alphas[8];
+    bc3_alpha_palette(in[0], in[1], alphas);
+
+    u64 packed = 0;
+    for (u32 i = 0; i < 6; ++i)
+        packed |= (u64)in[2 + i] << (8*i);
+    for (u32 y = 0; y < 4; ++y)
+    {
+        for (u32 x = 0; x < 4; ++x)
+            out[y*out_stride + x*4 + 3] = alphas[(packed >> (3*(y*4 + x))) & 7];
+    }
+}
+
+//
+// NOTE(lucas): BC7
+//
+
+typedef struct
+{
+    u8* data;
+    u32 pos;
+} BcBits;
+
+internal inline void bc_write_bits(BcBits* bits, u32 value, u32 count)
+{
+    for (u32 i = 0; i < count; ++i, ++bits->pos)
+    {
+        if (value & (1u << i))
+            bits->data[bits->pos >> 3] |= (u8)(1u << (bits->pos & 7));
+    }
+}
+
+internal inline u32 bc_read_bits(BcBits* bits, u32 count)
+{
+    u32 result = 0;
+    for (u32 i = 0; i < count; ++i, ++bits->pos)
+        result |= (u32)((bits->data[bits->pos >> 3] >> (bits->pos & 7)) & 1) << i;
+    return result;
+}
+
+// Quantizes an 8-bit endpoint to 7 bits plus a p-bit shared by its four channels, trying both p-bit values
+internal void bc7_quantize_endpoint(f32* endpoint, u8* quantized, u32* p_bit)
+{
+    f32 best_error = 3.4e38f;
+    for (u32 p = 0; p < 2; ++p)
+    {
+        u8 candidate[4];
+        f32 error = 0.0f;
+        for (u32 channel = 0; channel < 4; ++channel)
+        {
+            i32 q = (i32)((endpoint[channel] - (f32)p)*0.5f + 0.5f);
+            q = q < 0 ? 0 : (q > 127 ? 127 : q);
+            candidate[channel] = (u8)q;
+            error += sq_f32(endpoint[channel] - (f32)((q << 1) | p));
+        }
+        if (error < best_error)
+        {
+            best_error = error;
+            memcpy(quantized, candidate, 4);
+            *p_bit = p;
+        }
+    }
+}
+
+internal inline u8 bc7_interpolate(u32 e0, u32 e1, u32 weight)
+{
+    return (u8)(((64 - weight)*e0 + weight*e1 + 32) >> 6);
+}
+
+internal void bc7_encode_block(BcBlock* block, u8* out)
+{
+    f32 e0[4];
+    f32 e1[4];
+    bc_fit_principal_axis(block, 4, e0, e1);
+
+    f32 weights[16];
+    for (u32 i = 0; i < 16; ++i)
+        weights[i] = bc7_weights4[i] / 64.0f;
+
+    f32 best_error = 3.4e38f;
+    u8 best_endpoints[2][4] = {0};
+    u32 best_p_bits[2] = {0};
+    u8 best_indices[BC_PIXELS] = {0};
+
+    for (u32 iteration = 0; iteration < 2; ++iteration)
+    {
+        u8 endpoints[2][4];
+        u32 p_bits[2];
+        bc7_quantize_endpoint(e0, endpoints[0], &p_bits[0]);
+        bc7_quantize_endpoint(e1, endpoints[1], &p_bits[1]);
+
+        BcPalette palette = {0};
+        palette.count = 16;
+        for (u32 entry = 0; entry < 16; ++entry)
+        {
+            for (u32 channel = 0; channel < 4; ++channel)
+            {
+                u32 a = ((u32)endpoints[0][channel] << 1) | p_bits[0];
+                u32 b = ((u32)endpoints[1][channel] << 1) | p_bits[1];
+                palette.entries[entry][channel] = bc7_interpolate(a, b, bc7_weights4[entry]);
+            }
+        }
+
+        u8 indices[BC_PIXELS];
+        f32 error = bc_select_indices(block, &palette, 4, indices);
+        if (error < best_error)
+        {
+            best_error = error;
+            memcpy(best_endpoints, endpoints, sizeof(endpoints));
+            memcpy(best_p_bits, p_bits, sizeof(p_bits));
+            memcpy(best_indices, indices, sizeof(indices));
+        }
+
+        if (error == 0.0f || !bc_fit_least_squares(block, 4, indices, weights, e0, e1))
+            break;
+    }
+
+    // The first index is stored without its top bit, so it has to be in the lower half
+    if (best_indices[0] & 8)
+    {
+        for (u32 channel = 0; channel < 4; ++channel)
+        {
+            u8 temp = best_endpoints[0][channel];
+            best_endpoints[0][channel] = best_endpoints[1][channel];
+            best_endpoints[1][channel] = temp;
+        }
+        u32 temp = best_p_bits[0];
+        best_p_bits[0] = best_p_bits[1];
+        best_p_bits[1] = temp;
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+            best_indices[i] = (u8)(15 - best_indices[i]);
+    }
+
+    memset(out, 0, 16);
+    BcBits bits = {out, 0};
+    bc_write_bits(&bits, 1u << 6, 7); // Mode 6
+    for (u32 channel = 0; channel < 4; ++channel)
+    {
+        bc_write_bits(&bits, best_endpoints[0][channel], 7);
+        bc_write_bits(&bits, best_endpoints[1][channel], 7);
+    }
+    bc_write_bits(&bits, best_p_bits[0], 1);
+    bc_write_bits(&bits, best_p_bits[1], 1);
+    for (u32 i = 0; i < BC_PIXELS; ++i)
+        bc_write_bits(&bits, best_indices[i], i ? 4 : 3);
+}
+
+internal inline u8 bc7_unquantize(u32 value, u32 bits)
+{
+    value <<= 8 - bits;
+    return (u8)(value | (value >> bits));
+}
+
+internal inline const u8* bc7_weights(u32 index_bits)
+{
+    return (index_bits == 2) ? bc7_weights2 : ((index_bits == 3) ? bc7_weights3 : bc7_weights4);
+}
+
+internal void bc7_decode_block(u8* in, u8* out, size out_stride)
+{
+    u32 mode = 0;
+    while (mode < 8 && !(in[0] & (1u << mode)))
+        ++mode;
+
+    // Reserved mode 8 (a zero first byte) decodes as transparent black
+    if (mode == 8)
+    {
+        for (u32 y = 0; y < 4; ++y)
+            memset(out + y*out_stride, 0, 16);
+        return;
+    }
+
+    u8 endpoints[3][2][4] = {0};
+    u8 subsets[BC_PIXELS] = {0};
+    u8 color_indices[BC_PIXELS] = {0};
+    u8 alpha_indices[BC_PIXELS] = {0};
+    const u8* color_weights = bc7_weights4;
+    const u8* alpha_weights = bc7_weights4;
+    u32 rotation = 0;
+
+    BcBits bits = {in, mode + 1};
+    if (mode == 4 || mode == 5)
+    {
+        rotation = bc_read_bits(&bits, 2);
+        u32 index_selection = (mode == 4) ? bc_read_bits(&bits, 1) : 0;
+        u32 color_bits = bc7_modes[mode].color_bits;
+        u32 alpha_bits = bc7_modes[mode].alpha_bits;
+        for (u32 channel = 0; channel < 3; ++channel)
+        {
+            endpoints[0][0][channel] = bc7_unquantize(bc_read_bits(&bits, color_bits), color_bits);
+            endpoints[0][1][channel] = bc7_unquantize(bc_read_bits(&bits, color_bits), color_bits);
+        }
+        endpoints[0][0][3] = bc7_unquantize(bc_read_bits(&bits, alpha_bits), alpha_bits);
+        endpoints[0][1][3] = bc7_unquantize(bc_read_bits(&bits, alpha_bits), alpha_bits);
+
+        // Mode 4 has a 2-bit and a 3-bit index set, and index_selection says which one is for color
+        u32 first_bits = 2;
+        u32 second_bits = (mode == 4) ? 3 : 2;
+        u8 first[BC_PIXELS];
+        u8 second[BC_PIXELS];
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+            first[i] = (u8)bc_read_bits(&bits, i ? first_bits : first_bits - 1);
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+            second[i] = (u8)bc_read_bits(&bits, i ? second_bits : second_bits - 1);
+
+        if (index_selection)
+        {
+            memcpy(color_indices, second, BC_PIXELS);
+            memcpy(alpha_indices, first, BC_PIXELS);
+            color_weights = bc7_weights(second_bits);
+            alpha_weights = bc7_weights(first_bits);
+        }
+        else
+        {
+            memcpy(color_indices, first, BC_PIXELS);
+            memcpy(alpha_indices, second, BC_PIXELS);
+            color_weights = bc7_weights(first_bits);
+            alpha_weights = bc7_weights(second_bits);
+        }
+    }
+    else
+    {
+        /*
+         * NOTE(lucas): Every other mode is a partition number, then the endpoints channel by channel (each channel
+         * of every endpoint of every subset before the next channel), then the p-bits, which become the lowest bit
+         * of every channel of their endpoints, then one set of indices. The index of each subset's anchor pixel
+         * drops its top bit, which the encoder makes 0 by ordering the endpoints.
+         */
+        const Bc7Mode* layout = &bc7_modes[mode];
+        u32 partition = bc_read_bits(&bits, layout->partition_bits);
+        u32 subset_count = layout->subset_count;
+        u32 channel_count = layout->alpha_bits ? 4 : 3;
+
+        u32 raw[3][2][4] = {0};
+        for (u32 channel = 0; channel < channel_count; ++channel)
+        {
+            u32 channel_bits = (channel < 3) ? layout->color_bits : layout->alpha_bits;
+            for (u32 subset = 0; subset < subset_count; ++subset)
+            {
+                raw[subset][0][channel] = bc_read_bits(&bits, channel_bits);
+                raw[subset][1][channel] = bc_read_bits(&bits, channel_bits);
+            }
+        }
+
+        u32 p_bits[3][2] = {0};
+        for (u32 subset = 0; subset < subset_count; ++subset)
+        {
+            if (layout->endpoint_p_bit)
+            {
+                p_bits[subset][0] = bc_read_bits(&bits, 1);
+                p_bits[subset][1] = bc_read_bits(&bits, 1);
+            }
+            else if (layout->shared_p_bit)
+            {
+                p_bits[subset][0] = p_bits[subset][1] = bc_read_bits(&bits, 1);
+            }
+        }
+
+        u32 p_bit_count = (layout->endpoint_p_bit || layout->shared_p_bit) ? 1 : 0;
+        for (u32 subset = 0; subset < subset_count; ++subset)
+        {
+            for (u32 end = 0; end < 2; ++end)
+            {
+                for (u32 channel = 0; channel < channel_count; ++channel)
+                {
+                    u32 channel_bits = ((channel < 3) ? layout->color_bits : layout->alpha_bits) + p_bit_count;
+                    u32 value = (raw[subset][end][channel] << p_bit_count) | p_bits[subset][end];
+                    endpoints[subset][end][channel] = bc7_unquantize(value, channel_bits);
+                }
+                if (channel_count == 3)
+                    endpoints[subset][end][3] = 255;
+            }
+        }
+
+        u32 anchors[3] = {0, 0, 0};
+        if (subset_count == 2)
+            anchors[1] = bc7_anchors2[partition];
+        if (subset_count == 3)
+        {
+            anchors[1] = bc7_anchors3_second[partition];
+            anchors[2] = bc7_anchors3_third[partition];
+        }
+
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+        {
+            if (subset_count == 2)
+                subsets[i] = (u8)((bc7_partitions2[partition] >> i) & 1);
+            else if (subset_count == 3)
+                subsets[i] = (u8)((bc7_partitions3[partition] >> (2*i)) & 3);
+
+            b32 anchor = (i == anchors[subsets[i]]);
+            color_indices[i] = (u8)bc_read_bits(&bits, layout->index_bits - (anchor ? 1 : 0));
+        }
+        memcpy(alpha_indices, color_indices, BC_PIXELS);
+        color_weights = alpha_weights = bc7_weights(layout->index_bits);
+    }
+
+    for (u32 i = 0; i < BC_PIXELS; ++i)
+    {
+        u8* pixel = out + (i >> 2)*out_stride + (i & 3)*4;
+        u8* e0 = endpoints[subsets[i]][0];
+        u8* e1 = endpoints[subsets[i]][1];
+        for (u32 channel = 0; channel < 3; ++channel)
+            pixel[channel] = bc7_interpolate(e0[channel], e1[channel], color_weights[color_indices[i]]);
+        pixel[3] = bc7_interpolate(e0[3], e1[3], alpha_weights[alpha_indices[i]]);
+
+        if (rotation)
+        {
+            u8 temp = pixel[3];
+            pixel[3] = pixel[rotation - 1];
+            pixel[rotation - 1] = temp;
+        }
+    }
+}
+
+//
+// NOTE(lucas): Whole textures
+//
+
+typedef struct
+{
+    Texture* source;
+    Texture* dest;
+    u32 first_block_row;
+    u32 block_row_count;
+} BcEncodeJob;
+
+// Reads one block, repeating the edge pixels past the right and bottom of the source
+internal void bc_load_block(Texture* source, u32 block_x, u32 block_y, BcBlock* block)
+{
+    for (u32 y = 0; y < 4; ++y)
+    {
+        u32 source_y = block_y*4 + y;
+        if (source_y >= (u32)source->height)
+            source_y = (u32)source->height - 1;
+        for (u32 x = 0; x < 4; ++x)
+        {
+            u32 source_x = block_x*4 + x;
+            if (source_x >= (u32)source->width)
+                source_x = (u32)source->width - 1;
+            u8* pixel = source->data + ((size)source_y*source->width + source_x)*4;
+            for (u32 channel = 0; channel < 4; ++channel)
+                block->c[channel][y*4 + x] = pixel[channel];
+        }
+    }
+}
+
+internal void bc_encode_block(TextureFormat format, BcBlock* block, u8* out)
+{
+    switch (format)
+    {
+        case TextureFormat_BC1: bc1_encode_block(block, out, false); break;
+        case TextureFormat_BC3:
+        {
+            bc3_encode_alpha(block, out);
+            bc1_encode_block(block, out + 8, true);
+        } break;
+        case TextureFormat_BC7: bc7_encode_block(block, out); break;
+        default: INVALID_CODE_PATH(); break;
+    }
+}
+
+internal void bc_decode_block(TextureFormat format, u8* in, u8* out, size out_stride)
+{
+    switch (format)
+    {
+        case TextureFormat_BC1: bc1_decode_block(in, out, out_stride, false); break;
+        case TextureFormat_BC3:
+        {
+            bc1_decode_block(in + 8, out, out_stride, true);
+            bc3_decode_alpha(in, out, out_stride);
+        } break;
+        case TextureFormat_BC7: bc7_decode_block(in, out, out_stride); break;
+        default: break;
+    }
+}
+
+internal void bc_encode_job(void* data)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    BcEncodeJob* job = (BcEncodeJob*)data;
+    Texture* dest = job->dest;
+    u32 block_bytes = bc_block_bytes(dest->format);
+    u32 blocks_x = ((u32)dest->width + 3) / 4;
+
+    for (u32 block_y = job->first_block_row; block_y < job->first_block_row + job->block_row_count; ++block_y)
+    {
+        u8* out = dest->data + (size)block_y*blocks_x*block_bytes;
+        for (u32 block_x = 0; block_x < blocks_x; ++block_x, out += block_bytes)
+        {
+            BcBlock block;
+            bc_load_block(job->source, block_x, block_y, &block);
+            bc_encode_block(dest->format, &block, out);
+        }
+    }
+
+    PROFILE_FUNCTION_END();
+}
+
+Texture texture_encode_bc(Texture* source, TextureFormat format, Arena* arena, WorkQueue* queue)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ASSERT(source->format == TextureFormat_RGBA8 && source->channels == 4, "Only RGBA8 textures can be encoded");
+    ASSERT(bc_block_bytes(format), "Not a block-compressed format");
+
+    Texture result = {0};
+    result.width = (source->width + 3) & ~3;
+    result.height = (source->height + 3) & ~3;
+    result.channels = 4;
+    result.format = format;
+
+    // Padding can give the result one more level than the source, which is left off
+    i32 mip_count = source->mip_count > 1 ? source->mip_count : 1;
+    i32 full_mip_count = texture_full_mip_count(result.width, result.height);
+    result.mip_count = mip_count < full_mip_count ? mip_count : full_mip_count;
+
+    result.data = push_array(arena, texture_data_size(&result), u8);
+    if (!result.data)
+    {
+        zero_struct(result);
+        PROFILE_FUNCTION_END();
+        return result;
+    }
+
+    Texture source_levels[TEXTURE_MAX_MIP_LEVELS];
+    Texture dest_levels[TEXTURE_MAX_MIP_LEVELS];
+    u32 block_rows[TEXTURE_MAX_MIP_LEVELS];
+    u32 total_block_rows = 0;
+    for (i32 level = 0; level < result.mip_count; ++level)
+    {
+        source_levels[level] = texture_mip_level(source, level);
+        dest_levels[level] = texture_mip_level(&result, level);
+        block_rows[level] = ((u32)dest_levels[level].height + 3) / 4;
+        total_block_rows += block_rows[level];
+    }
+
+    // NOTE(lucas): Each level gets a share of the jobs in proportion to its rows, and at least one, so the small
+    // levels are spread across threads along with the base level instead of waiting for it.
+    BcEncodeJob jobs[BC_MAX_ENCODE_JOBS + TEXTURE_MAX_MIP_LEVELS];
+    u32 job_index = 0;
+    for (i32 level = 0; level < result.mip_count; ++level)
+    {
+        u32 job_count = 1;
+        if (queue)
+        {
+            job_count = (u32)(((u64)block_rows[level]*BC_MAX_ENCODE_JOBS) / total_block_rows);
+            if (job_count < 1)
+                job_count = 1;
+            if (job_count > block_rows[level])
+                job_count = block_rows[level];
+        }
+
+        u32 first_row = 0;
+        for (u32 i = 0; i < job_count; ++i)
+        {
+            u32 end_row = (u32)(((u64)block_rows[level]*(i + 1)) / job_count);
+            BcEncodeJob* job = &jobs[job_index++];
+            job->source = &source_levels[level];
+            job->dest = &dest_levels[level];
+            job->first_block_row = first_row;
+            job->block_row_count = end_row - first_row;
+            first_row = end_row;
+
+            if (queue)
+                work_queue_add(queue, bc_encode_job, job);
+            else
+                bc_encode_job(job);
+        }
+    }
+    if (queue)
+        work_queue_complete_all(queue);
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+Texture texture_decode_bc(Texture* source, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    Texture result = {0};
+    u32 block_bytes = bc_block_bytes(source->format);
+    ASSERT(block_bytes, "Not a block-compressed format");
+    result.width = source->width;
+    result.height = source->height;
+    result.channels = 4;
+    result.format = TextureFormat_RGBA8;
+    result.mip_count = source->mip_count;
+    result.data = push_array(arena, texture_data_size(&result), u8);
+    if (!result.data || !block_bytes)
+    {
+        zero_struct(result);
+        PROFILE_FUNCTION_END();
+        return result;
+    }
+
+    i32 mip_count = source->mip_count > 1 ? source->mip_count : 1;
+    for (i32 level = 0; level < mip_count; ++level)
+    {
+        Texture in_level = texture_mip_level(source, level);
+        Texture out_level = texture_mip_level(&result, level);
+        u32 blocks_x = ((u32)in_level.width + 3) / 4;
+        u32 blocks_y = ((u32)in_level.height + 3) / 4;
+        size stride = (size)out_level.width*4;
+        u8* in = in_level.data;
+        for (u32 block_y = 0; block_y < blocks_y; ++block_y)
+        {
+            for (u32 block_x = 0; block_x < blocks_x; ++block_x, in += block_bytes)
+            {
+                // Blocks that hang off the edge of a small level are decoded aside and clipped
+                u32 width = (u32)out_level.width - block_x*4;
+                u32 height = (u32)out_level.height - block_y*4;
+                b32 partial = width < 4 || height < 4;
+                u8 partial_block[4*4*4];
+                u8* out = partial ? partial_block : out_level.data + (size)block_y*4*stride + block_x*16;
+                size out_stride = partial ? 16 : stride;
+                bc_decode_block(source->format, in, out, out_stride);
+
+                if (partial)
+                {
+                    width = width < 4 ? width : 4;
+                    height = height < 4 ? height : 4;
+                    for (u32 y = 0; y < height; ++y)
+                    {
+                        memcpy(out_level.data + (size)(block_y*4 + y)*stride + block_x*16, partial_block + y*16,
+                               width*4);
+                    }
+                }
+            }
+        }
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+/*
+ * NOTE(lucas): Flipping trades the engine's bottom-up rows for the top-down rows of DDS files. Only a level's own
+ * rows are reversed, and the padding that rounds it up to whole blocks stays past its last row, which is at the top
+ * in the engine and at the bottom in a file. Row r of a level h rows high goes to row h - 1 - r and back again, so
+ * the same flip works both ways.
+ *
+ * When h is a multiple of 4, or less than 4, every row stays in its block, so the rows of blocks are reversed and
+ * then the rows inside each block, without decoding them. BC1 and BC3 keep a row of indices for each row of pixels,
+ * and BC7 blocks are rewritten (see bc7_flip_block). The few BC7 blocks that can't be, and levels whose rows would
+ * move from one block to the next, are decoded, flipped and encoded again. That loses a little, and more in BC7
+ * blocks that needed several subsets, since the encoder only writes one.
+ */
+
+internal inline u32 bc_flip_row(u32 row, u32 row_count)
+{
+    return (row < row_count) ? row_count - 1 - row : row;
+}
+
+internal inline u32 bc7_subset(u32 subset_count, u32 partition, u32 pixel)
+{
+    u32 result = 0;
+    if (subset_count == 2)
+        result = (bc7_partitions2[partition] >> pixel) & 1;
+    else if (subset_count == 3)
+        result = (bc7_partitions3[partition] >> (2*pixel)) & 3;
+    return result;
+}
+
+internal inline u32 bc7_anchor(u32 subset_count, u32 partition, u32 subset)
+{
+    u32 result = 0;
+    if (subset == 1)
+        result = (subset_count == 2) ? bc7_anchors2[partition] : bc7_anchors3_second[partition];
+    else if (subset == 2)
+        result = bc7_anchors3_third[partition];
+    return result;
+}
+
+// For the two- and three-subset partitions, the partition that is each one flipped, if there is one, and which of
+// its subsets each of the original's became
+typedef struct
+{
+    u8 partitions[2][64];
+    u8 subsets[2][64][3];
+} Bc7FlipTable;
+
+#define BC7_NO_PARTITION 0xFF
+
+internal void bc7_flip_table_init(Bc7FlipTable* table, u32 row_count)
+{
+    for (u32 subset_count = 2; subset_count <= 3; ++subset_count)
+    {
+        for (u32 partition = 0; partition < 64; ++partition)
+        {
+            u8 flipped[BC_PIXELS];
+            for (u32 i = 0; i < BC_PIXELS; ++i)
+                flipped[bc_flip_row(i >> 2, row_count)*4 + (i & 3)] = (u8)bc7_subset(subset_count, partition, i);
+
+            table->partitions[subset_count - 2][partition] = BC7_NO_PARTITION;
+            for (u32 candidate = 0; candidate < 64; ++candidate)
+            {
+                u8 subsets[3] = {BC7_NO_PARTITION, BC7_NO_PARTITION, BC7_NO_PARTITION};
+                u32 taken = 0;
+                b32 same = true;
+                for (u32 i = 0; i < BC_PIXELS && same; ++i)
+                {
+                    u32 from = flipped[i];
+                    u32 to = bc7_subset(subset_count, candidate, i);
+                    if (subsets[from] == BC7_NO_PARTITION && !(taken & (1u << to)))
+                    {
+                        subsets[from] = (u8)to;
+                        taken |= 1u << to;
+                    }
+                    same = (subsets[from] == to);
+                }
+
+                if (same)
+                {
+                    table->partitions[subset_count - 2][partition] = (u8)candidate;
+                    memcpy(table->subsets[subset_count - 2][partition], subsets, sizeof(subsets));
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Swaps a subset's endpoints in the given channels and turns its indices around, which gives the same colors
+internal void bc7_swap_endpoints(u32 raw[3][2][4], u32 p_bits[3][2], u32 subset, u32 first_channel,
+                                 u32 channel_end)
+{
+    for (u32 channel = first_channel; channel < channel_end; ++channel)
+    {
+        u32 temp = raw[subset][0][channel];
+        raw[subset][0][channel] = raw[subset][1][channel];
+        raw[subset][1][channel] = temp;
+    }
+    u32 temp = p_bits[subset][0];
+    p_bits[subset][0] = p_bits[subset][1];
+    p_bits[subset][1] = temp;
+}
+
+/*
+ * NOTE(lucas): Rewrites a BC7 block with its rows flipped, bit for bit the same colors. The indices move with their
+ * pixels and the partition becomes the one with the flipped shape. Each subset's anchor pixel has to have the top bit
+ * of its index clear, so where it doesn't, that subset's endpoints trade places and its indices are turned around.
+ * The interpolation weights are symmetric, so that doesn't change a color either. Returns false for the few
+ * partitions whose flipped shape isn't one of the others.
+ */
+internal b32 bc7_flip_block(u8* block, u32 row_count, Bc7FlipTable* table)
+{
+    u32 mode = 0;
+    while (mode < 8 && !(block[0] & (1u << mode)))
+        ++mode;
+    if (mode == 8)
+        return true;
+
+    const Bc7Mode* layout = &bc7_modes[mode];
+    b32 separate_alpha = (mode == 4 || mode == 5);
+    u32 subset_count = layout->subset_count;
+    u32 channel_count = layout->alpha_bits ? 4 : 3;
+    u32 p_bit_count = (layout->endpoint_p_bit ? 2 : 0) + (layout->shared_p_bit ? 1 : 0);
+
+    BcBits bits = {block, mode + 1};
+    u32 rotation = 0;
+    u32 index_selection = 0;
+    u32 partition = 0;
+    if (separate_alpha)
+    {
+        rotation = bc_read_bits(&bits, 2);
+        index_selection = (mode == 4) ? bc_read_bits(&bits, 1) : 0;
+    }
+    else
+    {
+        partition = bc_read_bits(&bits, layout->partition_bits);
+    }
+
+    u32 raw[3][2][4] = {0};
+    for (u32 channel = 0; channel < channel_count; ++channel)
+    {
+        u32 channel_bits = (channel < 3) ? layout->color_bits : layout->alpha_bits;
+        for (u32 subset = 0; subset < subset_count; ++subset)
+        {
+            raw[subset][0][channel] = bc_read_bits(&bits, channel_bits);
+            raw[subset][1][channel] = bc_read_bits(&bits, channel_bits);
+        }
+    }
+
+    u32 p_bits[3][2] = {0};
+    for (u32 subset = 0; subset < subset_count; ++subset)
+    {
+        if (p_bit_count == 2)
+        {
+            p_bits[subset][0] = bc_read_bits(&bits, 1);
+            p_bits[subset][1] = bc_read_bits(&bits, 1);
+        }
+        else if (p_bit_count == 1)
+        {
+            p_bits[subset][0] = p_bits[subset][1] = bc_read_bits(&bits, 1);
+        }
+    }
+
+    // Modes 4 and 5 have a second set of indices, for alpha unless index_selection swaps them
+    u32 set_count = separate_alpha ? 2 : 1;
+    u32 set_bits[2] = {layout->index_bits, (mode == 4) ? 3 : 2};
+    if (separate_alpha)
+        set_bits[0] = 2;
+    u8 indices[2][BC_PIXELS];
+    for (u32 set = 0; set < set_count; ++set)
+    {
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+        {
+            u32 subset = bc7_subset(subset_count, partition, i);
+            b32 anchor = (i == bc7_anchor(subset_count, partition, subset));
+            u32 index = bc_read_bits(&bits, set_bits[set] - (anchor ? 1 : 0));
+            indices[set][bc_flip_row(i >> 2, row_count)*4 + (i & 3)] = (u8)index;
+        }
+    }
+
+    u32 flipped_partition = partition;
+    if (subset_count > 1)
+    {
+        flipped_partition = table->partitions[subset_count - 2][partition];
+        if (flipped_partition >= (1u << layout->partition_bits))
+            return false;
+
+        u8* subsets = table->subsets[subset_count - 2][partition];
+        u32 moved_raw[3][2][4];
+        u32 moved_p_bits[3][2];
+        for (u32 subset = 0; subset < subset_count; ++subset)
+        {
+            memcpy(moved_raw[subsets[subset]], raw[subset], sizeof(raw[subset]));
+            memcpy(moved_p_bits[subsets[subset]], p_bits[subset], sizeof(p_bits[subset]));
+        }
+        memcpy(raw, moved_raw, sizeof(raw));
+        memcpy(p_bits, moved_p_bits, sizeof(p_bits));
+    }
+
+    for (u32 set = 0; set < set_count; ++set)
+    {
+        u32 top_bit = 1u << (set_bits[set] - 1);
+        u32 last_index = (1u << set_bits[set]) - 1;
+        for (u32 subset = 0; subset < subset_count; ++subset)
+        {
+            if (!(indices[set][bc7_anchor(subset_count, flipped_partition, subset)] & top_bit))
+                continue;
+
+            // The first set of modes 4 and 5 goes with the color endpoints, or the alpha ones if swapped
+            u32 first_channel = 0;
+            u32 channel_end = channel_count;
+            if (separate_alpha)
+            {
+                b32 alpha = (set == 1) != (index_selection == 1);
+                first_channel = alpha ? 3 : 0;
+                channel_end = alpha ? 4 : 3;
+            }
+            bc7_swap_endpoints(raw, p_bits, subset, first_channel, channel_end);
+            for (u32 i = 0; i < BC_PIXELS; ++i)
+            {
+                if (bc7_subset(subset_count, flipped_partition, i) == subset)
+                    indices[set][i] = (u8)(last_index - indices[set][i]);
+            }
+        }
+    }
+
+    memset(block, 0, 16);
+    bits.pos = 0;
+    bc_write_bits(&bits, 1u << mode, mode + 1);
+    if (separate_alpha)
+    {
+        bc_write_bits(&bits, rotation, 2);
+        if (mode == 4)
+            bc_write_bits(&bits, index_selection, 1);
+    }
+    else
+    {
+        bc_write_bits(&bits, flipped_partition, layout->partition_bits);
+    }
+    for (u32 channel = 0; channel < channel_count; ++channel)
+    {
+        u32 channel_bits = (channel < 3) ? layout->color_bits : layout->alpha_bits;
+        for (u32 subset = 0; subset < subset_count; ++subset)
+        {
+            bc_write_bits(&bits, raw[subset][0][channel], channel_bits);
+            bc_write_bits(&bits, raw[subset][1][channel], channel_bits);
+        }
+    }
+    for (u32 subset = 0; subset < subset_count; ++subset)
+    {
+        if (p_bit_count == 2)
+        {
+            bc_write_bits(&bits, p_bits[subset][0], 1);
+            bc_write_bits(&bits, p_bits[subset][1], 1);
+        }
+        else if (p_bit_count == 1)
+        {
+            bc_write_bits(&bits, p_bits[subset][0], 1);
+        }
+    }
+    for (u32 set = 0; set < set_count; ++set)
+    {
+        for (u32 i = 0; i < BC_PIXELS; ++i)
+        {
+            u32 subset = bc7_subset(subset_count, flipped_partition, i);
+            b32 anchor = (i == bc7_anchor(subset_count, flipped_partition, subset));
+            bc_write_bits(&bits, indices[set][i], set_bits[set] - (anchor ? 1 : 0));
+        }
+    }
+    return true;
+}
+
+// Reverses the first row_count rows of a block
+internal void bc_flip_block(TextureFormat format, u8* block, u32 row_count, Bc7FlipTable* table)
+{
+    if (format == TextureFormat_BC7)
+    {
+        if (!bc7_flip_block(block, row_count, table))
+        {
+            u8 pixels[4*4*4];
+            bc7_decode_block(block, pixels, 16);
+            BcBlock flipped;
+            for (u32 i = 0; i < BC_PIXELS; ++i)
+            {
+                u32 to = bc_flip_row(i >> 2, row_count)*4 + (i & 3);
+                for (u32 channel = 0; channel < 4; ++channel)
+                    flipped.c[channel][to] = pixels[i*4 + channel];
+            }
+            bc7_encode_block(&flipped, block);
+        }
+        return;
+    }
+
+    if (format == TextureFormat_BC3)
+    {
+        u64 alpha = 0;
+        for (u32 i = 0; i < 6; ++i)
+            alpha |= (u64)block[2 + i] << (8*i);
+        u64 flipped = 0;
+        for (u32 row = 0; row < 4; ++row)
+            flipped |= ((alpha >> (12*row)) & 0xFFF) << (12*bc_flip_row(row, row_count));
+        for (u32 i = 0; i < 6; ++i)
+            block[2 + i] = (u8)(flipped >> (8*i));
+        block += 8;
+    }
+
+    u8 rows[4];
+    memcpy(rows, block + 4, 4);
+    for (u32 row = 0; row < 4; ++row)
+        block[4 + bc_flip_row(row, row_count)] = rows[row];
+}
+
+// Decodes the level's blocks aside and encodes them again from the flipped rows, repeating the edge into the padding
+internal b32 bc_flip_level_across_blocks(Texture* level, Arena* arena)
+{
+    u32 block_bytes = bc_block_bytes(level->format);
+    u32 blocks_x = ((u32)level->width + 3) / 4;
+    u32 blocks_y = ((u32)level->height + 3) / 4;
+    size stride = (size)blocks_x*16;
+    u8* pixels = push_array(arena, stride*blocks_y*4, u8);
+    if (!pixels)
+        return false;
+
+    u8* in = level->data;
+    for (u32 block_y = 0; block_y < blocks_y; ++block_y)
+    {
+        for (u32 block_x = 0; block_x < blocks_x; ++block_x, in += block_bytes)
+            bc_decode_block(level->format, in, pixels + (size)block_y*4*stride + block_x*16, stride);
+    }
+
+    u32 height = (u32)level->height;
+    u8* out = level->data;
+    for (u32 block_y = 0; block_y < blocks_y; ++block_y)
+    {
+        for (u32 block_x = 0; block_x < blocks_x; ++block_x, out += block_bytes)
+        {
+            BcBlock block;
+            for (u32 y = 0; y < 4; ++y)
+            {
+                u32 row = block_y*4 + y;
+                u32 source_row = (row < height) ? height - 1 - row : 0;
+                u8* pixel = pixels + (size)source_row*stride + block_x*16;
+                for (u32 x = 0; x < 4; ++x, pixel += 4)
+                {
+                    for (u32 channel = 0; channel < 4; ++channel)
+                        block.c[channel][y*4 + x] = pixel[channel];
+                }
+            }
+            bc_encode_block(level->format, &block, out);
+        }
+    }
+    return true;
+}
+
+b32 texture_flip_bc(Texture* texture, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    b32 result = true;
+    u32 block_bytes = bc_block_bytes(texture->format);
+    i32 mip_count = texture->mip_count > 1 ? texture->mip_count : 1;
+    for (i32 level = 0; level < mip_count && result; ++level)
+    {
+        Texture level_texture = texture_mip_level(texture, level);
+        u32 height = (u32)level_texture.height;
+        if (height > 4 && height % 4)
+        {
+            size saved_used = arena->used;
+            result = bc_flip_level_across_blocks(&level_texture, arena);
+            arena_pop(arena, arena->used - saved_used);
+            continue;
+        }
+
+        u32 row_count = (height < 4) ? height : 4;
+        Bc7FlipTable table;
+        if (texture->format == TextureFormat_BC7)
+            bc7_flip_table_init(&table, row_count);
+
+        u32 blocks_x = ((u32)level_texture.width + 3) / 4;
+        u32 blocks_y = ((u32)level_texture.height + 3) / 4;
+        size row_bytes = (size)blocks_x*block_bytes;
+        for (u32 block_y = 0; block_y < (blocks_y + 1) / 2; ++block_y)
+        {
+            u8* top = level_texture.data + (size)block_y*row_bytes;
+            u8* bottom = level_texture.data + (size)(blocks_y - 1 - block_y)*row_bytes;
+            for (size i = 0; i < row_bytes; i += block_bytes)
+            {
+                bc_flip_block(texture->format, top + i, row_count, &table);
+                if (bottom == top)
+                    continue;
+                bc_flip_block(texture->format, bottom + i, row_count, &table);
+                for (u32 b = 0; b < block_bytes; ++b)
+                {
+                    u8 temp = top[i + b];
+                    top[i + b] = bottom[i + b];
+                    bottom[i + b] = temp;
+                }
+            }
+        }
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
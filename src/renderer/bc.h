@@ -0,0 +1,36 @@
+#pragma once
+
+#include "grapple_memory.h"
+#include "texture.h"
+#include "thread.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Block compression. Every format codes 4x4 pixel blocks independently:
+ *   BC1: two RGB565 endpoints and 2-bit indices (8 bytes). Blocks with transparent pixels use the 3-color mode.
+ *   BC3: a BC1 color block plus two 8-bit alpha endpoints and 3-bit indices (16 bytes).
+ *   BC7: the encoder only writes mode 6, a single RGBA subset with 7-bit endpoints, p-bits and 4-bit indices
+ *        (16 bytes). The decoder handles all eight modes, including the partitioned ones other encoders use.
+ *
+ * Blocks are kept in the engine's bottom-up row order, like every other texture, and are flipped from and to the
+ * top-down order of DDS files when they are read and written.
+ *
+ * Encoding fits endpoints along the principal axis of the block's colors, picks the nearest palette entry for each
+ * pixel (four pixels at a time with SSE2), then refits the endpoints by least squares and keeps whichever is better.
+ * It is meant for baking assets offline, not for use at load time.
+ */
+
+#define BC_BLOCK_DIM 4
+
+u32 bc_block_bytes(TextureFormat format);
+
+// Encodes an RGBA8 texture along with its mip levels. The result is padded to whole blocks by repeating the edge
+// pixels. Rows of blocks are spread across the queue's threads when queue is not 0.
+Texture texture_encode_bc(Texture* source, TextureFormat format, Arena* arena, WorkQueue* queue);
+
+// Decodes a block-compressed texture and its mip levels to RGBA8
+Texture texture_decode_bc(Texture* source, Arena* arena);
+
+// Reverses the row order of a texture and its mip levels in place, between the engine's order and DDS's. Levels
+// that have to be encoded again are decoded onto the arena first, and false is returned if it is full.
+b32 texture_flip_bc(Texture* texture, Arena* arena);
@@ -0,0 +1,262 @@
+#include "containers.h"
+#include "file.h"
+#include "grapple_memory.h"
+#include "renderer/capture.h"
+#include "renderer/renderer.h"
+
+#include <string.h> // memcpy
+
+// Texture address to capture id
+HASH_MAP_DEFINE(CaptureTextureMap, capture_texture_map, u64, u32, hash_u64, hash_u64_equal)
+
+typedef struct
+{
+    void* file;
+    size used;
+    u8 data[KILOBYTES(256)];
+    size pending_padding; // Written before the next record so every record starts 8-byte aligned
+
+    // Textures that have already been written. The arena is kept between captures.
+    Arena arena;
+    CaptureTextureMap textures;
+    u32 texture_count;
+    b32 out_of_memory;
+} RenderCapture;
+
+global RenderCapture global_capture;
+
+internal void capture_flush(void)
+{
+    RenderCapture* capture = &global_capture;
+    if (capture->used)
+        file_write(capture->file, capture->data, capture->used);
+    capture->used = 0;
+}
+
+internal void capture_write(void* data, size bytes)
+{
+    RenderCapture* capture = &global_capture;
+    if (capture->used + bytes > (size)sizeof(capture->data))
+        capture_flush();
+
+    // Large payloads like texture pixels skip the buffer
+    if (bytes > (size)sizeof(capture->data))
+    {
+        file_write(capture->file, data, bytes);
+        return;
+    }
+
+    memcpy(capture->data + capture->used, data, (usize)bytes);
+    capture->used += bytes;
+}
+
+// Writes the header and fixed part of a record. The caller writes the extra_size bytes of payload after it.
+internal void capture_write_record(CaptureRecordType type, void* record, size record_size, size extra_size)
+{
+    RenderCapture* capture = &global_capture;
+    u8 padding[CAPTURE_RECORD_ALIGNMENT] = {0};
+    if (capture->pending_padding)
+        capture_write(padding, capture->pending_padding);
+
+    size payload_size = record_size + extra_size;
+    size padded_size = (payload_size + CAPTURE_RECORD_ALIGNMENT-1) & ~(size)(CAPTURE_RECORD_ALIGNMENT-1);
+    capture->pending_padding = padded_size - payload_size;
+
+    CaptureRecordHeader header = {0};
+    header.type = type;
+    header.size = (u32)padded_size;
+    capture_write(&header, sizeof(header));
+    capture_write(record, record_size);
+}
+
+b32 capture_begin(char* filename)
+{
+    RenderCapture* capture = &global_capture;
+    ASSERT(!capture->file, "A capture is already active");
+    if (capture->file)
+        return false;
+
+    if (!capture->arena.data)
+        capture->arena = arena_alloc(CAPTURE_MEMORY);
+    arena_clear(&capture->arena);
+    if (!capture_texture_map_init(&capture->textures, &capture->arena, 256))
+        return false;
+
+    capture->file = file_open(filename, FileMode_Write|FileMode_Create);
+    if (!capture->file)
+        return false;
+    capture->used = 0;
+    capture->pending_padding = 0;
+    capture->texture_count = 0;
+    capture->out_of_memory = false;
+
+    CaptureFileHeader header = {0};
+    header.magic = CAPTURE_MAGIC;
+    header.version = CAPTURE_VERSION;
+    capture_write(&header, sizeof(header));
+
+    return true;
+}
+
+b32 capture_end(void)
+{
+    RenderCapture* capture = &global_capture;
+    if (!capture->file)
+        return !capture->out_of_memory;
+
+    u8 padding[CAPTURE_RECORD_ALIGNMENT] = {0};
+    if (capture->pending_padding)
+        capture_write(padding, capture->pending_padding);
+    capture->pending_padding = 0;
+
+    capture_flush();
+    file_close(capture->file);
+    capture->file = 0;
+    return !capture->out_of_memory;
+}
+
+b32 capture_is_active(void)
+{
+    return global_capture.file != 0;
+}
+
+/*
+ * NOTE(lucas): Gets the capture id of texture, writing its contents the first time it is seen. Returns false if there
+ * is no memory left to remember a new texture, which ends the capture instead of giving the draw another texture's id.
+ * The caller then skips the record, so the file ends cleanly after the last one that could be replayed.
+ */
+internal b32 capture_texture_id(Texture* texture, u32* id)
+{
+    RenderCapture* capture = &global_capture;
+    u64 key = (u64)(usize)texture;
+    u32* known = capture_texture_map_get(&capture->textures, key);
+    if (known)
+    {
+        *id = *known;
+        return true;
+    }
+
+    if (!capture_texture_map_put(&capture->textures, key, capture->texture_count))
+    {
+        ASSERT(0, "Out of memory for the capture's textures");
+        capture->out_of_memory = true;
+        capture_end();
+        return false;
+    }
+    *id = capture->texture_count++;
+
+    CaptureTexture record = {0};
+    record.id = *id;
+    if (texture && texture->data)
+    {
+        record.width = texture->width;
+        record.height = texture->height;
+        record.channels = texture->channels;
+        record.format = texture->format;
+        record.mip_count = texture->mip_count;
+    }
+    size pixel_bytes = (texture && texture->data) ? texture_data_size(texture) : 0;
+    capture_write_record(CaptureRecord_Texture, &record, sizeof(record), pixel_bytes);
+    if (pixel_bytes)
+        capture_write(texture->data, pixel_bytes);
+
+    return true;
+}
+
+void capture_frame_begin(i32 width, i32 height, rect damage, b32 has_damage)
+{
+    if (!global_capture.file) return;
+
+    CaptureFrameBegin record = {0};
+    record.width = width;
+    record.height = height;
+    record.damage = damage;
+    record.has_damage = has_damage;
+    capture_write_record(CaptureRecord_FrameBegin, &record, sizeof(record), 0);
+}
+
+void capture_frame_end(i32 total_quads, i32 batch_count)
+{
+    if (!global_capture.file) return;
+
+    CaptureFrameEnd record = {0};
+    record.total_quads = total_quads;
+    record.batch_count = batch_count;
+    capture_write_record(CaptureRecord_FrameEnd, &record, sizeof(record), 0);
+}
+
+void capture_set_projection(m4 proj)
+{
+    if (!global_capture.file) return;
+    capture_write_record(CaptureRecord_SetProjection, &proj, sizeof(proj), 0);
+}
+
+void capture_clear(v4 color)
+{
+    if (!global_capture.file) return;
+    capture_write_record(CaptureRecord_Clear, &color, sizeof(color), 0);
+}
+
+void capture_draw_texture(Texture* texture, v2 pos, v2 dim)
+{
+    if (!global_capture.file) return;
+
+    CaptureDrawTexture record = {0};
+    if (!capture_texture_id(texture, &record.texture_id))
+        return;
+    record.pos = pos;
+    record.dim = dim;
+    capture_write_record(CaptureRecord_DrawTexture, &record, sizeof(record), 0);
+}
+
+void capture_draw_quads(Texture* texture, QuadsSoA quads, size count, m2x3* transform, rect* clip)
+{
+    if (!global_capture.file || count <= 0) return;
+
+    CaptureDrawQuads record = {0};
+    if (!capture_texture_id(texture, &record.texture_id))
+        return;
+    record.count = (u32)count;
+    if (transform)
+    {
+        record.has_transform = true;
+        record.transform = *transform;
+    }
+    if (clip)
+    {
+        record.has_clip = true;
+        record.clip = *clip;
+    }
+
+    f32* arrays[] = {quads.x, quads.y, quads.w, quads.h, quads.u0, quads.v0, quads.u1, quads.v1};
+    size array_bytes = count*(size)sizeof(f32);
+    capture_write_record(CaptureRecord_DrawQuads, &record, sizeof(record), (size)countof(arrays)*array_bytes);
+    for (size i = 0; i < (size)countof(arrays); ++i)
+        capture_write(arrays[i], array_bytes);
+}
+
+void capture_draw_list_command(Texture* texture, Vertex* vertices, u32 quad_count)
+{
+    if (!global_capture.file || !quad_count) return;
+
+    CaptureDrawListCommand record = {0};
+    if (!capture_texture_id(texture, &record.texture_id))
+        return;
+    record.quad_count = quad_count;
+    size vertex_bytes = (size)quad_count*4*(size)sizeof(Vertex);
+    capture_write_record(CaptureRecord_DrawListCommand, &record, sizeof(record), vertex_bytes);
+    capture_write(vertices, vertex_bytes);
+}
+
+void capture_text(s8 text, rect bounds, v4 color)
+{
+    if (!global_capture.file) return;
+
+    CaptureText record = {0};
+    record.bounds = bounds;
+    record.color = color;
+    record.text_len = (u32)text.len;
+    capture_write_record(CaptureRecord_Text, &record, sizeof(record), text.len);
+    if (text.len)
+        capture_write(text.data, text.len);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "grapple_math.h"
+#include "str.h"
+#include "texture.h"
+#include "types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Vertex Vertex;
+
+/*
+ * NOTE(lucas): Render capture. While a capture is active, every call made to the renderer is serialized to a file
+ * along with the contents of each texture the first time it is referenced. grapple_replay re-submits the stream to
+ * any backend and times it, so a slow frame from the field can be turned into a repeatable benchmark.
+ *
+ * Calls are recorded as they were made, before damage culling, so the replay does the same work the original did.
+ * Hooks only run on the render thread. Draw lists filled on workers are recorded when they are merged.
+ */
+
+#define CAPTURE_MAGIC 0x50435247 // "GRCP"
+#define CAPTURE_VERSION 3
+#define CAPTURE_MEMORY MEGABYTES(64) // For the map of textures already written, touched only as it fills
+#define CAPTURE_RECORD_ALIGNMENT 8
+
+typedef enum
+{
+    CaptureRecord_None = 0,
+    CaptureRecord_FrameBegin,
+    CaptureRecord_FrameEnd,
+    CaptureRecord_SetProjection,
+    CaptureRecord_Clear,
+    CaptureRecord_Texture,
+    CaptureRecord_DrawTexture,
+    CaptureRecord_DrawQuads,
+    CaptureRecord_DrawListCommand,
+    CaptureRecord_Text,
+
+    CaptureRecord_Count
+} CaptureRecordType;
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+} CaptureFileHeader;
+
+// Every record is a header followed by size bytes of payload, padded so the next header is 8-byte aligned
+typedef struct
+{
+    u32 type;
+    u32 size;
+} CaptureRecordHeader;
+
+typedef struct
+{
+    i32 width;
+    i32 height;
+    rect damage;
+    b32 has_damage;
+} CaptureFrameBegin;
+
+// Batch statistics at the end of the original frame, so the replay can check it did the same work
+typedef struct
+{
+    i32 total_quads;
+    i32 batch_count;
+} CaptureFrameEnd;
+
+// Followed by texture_data_size bytes of pixels or blocks. Ids count up from 0 in the order textures are first drawn,
+// so each one is the number of textures written before it.
+typedef struct
+{
+    u32 id;
+    i32 width;
+    i32 height;
+    i32 channels;
+    i32 format; // TextureFormat
+    i32 mip_count;
+} CaptureTexture;
+
+typedef struct
+{
+    u32 texture_id;
+    v2 pos;
+    v2 dim;
+} CaptureDrawTexture;
+
+// Followed by the 8 SoA arrays, count f32 each, in QuadsSoA member order
+typedef struct
+{
+    u32 texture_id;
+    u32 count;
+    b32 has_transform;
+    b32 has_clip;
+    m2x3 transform;
+    rect clip;
+} CaptureDrawQuads;
+
+// Followed by quad_count*4 vertices
+typedef struct
+{
+    u32 texture_id;
+    u32 quad_count;
+} CaptureDrawListCommand;
+
+// Followed by text_len bytes of UTF-8
+typedef struct
+{
+    rect bounds;
+    v4 color;
+    u32 text_len;
+} CaptureText;
+
+b32 capture_begin(char* filename);
+// Returns false if the capture stopped early because it ran out of memory for its textures. The file then holds every
+// record up to that point.
+b32 capture_end(void);
+b32 capture_is_active(void);
+
+void capture_frame_begin(i32 width, i32 height, rect damage, b32 has_damage);
+void capture_frame_end(i32 total_quads, i32 batch_count);
+void capture_set_projection(m4 proj);
+void capture_clear(v4 color);
+void capture_draw_texture(Texture* texture, v2 pos, v2 dim);
+void capture_draw_quads(Texture* texture, QuadsSoA quads, size count, m2x3* transform, rect* clip);
+void capture_draw_list_command(Texture* texture, Vertex* vertices, u32 quad_count);
+void capture_text(s8 text, rect bounds, v4 color);
+
+#ifdef __cplusplus
+}
+#endif
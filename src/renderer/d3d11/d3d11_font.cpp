@@ -1,11 +1,11 @@
+#include "profiler.h"
+#include "renderer/capture.h"
 #include "renderer/font.h"
 #include "platform/windows/win32_base.h"
 
 #include "d3d11_renderer.h"
 
-#include "grapple_memory.c"
-
-#include <d3d11.h>
+#include <d3d11_1.h>
 #include <d2d1_1.h>
 #include <d2d1_1helper.h>
 #include <dwrite.h>
@@ -19,10 +19,11 @@ struct TextRenderer
     Arena scratch_arena;
 };
 
-extern "C" TextRenderer* text_renderer_create(void* window_ptr, IDXGISwapChain* swap_chain, Arena* arena)
+extern "C" TextRenderer* text_renderer_create(void* window_ptr, ID3D11Texture2D* target, Arena* arena)
 {
     TextRenderer* tr = push_struct(arena, TextRenderer);
     tr->scratch_arena = arena_alloc(KILOBYTES(1));
+    arena_register(&tr->scratch_arena, "text_scratch");
 
     f32 dpi = (f32)GetDpiForWindow((HWND)window_ptr);
 
@@ -32,7 +33,7 @@ extern "C" TextRenderer* text_renderer_create(void* window_ptr, IDXGISwapChain*
     (void**)&d2d_factory));
 
     IDXGISurface* dxgi_surface = NULL;
-    HR(swap_chain->GetBuffer(0, __uuidof(IDXGISurface), (void**)&dxgi_surface));
+    HR(target->QueryInterface(__uuidof(IDXGISurface), (void**)&dxgi_surface));
 
     D2D1_RENDER_TARGET_PROPERTIES props = {};
     props.dpiX = dpi;
@@ -66,20 +67,42 @@ extern "C" void text_renderer_destroy(TextRenderer* tr)
 
 extern "C" void text_draw_rect(Renderer* renderer, s8 text, rect bounds, v4 color)
 {
+    capture_text(text, bounds, color);
+    if (!renderer->has_damage || !rect_overlaps(renderer->damage, bounds))
+        return;
+
+    PROFILE_FUNCTION_BEGIN();
+
     TextRenderer* tr = renderer->text_renderer;
     wchar_t* wide_buf = push_array(&tr->scratch_arena, text.len, wchar_t);
+    if (!wide_buf)
+    {
+        // Longer than the scratch arena; the overflow shows up in the arena stats
+        PROFILE_FUNCTION_END();
+        return;
+    }
     int wide_len = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, (const char*)text.data, (int)text.len,
                                        wide_buf, (int)text.len);
     ASSERT(wide_len > 0, "Conversion to UTF-16 failed!");
-    if (wide_len <= 0) return;
+    if (wide_len <= 0)
+    {
+        PROFILE_FUNCTION_END();
+        return;
+    }
 
+    rect clip = renderer->damage;
     tr->render_target->BeginDraw();
+    tr->render_target->PushAxisAlignedClip(D2D1::RectF(clip.min.x, clip.min.y, clip.max.x, clip.max.y),
+                                           D2D1_ANTIALIAS_MODE_ALIASED);
     tr->brush->SetColor(D2D1::ColorF(color.r, color.g, color.b, color.a));
     tr->render_target->DrawText(wide_buf, (UINT32)text.len, tr->text_format,
                                 D2D1::RectF(bounds.min.x, bounds.min.y, bounds.max.x, bounds.max.y), tr->brush);
+    tr->render_target->PopAxisAlignedClip();
     HR(tr->render_target->EndDraw());
 
     arena_pop(&tr->scratch_arena, text.len*sizeof(wchar_t));
+
+    PROFILE_FUNCTION_END();
 }
 
 extern "C" void text_draw(Renderer* renderer, s8 text, v2 pos, v2 dim, v4 color)
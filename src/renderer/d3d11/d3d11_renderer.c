@@ -1,4 +1,7 @@
 #include "grapple_math.h"
+#include "profiler.h"
+#include "renderer/bc.h"
+#include "renderer/capture.h"
 #include "renderer/font.h"
 #include "renderer/renderer.h"
 
@@ -9,7 +12,7 @@
 #include "shaders/compiled/d3d11_vshader.h"
 
 #include <crtdbg.h>
-#include <d3d11.h>
+#include <d3d11_1.h>
 #include <windows.h>
 
 internal Renderer* renderer_create(Window* window, Arena* arena)
@@ -19,6 +22,8 @@ internal Renderer* renderer_create(Window* window, Arena* arena)
 #endif
 
     Renderer* renderer = push_struct(arena, Renderer);
+    renderer->width = window->width;
+    renderer->height = window->height;
 
     UINT flags = D3D11_CREATE_DEVICE_SINGLETHREADED | D3D11_CREATE_DEVICE_BGRA_SUPPORT;
 #ifdef GRAPPLE_DEBUG
@@ -66,13 +71,32 @@ internal Renderer* renderer_create(Window* window, Arena* arena)
     com_release(dxgi_adapter);
     com_release(dxgi_factory);
 
-    ID3D11Texture2D* back_buffer = 0;
-    HR(renderer->swap_chain->lpVtbl->GetBuffer(renderer->swap_chain, 0, &IID_ID3D11Texture2D, (void**)(&back_buffer)));
-    HR(renderer->device->lpVtbl->CreateRenderTargetView(renderer->device, (ID3D11Resource*)back_buffer, NULL,
+    HR(renderer->ctx->lpVtbl->QueryInterface(renderer->ctx, &IID_ID3D11DeviceContext1, (void**)(&renderer->ctx1)));
+
+    // With flip-model swap chains, buffer 0 always refers to the current back buffer
+    HR(renderer->swap_chain->lpVtbl->GetBuffer(renderer->swap_chain, 0, &IID_ID3D11Texture2D,
+                                               (void**)(&renderer->back_buffer)));
+
+    D3D11_TEXTURE2D_DESC canvas_desc = {0};
+    renderer->back_buffer->lpVtbl->GetDesc(renderer->back_buffer, &canvas_desc);
+    canvas_desc.Usage = D3D11_USAGE_DEFAULT;
+    canvas_desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    canvas_desc.CPUAccessFlags = 0;
+    canvas_desc.MiscFlags = 0;
+    HR(renderer->device->lpVtbl->CreateTexture2D(renderer->device, &canvas_desc, NULL, &renderer->canvas));
+    HR(renderer->device->lpVtbl->CreateRenderTargetView(renderer->device, (ID3D11Resource*)renderer->canvas, NULL,
        &renderer->render_target_view));
-    com_release(back_buffer);
     renderer->ctx->lpVtbl->OMSetRenderTargets(renderer->ctx, 1, &renderer->render_target_view, NULL);
 
+    // Same as the default rasterizer state, plus scissoring to the damaged region
+    D3D11_RASTERIZER_DESC rasterizer_desc = {0};
+    rasterizer_desc.FillMode = D3D11_FILL_SOLID;
+    rasterizer_desc.CullMode = D3D11_CULL_BACK;
+    rasterizer_desc.DepthClipEnable = TRUE;
+    rasterizer_desc.ScissorEnable = TRUE;
+    HR(renderer->device->lpVtbl->CreateRasterizerState(renderer->device, &rasterizer_desc,
+                                                       &renderer->rasterizer_state));
+
     D3D11_VIEWPORT vp = {0};
     vp.TopLeftX = 0.0f;
     vp.TopLeftY = 0.0f;
@@ -138,6 +162,16 @@ internal Renderer* renderer_create(Window* window, Arena* arena)
     sampler_desc.MaxLOD = D3D11_FLOAT32_MAX;
     HR(renderer->device->lpVtbl->CreateSamplerState(renderer->device, &sampler_desc, &renderer->sampler_state));
 
+    // Textures with mips are drawn smaller than their size, so minification blends between the two nearest levels.
+    // Magnification stays point sampled like everything else, and clamping keeps the far edge out of the filter.
+    D3D11_SAMPLER_DESC mip_sampler_desc = sampler_desc;
+    mip_sampler_desc.Filter = D3D11_FILTER_MIN_LINEAR_MAG_POINT_MIP_LINEAR;
+    mip_sampler_desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+    mip_sampler_desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+    mip_sampler_desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+    HR(renderer->device->lpVtbl->CreateSamplerState(renderer->device, &mip_sampler_desc,
+                                                    &renderer->mip_sampler_state));
+
     D3D11_BLEND_DESC transparent_desc = {0};
     transparent_desc.AlphaToCoverageEnable = FALSE;
     transparent_desc.IndependentBlendEnable = FALSE;
@@ -160,7 +194,10 @@ internal Renderer* renderer_create(Window* window, Arena* arena)
     renderer->proj = ortho_top_left((f32)window->width, (f32)window->height);
     renderer_set_projection(renderer, renderer->proj);
 
-    renderer->text_renderer = text_renderer_create(window->ptr, renderer->swap_chain, arena);
+    renderer->text_renderer = text_renderer_create(window->ptr, renderer->canvas, arena);
+
+    // Nothing has been drawn to the canvas yet
+    renderer_invalidate_all(renderer);
 
     ASSERT(renderer->ctx, "D3D immediate context is null");
     ASSERT(renderer->swap_chain, "D3D swap chain is null");
@@ -172,14 +209,19 @@ internal void renderer_destroy(Renderer* renderer)
 {
     com_release(renderer->swap_chain);
     com_release(renderer->device);
+    com_release(renderer->ctx1);
     com_release(renderer->ctx);
     com_release(renderer->render_target_view);
+    com_release(renderer->canvas);
+    com_release(renderer->back_buffer);
+    com_release(renderer->rasterizer_state);
     com_release(renderer->pixel_shader);
     com_release(renderer->vertex_shader);
     com_release(renderer->input_layout);
     com_release(renderer->vb);
     com_release(renderer->ib);
     com_release(renderer->sampler_state);
+    com_release(renderer->mip_sampler_state);
     com_release(renderer->blend_state);
     com_release(renderer->proj_buffer);
     text_renderer_destroy(renderer->text_renderer);
@@ -187,6 +229,7 @@ internal void renderer_destroy(Renderer* renderer)
 
 internal void renderer_set_projection(Renderer* renderer, m4 proj)
 {
+    capture_set_projection(proj);
     renderer->proj = proj;
     D3D11_MAPPED_SUBRESOURCE mapped = {0};
     HR(renderer->ctx->lpVtbl->Map(renderer->ctx, (ID3D11Resource*)renderer->proj_buffer, 0, D3D11_MAP_WRITE_DISCARD,
@@ -199,41 +242,93 @@ internal void renderer_set_projection(Renderer* renderer, m4 proj)
 
 internal void renderer_upload_texture(Renderer* renderer, Texture* texture)
 {
+    PROFILE_FUNCTION_BEGIN();
+
+    DXGI_FORMAT format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    u32 block_bytes = bc_block_bytes(texture->format);
+    switch (texture->format)
+    {
+        case TextureFormat_BC1: format = DXGI_FORMAT_BC1_UNORM; break;
+        case TextureFormat_BC3: format = DXGI_FORMAT_BC3_UNORM; break;
+        case TextureFormat_BC7: format = DXGI_FORMAT_BC7_UNORM; break;
+        default: break;
+    }
+    u32 mip_count = texture->mip_count > 1 ? (u32)texture->mip_count : 1;
+
     D3D11_TEXTURE2D_DESC tex_desc = {0};
     tex_desc.Width = texture->width;
     tex_desc.Height = texture->height;
-    tex_desc.MipLevels = 1;
+    tex_desc.MipLevels = mip_count;
     tex_desc.ArraySize = 1;
-    tex_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    tex_desc.Format = format;
     tex_desc.SampleDesc.Count = 1;
     tex_desc.SampleDesc.Quality = 0;
     tex_desc.Usage = D3D11_USAGE_DEFAULT;
     tex_desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 
-    D3D11_SUBRESOURCE_DATA tex_init_data = {0};
-    tex_init_data.pSysMem = texture->data;
-    tex_init_data.SysMemPitch = texture->width*texture->channels;
-    tex_init_data.SysMemSlicePitch = texture->width*texture->height*texture->channels;
+    // Block-compressed rows are one row of 4x4 blocks
+    D3D11_SUBRESOURCE_DATA tex_init_data[TEXTURE_MAX_MIP_LEVELS] = {0};
+    for (u32 level = 0; level < mip_count; ++level)
+    {
+        Texture level_texture = texture_mip_level(texture, (i32)level);
+        u32 pitch = level_texture.width*level_texture.channels;
+        if (block_bytes)
+            pitch = ((level_texture.width + 3) / 4)*block_bytes;
+        tex_init_data[level].pSysMem = level_texture.data;
+        tex_init_data[level].SysMemPitch = pitch;
+        tex_init_data[level].SysMemSlicePitch = (UINT)texture_data_size(&level_texture);
+    }
 
     ID3D11Texture2D* d3d_tex = NULL;
-    HR(renderer->device->lpVtbl->CreateTexture2D(renderer->device, &tex_desc, &tex_init_data, &d3d_tex));
+    HR(renderer->device->lpVtbl->CreateTexture2D(renderer->device, &tex_desc, tex_init_data, &d3d_tex));
 
     D3D11_SHADER_RESOURCE_VIEW_DESC srv_desc = {0};
-    srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srv_desc.Format = format;
     srv_desc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-    srv_desc.Texture2D.MipLevels = 1;
+    srv_desc.Texture2D.MipLevels = mip_count;
 
     ID3D11ShaderResourceView* srv;
     HR(renderer->device->lpVtbl->CreateShaderResourceView(renderer->device, (ID3D11Resource*)d3d_tex, &srv_desc, &srv));
     texture->api_handle = (void*)srv;
 
     com_release(d3d_tex);
+
+    PROFILE_FUNCTION_END();
+}
+
+internal void renderer_update_texture(Renderer* renderer, Texture* texture, i32 x, i32 y, i32 width, i32 height)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ASSERT(texture->format == TextureFormat_RGBA8 && texture->mip_count <= 1, "Only RGBA8 textures can be updated");
+    ASSERT(x >= 0 && y >= 0 && x + width <= texture->width && y + height <= texture->height,
+           "Update out of the texture");
+
+    ID3D11ShaderResourceView* srv = (ID3D11ShaderResourceView*)texture->api_handle;
+    ID3D11Resource* resource = NULL;
+    srv->lpVtbl->GetResource(srv, &resource);
+
+    D3D11_BOX box = {0};
+    box.left = (UINT)x;
+    box.top = (UINT)y;
+    box.front = 0;
+    box.right = (UINT)(x + width);
+    box.bottom = (UINT)(y + height);
+    box.back = 1;
+    u32 pitch = (u32)texture->width*4;
+    u8* first = texture->data + (size)y*pitch + (size)x*4;
+    renderer->ctx->lpVtbl->UpdateSubresource(renderer->ctx, resource, 0, &box, first, pitch, 0);
+
+    com_release(resource);
+
+    PROFILE_FUNCTION_END();
 }
 
 internal void renderer_flush_quads(Renderer* renderer)
 {
     if (renderer->quads_in_batch == 0) return;
 
+    PROFILE_FUNCTION_BEGIN();
     ++renderer->batch_count;
 
     D3D11_MAPPED_SUBRESOURCE mapped = {0};
@@ -254,52 +349,71 @@ internal void renderer_flush_quads(Renderer* renderer)
 
     // TODO(lucas): Texture atlas
     ID3D11ShaderResourceView* texture_srv = renderer->current_texture->api_handle;
-    renderer->ctx->lpVtbl->PSSetSamplers(renderer->ctx, 0, 1, &renderer->sampler_state);
+    ID3D11SamplerState* sampler_state = renderer->sampler_state;
+    if (renderer->current_texture->mip_count > 1)
+        sampler_state = renderer->mip_sampler_state;
+    renderer->ctx->lpVtbl->PSSetSamplers(renderer->ctx, 0, 1, &sampler_state);
     renderer->ctx->lpVtbl->PSSetShaderResources(renderer->ctx, 0, 1, &texture_srv);
 
     renderer->ctx->lpVtbl->DrawIndexed(renderer->ctx, renderer->quads_in_batch*6, 0, 0);
 
     renderer->quads_in_batch = 0;
+    PROFILE_FUNCTION_END();
 }
 
-internal void renderer_draw_texture(Renderer* renderer, Texture* texture, v2 pos, v2 dim)
+internal D3D11_RECT d3d11_rect_from_damage(Renderer* renderer)
 {
-    ++renderer->quads_in_batch;
-    ++renderer->total_quads;
-    Texture* old_texture = texture;
-    renderer->current_texture = texture;
-
-    if (renderer->quads_in_batch >= renderer->quads_per_batch || texture != old_texture)
-        renderer_flush_quads(renderer);
-
-    f32 x = pos.x;
-    f32 y = pos.y;
-    f32 w = dim.x;
-    f32 h = dim.y;
-    Vertex* verts = renderer->cpu_vb + renderer->quads_in_batch*4;
-    verts[0] = (Vertex){ pos,              v2(0.0f, 1.0f) };
-    verts[1] = (Vertex){ v2(x + w, y),     v2(1.0f, 1.0f) };
-    verts[2] = (Vertex){ v2(x,     y + h), v2(0.0f, 0.0f) };
-    verts[3] = (Vertex){ v2(x + w, y + h), v2(1.0f, 0.0f) };
+    D3D11_RECT result = {0};
+    if (renderer->has_damage)
+    {
+        result.left = (LONG)renderer->damage.min.x;
+        result.top = (LONG)renderer->damage.min.y;
+        result.right = (LONG)renderer->damage.max.x;
+        result.bottom = (LONG)renderer->damage.max.y;
+    }
+    return result;
 }
 
 internal void renderer_clear(Renderer* renderer, v4 clear_color)
 {
+    capture_clear(clear_color);
+    if (!renderer->has_damage) return;
+
+    D3D11_RECT clear_rect = d3d11_rect_from_damage(renderer);
     renderer->ctx->lpVtbl->OMSetRenderTargets(renderer->ctx, 1, &renderer->render_target_view, NULL);
-    renderer->ctx->lpVtbl->ClearRenderTargetView(renderer->ctx, renderer->render_target_view, clear_color.e);
+    renderer->ctx1->lpVtbl->ClearView(renderer->ctx1, (ID3D11View*)renderer->render_target_view, clear_color.e,
+                                      &clear_rect, 1);
 }
 
 internal void renderer_begin_frame(Renderer* renderer, Window* window)
 {
     (void)window;
+    capture_frame_begin(renderer->width, renderer->height, renderer->damage, renderer->has_damage);
     renderer_set_projection(renderer, renderer->proj);
     renderer->quads_in_batch = 0;
     renderer->total_quads = 0;
     renderer->batch_count = 0;
+
+    D3D11_RECT scissor = d3d11_rect_from_damage(renderer);
+    renderer->ctx->lpVtbl->RSSetState(renderer->ctx, renderer->rasterizer_state);
+    renderer->ctx->lpVtbl->RSSetScissorRects(renderer->ctx, 1, &scissor);
 }
 
 internal void renderer_end_frame(Renderer* renderer)
 {
+    renderer_merge_draw_lists(renderer);
     renderer_flush_quads(renderer);
+    capture_frame_end(renderer->total_quads, renderer->batch_count);
+
+    // Nothing changed, so the last presented image is still correct
+    if (!renderer->has_damage) return;
+
+    renderer->ctx->lpVtbl->CopyResource(renderer->ctx, (ID3D11Resource*)renderer->back_buffer,
+                                        (ID3D11Resource*)renderer->canvas);
+
+    PROFILE_BEGIN("present");
     HR(renderer->swap_chain->lpVtbl->Present(renderer->swap_chain, 1, 0));
+    PROFILE_END("present");
+
+    renderer->has_damage = false;
 }
@@ -2,17 +2,13 @@
 
 #include "grapple_math.h"
 #include "types.h"
+#include "renderer/draw_list.h"
 #include "renderer/texture.h"
 
-#include <d3d11.h>
+#include <d3d11_1.h>
 
 typedef struct TextRenderer TextRenderer;
-
-typedef struct
-{
-    v2 pos; // Screen-space position
-    v2 tex_coord;
-} Vertex;
+typedef struct Vertex Vertex; // Defined in renderer.h
 
 typedef struct
 {
@@ -24,11 +20,19 @@ typedef struct Renderer
     IDXGISwapChain* swap_chain;
     ID3D11Device* device;
     ID3D11DeviceContext* ctx;
-    ID3D11RenderTargetView* render_target_view;
+    ID3D11DeviceContext1* ctx1; // For ClearView
+
+    // NOTE(lucas): Everything is drawn into a persistent canvas, so regions that were not damaged keep last
+    // frame's pixels. The canvas is copied to the swap chain's back buffer only on frames that changed something.
+    ID3D11Texture2D* back_buffer;
+    ID3D11Texture2D* canvas;
+    ID3D11RenderTargetView* render_target_view; // Views the canvas
+    ID3D11RasterizerState* rasterizer_state;
     ID3D11PixelShader* pixel_shader;
     ID3D11VertexShader* vertex_shader;
     ID3D11InputLayout* input_layout;
     ID3D11SamplerState* sampler_state;
+    ID3D11SamplerState* mip_sampler_state; // Trilinear, for textures with mips
     ID3D11BlendState* blend_state;
 
     TextRenderer* text_renderer;
@@ -50,4 +54,24 @@ typedef struct Renderer
     i32 ib_size;
 
     Texture* current_texture;
+
+    // Filled from any thread with renderer_submit_draw_list, merged in renderer_end_frame
+    DrawList* draw_lists[RENDERER_MAX_DRAW_LISTS];
+    volatile u32 draw_list_count;
+
+    i32 width;
+    i32 height;
+    rect damage;
+    b32 has_damage;
 } Renderer;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+TextRenderer* text_renderer_create(void* window_ptr, ID3D11Texture2D* target, Arena* arena);
+void text_renderer_destroy(TextRenderer* tr);
+
+#ifdef __cplusplus
+}
+#endif
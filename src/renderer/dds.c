@@ -0,0 +1,221 @@
+#include "bc.h"
+#include "file.h"
+#include "profiler.h"
+#include "texture.h"
+
+#include <string.h> // memcpy
+
+/*
+ * NOTE(lucas): DDS container for block-compressed textures. BC1 and BC3 use the legacy DXT1/DXT5 four-character
+ * codes, and BC7 uses the DX10 extended header.
+ *
+ * Files are top-down, as other tools expect. Blocks are flipped in place to the engine's bottom-up order on load, like
+ * BMP, and a copy of them is flipped back on write (see texture_flip_bc).
+ */
+
+#define DDS_MAGIC 0x20534444 // "DDS "
+
+#define DDSD_CAPS        0x1
+#define DDSD_HEIGHT      0x2
+#define DDSD_WIDTH       0x4
+#define DDSD_PIXELFORMAT 0x1000
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSD_LINEARSIZE  0x80000
+#define DDPF_FOURCC      0x4
+#define DDSCAPS_COMPLEX  0x8
+#define DDSCAPS_TEXTURE  0x1000
+#define DDSCAPS_MIPMAP   0x400000
+
+#define DDS_FOURCC(a, b, c, d) ((u32)(a) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
+
+// DXGI_FORMAT values, so this file does not need the D3D headers
+#define DDS_DXGI_BC1_UNORM 71
+#define DDS_DXGI_BC3_UNORM 77
+#define DDS_DXGI_BC7_UNORM 98
+#define DDS_DIMENSION_TEXTURE2D 3
+
+#pragma pack(push, 1)
+typedef struct
+{
+    u32 size;
+    u32 flags;
+    u32 four_cc;
+    u32 rgb_bit_count;
+    u32 r_mask;
+    u32 g_mask;
+    u32 b_mask;
+    u32 a_mask;
+} DdsPixelFormat;
+
+typedef struct
+{
+    u32 magic;
+    u32 size;
+    u32 flags;
+    u32 height;
+    u32 width;
+    u32 pitch_or_linear_size;
+    u32 depth;
+    u32 mip_count;
+    u32 reserved1[11];
+    DdsPixelFormat pixel_format;
+    u32 caps;
+    u32 caps2;
+    u32 caps3;
+    u32 caps4;
+    u32 reserved2;
+} DdsHeader;
+
+typedef struct
+{
+    u32 dxgi_format;
+    u32 resource_dimension;
+    u32 misc_flag;
+    u32 array_size;
+    u32 misc_flags2;
+} DdsHeaderDx10;
+#pragma pack(pop)
+
+b32 is_dds(u8* data, size data_size)
+{
+    u32 magic = 0;
+    if (data_size >= (size)sizeof(DdsHeader))
+        memcpy(&magic, data, sizeof(magic));
+    return magic == DDS_MAGIC;
+}
+
+Texture load_dds_from_memory(u8* data, size data_size, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    Texture tex = {0};
+    if (!is_dds(data, data_size))
+    {
+        PROFILE_FUNCTION_END();
+        return tex;
+    }
+
+    DdsHeader* header = (DdsHeader*)data;
+    size offset = sizeof(DdsHeader);
+    TextureFormat format = TextureFormat_RGBA8;
+    if (header->pixel_format.flags & DDPF_FOURCC)
+    {
+        u32 four_cc = header->pixel_format.four_cc;
+        if (four_cc == DDS_FOURCC('D', 'X', 'T', '1'))
+        {
+            format = TextureFormat_BC1;
+        }
+        else if (four_cc == DDS_FOURCC('D', 'X', 'T', '5'))
+        {
+            format = TextureFormat_BC3;
+        }
+        else if (four_cc == DDS_FOURCC('D', 'X', '1', '0') && data_size >= offset + (size)sizeof(DdsHeaderDx10))
+        {
+            DdsHeaderDx10* dx10 = (DdsHeaderDx10*)(data + offset);
+            offset += sizeof(DdsHeaderDx10);
+            switch (dx10->dxgi_format)
+            {
+                case DDS_DXGI_BC1_UNORM: format = TextureFormat_BC1; break;
+                case DDS_DXGI_BC3_UNORM: format = TextureFormat_BC3; break;
+                case DDS_DXGI_BC7_UNORM: format = TextureFormat_BC7; break;
+                default: break;
+            }
+        }
+    }
+
+    // Anything else, including uncompressed DDS, is better stored as PNG or QOI
+    if (format != TextureFormat_RGBA8 && header->width && header->height &&
+        header->width <= (1u << 16) && header->height <= (1u << 16))
+    {
+        tex.width = (i32)((header->width + 3) & ~3u);
+        tex.height = (i32)((header->height + 3) & ~3u);
+        tex.channels = 4;
+        tex.format = format;
+
+        // NOTE(lucas): Rounding the base level up to whole blocks changes the size of the smaller levels, so those
+        // are only kept when the file's size was already whole blocks.
+        b32 whole_blocks = (u32)tex.width == header->width && (u32)tex.height == header->height;
+        if ((header->flags & DDSD_MIPMAPCOUNT) && header->mip_count > 1 && whole_blocks)
+        {
+            i32 full_mip_count = texture_full_mip_count(tex.width, tex.height);
+            tex.mip_count = header->mip_count < (u32)full_mip_count ? (i32)header->mip_count : full_mip_count;
+        }
+
+        tex.data = (data_size - offset >= texture_data_size(&tex)) ? data + offset : 0;
+        if (!tex.data || !texture_flip_bc(&tex, arena))
+            zero_struct(tex);
+    }
+
+    PROFILE_FUNCTION_END();
+    return tex;
+}
+
+b32 dds_write(char* filename, Texture* texture, Arena* arena)
+{
+    u32 block_bytes = bc_block_bytes(texture->format);
+    ASSERT(block_bytes, "Only block-compressed textures can be written as DDS");
+    if (!block_bytes || !texture->data)
+        return false;
+
+    size data_size = texture_data_size(texture);
+    Texture base_level = texture_mip_level(texture, 0);
+
+    DdsHeader header = {0};
+    header.magic = DDS_MAGIC;
+    header.size = sizeof(DdsHeader) - sizeof(header.magic);
+    header.flags = DDSD_CAPS|DDSD_HEIGHT|DDSD_WIDTH|DDSD_PIXELFORMAT|DDSD_LINEARSIZE;
+    header.width = (u32)texture->width;
+    header.height = (u32)texture->height;
+    header.pitch_or_linear_size = (u32)texture_data_size(&base_level);
+    header.mip_count = 1;
+    header.pixel_format.size = sizeof(DdsPixelFormat);
+    header.pixel_format.flags = DDPF_FOURCC;
+    header.caps = DDSCAPS_TEXTURE;
+    if (texture->mip_count > 1)
+    {
+        header.flags |= DDSD_MIPMAPCOUNT;
+        header.mip_count = (u32)texture->mip_count;
+        header.caps |= DDSCAPS_COMPLEX|DDSCAPS_MIPMAP;
+    }
+
+    DdsHeaderDx10 dx10 = {0};
+    b32 has_dx10 = false;
+    switch (texture->format)
+    {
+        case TextureFormat_BC1: header.pixel_format.four_cc = DDS_FOURCC('D', 'X', 'T', '1'); break;
+        case TextureFormat_BC3: header.pixel_format.four_cc = DDS_FOURCC('D', 'X', 'T', '5'); break;
+        case TextureFormat_BC7:
+        {
+            header.pixel_format.four_cc = DDS_FOURCC('D', 'X', '1', '0');
+            dx10.dxgi_format = DDS_DXGI_BC7_UNORM;
+            dx10.resource_dimension = DDS_DIMENSION_TEXTURE2D;
+            dx10.array_size = 1;
+            has_dx10 = true;
+        } break;
+        default: break;
+    }
+
+    // Flipped on a copy, since a level that is encoded again to flip it would lose more if it were flipped back
+    size saved_used = arena->used;
+    Texture flipped = *texture;
+    flipped.data = push_array(arena, data_size, u8);
+    b32 result = flipped.data != 0;
+    if (result)
+    {
+        memcpy(flipped.data, texture->data, (usize)data_size);
+        result = texture_flip_bc(&flipped, arena);
+    }
+
+    void* file = result ? file_open(filename, FileMode_Write|FileMode_Create) : 0;
+    if (file)
+    {
+        file_write(file, &header, sizeof(header));
+        if (has_dx10)
+            file_write(file, &dx10, sizeof(dx10));
+        file_write(file, flipped.data, data_size);
+        file_close(file);
+    }
+
+    arena_pop(arena, arena->used - saved_used);
+    return file != 0;
+}
@@ -0,0 +1,163 @@
+#include "atomic.h"
+#include "grapple_math.h"
+#include "profiler.h"
+#include "renderer/capture.h"
+#include "renderer/draw_list.h"
+#include "renderer/renderer.h"
+
+#include <string.h> // memcpy
+
+internal DrawList* draw_list_create(Arena* arena, u32 max_quads, u32 max_commands)
+{
+    DrawList* list = push_struct(arena, DrawList);
+    zero_struct(*list);
+
+    list->vertex_arena = arena_alloc((size)max_quads*4*(size)sizeof(Vertex));
+    list->command_arena = arena_alloc((size)max_commands*(size)sizeof(DrawCommand));
+    list->quad_capacity = max_quads;
+    list->command_capacity = max_commands;
+
+    return list;
+}
+
+internal void draw_list_reset(DrawList* list, Renderer* renderer, u32 sort_key)
+{
+    list->quad_count = 0;
+    list->command_count = 0;
+    list->sort_key = sort_key;
+    list->damage = renderer->damage;
+    list->has_damage = renderer->has_damage;
+}
+
+internal inline Vertex* draw_list_vertices(DrawList* list)
+{
+    return (Vertex*)list->vertex_arena.data;
+}
+
+internal inline DrawCommand* draw_list_commands(DrawList* list)
+{
+    return (DrawCommand*)list->command_arena.data;
+}
+
+// Reserves space for count quads drawn with texture, merging with the previous command when the texture matches.
+// Returns 0 if the list is out of space.
+internal Vertex* draw_list_reserve(DrawList* list, Texture* texture, u32 count)
+{
+    ASSERT(list->quad_count + count <= list->quad_capacity, "Draw list is out of vertex space");
+    if (list->quad_count + count > list->quad_capacity)
+        return 0;
+
+    DrawCommand* commands = draw_list_commands(list);
+    DrawCommand* command = list->command_count ? &commands[list->command_count-1] : 0;
+    if (!command || command->texture != texture)
+    {
+        ASSERT(list->command_count < list->command_capacity, "Draw list is out of command space");
+        if (list->command_count >= list->command_capacity)
+            return 0;
+
+        command = &commands[list->command_count++];
+        command->texture = texture;
+        command->first_quad = list->quad_count;
+        command->quad_count = 0;
+    }
+
+    Vertex* result = draw_list_vertices(list) + list->quad_count*4;
+    command->quad_count += count;
+    list->quad_count += count;
+    return result;
+}
+
+internal void draw_list_texture(DrawList* list, Texture* texture, v2 pos, v2 dim)
+{
+    if (!list->has_damage || !rect_overlaps(list->damage, rect_min_dim(pos, dim)))
+        return;
+
+    Vertex* verts = draw_list_reserve(list, texture, 1);
+    if (verts)
+        quad_write_vertices(verts, pos, dim);
+}
+
+internal void draw_list_quads(DrawList* list, Texture* texture, QuadsSoA quads, size count,
+                              m2x3* transform, rect* clip)
+{
+    if (!list->has_damage || count <= 0)
+        return;
+
+    // Same damage folding as renderer_draw_quads
+    rect damage_clip = {0};
+    if (!transform)
+    {
+        damage_clip = clip ? rect_intersect(*clip, list->damage) : list->damage;
+        clip = &damage_clip;
+    }
+
+    Vertex* verts = draw_list_reserve(list, texture, (u32)count);
+    if (verts)
+        quads_expand((f32*)verts, quads, count, transform, clip);
+}
+
+internal void renderer_submit_draw_list(Renderer* renderer, DrawList* list)
+{
+    u32 index = atomic_add_u32(&renderer->draw_list_count, 1) - 1;
+    ASSERT(index < RENDERER_MAX_DRAW_LISTS, "Too many draw lists submitted this frame");
+    if (index < RENDERER_MAX_DRAW_LISTS)
+        renderer->draw_lists[index] = list;
+}
+
+internal void renderer_merge_draw_lists(Renderer* renderer)
+{
+    u32 list_count = atomic_load_u32(&renderer->draw_list_count);
+    if (list_count > RENDERER_MAX_DRAW_LISTS)
+        list_count = RENDERER_MAX_DRAW_LISTS;
+    if (!list_count)
+        return;
+
+    PROFILE_FUNCTION_BEGIN();
+
+    // Lists arrive in whatever order their threads finished. There are only a handful, so insertion sort is plenty.
+    DrawList** lists = renderer->draw_lists;
+    for (u32 i = 1; i < list_count; ++i)
+    {
+        DrawList* list = lists[i];
+        u32 j = i;
+        for (; j > 0 && lists[j-1]->sort_key > list->sort_key; --j)
+            lists[j] = lists[j-1];
+        lists[j] = list;
+    }
+
+    for (u32 list_index = 0; list_index < list_count; ++list_index)
+    {
+        DrawList* list = lists[list_index];
+        DrawCommand* commands = draw_list_commands(list);
+        for (u32 command_index = 0; command_index < list->command_count; ++command_index)
+        {
+            DrawCommand* command = &commands[command_index];
+            if (command->texture != renderer->current_texture)
+                renderer_flush_quads(renderer);
+            renderer->current_texture = command->texture;
+
+            // Runs from consecutive lists that share a texture are coalesced into the same batch
+            Vertex* src = draw_list_vertices(list) + command->first_quad*4;
+            capture_draw_list_command(command->texture, src, command->quad_count);
+            u32 remaining = command->quad_count;
+            while (remaining)
+            {
+                if (renderer->quads_in_batch >= renderer->quads_per_batch)
+                    renderer_flush_quads(renderer);
+
+                u32 batch_count = (u32)(renderer->quads_per_batch - renderer->quads_in_batch);
+                if (batch_count > remaining)
+                    batch_count = remaining;
+
+                memcpy(renderer->cpu_vb + renderer->quads_in_batch*4, src, batch_count*4*sizeof(Vertex));
+                renderer->quads_in_batch += (i16)batch_count;
+                renderer->total_quads += (i32)batch_count;
+                src += batch_count*4;
+                remaining -= batch_count;
+            }
+        }
+    }
+
+    atomic_store_u32(&renderer->draw_list_count, 0);
+    PROFILE_FUNCTION_END();
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "grapple_math.h"
+#include "grapple_memory.h"
+#include "texture.h"
+#include "types.h"
+
+#define RENDERER_MAX_DRAW_LISTS 64
+
+typedef struct Renderer Renderer;
+
+typedef struct
+{
+    Texture* texture;
+    u32 first_quad;
+    u32 quad_count;
+} DrawCommand;
+
+/*
+ * NOTE(lucas): A draw list records quads without touching the renderer, so any thread can fill one. Each list
+ * owns its vertex and command storage, which means threads filling different lists never contend. Finished lists
+ * are handed over with renderer_submit_draw_list, and renderer_end_frame draws them after the frame's
+ * immediate-mode draws, ordered by sort_key. That keeps the output the same no matter which thread finished first.
+ */
+typedef struct DrawList
+{
+    Arena vertex_arena;
+    Arena command_arena;
+    u32 quad_capacity;
+    u32 command_capacity;
+    u32 quad_count;
+    u32 command_count;
+    u32 sort_key;
+
+    // Copied from the renderer on reset so recording can cull without reading renderer state
+    rect damage;
+    b32 has_damage;
+} DrawList;
+
+internal DrawList* draw_list_create(Arena* arena, u32 max_quads, u32 max_commands);
+
+// Call on the render thread before handing the list to a worker
+internal void draw_list_reset(DrawList* list, Renderer* renderer, u32 sort_key);
+
+internal void draw_list_texture(DrawList* list, Texture* texture, v2 pos, v2 dim);
+internal void draw_list_quads(DrawList* list, Texture* texture, QuadsSoA quads, size count,
+                              m2x3* transform, rect* clip);
+
+// Safe to call from any thread. Every list has to be submitted before renderer_end_frame.
+internal void renderer_submit_draw_list(Renderer* renderer, DrawList* list);
+internal void renderer_merge_draw_lists(Renderer* renderer); // Called by each backend's renderer_end_frame
@@ -0,0 +1,290 @@
+#include "grapple_memory.h"
+#include "profiler.h"
+#include "texture.h"
+
+#include <math.h> // sqrtf
+#include <string.h> // memcpy, memset
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MIP_SSE2 1
+#endif
+
+/*
+ * NOTE(lucas): Each level is a 2x2 box filter of the one above it. Averaging sRGB values directly darkens
+ * everything that has detail, so colors are squared into linear space, like srgb255_to_linear1, averaged and square
+ * rooted back. Colors are also weighted by alpha, so the color of fully transparent pixels (often white or black
+ * garbage) does not bleed into the edges of what is visible.
+ *
+ * Odd dimensions round down, so the last row or column of an odd level only contributes through its neighbors.
+ * TODO(lucas): A wider filter (Kaiser or Lanczos) would keep more detail in the small levels, if thumbnails need it.
+ *
+ * texture_downsample is the same filter for any ratio, in one pass: every source pixel falls in exactly one output
+ * pixel, whose box is the run of source pixels that map to it, so boxes differ by a pixel when the ratio isn't
+ * whole. Each source row is summed into a row of accumulators, which are resolved after the last row of the box.
+ */
+
+// Keeps the weights from being zero when all four pixels are transparent, so their colors are averaged evenly
+#define MIP_MIN_WEIGHT 1e-5f
+
+#ifdef MIP_SSE2
+internal inline __m128 mip_load_pixel(u8* pixel)
+{
+    i32 value;
+    memcpy(&value, pixel, sizeof(value));
+    __m128i zero = _mm_setzero_si128();
+    __m128i wide = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(value), zero), zero);
+    return _mm_cvtepi32_ps(wide);
+}
+
+internal void mip_downsample_row(u8* row0, u8* row1, i32 source_width, u8* out, i32 out_width)
+{
+    __m128 inv_255 = _mm_set1_ps(1.0f/255.0f);
+    __m128 alpha_one = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    __m128 rgb_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    __m128 min_weight = _mm_set1_ps(MIP_MIN_WEIGHT);
+    __m128 quarter = _mm_set1_ps(0.25f);
+    __m128 scale = _mm_set1_ps(255.0f);
+    __m128 half = _mm_set1_ps(0.5f);
+
+    for (i32 x = 0; x < out_width; ++x)
+    {
+        i32 x0 = 2*x;
+        i32 x1 = (x0 + 1 < source_width) ? x0 + 1 : x0;
+        u8* pixels[4] = {row0 + x0*4, row0 + x1*4, row1 + x0*4, row1 + x1*4};
+
+        __m128 color_sum = _mm_setzero_ps();
+        __m128 weight_sum = _mm_setzero_ps();
+        __m128 alpha_sum = _mm_setzero_ps();
+        for (u32 i = 0; i < 4; ++i)
+        {
+            // Squares r, g and b and leaves a alone
+            __m128 v = _mm_mul_ps(mip_load_pixel(pixels[i]), inv_255);
+            __m128 linear = _mm_mul_ps(v, _mm_or_ps(_mm_and_ps(v, rgb_mask), alpha_one));
+            __m128 weight = _mm_add_ps(_mm_shuffle_ps(linear, linear, _MM_SHUFFLE(3, 3, 3, 3)), min_weight);
+            color_sum = _mm_add_ps(color_sum, _mm_mul_ps(linear, weight));
+            weight_sum = _mm_add_ps(weight_sum, weight);
+            alpha_sum = _mm_add_ps(alpha_sum, linear);
+        }
+
+        __m128 color = _mm_sqrt_ps(_mm_div_ps(color_sum, weight_sum));
+        __m128 alpha = _mm_mul_ps(alpha_sum, quarter);
+        __m128 result = _mm_or_ps(_mm_and_ps(rgb_mask, color), _mm_andnot_ps(rgb_mask, alpha));
+
+        __m128i packed = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(result, scale), half));
+        packed = _mm_packs_epi32(packed, packed);
+        packed = _mm_packus_epi16(packed, packed);
+        i32 value = _mm_cvtsi128_si32(packed);
+        memcpy(out + x*4, &value, sizeof(value));
+    }
+}
+#else
+internal void mip_downsample_row(u8* row0, u8* row1, i32 source_width, u8* out, i32 out_width)
+{
+    f32 inv_255 = 1.0f/255.0f;
+    for (i32 x = 0; x < out_width; ++x)
+    {
+        i32 x0 = 2*x;
+        i32 x1 = (x0 + 1 < source_width) ? x0 + 1 : x0;
+        u8* pixels[4] = {row0 + x0*4, row0 + x1*4, row1 + x0*4, row1 + x1*4};
+
+        f32 color_sum[3] = {0};
+        f32 weight_sum = 0.0f;
+        f32 alpha_sum = 0.0f;
+        for (u32 i = 0; i < 4; ++i)
+        {
+            f32 alpha = inv_255*pixels[i][3];
+            f32 weight = alpha + MIP_MIN_WEIGHT;
+            for (u32 c = 0; c < 3; ++c)
+                color_sum[c] += sq_f32(inv_255*pixels[i][c])*weight;
+            weight_sum += weight;
+            alpha_sum += alpha;
+        }
+
+        for (u32 c = 0; c < 3; ++c)
+            out[x*4 + c] = (u8)(255.0f*sqrtf(color_sum[c] / weight_sum) + 0.5f);
+        out[x*4 + 3] = (u8)(255.0f*0.25f*alpha_sum + 0.5f);
+    }
+}
+#endif
+
+#ifdef MIP_SSE2
+// Adds each output pixel's run of the row, from starts[x] to starts[x + 1], to its sums. Sums are (r, g, b)
+// squared and weighted by alpha, then alpha, and weights are (weight, weight, weight, 1), so the last lane counts.
+internal void mip_accumulate_row(u8* row, u32* starts, f32* sums, f32* weights, i32 out_width)
+{
+    __m128 inv_255 = _mm_set1_ps(1.0f/255.0f);
+    __m128 alpha_one = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+    __m128 rgb_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    __m128 min_weight = _mm_set1_ps(MIP_MIN_WEIGHT);
+
+    for (i32 out_x = 0; out_x < out_width; ++out_x)
+    {
+        __m128 color_sum = _mm_setzero_ps();
+        __m128 weight_sum = _mm_setzero_ps();
+        for (u32 x = starts[out_x]; x < starts[out_x + 1]; ++x)
+        {
+            __m128 v = _mm_mul_ps(mip_load_pixel(row + x*4), inv_255);
+            __m128 linear = _mm_mul_ps(v, _mm_or_ps(_mm_and_ps(v, rgb_mask), alpha_one));
+            __m128 weight = _mm_add_ps(_mm_shuffle_ps(linear, linear, _MM_SHUFFLE(3, 3, 3, 3)), min_weight);
+            weight = _mm_or_ps(_mm_and_ps(weight, rgb_mask), alpha_one);
+            color_sum = _mm_add_ps(color_sum, _mm_mul_ps(linear, weight));
+            weight_sum = _mm_add_ps(weight_sum, weight);
+        }
+        _mm_store_ps(sums + out_x*4, _mm_add_ps(_mm_load_ps(sums + out_x*4), color_sum));
+        _mm_store_ps(weights + out_x*4, _mm_add_ps(_mm_load_ps(weights + out_x*4), weight_sum));
+    }
+}
+
+internal void mip_resolve_row(f32* sums, f32* weights, u8* out, i32 out_width)
+{
+    __m128 rgb_mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    __m128 scale = _mm_set1_ps(255.0f);
+    __m128 half = _mm_set1_ps(0.5f);
+
+    for (i32 x = 0; x < out_width; ++x)
+    {
+        __m128 average = _mm_div_ps(_mm_load_ps(sums + x*4), _mm_load_ps(weights + x*4));
+        __m128 result = _mm_or_ps(_mm_and_ps(rgb_mask, _mm_sqrt_ps(average)), _mm_andnot_ps(rgb_mask, average));
+
+        __m128i packed = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(result, scale), half));
+        packed = _mm_packs_epi32(packed, packed);
+        packed = _mm_packus_epi16(packed, packed);
+        i32 value = _mm_cvtsi128_si32(packed);
+        memcpy(out + x*4, &value, sizeof(value));
+    }
+}
+#else
+internal void mip_accumulate_row(u8* row, u32* starts, f32* sums, f32* weights, i32 out_width)
+{
+    f32 inv_255 = 1.0f/255.0f;
+    for (i32 out_x = 0; out_x < out_width; ++out_x)
+    {
+        f32* sum = sums + out_x*4;
+        f32* weight_sum = weights + out_x*4;
+        for (u32 x = starts[out_x]; x < starts[out_x + 1]; ++x)
+        {
+            u8* pixel = row + x*4;
+            f32 alpha = inv_255*pixel[3];
+            f32 weight = alpha + MIP_MIN_WEIGHT;
+            for (u32 c = 0; c < 3; ++c)
+            {
+                sum[c] += sq_f32(inv_255*pixel[c])*weight;
+                weight_sum[c] += weight;
+            }
+            sum[3] += alpha;
+            weight_sum[3] += 1.0f;
+        }
+    }
+}
+
+internal void mip_resolve_row(f32* sums, f32* weights, u8* out, i32 out_width)
+{
+    for (i32 x = 0; x < out_width; ++x)
+    {
+        for (u32 c = 0; c < 3; ++c)
+            out[x*4 + c] = (u8)(255.0f*sqrtf(sums[x*4 + c] / weights[x*4 + c]) + 0.5f);
+        out[x*4 + 3] = (u8)(255.0f*sums[x*4 + 3] / weights[x*4 + 3] + 0.5f);
+    }
+}
+#endif
+
+Texture texture_downsample(Texture* source, i32 width, i32 height, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ASSERT(source->format == TextureFormat_RGBA8 && source->channels == 4, "Only RGBA8 textures are downsampled");
+    ASSERT(width > 0 && height > 0 && width <= source->width && height <= source->height,
+           "Downsampled size out of range");
+
+    // The pixels, then accumulators for one output row and where each output column starts in the source
+    Texture result = {0};
+    size scratch_size = 16 + (size)width*8*sizeof(f32) + ((size)width + 1)*sizeof(u32);
+    if (arena->bytes - arena->used < (size)width*height*4 + scratch_size)
+    {
+        PROFILE_FUNCTION_END();
+        return result;
+    }
+
+    u8* pixels = push_array(arena, (size)width*height*4, u8);
+    size pixels_end = arena->used;
+
+    arena_align(arena, 16);
+    f32* sums = push_array(arena, (size)width*4, f32);
+    f32* weights = push_array(arena, (size)width*4, f32);
+    u32* starts = push_array(arena, (size)width + 1, u32);
+
+    // Source pixel x falls in output pixel x*width/source_width, rounding down
+    for (i32 x = 0; x <= width; ++x)
+        starts[x] = (u32)(((i64)x*source->width + width - 1) / width);
+
+    for (i32 out_y = 0; out_y < height; ++out_y)
+    {
+        memset(sums, 0, (usize)width*4*sizeof(f32));
+        memset(weights, 0, (usize)width*4*sizeof(f32));
+        i32 y_end = (i32)(((i64)(out_y + 1)*source->height + height - 1) / height);
+        for (i32 y = (i32)(((i64)out_y*source->height + height - 1) / height); y < y_end; ++y)
+            mip_accumulate_row(source->data + (size)y*source->width*4, starts, sums, weights, width);
+        mip_resolve_row(sums, weights, pixels + (size)out_y*width*4, width);
+    }
+
+    arena->used = pixels_end;
+    result.width = width;
+    result.height = height;
+    result.channels = 4;
+    result.data = pixels;
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+Texture texture_generate_mips(Texture* texture, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ASSERT(texture->format == TextureFormat_RGBA8 && texture->channels == 4, "Only RGBA8 textures have mips built");
+
+    Texture result = *texture;
+    result.mip_count = texture_full_mip_count(texture->width, texture->height);
+    if (texture->mip_count > 1 || result.mip_count == 1)
+    {
+        PROFILE_FUNCTION_END();
+        return *texture;
+    }
+
+    size base_size = (size)texture->width*texture->height*4;
+    size chain_size = texture_data_size(&result);
+    if (texture->data + base_size == arena->data + arena->used)
+    {
+        if (!push_size(arena, chain_size - base_size))
+            result.data = 0;
+    }
+    else
+    {
+        result.data = push_size(arena, chain_size);
+        if (result.data)
+            memcpy(result.data, texture->data, (usize)base_size);
+    }
+
+    if (!result.data)
+    {
+        PROFILE_FUNCTION_END();
+        return *texture;
+    }
+
+    for (i32 level = 1; level < result.mip_count; ++level)
+    {
+        Texture source = texture_mip_level(&result, level - 1);
+        Texture dest = texture_mip_level(&result, level);
+        for (i32 y = 0; y < dest.height; ++y)
+        {
+            i32 y0 = 2*y;
+            i32 y1 = (y0 + 1 < source.height) ? y0 + 1 : y0;
+            mip_downsample_row(source.data + (size)y0*source.width*4, source.data + (size)y1*source.width*4,
+                               source.width, dest.data + (size)y*dest.width*4, dest.width);
+        }
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
@@ -0,0 +1,124 @@
+#include "grapple_math.h"
+#include "profiler.h"
+#include "renderer/bc.h"
+#include "renderer/capture.h"
+#include "renderer/font.h"
+#include "renderer/renderer.h"
+
+#include "null_renderer.h"
+
+#include <string.h> // memcpy
+
+internal Renderer* renderer_create(Window* window, Arena* arena)
+{
+    Renderer* renderer = push_struct(arena, Renderer);
+    zero_struct(*renderer);
+
+    renderer->quads_per_batch = 1024;
+    renderer->vb_size = renderer->quads_per_batch*4*sizeof(Vertex);
+    renderer->cpu_vb = push_array(arena, renderer->quads_per_batch*4, Vertex);
+    renderer->gpu_vb = push_array(arena, renderer->quads_per_batch*4, Vertex);
+
+    // A headless renderer may not have a window, so fall back to the default window size
+    renderer->width = window ? window->width : 800;
+    renderer->height = window ? window->height : 600;
+    renderer->proj = ortho_top_left((f32)renderer->width, (f32)renderer->height);
+
+    renderer->texture_arena = arena_alloc(MEGABYTES(64));
+    arena_register(&renderer->texture_arena, "null_textures");
+
+    return renderer;
+}
+
+internal void renderer_destroy(Renderer* renderer)
+{
+    (void)renderer;
+}
+
+internal void renderer_set_projection(Renderer* renderer, m4 proj)
+{
+    capture_set_projection(proj);
+    renderer->proj = proj;
+}
+
+// NOTE(lucas): The handle is the RGBA8 pixels a GPU would sample, so uploads of compressed textures pay for the
+// same decode a GPU would do and headless tools can read the result back.
+internal void renderer_upload_texture(Renderer* renderer, Texture* texture)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    // Textures without pixels still get a non-null handle, which keeps "is this uploaded?" checks meaningful
+    texture->api_handle = texture->data ? (void*)texture->data : (void*)texture;
+    if (texture->data && bc_block_bytes(texture->format))
+    {
+        Texture decoded = texture_decode_bc(texture, &renderer->texture_arena);
+        texture->api_handle = decoded.data;
+    }
+
+    PROFILE_FUNCTION_END();
+}
+
+// The handle of an RGBA8 texture is its own pixels, which are already up to date
+internal void renderer_update_texture(Renderer* renderer, Texture* texture, i32 x, i32 y, i32 width, i32 height)
+{
+    (void)renderer;
+    ASSERT(texture->format == TextureFormat_RGBA8 && texture->api_handle == texture->data,
+           "Only uploaded RGBA8 textures can be updated");
+    ASSERT(x >= 0 && y >= 0 && x + width <= texture->width && y + height <= texture->height,
+           "Update out of the texture");
+    (void)texture;
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+}
+
+internal void renderer_flush_quads(Renderer* renderer)
+{
+    if (renderer->quads_in_batch == 0) return;
+
+    PROFILE_FUNCTION_BEGIN();
+    ++renderer->batch_count;
+    memcpy(renderer->gpu_vb, renderer->cpu_vb, renderer->quads_in_batch*4*sizeof(Vertex));
+    renderer->quads_in_batch = 0;
+    PROFILE_FUNCTION_END();
+}
+
+internal void renderer_clear(Renderer* renderer, v4 clear_color)
+{
+    capture_clear(clear_color);
+    (void)renderer;
+    (void)clear_color;
+}
+
+internal void renderer_begin_frame(Renderer* renderer, Window* window)
+{
+    (void)window;
+    capture_frame_begin(renderer->width, renderer->height, renderer->damage, renderer->has_damage);
+    renderer->quads_in_batch = 0;
+    renderer->total_quads = 0;
+    renderer->batch_count = 0;
+}
+
+internal void renderer_end_frame(Renderer* renderer)
+{
+    renderer_merge_draw_lists(renderer);
+    renderer_flush_quads(renderer);
+    capture_frame_end(renderer->total_quads, renderer->batch_count);
+    renderer->has_damage = false;
+}
+
+void text_draw_rect(Renderer* renderer, s8 text, rect bounds, v4 color)
+{
+    capture_text(text, bounds, color);
+    if (!renderer->has_damage || !rect_overlaps(renderer->damage, bounds))
+        return;
+
+    ++renderer->text_draw_count;
+    renderer->text_bytes += (u64)text.len;
+}
+
+void text_draw(Renderer* renderer, s8 text, v2 pos, v2 dim, v4 color)
+{
+    text_draw_rect(renderer, text, rect_min_dim(pos, dim), color);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "grapple_math.h"
+#include "types.h"
+#include "renderer/draw_list.h"
+#include "renderer/texture.h"
+
+typedef struct Vertex Vertex; // Defined in renderer.h
+
+// NOTE(lucas): Headless backend. It runs the same batching as the GPU backends, but flushing copies the batch
+// into a plain memory "vertex buffer" instead of a GPU one, so CPU-side costs can be measured without a device.
+typedef struct Renderer
+{
+    m4 proj;
+
+    Vertex* cpu_vb;
+    Vertex* gpu_vb; // Stand-in for the mapped GPU vertex buffer
+
+    i16 quads_per_batch;
+    i16 quads_in_batch;
+    i16 batch_count;
+    i32 total_quads;
+    i32 vb_size;
+
+    Texture* current_texture;
+
+    // Filled from any thread with renderer_submit_draw_list, merged in renderer_end_frame
+    DrawList* draw_lists[RENDERER_MAX_DRAW_LISTS];
+    volatile u32 draw_list_count;
+
+    i32 width;
+    i32 height;
+    rect damage;
+    b32 has_damage;
+
+    u64 text_draw_count;
+    u64 text_bytes;
+
+    // Block-compressed textures are decoded here on upload, standing in for the GPU's decoder
+    Arena texture_arena;
+} Renderer;
@@ -0,0 +1,692 @@
+#include "grapple_memory.h"
+#include "inflate.h"
+#include "profiler.h"
+#include "texture.h"
+
+#include <string.h> // memcpy, memset
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PNG_SSE2 1
+#endif
+
+/*
+ * NOTE(lucas): PNG decoder. Supports every color type and bit depth and Adam7 interlacing, and always produces
+ * RGBA8, bottom-up, with straight alpha. 16-bit samples keep their high byte. The zlib checksum is verified, but chunk
+ * CRCs are not, and ancillary chunks (gamma, color profiles, text) are ignored.
+ *
+ * Decoding is three serial passes: inflate the concatenated IDAT data, undo the per-row filters in place, and
+ * expand the rows to RGBA8. Each row's filter depends on the row above it and the stream is one zlib stream however
+ * it is split into IDAT chunks, so a single image cannot be split across threads. Load several images at once with
+ * texture_load_from_files instead.
+ */
+
+#define PNG_SIGNATURE_SIZE 8
+#define PNG_MAX_DIMENSION (1u << 24)
+#define PNG_MAX_PIXELS (1u << 28)
+
+#define PNG_CHUNK_TYPE(a, b, c, d) (((u32)(a) << 24) | ((u32)(b) << 16) | ((u32)(c) << 8) | (u32)(d))
+#define PNG_CHUNK_IHDR PNG_CHUNK_TYPE('I', 'H', 'D', 'R')
+#define PNG_CHUNK_PLTE PNG_CHUNK_TYPE('P', 'L', 'T', 'E')
+#define PNG_CHUNK_TRNS PNG_CHUNK_TYPE('t', 'R', 'N', 'S')
+#define PNG_CHUNK_IDAT PNG_CHUNK_TYPE('I', 'D', 'A', 'T')
+#define PNG_CHUNK_IEND PNG_CHUNK_TYPE('I', 'E', 'N', 'D')
+
+typedef enum
+{
+    PngColor_Gray = 0,
+    PngColor_RGB = 2,
+    PngColor_Palette = 3,
+    PngColor_GrayAlpha = 4,
+    PngColor_RGBA = 6,
+} PngColorType;
+
+typedef enum
+{
+    PngFilter_None = 0,
+    PngFilter_Sub,
+    PngFilter_Up,
+    PngFilter_Average,
+    PngFilter_Paeth,
+} PngFilter;
+
+typedef struct
+{
+    u32 width;
+    u32 height;
+    u32 bit_depth;
+    PngColorType color_type;
+    b32 interlaced;
+    u32 samples;         // Samples per pixel
+    u32 bytes_per_pixel; // Distance the filters look back, at least 1
+
+    u8 palette[256*4];
+    b32 has_palette;
+    b32 has_transparent_key;
+    u16 transparent_key[3]; // Gray or RGB value that is fully transparent, at the image's bit depth
+
+    u8* idat;       // Only set when there is a single IDAT chunk, which needs no copy
+    size idat_size; // Total across all IDAT chunks
+} PngInfo;
+
+typedef struct
+{
+    u32 x0;
+    u32 y0;
+    u32 dx;
+    u32 dy;
+} PngPass;
+
+global const u8 png_signature[PNG_SIGNATURE_SIZE] = {137, 80, 78, 71, 13, 10, 26, 10};
+
+global const PngPass png_adam7_passes[7] =
+{
+    {0, 0, 8, 8}, {4, 0, 8, 8}, {0, 4, 4, 8}, {2, 0, 4, 4}, {0, 2, 2, 4}, {1, 0, 2, 2}, {0, 1, 1, 2},
+};
+
+internal inline u32 png_read_u32(u8* p)
+{
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3];
+}
+
+internal inline size png_row_bytes(PngInfo* info, u32 width)
+{
+    return ((size)width*info->samples*info->bit_depth + 7) / 8;
+}
+
+b32 is_png(u8* data, size data_size)
+{
+    return data_size >= PNG_SIGNATURE_SIZE && memcmp(data, png_signature, PNG_SIGNATURE_SIZE) == 0;
+}
+
+internal b32 png_valid_bit_depth(PngColorType color_type, u32 bit_depth)
+{
+    b32 result = false;
+    switch (color_type)
+    {
+        case PngColor_Gray:      result = (bit_depth == 1 || bit_depth == 2 || bit_depth == 4 || bit_depth == 8 ||
+                                           bit_depth == 16); break;
+        case PngColor_Palette:   result = (bit_depth == 1 || bit_depth == 2 || bit_depth == 4 || bit_depth == 8); break;
+        case PngColor_RGB:
+        case PngColor_GrayAlpha:
+        case PngColor_RGBA:      result = (bit_depth == 8 || bit_depth == 16); break;
+    }
+    return result;
+}
+
+// Walks the chunks once to read the header, palette and transparency and to find the size of the image data
+internal b32 png_parse_chunks(u8* data, size data_size, PngInfo* info)
+{
+    size pos = PNG_SIGNATURE_SIZE;
+    b32 has_header = false;
+    u32 idat_count = 0;
+
+    for (u32 i = 0; i < 256; ++i)
+    {
+        info->palette[i*4 + 0] = 0;
+        info->palette[i*4 + 1] = 0;
+        info->palette[i*4 + 2] = 0;
+        info->palette[i*4 + 3] = 255;
+    }
+
+    for (;;)
+    {
+        if (data_size - pos < 12)
+            return false;
+
+        u32 length = png_read_u32(data + pos);
+        u32 type = png_read_u32(data + pos + 4);
+        u8* chunk = data + pos + 8;
+        if (length > data_size - pos - 12)
+            return false;
+        pos += (size)length + 12;
+
+        if (!has_header && type != PNG_CHUNK_IHDR)
+            return false;
+
+        switch (type)
+        {
+            case PNG_CHUNK_IHDR:
+            {
+                if (has_header || length != 13)
+                    return false;
+                has_header = true;
+
+                info->width = png_read_u32(chunk);
+                info->height = png_read_u32(chunk + 4);
+                info->bit_depth = chunk[8];
+                info->color_type = (PngColorType)chunk[9];
+                info->interlaced = chunk[12];
+                u8 compression = chunk[10];
+                u8 filter_method = chunk[11];
+
+                if (!info->width || !info->height || info->width > PNG_MAX_DIMENSION ||
+                    info->height > PNG_MAX_DIMENSION || (u64)info->width*info->height > PNG_MAX_PIXELS)
+                {
+                    return false;
+                }
+                if (!png_valid_bit_depth(info->color_type, info->bit_depth) || compression || filter_method ||
+                    info->interlaced > 1)
+                {
+                    return false;
+                }
+
+                switch (info->color_type)
+                {
+                    case PngColor_Gray:      info->samples = 1; break;
+                    case PngColor_RGB:       info->samples = 3; break;
+                    case PngColor_Palette:   info->samples = 1; break;
+                    case PngColor_GrayAlpha: info->samples = 2; break;
+                    case PngColor_RGBA:      info->samples = 4; break;
+                }
+                info->bytes_per_pixel = (info->samples*info->bit_depth + 7) / 8;
+            } break;
+
+            case PNG_CHUNK_PLTE:
+            {
+                if (length % 3 || length > 256*3)
+                    return false;
+                for (u32 i = 0; i < length / 3; ++i)
+                {
+                    info->palette[i*4 + 0] = chunk[i*3 + 0];
+                    info->palette[i*4 + 1] = chunk[i*3 + 1];
+                    info->palette[i*4 + 2] = chunk[i*3 + 2];
+                }
+                info->has_palette = true;
+            } break;
+
+            case PNG_CHUNK_TRNS:
+            {
+                if (info->color_type == PngColor_Palette)
+                {
+                    if (length > 256)
+                        return false;
+                    for (u32 i = 0; i < length; ++i)
+                        info->palette[i*4 + 3] = chunk[i];
+                }
+                else if (info->color_type == PngColor_Gray || info->color_type == PngColor_RGB)
+                {
+                    u32 key_count = info->samples;
+                    if (length != key_count*2)
+                        return false;
+                    for (u32 i = 0; i < key_count; ++i)
+                        info->transparent_key[i] = (u16)((chunk[i*2] << 8) | chunk[i*2 + 1]);
+                    info->has_transparent_key = true;
+                }
+            } break;
+
+            case PNG_CHUNK_IDAT:
+            {
+                info->idat = (idat_count++ == 0) ? chunk : 0;
+                info->idat_size += length;
+            } break;
+
+            case PNG_CHUNK_IEND:
+            {
+                return idat_count && (info->color_type != PngColor_Palette || info->has_palette);
+            } break;
+
+            default:
+            {
+                // Unknown critical chunks (uppercase first letter) change how the image must be decoded
+                if (!(type & PNG_CHUNK_TYPE(32, 0, 0, 0)))
+                    return false;
+            } break;
+        }
+    }
+}
+
+internal void png_copy_idat(u8* data, size data_size, u8* dest)
+{
+    size pos = PNG_SIGNATURE_SIZE;
+    while (data_size - pos >= 12)
+    {
+        u32 length = png_read_u32(data + pos);
+        u32 type = png_read_u32(data + pos + 4);
+        if (type == PNG_CHUNK_IDAT)
+        {
+            memcpy(dest, data + pos + 8, length);
+            dest += length;
+        }
+        else if (type == PNG_CHUNK_IEND)
+        {
+            break;
+        }
+        pos += (size)length + 12;
+    }
+}
+
+internal inline u8 png_paeth(i32 a, i32 b, i32 c)
+{
+    i32 p = a + b - c;
+    i32 pa = p > a ? p - a : a - p;
+    i32 pb = p > b ? p - b : b - p;
+    i32 pc = p > c ? p - c : c - p;
+    if (pa <= pb && pa <= pc)
+        return (u8)a;
+    if (pb <= pc)
+        return (u8)b;
+    return (u8)c;
+}
+
+#ifdef PNG_SSE2
+// NOTE(lucas): Filters for 3 and 4 byte pixels, one pixel per iteration in the low lanes of a register, the same
+// approach as libpng's SSE2 filters. The dependency on the previous pixel stays, but each pixel is one vector op
+// instead of three or four scalar ones.
+internal inline __m128i png_load4(u8* p)
+{
+    i32 value;
+    memcpy(&value, p, 4);
+    return _mm_cvtsi32_si128(value);
+}
+
+internal inline void png_store4(u8* p, __m128i v)
+{
+    i32 value = _mm_cvtsi128_si32(v);
+    memcpy(p, &value, 4);
+}
+
+internal inline __m128i png_load3(u8* p)
+{
+    i32 value = 0;
+    memcpy(&value, p, 3);
+    return _mm_cvtsi32_si128(value);
+}
+
+internal inline void png_store3(u8* p, __m128i v)
+{
+    i32 value = _mm_cvtsi128_si32(v);
+    memcpy(p, &value, 3);
+}
+
+internal inline __m128i png_load_pixel(u8* p, u32 bpp)
+{
+    return bpp == 4 ? png_load4(p) : png_load3(p);
+}
+
+internal inline void png_store_pixel(u8* p, __m128i v, u32 bpp)
+{
+    if (bpp == 4)
+        png_store4(p, v);
+    else
+        png_store3(p, v);
+}
+
+internal inline __m128i png_abs_epi16(__m128i x)
+{
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+internal inline __m128i png_select(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+internal void png_unfilter_row_sse2(PngFilter filter, u8* row, u8* prior, size row_bytes, u32 bpp)
+{
+    switch (filter)
+    {
+        case PngFilter_Sub:
+        {
+            __m128i d = _mm_setzero_si128();
+            for (size i = 0; i < row_bytes; i += bpp)
+            {
+                d = _mm_add_epi8(png_load_pixel(row + i, bpp), d);
+                png_store_pixel(row + i, d, bpp);
+            }
+        } break;
+
+        case PngFilter_Average:
+        {
+            // _mm_avg_epu8 rounds up, the filter rounds down
+            __m128i one = _mm_set1_epi8(1);
+            __m128i a = _mm_setzero_si128();
+            for (size i = 0; i < row_bytes; i += bpp)
+            {
+                __m128i b = png_load_pixel(prior + i, bpp);
+                __m128i avg = _mm_avg_epu8(a, b);
+                avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), one));
+                a = _mm_add_epi8(png_load_pixel(row + i, bpp), avg);
+                png_store_pixel(row + i, a, bpp);
+            }
+        } break;
+
+        case PngFilter_Paeth:
+        {
+            // Works in 16-bit lanes so the predictor differences do not overflow
+            __m128i zero = _mm_setzero_si128();
+            __m128i a = zero;
+            __m128i b = zero;
+            __m128i c = zero;
+            for (size i = 0; i < row_bytes; i += bpp)
+            {
+                c = b;
+                b = _mm_unpacklo_epi8(png_load_pixel(prior + i, bpp), zero);
+                __m128i d = _mm_unpacklo_epi8(png_load_pixel(row + i, bpp), zero);
+
+                __m128i pa = _mm_sub_epi16(b, c);
+                __m128i pb = _mm_sub_epi16(a, c);
+                __m128i pc = _mm_add_epi16(pa, pb);
+                pa = png_abs_epi16(pa);
+                pb = png_abs_epi16(pb);
+                pc = png_abs_epi16(pc);
+
+                __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+                __m128i nearest = png_select(_mm_cmpeq_epi16(smallest, pa), a,
+                                             png_select(_mm_cmpeq_epi16(smallest, pb), b, c));
+
+                a = _mm_add_epi8(d, nearest);
+                png_store_pixel(row + i, _mm_packus_epi16(a, a), bpp);
+            }
+        } break;
+
+        default: break;
+    }
+}
+#endif
+
+// Undoes the filter on one row in place. prior is the row above, already unfiltered, or zeros for the first row.
+internal b32 png_unfilter_row(u8 filter, u8* row, u8* prior, size row_bytes, u32 bpp)
+{
+    switch (filter)
+    {
+        case PngFilter_None: break;
+
+        case PngFilter_Up:
+        {
+            size i = 0;
+#ifdef PNG_SSE2
+            for (; i + 16 <= row_bytes; i += 16)
+            {
+                __m128i x = _mm_loadu_si128((__m128i*)(row + i));
+                __m128i b = _mm_loadu_si128((__m128i*)(prior + i));
+                _mm_storeu_si128((__m128i*)(row + i), _mm_add_epi8(x, b));
+            }
+#endif
+            for (; i < row_bytes; ++i)
+                row[i] = (u8)(row[i] + prior[i]);
+        } break;
+
+        case PngFilter_Sub:
+        case PngFilter_Average:
+        case PngFilter_Paeth:
+        {
+#ifdef PNG_SSE2
+            if (bpp == 3 || bpp == 4)
+            {
+                png_unfilter_row_sse2((PngFilter)filter, row, prior, row_bytes, bpp);
+                break;
+            }
+#endif
+            // The first pixel has no left neighbor, which the filters treat as zero
+            size i = 0;
+            if (filter == PngFilter_Sub)
+            {
+                for (i = bpp; i < row_bytes; ++i)
+                    row[i] = (u8)(row[i] + row[i - bpp]);
+            }
+            else if (filter == PngFilter_Average)
+            {
+                for (; i < bpp; ++i)
+                    row[i] = (u8)(row[i] + (prior[i] >> 1));
+                for (; i < row_bytes; ++i)
+                    row[i] = (u8)(row[i] + ((row[i - bpp] + prior[i]) >> 1));
+            }
+            else
+            {
+                for (; i < bpp; ++i)
+                    row[i] = (u8)(row[i] + prior[i]);
+                for (; i < row_bytes; ++i)
+                    row[i] = (u8)(row[i] + png_paeth(row[i - bpp], prior[i], prior[i - bpp]));
+            }
+        } break;
+
+        default: return false;
+    }
+
+    return true;
+}
+
+// Reads sample index from a row of packed samples narrower than a byte
+internal inline u32 png_packed_sample(u8* row, u32 index, u32 bit_depth)
+{
+    u32 bit = index*bit_depth;
+    u32 shift = 8 - bit_depth - (bit & 7);
+    return (row[bit >> 3] >> shift) & ((1u << bit_depth) - 1);
+}
+
+// Expands count pixels of an unfiltered row to RGBA8, writing every out_step bytes
+internal void png_expand_row(PngInfo* info, u8* row, u32 count, u8* out, size out_step)
+{
+    u32 depth = info->bit_depth;
+
+    if (depth == 8 && info->color_type == PngColor_RGBA && out_step == 4)
+    {
+        memcpy(out, row, (usize)count*4);
+        return;
+    }
+
+    switch (info->color_type)
+    {
+        case PngColor_Gray:
+        {
+            // Low bit depths are scaled to fill the byte: 1 -> 255, 3 (of 2 bits) -> 255, and so on
+            u32 scale = (depth == 1) ? 0xFF : (depth == 2) ? 0x55 : (depth == 4) ? 0x11 : 1;
+            for (u32 x = 0; x < count; ++x, out += out_step)
+            {
+                u32 value;
+                u8 gray;
+                if (depth == 16)
+                {
+                    value = ((u32)row[x*2] << 8) | row[x*2 + 1];
+                    gray = row[x*2];
+                }
+                else
+                {
+                    value = (depth == 8) ? row[x] : png_packed_sample(row, x, depth);
+                    gray = (u8)(value*scale);
+                }
+                out[0] = gray;
+                out[1] = gray;
+                out[2] = gray;
+                out[3] = (info->has_transparent_key && value == info->transparent_key[0]) ? 0 : 255;
+            }
+        } break;
+
+        case PngColor_RGB:
+        {
+            u16* key = info->transparent_key;
+            for (u32 x = 0; x < count; ++x, out += out_step)
+            {
+                b32 transparent;
+                if (depth == 16)
+                {
+                    u8* p = row + x*6;
+                    out[0] = p[0];
+                    out[1] = p[2];
+                    out[2] = p[4];
+                    transparent = (((p[0] << 8) | p[1]) == key[0] && ((p[2] << 8) | p[3]) == key[1] &&
+                                   ((p[4] << 8) | p[5]) == key[2]);
+                }
+                else
+                {
+                    u8* p = row + x*3;
+                    out[0] = p[0];
+                    out[1] = p[1];
+                    out[2] = p[2];
+                    transparent = (p[0] == key[0] && p[1] == key[1] && p[2] == key[2]);
+                }
+                out[3] = (info->has_transparent_key && transparent) ? 0 : 255;
+            }
+        } break;
+
+        case PngColor_Palette:
+        {
+            for (u32 x = 0; x < count; ++x, out += out_step)
+            {
+                u32 index = (depth == 8) ? row[x] : png_packed_sample(row, x, depth);
+                memcpy(out, info->palette + index*4, 4);
+            }
+        } break;
+
+        case PngColor_GrayAlpha:
+        {
+            u32 stride = depth / 4; // Bytes per pixel
+            for (u32 x = 0; x < count; ++x, out += out_step)
+            {
+                u8* p = row + x*stride;
+                out[0] = p[0];
+                out[1] = p[0];
+                out[2] = p[0];
+                out[3] = p[stride / 2];
+            }
+        } break;
+
+        case PngColor_RGBA:
+        {
+            u32 stride = depth / 2;
+            u32 step = depth / 8; // 16-bit samples keep the high byte, which comes first
+            for (u32 x = 0; x < count; ++x, out += out_step)
+            {
+                u8* p = row + x*stride;
+                out[0] = p[0];
+                out[1] = p[step];
+                out[2] = p[step*2];
+                out[3] = p[step*3];
+            }
+        } break;
+    }
+}
+
+// Unfilters and expands one pass (the whole image when not interlaced). Returns the number of filtered bytes used.
+internal size png_decode_pass(PngInfo* info, PngPass pass, u8* filtered, size filtered_size, u8* zero_row, u8* out)
+{
+    if (pass.x0 >= info->width || pass.y0 >= info->height)
+        return 0;
+
+    u32 pass_width = (info->width - pass.x0 + pass.dx - 1) / pass.dx;
+    u32 pass_height = (info->height - pass.y0 + pass.dy - 1) / pass.dy;
+    size row_bytes = png_row_bytes(info, pass_width);
+    size pass_size = (row_bytes + 1)*pass_height;
+    if (pass_size > filtered_size)
+        return -1;
+
+    u8* prior = zero_row;
+    size out_stride = (size)info->width*4;
+    for (u32 y = 0; y < pass_height; ++y)
+    {
+        u8* row = filtered + (row_bytes + 1)*y;
+        if (!png_unfilter_row(row[0], row + 1, prior, row_bytes, info->bytes_per_pixel))
+            return -1;
+
+        u32 image_y = pass.y0 + y*pass.dy;
+        u8* out_row = out + out_stride*(info->height - 1 - image_y) + (size)pass.x0*4;
+        png_expand_row(info, row + 1, pass_width, out_row, (size)pass.dx*4);
+        prior = row + 1;
+    }
+
+    return pass_size;
+}
+
+Texture load_png_from_memory(u8* data, size data_size, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    Texture tex = {0};
+    PngInfo info_storage = {0};
+    PngInfo* info = &info_storage;
+    size arena_start = arena->used;
+
+    b32 ok = is_png(data, data_size) && png_parse_chunks(data, data_size, info);
+
+    // NOTE(lucas): The pixels go on the arena first so everything pushed after them is scratch that can be popped
+    // before returning.
+    u8* pixels = 0;
+    size pixels_size = 0;
+    if (ok)
+    {
+        pixels_size = (size)info->width*info->height*4;
+        pixels = push_array(arena, pixels_size, u8);
+        ok = (pixels != 0);
+    }
+
+    // Filtered rows are one filter byte plus the packed samples, per pass
+    size filtered_size = 0;
+    if (ok)
+    {
+        u32 pass_count = info->interlaced ? 7 : 1;
+        PngPass whole_image = {0, 0, 1, 1};
+        for (u32 i = 0; i < pass_count; ++i)
+        {
+            PngPass pass = info->interlaced ? png_adam7_passes[i] : whole_image;
+            if (pass.x0 >= info->width || pass.y0 >= info->height)
+                continue;
+            u32 pass_width = (info->width - pass.x0 + pass.dx - 1) / pass.dx;
+            u32 pass_height = (info->height - pass.y0 + pass.dy - 1) / pass.dy;
+            filtered_size += (png_row_bytes(info, pass_width) + 1)*pass_height;
+        }
+    }
+
+    u8* idat = 0;
+    u8* filtered = 0;
+    u8* zero_row = 0;
+    Inflater* inflater = 0;
+    if (ok)
+    {
+        idat = info->idat;
+        if (!idat)
+        {
+            PROFILE_BEGIN("png_copy_idat");
+            idat = push_array(arena, info->idat_size, u8);
+            if (idat)
+                png_copy_idat(data, data_size, idat);
+            PROFILE_END("png_copy_idat");
+        }
+        arena_align(arena, 8);
+        inflater = push_struct(arena, Inflater);
+        filtered = push_array(arena, filtered_size, u8);
+        zero_row = push_array(arena, png_row_bytes(info, info->width), u8);
+        ok = idat && filtered && zero_row && inflater;
+    }
+
+    if (ok)
+    {
+        PROFILE_BEGIN("png_inflate");
+        size inflated = inflate_zlib(idat, info->idat_size, filtered, filtered_size, inflater);
+        ok = (inflated == filtered_size);
+        PROFILE_END("png_inflate");
+    }
+
+    if (ok)
+    {
+        PROFILE_BEGIN("png_unfilter");
+        zero_array(zero_row, png_row_bytes(info, info->width), u8);
+        u32 pass_count = info->interlaced ? 7 : 1;
+        PngPass whole_image = {0, 0, 1, 1};
+        size offset = 0;
+        for (u32 i = 0; i < pass_count && ok; ++i)
+        {
+            PngPass pass = info->interlaced ? png_adam7_passes[i] : whole_image;
+            size used = png_decode_pass(info, pass, filtered + offset, filtered_size - offset, zero_row, pixels);
+            ok = (used >= 0);
+            offset += used;
+        }
+        PROFILE_END("png_unfilter");
+    }
+
+    if (ok)
+    {
+        tex.width = (i32)info->width;
+        tex.height = (i32)info->height;
+        tex.channels = 4;
+        tex.data = pixels;
+        arena->used = arena_start + pixels_size;
+    }
+    else
+    {
+        arena->used = arena_start;
+    }
+
+    PROFILE_FUNCTION_END();
+    return tex;
+}
@@ -0,0 +1,162 @@
+#include "grapple_memory.h"
+#include "profiler.h"
+#include "texture.h"
+
+/*
+ * NOTE(lucas): QOI decoder (https://qoiformat.org/qoi-specification.pdf).
+ * The format is a single pass over the pixels with a 64-entry cache of recently seen colors, so decoding is one
+ * branch per chunk with no entropy coding. Output is always RGBA8, bottom-up like the other loaders.
+ */
+
+#define QOI_HEADER_SIZE 14
+#define QOI_PADDING_SIZE 8
+#define QOI_MAX_PIXELS (400000000u) // The spec's limit on width*height
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xC0
+#define QOI_OP_RGB   0xFE
+#define QOI_OP_RGBA  0xFF
+#define QOI_MASK_2   0xC0
+
+typedef union
+{
+    struct { u8 r, g, b, a; };
+    u32 value;
+} QoiPixel;
+
+internal inline u32 qoi_read_u32_be(u8* p)
+{
+    return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | (u32)p[3];
+}
+
+internal inline u32 qoi_hash(QoiPixel px)
+{
+    return ((u32)px.r*3 + (u32)px.g*5 + (u32)px.b*7 + (u32)px.a*11) & 63;
+}
+
+b32 is_qoi(u8* data, size data_size)
+{
+    return data_size >= QOI_HEADER_SIZE && data[0] == 'q' && data[1] == 'o' && data[2] == 'i' && data[3] == 'f';
+}
+
+Texture load_qoi_from_memory(u8* data, size data_size, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    Texture tex = {0};
+    if (!is_qoi(data, data_size) || data_size < QOI_HEADER_SIZE + QOI_PADDING_SIZE)
+    {
+        PROFILE_FUNCTION_END();
+        return tex;
+    }
+
+    u32 width = qoi_read_u32_be(data + 4);
+    u32 height = qoi_read_u32_be(data + 8);
+    u8 channels = data[12];
+    u8 colorspace = data[13];
+    if (!width || !height || height >= QOI_MAX_PIXELS / width || channels < 3 || channels > 4 || colorspace > 1)
+    {
+        PROFILE_FUNCTION_END();
+        return tex;
+    }
+
+    size arena_start = arena->used;
+    arena_align(arena, sizeof(u32));
+    u32* pixels = push_array(arena, (size)width*height, u32);
+    if (!pixels)
+    {
+        arena->used = arena_start;
+        PROFILE_FUNCTION_END();
+        return tex;
+    }
+
+    QoiPixel index[64] = {0};
+    QoiPixel px = {0};
+    px.a = 255;
+
+    u8* p = data + QOI_HEADER_SIZE;
+    u8* chunks_end = data + data_size - QOI_PADDING_SIZE;
+    u32 run = 0;
+    b32 truncated = false;
+
+    // Chunks are in top-down order, rows are written bottom-up
+    for (u32 y = 0; y < height && !truncated; ++y)
+    {
+        u32* out = pixels + (size)(height - 1 - y)*width;
+        for (u32 x = 0; x < width; ++x)
+        {
+            if (run)
+            {
+                --run;
+                out[x] = px.value;
+                continue;
+            }
+
+            // The longest chunk is 5 bytes, and the padding at the end guarantees every chunk can be read whole
+            if (p >= chunks_end)
+            {
+                truncated = true;
+                break;
+            }
+
+            u8 b1 = *p++;
+            if (b1 == QOI_OP_RGB)
+            {
+                px.r = p[0];
+                px.g = p[1];
+                px.b = p[2];
+                p += 3;
+            }
+            else if (b1 == QOI_OP_RGBA)
+            {
+                px.r = p[0];
+                px.g = p[1];
+                px.b = p[2];
+                px.a = p[3];
+                p += 4;
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX)
+            {
+                px = index[b1];
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF)
+            {
+                px.r = (u8)(px.r + ((b1 >> 4) & 3) - 2);
+                px.g = (u8)(px.g + ((b1 >> 2) & 3) - 2);
+                px.b = (u8)(px.b + (b1 & 3) - 2);
+            }
+            else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA)
+            {
+                u8 b2 = *p++;
+                i32 dg = (b1 & 63) - 32;
+                px.r = (u8)(px.r + dg - 8 + ((b2 >> 4) & 15));
+                px.g = (u8)(px.g + dg);
+                px.b = (u8)(px.b + dg - 8 + (b2 & 15));
+            }
+            else // QOI_OP_RUN
+            {
+                run = b1 & 63;
+            }
+
+            index[qoi_hash(px)] = px;
+            out[x] = px.value;
+        }
+    }
+
+    if (truncated)
+    {
+        arena->used = arena_start;
+    }
+    else
+    {
+        tex.width = (i32)width;
+        tex.height = (i32)height;
+        tex.channels = 4;
+        tex.data = (u8*)pixels;
+    }
+
+    PROFILE_FUNCTION_END();
+    return tex;
+}
@@ -1,7 +1,125 @@
 #include "renderer.h"
+#include "renderer/capture.h"
 
-#ifdef _WIN32
+#if defined(GRAPPLE_RENDERER_NULL)
+    #include "renderer/null/null_renderer.c"
+#elif defined(_WIN32)
     #include "renderer/d3d11/d3d11_renderer.c"
 #else
     #error "No renderer backend defined!"
 #endif
+
+// Writes the four vertices of an axis-aligned quad showing the whole texture
+internal inline void quad_write_vertices(Vertex* verts, v2 pos, v2 dim)
+{
+    f32 x = pos.x;
+    f32 y = pos.y;
+    f32 w = dim.x;
+    f32 h = dim.y;
+    verts[0] = (Vertex){ pos,              v2(0.0f, 1.0f) };
+    verts[1] = (Vertex){ v2(x + w, y),     v2(1.0f, 1.0f) };
+    verts[2] = (Vertex){ v2(x,     y + h), v2(0.0f, 0.0f) };
+    verts[3] = (Vertex){ v2(x + w, y + h), v2(1.0f, 0.0f) };
+}
+
+#include "renderer/capture.c"
+#include "renderer/draw_list.c"
+
+// NOTE(lucas): Quad batching is shared by all backends. Each backend's Renderer provides cpu_vb, the batch
+// counters and current_texture, and renderer_flush_quads submits whatever is in cpu_vb.
+internal void renderer_draw_texture(Renderer* renderer, Texture* texture, v2 pos, v2 dim)
+{
+    capture_draw_texture(texture, pos, dim);
+    if (!renderer->has_damage || !rect_overlaps(renderer->damage, rect_min_dim(pos, dim)))
+        return;
+
+    if (renderer->quads_in_batch >= renderer->quads_per_batch || texture != renderer->current_texture)
+        renderer_flush_quads(renderer);
+    renderer->current_texture = texture;
+
+    quad_write_vertices(renderer->cpu_vb + renderer->quads_in_batch*4, pos, dim);
+
+    ++renderer->quads_in_batch;
+    ++renderer->total_quads;
+}
+
+internal void renderer_draw_quads(Renderer* renderer, Texture* texture, QuadsSoA quads, size count,
+                                  m2x3* transform, rect* clip)
+{
+    capture_draw_quads(texture, quads, count, transform, clip);
+    if (!renderer->has_damage || count <= 0)
+        return;
+
+    // Without a transform the damage can be folded into the clip rect, so quads outside it collapse to nothing
+    // on the CPU. With a transform the clip rect is in a different space, and the scissor rect handles it.
+    rect damage_clip = {0};
+    if (!transform)
+    {
+        damage_clip = clip ? rect_intersect(*clip, renderer->damage) : renderer->damage;
+        clip = &damage_clip;
+    }
+
+    if (texture != renderer->current_texture)
+        renderer_flush_quads(renderer);
+    renderer->current_texture = texture;
+
+    size first = 0;
+    while (first < count)
+    {
+        if (renderer->quads_in_batch >= renderer->quads_per_batch)
+            renderer_flush_quads(renderer);
+
+        size batch_count = renderer->quads_per_batch - renderer->quads_in_batch;
+        if (batch_count > count - first)
+            batch_count = count - first;
+
+        f32* verts = (f32*)(renderer->cpu_vb + renderer->quads_in_batch*4);
+        quads_expand(verts, quads_soa_offset(quads, first), batch_count, transform, clip);
+
+        renderer->quads_in_batch += (i16)batch_count;
+        renderer->total_quads += (i32)batch_count;
+        first += batch_count;
+    }
+}
+
+internal QuadsSoA quads_soa_alloc(Arena* arena, size count)
+{
+    QuadsSoA result = {0};
+    result.x = push_array(arena, count, f32);
+    result.y = push_array(arena, count, f32);
+    result.w = push_array(arena, count, f32);
+    result.h = push_array(arena, count, f32);
+    result.u0 = push_array(arena, count, f32);
+    result.v0 = push_array(arena, count, f32);
+    result.u1 = push_array(arena, count, f32);
+    result.v1 = push_array(arena, count, f32);
+    return result;
+}
+
+internal void renderer_invalidate(Renderer* renderer, rect region)
+{
+    rect target = rect_min_dim(v2_zero(), v2((f32)renderer->width, (f32)renderer->height));
+    region = rect_intersect(region, target);
+    if (rect_is_empty(region))
+        return;
+
+    // Snap outward to whole pixels so the scissor rect covers everything that was invalidated
+    region.min = v2(floorf(region.min.x), floorf(region.min.y));
+    region.max = v2(ceilf(region.max.x), ceilf(region.max.y));
+
+    if (renderer->has_damage)
+        renderer->damage = rect_union(renderer->damage, region);
+    else
+        renderer->damage = region;
+    renderer->has_damage = true;
+}
+
+internal void renderer_invalidate_all(Renderer* renderer)
+{
+    renderer_invalidate(renderer, rect_min_dim(v2_zero(), v2((f32)renderer->width, (f32)renderer->height)));
+}
+
+internal b32 renderer_has_damage(Renderer* renderer)
+{
+    return renderer->has_damage;
+}
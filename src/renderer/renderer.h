@@ -2,19 +2,41 @@
 
 #include "grapple_math.h"
 #include "grapple_memory.h"
+#include "renderer/draw_list.h"
 #include "texture.h"
 #include "types.h"
 #include "window.h"
 
 typedef struct Renderer Renderer;
 
+typedef struct Vertex
+{
+    v2 pos; // Screen-space position
+    v2 tex_coord;
+} Vertex;
+
 internal Renderer* renderer_create(Window* window, Arena* arena);
 internal void renderer_destroy(Renderer* renderer);
 
 internal void renderer_set_projection(Renderer* renderer, m4 proj);
 internal void renderer_upload_texture(Renderer* renderer, Texture* texture);
+// Copies a rectangle of texture->data to the uploaded texture, for textures that are filled in as they are used,
+// like atlases. RGBA8 without mips only. Captures keep what a texture held when it was first drawn.
+internal void renderer_update_texture(Renderer* renderer, Texture* texture, i32 x, i32 y, i32 width, i32 height);
 internal void renderer_draw_texture(Renderer* renderer, Texture* texture, v2 pos, v2 dim);
 
+// Bulk submission for many quads sharing one texture. transform and clip are optional, see quads_expand.
+internal void renderer_draw_quads(Renderer* renderer, Texture* texture, QuadsSoA quads, size count,
+                                  m2x3* transform, rect* clip);
+internal QuadsSoA quads_soa_alloc(Arena* arena, size count);
+internal void renderer_flush_quads(Renderer* renderer); // Implemented by each backend
+
+// NOTE(lucas): Damage tracking. Only regions invalidated since the last frame are redrawn: draws that miss the
+// damage are culled, the rest are clipped to it, and a frame with no damage presents nothing.
+internal void renderer_invalidate(Renderer* renderer, rect region);
+internal void renderer_invalidate_all(Renderer* renderer);
+internal b32 renderer_has_damage(Renderer* renderer);
+
 internal void renderer_clear(Renderer* renderer, v4 clear_color);
 internal void renderer_begin_frame(Renderer* renderer, Window* window);
 internal void renderer_end_frame(Renderer* renderer);
@@ -1,7 +1,17 @@
 #include "file.c"
 #include "grapple_math.h"
 #include "grapple_memory.h"
+#include "profiler.h"
 #include "texture.h"
+#include "thread.h"
+
+#include "renderer/bc.c"
+#include "renderer/dds.c"
+#include "renderer/mip.c"
+#include "renderer/png.c"
+#include "renderer/qoi.c"
+
+#include <string.h> // memmove
 
 // TODO(lucas): Full bitmap support should separate the BMP header from the DIB header
 // and allow using different versions of the DIB header.
@@ -41,11 +51,21 @@ typedef struct BitmapHeader
 BitScanResult find_least_significant_bit(u32 value)
 {
     BitScanResult result = {0};
-    result.found = _BitScanForward(&result.index, value);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    result.found = _BitScanForward(&index, value);
+    result.index = (u32)index;
+#else
+    if (value)
+    {
+        result.found = true;
+        result.index = (u32)__builtin_ctz(value);
+    }
+#endif
     return result;
 }
 
-inline v4 srgb255_to_linear1(v4 c)
+internal inline v4 srgb255_to_linear1(v4 c)
 {
     v4 result = v4_zero();
 
@@ -59,7 +79,7 @@ inline v4 srgb255_to_linear1(v4 c)
     return result;
 }
 
-inline v4 linear1_to_srgb255(v4 c)
+internal inline v4 linear1_to_srgb255(v4 c)
 {
     v4 result = v4_zero();
 
@@ -73,6 +93,8 @@ inline v4 linear1_to_srgb255(v4 c)
 
 Texture load_bmp_from_memory(u8* data, size data_size)
 {
+    PROFILE_FUNCTION_BEGIN();
+
     Texture tex = {0};
     if (data_size)
     {
@@ -164,6 +186,8 @@ Texture load_bmp_from_memory(u8* data, size data_size)
     }
 
     ASSERT(tex.data, "Failed to load texture");
+
+    PROFILE_FUNCTION_END();
     return tex;
 }
 
@@ -178,30 +202,156 @@ Texture load_bmp_from_file(char* filename, Arena* arena)
     return result;
 }
 
-Texture texture_load_from_file(char* filename, Renderer* renderer, Arena* arena)
+internal inline i32 texture_mip_dim(i32 dim, i32 level)
 {
-    size file_size = file_get_size(filename);
-    void* file = file_open(filename, FileMode_Read);
-    u16 signature = 0;
-    file_read(file, &signature, sizeof(signature));
-    b32 is_bmp = (signature == 0x4D42);
+    i32 result = dim >> level;
+    return result > 0 ? result : 1;
+}
+
+internal size texture_level_data_size(Texture* texture, i32 level)
+{
+    i32 width = texture_mip_dim(texture->width, level);
+    i32 height = texture_mip_dim(texture->height, level);
+    size result = (size)width*height*texture->channels;
+    u32 block_bytes = bc_block_bytes(texture->format);
+    if (block_bytes)
+        result = (size)((width + 3) / 4)*((height + 3) / 4)*block_bytes;
+    return result;
+}
 
-    ASSERT(is_bmp, "Only BMP textures are currently supported");
+size texture_data_size(Texture* texture)
+{
+    size result = 0;
+    i32 mip_count = texture->mip_count > 1 ? texture->mip_count : 1;
+    for (i32 level = 0; level < mip_count; ++level)
+        result += texture_level_data_size(texture, level);
+    return result;
+}
+
+i32 texture_full_mip_count(i32 width, i32 height)
+{
+    i32 result = 1;
+    i32 dim = width > height ? width : height;
+    while (dim > 1)
+    {
+        dim >>= 1;
+        ++result;
+    }
+    return result;
+}
+
+Texture texture_mip_level(Texture* texture, i32 level)
+{
+    ASSERT(level == 0 || level < texture->mip_count, "Mip level out of range");
+
+    Texture result = *texture;
+    result.width = texture_mip_dim(texture->width, level);
+    result.height = texture_mip_dim(texture->height, level);
+    result.api_handle = 0;
+    result.mip_count = 1;
+    for (i32 i = 0; i < level; ++i)
+        result.data += texture_level_data_size(texture, i);
+    return result;
+}
+
+internal inline b32 is_bmp(u8* data, size data_size)
+{
+    return data_size >= (size)sizeof(BitmapHeader) && data[0] == 'B' && data[1] == 'M';
+}
+
+Texture texture_decode_from_memory(u8* data, size data_size, Arena* arena)
+{
+    Texture tex = {0};
+    if (is_bmp(data, data_size))
+        tex = load_bmp_from_memory(data, data_size);
+    else if (is_png(data, data_size))
+        tex = load_png_from_memory(data, data_size, arena);
+    else if (is_qoi(data, data_size))
+        tex = load_qoi_from_memory(data, data_size, arena);
+    else if (is_dds(data, data_size))
+        tex = load_dds_from_memory(data, data_size, arena);
+    return tex;
+}
 
+// Reads and decodes a file without uploading it, so it is safe to call from any thread with its own arena
+internal Texture texture_read_from_file(char* filename, Arena* arena)
+{
     Texture tex = {0};
-    if (is_bmp)
+    size file_size = file_get_size(filename);
+    void* file = file_open(filename, FileMode_Read);
+    if (!file || !file_size)
     {
-        file_seek_begin(file);
-        u8* data = push_size(arena, file_size);
+        if (file)
+            file_close(file);
+        return tex;
+    }
+
+    PROFILE_BEGIN("file_read");
+    size arena_start = arena->used;
+    u8* data = push_size(arena, file_size);
+    if (data)
         file_read(file, data, file_size);
-        tex = load_bmp_from_memory(data, file_size);
-        file_close(file);
+    file_close(file);
+    PROFILE_END("file_read");
+
+    if (data)
+        tex = texture_decode_from_memory(data, file_size, arena);
+
+    if (!tex.data)
+    {
+        arena->used = arena_start;
+    }
+    else if (tex.data >= data + file_size)
+    {
+        // NOTE(lucas): BMP and DDS are used in place, but compressed formats are decoded after the file data, which
+        // is no longer needed. Sliding the pixels down over it keeps only the pixels on the arena.
+        size pixels_size = texture_data_size(&tex);
+        memmove(data, tex.data, (usize)pixels_size);
+        tex.data = data;
+        arena->used = arena_start + pixels_size;
     }
-    else
-        return tex;
 
-    ASSERT(tex.data, "Failed to laod texture");
+    return tex;
+}
 
-    renderer_upload_texture(renderer, &tex);
+Texture texture_load_from_file(char* filename, Renderer* renderer, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    Texture tex = texture_read_from_file(filename, arena);
+    ASSERT(tex.data, "Failed to load texture");
+    if (tex.data)
+        renderer_upload_texture(renderer, &tex);
+
+    PROFILE_FUNCTION_END();
     return tex;
 }
+
+internal void texture_load_job(void* data)
+{
+    PROFILE_FUNCTION_BEGIN();
+    TextureLoad* load = (TextureLoad*)data;
+    load->texture = texture_read_from_file(load->filename, load->arena);
+    if (load->generate_mips && load->texture.data && load->texture.format == TextureFormat_RGBA8)
+        load->texture = texture_generate_mips(&load->texture, load->arena);
+    PROFILE_FUNCTION_END();
+}
+
+// NOTE(lucas): Reading and decoding run on the work queue, one file per entry, and uploads happen afterwards on
+// the calling thread since the renderer is not thread safe. Files that fail to load are left with no data.
+void texture_load_from_files(WorkQueue* queue, TextureLoad* loads, u32 count, Renderer* renderer)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    for (u32 i = 0; i < count; ++i)
+        work_queue_add(queue, texture_load_job, &loads[i]);
+    work_queue_complete_all(queue);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (loads[i].texture.data)
+            renderer_upload_texture(renderer, &loads[i].texture);
+    }
+
+    PROFILE_FUNCTION_END();
+}
@@ -6,9 +6,21 @@
 typedef struct
 {
     b32 found;
-    DWORD index;
+    u32 index;
 } BitScanResult;
 
+typedef enum
+{
+    TextureFormat_RGBA8 = 0,
+    TextureFormat_BC1,   // 4x4 blocks of 8 bytes: RGB with 1-bit alpha
+    TextureFormat_BC3,   // 4x4 blocks of 16 bytes: BC1 color plus 8-bit alpha
+    TextureFormat_BC7,   // 4x4 blocks of 16 bytes: RGBA
+    TextureFormat_Count,
+} TextureFormat;
+
+// Enough for a 65536x65536 texture, the largest any loader accepts
+#define TEXTURE_MAX_MIP_LEVELS 17
+
 typedef struct
 {
     i32 channels;
@@ -16,7 +28,56 @@ typedef struct
     i32 height;
     u8* data;
     void* api_handle;
+    TextureFormat format; // Block-compressed base levels are whole blocks, so width and height are multiples of 4
+
+    // NOTE(lucas): Levels are stored one after another in data, each half the size of the last (rounding down, but
+    // at least 1) until 1x1. 0 and 1 both mean just the base level. Block-compressed levels round up to whole
+    // blocks, so the ones smaller than a block still take a whole block.
+    i32 mip_count;
 } Texture;
 
+// One file for texture_load_from_files. Each load gets its own arena, which holds the file and then the pixels.
+typedef struct
+{
+    char* filename;
+    Arena* arena;
+    b32 generate_mips; // For images drawn smaller than their size, such as thumbnails
+    Texture texture; // data is 0 if the file could not be read or decoded
+} TextureLoad;
+
 Texture load_bmp_from_memory(u8* data, size data_size);
 Texture load_bmp_from_file(char* filename, Arena* arena);
+
+// NOTE(lucas): The QOI and PNG decoders leave the source data alone and push RGBA8 pixels onto the arena. On
+// failure they return a texture with no data and leave the arena as it was.
+b32 is_qoi(u8* data, size data_size);
+Texture load_qoi_from_memory(u8* data, size data_size, Arena* arena);
+b32 is_png(u8* data, size data_size);
+Texture load_png_from_memory(u8* data, size data_size, Arena* arena);
+
+// DDS holding BC1, BC3 or BC7 data, used in place like BMP, along with its mip levels. The blocks are flipped in
+// place to bottom-up, and the arena is only used while they are.
+b32 is_dds(u8* data, size data_size);
+Texture load_dds_from_memory(u8* data, size data_size, Arena* arena);
+b32 dds_write(char* filename, Texture* texture, Arena* arena);
+
+// Size of every level together
+size texture_data_size(Texture* texture);
+
+// Number of levels in a full chain down to 1x1
+i32 texture_full_mip_count(i32 width, i32 height);
+
+// A single-level texture that views one level of texture's data
+Texture texture_mip_level(Texture* texture, i32 level);
+
+// Builds the full mip chain of an RGBA8 texture with a box filter in linear space. The new levels are pushed right
+// after the base level when it is the last thing on the arena, and the base level is copied first otherwise. The
+// texture is returned as it was if it already has mips or the arena is full.
+Texture texture_generate_mips(Texture* texture, Arena* arena);
+
+// Shrinks an RGBA8 texture to width by height, which are at most its own, with the same filter as the mips. The
+// pixels are pushed onto the arena. Returns a texture with no data if they don't fit.
+Texture texture_downsample(Texture* source, i32 width, i32 height, Arena* arena);
+
+// Picks the decoder from the file signature
+Texture texture_decode_from_memory(u8* data, size data_size, Arena* arena);
@@ -0,0 +1,796 @@
+#include "atomic.h"
+#include "containers.h"
+#include "file.h"
+#include "profiler.h"
+#include "renderer/bc.h"
+#include "renderer/renderer.h"
+#include "renderer/texture.h"
+#include "renderer/thumbnail.h"
+#include "str.h"
+#include "thread.h"
+
+#include <string.h> // memcpy, memmove, strlen
+
+#define THUMBNAIL_ALIGN(value) (((value) + 7) & ~(u64)7)
+#define THUMBNAIL_CACHE_MAX_ENTRIES (1u << 20)
+
+i32 thumbnail_dim(ThumbnailSize thumbnail_size)
+{
+    return 64 << thumbnail_size;
+}
+
+// Every size of an image is its own entry, so the size is part of every key
+internal inline u64 thumbnail_key(u64 hash, ThumbnailSize thumbnail_size)
+{
+    return hash_u64(hash ^ ((u64)thumbnail_size + 1)*0x9E3779B97F4A7C15ull);
+}
+
+internal inline u64 thumbnail_path_hash(char* path)
+{
+    s8 name = {(u8*)path, (size)strlen(path)};
+    return s8_hash(name);
+}
+
+internal inline u64 thumbnail_stamp(char* path, FileInfo* info)
+{
+    return hash_u64(hash_u64(thumbnail_path_hash(path) ^ info->size) ^ info->modified);
+}
+
+internal inline size thumbnail_pixels_size(u32 width, u32 height)
+{
+    return (size)width*height*4;
+}
+
+//
+// Cache
+//
+
+b32 thumbnail_cache_from_memory(ThumbnailCache* cache, u8* data, size data_size)
+{
+    zero_struct(*cache);
+    cache->arena = arena_alloc(THUMBNAIL_CACHE_MEMORY);
+
+    ThumbnailCacheHeader* header = (ThumbnailCacheHeader*)data;
+    if (!data || !cache->arena.data || data_size < (size)sizeof(ThumbnailCacheHeader) ||
+        header->magic != THUMBNAIL_CACHE_MAGIC || header->version != THUMBNAIL_CACHE_VERSION ||
+        header->file_size != (u64)data_size || header->entry_count > THUMBNAIL_CACHE_MAX_ENTRIES)
+        return false;
+
+    u64 pixels_offset = sizeof(ThumbnailCacheHeader) + (u64)header->entry_count*sizeof(ThumbnailCacheEntry);
+    if (pixels_offset + header->pixels_size != (u64)data_size)
+        return false;
+
+    // NOTE(lucas): Everything that would send a reader out of bounds is checked rather than trusted
+    ThumbnailCacheEntry* entries = (ThumbnailCacheEntry*)(data + sizeof(ThumbnailCacheHeader));
+    for (u32 i = 0; i < header->entry_count; ++i)
+    {
+        ThumbnailCacheEntry* entry = &entries[i];
+        if (entry->size >= ThumbnailSize_Count)
+            return false;
+        i32 dim = thumbnail_dim((ThumbnailSize)entry->size);
+        if (!entry->width || !entry->height || entry->width > dim || entry->height > dim ||
+            (entry->pixels_offset & 7) || entry->pixels_offset > header->pixels_size ||
+            (u64)thumbnail_pixels_size(entry->width, entry->height) > header->pixels_size - entry->pixels_offset)
+            return false;
+    }
+
+    u32 capacity = header->entry_count*2 + 16;
+    if (!thumbnail_key_map_init(&cache->by_stamp, &cache->arena, capacity) ||
+        !thumbnail_key_map_init(&cache->by_content, &cache->arena, capacity))
+    {
+        arena_clear(&cache->arena);
+        zero_struct(cache->by_stamp);
+        zero_struct(cache->by_content);
+        return false;
+    }
+
+    for (u32 i = 0; i < header->entry_count; ++i)
+    {
+        ThumbnailSize thumbnail_size = (ThumbnailSize)entries[i].size;
+        thumbnail_key_map_put(&cache->by_stamp, thumbnail_key(entries[i].stamp, thumbnail_size), i);
+        thumbnail_key_map_put(&cache->by_content, thumbnail_key(entries[i].content_hash, thumbnail_size), i);
+    }
+
+    cache->header = header;
+    cache->entries = entries;
+    cache->pixels = data + pixels_offset;
+    return true;
+}
+
+b32 thumbnail_cache_open(ThumbnailCache* cache, char* filename)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    FileMapping mapping = file_map(filename);
+    b32 result = thumbnail_cache_from_memory(cache, mapping.data, mapping.size);
+    if (result)
+        cache->mapping = mapping;
+    else
+        file_unmap(&mapping);
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+void thumbnail_cache_close(ThumbnailCache* cache)
+{
+    file_unmap(&cache->mapping);
+    cache->header = 0;
+    cache->entries = 0;
+    cache->pixels = 0;
+    zero_struct(cache->by_stamp);
+    zero_struct(cache->by_content);
+    arena_clear(&cache->arena);
+    zero_struct(cache->added);
+}
+
+ThumbnailCacheEntry* thumbnail_cache_find_stamp(ThumbnailCache* cache, u64 stamp, ThumbnailSize thumbnail_size)
+{
+    u32* index = thumbnail_key_map_get(&cache->by_stamp, thumbnail_key(stamp, thumbnail_size));
+    ThumbnailCacheEntry* result = index ? &cache->entries[*index] : 0;
+    return (result && result->stamp == stamp && result->size == (u32)thumbnail_size) ? result : 0;
+}
+
+ThumbnailCacheEntry* thumbnail_cache_find_content(ThumbnailCache* cache, u64 content_hash, ThumbnailSize thumbnail_size)
+{
+    u32* index = thumbnail_key_map_get(&cache->by_content, thumbnail_key(content_hash, thumbnail_size));
+    ThumbnailCacheEntry* result = index ? &cache->entries[*index] : 0;
+    return (result && result->content_hash == content_hash && result->size == (u32)thumbnail_size) ? result : 0;
+}
+
+u8* thumbnail_cache_pixels(ThumbnailCache* cache, ThumbnailCacheEntry* entry)
+{
+    return cache->pixels + entry->pixels_offset;
+}
+
+u8* thumbnail_cache_add(ThumbnailCache* cache, ThumbnailCacheEntry* entry, u8* pixels)
+{
+    size pixels_size = thumbnail_pixels_size(entry->width, entry->height);
+    b32 in_file = cache->header && pixels >= cache->pixels && pixels < cache->pixels + cache->header->pixels_size;
+
+    // Room for the pixels and for the array to move to twice its size, each aligned
+    size needed = (size)(cache->added.capacity*2 + 16)*(size)sizeof(ThumbnailCacheAdded) + 8;
+    if (!in_file)
+        needed += pixels_size + 8;
+    if (cache->arena.bytes - cache->arena.used < needed)
+        return 0;
+
+    u8* kept = pixels;
+    if (!in_file)
+    {
+        arena_align(&cache->arena, 8);
+        kept = push_array(&cache->arena, pixels_size, u8);
+        memcpy(kept, pixels, (usize)pixels_size);
+    }
+
+    // The pixels leave the arena unaligned whenever their size isn't a multiple of 8, and the array moves to the
+    // top of the arena when it grows
+    arena_align(&cache->arena, 8);
+    ThumbnailCacheAdded* added = array_push(&cache->arena, &cache->added);
+    added->entry = *entry;
+    added->pixels = kept;
+    return kept;
+}
+
+b32 thumbnail_cache_save(ThumbnailCache* cache, char* filename, Arena* scratch)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    u64 added_size = 0;
+    for (size i = 0; i < cache->added.count; ++i)
+    {
+        ThumbnailCacheEntry* entry = &cache->added.data[i].entry;
+        added_size += THUMBNAIL_ALIGN((u64)thumbnail_pixels_size(entry->width, entry->height));
+    }
+    b32 keep_old = cache->header && cache->header->pixels_size + added_size <= THUMBNAIL_CACHE_MAX_SIZE;
+    u32 old_count = keep_old ? cache->header->entry_count : 0;
+    u32 count = old_count + (u32)cache->added.count;
+
+    // NOTE(lucas): Entries with the same contents and size share pixels, written once where the first of them is.
+    // That is how a renamed or copied image costs an entry rather than another thumbnail.
+    size scratch_start = scratch->used;
+    b32 result = scratch->bytes - scratch->used >= (size)count*128 + (size)KILOBYTES(4);
+    ThumbnailCacheEntry* entries = 0;
+    u8** sources = 0;
+    ThumbnailKeyMap firsts = {0};
+    if (result)
+    {
+        arena_align(scratch, 8);
+        entries = push_array(scratch, count, ThumbnailCacheEntry);
+        sources = push_array(scratch, count, u8*);
+        result = entries && sources && thumbnail_key_map_init(&firsts, scratch, count*2 + 16);
+    }
+
+    u64 pixels_size = 0;
+    for (u32 i = 0; result && i < count; ++i)
+    {
+        ThumbnailCacheEntry entry = (i < old_count) ? cache->entries[i] : cache->added.data[i - old_count].entry;
+        u8* source = (i < old_count) ? thumbnail_cache_pixels(cache, &cache->entries[i]) :
+                                       cache->added.data[i - old_count].pixels;
+        u64 key = thumbnail_key(entry.content_hash, (ThumbnailSize)entry.size);
+        u32* first = thumbnail_key_map_get(&firsts, key);
+        if (first)
+        {
+            entry.pixels_offset = entries[*first].pixels_offset;
+            source = 0;
+        }
+        else
+        {
+            result = thumbnail_key_map_put(&firsts, key, i) != 0;
+            entry.pixels_offset = pixels_size;
+            pixels_size += THUMBNAIL_ALIGN((u64)thumbnail_pixels_size(entry.width, entry.height));
+        }
+        entries[i] = entry;
+        sources[i] = source;
+    }
+
+    ThumbnailCacheHeader header = {0};
+    header.magic = THUMBNAIL_CACHE_MAGIC;
+    header.version = THUMBNAIL_CACHE_VERSION;
+    header.entry_count = count;
+    header.pixels_size = pixels_size;
+    header.file_size = sizeof(ThumbnailCacheHeader) + (u64)count*sizeof(ThumbnailCacheEntry) + pixels_size;
+
+    char temp[THUMBNAIL_MAX_PATH];
+    size length = (size)strlen(filename);
+    void* file = 0;
+    if (result && length + 5 <= THUMBNAIL_MAX_PATH)
+    {
+        memcpy(temp, filename, (usize)length);
+        memcpy(temp + length, ".tmp", 5);
+        file = file_open(temp, FileMode_Create);
+    }
+    result = file != 0;
+
+    if (file)
+    {
+        u8 padding[8] = {0};
+        size entries_size = (size)count*(size)sizeof(ThumbnailCacheEntry);
+        result = file_write(file, &header, sizeof(header)) == (int)sizeof(header) &&
+                 file_write(file, entries, entries_size) == (int)entries_size;
+        for (u32 i = 0; result && i < count; ++i)
+        {
+            if (!sources[i])
+                continue;
+            size bytes = thumbnail_pixels_size(entries[i].width, entries[i].height);
+            size padding_size = (size)THUMBNAIL_ALIGN((u64)bytes) - bytes;
+            result = file_write(file, sources[i], bytes) == (int)bytes &&
+                     (!padding_size || file_write(file, padding, padding_size) == (int)padding_size);
+        }
+        result = result && file_flush(file);
+        file_close(file);
+    }
+
+    // The pixels were copied out of the mapping, which has to be gone before the file can be replaced
+    thumbnail_cache_close(cache);
+    scratch->used = scratch_start;
+
+    if (file)
+    {
+        result = result && file_replace(temp, filename);
+        if (!result)
+            file_delete(temp);
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+//
+// Decoding
+//
+
+// load_bmp_from_memory trusts the header, which a file off disk can't be
+internal b32 thumbnail_bmp_is_valid(u8* data, size data_size)
+{
+    BitmapHeader* header = (BitmapHeader*)data;
+    if (header->width <= 0 || header->height <= 0)
+        return false;
+    if (header->compression == 0)
+    {
+        if (header->bits_per_pixel != 24 && header->bits_per_pixel != 32)
+            return false;
+    }
+    else if (header->compression != 3 || header->bits_per_pixel != 32 || !header->red_mask ||
+             !header->green_mask || !header->blue_mask)
+    {
+        return false;
+    }
+
+    u64 row_size = ((u64)header->width*(header->bits_per_pixel / 8) + 3) & ~(u64)3;
+    return (u64)header->pixel_array_offset + row_size*(u64)header->height <= (u64)data_size;
+}
+
+// 24-bit BMPs are the only textures with three channels, and their rows are padded to 4 bytes
+internal Texture thumbnail_expand_rgb(Texture* source, Arena* arena)
+{
+    Texture result = *source;
+    result.channels = 4;
+    result.data = push_array(arena, (size)source->width*source->height*4, u8);
+    if (!result.data)
+        return result;
+
+    size pitch = ((size)source->width*3 + 3) & ~(size)3;
+    for (i32 y = 0; y < source->height; ++y)
+    {
+        u8* in = source->data + (size)y*pitch;
+        u8* out = result.data + (size)y*source->width*4;
+        for (i32 x = 0; x < source->width; ++x)
+        {
+            out[x*4 + 0] = in[x*3 + 0];
+            out[x*4 + 1] = in[x*3 + 1];
+            out[x*4 + 2] = in[x*3 + 2];
+            out[x*4 + 3] = 0xFF;
+        }
+    }
+    return result;
+}
+
+// NOTE(lucas): The decoders assume their arena has room for the whole image. A file off disk can claim any size, so
+// its dimensions are read first and it is refused if the decoded image and a copy of it might not fit. Every format
+// but DDS keeps them in the first few bytes, in its own byte order.
+internal b32 thumbnail_image_fits(u8* data, size data_size, Arena* arena)
+{
+    u64 width = 0;
+    u64 height = 0;
+    if (is_bmp(data, data_size))
+    {
+        BitmapHeader* header = (BitmapHeader*)data;
+        width = header->width > 0 ? (u64)header->width : 0;
+        height = header->height > 0 ? (u64)header->height : 0;
+    }
+    else if (is_png(data, data_size) && data_size >= 24)
+    {
+        width = png_read_u32(data + 16);
+        height = png_read_u32(data + 20);
+    }
+    else if (is_qoi(data, data_size))
+    {
+        width = qoi_read_u32_be(data + 4);
+        height = qoi_read_u32_be(data + 8);
+    }
+    else if (is_dds(data, data_size))
+    {
+        DdsHeader* header = (DdsHeader*)data;
+        width = header->width;
+        height = header->height;
+    }
+
+    u64 needed = (u64)data_size + width*height*8 + KILOBYTES(64);
+    return width && height && width <= (1u << 16) && height <= (1u << 16) &&
+           needed <= (u64)(arena->bytes - arena->used);
+}
+
+Texture thumbnail_make(u8* data, size data_size, ThumbnailSize thumbnail_size, Arena* arena)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    size arena_start = arena->used;
+    Texture image = {0};
+    if (!thumbnail_image_fits(data, data_size, arena))
+    {
+        PROFILE_FUNCTION_END();
+        return image;
+    }
+
+    if (is_bmp(data, data_size))
+    {
+        // BMPs are decoded in place, so on a copy
+        u8* copy = thumbnail_bmp_is_valid(data, data_size) ? push_array(arena, data_size, u8) : 0;
+        if (copy)
+        {
+            memcpy(copy, data, (usize)data_size);
+            image = load_bmp_from_memory(copy, data_size);
+
+            // Without bitfields the fourth byte of a 32-bit BMP isn't alpha, and is usually 0
+            BitmapHeader* header = (BitmapHeader*)copy;
+            if (header->compression == 0 && image.channels == 4)
+            {
+                for (size i = 0; i < (size)image.width*image.height; ++i)
+                    image.data[i*4 + 3] = 0xFF;
+            }
+        }
+    }
+    else
+    {
+        // DDS files are flipped in place too
+        u8* source = data;
+        if (is_dds(data, data_size))
+        {
+            source = push_array(arena, data_size, u8);
+            memcpy(source, data, (usize)data_size);
+        }
+        image = texture_decode_from_memory(source, data_size, arena);
+        if (image.data && bc_block_bytes(image.format))
+            image = texture_decode_bc(&image, arena);
+    }
+
+    if (image.data && image.channels == 3)
+        image = thumbnail_expand_rgb(&image, arena);
+
+    Texture result = {0};
+    if (image.data && image.channels == 4 && image.width > 0 && image.height > 0)
+    {
+        // Shrunk to fit, never grown
+        i32 dim = thumbnail_dim(thumbnail_size);
+        i32 width = image.width;
+        i32 height = image.height;
+        if (width > dim && width >= height)
+        {
+            height = (i32)(((i64)height*dim + width/2) / width);
+            width = dim;
+        }
+        else if (height > dim)
+        {
+            width = (i32)(((i64)width*dim + height/2) / height);
+            height = dim;
+        }
+        image.format = TextureFormat_RGBA8;
+        result = texture_downsample(&image, width > 0 ? width : 1, height > 0 ? height : 1, arena);
+    }
+
+    // Only the thumbnail is kept, slid down over the file and the full-size image
+    if (result.data)
+    {
+        size result_size = thumbnail_pixels_size((u32)result.width, (u32)result.height);
+        memmove(arena->data + arena_start, result.data, (usize)result_size);
+        result.data = arena->data + arena_start;
+        arena->used = arena_start + result_size;
+    }
+    else
+    {
+        arena->used = arena_start;
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+// NOTE(lucas): Runs on a worker. The stamp is a stat away, so a thumbnail that is in the cache file under it costs
+// no read at all. Otherwise the file is mapped and hashed, and only decoded if its contents aren't there either.
+internal void thumbnail_job(void* data)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ThumbnailJob* job = (ThumbnailJob*)data;
+    ThumbnailRequest* request = &job->request;
+    ThumbnailCache* cache = job->cache;
+    job->source = ThumbnailSource_None;
+    job->pixels = 0;
+    zero_struct(job->entry);
+    arena_clear(&job->arena);
+
+    FileInfo info;
+    if (file_get_info(request->path, &info) && info.kind == FileEntryKind_File)
+    {
+        u64 stamp = thumbnail_stamp(request->path, &info);
+        ThumbnailCacheEntry* found = thumbnail_cache_find_stamp(cache, stamp, request->thumbnail_size);
+        if (found)
+        {
+            job->source = ThumbnailSource_Stamp;
+            job->entry = *found;
+        }
+        else
+        {
+            FileMapping mapping = file_map(request->path);
+            if (mapping.data)
+            {
+                s8 contents = {mapping.data, mapping.size};
+                u64 content_hash = s8_hash(contents);
+                found = thumbnail_cache_find_content(cache, content_hash, request->thumbnail_size);
+                if (found)
+                {
+                    job->source = ThumbnailSource_Content;
+                    job->entry = *found;
+                }
+                else
+                {
+                    Texture thumbnail = thumbnail_make(mapping.data, mapping.size, request->thumbnail_size,
+                                                       &job->arena);
+                    if (thumbnail.data)
+                    {
+                        job->source = ThumbnailSource_Decoded;
+                        job->entry.width = (u16)thumbnail.width;
+                        job->entry.height = (u16)thumbnail.height;
+                        job->entry.size = (u32)request->thumbnail_size;
+                        job->pixels = thumbnail.data;
+                    }
+                }
+                job->entry.content_hash = content_hash;
+                job->entry.stamp = stamp;
+                file_unmap(&mapping);
+            }
+        }
+
+        if (found)
+            job->pixels = thumbnail_cache_pixels(cache, found);
+    }
+
+    atomic_store_u32(&job->done, 1);
+
+    PROFILE_FUNCTION_END();
+}
+
+//
+// Atlases
+//
+
+internal b32 thumbnail_atlas_init(ThumbnailAtlas* atlas, Arena* arena, Renderer* renderer, ThumbnailSize thumbnail_size)
+{
+    i32 cell_dim = thumbnail_dim(thumbnail_size);
+    u32 cells_per_row = (u32)(THUMBNAIL_ATLAS_DIM / cell_dim);
+    u32 cell_count = cells_per_row*cells_per_row;
+    size pixels_size = (size)THUMBNAIL_ATLAS_DIM*THUMBNAIL_ATLAS_DIM*4;
+    if (arena->bytes - arena->used < pixels_size + (size)cell_count*(size)sizeof(ThumbnailCell) + 16)
+        return false;
+
+    zero_struct(*atlas);
+    atlas->cell_dim = cell_dim;
+    atlas->cells_per_row = cells_per_row;
+    atlas->cell_count = cell_count;
+    atlas->cells = push_array(arena, cell_count, ThumbnailCell);
+    zero_array(atlas->cells, cell_count, ThumbnailCell);
+
+    arena_align(arena, 16);
+    atlas->texture.width = THUMBNAIL_ATLAS_DIM;
+    atlas->texture.height = THUMBNAIL_ATLAS_DIM;
+    atlas->texture.channels = 4;
+    atlas->texture.format = TextureFormat_RGBA8;
+    atlas->texture.data = push_array(arena, pixels_size, u8);
+    memset(atlas->texture.data, 0, (usize)pixels_size);
+    renderer_upload_texture(renderer, &atlas->texture);
+    return true;
+}
+
+// Copies a thumbnail into a free cell of its size's atlas, or over the one asked for longest ago. Returns the cell,
+// or THUMBNAIL_FAILED if every cell was asked for in this frame or the last.
+internal u32 thumbnails_place(Thumbnails* thumbnails, u64 key, ThumbnailSize thumbnail_size, ThumbnailKnown* known)
+{
+    ThumbnailAtlas* atlas = &thumbnails->atlases[thumbnail_size];
+    if (!atlas->cells && !thumbnail_atlas_init(atlas, &thumbnails->arena, thumbnails->renderer, thumbnail_size))
+        return THUMBNAIL_FAILED;
+
+    u32 index = THUMBNAIL_FAILED;
+    for (u32 i = 0; i < atlas->cell_count; ++i)
+    {
+        ThumbnailCell* cell = &atlas->cells[i];
+        if (!cell->used)
+        {
+            index = i;
+            break;
+        }
+        if (cell->last_used + 1 < thumbnails->frame &&
+            (index == THUMBNAIL_FAILED || cell->last_used < atlas->cells[index].last_used))
+            index = i;
+    }
+    if (index == THUMBNAIL_FAILED)
+        return THUMBNAIL_FAILED;
+
+    ThumbnailCell* cell = &atlas->cells[index];
+    if (cell->used)
+        thumbnail_key_map_remove(&thumbnails->resident, cell->key);
+    cell->used = false;
+    if (!thumbnail_key_map_put(&thumbnails->resident, key, index))
+        return THUMBNAIL_FAILED;
+
+    cell->used = true;
+    cell->key = key;
+    cell->last_used = thumbnails->frame;
+    cell->width = known->width;
+    cell->height = known->height;
+
+    i32 x = (i32)(index % atlas->cells_per_row)*atlas->cell_dim;
+    i32 y = (i32)(index / atlas->cells_per_row)*atlas->cell_dim;
+    size row_size = (size)known->width*4;
+    for (i32 row = 0; row < known->height; ++row)
+    {
+        u8* out = atlas->texture.data + ((size)(y + row)*THUMBNAIL_ATLAS_DIM + x)*4;
+        memcpy(out, known->pixels + row*row_size, (usize)row_size);
+    }
+    renderer_update_texture(thumbnails->renderer, &atlas->texture, x, y, known->width, known->height);
+    return index;
+}
+
+//
+// Pipeline
+//
+
+Thumbnails* thumbnails_create(Renderer* renderer, ThumbnailCache* cache, u32 thread_count)
+{
+    Arena arena = arena_alloc(THUMBNAIL_MEMORY);
+    Thumbnails* thumbnails = arena.data ? push_struct(&arena, Thumbnails) : 0;
+    if (!thumbnails)
+        return 0;
+
+    zero_struct(*thumbnails);
+    thumbnails->arena = arena;
+    thumbnails->renderer = renderer;
+    thumbnails->cache = cache;
+    thumbnails->frame = 1;
+
+    if (!thumbnail_key_map_init(&thumbnails->resident, &thumbnails->arena, 1024) ||
+        !thumbnail_key_map_init(&thumbnails->known, &thumbnails->arena, 1024) ||
+        !thumbnail_key_map_init(&thumbnails->pending, &thumbnails->arena, THUMBNAIL_MAX_PENDING*2))
+        return 0;
+
+    // A couple of jobs per thread, so a worker that finishes one has the next waiting
+    thread_count = thread_count ? thread_count : 1;
+    u32 job_count = thread_count*2 < THUMBNAIL_MAX_JOBS ? thread_count*2 : THUMBNAIL_MAX_JOBS;
+    for (u32 i = 0; i < job_count; ++i)
+    {
+        ThumbnailJob* job = &thumbnails->jobs[thumbnails->job_count];
+        job->cache = cache;
+        job->arena = arena_alloc(THUMBNAIL_JOB_MEMORY);
+        if (job->arena.data)
+            ++thumbnails->job_count;
+    }
+    if (!thumbnails->job_count)
+        return 0;
+
+    thumbnails->queue = work_queue_create(&thumbnails->arena, thread_count);
+    return thumbnails;
+}
+
+internal void thumbnails_ask(Thumbnails* thumbnails, u64 key, ThumbnailSize thumbnail_size, char* path)
+{
+    u32* asked = thumbnail_key_map_get(&thumbnails->pending, key);
+    if (asked)
+    {
+        *asked = thumbnails->frame;
+        return;
+    }
+
+    size length = (size)strlen(path);
+    if (length >= THUMBNAIL_MAX_PATH)
+    {
+        thumbnail_key_map_put(&thumbnails->known, key, THUMBNAIL_FAILED);
+        return;
+    }
+
+    // Asked again next frame if there's no room now
+    if (thumbnails->pending_count == THUMBNAIL_MAX_PENDING ||
+        !thumbnail_key_map_put(&thumbnails->pending, key, thumbnails->frame))
+        return;
+
+    u32 index = (thumbnails->pending_first + thumbnails->pending_count) % THUMBNAIL_MAX_PENDING;
+    ThumbnailRequest* request = &thumbnails->requests[index];
+    ++thumbnails->pending_count;
+    request->key = key;
+    request->thumbnail_size = thumbnail_size;
+    memcpy(request->path, path, (usize)length + 1);
+}
+
+Thumbnail thumbnail_get(Thumbnails* thumbnails, char* path, ThumbnailSize thumbnail_size)
+{
+    Thumbnail result = {0};
+    u64 key = thumbnail_key(thumbnail_path_hash(path), thumbnail_size);
+
+    u32 index = THUMBNAIL_FAILED;
+    u32* resident = thumbnail_key_map_get(&thumbnails->resident, key);
+    if (resident)
+    {
+        index = *resident;
+    }
+    else
+    {
+        u32* known = thumbnail_key_map_get(&thumbnails->known, key);
+        if (!known)
+            thumbnails_ask(thumbnails, key, thumbnail_size, path);
+        else if (*known == THUMBNAIL_FAILED)
+            result.failed = true;
+        else
+            index = thumbnails_place(thumbnails, key, thumbnail_size, &thumbnails->known_list.data[*known]);
+    }
+
+    if (index != THUMBNAIL_FAILED)
+    {
+        ThumbnailAtlas* atlas = &thumbnails->atlases[thumbnail_size];
+        ThumbnailCell* cell = &atlas->cells[index];
+        cell->last_used = thumbnails->frame;
+
+        // Half a texel in from the edges, so filtering never reaches the next cell. Rows are bottom up, so the top
+        // of the image is the end of its rows.
+        f32 x = (f32)((index % atlas->cells_per_row)*(u32)atlas->cell_dim);
+        f32 y = (f32)((index / atlas->cells_per_row)*(u32)atlas->cell_dim);
+        f32 inv_dim = 1.0f/(f32)THUMBNAIL_ATLAS_DIM;
+        result.atlas = &atlas->texture;
+        result.width = cell->width;
+        result.height = cell->height;
+        result.u0 = (x + 0.5f)*inv_dim;
+        result.v0 = (y + (f32)cell->height - 0.5f)*inv_dim;
+        result.u1 = (x + (f32)cell->width - 0.5f)*inv_dim;
+        result.v1 = (y + 0.5f)*inv_dim;
+    }
+
+    return result;
+}
+
+// Keeps what the job found for the rest of the run, and for the cache file if it wasn't there under this stamp
+internal void thumbnails_finish_job(Thumbnails* thumbnails, ThumbnailJob* job)
+{
+    u64 key = job->request.key;
+    ThumbnailSize thumbnail_size = job->request.thumbnail_size;
+    thumbnail_key_map_remove(&thumbnails->pending, key);
+    job->busy = false;
+
+    u32 index = THUMBNAIL_FAILED;
+    if (job->pixels)
+    {
+        ThumbnailKnown known = {job->pixels, job->entry.width, job->entry.height};
+        if (job->source != ThumbnailSource_Stamp)
+            known.pixels = thumbnail_cache_add(thumbnails->cache, &job->entry, job->pixels);
+
+        ThumbnailKnown* kept = known.pixels ? array_push(&thumbnails->arena, &thumbnails->known_list) : 0;
+        if (!kept)
+        {
+            // Out of memory, so it is shown while it lasts in the atlas and made again after that
+            ThumbnailKnown shown = {job->pixels, job->entry.width, job->entry.height};
+            thumbnails_place(thumbnails, key, thumbnail_size, &shown);
+            return;
+        }
+        *kept = known;
+        index = (u32)(thumbnails->known_list.count - 1);
+    }
+    thumbnail_key_map_put(&thumbnails->known, key, index);
+}
+
+void thumbnails_update(Thumbnails* thumbnails)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ++thumbnails->frame;
+    for (u32 i = 0; i < thumbnails->job_count; ++i)
+    {
+        ThumbnailJob* job = &thumbnails->jobs[i];
+        if (job->busy && atomic_load_u32(&job->done))
+            thumbnails_finish_job(thumbnails, job);
+    }
+
+    // Oldest first, skipping whatever has scrolled out of view since it was asked for
+    for (u32 i = 0; i < thumbnails->job_count && thumbnails->pending_count; ++i)
+    {
+        ThumbnailJob* job = &thumbnails->jobs[i];
+        if (job->busy)
+            continue;
+
+        ThumbnailRequest* request = 0;
+        while (!request && thumbnails->pending_count)
+        {
+            ThumbnailRequest* next = &thumbnails->requests[thumbnails->pending_first];
+            thumbnails->pending_first = (thumbnails->pending_first + 1) % THUMBNAIL_MAX_PENDING;
+            --thumbnails->pending_count;
+
+            u32* asked = thumbnail_key_map_get(&thumbnails->pending, next->key);
+            if (asked && *asked + 1 >= thumbnails->frame)
+                request = next;
+            else
+                thumbnail_key_map_remove(&thumbnails->pending, next->key);
+        }
+        if (!request)
+            break;
+
+        job->request.key = request->key;
+        job->request.thumbnail_size = request->thumbnail_size;
+        memcpy(job->request.path, request->path, strlen(request->path) + 1);
+        job->busy = true;
+        atomic_store_u32(&job->done, 0);
+        work_queue_add(thumbnails->queue, thumbnail_job, job);
+    }
+
+    PROFILE_FUNCTION_END();
+}
+
+b32 thumbnails_save(Thumbnails* thumbnails, char* filename)
+{
+    work_queue_complete_all(thumbnails->queue);
+    for (u32 i = 0; i < thumbnails->job_count; ++i)
+    {
+        if (thumbnails->jobs[i].busy)
+            thumbnails_finish_job(thumbnails, &thumbnails->jobs[i]);
+    }
+
+    // The jobs are done, so the first one's memory is free for writing
+    Arena* scratch = &thumbnails->jobs[0].arena;
+    arena_clear(scratch);
+    return thumbnail_cache_save(thumbnails->cache, filename, scratch);
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include "containers.h"
+#include "file.h"
+#include "grapple_memory.h"
+#include "renderer/texture.h"
+#include "thread.h"
+#include "types.h"
+
+typedef struct Renderer Renderer;
+
+/*
+ * NOTE(lucas): Thumbnails for image results. A grid of hundreds of images can't decode and upload every one at full
+ * size, so each image is decoded once on a worker, shrunk to a fixed size (texture_downsample) and kept in:
+ *
+ *   A cache file, mapped and used in place, that keeps thumbnails between runs. Entries are keyed by a hash of the
+ *   file's contents, so copies and renamed files are found too, and by a stamp of its path, size and modification
+ *   time, which finds them without reading the file at all. Thumbnails made during a run are held in memory and
+ *   saved with the old ones by thumbnail_cache_save, through a temporary file moved over the old one.
+ *
+ *   An atlas per size, a texture of equal cells that thumbnails are copied into as they are asked for and updated
+ *   a cell at a time, so a grid of them is drawn as one batch of quads. When an atlas is full, the cell that was
+ *   asked for longest ago is reused, never one that was drawn in the last frame.
+ *
+ * Workers only read the entries that were in the file when it was opened, which never change. Everything else
+ * belongs to the thread that calls thumbnail_get and thumbnails_update. Within a run a file is only looked at once,
+ * so an image edited while it is shown keeps its old thumbnail until the next run.
+ *
+ * Layout of the cache file:
+ *   ThumbnailCacheHeader
+ *   ThumbnailCacheEntry[entry_count]
+ *   pixels                             RGBA8, bottom row first like every texture, each thumbnail 8-byte aligned
+ */
+
+#define THUMBNAIL_CACHE_MAGIC 0x424D4854 // "THMB"
+#define THUMBNAIL_CACHE_VERSION 1
+#define THUMBNAIL_CACHE_MAX_SIZE MEGABYTES(256) // A save that would be bigger keeps only this run's thumbnails
+#define THUMBNAIL_CACHE_MEMORY MEGABYTES(256)   // For thumbnails made since the cache was opened
+#define THUMBNAIL_ATLAS_DIM 2048
+#define THUMBNAIL_MEMORY MEGABYTES(64)          // Atlases and bookkeeping
+#define THUMBNAIL_JOB_MEMORY MEGABYTES(128)     // Per job, for the file and its decoded pixels
+#define THUMBNAIL_MAX_JOBS 16
+#define THUMBNAIL_MAX_PENDING 512
+#define THUMBNAIL_MAX_PATH 1024
+#define THUMBNAIL_FAILED 0xFFFFFFFFu
+
+typedef enum
+{
+    ThumbnailSize_64 = 0,
+    ThumbnailSize_128,
+    ThumbnailSize_256,
+    ThumbnailSize_Count,
+} ThumbnailSize;
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u64 file_size;
+    u32 entry_count;
+    u32 reserved;
+    u64 pixels_size;
+} ThumbnailCacheHeader;
+
+typedef struct
+{
+    u64 content_hash;  // Of the whole file
+    u64 stamp;         // Of the path, size and modification time it had
+    u64 pixels_offset; // From the start of the pixels
+    u16 width;         // At most the size's, keeping the image's aspect ratio
+    u16 height;
+    u32 size;          // ThumbnailSize
+} ThumbnailCacheEntry;
+
+HASH_MAP_DEFINE(ThumbnailKeyMap, thumbnail_key_map, u64, u32, hash_u64, hash_u64_equal)
+
+typedef struct
+{
+    ThumbnailCacheEntry entry;
+    u8* pixels; // In the cache's arena, or in its mapping when the contents were already there
+} ThumbnailCacheAdded;
+
+ARRAY_TYPE(ThumbnailCacheAddedArray, ThumbnailCacheAdded);
+
+typedef struct
+{
+    FileMapping mapping; // Empty unless the cache was opened from a file
+    ThumbnailCacheHeader* header;
+    ThumbnailCacheEntry* entries;
+    u8* pixels;
+    ThumbnailKeyMap by_stamp;   // Keys of the file's entries to their indices
+    ThumbnailKeyMap by_content;
+
+    Arena arena;
+    ThumbnailCacheAddedArray added;
+} ThumbnailCache;
+
+// What thumbnail_get hands back for drawing
+typedef struct
+{
+    Texture* atlas;     // 0 until the thumbnail is ready
+    f32 u0, v0, u1, v1; // In the atlas, as in QuadsSoA
+    i32 width;          // In pixels
+    i32 height;
+    b32 failed;         // Missing, unreadable or not an image, so there never will be one
+} Thumbnail;
+
+typedef struct
+{
+    u64 key;
+    u32 last_used; // Frame it was last asked for
+    u16 width;
+    u16 height;
+    b32 used;
+} ThumbnailCell;
+
+typedef struct
+{
+    Texture texture;
+    i32 cell_dim;
+    u32 cells_per_row;
+    u32 cell_count;
+    ThumbnailCell* cells;
+} ThumbnailAtlas;
+
+typedef struct
+{
+    u64 key;
+    ThumbnailSize thumbnail_size;
+    char path[THUMBNAIL_MAX_PATH];
+} ThumbnailRequest;
+
+typedef enum
+{
+    ThumbnailSource_None = 0, // Nothing came of it
+    ThumbnailSource_Stamp,    // In the cache file under the file's stamp
+    ThumbnailSource_Content,  // In the cache file under the file's contents, with a new stamp
+    ThumbnailSource_Decoded,
+} ThumbnailSource;
+
+typedef struct
+{
+    ThumbnailCache* cache;
+    ThumbnailRequest request;
+    Arena arena;
+    b32 busy;
+
+    // Set by the worker before done
+    volatile u32 done;
+    ThumbnailSource source;
+    ThumbnailCacheEntry entry;
+    u8* pixels;
+} ThumbnailJob;
+
+typedef struct
+{
+    u8* pixels;
+    u16 width;
+    u16 height;
+} ThumbnailKnown;
+
+ARRAY_TYPE(ThumbnailKnownArray, ThumbnailKnown);
+
+typedef struct
+{
+    WorkQueue* queue; // Its own, so waiting on other work never waits for a decode
+    Renderer* renderer;
+    ThumbnailCache* cache;
+    Arena arena; // Holds the Thumbnails too
+    u32 frame;
+
+    ThumbnailAtlas atlases[ThumbnailSize_Count]; // Made when their size is first asked for
+    ThumbnailKeyMap resident; // Keys of thumbnails in an atlas to their cells
+    ThumbnailKeyMap known;    // Keys of thumbnails looked at this run to known_list, or THUMBNAIL_FAILED
+    ThumbnailKnownArray known_list;
+    ThumbnailKeyMap pending;  // Keys waiting for or being run by a job to the frame they were last asked for
+
+    u32 pending_first;
+    u32 pending_count;
+    ThumbnailRequest requests[THUMBNAIL_MAX_PENDING];
+
+    u32 job_count;
+    ThumbnailJob jobs[THUMBNAIL_MAX_JOBS];
+} Thumbnails;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+i32 thumbnail_dim(ThumbnailSize thumbnail_size);
+
+// Maps filename and indexes its entries. Returns false if it is missing or damaged, which leaves an empty cache that
+// still takes new thumbnails.
+b32 thumbnail_cache_open(ThumbnailCache* cache, char* filename);
+b32 thumbnail_cache_from_memory(ThumbnailCache* cache, u8* data, size data_size);
+void thumbnail_cache_close(ThumbnailCache* cache);
+
+// Look only at the entries that were in the file, so workers can call them. Return 0 if there is none.
+ThumbnailCacheEntry* thumbnail_cache_find_stamp(ThumbnailCache* cache, u64 stamp, ThumbnailSize thumbnail_size);
+ThumbnailCacheEntry* thumbnail_cache_find_content(ThumbnailCache* cache, u64 content_hash,
+                                                  ThumbnailSize thumbnail_size);
+u8* thumbnail_cache_pixels(ThumbnailCache* cache, ThumbnailCacheEntry* entry);
+
+// Keeps a thumbnail until the cache is saved, copying its pixels unless they are in the cache file. Returns where
+// they are kept, or 0 if the cache's memory is full.
+u8* thumbnail_cache_add(ThumbnailCache* cache, ThumbnailCacheEntry* entry, u8* pixels);
+
+// Writes the file's thumbnails and the added ones, each set of pixels once, and closes the cache, since Windows
+// can't replace a file that is mapped
+b32 thumbnail_cache_save(ThumbnailCache* cache, char* filename, Arena* scratch);
+
+// Decodes an image file of any format texture_decode_from_memory knows and shrinks it to fit thumbnail_size. data
+// is left alone. Returns a texture with no data if it isn't an image that can be read.
+Texture thumbnail_make(u8* data, size data_size, ThumbnailSize thumbnail_size, Arena* arena);
+
+// Starts thread_count workers of its own. Returns 0 if its memory couldn't be reserved.
+Thumbnails* thumbnails_create(Renderer* renderer, ThumbnailCache* cache, u32 thread_count);
+
+// Call every frame for every thumbnail that is shown. Asks for the ones that aren't ready yet.
+Thumbnail thumbnail_get(Thumbnails* thumbnails, char* path, ThumbnailSize thumbnail_size);
+
+// Call once a frame before thumbnail_get. Takes in finished jobs and starts new ones for what was asked for last
+// frame, dropping requests that haven't been repeated since.
+void thumbnails_update(Thumbnails* thumbnails);
+
+// Waits for the jobs and saves the cache. Thumbnails can't be used after.
+b32 thumbnails_save(Thumbnails* thumbnails, char* filename);
+
+#ifdef __cplusplus
+}
+#endif
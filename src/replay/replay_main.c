@@ -0,0 +1,514 @@
+#include "grapple_math.h"
+#include "profiler.h"
+#include "types.h"
+#include "str.h"
+
+#include "grapple_memory.c"
+#include "timer.c"
+#include "profiler.c"
+#include "inflate.c"
+#include "renderer/renderer.c"
+#include "renderer/texture.c"
+#include "thread.c"
+
+#include <stdio.h> // printf
+#include <stdlib.h> // atoi, qsort
+#include <string.h> // strcmp, memcpy
+
+/*
+ * NOTE(lucas): grapple_replay re-submits a render capture (see renderer/capture.h) to whichever backend it was
+ * built with and times every stage. Textures are uploaded once, on the first loop. The batch statistics recorded
+ * at the end of each original frame are compared against the replay, so a replay that drifts from the capture is
+ * reported instead of silently measuring different work.
+ */
+
+typedef struct
+{
+    u64 calls;
+    u64 ticks;
+} ReplayStage;
+
+typedef struct
+{
+    u8* data;
+    size data_size;
+
+    Renderer* renderer;
+    Texture* textures;
+    u32 texture_count;
+    DrawList* draw_list;
+    Window window;
+
+    u32 frame_count;
+    u32 max_frame_quads;
+
+    ReplayStage stages[CaptureRecord_Count];
+    ReplayStage end_frame_stage; // Merge, flush and present, separate from recording the end of the frame
+
+    u64* frame_ticks; // frame_count*loops entries
+    u32 frame_ticks_count;
+    u32 mismatched_frames;
+} Replay;
+
+global const char* replay_stage_names[CaptureRecord_Count] =
+{
+    "none",
+    "begin_frame",
+    "end_frame",
+    "set_projection",
+    "clear",
+    "upload_texture",
+    "draw_texture",
+    "draw_quads",
+    "draw_list",
+    "text",
+};
+
+internal void replay_print_usage(void)
+{
+    printf("Usage: grapple_replay CAPTURE_FILE [--loops N] [--json FILE]\n");
+}
+
+internal int replay_compare_u64(const void* a, const void* b)
+{
+    u64 x = *(const u64*)a;
+    u64 y = *(const u64*)b;
+    int result = (x > y) - (x < y);
+    return result;
+}
+
+// Returns the next record and its payload, or 0 at the end of the data or on a malformed record
+internal CaptureRecordHeader* replay_next_record(Replay* replay, size* offset, u8** payload)
+{
+    if (*offset + (size)sizeof(CaptureRecordHeader) > replay->data_size)
+        return 0;
+
+    CaptureRecordHeader* header = (CaptureRecordHeader*)(replay->data + *offset);
+    size payload_offset = *offset + (size)sizeof(CaptureRecordHeader);
+    if (header->type == CaptureRecord_None || header->type >= CaptureRecord_Count ||
+        (size)header->size > replay->data_size - payload_offset)
+    {
+        printf("Malformed record at offset %lld\n", (long long)*offset);
+        return 0;
+    }
+
+    *payload = replay->data + payload_offset;
+    *offset = payload_offset + header->size;
+    return header;
+}
+
+// Size a record needs to hold its fixed part and payload, or -1 if the fixed part itself is missing
+internal size replay_record_required_size(CaptureRecordHeader* header, u8* payload)
+{
+    size fixed_sizes[CaptureRecord_Count] =
+    {
+        0,
+        sizeof(CaptureFrameBegin),
+        sizeof(CaptureFrameEnd),
+        sizeof(m4),
+        sizeof(v4),
+        sizeof(CaptureTexture),
+        sizeof(CaptureDrawTexture),
+        sizeof(CaptureDrawQuads),
+        sizeof(CaptureDrawListCommand),
+        sizeof(CaptureText),
+    };
+
+    size result = fixed_sizes[header->type];
+    if ((size)header->size < result)
+        return -1;
+
+    switch (header->type)
+    {
+        case CaptureRecord_Texture:
+        {
+            CaptureTexture* record = (CaptureTexture*)payload;
+            if (record->format < 0 || record->format >= TextureFormat_Count)
+                return -1;
+            if (record->width > 0 && record->height > 0 && record->channels > 0)
+            {
+                if (record->mip_count < 0 || record->mip_count > texture_full_mip_count(record->width, record->height))
+                    return -1;
+
+                Texture texture = {0};
+                texture.width = record->width;
+                texture.height = record->height;
+                texture.channels = record->channels;
+                texture.format = (TextureFormat)record->format;
+                texture.mip_count = record->mip_count;
+                result += texture_data_size(&texture);
+            }
+        } break;
+
+        case CaptureRecord_DrawQuads:
+            result += 8*(size)((CaptureDrawQuads*)payload)->count*(size)sizeof(f32);
+            break;
+
+        case CaptureRecord_DrawListCommand:
+            result += (size)((CaptureDrawListCommand*)payload)->quad_count*4*(size)sizeof(Vertex);
+            break;
+
+        case CaptureRecord_Text:
+            result += (size)((CaptureText*)payload)->text_len;
+            break;
+
+        default: break;
+    }
+
+    return result;
+}
+
+// Checks sizes and gathers what has to be allocated before the timed loops
+internal b32 replay_scan(Replay* replay)
+{
+    size offset = sizeof(CaptureFileHeader);
+    u8* payload = 0;
+    u32 frame_quads = 0;
+    CaptureRecordHeader* header;
+    while ((header = replay_next_record(replay, &offset, &payload)) != 0)
+    {
+        size required_size = replay_record_required_size(header, payload);
+        if (required_size < 0 || required_size > (size)header->size)
+        {
+            printf("Record at offset %lld is too small for its contents\n",
+                   (long long)(payload - replay->data) - (long long)sizeof(CaptureRecordHeader));
+            return false;
+        }
+
+        switch (header->type)
+        {
+            case CaptureRecord_FrameBegin:
+            {
+                CaptureFrameBegin* record = (CaptureFrameBegin*)payload;
+                if (!replay->frame_count)
+                {
+                    replay->window.width = record->width;
+                    replay->window.height = record->height;
+                }
+                ++replay->frame_count;
+                frame_quads = 0;
+            } break;
+
+            case CaptureRecord_Texture:
+            {
+                CaptureTexture* record = (CaptureTexture*)payload;
+                // Ids are handed out in order, which also keeps the table no bigger than the file
+                if (record->id != replay->texture_count)
+                {
+                    printf("Texture %u at offset %lld is out of order\n", record->id,
+                           (long long)(payload - replay->data) - (long long)sizeof(CaptureRecordHeader));
+                    return false;
+                }
+                ++replay->texture_count;
+            } break;
+
+            case CaptureRecord_DrawListCommand:
+            {
+                CaptureDrawListCommand* record = (CaptureDrawListCommand*)payload;
+                frame_quads += record->quad_count;
+                if (frame_quads > replay->max_frame_quads)
+                    replay->max_frame_quads = frame_quads;
+            } break;
+
+            default: break;
+        }
+    }
+
+    return offset == replay->data_size;
+}
+
+internal Texture* replay_get_texture(Replay* replay, u32 id)
+{
+    Texture* result = (id < replay->texture_count) ? &replay->textures[id] : 0;
+    return result;
+}
+
+internal void replay_run(Replay* replay, b32 first_loop)
+{
+    Renderer* renderer = replay->renderer;
+    size offset = sizeof(CaptureFileHeader);
+    u8* payload = 0;
+    u64 frame_start = 0;
+    CaptureRecordHeader* header;
+    while ((header = replay_next_record(replay, &offset, &payload)) != 0)
+    {
+        u64 start = timer_read_cpu();
+        switch (header->type)
+        {
+            case CaptureRecord_FrameBegin:
+            {
+                CaptureFrameBegin* record = (CaptureFrameBegin*)payload;
+                frame_start = start;
+                if (record->has_damage)
+                    renderer_invalidate(renderer, record->damage);
+                renderer_begin_frame(renderer, &replay->window);
+                draw_list_reset(replay->draw_list, renderer, 0);
+            } break;
+
+            case CaptureRecord_FrameEnd:
+            {
+                CaptureFrameEnd* record = (CaptureFrameEnd*)payload;
+                if (replay->draw_list->quad_count)
+                    renderer_submit_draw_list(renderer, replay->draw_list);
+
+                renderer_end_frame(renderer);
+                u64 end = timer_read_cpu();
+                replay->end_frame_stage.ticks += end - start;
+                ++replay->end_frame_stage.calls;
+                replay->frame_ticks[replay->frame_ticks_count++] = end - frame_start;
+
+                if (first_loop && (record->total_quads != renderer->total_quads ||
+                                   record->batch_count != renderer->batch_count))
+                {
+                    ++replay->mismatched_frames;
+                }
+                continue;
+            }
+
+            case CaptureRecord_SetProjection:
+            {
+                renderer_set_projection(renderer, *(m4*)payload);
+            } break;
+
+            case CaptureRecord_Clear:
+            {
+                renderer_clear(renderer, *(v4*)payload);
+            } break;
+
+            case CaptureRecord_Texture:
+            {
+                if (!first_loop)
+                    continue;
+
+                CaptureTexture* record = (CaptureTexture*)payload;
+                Texture* texture = replay_get_texture(replay, record->id);
+                texture->width = record->width;
+                texture->height = record->height;
+                texture->channels = record->channels;
+                texture->format = (TextureFormat)record->format;
+                texture->mip_count = record->mip_count;
+                b32 has_pixels = (record->width > 0 && record->height > 0 && record->channels > 0);
+                texture->data = has_pixels ? (u8*)(record + 1) : 0;
+                if (texture->data)
+                    renderer_upload_texture(renderer, texture);
+            } break;
+
+            case CaptureRecord_DrawTexture:
+            {
+                CaptureDrawTexture* record = (CaptureDrawTexture*)payload;
+                renderer_draw_texture(renderer, replay_get_texture(replay, record->texture_id),
+                                      record->pos, record->dim);
+            } break;
+
+            case CaptureRecord_DrawQuads:
+            {
+                CaptureDrawQuads* record = (CaptureDrawQuads*)payload;
+                f32* arrays = (f32*)(record + 1);
+                QuadsSoA quads = {0};
+                quads.x  = arrays + 0*record->count;
+                quads.y  = arrays + 1*record->count;
+                quads.w  = arrays + 2*record->count;
+                quads.h  = arrays + 3*record->count;
+                quads.u0 = arrays + 4*record->count;
+                quads.v0 = arrays + 5*record->count;
+                quads.u1 = arrays + 6*record->count;
+                quads.v1 = arrays + 7*record->count;
+                renderer_draw_quads(renderer, replay_get_texture(replay, record->texture_id), quads, record->count,
+                                    record->has_transform ? &record->transform : 0,
+                                    record->has_clip ? &record->clip : 0);
+            } break;
+
+            case CaptureRecord_DrawListCommand:
+            {
+                // Lists were merged in order when captured, so one list per frame reproduces the same stream
+                CaptureDrawListCommand* record = (CaptureDrawListCommand*)payload;
+                Vertex* verts = draw_list_reserve(replay->draw_list, replay_get_texture(replay, record->texture_id),
+                                                  record->quad_count);
+                if (verts)
+                    memcpy(verts, record + 1, (usize)record->quad_count*4*sizeof(Vertex));
+            } break;
+
+            case CaptureRecord_Text:
+            {
+                CaptureText* record = (CaptureText*)payload;
+                s8 text = {(u8*)(record + 1), (size)record->text_len};
+                text_draw_rect(renderer, text, record->bounds, record->color);
+            } break;
+
+            default: break;
+        }
+
+        ReplayStage* stage = &replay->stages[header->type];
+        stage->ticks += timer_read_cpu() - start;
+        ++stage->calls;
+    }
+}
+
+internal f64 replay_ticks_to_ms(u64 ticks, u64 cpu_frequency)
+{
+    f64 result = cpu_frequency ? 1000.0*(f64)ticks / (f64)cpu_frequency : 0.0;
+    return result;
+}
+
+internal b32 replay_write_json(Replay* replay, Arena* arena, char* filename, u64 cpu_frequency, u32 loops)
+{
+    void* file = file_open(filename, FileMode_Write|FileMode_Create);
+    if (!file)
+        return false;
+
+    size arena_mark = arena->used;
+    u64* sorted = replay->frame_ticks;
+    u32 count = replay->frame_ticks_count;
+    s8 header = s8_format(arena, "{\n  \"frames\": %u,\n  \"loops\": %u,\n  \"mismatched_frames\": %u,\n"
+                          "  \"frame_ms\": {\"min\": %.4f, \"median\": %.4f, \"p99\": %.4f, \"max\": %.4f},\n"
+                          "  \"stages\": [\n", replay->frame_count, loops, replay->mismatched_frames,
+                          replay_ticks_to_ms(sorted[0], cpu_frequency),
+                          replay_ticks_to_ms(sorted[count/2], cpu_frequency),
+                          replay_ticks_to_ms(sorted[((u64)count*99)/100], cpu_frequency),
+                          replay_ticks_to_ms(sorted[count-1], cpu_frequency));
+    file_write(file, header.data, header.len);
+
+    for (u32 i = 0; i <= CaptureRecord_Count; ++i)
+    {
+        ReplayStage* stage = (i < CaptureRecord_Count) ? &replay->stages[i] : &replay->end_frame_stage;
+        const char* name = (i < CaptureRecord_Count) ? replay_stage_names[i] : "end_frame_submit";
+        if (i == CaptureRecord_None || i == CaptureRecord_FrameEnd)
+            continue;
+
+        s8 entry = s8_format(arena, "    {\"name\": \"%s\", \"calls\": %llu, \"total_ms\": %.4f}%s\n", name,
+                             (unsigned long long)stage->calls, replay_ticks_to_ms(stage->ticks, cpu_frequency),
+                             (i < CaptureRecord_Count) ? "," : "");
+        file_write(file, entry.data, entry.len);
+    }
+
+    s8 footer = s8("  ]\n}\n");
+    file_write(file, footer.data, footer.len);
+    file_close(file);
+
+    arena->used = arena_mark;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    char* capture_filename = 0;
+    char* json_filename = 0;
+    u32 loops = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        b32 has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--loops") == 0 && has_value)
+            loops = (u32)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && has_value)
+            json_filename = argv[++i];
+        else if (!capture_filename && argv[i][0] != '-')
+            capture_filename = argv[i];
+        else
+        {
+            replay_print_usage();
+            return 1;
+        }
+    }
+    if (!capture_filename)
+    {
+        replay_print_usage();
+        return 1;
+    }
+    if (loops == 0)
+        loops = 1;
+
+    PROFILE_INIT();
+
+    Arena arena = arena_alloc(MEGABYTES(64));
+    Replay* replay = push_struct(&arena, Replay);
+    zero_struct(*replay);
+
+    size file_size = file_exists(capture_filename) ? file_get_size(capture_filename) : 0;
+    void* file = file_size ? file_open(capture_filename, FileMode_Read) : 0;
+    if (!file)
+    {
+        printf("Could not open %s\n", capture_filename);
+        return 1;
+    }
+
+    // The capture stays in memory for the whole replay; texture pixels and quad arrays are used in place
+    Arena file_arena = arena_alloc(file_size);
+    replay->data = push_size(&file_arena, file_size);
+    replay->data_size = file_size;
+    file_read(file, replay->data, file_size);
+    file_close(file);
+
+    CaptureFileHeader* file_header = (CaptureFileHeader*)replay->data;
+    if (file_size < (size)sizeof(CaptureFileHeader) || file_header->magic != CAPTURE_MAGIC ||
+        file_header->version != CAPTURE_VERSION)
+    {
+        printf("%s is not a version %u capture\n", capture_filename, CAPTURE_VERSION);
+        return 1;
+    }
+
+    if (!replay_scan(replay) || !replay->frame_count)
+    {
+        printf("%s is truncated or has no complete frames\n", capture_filename);
+        return 1;
+    }
+
+    replay->renderer = renderer_create(&replay->window, &arena);
+    replay->textures = push_array(&arena, replay->texture_count + 1, Texture);
+    if (!replay->textures)
+    {
+        printf("Not enough memory for %u textures\n", replay->texture_count);
+        return 1;
+    }
+    zero_array(replay->textures, replay->texture_count + 1, Texture);
+    replay->draw_list = draw_list_create(&arena, replay->max_frame_quads + 1, 1024);
+    replay->frame_ticks = push_array(&arena, (size)replay->frame_count*loops, u64);
+
+    for (u32 loop = 0; loop < loops; ++loop)
+        replay_run(replay, loop == 0);
+
+    u64 cpu_frequency = timer_estimate_cpu_frequency(100);
+    u32 count = replay->frame_ticks_count;
+
+    // Find the slowest frame before sorting loses the order
+    u32 slowest_frame = 0;
+    for (u32 i = 1; i < count; ++i)
+    {
+        if (replay->frame_ticks[i] > replay->frame_ticks[slowest_frame])
+            slowest_frame = i;
+    }
+    qsort(replay->frame_ticks, count, sizeof(u64), replay_compare_u64);
+
+    printf("%s: %u frames, %u loops, %u textures\n", capture_filename, replay->frame_count, loops,
+           replay->texture_count);
+    printf("Frame ms: min %.3f  median %.3f  p99 %.3f  max %.3f (frame %u)\n\n",
+           replay_ticks_to_ms(replay->frame_ticks[0], cpu_frequency),
+           replay_ticks_to_ms(replay->frame_ticks[count/2], cpu_frequency),
+           replay_ticks_to_ms(replay->frame_ticks[((u64)count*99)/100], cpu_frequency),
+           replay_ticks_to_ms(replay->frame_ticks[count-1], cpu_frequency), slowest_frame % replay->frame_count);
+
+    printf("%-20s %12s %12s %14s\n", "stage", "calls", "total ms", "us per frame");
+    for (u32 i = 0; i <= CaptureRecord_Count; ++i)
+    {
+        ReplayStage* stage = (i < CaptureRecord_Count) ? &replay->stages[i] : &replay->end_frame_stage;
+        const char* name = (i < CaptureRecord_Count) ? replay_stage_names[i] : "end_frame_submit";
+        if (i == CaptureRecord_None || i == CaptureRecord_FrameEnd || !stage->calls)
+            continue;
+
+        f64 total_ms = replay_ticks_to_ms(stage->ticks, cpu_frequency);
+        printf("%-20s %12llu %12.3f %14.3f\n", name, (unsigned long long)stage->calls, total_ms,
+               1000.0*total_ms / (f64)count);
+    }
+
+    if (replay->mismatched_frames)
+        printf("\nWarning: %u frames produced different batch statistics than the capture\n",
+               replay->mismatched_frames);
+
+    if (json_filename && !replay_write_json(replay, &arena, json_filename, cpu_frequency, loops))
+    {
+        printf("Failed to write %s\n", json_filename);
+        return 1;
+    }
+
+    return replay->mismatched_frames ? 2 : 0;
+}
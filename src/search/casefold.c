@@ -0,0 +1,286 @@
+#include "search/search.h"
+
+/*
+ * NOTE(lucas): Unicode 14.0 simple case folding (CaseFolding.txt, statuses C and S). Each code point folds to one
+ * other, so code points that fold to the same one are the same letter in different cases. The 1454 code points that
+ * fold are kept as runs that fold by the same delta, every code point or every other one, the way most scripts lay
+ * out their cases, which takes 202 of them. The table is generated from the data file, not written by hand.
+ */
+
+#define SEARCH_MAX_CASES 4 // Code points that fold to the same one, like the four thetas
+
+// Invalid UTF-8 is taken a byte at a time, as these plus the byte, which are past Unicode and only match themselves
+#define SEARCH_INVALID_CODEPOINT 0x110000u
+
+typedef struct
+{
+    u32 first;
+    u8 count;
+    u8 stride; // 1 or 2
+    i32 delta;
+} SearchFoldRun;
+
+global const SearchFoldRun search_fold_runs[202] =
+{
+    {0x41, 26, 1, 32}, {0xB5, 1, 1, 775}, {0xC0, 23, 1, 32}, {0xD8, 7, 1, 32}, {0x100, 24, 2, 1}, {0x132, 3, 2, 1},
+    {0x139, 8, 2, 1}, {0x14A, 23, 2, 1}, {0x178, 1, 1, -121}, {0x179, 3, 2, 1}, {0x17F, 1, 1, -268},
+    {0x181, 1, 1, 210}, {0x182, 2, 2, 1}, {0x186, 1, 1, 206}, {0x187, 1, 1, 1}, {0x189, 2, 1, 205}, {0x18B, 1, 1, 1},
+    {0x18E, 1, 1, 79}, {0x18F, 1, 1, 202}, {0x190, 1, 1, 203}, {0x191, 1, 1, 1}, {0x193, 1, 1, 205},
+    {0x194, 1, 1, 207}, {0x196, 1, 1, 211}, {0x197, 1, 1, 209}, {0x198, 1, 1, 1}, {0x19C, 1, 1, 211},
+    {0x19D, 1, 1, 213}, {0x19F, 1, 1, 214}, {0x1A0, 3, 2, 1}, {0x1A6, 1, 1, 218}, {0x1A7, 1, 1, 1},
+    {0x1A9, 1, 1, 218}, {0x1AC, 1, 1, 1}, {0x1AE, 1, 1, 218}, {0x1AF, 1, 1, 1}, {0x1B1, 2, 1, 217}, {0x1B3, 2, 2, 1},
+    {0x1B7, 1, 1, 219}, {0x1B8, 1, 1, 1}, {0x1BC, 1, 1, 1}, {0x1C4, 1, 1, 2}, {0x1C5, 1, 1, 1}, {0x1C7, 1, 1, 2},
+    {0x1C8, 1, 1, 1}, {0x1CA, 1, 1, 2}, {0x1CB, 9, 2, 1}, {0x1DE, 9, 2, 1}, {0x1F1, 1, 1, 2}, {0x1F2, 2, 2, 1},
+    {0x1F6, 1, 1, -97}, {0x1F7, 1, 1, -56}, {0x1F8, 20, 2, 1}, {0x220, 1, 1, -130}, {0x222, 9, 2, 1},
+    {0x23A, 1, 1, 10795}, {0x23B, 1, 1, 1}, {0x23D, 1, 1, -163}, {0x23E, 1, 1, 10792}, {0x241, 1, 1, 1},
+    {0x243, 1, 1, -195}, {0x244, 1, 1, 69}, {0x245, 1, 1, 71}, {0x246, 5, 2, 1}, {0x345, 1, 1, 116}, {0x370, 2, 2, 1},
+    {0x376, 1, 1, 1}, {0x37F, 1, 1, 116}, {0x386, 1, 1, 38}, {0x388, 3, 1, 37}, {0x38C, 1, 1, 64}, {0x38E, 2, 1, 63},
+    {0x391, 17, 1, 32}, {0x3A3, 9, 1, 32}, {0x3C2, 1, 1, 1}, {0x3CF, 1, 1, 8}, {0x3D0, 1, 1, -30}, {0x3D1, 1, 1, -25},
+    {0x3D5, 1, 1, -15}, {0x3D6, 1, 1, -22}, {0x3D8, 12, 2, 1}, {0x3F0, 1, 1, -54}, {0x3F1, 1, 1, -48},
+    {0x3F4, 1, 1, -60}, {0x3F5, 1, 1, -64}, {0x3F7, 1, 1, 1}, {0x3F9, 1, 1, -7}, {0x3FA, 1, 1, 1},
+    {0x3FD, 3, 1, -130}, {0x400, 16, 1, 80}, {0x410, 32, 1, 32}, {0x460, 17, 2, 1}, {0x48A, 27, 2, 1},
+    {0x4C0, 1, 1, 15}, {0x4C1, 7, 2, 1}, {0x4D0, 48, 2, 1}, {0x531, 38, 1, 48}, {0x10A0, 38, 1, 7264},
+    {0x10C7, 1, 1, 7264}, {0x10CD, 1, 1, 7264}, {0x13F8, 6, 1, -8}, {0x1C80, 1, 1, -6222}, {0x1C81, 1, 1, -6221},
+    {0x1C82, 1, 1, -6212}, {0x1C83, 2, 1, -6210}, {0x1C85, 1, 1, -6211}, {0x1C86, 1, 1, -6204}, {0x1C87, 1, 1, -6180},
+    {0x1C88, 1, 1, 35267}, {0x1C90, 43, 1, -3008}, {0x1CBD, 3, 1, -3008}, {0x1E00, 75, 2, 1}, {0x1E9B, 1, 1, -58},
+    {0x1E9E, 1, 1, -7615}, {0x1EA0, 48, 2, 1}, {0x1F08, 8, 1, -8}, {0x1F18, 6, 1, -8}, {0x1F28, 8, 1, -8},
+    {0x1F38, 8, 1, -8}, {0x1F48, 6, 1, -8}, {0x1F59, 4, 2, -8}, {0x1F68, 8, 1, -8}, {0x1F88, 8, 1, -8},
+    {0x1F98, 8, 1, -8}, {0x1FA8, 8, 1, -8}, {0x1FB8, 2, 1, -8}, {0x1FBA, 2, 1, -74}, {0x1FBC, 1, 1, -9},
+    {0x1FBE, 1, 1, -7173}, {0x1FC8, 4, 1, -86}, {0x1FCC, 1, 1, -9}, {0x1FD8, 2, 1, -8}, {0x1FDA, 2, 1, -100},
+    {0x1FE8, 2, 1, -8}, {0x1FEA, 2, 1, -112}, {0x1FEC, 1, 1, -7}, {0x1FF8, 2, 1, -128}, {0x1FFA, 2, 1, -126},
+    {0x1FFC, 1, 1, -9}, {0x2126, 1, 1, -7517}, {0x212A, 1, 1, -8383}, {0x212B, 1, 1, -8262}, {0x2132, 1, 1, 28},
+    {0x2160, 16, 1, 16}, {0x2183, 1, 1, 1}, {0x24B6, 26, 1, 26}, {0x2C00, 48, 1, 48}, {0x2C60, 1, 1, 1},
+    {0x2C62, 1, 1, -10743}, {0x2C63, 1, 1, -3814}, {0x2C64, 1, 1, -10727}, {0x2C67, 3, 2, 1}, {0x2C6D, 1, 1, -10780},
+    {0x2C6E, 1, 1, -10749}, {0x2C6F, 1, 1, -10783}, {0x2C70, 1, 1, -10782}, {0x2C72, 1, 1, 1}, {0x2C75, 1, 1, 1},
+    {0x2C7E, 2, 1, -10815}, {0x2C80, 50, 2, 1}, {0x2CEB, 2, 2, 1}, {0x2CF2, 1, 1, 1}, {0xA640, 23, 2, 1},
+    {0xA680, 14, 2, 1}, {0xA722, 7, 2, 1}, {0xA732, 31, 2, 1}, {0xA779, 2, 2, 1}, {0xA77D, 1, 1, -35332},
+    {0xA77E, 5, 2, 1}, {0xA78B, 1, 1, 1}, {0xA78D, 1, 1, -42280}, {0xA790, 2, 2, 1}, {0xA796, 10, 2, 1},
+    {0xA7AA, 1, 1, -42308}, {0xA7AB, 1, 1, -42319}, {0xA7AC, 1, 1, -42315}, {0xA7AD, 1, 1, -42305},
+    {0xA7AE, 1, 1, -42308}, {0xA7B0, 1, 1, -42258}, {0xA7B1, 1, 1, -42282}, {0xA7B2, 1, 1, -42261},
+    {0xA7B3, 1, 1, 928}, {0xA7B4, 8, 2, 1}, {0xA7C4, 1, 1, -48}, {0xA7C5, 1, 1, -42307}, {0xA7C6, 1, 1, -35384},
+    {0xA7C7, 2, 2, 1}, {0xA7D0, 1, 1, 1}, {0xA7D6, 2, 2, 1}, {0xA7F5, 1, 1, 1}, {0xAB70, 80, 1, -38864},
+    {0xFF21, 26, 1, 32}, {0x10400, 40, 1, 40}, {0x104B0, 36, 1, 40}, {0x10570, 11, 1, 39}, {0x1057C, 15, 1, 39},
+    {0x1058C, 7, 1, 39}, {0x10594, 2, 1, 39}, {0x10C80, 51, 1, 64}, {0x118A0, 32, 1, 32}, {0x16E40, 32, 1, 32},
+    {0x1E900, 34, 1, 34}
+};
+
+internal inline u32 search_fold_codepoint(u32 codepoint)
+{
+    if (codepoint < 0x80)
+        return (codepoint - 'A' < 26) ? codepoint + 32 : codepoint;
+
+    // The last run that starts at or before codepoint
+    size low = 0;
+    size high = countof(search_fold_runs);
+    while (low < high)
+    {
+        size mid = (low + high)/2;
+        if (search_fold_runs[mid].first <= codepoint)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    if (low == 0)
+        return codepoint;
+
+    const SearchFoldRun* run = &search_fold_runs[low - 1];
+    u32 offset = codepoint - run->first;
+    if (offset < (u32)run->count*run->stride && offset % run->stride == 0)
+        return (u32)((i32)codepoint + run->delta);
+    return codepoint;
+}
+
+// Every code point that folds to the same one as codepoint, the folded one first. Returns how many.
+internal u32 search_fold_cases(u32 codepoint, u32* cases)
+{
+    u32 folded = search_fold_codepoint(codepoint);
+    u32 count = 0;
+    cases[count++] = folded;
+    for (size i = 0; i < (size)countof(search_fold_runs); ++i)
+    {
+        const SearchFoldRun* run = &search_fold_runs[i];
+        i64 offset = (i64)folded - run->delta - run->first;
+        if (offset >= 0 && offset < (i64)run->count*run->stride && offset % run->stride == 0)
+        {
+            ASSERT(count < SEARCH_MAX_CASES, "More cases than SEARCH_MAX_CASES");
+            cases[count++] = (u32)(run->first + offset);
+        }
+    }
+    return count;
+}
+
+// Decodes the code point at data. Anything that doesn't start valid UTF-8, overlong forms and surrogates included,
+// is one byte long.
+internal inline u32 search_decode_utf8(u8* data, size data_size, size* length)
+{
+    u8 lead = data[0];
+    *length = 1;
+    if (lead < 0x80)
+        return lead;
+
+    size expected = 0;
+    u32 codepoint = 0;
+    u8 low = 0x80;
+    u8 high = 0xBF;
+    if (lead >= 0xC2 && lead <= 0xDF)
+    {
+        expected = 2;
+        codepoint = lead & 0x1F;
+    }
+    else if (lead >= 0xE0 && lead <= 0xEF)
+    {
+        expected = 3;
+        codepoint = lead & 0x0F;
+        low = (lead == 0xE0) ? 0xA0 : 0x80;
+        high = (lead == 0xED) ? 0x9F : 0xBF;
+    }
+    else if (lead >= 0xF0 && lead <= 0xF4)
+    {
+        expected = 4;
+        codepoint = lead & 0x07;
+        low = (lead == 0xF0) ? 0x90 : 0x80;
+        high = (lead == 0xF4) ? 0x8F : 0xBF;
+    }
+    if (expected == 0 || expected > data_size || data[1] < low || data[1] > high)
+        return SEARCH_INVALID_CODEPOINT + lead;
+
+    for (size i = 1; i < expected; ++i)
+    {
+        if ((data[i] & 0xC0) != 0x80)
+            return SEARCH_INVALID_CODEPOINT + lead;
+        codepoint = (codepoint << 6) | (data[i] & 0x3F);
+    }
+    *length = expected;
+    return codepoint;
+}
+
+internal inline size search_put_utf8(u8* out, u32 codepoint)
+{
+    if (codepoint < 0x80)
+    {
+        out[0] = (u8)codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800)
+    {
+        out[0] = (u8)(0xC0 | (codepoint >> 6));
+        out[1] = (u8)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if (codepoint < 0x10000)
+    {
+        out[0] = (u8)(0xE0 | (codepoint >> 12));
+        out[1] = (u8)(0x80 | ((codepoint >> 6) & 0x3F));
+        out[2] = (u8)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    out[0] = (u8)(0xF0 | (codepoint >> 18));
+    out[1] = (u8)(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = (u8)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = (u8)(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+// search_put_utf8, with invalid bytes put back as they were
+internal inline size search_put_decoded(u8* out, u32 codepoint)
+{
+    if (codepoint >= SEARCH_INVALID_CODEPOINT)
+    {
+        out[0] = (u8)(codepoint - SEARCH_INVALID_CODEPOINT);
+        return 1;
+    }
+    return search_put_utf8(out, codepoint);
+}
+
+//
+// Other encodings
+//
+
+internal inline b32 search_is_utf16(SearchFileKind kind)
+{
+    return kind == SearchFileKind_Utf16Le || kind == SearchFileKind_Utf16Be;
+}
+
+internal inline size search_put_unit(u8* out, u32 unit, b32 big_endian)
+{
+    out[big_endian ? 1 : 0] = (u8)(unit & 0xFF);
+    out[big_endian ? 0 : 1] = (u8)(unit >> 8);
+    return 2;
+}
+
+// Writes a decoded code point the way a file of kind writes it, or returns 0 if it can't. Text and binary files are
+// taken as UTF-8. Invalid bytes are put back as they were in the 8-bit encodings and have no UTF-16 at all.
+internal size search_encode(SearchFileKind kind, u32 codepoint, u8* out)
+{
+    b32 invalid = codepoint >= SEARCH_INVALID_CODEPOINT;
+    size result = 0;
+    if (kind == SearchFileKind_Latin1)
+    {
+        if (invalid || codepoint <= 0xFF)
+        {
+            out[0] = (u8)(invalid ? codepoint - SEARCH_INVALID_CODEPOINT : codepoint);
+            result = 1;
+        }
+    }
+    else if (search_is_utf16(kind))
+    {
+        b32 big_endian = (kind == SearchFileKind_Utf16Be);
+        if (!invalid && codepoint >= 0x10000)
+        {
+            u32 bits = codepoint - 0x10000;
+            result = search_put_unit(out, 0xD800 + (bits >> 10), big_endian);
+            result += search_put_unit(out + 2, 0xDC00 + (bits & 0x3FF), big_endian);
+        }
+        else if (!invalid)
+        {
+            result = search_put_unit(out, codepoint, big_endian);
+        }
+    }
+    else
+    {
+        result = search_put_decoded(out, codepoint);
+    }
+    return result;
+}
+
+// search_decode_utf8 for a file of kind. A UTF-16 unit that isn't half of a pair is SEARCH_INVALID_CODEPOINT plus
+// the unit, and so is half a unit at the end of data.
+internal u32 search_decode(SearchFileKind kind, u8* data, size data_size, size* length)
+{
+    u32 result = 0;
+    if (kind == SearchFileKind_Latin1)
+    {
+        *length = 1;
+        result = data[0];
+    }
+    else if (search_is_utf16(kind))
+    {
+        b32 big_endian = (kind == SearchFileKind_Utf16Be);
+        *length = (data_size < 2) ? data_size : 2;
+        if (data_size < 2)
+            return SEARCH_INVALID_CODEPOINT + data[0];
+
+        u32 unit = big_endian ? ((u32)data[0] << 8) | data[1] : data[0] | ((u32)data[1] << 8);
+        result = unit;
+        if (unit >= 0xD800 && unit <= 0xDFFF)
+        {
+            u32 low = 0;
+            if (data_size >= 4)
+                low = big_endian ? ((u32)data[2] << 8) | data[3] : data[2] | ((u32)data[3] << 8);
+            if (unit <= 0xDBFF && low >= 0xDC00 && low <= 0xDFFF)
+            {
+                *length = 4;
+                result = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else
+            {
+                result = SEARCH_INVALID_CODEPOINT + unit;
+            }
+        }
+    }
+    else
+    {
+        result = search_decode_utf8(data, data_size, length);
+    }
+    return result;
+}
@@ -0,0 +1,259 @@
+#include "search/search.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SEARCH_CLASSIFY_SSE2 1
+#endif
+
+typedef struct
+{
+    u64 nul_even; // NUL bytes at even offsets
+    u64 nul_odd;
+    u64 control;  // Control bytes other than NUL and the usual whitespace and escape
+} SearchByteCounts;
+
+internal inline b32 search_is_control_byte(u8 byte)
+{
+    return byte && byte < 0x20 && !(byte >= '\t' && byte <= '\r') && byte != 0x1B;
+}
+
+#ifdef SEARCH_CLASSIFY_SSE2
+internal inline u64 search_sum_bytes(__m128i counts)
+{
+    __m128i sums = _mm_sad_epu8(counts, _mm_setzero_si128());
+    return (u64)_mm_cvtsi128_si32(sums) + (u64)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+}
+#endif
+
+internal SearchByteCounts search_count_bytes(u8* data, size data_size)
+{
+    SearchByteCounts result = {0};
+    size i = 0;
+
+#ifdef SEARCH_CLASSIFY_SSE2
+    // Same counting as search_count_newlines: matches are -1, so subtracting them counts up per byte lane
+    __m128i zero = _mm_setzero_si128();
+    __m128i even_lanes = _mm_set1_epi16(0x00FF);
+    __m128i control_max = _mm_set1_epi8(0x1F);
+    __m128i whitespace_first = _mm_set1_epi8('\t');
+    __m128i whitespace_span = _mm_set1_epi8('\r' - '\t');
+    __m128i escape = _mm_set1_epi8(0x1B);
+    while (i + 16 <= data_size)
+    {
+        size block_end = i + 255*16;
+        if (block_end > data_size)
+            block_end = data_size;
+
+        __m128i nul_counts = zero;
+        __m128i nul_even_counts = zero;
+        __m128i control_counts = zero;
+        for (; i + 16 <= block_end; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128((__m128i*)(data + i));
+            __m128i nul = _mm_cmpeq_epi8(bytes, zero);
+            __m128i below_space = _mm_cmpeq_epi8(_mm_min_epu8(bytes, control_max), bytes);
+            __m128i shifted = _mm_sub_epi8(bytes, whitespace_first);
+            __m128i whitespace = _mm_cmpeq_epi8(_mm_min_epu8(shifted, whitespace_span), shifted);
+            __m128i allowed = _mm_or_si128(_mm_or_si128(nul, whitespace), _mm_cmpeq_epi8(bytes, escape));
+
+            nul_counts = _mm_sub_epi8(nul_counts, nul);
+            nul_even_counts = _mm_sub_epi8(nul_even_counts, _mm_and_si128(nul, even_lanes));
+            control_counts = _mm_sub_epi8(control_counts, _mm_andnot_si128(allowed, below_space));
+        }
+
+        u64 nul = search_sum_bytes(nul_counts);
+        u64 nul_even = search_sum_bytes(nul_even_counts);
+        result.nul_even += nul_even;
+        result.nul_odd += nul - nul_even;
+        result.control += search_sum_bytes(control_counts);
+    }
+#endif
+
+    // i is a multiple of 16 here, so i & 1 is still the parity of the offset
+    for (; i < data_size; ++i)
+    {
+        if (data[i] == 0)
+        {
+            if (i & 1)
+                ++result.nul_odd;
+            else
+                ++result.nul_even;
+        }
+        result.control += search_is_control_byte(data[i]);
+    }
+    return result;
+}
+
+// Whether text has bytes that aren't UTF-8 and no characters that are, past ASCII. A character cut off by the end
+// of the head doesn't count either way.
+internal b32 search_looks_latin1(u8* data, size data_size)
+{
+    b32 invalid = false;
+    b32 valid = false;
+    size i = 0;
+    while (i < data_size && !valid)
+    {
+#ifdef SEARCH_CLASSIFY_SSE2
+        // Runs of ASCII, which is most of any text, 16 bytes at a time
+        while (i + 16 <= data_size && !_mm_movemask_epi8(_mm_loadu_si128((__m128i*)(data + i))))
+            i += 16;
+        if (i >= data_size)
+            break;
+#endif
+        size length = 0;
+        u32 codepoint = search_decode_utf8(data + i, data_size - i, &length);
+        if (codepoint >= SEARCH_INVALID_CODEPOINT && i + 4 > data_size)
+            break;
+        invalid = invalid || codepoint >= SEARCH_INVALID_CODEPOINT;
+        valid = length > 1;
+        i += length;
+    }
+    return invalid && !valid;
+}
+
+/*
+ * NOTE(lucas): A NUL byte anywhere in the head means binary, as it does for git and grep, unless the NULs line up
+ * the way mostly-ASCII UTF-16 puts them: the high byte of nearly every other unit. A head that is more than
+ * 1/SEARCH_CONTROL_BYTE_RATIO control bytes is binary too, which catches formats that avoid NUL.
+ *
+ * Text is UTF-8 unless its head has bytes that can't be and not one character past ASCII that is, which is what
+ * Latin-1 looks like. A UTF-8 file with a stray bad byte in it stays UTF-8.
+ */
+#define SEARCH_CONTROL_BYTE_RATIO 16
+
+SearchFileKind search_classify(u8* head, size head_size)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    SearchFileKind result = SearchFileKind_Text;
+    if (head_size >= 4 && head[0] == 0xFF && head[1] == 0xFE && head[2] == 0 && head[3] == 0)
+        result = SearchFileKind_Binary; // UTF-32, which nothing writes on purpose
+    else if (head_size >= 2 && head[0] == 0xFF && head[1] == 0xFE)
+        result = SearchFileKind_Utf16Le;
+    else if (head_size >= 2 && head[0] == 0xFE && head[1] == 0xFF)
+        result = SearchFileKind_Utf16Be;
+    else if (!(head_size >= 3 && head[0] == 0xEF && head[1] == 0xBB && head[2] == 0xBF))
+    {
+        SearchByteCounts counts = search_count_bytes(head, head_size);
+        u64 units = (u64)head_size / 2;
+        if (counts.nul_odd > units / 4 && counts.nul_even*8 < counts.nul_odd)
+            result = SearchFileKind_Utf16Le;
+        else if (counts.nul_even > units / 4 && counts.nul_odd*8 < counts.nul_even)
+            result = SearchFileKind_Utf16Be;
+        else if (counts.nul_even || counts.nul_odd || counts.control*SEARCH_CONTROL_BYTE_RATIO > (u64)head_size)
+            result = SearchFileKind_Binary;
+        else if (search_looks_latin1(head, head_size))
+            result = SearchFileKind_Latin1;
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+//
+// UTF-16 to UTF-8
+//
+
+void search_transcoder_init(SearchTranscoder* transcoder, SearchFileKind kind)
+{
+    ASSERT(kind == SearchFileKind_Utf16Le || kind == SearchFileKind_Utf16Be, "Only UTF-16 is transcoded");
+    transcoder->big_endian = (kind == SearchFileKind_Utf16Be);
+    transcoder->at_start = true;
+    transcoder->high_surrogate = 0;
+    transcoder->has_odd_byte = false;
+    transcoder->odd_byte = 0;
+}
+
+// Converts one unit, pairing surrogates across calls. Unpaired surrogates become U+FFFD.
+internal inline size search_transcode_unit(SearchTranscoder* transcoder, u32 unit, u8* out)
+{
+    size result = 0;
+    if (transcoder->high_surrogate)
+    {
+        if (unit >= 0xDC00 && unit <= 0xDFFF)
+        {
+            u32 codepoint = 0x10000 + ((transcoder->high_surrogate - 0xD800) << 10) + (unit - 0xDC00);
+            transcoder->high_surrogate = 0;
+            return search_put_utf8(out, codepoint);
+        }
+        result = search_put_utf8(out, 0xFFFD);
+        transcoder->high_surrogate = 0;
+    }
+
+    if (unit >= 0xD800 && unit <= 0xDBFF)
+        transcoder->high_surrogate = unit;
+    else if (unit >= 0xDC00 && unit <= 0xDFFF)
+        result += search_put_utf8(out + result, 0xFFFD);
+    else
+        result += search_put_utf8(out + result, unit);
+    return result;
+}
+
+size search_transcode_utf16(SearchTranscoder* transcoder, u8* in, size in_size, u8* out)
+{
+    size out_size = 0;
+    size i = 0;
+
+    // A unit split across two calls
+    if (transcoder->has_odd_byte && in_size > 0)
+    {
+        u32 unit = transcoder->big_endian ? ((u32)transcoder->odd_byte << 8) | in[0]
+                                          : transcoder->odd_byte | ((u32)in[0] << 8);
+        transcoder->has_odd_byte = false;
+        i = 1;
+        if (!(transcoder->at_start && unit == 0xFEFF))
+            out_size += search_transcode_unit(transcoder, unit, out + out_size);
+        transcoder->at_start = false;
+    }
+    if (transcoder->at_start && in_size - i >= 2)
+    {
+        // The byte order mark isn't part of the text
+        u32 unit = transcoder->big_endian ? ((u32)in[i] << 8) | in[i + 1] : in[i] | ((u32)in[i + 1] << 8);
+        if (unit == 0xFEFF)
+            i += 2;
+        transcoder->at_start = false;
+    }
+
+    while (i + 2 <= in_size)
+    {
+#ifdef SEARCH_CLASSIFY_SSE2
+        // Runs of ASCII, which is most of what is searched, go eight units at a time
+        if (!transcoder->high_surrogate)
+        {
+            __m128i non_ascii = _mm_set1_epi16((short)0xFF80);
+            while (i + 16 <= in_size)
+            {
+                __m128i units = _mm_loadu_si128((__m128i*)(in + i));
+                if (transcoder->big_endian)
+                    units = _mm_or_si128(_mm_slli_epi16(units, 8), _mm_srli_epi16(units, 8));
+                __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(units, non_ascii), _mm_setzero_si128());
+                if (_mm_movemask_epi8(ascii) != 0xFFFF)
+                    break;
+                _mm_storel_epi64((__m128i*)(out + out_size), _mm_packus_epi16(units, units));
+                out_size += 8;
+                i += 16;
+            }
+            if (i + 2 > in_size)
+                break;
+        }
+#endif
+        u32 unit = transcoder->big_endian ? ((u32)in[i] << 8) | in[i + 1] : in[i] | ((u32)in[i + 1] << 8);
+        out_size += search_transcode_unit(transcoder, unit, out + out_size);
+        i += 2;
+    }
+
+    if (i < in_size)
+    {
+        transcoder->odd_byte = in[i];
+        transcoder->has_odd_byte = true;
+    }
+    return out_size;
+}
+
+size search_transcode_latin1(u8* in, size in_size, u8* out)
+{
+    size out_size = 0;
+    for (size i = 0; i < in_size; ++i)
+        out_size += search_put_utf8(out + out_size, in[i]);
+    return out_size;
+}
@@ -0,0 +1,696 @@
+#include "atomic.h"
+#include "channel.h"
+#include "file.h"
+#include "ipc.h"
+#include "profiler.h"
+#include "search/daemon.h"
+#include "search/query.h"
+#include "search/snapshot.h"
+#include "thread.h"
+
+#include <stdio.h> // snprintf
+#include <string.h> // memcpy, strcmp, strlen
+
+//
+// Ring
+//
+
+internal void daemon_ring_init(DaemonRing* ring)
+{
+    ring->magic = DAEMON_RING_MAGIC;
+    ring->cell_count = DAEMON_RING_CELLS;
+    ring->write = 0;
+    ring->read = 0;
+    for (u32 i = 0; i < DAEMON_RING_CELLS; ++i)
+        ring->cells[i].sequence = i;
+}
+
+// Workers publish as in channel_ring_push_multi, except that a full ring is waited out. Returns false if the token
+// was cancelled first.
+internal b32 daemon_ring_push(DaemonRing* ring, DaemonCell* batch, u32 generation, CancelToken* token)
+{
+    u32 mask = DAEMON_RING_CELLS - 1;
+    DaemonCell* cell = 0;
+    u32 position = atomic_load_u32(&ring->write);
+    for (;;)
+    {
+        cell = &ring->cells[position & mask];
+        i32 difference = (i32)(atomic_load_u32(&cell->sequence) - position);
+        if (difference == 0)
+        {
+            if (atomic_compare_exchange_u32(&ring->write, position, position + 1))
+                break;
+        }
+        else if (difference < 0)
+        {
+            // Full, until the client reads the cell
+            if (cancel_token_is_cancelled(token))
+                return false;
+            thread_sleep(1);
+        }
+        position = atomic_load_u32(&ring->write);
+    }
+
+    cell->generation = generation;
+    cell->count = batch->count;
+    memcpy(cell->matches, batch->matches, (usize)batch->count*sizeof(SearchMatch));
+    atomic_store_u32(&cell->sequence, position + 1);
+    return true;
+}
+
+// The client is the only consumer, so it reads in order without claiming cells. Returns 0 if the next isn't ready.
+internal DaemonCell* daemon_ring_peek(DaemonRing* ring)
+{
+    u32 read = ring->read;
+    DaemonCell* cell = &ring->cells[read & (DAEMON_RING_CELLS - 1)];
+    return (atomic_load_u32(&cell->sequence) == read + 1) ? cell : 0;
+}
+
+internal void daemon_ring_release(DaemonRing* ring, DaemonCell* cell)
+{
+    u32 read = ring->read;
+    atomic_store_u32(&cell->sequence, read + DAEMON_RING_CELLS);
+    atomic_store_u32(&ring->read, read + 1);
+}
+
+//
+// Path table
+//
+
+typedef struct
+{
+    s8 root;
+    u8* base;
+    u64* offsets;
+    u64 used; // Bytes of paths
+    u32 count;
+} DaemonPathWriter;
+
+internal void daemon_measure_path(s8 path, SnapshotNode* node, void* data)
+{
+    DaemonPathWriter* writer = (DaemonPathWriter*)data;
+    writer->used += (u64)writer->root.len + 1 + (u64)path.len + 1;
+    ++writer->count;
+    (void)node;
+}
+
+internal void daemon_write_path(s8 path, SnapshotNode* node, void* data)
+{
+    DaemonPathWriter* writer = (DaemonPathWriter*)data;
+    u64 offset = writer->offsets[writer->count];
+    u8* at = writer->base + offset;
+    memcpy(at, writer->root.data, (usize)writer->root.len);
+    at[writer->root.len] = '/';
+    memcpy(at + writer->root.len + 1, path.data, (usize)path.len);
+    at[writer->root.len + 1 + path.len] = 0;
+    writer->offsets[++writer->count] = offset + (u64)writer->root.len + 1 + (u64)path.len + 1;
+    (void)node;
+}
+
+// Makes the next version of the path table from a snapshot image, which is copied. Only called between queries.
+internal b32 daemon_load_corpus(DaemonServer* server, s8 image)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    // NOTE(lucas): This slot holds the table from two versions back. Clients that were reading it have had a
+    // whole refresh to move on, and on Linux their mappings outlive the name anyway.
+    u32 version = server->corpus_version + 1;
+    DaemonCorpus* corpus = &server->corpora[version & 1];
+    if (corpus->paths.data)
+    {
+        shared_memory_close(&corpus->paths);
+        shared_memory_unlink(corpus->paths_name);
+    }
+    arena_clear(&corpus->arena);
+    zero_struct(corpus->corpus);
+
+    u8* copy = push_array(&corpus->arena, image.len, u8);
+    b32 result = copy != 0;
+    if (result)
+    {
+        memcpy(copy, image.data, (usize)image.len);
+        result = snapshot_from_memory(&corpus->snapshot, copy, image.len);
+    }
+
+    DaemonPathWriter writer = {0};
+    writer.root = corpus->snapshot.root;
+    u64 paths_offset = 0;
+    if (result)
+    {
+        snapshot_for_each_file(&corpus->snapshot, &corpus->arena, daemon_measure_path, &writer);
+        paths_offset = sizeof(DaemonPathsHeader) + ((u64)writer.count + 1)*sizeof(u64);
+        snprintf(corpus->paths_name, sizeof(corpus->paths_name), "%s-paths-%u", server->name, version);
+        result = shared_memory_create(&corpus->paths, corpus->paths_name, (size)(paths_offset + writer.used));
+    }
+
+    if (result)
+    {
+        DaemonPathsHeader* header = (DaemonPathsHeader*)corpus->paths.data;
+        header->magic = DAEMON_PATHS_MAGIC;
+        header->version = version;
+        header->file_count = writer.count;
+        header->root_length = (u32)writer.root.len;
+        header->bytes = (u64)corpus->paths.bytes;
+
+        writer.base = corpus->paths.data;
+        writer.offsets = (u64*)(corpus->paths.data + sizeof(DaemonPathsHeader));
+        writer.offsets[0] = paths_offset;
+        writer.count = 0;
+        snapshot_for_each_file(&corpus->snapshot, &corpus->arena, daemon_write_path, &writer);
+
+        // The workers open files by the same paths the clients see
+        corpus->corpus.file_count = writer.count;
+        corpus->corpus.paths = push_array(&corpus->arena, writer.count, char*);
+        result = corpus->corpus.paths != 0;
+        for (u32 i = 0; result && i < writer.count; ++i)
+            corpus->corpus.paths[i] = (char*)(corpus->paths.data + writer.offsets[i]);
+    }
+
+    if (result)
+    {
+        corpus->version = version;
+        server->corpus_version = version;
+        server->refresh.current = &corpus->snapshot;
+    }
+    else if (corpus->paths.data)
+    {
+        shared_memory_close(&corpus->paths);
+        shared_memory_unlink(corpus->paths_name);
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+//
+// Sessions
+//
+
+internal void daemon_session_sink(QueryExecutor* executor, u32 worker, SearchMatch* match, void* data)
+{
+    DaemonSession* session = (DaemonSession*)data;
+    DaemonCell* batch = &session->batches[worker];
+    if (match)
+    {
+        batch->matches[batch->count++] = *match;
+        if (batch->count < DAEMON_RING_BATCH)
+            return;
+    }
+
+    // Full, or the worker has finished its files. Matches of a query that was cancelled are dropped.
+    if (batch->count)
+        daemon_ring_push(session->ring, batch, executor->generation, executor->query.token);
+    batch->count = 0;
+}
+
+internal void daemon_send_reply(DaemonServer* server, DaemonSession* session, u32 type, u32 generation,
+                                QueryStats* stats)
+{
+    DaemonCorpus* corpus = &server->corpora[session->corpus_version & 1];
+    DaemonReply reply;
+    zero_struct(reply);
+    reply.type = type;
+    reply.generation = generation;
+    reply.paths_version = corpus->version;
+    reply.file_count = corpus->corpus.file_count;
+    reply.paths_bytes = (u64)corpus->paths.bytes;
+    memcpy(reply.ring_name, session->ring_name, sizeof(reply.ring_name));
+    memcpy(reply.paths_name, corpus->paths_name, sizeof(reply.paths_name));
+    if (stats)
+        reply.stats = *stats;
+
+    // A client that has gone is noticed by its connection's thread
+    ipc_send(session->connection, &reply, sizeof(reply));
+}
+
+// After the connection's thread has finished, so the search thread is the only one left using the session
+internal void daemon_session_clean(DaemonSession* session)
+{
+    if (session->ring_memory.data && !session->ring_unlinked)
+        shared_memory_unlink(session->ring_name);
+    shared_memory_close(&session->ring_memory);
+    session->ring = 0;
+    session->ring_unlinked = false;
+    ipc_close(session->connection);
+    session->connection = 0;
+    session->welcomed = false;
+
+    // Queries the client sent before it went are never run, and the next client starts without its history
+    session->executor->started = session->executor->submitted;
+    query_forget(session->executor);
+    atomic_store_u32(&session->state, DaemonSessionState_Free);
+}
+
+internal void daemon_session_thread(void* data)
+{
+    DaemonSession* session = (DaemonSession*)data;
+    DaemonServer* server = session->server;
+    DaemonRequest request;
+    b32 ready = ipc_receive(session->connection, &request, sizeof(request)) &&
+                request.type == DaemonMessage_Hello && request.version == DAEMON_PROTOCOL_VERSION;
+    if (ready)
+    {
+        snprintf(session->ring_name, sizeof(session->ring_name), "%s-ring-%u-%u", server->name, session->index,
+                 ++session->serial);
+        ready = shared_memory_create(&session->ring_memory, session->ring_name, sizeof(DaemonRing));
+    }
+
+    if (ready)
+    {
+        session->last_needle_length = 0;
+        session->ring = (DaemonRing*)session->ring_memory.data;
+        daemon_ring_init(session->ring);
+        atomic_store_u32(&session->state, DaemonSessionState_Ready);
+        semaphore_signal(server->wake);
+
+        QueryExecutor* executor = session->executor;
+        while (ipc_receive(session->connection, &request, sizeof(request)))
+        {
+            // Anything the client sends comes after it has mapped the ring
+            if (!session->ring_unlinked)
+            {
+                shared_memory_unlink(session->ring_name);
+                session->ring_unlinked = true;
+            }
+            if (request.type == DaemonMessage_Query)
+            {
+                size needle_length = (request.needle_length < SEARCH_MAX_NEEDLE) ? (size)request.needle_length :
+                                                                                   (size)SEARCH_MAX_NEEDLE;
+                s8 needle = {request.needle, needle_length};
+                s8 last = {session->last_needle, session->last_needle_length};
+                if (!last.len || needle.len <= last.len || !search_find(needle.data, needle.len, last))
+                    query_forget(executor);
+                memcpy(session->last_needle, needle.data, (usize)needle.len);
+                session->last_needle_length = needle.len;
+                query_submit(executor, needle);
+            }
+        }
+
+        // The query that may still be running. Those before it were cancelled when it was submitted.
+        cancel_token_cancel(&executor->requests[executor->submitted % QUERY_REQUESTS].token);
+    }
+
+    atomic_store_u32(&session->state, DaemonSessionState_Closed);
+    semaphore_signal(server->wake);
+}
+
+internal void daemon_accept_thread(void* data)
+{
+    DaemonServer* server = (DaemonServer*)data;
+    for (;;)
+    {
+        void* connection = ipc_accept(server->listener);
+        if (!connection)
+        {
+            thread_sleep(10);
+            continue;
+        }
+
+        DaemonSession* session = 0;
+        for (u32 i = 0; !session && i < DAEMON_MAX_CLIENTS; ++i)
+        {
+            DaemonSession* candidate = &server->sessions[i];
+            if (atomic_compare_exchange_u32(&candidate->state, DaemonSessionState_Free, DaemonSessionState_Connecting))
+                session = candidate;
+        }
+
+        // Without a free session the client sees the connection close before its Welcome
+        if (session)
+        {
+            session->connection = connection;
+            if (!thread_create(daemon_session_thread, session))
+            {
+                session->connection = 0;
+                atomic_store_u32(&session->state, DaemonSessionState_Free);
+                ipc_close(connection);
+            }
+        }
+        else
+        {
+            ipc_close(connection);
+        }
+    }
+}
+
+internal void daemon_refresh_thread(void* data)
+{
+    DaemonServer* server = (DaemonServer*)data;
+    for (;;)
+    {
+        thread_sleep(DAEMON_REFRESH_MS);
+        if (atomic_load_u32(&server->refresh_ready))
+            continue;
+
+        snapshot_refresh_job(&server->refresh);
+        if (server->refresh.changed && server->refresh.image.data)
+        {
+            atomic_store_u32(&server->refresh_ready, 1);
+            semaphore_signal(server->wake);
+        }
+    }
+}
+
+//
+// Serving
+//
+
+// Every ring and path table of the daemon, or of one before it that died without removing them
+internal void daemon_unlink_shared_memory(DaemonServer* server)
+{
+    char prefix[IPC_MAX_NAME];
+    snprintf(prefix, sizeof(prefix), "%s-", server->name);
+    shared_memory_unlink_all(prefix);
+}
+
+b32 daemon_get_name(char* root, WalkOptions* options, char* name, size capacity)
+{
+    char full_root[WALK_MAX_PATH];
+    size length = file_get_full_path(root, full_root, sizeof(full_root));
+    if (length)
+    {
+        u64 hash = snapshot_options_hash((s8){(u8*)full_root, length}, options);
+        snprintf(name, (usize)capacity, "grapple-%016llx", (unsigned long long)hash);
+    }
+    return length != 0;
+}
+
+internal b32 daemon_start(DaemonServer* server, char* root, WalkOptions* options)
+{
+    if (!file_get_full_path(root, server->root, sizeof(server->root)) ||
+        !daemon_get_name(server->root, options, server->name, sizeof(server->name)))
+        return false;
+    server->options = *options;
+
+    char snapshot_name[IPC_MAX_NAME + 16];
+    snprintf(snapshot_name, sizeof(snapshot_name), "%s-snapshot", server->name);
+    if (!ipc_runtime_path(snapshot_name, server->snapshot_path, sizeof(server->snapshot_path)))
+        return false;
+
+    // Listening fails while another daemon answers, so what is left under the name is from one that died
+    server->listener = ipc_listen(server->name);
+    if (!server->listener)
+        return false;
+    daemon_unlink_shared_memory(server);
+
+    server->arena = arena_alloc(MEGABYTES(16));
+    u32 processor_count = thread_get_processor_count();
+    server->queue = work_queue_create(&server->arena, processor_count > 1 ? processor_count - 1 : 1);
+    server->wake = semaphore_create(&server->arena, 0);
+    ipc_catch_interrupt(&server->interrupted, server->wake);
+    server->corpora[0].arena = arena_alloc(DAEMON_CORPUS_MEMORY);
+    server->corpora[1].arena = arena_alloc(DAEMON_CORPUS_MEMORY);
+    snapshot_refresh_init(&server->refresh, server->root, server->snapshot_path, &server->options, 0);
+
+    // The saved snapshot if there is one, which the refresh thread checks straight away, or else a crawl
+    Snapshot saved;
+    b32 loaded = false;
+    if (snapshot_open(&saved, server->snapshot_path, server->root, &server->options))
+    {
+        s8 image = {saved.mapping.data, saved.mapping.size};
+        loaded = daemon_load_corpus(server, image);
+        snapshot_close(&saved);
+    }
+    if (!loaded)
+    {
+        SnapshotBuilder* builder = push_struct(&server->refresh.arena, SnapshotBuilder);
+        s8 full_root = {(u8*)server->root, (size)strlen(server->root)};
+        snapshot_builder_init(builder, &server->refresh.arena, full_root, &server->options);
+        snapshot_crawl(builder, &server->refresh.scratch, &server->options);
+        s8 image = snapshot_builder_finish(builder);
+        snapshot_write(image, server->snapshot_path);
+        loaded = daemon_load_corpus(server, image);
+        arena_clear(&server->refresh.arena);
+        arena_clear(&server->refresh.scratch);
+    }
+    if (!loaded)
+        return false;
+
+    // NOTE(lucas): Only one query runs at a time, so every session's executor shares the first one's search
+    // contexts rather than each reserving their own. They start without a corpus, and are given the current one
+    // when their session is first used.
+    QueryCorpus empty = {0};
+    QueryExecutor* first = 0;
+    for (u32 i = 0; i < DAEMON_MAX_CLIENTS; ++i)
+    {
+        DaemonSession* session = &server->sessions[i];
+        session->server = server;
+        session->index = i;
+        session->arena = arena_alloc(DAEMON_SESSION_MEMORY);
+        if (first)
+            session->executor = query_executor_create_shared(&session->arena, &empty, first);
+        else
+            first = session->executor = query_executor_create(&session->arena, &empty, server->queue, 0);
+        session->executor->wake = server->wake;
+        session->executor->sink = daemon_session_sink;
+        session->executor->sink_data = session;
+        session->batches = push_array(&session->arena, session->executor->worker_count, DaemonCell);
+        for (u32 w = 0; w < session->executor->worker_count; ++w)
+            session->batches[w].count = 0;
+    }
+
+    return thread_create(daemon_refresh_thread, server) && thread_create(daemon_accept_thread, server);
+}
+
+b32 daemon_serve(char* root, WalkOptions* options)
+{
+    Arena arena = arena_alloc(sizeof(DaemonServer));
+    DaemonServer* server = push_struct(&arena, DaemonServer);
+    if (!server)
+        return false;
+    zero_struct(*server);
+    if (!daemon_start(server, root, options))
+        return false;
+
+    // The search thread is this one, which created the work queue and so is the only one that may add to it
+    while (!atomic_load_u32(&server->interrupted))
+    {
+        semaphore_wait(server->wake);
+        b32 busy = true;
+        while (busy && !atomic_load_u32(&server->interrupted))
+        {
+            busy = false;
+            if (atomic_load_u32(&server->refresh_ready))
+            {
+                daemon_load_corpus(server, server->refresh.image);
+                atomic_store_u32(&server->refresh_ready, 0);
+            }
+
+            // One query per client per turn, so a client typing quickly can't keep the others waiting
+            for (u32 i = 0; i < DAEMON_MAX_CLIENTS; ++i)
+            {
+                DaemonSession* session = &server->sessions[i];
+                u32 state = atomic_load_u32(&session->state);
+                if (state == DaemonSessionState_Closed)
+                    daemon_session_clean(session);
+                if (state != DaemonSessionState_Ready)
+                    continue;
+
+                // The executor's per file flags go with the table, and are given back when it is
+                if (session->corpus_version != server->corpus_version)
+                {
+                    DaemonCorpus* corpus = &server->corpora[server->corpus_version & 1];
+                    query_executor_set_corpus(session->executor, &corpus->arena, &corpus->corpus);
+                    session->corpus_version = server->corpus_version;
+                }
+                if (!session->welcomed)
+                {
+                    daemon_send_reply(server, session, DaemonMessage_Welcome, session->executor->submitted, 0);
+                    session->welcomed = true;
+                }
+                if (query_executor_step(session->executor))
+                {
+                    daemon_send_reply(server, session, DaemonMessage_Done, session->executor->completed,
+                                      &session->executor->stats);
+                    busy = true;
+                }
+            }
+        }
+    }
+
+    /*
+     * NOTE(lucas): The socket goes first, so no new client can connect. One that connected just before may still make
+     * its ring after the rest are gone, and the next daemon removes that. Clients see their connections close when
+     * the process exits, and the rings and tables they have mapped stay readable until they unmap them. Queries still
+     * running are abandoned along with the workers.
+     */
+    ipc_unlink(server->name);
+    daemon_unlink_shared_memory(server);
+    return true;
+}
+
+internal void daemon_print_error(char* message, char* detail)
+{
+    char buffer[WALK_MAX_PATH + 256];
+    int length = snprintf(buffer, sizeof(buffer), "grapple daemon: %s%s\n", message, detail);
+    if (length > (int)sizeof(buffer) - 1)
+        length = (int)sizeof(buffer) - 1;
+    if (length > 0)
+        file_write_stream(file_get_stderr(), buffer, length);
+}
+
+int daemon_main(int argc, char** argv)
+{
+    WalkOptions options = {0};
+    char* root = ".";
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--hidden") == 0)
+            options.include_hidden = true;
+        else if (strcmp(argv[i], "--no-ignore") == 0)
+            options.no_ignore_files = true;
+        else if (argv[i][0] == '-')
+        {
+            daemon_print_error("unknown option ", argv[i]);
+            return 2;
+        }
+        else
+            root = argv[i];
+    }
+
+    if (daemon_serve(root, &options))
+        return 0;
+    daemon_print_error("couldn't serve ", root);
+    return 1;
+}
+
+//
+// Clients
+//
+
+b32 daemon_client_connect(DaemonClient* client, char* root, WalkOptions* options)
+{
+    zero_struct(*client);
+    char name[IPC_MAX_NAME];
+    if (!daemon_get_name(root, options, name, sizeof(name)))
+        return false;
+
+    client->connection = ipc_connect(name);
+    b32 result = client->connection != 0;
+    if (result)
+    {
+        DaemonRequest hello;
+        zero_struct(hello);
+        hello.type = DaemonMessage_Hello;
+        hello.version = DAEMON_PROTOCOL_VERSION;
+        result = ipc_send(client->connection, &hello, sizeof(hello)) &&
+                 ipc_receive(client->connection, &client->reply, sizeof(client->reply)) &&
+                 client->reply.type == DaemonMessage_Welcome;
+    }
+    if (result)
+    {
+        client->reply.ring_name[IPC_MAX_NAME - 1] = 0;
+        result = shared_memory_open(&client->ring_memory, client->reply.ring_name, sizeof(DaemonRing));
+        client->ring = (DaemonRing*)client->ring_memory.data;
+        result = result && client->ring->magic == DAEMON_RING_MAGIC && client->ring->cell_count == DAEMON_RING_CELLS;
+    }
+
+    if (result)
+    {
+        client->generation = client->reply.generation;
+        client->done = true;
+    }
+    else
+    {
+        daemon_client_close(client);
+    }
+    return result;
+}
+
+void daemon_client_close(DaemonClient* client)
+{
+    ipc_close(client->connection);
+    shared_memory_close(&client->ring_memory);
+    shared_memory_close(&client->paths_memory);
+    zero_struct(*client);
+}
+
+u32 daemon_client_query(DaemonClient* client, s8 needle)
+{
+    DaemonRequest request;
+    zero_struct(request);
+    request.type = DaemonMessage_Query;
+    request.needle_length = (u32)((needle.len < (size)SEARCH_MAX_NEEDLE) ? needle.len : (size)SEARCH_MAX_NEEDLE);
+    memcpy(request.needle, needle.data, (usize)request.needle_length);
+
+    u32 result = 0;
+    if (client->connection && ipc_send(client->connection, &request, sizeof(request)))
+    {
+        // Generations are counted per client, so the daemon will give this one the next
+        result = ++client->generation;
+        client->done = false;
+    }
+    return result;
+}
+
+u64 daemon_client_drain(DaemonClient* client, SearchMatchCallback* on_match, void* data)
+{
+    u64 result = 0;
+    DaemonCell* cell = 0;
+    while (client->ring && (cell = daemon_ring_peek(client->ring)) != 0)
+    {
+        if (cell->generation == client->generation)
+        {
+            u32 count = (cell->count < DAEMON_RING_BATCH) ? cell->count : DAEMON_RING_BATCH;
+            for (u32 i = 0; i < count; ++i)
+                on_match(&cell->matches[i], data);
+            result += count;
+        }
+        daemon_ring_release(client->ring, cell);
+    }
+    return result;
+}
+
+b32 daemon_client_wait(DaemonClient* client, u32 timeout_ms)
+{
+    DaemonReply reply;
+    while (!client->done && client->connection && ipc_wait(client->connection, timeout_ms))
+    {
+        if (!ipc_receive(client->connection, &reply, sizeof(reply)))
+        {
+            // The daemon went away. What is in the ring is all there is.
+            ipc_close(client->connection);
+            client->connection = 0;
+            client->reply.stats.cancelled = true;
+            client->done = true;
+            break;
+        }
+        if (reply.type != DaemonMessage_Done || reply.generation != client->generation)
+            continue;
+
+        client->reply = reply;
+        client->done = true;
+        client->reply.paths_name[IPC_MAX_NAME - 1] = 0;
+        if (!client->paths || client->paths->version != reply.paths_version)
+        {
+            shared_memory_close(&client->paths_memory);
+            client->paths = 0;
+            if (shared_memory_open(&client->paths_memory, reply.paths_name, (size)reply.paths_bytes))
+            {
+                DaemonPathsHeader* header = (DaemonPathsHeader*)client->paths_memory.data;
+                u64 table_size = sizeof(DaemonPathsHeader) + ((u64)header->file_count + 1)*sizeof(u64);
+                if (header->magic == DAEMON_PATHS_MAGIC && header->bytes == reply.paths_bytes &&
+                    table_size <= header->bytes)
+                    client->paths = header;
+            }
+        }
+    }
+    return client->done;
+}
+
+s8 daemon_client_path(DaemonClient* client, u32 file_index)
+{
+    s8 result = {0};
+    DaemonPathsHeader* header = client->paths;
+    if (header && file_index < header->file_count)
+    {
+        u64* offsets = (u64*)(header + 1);
+        u64 start = offsets[file_index];
+        u64 end = offsets[file_index + 1];
+        if (start < end && end <= header->bytes)
+        {
+            result.data = (u8*)header + start;
+            result.len = (size)(end - start - 1);
+        }
+    }
+    return result;
+}
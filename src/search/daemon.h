@@ -0,0 +1,231 @@
+#pragma once
+
+#include "channel.h"
+#include "grapple_memory.h"
+#include "ipc.h"
+#include "search/query.h"
+#include "search/search.h"
+#include "search/snapshot.h"
+#include "search/walk.h"
+#include "thread.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): The daemon keeps one tree's search state warm between searches: the snapshot, revalidated every
+ * DAEMON_REFRESH_MS on a thread of its own, the path table built from it, the workers, and every client's query
+ * history. A search that goes through it only pays for the matching.
+ *
+ *   grapple daemon [--hidden] [--no-ignore] [PATH]
+ *
+ * A daemon's name comes from its root's full path and its walk options, so clients find it from the same two.
+ * Requests and replies are small fixed-size messages over the connection, but matches and paths never are:
+ *
+ *   - Each client gets a ring of DAEMON_RING_CELLS cells in shared memory. Workers fill a batch of matches each and
+ *     publish it to a cell, and the client reads the cells where they are. It is the bounded queue from channel.h,
+ *     with a sequence number per cell, laid out so that nothing in it is a pointer.
+ *   - The path table is shared too, and the matches' file indices are into it. A refresh that changes the tree
+ *     makes a new table with a new version, and the Done reply of every query names the table its indices are for.
+ *
+ * One thread runs the queries of every client, one at a time and taking turns, so the work queue keeps its single
+ * producer. As in query.h, a new query cancels the client's last one, and a query that extends the one before it
+ * searches only the files that matched. The refresh only notices files added and removed, not files edited in place, so
+ * any other query drops the client's history and searches every file. An edit is then missed only by the refinements of
+ * a query made before it. A worker that finds the ring full waits for the client to read it, and gives up once the
+ * query is cancelled, which also happens when the client goes away.
+ *
+ * Ctrl+C or SIGTERM stops the daemon, which removes its socket and shared memory on the way out and keeps only the
+ * snapshot, readable by its owner alone, for the next one. A daemon killed outright leaves the rest behind, and the
+ * next one to serve the same root removes it when it finds nobody listening.
+ */
+
+#define DAEMON_PROTOCOL_VERSION 1
+#define DAEMON_MAX_CLIENTS 16
+#define DAEMON_RING_CELLS 1024 // A power of two
+#define DAEMON_RING_BATCH 64   // Matches per cell
+#define DAEMON_RING_MAGIC 0x474E4952 // "RING"
+#define DAEMON_PATHS_MAGIC 0x48544150 // "PATH"
+#define DAEMON_REFRESH_MS 1000
+#define DAEMON_CORPUS_MEMORY MEGABYTES(256) // Per path table version, with every session's per file flags
+#define DAEMON_SESSION_MEMORY MEGABYTES(1)
+
+typedef struct
+{
+    volatile u32 sequence;
+    u32 generation; // Of the query that found the matches
+    u32 count;
+    u32 reserved;
+    SearchMatch matches[DAEMON_RING_BATCH];
+} DaemonCell;
+
+typedef struct
+{
+    u32 magic;
+    u32 cell_count;
+    u8 pad0[CHANNEL_CACHE_LINE - 2*sizeof(u32)];
+    volatile u32 write;
+    u8 pad1[CHANNEL_CACHE_LINE - sizeof(u32)];
+    volatile u32 read;
+    u8 pad2[CHANNEL_CACHE_LINE - sizeof(u32)];
+    DaemonCell cells[DAEMON_RING_CELLS];
+} DaemonRing;
+
+// Followed by u64 offsets[file_count + 1] and the paths they point to, each null-terminated. Paths are full, and
+// start with the root, which is the first root_length bytes of each.
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u32 file_count;
+    u32 root_length;
+    u64 bytes;
+} DaemonPathsHeader;
+
+typedef enum
+{
+    DaemonMessage_Hello = 1,
+    DaemonMessage_Welcome,
+    DaemonMessage_Query,
+    DaemonMessage_Done,
+} DaemonMessage;
+
+// From a client
+typedef struct
+{
+    u32 type;
+    u32 version; // DAEMON_PROTOCOL_VERSION, in a Hello
+    u32 needle_length;
+    u32 reserved;
+    u8 needle[SEARCH_MAX_NEEDLE];
+} DaemonRequest;
+
+// From the daemon
+typedef struct
+{
+    u32 type;
+    u32 generation; // Of the finished query, or in a Welcome, of the last one before the client's first
+    u32 paths_version;
+    u32 file_count;
+    u64 paths_bytes;
+    char ring_name[IPC_MAX_NAME];
+    char paths_name[IPC_MAX_NAME];
+    QueryStats stats;
+} DaemonReply;
+
+typedef struct DaemonServer DaemonServer;
+
+// A connected client, as the daemon sees it
+typedef struct
+{
+    DaemonServer* server;
+    u32 index;
+    volatile u32 state; // DaemonSessionState
+    void* connection;
+    b32 welcomed;
+    u32 serial; // Connections this session has had, to name their rings
+
+    SharedMemory ring_memory;
+    DaemonRing* ring;
+    char ring_name[IPC_MAX_NAME];
+    b32 ring_unlinked;
+
+    // The last needle the client sent, for the connection's thread
+    u8 last_needle[SEARCH_MAX_NEEDLE];
+    size last_needle_length;
+
+    Arena arena;
+    QueryExecutor* executor;
+    u32 corpus_version;
+    DaemonCell* batches; // One per worker, filled before they are published
+} DaemonSession;
+
+typedef enum
+{
+    DaemonSessionState_Free = 0,
+    DaemonSessionState_Connecting, // Taken by a connection whose thread is setting it up
+    DaemonSessionState_Ready,
+    DaemonSessionState_Closed, // The connection's thread has finished, and the search thread cleans up after it
+} DaemonSessionState;
+
+// One version of the path table and the snapshot it was made from
+typedef struct
+{
+    u32 version;
+    Arena arena; // The snapshot, the corpus's pointers into the table, and the executors' per file flags
+    Snapshot snapshot;
+    SharedMemory paths;
+    char paths_name[IPC_MAX_NAME];
+    QueryCorpus corpus;
+} DaemonCorpus;
+
+struct DaemonServer
+{
+    char root[WALK_MAX_PATH];
+    WalkOptions options;
+    char name[32]; // "grapple-" and a hash, which leaves room in IPC_MAX_NAME for what is named after it
+    char snapshot_path[IPC_MAX_PATH];
+    void* listener;
+
+    Arena arena;
+    WorkQueue* queue;
+    Semaphore* wake; // Signalled for new queries, connections coming and going, refreshes, and interrupts
+    volatile u32 interrupted; // By Ctrl+C or a request to terminate
+
+    // The current version and the one before it, which clients may still be reading
+    DaemonCorpus corpora[2];
+    u32 corpus_version;
+
+    SnapshotRefresh refresh;
+    volatile u32 refresh_ready; // A changed snapshot is waiting to be swapped in, and the refresh thread waits for it
+
+    DaemonSession sessions[DAEMON_MAX_CLIENTS];
+};
+
+// A client's end of the connection
+typedef struct
+{
+    void* connection;
+    SharedMemory ring_memory;
+    DaemonRing* ring;
+    SharedMemory paths_memory;
+    DaemonPathsHeader* paths;
+    u32 generation; // Of the last query sent
+    b32 done;       // Whether it has finished
+    DaemonReply reply; // The last Done
+} DaemonClient;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Writes the name of the daemon for root and options. Returns false if root doesn't exist.
+b32 daemon_get_name(char* root, WalkOptions* options, char* name, size capacity);
+
+// Serves root on the calling thread and the ones it starts until it is interrupted, then removes its socket and
+// shared memory and returns true. Returns false if it can't start, as when another daemon is already serving the
+// same root.
+b32 daemon_serve(char* root, WalkOptions* options);
+
+// "grapple daemon". argv starts after "daemon". Returns once the daemon is interrupted, or on failure.
+int daemon_main(int argc, char** argv);
+
+// Fails straight away if no daemon is serving root with these options
+b32 daemon_client_connect(DaemonClient* client, char* root, WalkOptions* options);
+void daemon_client_close(DaemonClient* client);
+
+// Cancels the last query, if it is still running. Returns the new query's generation, or 0 if the daemon has gone.
+u32 daemon_client_query(DaemonClient* client, s8 needle);
+
+// Hands the matches waiting in the ring to on_match, skipping any from earlier queries. Returns how many were
+// handed over. Clients have to keep draining while a query runs, since the workers wait while the ring is full.
+u64 daemon_client_drain(DaemonClient* client, SearchMatchCallback* on_match, void* data);
+
+// Returns true once the last query has finished, waiting at most timeout_ms. Its matches are all in the ring by then,
+// and file indices can be turned into paths.
+b32 daemon_client_wait(DaemonClient* client, u32 timeout_ms);
+
+// The full path of a file in the table of the last query to finish. Null-terminated.
+s8 daemon_client_path(DaemonClient* client, u32 file_index);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,836 @@
+#include "atomic.h"
+#include "containers.h"
+#include "file.h"
+#include "profiler.h"
+#include "search/fuzzy.h"
+#include "search/walk.h"
+
+#include <stdio.h> // snprintf
+#include <string.h> // memcpy, strcmp, strlen
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define FUZZY_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// Scores as in fzf, whose weights have held up well on real trees
+#define FUZZY_SCORE_MATCH 16
+#define FUZZY_GAP_START -3
+#define FUZZY_GAP_EXTENSION -1
+#define FUZZY_BONUS_SLASH 9
+#define FUZZY_BONUS_BOUNDARY 8
+#define FUZZY_BONUS_CAMEL 7
+#define FUZZY_BONUS_CONSECUTIVE 4 // Never less than a gap would have cost
+#define FUZZY_BONUS_NAME 2
+#define FUZZY_FIRST_CHAR_MULTIPLIER 2
+#define FUZZY_NONE (-(1 << 29))
+
+#define FUZZY_ROW_SIZE (WALK_MAX_PATH + 16)
+#define FUZZY_TEXT_PADDING 64 // After the text, so the last path can be read 64 bytes at a time
+#define FUZZY_BLOCK_PATHS 4096 // Filtered at a time, and how often the token is checked
+
+internal inline u8 fuzzy_lower(u8 c)
+{
+    return (c >= 'A' && c <= 'Z') ? (u8)(c + ('a' - 'A')) : c;
+}
+
+// c is lowercase
+internal inline u64 fuzzy_char_bit(u8 c)
+{
+    if (c >= 'a' && c <= 'z')
+        return 1ull << (c - 'a');
+    if (c >= '0' && c <= '9')
+        return 1ull << (26 + c - '0');
+    return 1ull << (36 + c % 28);
+}
+
+internal u64 fuzzy_char_mask(u8* lower, size length)
+{
+    u64 result = 0;
+    for (size i = 0; i < length; ++i)
+        result |= fuzzy_char_bit(lower[i]);
+    return result;
+}
+
+// For the part masks, which only keep letters apart. c is lowercase.
+internal inline u32 fuzzy_part_bit(u8 c)
+{
+    if (c >= 'a' && c <= 'z')
+        return 1u << (c - 'a');
+    if (c >= '0' && c <= '9')
+        return 1u << (26 + (c - '0') % 3);
+    return 1u << (29 + c % 3);
+}
+
+//
+// Path table
+//
+
+b32 fuzzy_table_create(FuzzyTable* table, u32 max_paths, u32 average_length)
+{
+    zero_struct(*table);
+    u64 text_capacity = (u64)max_paths*average_length*2;
+    u64 path_bytes = sizeof(FuzzyPath) + sizeof(u64) + FUZZY_PARTS*sizeof(u32);
+    size total = (size)((u64)max_paths*path_bytes + text_capacity + FUZZY_TEXT_PADDING);
+    table->block = arena_alloc(total);
+    if (!table->block.data)
+        return false;
+
+    table->paths = push_array(&table->block, max_paths, FuzzyPath);
+    table->masks = push_array(&table->block, max_paths, u64);
+    table->part_masks = push_array(&table->block, (size)max_paths*FUZZY_PARTS, u32);
+    table->text = push_array(&table->block, text_capacity + FUZZY_TEXT_PADDING, u8);
+    table->max_paths = max_paths;
+    table->text_capacity = text_capacity;
+    return true;
+}
+
+void fuzzy_table_clear(FuzzyTable* table)
+{
+    table->path_count = 0;
+    table->text_used = 0;
+}
+
+s8 fuzzy_table_path(FuzzyTable* table, u32 index)
+{
+    ASSERT(index < table->path_count, "Path index out of range");
+    FuzzyPath* path = &table->paths[index];
+    s8 result = {table->text + path->offset, path->length};
+    return result;
+}
+
+b32 fuzzy_table_add(FuzzyTable* table, s8 path)
+{
+    u64 length = (u64)path.len;
+    if (table->path_count == table->max_paths || length*2 > table->text_capacity - table->text_used ||
+        length > WALK_MAX_PATH)
+        return false;
+
+    FuzzyPath* entry = &table->paths[table->path_count];
+    entry->offset = table->text_used;
+    entry->length = (u32)length;
+    entry->name_offset = 0;
+
+    u8* text = table->text + table->text_used;
+    u8* lower = text + length;
+    memcpy(text, path.data, (usize)length);
+    for (u32 i = 0; i < entry->length; ++i)
+    {
+        lower[i] = fuzzy_lower(text[i]);
+        if (text[i] == '/' || text[i] == '\\')
+            entry->name_offset = i + 1;
+    }
+
+    table->masks[table->path_count] = fuzzy_char_mask(lower, path.len);
+    u32* parts = &table->part_masks[(size)table->path_count*FUZZY_PARTS];
+    for (u32 part = 0; part < FUZZY_PARTS; ++part)
+    {
+        parts[part] = 0;
+        for (u32 i = part*entry->length/FUZZY_PARTS; i < (part + 1)*entry->length/FUZZY_PARTS; ++i)
+            parts[part] |= fuzzy_part_bit(lower[i]);
+    }
+    table->text_used += length*2;
+    ++table->path_count;
+    return true;
+}
+
+typedef struct
+{
+    FuzzyTable* table;
+    size prefix_length;
+} FuzzyTreeContext;
+
+internal void fuzzy_add_walked_file(char* path, size path_length, void* data)
+{
+    FuzzyTreeContext* context = (FuzzyTreeContext*)data;
+    s8 relative = {(u8*)path + context->prefix_length, path_length - context->prefix_length};
+    fuzzy_table_add(context->table, relative);
+}
+
+WalkStats fuzzy_table_add_tree(FuzzyTable* table, Arena* scratch, char* root, WalkOptions* options)
+{
+    // walk_tree drops trailing slashes from the root and puts one slash after it
+    size root_length = (size)strlen(root);
+    while (root_length > 0 && (root[root_length - 1] == '/' || root[root_length - 1] == '\\'))
+        --root_length;
+
+    FuzzyTreeContext context = {table, root_length + 1};
+    return walk_tree(scratch, root, options, fuzzy_add_walked_file, &context);
+}
+
+//
+// Scoring
+//
+
+FuzzyFinder* fuzzy_finder_create(Arena* arena, WorkQueue* queue)
+{
+    arena_align(arena, 16);
+    FuzzyFinder* finder = push_struct(arena, FuzzyFinder);
+    zero_struct(*finder);
+    finder->queue = queue;
+    finder->worker_count = queue ? queue->thread_count + 1 : 1;
+    finder->workers = push_array(arena, finder->worker_count, FuzzyWorker);
+    for (u32 i = 0; i < finder->worker_count; ++i)
+    {
+        FuzzyWorker* worker = &finder->workers[i];
+        worker->rows = push_array(arena, FUZZY_ROW_SIZE*4, i32);
+        worker->heap = push_array(arena, FUZZY_MAX_RESULTS, FuzzyResult);
+        worker->candidates = push_array(arena, FUZZY_BLOCK_PATHS, u32);
+    }
+    return finder;
+}
+
+// Index of the first c in text[start, end), or end
+internal inline size fuzzy_find_byte(u8* text, size start, size end, u8 c)
+{
+    size i = start;
+#ifdef FUZZY_SSE2
+    __m128i wide = _mm_set1_epi8((char)c);
+    for (; i + 16 <= end; i += 16)
+    {
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(text + i)), wide));
+        if (mask)
+            return i + count_trailing_zeros_u32(mask);
+    }
+#endif
+    for (; i < end; ++i)
+    {
+        if (text[i] == c)
+            return i;
+    }
+    return end;
+}
+
+// A bit for every c in the 64 bytes at text, which may run past the end of the path (see FUZZY_TEXT_PADDING)
+internal inline u64 fuzzy_occurrences(u8* text, u8 c)
+{
+#ifdef FUZZY_SSE2
+    __m128i wide = _mm_set1_epi8((char)c);
+    u64 result = (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)text), wide));
+    result |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(text + 16)), wide)) << 16;
+    result |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(text + 32)), wide)) << 32;
+    result |= (u64)(u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(text + 48)), wide)) << 48;
+    return result;
+#else
+    u64 result = 0;
+    for (u32 i = 0; i < 64; ++i)
+        result |= (u64)(text[i] == c) << i;
+    return result;
+#endif
+}
+
+internal inline u32 fuzzy_lowest_bit(u64 value)
+{
+    u32 low = (u32)value;
+    return low ? count_trailing_zeros_u32(low) : 32 + count_trailing_zeros_u32((u32)(value >> 32));
+}
+
+internal inline u32 fuzzy_highest_bit(u64 value)
+{
+    ASSERT(value, "fuzzy_highest_bit is undefined for 0");
+    u32 high = (u32)(value >> 32);
+    u32 part = high ? high : (u32)value;
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse(&index, part);
+    return (high ? 32 : 0) + (u32)index;
+#else
+    return (high ? 32 : 0) + 31 - (u32)__builtin_clz(part);
+#endif
+}
+
+internal inline i32 fuzzy_bonus(u8 previous, u8 current)
+{
+    if (previous == '/' || previous == '\\')
+        return FUZZY_BONUS_SLASH;
+    if (previous == '_' || previous == '-' || previous == '.' || previous == ' ' || previous == ':')
+        return FUZZY_BONUS_BOUNDARY;
+    b32 previous_lower = (previous >= 'a' && previous <= 'z');
+    b32 previous_digit = (previous >= '0' && previous <= '9');
+    if ((previous_lower && current >= 'A' && current <= 'Z') || (!previous_digit && current >= '0' && current <= '9'))
+        return FUZZY_BONUS_CAMEL;
+    return 0;
+}
+
+// The best score of a row steps positions after left, with no match in between
+internal inline i32 fuzzy_gap(i32 left, b32 left_is_match, i32 steps)
+{
+    if (steps == 0 || left == FUZZY_NONE)
+        return left;
+    return left + (left_is_match ? FUZZY_GAP_START : FUZZY_GAP_EXTENSION) + (steps - 1)*FUZZY_GAP_EXTENSION;
+}
+
+/*
+ * NOTE(lucas): query is lowercase. Matching the query greedily from the front gives the earliest place each of its
+ * characters can match, and matching it greedily from the back gives the latest, so character i can only ever be
+ * matched in [earliest[i], latest[i]]. Nothing outside those bands is scored. For typical queries the bands are a
+ * few bytes wide, and for a query that only fits one way they are one byte each. Returns false if the query isn't
+ * a subsequence, which most candidates fail a character or two in, so the front match stops there.
+ *
+ * The dynamic programming is the usual Smith-Waterman with affine gaps, one query character per row: the match
+ * score at t is the best score with this character matched at t, and the best score at t the best with it matched
+ * at or before t. Only the places in a row's band where its character is have a match score, and between them the
+ * best score only pays for gaps, so each row is kept as a list of those places. The next row walks the list
+ * alongside its own, working out the best score just before each of its places as it goes.
+ */
+internal b32 fuzzy_score_path(FuzzyWorker* worker, u8* text, u8* lower, size length, size name_offset, s8 query,
+                              i32* score)
+{
+    size n = query.len;
+    if (n == 0)
+    {
+        *score = 0;
+        return true;
+    }
+
+    u16 earliest[FUZZY_MAX_QUERY] = {0}; // Always set below, which GCC can fail to see at -O1. Paths fit in a u16.
+    size latest[FUZZY_MAX_QUERY];
+    u64 occurrences[FUZZY_MAX_QUERY];
+    if (length <= 64)
+    {
+        // Where each query character is, as a bit per byte of the path, so both greedy matches are bit twiddling
+        u64 valid = (length == 64) ? ~0ull : (1ull << length) - 1;
+        u64 allowed = ~0ull;
+        for (size i = 0; i < n; ++i)
+        {
+            occurrences[i] = fuzzy_occurrences(lower, query.data[i]) & valid;
+            u64 after = occurrences[i] & allowed;
+            if (!after)
+                return false;
+            earliest[i] = (u16)fuzzy_lowest_bit(after);
+            allowed = (earliest[i] == 63) ? 0 : ~0ull << (earliest[i] + 1);
+        }
+        allowed = ~0ull;
+        for (size i = n; i-- > 0;)
+        {
+            latest[i] = fuzzy_highest_bit(occurrences[i] & allowed);
+            allowed = (1ull << latest[i]) - 1;
+        }
+    }
+    else
+    {
+        size position = 0;
+        for (size i = 0; i < n; ++i)
+        {
+            position = fuzzy_find_byte(lower, position, length, query.data[i]);
+            if (position >= length)
+                return false;
+            earliest[i] = (u16)position++;
+        }
+        position = length;
+        for (size i = n; i-- > 0;)
+        {
+            do
+            {
+                --position;
+            } while (lower[position] != query.data[i]);
+            latest[i] = position;
+        }
+    }
+
+    i32 result = FUZZY_NONE;
+    i32* previous_at = worker->rows;
+    i32* previous_match = previous_at + FUZZY_ROW_SIZE;
+    i32* at = previous_match + FUZZY_ROW_SIZE;
+    i32* match = at + FUZZY_ROW_SIZE;
+    u32 previous_count = 0;
+    for (size i = 0; i < n; ++i)
+    {
+        u8 c = query.data[i];
+        u32 count = 0;
+        if (length <= 64)
+        {
+            u64 band = occurrences[i] & (~0ull << earliest[i]);
+            if (latest[i] < 63)
+                band &= (2ull << latest[i]) - 1;
+            for (; band; band &= band - 1)
+                at[count++] = (i32)fuzzy_lowest_bit(band);
+        }
+        else
+        {
+            for (size j = earliest[i]; j <= latest[i]; j = fuzzy_find_byte(lower, j + 1, latest[i] + 1, c))
+                at[count++] = (i32)j;
+        }
+
+        // The previous row's best score, as of left_at and whether it was a match there
+        u32 next = 0;
+        i32 left = FUZZY_NONE;
+        i32 left_at = 0;
+        b32 left_is_match = false;
+        u32 kept = 0;
+        for (u32 k = 0; k < count; ++k)
+        {
+            i32 j = at[k];
+            i32 bonus = fuzzy_bonus(j ? text[j - 1] : '/', text[j]) + (j >= name_offset ? FUZZY_BONUS_NAME : 0);
+            i32 here = FUZZY_NONE;
+            if (i == 0)
+            {
+                here = FUZZY_SCORE_MATCH + bonus*FUZZY_FIRST_CHAR_MULTIPLIER;
+            }
+            else
+            {
+                // Gaps cost FUZZY_GAP_START for their first byte and FUZZY_GAP_EXTENSION after, and a match that
+                // doesn't beat the gap running through it doesn't restart it
+                for (; next < previous_count && previous_at[next] < j; ++next)
+                {
+                    i32 gap = fuzzy_gap(left, left_is_match, previous_at[next] - left_at);
+                    i32 previous = previous_match[next];
+                    left_is_match = previous >= gap;
+                    left = left_is_match ? previous : gap;
+                    left_at = previous_at[next];
+                }
+
+                i32 consecutive = (next && previous_at[next - 1] == j - 1) ? previous_match[next - 1] : FUZZY_NONE;
+                i32 after_gap = fuzzy_gap(left, left_is_match, j - 1 - left_at);
+                if (consecutive > FUZZY_NONE)
+                {
+                    i32 run_bonus = bonus > FUZZY_BONUS_CONSECUTIVE ? bonus : FUZZY_BONUS_CONSECUTIVE;
+                    here = consecutive + FUZZY_SCORE_MATCH + run_bonus;
+                }
+                if (after_gap > FUZZY_NONE && after_gap + FUZZY_SCORE_MATCH + bonus > here)
+                    here = after_gap + FUZZY_SCORE_MATCH + bonus;
+            }
+
+            // Trailing gaps are free, so the score is the best match of the last character. Places the previous
+            // rows can't reach have no score, and are dropped as if the character weren't there.
+            if (i + 1 == n)
+            {
+                if (here > result)
+                    result = here;
+            }
+            else if (here > FUZZY_NONE)
+            {
+                at[kept] = j;
+                match[kept] = here;
+                ++kept;
+            }
+        }
+
+        i32* swap = previous_at;
+        previous_at = at;
+        at = swap;
+        swap = previous_match;
+        previous_match = match;
+        match = swap;
+        previous_count = kept;
+    }
+
+    // The last character can always match at latest[n - 1], so result is never FUZZY_NONE
+    *score = result;
+    return true;
+}
+
+b32 fuzzy_score(FuzzyWorker* worker, s8 path, s8 query, i32* score)
+{
+    u8 lower_query[FUZZY_MAX_QUERY];
+    u8 lower[WALK_MAX_PATH + FUZZY_TEXT_PADDING] = {0};
+    if (path.len > WALK_MAX_PATH || query.len > FUZZY_MAX_QUERY)
+        return false;
+
+    size name_offset = 0;
+    for (size i = 0; i < path.len; ++i)
+    {
+        lower[i] = fuzzy_lower(path.data[i]);
+        if (path.data[i] == '/' || path.data[i] == '\\')
+            name_offset = i + 1;
+    }
+    for (size i = 0; i < query.len; ++i)
+        lower_query[i] = fuzzy_lower(query.data[i]);
+
+    s8 lowered = {lower_query, query.len};
+    return fuzzy_score_path(worker, path.data, lower, path.len, name_offset, lowered, score);
+}
+
+//
+// Top K
+//
+
+internal inline b32 fuzzy_result_worse(FuzzyResult a, FuzzyResult b)
+{
+    if (a.score != b.score)
+        return a.score < b.score;
+    if (a.path_length != b.path_length)
+        return a.path_length > b.path_length;
+    return a.path_index > b.path_index;
+}
+
+// A min-heap with the worst kept result on top, so a new result only has to beat heap[0]
+internal void fuzzy_heap_push(FuzzyResult* heap, u32* count, u32 max_count, FuzzyResult result)
+{
+    u32 i = 0;
+    if (*count < max_count)
+    {
+        i = (*count)++;
+        while (i > 0 && fuzzy_result_worse(result, heap[(i - 1)/2]))
+        {
+            heap[i] = heap[(i - 1)/2];
+            i = (i - 1)/2;
+        }
+        heap[i] = result;
+        return;
+    }
+    if (!fuzzy_result_worse(heap[0], result))
+        return;
+
+    for (;;)
+    {
+        u32 child = i*2 + 1;
+        if (child >= *count)
+            break;
+        if (child + 1 < *count && fuzzy_result_worse(heap[child + 1], heap[child]))
+            ++child;
+        if (!fuzzy_result_worse(heap[child], result))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = result;
+}
+
+internal FuzzyResult fuzzy_heap_pop(FuzzyResult* heap, u32* count)
+{
+    FuzzyResult result = heap[0];
+    FuzzyResult last = heap[--(*count)];
+    u32 i = 0;
+    for (;;)
+    {
+        u32 child = i*2 + 1;
+        if (child >= *count)
+            break;
+        if (child + 1 < *count && fuzzy_result_worse(heap[child + 1], heap[child]))
+            ++child;
+        if (!fuzzy_result_worse(heap[child], last))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*count)
+        heap[i] = last;
+    return result;
+}
+
+//
+// Search
+//
+
+// What every worker shares for one search
+typedef struct
+{
+    FuzzyTable* table;
+    FuzzyQuery* query;
+    s8 lower_query;
+    u64 query_mask;
+    u32 max_results;
+    i32 max_score;
+    u64 part_allows[4][256]; // For each byte of a part mask, the places in the query whose characters it has
+    u32 block_count;
+    volatile u32 next_block;
+} FuzzySearch;
+
+typedef struct
+{
+    FuzzySearch* search;
+    FuzzyWorker* worker;
+    u32 heap_count;
+    b32 cancelled;
+    u64 candidates;
+    u64 scored;
+} FuzzySlice;
+
+// The best score a query of length characters could get: every character matched after a slash, in the file name
+internal i32 fuzzy_max_score(size length)
+{
+    if (length == 0)
+        return 0;
+    i32 best_bonus = FUZZY_BONUS_SLASH + FUZZY_BONUS_NAME;
+    i32 best_run_bonus = best_bonus > FUZZY_BONUS_CONSECUTIVE ? best_bonus : FUZZY_BONUS_CONSECUTIVE;
+    return FUZZY_SCORE_MATCH + best_bonus*FUZZY_FIRST_CHAR_MULTIPLIER +
+           (i32)(length - 1)*(FUZZY_SCORE_MATCH + best_run_bonus);
+}
+
+// Each part takes as much of what is left of the query as it has the characters for, up to the first place in the
+// query whose character it doesn't have. Taking as much as possible never leaves the next parts worse off. Places
+// past the end of the query are never allowed, so matched stops at its length, unless it is the full 64 bytes.
+internal inline b32 fuzzy_parts_match(FuzzySearch* search, u32 index)
+{
+    u32* parts = &search->table->part_masks[(size)index*FUZZY_PARTS];
+    u32 matched = 0;
+    for (u32 part = 0; part < FUZZY_PARTS; ++part)
+    {
+        u32 mask = parts[part];
+        u64 allowed = search->part_allows[0][mask & 0xFF] | search->part_allows[1][(mask >> 8) & 0xFF] |
+                      search->part_allows[2][(mask >> 16) & 0xFF] | search->part_allows[3][mask >> 24];
+        u64 rest = ~allowed >> (matched & 63);
+        matched += rest ? fuzzy_lowest_bit(rest) : 64;
+    }
+    return matched >= search->lower_query.len;
+}
+
+internal inline void fuzzy_slice_score(FuzzySlice* slice, u32 index)
+{
+    FuzzySearch* search = slice->search;
+    FuzzyTable* table = search->table;
+    FuzzyPath* path = &table->paths[index];
+    u8* text = table->text + path->offset;
+
+    // Once the heap is full, a path that couldn't beat its worst result even with the best score isn't scored.
+    // Short queries, whose best score many paths reach, mostly stop here.
+    FuzzyResult* heap = slice->worker->heap;
+    if (slice->heap_count == search->max_results)
+    {
+        FuzzyResult best_case = {search->max_score, index, path->length};
+        if (!fuzzy_result_worse(heap[0], best_case))
+            return;
+    }
+
+    i32 score = 0;
+    if (fuzzy_score_path(slice->worker, text, text + path->length, path->length, path->name_offset,
+                         search->lower_query, &score))
+    {
+        ++slice->scored;
+        FuzzyResult result = {score, index, path->length};
+        fuzzy_heap_push(heap, &slice->heap_count, search->max_results, result);
+    }
+}
+
+// How many candidates ahead the text is prefetched, and the entry twice that
+#define FUZZY_PREFETCH_DISTANCE 8
+
+/*
+ * NOTE(lucas): Workers take blocks of FUZZY_BLOCK_PATHS paths in turn until there are none left, rather than a slice
+ * each, so one that starts late or is slowed down only leaves a block behind. The masks are read in order, but the
+ * text of the paths that pass them is scattered over a block far bigger than the cache, so each one would be a miss.
+ * A block of paths is filtered first and its candidates' text is prefetched a few candidates ahead of scoring them.
+ */
+internal void fuzzy_slice_job(void* data)
+{
+    FuzzySlice* slice = (FuzzySlice*)data;
+    FuzzySearch* search = slice->search;
+    FuzzyTable* table = search->table;
+    u64* masks = table->masks;
+    u64 query_mask = search->query_mask;
+    u32* candidates = slice->worker->candidates;
+    slice->heap_count = 0;
+
+    for (;;)
+    {
+        u32 block = atomic_add_u32(&search->next_block, 1) - 1;
+        if (block >= search->block_count)
+            break;
+        if (cancel_token_is_cancelled(search->query->token))
+        {
+            slice->cancelled = true;
+            break;
+        }
+
+        u32 start = block*FUZZY_BLOCK_PATHS;
+        u32 end = table->path_count - start > FUZZY_BLOCK_PATHS ? start + FUZZY_BLOCK_PATHS : table->path_count;
+        u32 candidate_count = 0;
+        u32 i = start;
+#ifdef FUZZY_SSE2
+        // Four masks at a time. A path is a candidate when none of the query's bits are missing from its mask,
+        // which is both 32-bit halves of its lane comparing equal to zero.
+        __m128i wide_mask = _mm_set_epi32((int)(query_mask >> 32), (int)query_mask, (int)(query_mask >> 32),
+                                          (int)query_mask);
+        __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128i low = _mm_andnot_si128(_mm_loadu_si128((__m128i*)(masks + i)), wide_mask);
+            __m128i high = _mm_andnot_si128(_mm_loadu_si128((__m128i*)(masks + i + 2)), wide_mask);
+            u32 hits = (u32)_mm_movemask_epi8(_mm_cmpeq_epi32(low, zero)) |
+                       ((u32)_mm_movemask_epi8(_mm_cmpeq_epi32(high, zero)) << 16);
+            if (!hits)
+                continue;
+            for (u32 k = 0; k < 4; ++k)
+            {
+                if (((hits >> (k*8)) & 0xFF) == 0xFF)
+                    candidates[candidate_count++] = i + k;
+            }
+        }
+#endif
+        for (; i < end; ++i)
+        {
+            if (!(query_mask & ~masks[i]))
+                candidates[candidate_count++] = i;
+        }
+
+        u32 kept = 0;
+        for (u32 k = 0; k < candidate_count; ++k)
+        {
+            candidates[kept] = candidates[k];
+            kept += fuzzy_parts_match(search, candidates[k]);
+        }
+        candidate_count = kept;
+        slice->candidates += candidate_count;
+
+        for (u32 k = 0; k < candidate_count; ++k)
+        {
+#ifdef FUZZY_SSE2
+            if (k + FUZZY_PREFETCH_DISTANCE*2 < candidate_count)
+                _mm_prefetch((char*)&table->paths[candidates[k + FUZZY_PREFETCH_DISTANCE*2]], _MM_HINT_T0);
+            if (k + FUZZY_PREFETCH_DISTANCE < candidate_count)
+            {
+                FuzzyPath* ahead = &table->paths[candidates[k + FUZZY_PREFETCH_DISTANCE]];
+                _mm_prefetch((char*)table->text + ahead->offset + ahead->length, _MM_HINT_T0);
+            }
+#endif
+            fuzzy_slice_score(slice, candidates[k]);
+        }
+    }
+}
+
+FuzzyFindResult fuzzy_find(FuzzyFinder* finder, FuzzyTable* table, FuzzyQuery* query, FuzzyResult* results)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    FuzzyFindResult result = {0};
+    u8 lower_query[FUZZY_MAX_QUERY];
+    size query_length = query->text.len < FUZZY_MAX_QUERY ? query->text.len : FUZZY_MAX_QUERY;
+    for (size i = 0; i < query_length; ++i)
+        lower_query[i] = fuzzy_lower(query->text.data[i]);
+
+    FuzzySearch search = {0};
+    search.table = table;
+    search.query = query;
+    search.lower_query.data = lower_query;
+    search.lower_query.len = query_length;
+    search.query_mask = fuzzy_char_mask(lower_query, query_length);
+    search.max_results = query->max_results;
+    if (search.max_results == 0 || search.max_results > FUZZY_MAX_RESULTS)
+        search.max_results = FUZZY_MAX_RESULTS;
+    search.max_score = fuzzy_max_score(query_length);
+    u64 part_positions[32] = {0};
+    for (size i = 0; i < query_length; ++i)
+        part_positions[count_trailing_zeros_u32(fuzzy_part_bit(lower_query[i]))] |= 1ull << i;
+    for (u32 byte = 0; byte < 4; ++byte)
+    {
+        for (u32 value = 1; value < 256; ++value)
+        {
+            search.part_allows[byte][value] = search.part_allows[byte][value & (value - 1)] |
+                                               part_positions[byte*8 + count_trailing_zeros_u32(value)];
+        }
+    }
+    search.block_count = (table->path_count + FUZZY_BLOCK_PATHS - 1) / FUZZY_BLOCK_PATHS;
+
+    u32 slice_count = finder->worker_count;
+    if (!finder->queue || table->path_count < FUZZY_PARALLEL_MIN_PATHS)
+        slice_count = 1;
+    if (slice_count > search.block_count)
+        slice_count = search.block_count ? search.block_count : 1;
+
+    FuzzySlice slices[64];
+    if (slice_count > countof(slices))
+        slice_count = countof(slices);
+    for (u32 i = 0; i < slice_count; ++i)
+    {
+        FuzzySlice* slice = &slices[i];
+        zero_struct(*slice);
+        slice->search = &search;
+        slice->worker = &finder->workers[i];
+    }
+
+    for (u32 i = 1; i < slice_count; ++i)
+        work_queue_add(finder->queue, fuzzy_slice_job, &slices[i]);
+    fuzzy_slice_job(&slices[0]);
+    if (slice_count > 1)
+        work_queue_complete_all(finder->queue);
+
+    // Everything goes into the first heap, which then comes out worst first
+    FuzzyResult* heap = finder->workers[0].heap;
+    u32 heap_count = slices[0].heap_count;
+    for (u32 i = 0; i < slice_count; ++i)
+    {
+        FuzzySlice* slice = &slices[i];
+        for (u32 j = 0; i > 0 && j < slice->heap_count; ++j)
+            fuzzy_heap_push(heap, &heap_count, search.max_results, slice->worker->heap[j]);
+        result.cancelled |= slice->cancelled;
+        result.candidates += slice->candidates;
+        result.scored += slice->scored;
+    }
+
+    result.result_count = heap_count;
+    while (heap_count)
+    {
+        FuzzyResult worst = fuzzy_heap_pop(heap, &heap_count);
+        results[heap_count] = worst;
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+//
+// Command line
+//
+
+internal void fuzzy_print_error(char* message, char* detail)
+{
+    char buffer[WALK_MAX_PATH + 256];
+    int length = snprintf(buffer, sizeof(buffer), "grapple files: %s%s\n", message, detail);
+    if (length > (int)sizeof(buffer) - 1)
+        length = (int)sizeof(buffer) - 1;
+    if (length > 0)
+        file_write_stream(file_get_stderr(), buffer, length);
+}
+
+int fuzzy_main(int argc, char** argv)
+{
+    WalkOptions options = {0};
+    char* query_text = 0;
+    char* root = ".";
+    u32 positional_count = 0;
+    for (int i = 0; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--hidden") == 0)
+            options.include_hidden = true;
+        else if (strcmp(argv[i], "--no-ignore") == 0)
+            options.no_ignore_files = true;
+        else if (argv[i][0] == '-' || positional_count == 2)
+        {
+            fuzzy_print_error("unexpected argument ", argv[i]);
+            return 2;
+        }
+        else if (positional_count++ == 0)
+            query_text = argv[i];
+        else
+            root = argv[i];
+    }
+    if (!query_text)
+    {
+        fuzzy_print_error("usage: grapple files [--hidden] [--no-ignore] QUERY [PATH]", "");
+        return 2;
+    }
+
+    FuzzyTable table;
+    Arena scratch = arena_alloc(MEGABYTES(64));
+    Arena arena = arena_alloc(MEGABYTES(16));
+    if (!fuzzy_table_create(&table, FUZZY_CLI_MAX_PATHS, 64) || !scratch.data || !arena.data)
+    {
+        fuzzy_print_error("out of memory", "");
+        return 2;
+    }
+    fuzzy_table_add_tree(&table, &scratch, root, &options);
+
+    u32 processor_count = thread_get_processor_count();
+    WorkQueue* queue = work_queue_create(&arena, processor_count > 1 ? processor_count - 1 : 1);
+    FuzzyFinder* finder = fuzzy_finder_create(&arena, queue);
+    FuzzyQuery query = {0};
+    query.text.data = (u8*)query_text;
+    query.text.len = (size)strlen(query_text);
+    query.max_results = FUZZY_CLI_RESULTS;
+    FuzzyResult results[FUZZY_CLI_RESULTS];
+    FuzzyFindResult found = fuzzy_find(finder, &table, &query, results);
+
+    void* out = file_get_stdout();
+    for (u32 i = 0; i < found.result_count; ++i)
+    {
+        s8 path = fuzzy_table_path(&table, results[i].path_index);
+        if (!file_write_stream(out, path.data, path.len) || !file_write_stream(out, "\n", 1))
+            break;
+    }
+    return found.result_count ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "channel.h"
+#include "grapple_memory.h"
+#include "search/walk.h"
+#include "str.h"
+#include "thread.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Go-to-file. Every path in a tree is scored against the query on every keystroke, so the paths are
+ * kept in one block laid out for that: an array of entries, an array of character masks, and the text, where each
+ * path is followed by its lowercase copy. The entries say where the path's name starts.
+ *
+ * Most paths are rejected by their mask, a bit for each letter and digit they contain (and a bit shared by a few
+ * other bytes), without touching their text. Many of the rest have the query's characters in the wrong order, and
+ * are rejected by a mask for each quarter of the path: the query has to split into FUZZY_PARTS runs that are in
+ * each quarter in turn. Only then is the text checked for the query as a subsequence with SSE2, and only paths that
+ * have it are scored. Scoring is Smith-Waterman over the part of the path between the first place the
+ * query could start and the last place it could end: matches score, gaps cost, and matches after a slash, a
+ * separator or a case change, in a run, or in the file name score extra.
+ *
+ * Workers take blocks of the table in turn, each scoring into its own top-K heap, and the heaps are merged at the
+ * end. Once a heap is full, paths that couldn't beat its worst result even with a perfect score are skipped.
+ */
+
+#define FUZZY_MAX_QUERY 64
+#define FUZZY_MAX_RESULTS 256
+#define FUZZY_PARALLEL_MIN_PATHS 16384 // Fewer are scored on the calling thread alone
+#define FUZZY_PARTS 4 // Quarters of a path with a mask each
+#define FUZZY_CLI_MAX_PATHS (1u << 22)
+#define FUZZY_CLI_RESULTS 20
+
+typedef struct
+{
+    u64 offset;      // Into the text, where the path is followed by its lowercase copy
+    u32 length;
+    u32 name_offset; // Where the last component starts
+} FuzzyPath;
+
+typedef struct
+{
+    Arena block;
+    FuzzyPath* paths;
+    u64* masks;
+    u32* part_masks; // FUZZY_PARTS per path, with a bit per letter and the rest folded together
+    u8* text;
+    u32 path_count;
+    u32 max_paths;
+    u64 text_used;
+    u64 text_capacity;
+} FuzzyTable;
+
+typedef struct
+{
+    i32 score;
+    u32 path_index;
+    u32 path_length; // Breaks ties, shorter first
+} FuzzyResult;
+
+typedef struct
+{
+    s8 text; // Case-insensitive, at most FUZZY_MAX_QUERY bytes
+    u32 max_results; // At most FUZZY_MAX_RESULTS, which is what 0 means
+    CancelToken* token; // Optional
+} FuzzyQuery;
+
+typedef struct
+{
+    u32 result_count;
+    b32 cancelled;
+    u64 candidates; // Paths that got past the masks
+    u64 scored;     // Candidates that had the query as a subsequence and could still make the results
+} FuzzyFindResult;
+
+typedef struct
+{
+    i32* rows; // Two rows of match and best scores for the dynamic programming
+    FuzzyResult* heap;
+    u32* candidates; // Of the block of paths being scored
+} FuzzyWorker;
+
+typedef struct
+{
+    WorkQueue* queue; // Optional
+    u32 worker_count;
+    FuzzyWorker* workers; // The first one belongs to the thread calling fuzzy_find
+} FuzzyFinder;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Reserves room for max_paths paths averaging up to average_length bytes. Pages are committed as they are used.
+b32 fuzzy_table_create(FuzzyTable* table, u32 max_paths, u32 average_length);
+void fuzzy_table_clear(FuzzyTable* table);
+s8 fuzzy_table_path(FuzzyTable* table, u32 index);
+
+// Returns false once the table is full
+b32 fuzzy_table_add(FuzzyTable* table, s8 path);
+
+// Adds every file walk_tree finds under root, relative to it
+WalkStats fuzzy_table_add_tree(FuzzyTable* table, Arena* scratch, char* root, WalkOptions* options);
+
+FuzzyFinder* fuzzy_finder_create(Arena* arena, WorkQueue* queue);
+
+// Writes the best matches to results, best first. results needs room for query->max_results.
+FuzzyFindResult fuzzy_find(FuzzyFinder* finder, FuzzyTable* table, FuzzyQuery* query, FuzzyResult* results);
+
+// Scores one path on its own, returning false if the query isn't a subsequence of it
+b32 fuzzy_score(FuzzyWorker* worker, s8 path, s8 query, i32* score);
+
+// "grapple files [--hidden] [--no-ignore] QUERY [PATH]". argv starts after "files". Prints the paths under PATH that
+// best match QUERY, best first. Returns 0 if any did, 1 if none did, and 2 on bad arguments.
+int fuzzy_main(int argc, char** argv);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,345 @@
+#include "search/ignore.h"
+
+#include <string.h> // memcpy
+
+#define IGNORE_INITIAL_KEYS 64
+
+b32 ignore_matcher_init(IgnoreMatcher* matcher, Arena* arena)
+{
+    matcher->arena = arena;
+    zero_struct(matcher->rules);
+    zero_struct(matcher->globs);
+    return ignore_key_map_init(&matcher->names, arena, IGNORE_INITIAL_KEYS) &&
+           ignore_key_map_init(&matcher->extensions, arena, IGNORE_INITIAL_KEYS);
+}
+
+internal inline b32 ignore_has_wildcards(s8 pattern)
+{
+    for (size i = 0; i < pattern.len; ++i)
+    {
+        u8 c = pattern.data[i];
+        if (c == '*' || c == '?' || c == '[' || c == '\\')
+            return true;
+    }
+    return false;
+}
+
+internal inline b32 ignore_contains(s8 str, u8 c)
+{
+    return str.len > 0 && memchr(str.data, c, (usize)str.len) != 0;
+}
+
+internal b32 ignore_add_key(IgnoreKeyMap* map, s8 key, i32 index, b32 dir_only)
+{
+    IgnoreHit* hit = ignore_key_map_get(map, key);
+    if (!hit)
+    {
+        IgnoreHit empty = {-1, -1};
+        hit = ignore_key_map_put(map, key, empty);
+        if (!hit)
+            return false;
+    }
+    if (dir_only)
+        hit->dir_only = index;
+    else
+        hit->any = index;
+    return true;
+}
+
+b32 ignore_add_rule(IgnoreMatcher* matcher, s8 line)
+{
+    u8* p = line.data;
+    size n = line.len;
+    if (n > 0 && p[n - 1] == '\r')
+        --n;
+    if (n == 0 || p[0] == '#')
+        return true;
+
+    // Trailing spaces don't count unless they are escaped
+    while (n > 0 && p[n - 1] == ' ' && !(n > 1 && p[n - 2] == '\\'))
+        --n;
+
+    u32 flags = 0;
+    if (n > 0 && p[0] == '!')
+    {
+        flags |= IGNORE_RULE_NEGATED;
+        ++p;
+        --n;
+    }
+    else if (n > 1 && p[0] == '\\' && (p[1] == '!' || p[1] == '#'))
+    {
+        ++p;
+        --n;
+    }
+
+    if (n > 0 && p[n - 1] == '/')
+    {
+        flags |= IGNORE_RULE_DIR_ONLY;
+        --n;
+    }
+
+    // A slash anywhere but the end ties the rule to this directory. A leading "**/" undoes that again.
+    s8 pattern = {p, n};
+    if (ignore_contains(pattern, '/'))
+        flags |= IGNORE_RULE_ANCHORED;
+    if (n > 0 && p[0] == '/')
+    {
+        ++p;
+        --n;
+    }
+    else if (n > 3 && p[0] == '*' && p[1] == '*' && p[2] == '/')
+    {
+        s8 rest = {p + 3, n - 3};
+        if (!ignore_contains(rest, '/'))
+        {
+            flags &= ~(u32)IGNORE_RULE_ANCHORED;
+            p += 3;
+            n -= 3;
+        }
+    }
+    if (n == 0)
+        return true;
+
+    s8 copy = s8_alloc(matcher->arena, n);
+    IgnoreRule* rule = array_push(matcher->arena, &matcher->rules);
+    if (!copy.data || !rule)
+        return false;
+    memcpy(copy.data, p, (usize)n);
+    rule->pattern = copy;
+    rule->flags = flags;
+
+    i32 index = (i32)(matcher->rules.count - 1);
+    b32 dir_only = (flags & IGNORE_RULE_DIR_ONLY) != 0;
+    if (!(flags & IGNORE_RULE_ANCHORED))
+    {
+        if (!ignore_has_wildcards(copy))
+            return ignore_add_key(&matcher->names, copy, index, dir_only);
+
+        s8 extension = {copy.data + 1, copy.len - 1};
+        if (copy.data[0] == '*' && extension.len > 1 && extension.data[0] == '.' && !ignore_has_wildcards(extension) &&
+            !ignore_contains((s8){extension.data + 1, extension.len - 1}, '.'))
+        {
+            return ignore_add_key(&matcher->extensions, extension, index, dir_only);
+        }
+    }
+
+    i32* glob = array_push(matcher->arena, &matcher->globs);
+    if (!glob)
+        return false;
+    *glob = index;
+    return true;
+}
+
+b32 ignore_add_rules(IgnoreMatcher* matcher, s8 text)
+{
+    size start = 0;
+    for (size i = 0; i <= text.len; ++i)
+    {
+        if (i == text.len || text.data[i] == '\n')
+        {
+            s8 line = {text.data + start, i - start};
+            if (!ignore_add_rule(matcher, line))
+                return false;
+            start = i + 1;
+        }
+    }
+    return true;
+}
+
+internal inline i32 ignore_hit_index(IgnoreKeyMap* map, s8 key, b32 is_dir)
+{
+    IgnoreHit* hit = ignore_key_map_get(map, key);
+    if (!hit)
+        return -1;
+    return (is_dir && hit->dir_only > hit->any) ? hit->dir_only : hit->any;
+}
+
+IgnoreMatch ignore_match(IgnoreMatcher* matcher, s8 path, s8 name, b32 is_dir)
+{
+    i32 best = ignore_hit_index(&matcher->names, name, is_dir);
+
+    // The extension starts at the last dot, which may be the first character of a name like ".env"
+    for (size i = name.len; i > 0; --i)
+    {
+        if (name.data[i - 1] == '.')
+        {
+            s8 extension = {name.data + i - 1, name.len - i + 1};
+            i32 index = ignore_hit_index(&matcher->extensions, extension, is_dir);
+            if (index > best)
+                best = index;
+            break;
+        }
+    }
+
+    // Later rules win, so the first glob that matches going backwards is the last one that matches
+    for (size i = matcher->globs.count; i > 0; --i)
+    {
+        i32 index = matcher->globs.data[i - 1];
+        if (index <= best)
+            break;
+        IgnoreRule* rule = &matcher->rules.data[index];
+        if ((rule->flags & IGNORE_RULE_DIR_ONLY) && !is_dir)
+            continue;
+        s8 text = (rule->flags & IGNORE_RULE_ANCHORED) ? path : name;
+        if (ignore_glob_match(rule->pattern, text))
+        {
+            best = index;
+            break;
+        }
+    }
+
+    if (best < 0)
+        return IgnoreMatch_None;
+    return (matcher->rules.data[best].flags & IGNORE_RULE_NEGATED) ? IgnoreMatch_Include : IgnoreMatch_Ignore;
+}
+
+//
+// Globs
+//
+
+// Matches c against the class starting at pattern[*pos] == '['. Moves *pos past the class, or returns -1 if the
+// class isn't closed, in which case the '[' is an ordinary character.
+internal i32 ignore_match_class(u8* pattern, size pattern_size, size* pos, u8 c)
+{
+    size i = *pos + 1;
+    b32 negated = false;
+    if (i < pattern_size && (pattern[i] == '!' || pattern[i] == '^'))
+    {
+        negated = true;
+        ++i;
+    }
+
+    b32 matched = false;
+    size first = i;
+    while (i < pattern_size && (pattern[i] != ']' || i == first))
+    {
+        u8 low = pattern[i];
+        if (low == '\\' && i + 1 < pattern_size)
+            low = pattern[++i];
+        u8 high = low;
+        if (i + 2 < pattern_size && pattern[i + 1] == '-' && pattern[i + 2] != ']')
+        {
+            high = pattern[i + 2];
+            if (high == '\\' && i + 3 < pattern_size)
+                high = pattern[++i + 2];
+            i += 2;
+        }
+        if (c >= low && c <= high)
+            matched = true;
+        ++i;
+    }
+    if (i >= pattern_size)
+        return -1;
+
+    *pos = i + 1;
+    return (matched != negated) ? 1 : 0;
+}
+
+/*
+ * NOTE(lucas): The usual backtracking wildcard match, which only ever needs to go back to the most recent '*'. A '*'
+ * can't cross a slash, so once the text has moved past one, no earlier '*' could have matched differently. "**"
+ * does cross slashes and is tried at every position left, which is fine because it only appears at the start of
+ * a path component.
+ */
+b32 ignore_glob_match(s8 glob, s8 text)
+{
+    u8* p = glob.data;
+    size pn = glob.len;
+    u8* t = text.data;
+    size tn = text.len;
+    size pi = 0;
+    size ti = 0;
+    size star_pi = -1;
+    size star_ti = 0;
+
+    while (ti < tn || pi < pn)
+    {
+        if (pi < pn)
+        {
+            u8 c = p[pi];
+            if (c == '*')
+            {
+                b32 double_star = pi + 1 < pn && p[pi + 1] == '*' && (pi == 0 || p[pi - 1] == '/') &&
+                                  (pi + 2 == pn || p[pi + 2] == '/');
+                if (double_star)
+                {
+                    // "**" at the end matches everything left. "**/" matches zero or more whole directories.
+                    if (pi + 2 == pn)
+                        return true;
+                    s8 rest = {p + pi + 3, pn - pi - 3};
+                    for (size k = ti; k <= tn; ++k)
+                    {
+                        if (k == ti || t[k - 1] == '/')
+                        {
+                            s8 tail = {t + k, tn - k};
+                            if (ignore_glob_match(rest, tail))
+                                return true;
+                        }
+                    }
+                    return false;
+                }
+
+                star_pi = ++pi;
+                star_ti = ti;
+                continue;
+            }
+
+            if (ti < tn)
+            {
+                if (c == '?' && t[ti] != '/')
+                {
+                    ++pi;
+                    ++ti;
+                    continue;
+                }
+                if (c == '[' && t[ti] != '/')
+                {
+                    size class_end = pi;
+                    i32 matched = ignore_match_class(p, pn, &class_end, t[ti]);
+                    if (matched == 1)
+                    {
+                        pi = class_end;
+                        ++ti;
+                        continue;
+                    }
+                    if (matched == 0)
+                        goto mismatch;
+                }
+                if (c == '\\' && pi + 1 < pn)
+                {
+                    if (p[pi + 1] == t[ti])
+                    {
+                        pi += 2;
+                        ++ti;
+                        continue;
+                    }
+                    goto mismatch;
+                }
+                if (c == t[ti] && c != '?' && c != '[')
+                {
+                    ++pi;
+                    ++ti;
+                    continue;
+                }
+                if (c == '[' && t[ti] == '[')
+                {
+                    ++pi;
+                    ++ti;
+                    continue;
+                }
+            }
+        }
+
+    mismatch:
+        // Let the last '*' take one more character, as long as that isn't a slash
+        if (star_pi >= 0 && star_ti < tn && t[star_ti] != '/')
+        {
+            ++star_ti;
+            ti = star_ti;
+            pi = star_pi;
+            continue;
+        }
+        return false;
+    }
+    return true;
+}
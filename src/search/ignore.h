@@ -0,0 +1,78 @@
+#pragma once
+
+#include "containers.h"
+#include "grapple_memory.h"
+#include "str.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Ignore rules in .gitignore syntax, compiled so that testing a path doesn't walk every rule.
+ *
+ * Rules without wildcards that match a bare name go in a hash set keyed by the name, and "*.ext" rules go in one
+ * keyed by the extension, so the common cases ("node_modules/", "*.o") cost two lookups however many of them there
+ * are. Anything else is kept as a glob and tried from the last rule back, stopping as soon as no remaining rule
+ * could beat what the sets found. As in git, the last matching rule wins, and a "!" rule includes what an earlier
+ * one ignored.
+ *
+ * A matcher holds the rules of one directory and paths are given to it relative to that directory. Nesting is up
+ * to the caller (see walk.h).
+ */
+
+#define IGNORE_RULE_NEGATED  (1 << 0) // "!pattern": include what an earlier rule ignored
+#define IGNORE_RULE_DIR_ONLY (1 << 1) // "pattern/": only matches directories
+#define IGNORE_RULE_ANCHORED (1 << 2) // Has a slash, so it matches the whole relative path instead of the name
+
+typedef struct
+{
+    s8 pattern;
+    u32 flags;
+} IgnoreRule;
+
+// The last rule with the key, for any entry and for directories only, or -1
+typedef struct
+{
+    i32 any;
+    i32 dir_only;
+} IgnoreHit;
+
+HASH_MAP_DEFINE(IgnoreKeyMap, ignore_key_map, s8, IgnoreHit, s8_hash, s8_equal)
+ARRAY_TYPE(IgnoreRuleArray, IgnoreRule);
+ARRAY_TYPE(IgnoreIndexArray, i32);
+
+typedef struct
+{
+    Arena* arena;
+    IgnoreRuleArray rules;
+    IgnoreKeyMap names;      // Unanchored rules without wildcards
+    IgnoreKeyMap extensions; // Unanchored "*.ext" rules, keyed by ".ext"
+    IgnoreIndexArray globs;  // Every other rule, in file order
+} IgnoreMatcher;
+
+typedef enum
+{
+    IgnoreMatch_None = 0, // No rule says anything about the path
+    IgnoreMatch_Ignore,
+    IgnoreMatch_Include,  // Matched a "!" rule
+} IgnoreMatch;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Rules, patterns and tables all go in arena, which has to outlive the matcher
+b32 ignore_matcher_init(IgnoreMatcher* matcher, Arena* arena);
+
+// Adds one line, which may be blank or a comment. Returns false if the arena ran out.
+b32 ignore_add_rule(IgnoreMatcher* matcher, s8 line);
+b32 ignore_add_rules(IgnoreMatcher* matcher, s8 text);
+
+// path is relative to the matcher's directory and uses '/'. name is its last component.
+IgnoreMatch ignore_match(IgnoreMatcher* matcher, s8 path, s8 name, b32 is_dir);
+
+// Matches a whole string against a glob: '*' and '?' don't match '/', "**" between slashes matches any number of
+// directories, and [a-z] and [!a-z] are character classes
+b32 ignore_glob_match(s8 pattern, s8 text);
+
+#ifdef __cplusplus
+}
+#endif
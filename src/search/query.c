@@ -0,0 +1,320 @@
+#include "atomic.h"
+#include "channel.h"
+#include "profiler.h"
+#include "search/query.h"
+#include "search/search.h"
+#include "thread.h"
+
+#include <string.h> // memcpy, memset
+
+internal QueryExecutor* query_executor_init(Arena* arena, QueryCorpus* corpus, WorkQueue* queue, Channel* results,
+                                           QueryExecutor* shared)
+{
+    arena_align(arena, 16);
+    QueryExecutor* executor = push_struct(arena, QueryExecutor);
+    zero_struct(*executor);
+    executor->results = results;
+    executor->queue = queue;
+    executor->worker_count = queue ? queue->thread_count + 1 : 1;
+    executor->workers = push_array(arena, executor->worker_count, QueryWorker);
+    executor->wake = semaphore_create(arena, 0);
+
+    // Files are searched one per worker at a time, so each worker gets a context of its own without a queue
+    for (u32 i = 0; i < executor->worker_count; ++i)
+    {
+        QueryWorker* worker = &executor->workers[i];
+        zero_struct(*worker);
+        worker->executor = executor;
+        worker->index = i;
+        worker->context = shared ? shared->workers[i].context : search_context_create(arena, 0);
+    }
+
+    query_executor_set_corpus(executor, arena, corpus);
+    return executor;
+}
+
+QueryExecutor* query_executor_create(Arena* arena, QueryCorpus* corpus, WorkQueue* queue, Channel* results)
+{
+    return query_executor_init(arena, corpus, queue, results, 0);
+}
+
+QueryExecutor* query_executor_create_shared(Arena* arena, QueryCorpus* corpus, QueryExecutor* shared)
+{
+    return query_executor_init(arena, corpus, shared->queue, 0, shared);
+}
+
+void query_executor_set_corpus(QueryExecutor* executor, Arena* arena, QueryCorpus* corpus)
+{
+    executor->corpus = *corpus;
+    executor->matched = push_array(arena, corpus->file_count + 1, u8);
+    memset(executor->matched, 0, (usize)corpus->file_count + 1);
+
+    // NOTE(lucas): Arenas only commit what is used, so a history arena is replaced only when the corpus outgrows
+    // it, and the old reservation is left behind
+    size history_size = (size)corpus->file_count*(size)sizeof(u32) + KILOBYTES(4);
+    for (u32 i = 0; i < QUERY_HISTORY; ++i)
+    {
+        QueryHistoryEntry* entry = &executor->history[i];
+        entry->used = false;
+        if (entry->arena.bytes < history_size)
+            entry->arena = arena_alloc(history_size);
+    }
+}
+
+//
+// Running
+//
+
+internal void query_worker_match(SearchMatch* match, void* data)
+{
+    QueryWorker* worker = (QueryWorker*)data;
+    QueryExecutor* executor = worker->executor;
+    if (executor->sink)
+    {
+        executor->sink(executor, worker->index, match, executor->sink_data);
+        return;
+    }
+    if (!executor->results)
+        return;
+
+    QueryMatch* item = worker->batch ? (QueryMatch*)channel_batch_push(worker->batch) : 0;
+    if (!item && !cancel_token_is_cancelled(executor->query.token))
+    {
+        if (worker->batch)
+            channel_publish(executor->results, worker->batch);
+        worker->batch = channel_acquire(executor->results, executor->query.token);
+        item = worker->batch ? (QueryMatch*)channel_batch_push(worker->batch) : 0;
+    }
+    if (item)
+    {
+        item->match = *match;
+        item->generation = executor->generation;
+    }
+}
+
+internal void query_worker_job(void* data)
+{
+    QueryWorker* worker = (QueryWorker*)data;
+    QueryExecutor* executor = worker->executor;
+    QueryCorpus* corpus = &executor->corpus;
+    SearchQuery query = executor->query;
+    query.on_match = query_worker_match;
+    query.match_data = worker;
+    zero_struct(worker->stats);
+    worker->batch = 0;
+
+    while (!cancel_token_is_cancelled(query.token))
+    {
+        u32 next = atomic_add_u32(&executor->next_file, 1) - 1;
+        if (next >= executor->run_file_count)
+            break;
+
+        u32 file = executor->run_files ? executor->run_files[next] : next;
+        SearchFileResult result;
+        if (corpus->contents)
+            result = search_memory(worker->context, &query, corpus->contents[file].data, corpus->contents[file].len,
+                                   file);
+        else
+            result = search_file(worker->context, &query, corpus->paths[file], file);
+
+        ++worker->stats.files_searched;
+        worker->stats.bytes_searched += result.bytes_searched;
+        worker->stats.match_count += result.match_count;
+        if (result.match_count)
+        {
+            executor->matched[file] = 1;
+            ++worker->stats.files_matched;
+        }
+    }
+
+    if (worker->batch)
+        channel_publish(executor->results, worker->batch);
+    worker->batch = 0;
+    if (executor->sink)
+        executor->sink(executor, worker->index, 0, executor->sink_data);
+}
+
+// The completed query with the fewest files whose needle is inside this one, or 0
+internal QueryHistoryEntry* query_find_base(QueryExecutor* executor, s8 needle)
+{
+    QueryHistoryEntry* result = 0;
+    for (u32 i = 0; i < QUERY_HISTORY; ++i)
+    {
+        QueryHistoryEntry* entry = &executor->history[i];
+        if (entry->used && entry->needle_length <= needle.len &&
+            (!result || entry->file_count < result->file_count) &&
+            search_find(needle.data, needle.len, (s8){entry->needle, entry->needle_length}))
+        {
+            result = entry;
+        }
+    }
+    return result;
+}
+
+// Keeps the files the query matched, in the least recently used entry other than its base
+internal void query_remember(QueryExecutor* executor, s8 needle, QueryHistoryEntry* base)
+{
+    QueryHistoryEntry* entry = 0;
+    for (u32 i = 0; i < QUERY_HISTORY; ++i)
+    {
+        QueryHistoryEntry* candidate = &executor->history[i];
+        if (candidate != base && (!entry || !candidate->used || (entry->used &&
+                                                                  candidate->last_used < entry->last_used)))
+            entry = candidate;
+    }
+
+    arena_clear(&entry->arena);
+    entry->files = push_array(&entry->arena, executor->run_file_count, u32);
+    entry->file_count = 0;
+    for (u32 i = 0; i < executor->run_file_count; ++i)
+    {
+        u32 file = executor->run_files ? executor->run_files[i] : i;
+        if (executor->matched[file])
+            entry->files[entry->file_count++] = file;
+    }
+    memcpy(entry->needle, needle.data, (usize)needle.len);
+    entry->needle_length = needle.len;
+    entry->last_used = executor->runs;
+    entry->used = true;
+}
+
+QueryStats query_run(QueryExecutor* executor, s8 needle, CancelToken* token, u32 generation)
+{
+    QueryStats result;
+    zero_struct(result);
+    result.generation = generation;
+    if (atomic_load_u32(&executor->forget))
+    {
+        atomic_store_u32(&executor->forget, 0);
+        for (u32 i = 0; i < QUERY_HISTORY; ++i)
+            executor->history[i].used = false;
+    }
+    if (needle.len <= 0)
+        return result;
+
+    PROFILE_FUNCTION_BEGIN();
+
+    ++executor->runs;
+    QueryHistoryEntry* base = query_find_base(executor, needle);
+    if (base)
+        base->last_used = executor->runs;
+    result.refined = (base != 0);
+
+    zero_struct(executor->query);
+    executor->query.needle = needle;
+    executor->query.token = token;
+    executor->generation = generation;
+    executor->run_files = base ? base->files : 0;
+    executor->run_file_count = base ? base->file_count : executor->corpus.file_count;
+    atomic_store_u32(&executor->next_file, 0);
+
+    for (u32 i = 1; i < executor->worker_count; ++i)
+        work_queue_add(executor->queue, query_worker_job, &executor->workers[i]);
+    query_worker_job(&executor->workers[0]);
+    if (executor->queue)
+        work_queue_complete_all(executor->queue);
+
+    for (u32 i = 0; i < executor->worker_count; ++i)
+    {
+        QueryStats* stats = &executor->workers[i].stats;
+        result.files_searched += stats->files_searched;
+        result.files_matched += stats->files_matched;
+        result.bytes_searched += stats->bytes_searched;
+        result.match_count += stats->match_count;
+    }
+
+    // NOTE(lucas): A cancelled query didn't see all of its files, so it can't stand in for them later. A query with
+    // the same needle as its base matched the same files, so there is nothing new to keep.
+    result.cancelled = cancel_token_is_cancelled(token);
+    s8 base_needle = base ? (s8){base->needle, base->needle_length} : s8("");
+    if (!result.cancelled && !s8_equal(base_needle, needle))
+        query_remember(executor, needle, base);
+
+    for (u32 i = 0; i < executor->run_file_count; ++i)
+        executor->matched[executor->run_files ? executor->run_files[i] : i] = 0;
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+//
+// Executor thread
+//
+
+b32 query_executor_step(QueryExecutor* executor)
+{
+    u8 needle[SEARCH_MAX_NEEDLE];
+    for (;;)
+    {
+        u32 generation = atomic_load_u32(&executor->submitted);
+        if (generation == executor->started)
+            return false;
+
+        QueryRequest* request = &executor->requests[generation % QUERY_REQUESTS];
+        size needle_length = request->needle_length;
+        memcpy(needle, request->needle, (usize)needle_length);
+
+        /*
+         * NOTE(lucas): The slot is only written again QUERY_REQUESTS submits later, so if nothing was submitted
+         * while it was copied, the copy is whole. Its token was cancelled when the slot was last used, or is
+         * being cancelled now because this query was superseded. The exchange reads whichever it is, so if it
+         * was the second, the newer generation is seen below and this one is skipped. If it was the first, the
+         * coming cancel lands after the reset.
+         */
+        atomic_compare_exchange_u32(&request->token.cancelled, 1, 0);
+        if (atomic_load_u32(&executor->submitted) != generation)
+            continue;
+
+        executor->started = generation;
+        executor->stats = query_run(executor, (s8){needle, needle_length}, &request->token, generation);
+        atomic_store_u32(&executor->completed, generation);
+        return true;
+    }
+}
+
+internal void query_executor_thread(void* data)
+{
+    QueryExecutor* executor = (QueryExecutor*)data;
+    for (;;)
+    {
+        // Submits signal once each, so by the time a wait returns there may be nothing left to do
+        semaphore_wait(executor->wake);
+        while (query_executor_step(executor))
+            ;
+    }
+}
+
+b32 query_executor_start(QueryExecutor* executor)
+{
+    return thread_create(query_executor_thread, executor);
+}
+
+u32 query_submit(QueryExecutor* executor, s8 needle)
+{
+    u32 generation = executor->submitted + 1;
+    QueryRequest* request = &executor->requests[generation % QUERY_REQUESTS];
+    request->needle_length = (needle.len < (size)SEARCH_MAX_NEEDLE) ? needle.len : (size)SEARCH_MAX_NEEDLE;
+    memcpy(request->needle, needle.data, (usize)request->needle_length);
+
+    atomic_store_u32(&executor->submitted, generation);
+    CancelToken* last = &executor->requests[(generation - 1) % QUERY_REQUESTS].token;
+    if (executor->results)
+        channel_cancel(executor->results, last);
+    else
+        cancel_token_cancel(last);
+    semaphore_signal(executor->wake);
+    return generation;
+}
+
+b32 query_is_done(QueryExecutor* executor, u32 generation, QueryStats* stats)
+{
+    b32 result = atomic_load_u32(&executor->completed) == generation;
+    if (result && stats)
+        *stats = executor->stats;
+    return result;
+}
+
+void query_forget(QueryExecutor* executor)
+{
+    atomic_store_u32(&executor->forget, 1);
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "channel.h"
+#include "grapple_memory.h"
+#include "search/search.h"
+#include "str.h"
+#include "thread.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Search as you type. Every keystroke submits a query, which cancels the one before it. The executor's
+ * thread picks up the newest query, skipping any that were superseded before they started, and hands its files out
+ * to the workers one at a time. Work that is superseded stops at the next check of its token: before every file,
+ * and every SEARCH_CHUNK_SIZE bytes inside one, so within a few milliseconds however big the corpus is.
+ *
+ * A file that contains a needle contains every part of it. So a query only has to search the files matched by an
+ * earlier query whose needle is inside its own, as long as that query ran to the end. The last QUERY_HISTORY such
+ * queries are kept with the files they matched, and each query starts from the one with the fewest. Typing narrows
+ * the files searched with every letter, and deleting letters goes back to sets that are already known. The files
+ * are still searched from start to end, so a refinement costs what its candidates cost, not what the corpus does.
+ *
+ * The history assumes the files haven't changed since. query_forget drops it when they have.
+ */
+
+#define QUERY_HISTORY 8
+#define QUERY_REQUESTS 4 // Submitted queries the executor may still be reading. Tokens are reused after this many.
+
+typedef struct
+{
+    char** paths;
+    s8* contents; // Optional. Files already in memory, such as unsaved buffers, searched instead of reading paths.
+    u32 file_count;
+} QueryCorpus;
+
+// What the executor publishes to its channel. Batches of cancelled queries are dropped when the channel is drained,
+// but once tokens are reused a stale batch can get through, so items whose generation isn't the latest are skipped.
+typedef struct
+{
+    SearchMatch match; // file_index is the file's index in the corpus
+    u32 generation;
+} QueryMatch;
+
+typedef struct
+{
+    u32 generation;
+    b32 cancelled;
+    b32 refined;        // Searched only the files of an earlier query
+    u32 files_searched;
+    u32 files_matched;
+    u64 bytes_searched;
+    u64 match_count;
+} QueryStats;
+
+typedef struct
+{
+    u8 needle[SEARCH_MAX_NEEDLE];
+    size needle_length;
+    CancelToken token;
+} QueryRequest;
+
+// A query that ran to the end and the files it matched, in corpus order
+typedef struct
+{
+    u8 needle[SEARCH_MAX_NEEDLE];
+    size needle_length;
+    b32 used;
+    u32 last_used;
+    Arena arena;
+    u32* files;
+    u32 file_count;
+} QueryHistoryEntry;
+
+typedef struct QueryExecutor QueryExecutor;
+
+// Called on the worker that found the match, and with match 0 once the worker has run out of files, so matches can
+// be gathered per worker and passed on in batches
+typedef void QueryMatchSink(QueryExecutor* executor, u32 worker, SearchMatch* match, void* data);
+
+typedef struct
+{
+    QueryExecutor* executor;
+    u32 index;
+    SearchContext* context;
+    ChannelBatch* batch;
+    QueryStats stats;
+} QueryWorker;
+
+struct QueryExecutor
+{
+    QueryCorpus corpus;
+    Channel* results;
+    QueryMatchSink* sink; // Optional, and used instead of results
+    void* sink_data;
+    WorkQueue* queue;
+    u32 worker_count;
+    QueryWorker* workers;
+    Semaphore* wake; // May be replaced before any submit, to share one between executors stepped by one thread
+
+    // Written by the thread that submits queries
+    volatile u32 submitted;
+    volatile u32 forget;
+    QueryRequest requests[QUERY_REQUESTS];
+
+    // Written by the executor. stats belong to the completed generation.
+    volatile u32 completed;
+    QueryStats stats;
+    u32 started;
+    u32 runs;
+    QueryHistoryEntry history[QUERY_HISTORY];
+
+    // The query being run, for the workers
+    SearchQuery query;
+    u32 generation;
+    u32* run_files; // 0 for every file in the corpus
+    u32 run_file_count;
+    volatile u32 next_file;
+    u8* matched; // Per file in the corpus, set by whichever worker searched it
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// queue and results are optional. Once the executor's thread is started, only it adds work to the queue. results is
+// a multi-producer channel of QueryMatch items, and without one matches are only counted.
+QueryExecutor* query_executor_create(Arena* arena, QueryCorpus* corpus, WorkQueue* queue, Channel* results);
+b32 query_executor_start(QueryExecutor* executor);
+
+// Shares the queue and the workers' search contexts of another executor, without results. Only for executors that
+// are never run at the same time, such as several stepped by one thread.
+QueryExecutor* query_executor_create_shared(Arena* arena, QueryCorpus* corpus, QueryExecutor* shared);
+
+// Runs the newest submitted query if it hasn't been run, on the calling thread. Returns false if there was none. For
+// a thread that serves several executors instead of each having its own.
+b32 query_executor_step(QueryExecutor* executor);
+
+// Swaps in a new corpus and drops the history, which was of the old one. Only call between queries.
+void query_executor_set_corpus(QueryExecutor* executor, Arena* arena, QueryCorpus* corpus);
+
+// For the thread that owns the executor. needle is copied, cut to SEARCH_MAX_NEEDLE bytes. Returns its generation.
+u32 query_submit(QueryExecutor* executor, s8 needle);
+
+// Returns true once generation has finished, copying its stats, which stay valid until the next submit
+b32 query_is_done(QueryExecutor* executor, u32 generation, QueryStats* stats);
+
+// Drops the history before the next query, for when files have changed
+void query_forget(QueryExecutor* executor);
+
+// Runs a query on the calling thread, for callers that drive an executor that wasn't started
+QueryStats query_run(QueryExecutor* executor, s8 needle, CancelToken* token, u32 generation);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,249 @@
+#include "file.h"
+#include "grapple_memory.h"
+#include "profiler.h"
+#include "search/replace.h"
+#include "search/search.h"
+
+#include <string.h> // memcpy
+
+#define REPLACE_MAX_PATH 4096
+
+typedef struct
+{
+    ReplaceWorker* worker;
+    ReplaceQuery* query;
+    ReplaceFileResult* result;
+    char* filename;
+    void* in;
+    void* out; // Created at the first match
+    char out_path[REPLACE_MAX_PATH];
+    b32 failed;
+
+    u64 chunk_start; // Offset of the first byte of the read buffer
+    u64 copied;      // Everything before this has been written, or is a match that has been replaced
+    size write_used;
+} ReplaceStream;
+
+ReplaceWorker* replace_worker_create(Arena* arena)
+{
+    ReplaceWorker* worker = push_struct(arena, ReplaceWorker);
+    zero_struct(*worker);
+    worker->arena = arena_alloc(SEARCH_CHUNK_SIZE + REPLACE_WRITE_SIZE);
+    worker->read_buffer = push_array(&worker->arena, SEARCH_CHUNK_SIZE, u8);
+    worker->write_buffer = push_array(&worker->arena, REPLACE_WRITE_SIZE, u8);
+    return worker;
+}
+
+internal void replace_flush(ReplaceStream* stream)
+{
+    if (stream->write_used && !stream->failed)
+        stream->failed = !file_write_stream(stream->out, stream->worker->write_buffer, stream->write_used);
+    stream->write_used = 0;
+}
+
+internal void replace_write(ReplaceStream* stream, u8* data, size length)
+{
+    if (stream->write_used + length > (size)REPLACE_WRITE_SIZE)
+    {
+        replace_flush(stream);
+        if (length > (size)REPLACE_WRITE_SIZE)
+        {
+            if (!stream->failed)
+                stream->failed = !file_write_stream(stream->out, data, length);
+            return;
+        }
+    }
+    memcpy(stream->worker->write_buffer + stream->write_used, data, (usize)length);
+    stream->write_used += length;
+}
+
+// Writes the old file's bytes from where the last match ended up to end
+internal void replace_copy_until(ReplaceStream* stream, u64 end)
+{
+    if (end <= stream->copied)
+        return;
+
+    u64 length = end - stream->copied;
+    if (stream->copied >= stream->chunk_start && length < (u64)REPLACE_COPY_MIN)
+    {
+        replace_write(stream, stream->worker->read_buffer + (stream->copied - stream->chunk_start), (size)length);
+    }
+    else
+    {
+        // Kept in order with what is buffered
+        replace_flush(stream);
+        if (!stream->failed)
+            stream->failed = !file_copy_range(stream->in, stream->copied, stream->out, length);
+        stream->result->bytes_copied += length;
+    }
+    stream->result->bytes_written += length;
+    stream->copied = end;
+}
+
+internal void replace_on_match(SearchMatch* match, void* data)
+{
+    ReplaceStream* stream = (ReplaceStream*)data;
+    if (stream->failed)
+        return;
+
+    if (!stream->out)
+    {
+        stream->out = file_create_beside(stream->filename, stream->out_path, sizeof(stream->out_path));
+        stream->failed = !stream->out;
+        if (stream->failed)
+            return;
+    }
+
+    replace_copy_until(stream, match->offset);
+    replace_write(stream, stream->query->replacement.data, stream->query->replacement.len);
+    stream->copied = match->offset + (u64)stream->query->needle.len;
+    stream->result->bytes_written += (u64)stream->query->replacement.len;
+    ++stream->result->replacement_count;
+}
+
+internal b32 replace_is_ascii(s8 text)
+{
+    for (size i = 0; i < text.len; ++i)
+    {
+        if (text.data[i] >= 0x80)
+            return false;
+    }
+    return true;
+}
+
+b32 replace_is_supported(ReplaceQuery* query, SearchFileKind kind)
+{
+    b32 result = kind != SearchFileKind_Utf16Le && kind != SearchFileKind_Utf16Be &&
+                 (kind != SearchFileKind_Latin1 || (replace_is_ascii(query->needle) &&
+                                                    replace_is_ascii(query->replacement)));
+    return result;
+}
+
+// Same size, time and file, so nothing has written to it or replaced it
+internal b32 replace_is_unchanged(char* filename, FileInfo* before)
+{
+    FileInfo after;
+    b32 result = file_get_info(filename, &after) && after.size == before->size &&
+                 after.modified == before->modified && after.id == before->id;
+    return result;
+}
+
+ReplaceFileResult replace_file(ReplaceWorker* worker, ReplaceQuery* query, char* filename)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ReplaceFileResult result;
+    zero_struct(result);
+
+    // NOTE(lucas): Replacing a symbolic link would put a file where the link was, so only regular files are read
+    FileInfo before;
+    b32 exists = file_get_info(filename, &before) && before.kind == FileEntryKind_File;
+    void* in = (exists && before.size > 0) ? file_open_read(filename) : 0;
+    if (!exists || (before.size > 0 && !in))
+        result.status = ReplaceStatus_Unreadable;
+
+    if (in)
+    {
+        ReplaceStream stream;
+        zero_struct(stream);
+        stream.worker = worker;
+        stream.query = query;
+        stream.result = &result;
+        stream.filename = filename;
+        stream.in = in;
+
+        u8* buffer = worker->read_buffer;
+        size file_size = (size)before.size;
+        size filled = (file_size < (size)SEARCH_SNIFF_SIZE) ? file_size : (size)SEARCH_SNIFF_SIZE;
+        size remaining = file_size - filled;
+        SearchFileKind kind = SearchFileKind_Text;
+        result.file_size = before.size;
+        if (file_read_stream(in, buffer, filled) != filled)
+        {
+            result.status = ReplaceStatus_Unreadable;
+        }
+        else if (search_detect_compression(buffer, filled) != SearchCompression_None)
+        {
+            result.status = ReplaceStatus_Unsupported;
+            result.bytes_read = (u64)filled;
+        }
+        else
+        {
+            kind = search_classify(buffer, filled);
+            if (!replace_is_supported(query, kind))
+                result.status = ReplaceStatus_Unsupported;
+            else if (kind == SearchFileKind_Binary && !query->include_binary)
+                result.skipped = true;
+            if (result.status != ReplaceStatus_Ok || result.skipped)
+                result.bytes_read = (u64)filled;
+        }
+
+        if (result.status == ReplaceStatus_Ok && !result.skipped)
+        {
+            SearchQuery search_query = {0};
+            search_query.needle = query->needle;
+            search_query.on_match = replace_on_match;
+            search_query.match_data = &stream;
+            SearchScanner scanner;
+            search_scanner_init(&scanner, &search_query, kind, 0);
+            for (;;)
+            {
+                size wanted = (size)SEARCH_CHUNK_SIZE - filled;
+                if (wanted > remaining)
+                    wanted = remaining;
+                if (wanted > 0)
+                {
+                    size got = file_read_stream(in, buffer + filled, wanted);
+                    filled += got;
+                    remaining = (got == wanted) ? remaining - wanted : 0;
+                }
+
+                stream.chunk_start = result.bytes_read;
+                search_scanner_feed(&scanner, buffer, filled);
+                result.bytes_read += (u64)filled;
+                filled = 0;
+                if (remaining <= 0 || stream.failed)
+                    break;
+                if (cancel_token_is_cancelled(query->token))
+                {
+                    result.status = ReplaceStatus_Cancelled;
+                    break;
+                }
+            }
+
+            if (stream.out)
+            {
+                if (result.status == ReplaceStatus_Ok)
+                {
+                    replace_copy_until(&stream, result.bytes_read);
+                    replace_flush(&stream);
+                    if (stream.failed || !file_flush(stream.out))
+                        result.status = ReplaceStatus_Unwritable;
+                    else if (result.bytes_read != before.size || !replace_is_unchanged(filename, &before))
+                        result.status = ReplaceStatus_Changed;
+                }
+                file_close(stream.out);
+
+                // Closed first, since an open file can't be replaced on Windows
+                file_close(in);
+                in = 0;
+                if (result.status == ReplaceStatus_Ok && !file_replace(stream.out_path, filename))
+                    result.status = ReplaceStatus_Unwritable;
+                if (result.status == ReplaceStatus_Ok)
+                    result.rewritten = true;
+                else
+                    file_delete(stream.out_path);
+            }
+            else if (stream.failed)
+            {
+                result.status = ReplaceStatus_Unwritable;
+            }
+        }
+
+        if (in)
+            file_close(in);
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
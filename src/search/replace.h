@@ -0,0 +1,81 @@
+#pragma once
+
+#include "grapple_memory.h"
+#include "search/search.h"
+#include "str.h"
+#include "thread.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Search and replace in files on disk, a file at a time, with memory that doesn't grow with the file.
+ * The file is read a chunk at a time into the scanner, as search_file reads it, and nothing is written until the
+ * first match, so the files that don't match, which are most of them, only cost a search. From the first match on,
+ * a new version is written beside the old one: the replacement for each match, and the unchanged bytes between
+ * matches. Those are copied by the OS from the old file (file_copy_range) when there are REPLACE_COPY_MIN or more of
+ * them, or when they have already left the read buffer, and through a write buffer otherwise. Once it is all
+ * written, the new file takes the old one's place with file_replace, so a reader sees either one, never a mix, and
+ * a failure at any point leaves the old file as it was.
+ *
+ * A file that changes while it is being rewritten is left alone, since the new version would lose the change.
+ *
+ * Only text is rewritten. Compressed and UTF-16 files are left alone, since the matches are in text they would have
+ * to be converted back to, and binary files are skipped unless include_binary is set, as in search.h. Latin-1 files
+ * are left alone too, unless the needle and the replacement are both ASCII, which Latin-1 writes the same way.
+ */
+
+#define REPLACE_WRITE_SIZE MEGABYTES(1)
+#define REPLACE_COPY_MIN KILOBYTES(64)
+
+typedef enum
+{
+    ReplaceStatus_Ok = 0,
+    ReplaceStatus_Unreadable,
+    ReplaceStatus_Unwritable,  // The new version couldn't be created, written or moved into place
+    ReplaceStatus_Changed,     // The file changed while it was being rewritten
+    ReplaceStatus_Unsupported, // Compressed, UTF-16, or Latin-1 that query can't be written in, so left alone
+    ReplaceStatus_Cancelled,
+} ReplaceStatus;
+
+typedef struct
+{
+    s8 needle; // At most SEARCH_MAX_NEEDLE bytes
+    s8 replacement;
+    CancelToken* token; // Optional
+    b32 include_binary;
+} ReplaceQuery;
+
+typedef struct
+{
+    ReplaceStatus status;
+    b32 skipped;         // Binary, so only the head was read
+    b32 rewritten;
+    u64 file_size;
+    u64 bytes_read;
+    u64 bytes_written;   // The size of the new version
+    u64 bytes_copied;    // Of bytes_written, copied by the OS
+    u64 replacement_count;
+} ReplaceFileResult;
+
+// What one thread needs to rewrite files
+typedef struct
+{
+    Arena arena;
+    u8* read_buffer;  // SEARCH_CHUNK_SIZE
+    u8* write_buffer; // REPLACE_WRITE_SIZE
+} ReplaceWorker;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ReplaceWorker* replace_worker_create(Arena* arena);
+
+// Whether files of kind can be rewritten for query
+b32 replace_is_supported(ReplaceQuery* query, SearchFileKind kind);
+
+// Rewrites filename with every match of the needle replaced, if it has any
+ReplaceFileResult replace_file(ReplaceWorker* worker, ReplaceQuery* query, char* filename);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,752 @@
+#include "containers.h"
+#include "profiler.h"
+#include "search/search.h"
+
+#include <string.h> // memchr, memcmp, memcpy
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define SEARCH_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+internal inline u32 search_highest_bit(u32 value)
+{
+    ASSERT(value, "search_highest_bit is undefined for 0");
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse(&index, value);
+    return (u32)index;
+#else
+    return 31 - (u32)__builtin_clz(value);
+#endif
+}
+
+/*
+ * NOTE(lucas): Compares two bytes of the needle, normally its first and last, against 16 positions at once and only
+ * runs memcmp where both match. Checking two bytes that far apart rejects nearly every candidate, even for needles
+ * that start with a common letter. In UTF-16 the first or last byte is the high byte of a unit, which is mostly
+ * zero and would reject nothing, so the low bytes of the first and last units are checked instead (search_probes).
+ */
+internal u8* search_find_probed(u8* haystack, size haystack_size, u8* needle, size n, size first_at, size last_at)
+{
+    if (n <= 0 || n > haystack_size)
+        return 0;
+    if (n == 1)
+        return (u8*)memchr(haystack, needle[0], (usize)haystack_size);
+
+    u8 first = needle[first_at];
+    u8 last = needle[last_at];
+    size last_start = haystack_size - n;
+    size i = 0;
+
+#ifdef SEARCH_SSE2
+    __m128i first_wide = _mm_set1_epi8((char)first);
+    __m128i last_wide = _mm_set1_epi8((char)last);
+    for (; i + 16 <= last_start + 1; i += 16)
+    {
+        __m128i first_match = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(haystack + i + first_at)), first_wide);
+        __m128i last_match = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(haystack + i + last_at)), last_wide);
+        u32 mask = (u32)_mm_movemask_epi8(_mm_and_si128(first_match, last_match));
+        while (mask)
+        {
+            size candidate = i + count_trailing_zeros_u32(mask);
+            if (memcmp(haystack + candidate, needle, (usize)n) == 0)
+                return haystack + candidate;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i <= last_start; ++i)
+    {
+        if (haystack[i + first_at] == first && haystack[i + last_at] == last &&
+            memcmp(haystack + i, needle, (usize)n) == 0)
+        {
+            return haystack + i;
+        }
+    }
+    return 0;
+}
+
+u8* search_find(u8* haystack, size haystack_size, s8 needle)
+{
+    return search_find_probed(haystack, haystack_size, needle.data, needle.len, 0, needle.len - 1);
+}
+
+// The bytes of an n byte needle that search_find_probed checks first
+internal inline void search_probes(SearchFileKind kind, size n, size* first_at, size* last_at)
+{
+    *first_at = (kind == SearchFileKind_Utf16Be && n >= 2) ? 1 : 0;
+    *last_at = (kind == SearchFileKind_Utf16Le && n >= 2) ? n - 2 : n - 1;
+}
+
+//
+// Case-insensitive
+//
+
+// Whether data matches folded, with the case bit set on the bytes in case_bits
+internal b32 search_equal_ascii(u8* data, u8* folded, u8* case_bits, size n)
+{
+    size i = 0;
+
+#ifdef SEARCH_SSE2
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i have = _mm_or_si128(_mm_loadu_si128((__m128i*)(data + i)), _mm_loadu_si128((__m128i*)(case_bits + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(have, _mm_loadu_si128((__m128i*)(folded + i)))) != 0xFFFF)
+            return false;
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        if ((data[i] | case_bits[i]) != folded[i])
+            return false;
+    }
+    return true;
+}
+
+/*
+ * NOTE(lucas): search_find for ASCII letters in either case. The needle is in lower case, and the haystack's bytes
+ * are compared with the case bit set where the needle has a letter. That makes an uppercase letter lowercase and
+ * leaves a lowercase one alone, but would turn '@' into '`', so lanes with anything else are compared as they are.
+ * Which lanes those are comes with the needle, since in UTF-16 a byte that looks like a letter can be half of some
+ * other character. The two bytes checked first have their bits known up front, so it costs one OR per load.
+ */
+internal u8* search_find_ascii(u8* haystack, size haystack_size, u8* folded, u8* case_bits, size n, size first_at,
+                               size last_at)
+{
+    if (n <= 0 || n > haystack_size)
+        return 0;
+
+    u8 first = folded[first_at];
+    u8 last = folded[last_at];
+    u8 first_bit = case_bits[first_at];
+    u8 last_bit = case_bits[last_at];
+    if (n == 1 && !first_bit)
+        return (u8*)memchr(haystack, first, (usize)haystack_size);
+
+    size last_start = haystack_size - n;
+    size i = 0;
+
+#ifdef SEARCH_SSE2
+    __m128i first_wide = _mm_set1_epi8((char)first);
+    __m128i last_wide = _mm_set1_epi8((char)last);
+    __m128i first_bit_wide = _mm_set1_epi8((char)first_bit);
+    __m128i last_bit_wide = _mm_set1_epi8((char)last_bit);
+    for (; i + 16 <= last_start + 1; i += 16)
+    {
+        __m128i first_bytes = _mm_or_si128(_mm_loadu_si128((__m128i*)(haystack + i + first_at)), first_bit_wide);
+        __m128i last_bytes = _mm_or_si128(_mm_loadu_si128((__m128i*)(haystack + i + last_at)), last_bit_wide);
+        __m128i both = _mm_and_si128(_mm_cmpeq_epi8(first_bytes, first_wide), _mm_cmpeq_epi8(last_bytes, last_wide));
+        u32 mask = (u32)_mm_movemask_epi8(both);
+        while (mask)
+        {
+            size candidate = i + count_trailing_zeros_u32(mask);
+            if (search_equal_ascii(haystack + candidate, folded, case_bits, n))
+                return haystack + candidate;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i <= last_start; ++i)
+    {
+        if ((haystack[i + first_at] | first_bit) == first && (haystack[i + last_at] | last_bit) == last &&
+            search_equal_ascii(haystack + i, folded, case_bits, n))
+        {
+            return haystack + i;
+        }
+    }
+    return 0;
+}
+
+// How long the match of the needle from pattern->rest is at data, or 0 if there isn't one. Invalid UTF-8 in the
+// needle is matched byte for byte, so it can't match differently depending on where the data was cut. (It makes
+// a UTF-16 pattern impossible, so it never gets here for one.)
+internal size search_match_folded(SearchPattern* pattern, u8* data, size data_size)
+{
+    s8 needle = pattern->needle;
+    size i = 0;
+    for (size j = pattern->rest; j < needle.len;)
+    {
+        if (i >= data_size)
+            return 0;
+
+        size needle_length = 0;
+        u32 want = search_decode_utf8(needle.data + j, needle.len - j, &needle_length);
+        if (want >= SEARCH_INVALID_CODEPOINT)
+        {
+            if (data[i] != needle.data[j])
+                return 0;
+            ++i;
+            ++j;
+            continue;
+        }
+
+        size data_length = 0;
+        u32 have = search_decode(pattern->kind, data + i, data_size - i, &data_length);
+        if (have != want && (have >= SEARCH_INVALID_CODEPOINT ||
+                             search_fold_codepoint(have) != search_fold_codepoint(want)))
+        {
+            return 0;
+        }
+        i += data_length;
+        j += needle_length;
+    }
+    return i;
+}
+
+// How long the match at data is, starting with any of the literals, or 0 if there isn't one
+internal size search_match_unicode(SearchPattern* pattern, u8* data, size data_size)
+{
+    for (u32 j = 0; j < pattern->literal_count; ++j)
+    {
+        size literal_length = pattern->literal_lengths[j];
+        if (literal_length <= data_size &&
+            search_equal_ascii(data, pattern->literals[j], pattern->literal_case_bits[j], literal_length))
+        {
+            size rest = search_match_folded(pattern, data + literal_length, data_size - literal_length);
+            if (rest || pattern->rest == pattern->needle.len)
+                return literal_length + rest;
+        }
+    }
+    return 0;
+}
+
+/*
+ * NOTE(lucas): Every match starts with one of the pattern's literals, so they are what is looked for: the first and
+ * last byte of each, with the case bit as in search_find_ascii, at 16 positions at once. There are at most
+ * SEARCH_MAX_LITERALS and usually two, since a needle that gets here has a letter with a case outside ASCII, and
+ * every other letter's cases are one literal in lower case. Candidates are checked against the whole literal, then
+ * the rest of the needle a code point at a time.
+ */
+internal u8* search_find_unicode(SearchPattern* pattern, u8* haystack, size haystack_size, size* match_length)
+{
+    u32 literal_count = pattern->literal_count;
+    size i = 0;
+
+#ifdef SEARCH_SSE2
+    size longest = 0;
+    __m128i first_wide[SEARCH_MAX_LITERALS];
+    __m128i last_wide[SEARCH_MAX_LITERALS];
+    __m128i first_bit_wide[SEARCH_MAX_LITERALS];
+    __m128i last_bit_wide[SEARCH_MAX_LITERALS];
+    size first_at[SEARCH_MAX_LITERALS];
+    size last_at[SEARCH_MAX_LITERALS];
+    for (u32 j = 0; j < literal_count; ++j)
+    {
+        search_probes(pattern->kind, pattern->literal_lengths[j], &first_at[j], &last_at[j]);
+        longest = (pattern->literal_lengths[j] > longest) ? pattern->literal_lengths[j] : longest;
+        first_wide[j] = _mm_set1_epi8((char)pattern->literals[j][first_at[j]]);
+        last_wide[j] = _mm_set1_epi8((char)pattern->literals[j][last_at[j]]);
+        first_bit_wide[j] = _mm_set1_epi8((char)pattern->literal_case_bits[j][first_at[j]]);
+        last_bit_wide[j] = _mm_set1_epi8((char)pattern->literal_case_bits[j][last_at[j]]);
+    }
+    for (; i + 16 + longest - 1 <= haystack_size; i += 16)
+    {
+        // Every literal's first probe is at the same place, as they are all in the same encoding
+        __m128i bytes = _mm_loadu_si128((__m128i*)(haystack + i + first_at[0]));
+        __m128i any = _mm_setzero_si128();
+        for (u32 j = 0; j < literal_count; ++j)
+        {
+            __m128i first_bytes = _mm_or_si128(bytes, first_bit_wide[j]);
+            __m128i last = _mm_loadu_si128((__m128i*)(haystack + i + last_at[j]));
+            __m128i last_bytes = _mm_or_si128(last, last_bit_wide[j]);
+            any = _mm_or_si128(any, _mm_and_si128(_mm_cmpeq_epi8(first_bytes, first_wide[j]),
+                                                  _mm_cmpeq_epi8(last_bytes, last_wide[j])));
+        }
+
+        u32 mask = (u32)_mm_movemask_epi8(any);
+        while (mask)
+        {
+            size candidate = i + count_trailing_zeros_u32(mask);
+            size length = search_match_unicode(pattern, haystack + candidate, haystack_size - candidate);
+            if (length)
+            {
+                *match_length = length;
+                return haystack + candidate;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    for (; i < haystack_size; ++i)
+    {
+        size length = search_match_unicode(pattern, haystack + i, haystack_size - i);
+        if (length)
+        {
+            *match_length = length;
+            return haystack + i;
+        }
+    }
+    return 0;
+}
+
+// Writes codepoint the way kind does, and the case bits to go with it, or returns 0 if kind can't write it. With
+// fold_ascii, ASCII letters are written in lower case with the bit set.
+internal size search_put_folded(SearchFileKind kind, u32 codepoint, b32 fold_ascii, u8* out, u8* case_bits)
+{
+    b32 letter = fold_ascii && (codepoint | 0x20) - 'a' < 26;
+    size result = search_encode(kind, letter ? (codepoint | 0x20) : codepoint, out);
+    memset(case_bits, 0, (usize)result);
+    if (letter && result)
+        case_bits[(kind == SearchFileKind_Utf16Be) ? 1 : 0] = 0x20;
+    return result;
+}
+
+// Every way kind can write codepoint that matches it, without repeats: itself when case matters, and each of its
+// cases otherwise, with ASCII letters in lower case. Returns how many, which is 0 if kind can't write any of them.
+internal u32 search_variants(SearchFileKind kind, SearchCase match_case, u32 codepoint,
+                             u8 variants[SEARCH_MAX_CASES][4], u8 case_bits[SEARCH_MAX_CASES][4], size* lengths)
+{
+    u32 cases[SEARCH_MAX_CASES];
+    u32 case_count = 1;
+    cases[0] = codepoint;
+    if (match_case == SearchCase_Unicode)
+        case_count = search_fold_cases(codepoint, cases);
+
+    u32 result = 0;
+    for (u32 c = 0; c < case_count; ++c)
+    {
+        size length = search_put_folded(kind, cases[c], match_case != SearchCase_Sensitive, variants[result],
+                                        case_bits[result]);
+        b32 seen = (length == 0);
+        for (u32 v = 0; v < result && !seen; ++v)
+            seen = lengths[v] == length && memcmp(variants[v], variants[result], (usize)length) == 0;
+        if (!seen)
+            lengths[result++] = length;
+    }
+    return result;
+}
+
+/*
+ * NOTE(lucas): The needle is written the way the file writes text, a code point at a time. Where every code point
+ * can only be written one way, which is always the case for Sensitive and Ascii, and for Unicode when no letter
+ * has a case outside ASCII (or outside Latin-1's reach, like the Kelvin sign), that is the whole needle and it is
+ * looked for as it is. Otherwise the ways make the literals. A code point with no way at all means there can't be a
+ * match.
+ */
+void search_pattern_init(SearchPattern* pattern, s8 needle, SearchCase match_case, SearchFileKind kind)
+{
+    ASSERT(needle.len > 0 && needle.len <= (size)SEARCH_MAX_NEEDLE, "Needle is empty or too long");
+
+    pattern->needle = needle;
+    pattern->kind = kind;
+    pattern->match_case = match_case;
+    pattern->impossible = false;
+    pattern->unit = search_is_utf16(kind) ? 2 : 1;
+    pattern->length = 0;
+    pattern->rest = needle.len;
+    pattern->literal_count = 0;
+
+    b32 one_way = true;
+    size max_length = 0;
+    for (size i = 0; i < needle.len && !pattern->impossible;)
+    {
+        size length = 0;
+        u8 variants[SEARCH_MAX_CASES][4];
+        u8 case_bits[SEARCH_MAX_CASES][4];
+        size variant_lengths[SEARCH_MAX_CASES];
+        u32 codepoint = search_decode_utf8(needle.data + i, needle.len - i, &length);
+        u32 variant_count = search_variants(kind, match_case, codepoint, variants, case_bits, variant_lengths);
+        size longest = 0;
+        for (u32 v = 0; v < variant_count; ++v)
+            longest = (variant_lengths[v] > longest) ? variant_lengths[v] : longest;
+
+        if (variant_count == 1)
+        {
+            memcpy(pattern->encoded + pattern->length, variants[0], (usize)variant_lengths[0]);
+            memcpy(pattern->case_bits + pattern->length, case_bits[0], (usize)variant_lengths[0]);
+            pattern->length += variant_lengths[0];
+        }
+        pattern->impossible = (variant_count == 0);
+        one_way = one_way && variant_count == 1;
+        max_length += longest;
+        i += length;
+    }
+    pattern->max_length = (max_length > 0) ? max_length : 1;
+
+    if (one_way || pattern->impossible)
+    {
+        if (match_case == SearchCase_Unicode)
+            pattern->match_case = SearchCase_Ascii;
+    }
+    else
+    {
+        // Each code point multiplies the literals by its ways, until that would make too many or too long ones
+        pattern->literal_count = 1;
+        pattern->literal_lengths[0] = 0;
+        size rest = 0;
+        while (rest < needle.len)
+        {
+            size length = 0;
+            u8 variants[SEARCH_MAX_CASES][4];
+            u8 case_bits[SEARCH_MAX_CASES][4];
+            size variant_lengths[SEARCH_MAX_CASES];
+            u32 codepoint = search_decode_utf8(needle.data + rest, needle.len - rest, &length);
+            u32 variant_count = search_variants(kind, match_case, codepoint, variants, case_bits, variant_lengths);
+
+            size longest = 0;
+            for (u32 j = 0; j < pattern->literal_count; ++j)
+                longest = (pattern->literal_lengths[j] > longest) ? pattern->literal_lengths[j] : longest;
+            if (rest > 0 && (pattern->literal_count*variant_count > SEARCH_MAX_LITERALS ||
+                             longest + 4 > SEARCH_MAX_LITERAL))
+            {
+                break;
+            }
+
+            // Backwards, so each literal is copied from before it is written over
+            for (u32 j = pattern->literal_count; j-- > 0;)
+            {
+                for (u32 v = variant_count; v-- > 0;)
+                {
+                    u32 to = j*variant_count + v;
+                    size literal_length = pattern->literal_lengths[j];
+                    if (to != j)
+                    {
+                        memcpy(pattern->literals[to], pattern->literals[j], (usize)literal_length);
+                        memcpy(pattern->literal_case_bits[to], pattern->literal_case_bits[j], (usize)literal_length);
+                    }
+                    memcpy(pattern->literals[to] + literal_length, variants[v], (usize)variant_lengths[v]);
+                    memcpy(pattern->literal_case_bits[to] + literal_length, case_bits[v], (usize)variant_lengths[v]);
+                    pattern->literal_lengths[to] = (u8)(literal_length + variant_lengths[v]);
+                }
+            }
+            pattern->literal_count *= variant_count;
+            rest += length;
+        }
+        pattern->rest = rest;
+    }
+}
+
+u8* search_pattern_find(SearchPattern* pattern, u8* haystack, size haystack_size, size* match_length)
+{
+    u8* result = 0;
+    if (pattern->impossible)
+        return result;
+
+    if (pattern->match_case == SearchCase_Unicode)
+    {
+        result = search_find_unicode(pattern, haystack, haystack_size, match_length);
+    }
+    else
+    {
+        size first_at = 0;
+        size last_at = 0;
+        search_probes(pattern->kind, pattern->length, &first_at, &last_at);
+        result = (pattern->match_case == SearchCase_Ascii)
+                     ? search_find_ascii(haystack, haystack_size, pattern->encoded, pattern->case_bits,
+                                         pattern->length, first_at, last_at)
+                     : search_find_probed(haystack, haystack_size, pattern->encoded, pattern->length, first_at,
+                                          last_at);
+        *match_length = pattern->length;
+    }
+    return result;
+}
+
+u64 search_count_newlines(u8* data, size data_size)
+{
+    u64 result = 0;
+    size i = 0;
+
+#ifdef SEARCH_SSE2
+    // Matches are subtracted from per-byte counters (a match is -1), which are summed before they can wrap
+    __m128i newline = _mm_set1_epi8('\n');
+    __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= data_size)
+    {
+        size block_end = i + 255*16;
+        if (block_end > data_size)
+            block_end = data_size;
+
+        __m128i counts = zero;
+        for (; i + 16 <= block_end; i += 16)
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(data + i)), newline));
+
+        __m128i sums = _mm_sad_epu8(counts, zero);
+        result += (u64)_mm_cvtsi128_si32(sums) + (u64)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+#endif
+
+    for (; i < data_size; ++i)
+        result += (data[i] == '\n');
+    return result;
+}
+
+internal u8* search_find_last_newline(u8* data, size data_size)
+{
+    size i = data_size;
+
+#ifdef SEARCH_SSE2
+    __m128i newline = _mm_set1_epi8('\n');
+    while (i >= 16)
+    {
+        i -= 16;
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(data + i)), newline));
+        if (mask)
+            return data + i + search_highest_bit(mask);
+    }
+#endif
+
+    while (i > 0)
+    {
+        --i;
+        if (data[i] == '\n')
+            return data + i;
+    }
+    return 0;
+}
+
+// search_count_newlines for the 0x000A units of UTF-16, in data that starts on a unit
+internal u64 search_count_newline_units(u8* data, size data_size, b32 big_endian)
+{
+    u64 result = 0;
+    size i = 0;
+
+#ifdef SEARCH_SSE2
+    // As in search_count_newlines, but a unit that matches takes 1 from both of its bytes' counters
+    __m128i newline = _mm_set1_epi16((short)(big_endian ? 0x0A00 : 0x000A));
+    __m128i zero = _mm_setzero_si128();
+    u64 doubled = 0;
+    while (i + 16 <= data_size)
+    {
+        size block_end = i + 255*16;
+        if (block_end > data_size)
+            block_end = data_size;
+
+        __m128i counts = zero;
+        for (; i + 16 <= block_end; i += 16)
+            counts = _mm_sub_epi8(counts, _mm_cmpeq_epi16(_mm_loadu_si128((__m128i*)(data + i)), newline));
+
+        __m128i sums = _mm_sad_epu8(counts, zero);
+        doubled += (u64)_mm_cvtsi128_si32(sums) + (u64)_mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+    result = doubled/2;
+#endif
+
+    u8 first = (u8)(big_endian ? 0 : '\n');
+    u8 second = (u8)(big_endian ? '\n' : 0);
+    for (; i + 2 <= data_size; i += 2)
+        result += (data[i] == first && data[i + 1] == second);
+    return result;
+}
+
+internal u8* search_find_last_newline_unit(u8* data, size data_size, b32 big_endian)
+{
+    size i = data_size & ~(size)1;
+
+#ifdef SEARCH_SSE2
+    __m128i newline = _mm_set1_epi16((short)(big_endian ? 0x0A00 : 0x000A));
+    while (i >= 16)
+    {
+        i -= 16;
+        u32 mask = (u32)_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((__m128i*)(data + i)), newline));
+        if (mask)
+            return data + i + search_highest_bit(mask) - 1;
+    }
+#endif
+
+    u8 first = (u8)(big_endian ? 0 : '\n');
+    u8 second = (u8)(big_endian ? '\n' : 0);
+    while (i >= 2)
+    {
+        i -= 2;
+        if (data[i] == first && data[i + 1] == second)
+            return data + i;
+    }
+    return 0;
+}
+
+// Counts the lines that end in data, which starts on a unit, and if there are any, sets line_start to where the
+// next one starts in it
+internal u64 search_count_lines(SearchPattern* pattern, u8* data, size data_size, size* line_start)
+{
+    u64 result = 0;
+    if (search_is_utf16(pattern->kind))
+    {
+        b32 big_endian = (pattern->kind == SearchFileKind_Utf16Be);
+        result = search_count_newline_units(data, data_size, big_endian);
+        if (result)
+            *line_start = (search_find_last_newline_unit(data, data_size, big_endian) - data) + 2;
+    }
+    else
+    {
+        result = search_count_newlines(data, data_size);
+        if (result)
+            *line_start = (search_find_last_newline(data, data_size) - data) + 1;
+    }
+    return result;
+}
+
+void search_scanner_init(SearchScanner* scanner, SearchQuery* query, SearchFileKind kind, u32 file_index)
+{
+    search_pattern_init(&scanner->pattern, query->needle, query->match_case, kind);
+    scanner->offset = 0;
+    scanner->counted = 0;
+    scanner->newlines = 0;
+    scanner->line_start = 0;
+    scanner->first_line = 1;
+    scanner->resume = 0;
+    scanner->end = (u64)-1;
+    scanner->max_count = query->max_count ? query->max_count : (u64)-1;
+    scanner->match_count = 0;
+    scanner->file_index = file_index;
+    scanner->on_match = query->on_match;
+    scanner->match_data = query->match_data;
+    scanner->carry_size = 0;
+}
+
+// Moves the line count forward over data, which starts at scanner->counted
+internal inline void search_scanner_count(SearchScanner* scanner, u8* data, size data_size)
+{
+    size line_start = 0;
+    u64 newlines = search_count_lines(&scanner->pattern, data, data_size, &line_start);
+    if (newlines)
+    {
+        scanner->newlines += newlines;
+        scanner->line_start = scanner->counted + (u64)line_start;
+    }
+    scanner->counted += (u64)data_size;
+}
+
+/*
+ * NOTE(lucas): buffer[0] is at scanner->counted. Matches are reported if they start before match_limit and fit in
+ * the buffer, and the line count is moved up to count_limit. Everything after count_limit is the carry, which is
+ * counted the next time around, once it is known that no match can start in it without being seen.
+ */
+internal void search_scanner_scan(SearchScanner* scanner, u8* buffer, size buffer_size, size match_limit,
+                                  size count_limit)
+{
+    size n = scanner->pattern.max_length;
+    size search_end = (match_limit + n - 1 < buffer_size) ? match_limit + n - 1 : buffer_size;
+    u64 base = scanner->counted;
+    size counted = 0;
+    size pos = 0;
+
+    for (;;)
+    {
+        if (base + (u64)pos < scanner->resume)
+            pos = (size)(scanner->resume - base);
+        if (pos >= match_limit || scanner->match_count >= scanner->max_count)
+            break;
+
+        size match_length = 0;
+        u8* found = search_pattern_find(&scanner->pattern, buffer + pos, search_end - pos, &match_length);
+        if (!found)
+            break;
+
+        // A folded match can be shorter than the longest, so one can be found that starts past the limit
+        size at = found - buffer;
+        u64 offset = base + (u64)at;
+        if (at >= match_limit || offset >= scanner->end)
+            break;
+        if (offset & (u64)(scanner->pattern.unit - 1))
+        {
+            // Halfway through a UTF-16 unit
+            pos = at + 1;
+            continue;
+        }
+
+        // A folded match can be short enough to start in what will be the carry, which isn't counted yet, so the
+        // lines up to it are counted without keeping the count
+        size count_end = (at < count_limit) ? at : count_limit;
+        search_scanner_count(scanner, buffer + counted, count_end - counted);
+        counted = count_end;
+        u64 newlines = scanner->newlines;
+        u64 line_start = scanner->line_start;
+        if (at > counted)
+        {
+            size carry_line_start = 0;
+            u64 carry_newlines = search_count_lines(&scanner->pattern, buffer + counted, at - counted,
+                                                    &carry_line_start);
+            if (carry_newlines)
+            {
+                newlines += carry_newlines;
+                line_start = scanner->counted + (u64)carry_line_start;
+            }
+        }
+
+        u64 column = offset - line_start + 1;
+        SearchMatch match;
+        match.offset = offset;
+        match.line = scanner->first_line + newlines;
+        match.column = (column > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (u32)column;
+        match.file_index = scanner->file_index;
+        ++scanner->match_count;
+        if (scanner->on_match)
+            scanner->on_match(&match, scanner->match_data);
+
+        pos = at + match_length;
+        scanner->resume = offset + (u64)match_length;
+    }
+
+    if (count_limit > counted)
+        search_scanner_count(scanner, buffer + counted, count_limit - counted);
+}
+
+void search_scanner_feed(SearchScanner* scanner, u8* data, size data_size)
+{
+    if (data_size <= 0)
+        return;
+
+    PROFILE_FUNCTION_BEGIN();
+    ASSERT(!(scanner->offset & (u64)(scanner->pattern.unit - 1)), "UTF-16 is fed in whole units until the end");
+
+    // The carry starts on a unit, so that lines are only ever counted up to the start of one
+    size keep = scanner->pattern.max_length - 1;
+    if ((scanner->offset + (u64)data_size - (u64)keep) & (u64)(scanner->pattern.unit - 1))
+        ++keep;
+    if (data_size < keep)
+    {
+        // Too short to stand on its own, so the carry and the data are scanned as one and the carry comes from both
+        u8 joined[2*SEARCH_MAX_MATCH];
+        size joined_size = scanner->carry_size + data_size;
+        memcpy(joined, scanner->carry, (usize)scanner->carry_size);
+        memcpy(joined + scanner->carry_size, data, (usize)data_size);
+
+        size carry_size = (joined_size < keep) ? joined_size : keep;
+        search_scanner_scan(scanner, joined, joined_size, joined_size, joined_size - carry_size);
+        memcpy(scanner->carry, joined + joined_size - carry_size, (usize)carry_size);
+        scanner->carry_size = carry_size;
+    }
+    else
+    {
+        // Matches that start in the carry end within the first keep bytes of the data
+        if (scanner->carry_size)
+        {
+            u8 joined[2*SEARCH_MAX_MATCH];
+            memcpy(joined, scanner->carry, (usize)scanner->carry_size);
+            memcpy(joined + scanner->carry_size, data, (usize)keep);
+            search_scanner_scan(scanner, joined, scanner->carry_size + keep, scanner->carry_size,
+                                scanner->carry_size);
+        }
+
+        search_scanner_scan(scanner, data, data_size, data_size, data_size - keep);
+        memcpy(scanner->carry, data + data_size - keep, (usize)keep);
+        scanner->carry_size = keep;
+    }
+    scanner->offset += (u64)data_size;
+
+    PROFILE_FUNCTION_END();
+}
+
+// The line count as of scanner->offset, counting the carry without consuming it
+internal void search_scanner_line_state(SearchScanner* scanner, u64* newlines, u64* line_start)
+{
+    *newlines = scanner->newlines;
+    *line_start = scanner->line_start;
+    size carry_line_start = 0;
+    u64 carry_newlines = search_count_lines(&scanner->pattern, scanner->carry, scanner->carry_size,
+                                            &carry_line_start);
+    if (carry_newlines)
+    {
+        *newlines += carry_newlines;
+        *line_start = scanner->counted + (u64)carry_line_start;
+    }
+}
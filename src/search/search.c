@@ -0,0 +1,880 @@
+#include "channel.h"
+#include "containers.h"
+#include "file.h"
+#include "grapple_memory.h"
+#include "inflate.h"
+#include "profiler.h"
+#include "search/search.h"
+#include "thread.h"
+#include "zstd.h"
+
+#include "search/casefold.c"
+#include "search/classify.c"
+#include "search/scan.c"
+
+#include <string.h> // memcpy
+
+#define GZIP_FLAG_HCRC    (1 << 1)
+#define GZIP_FLAG_EXTRA   (1 << 2)
+#define GZIP_FLAG_NAME    (1 << 3)
+#define GZIP_FLAG_COMMENT (1 << 4)
+#define GZIP_TRAILER_SIZE 8 // CRC-32 of the member's output, then its size mod 2^32
+
+// The seek table of the zstd seekable format is a skippable frame at the end of the file, ending in this footer
+#define ZSTD_SEEKABLE_MAGIC 0x8F92EAB1u
+#define ZSTD_SEEK_TABLE_MAGIC 0x184D2A5Eu
+#define ZSTD_SEEK_TABLE_FOOTER_SIZE 9
+
+// A gzip member or zstd frame that can be decompressed on its own, or a piece of a plain file
+typedef struct
+{
+    size offset;
+    size size;
+} SearchUnit;
+
+ARRAY_TYPE(SearchUnitArray, SearchUnit);
+ARRAY_TYPE(SearchMatchArray, SearchMatch);
+
+typedef struct
+{
+    SearchWorker* worker;
+    SearchQuery* query;
+    SearchCompression compression;
+    SearchFileKind kind;
+    u8* in;
+    size in_size;
+    SearchUnit* units;
+    size unit_count;
+    size first_unit;
+    size end_unit;
+    u32 file_index;
+
+    // Results. Offsets and lines count from the scanner's start, which is zero for a range searched on its own.
+    SearchStatus status;
+    SearchMatchArray matches;
+    b32 overflowed; // Too many matches to hold, so the range is searched again once its position is known
+    u64 match_count;
+    u64 resume; // Where the last match ended
+    u64 end_offset;
+    u64 end_newlines;
+    u64 end_line_start;
+} SearchRange;
+
+SearchContext* search_context_create(Arena* arena, WorkQueue* queue)
+{
+    arena_align(arena, 16);
+    SearchContext* context = push_struct(arena, SearchContext);
+    zero_struct(*context);
+    context->queue = queue;
+    context->worker_count = queue ? queue->thread_count + 1 : 1;
+    context->workers = push_array(arena, context->worker_count, SearchWorker);
+    context->scratch = arena_alloc(SEARCH_SCRATCH_MEMORY);
+
+    for (u32 i = 0; i < context->worker_count; ++i)
+    {
+        SearchWorker* worker = &context->workers[i];
+        zero_struct(*worker);
+        worker->arena = arena_alloc(SEARCH_WORKER_MEMORY);
+        worker->read_buffer = push_array(&worker->arena, SEARCH_CHUNK_SIZE, u8);
+        arena_align(&worker->arena, 16);
+        worker->inflater = push_struct(&worker->arena, Inflater);
+        worker->inflate_window = push_array(&worker->arena, SEARCH_INFLATE_WINDOW, u8);
+        worker->zstd = push_struct(&worker->arena, ZstdDecoder);
+        worker->matches = arena_alloc(SEARCH_RANGE_MATCH_MEMORY);
+    }
+    return context;
+}
+
+SearchCompression search_detect_compression(u8* head, size head_size)
+{
+    SearchCompression result = SearchCompression_None;
+    if (head_size >= 3 && head[0] == 0x1F && head[1] == 0x8B && head[2] == 8)
+        result = SearchCompression_Gzip;
+    else if (zstd_is_skippable_frame(head, head_size) ||
+             (head_size >= 4 && head[0] == 0x28 && head[1] == 0xB5 && head[2] == 0x2F && head[3] == 0xFD))
+        result = SearchCompression_Zstd;
+    return result;
+}
+
+//
+// Decompression
+//
+
+// Returns the size of the gzip member header at in, or -1. bgzf_size is the size of the whole member if the header
+// has BGZF's "BC" extra field, and 0 otherwise.
+internal size search_gzip_header_size(u8* in, size in_size, size* bgzf_size)
+{
+    *bgzf_size = 0;
+    if (in_size < 10 || in[0] != 0x1F || in[1] != 0x8B || in[2] != 8 || (in[3] & 0xE0))
+        return -1;
+
+    u32 flags = in[3];
+    size pos = 10;
+    if (flags & GZIP_FLAG_EXTRA)
+    {
+        if (pos + 2 > in_size)
+            return -1;
+        size extra_size = in[pos] | ((size)in[pos + 1] << 8);
+        pos += 2;
+        if (pos + extra_size > in_size)
+            return -1;
+
+        // Subfields are two id bytes, a two byte length and the data
+        size extra_end = pos + extra_size;
+        for (size sub = pos; sub + 4 <= extra_end;)
+        {
+            size sub_size = in[sub + 2] | ((size)in[sub + 3] << 8);
+            if (in[sub] == 'B' && in[sub + 1] == 'C' && sub_size == 2 && sub + 6 <= extra_end)
+                *bgzf_size = (in[sub + 4] | ((size)in[sub + 5] << 8)) + 1;
+            sub += 4 + sub_size;
+        }
+        pos = extra_end;
+    }
+    if (flags & GZIP_FLAG_NAME)
+    {
+        while (pos < in_size && in[pos])
+            ++pos;
+        ++pos;
+    }
+    if (flags & GZIP_FLAG_COMMENT)
+    {
+        while (pos < in_size && in[pos])
+            ++pos;
+        ++pos;
+    }
+    if (flags & GZIP_FLAG_HCRC)
+        pos += 2;
+
+    return (pos <= in_size) ? pos : -1;
+}
+
+// True once a range's scanner has seen enough past its end for every match that starts inside it, or once the
+// scanner has all the matches it was asked for
+internal inline b32 search_scanner_satisfied(SearchScanner* scanner)
+{
+    return scanner->match_count >= scanner->max_count ||
+           (scanner->end != (u64)-1 && scanner->offset >= scanner->end + (u64)scanner->pattern.max_length - 1);
+}
+
+// Feeds plain data to the scanner a chunk at a time. A scanner with an end is only fed what it needs to finish.
+internal SearchStatus search_feed_plain(u8* in, size in_size, SearchScanner* scanner, CancelToken* token,
+                                        size* used)
+{
+    SearchStatus result = SearchStatus_Ok;
+    size pos = 0;
+    while (pos < in_size && !search_scanner_satisfied(scanner))
+    {
+        if (cancel_token_is_cancelled(token))
+        {
+            result = SearchStatus_Cancelled;
+            break;
+        }
+
+        size chunk = (in_size - pos < (size)SEARCH_CHUNK_SIZE) ? in_size - pos : (size)SEARCH_CHUNK_SIZE;
+        if (scanner->end != (u64)-1)
+        {
+            u64 needed = scanner->end + (u64)scanner->pattern.max_length - 1 - scanner->offset;
+            if ((u64)chunk > needed)
+                chunk = (size)needed;
+        }
+        search_scanner_feed(scanner, in + pos, chunk);
+        pos += chunk;
+    }
+    *used = pos;
+    return result;
+}
+
+// Decompresses the gzip member or zstd frame at in into the scanner. member_size is how much input it took.
+// Plain data is taken as one member. Checksums are only verified for members that are decoded to the end.
+internal SearchStatus search_decode_member(SearchWorker* worker, SearchCompression compression, u8* in,
+                                           size in_size, SearchScanner* scanner, CancelToken* token,
+                                           size* member_size)
+{
+    SearchStatus result = SearchStatus_Ok;
+    *member_size = 0;
+
+    if (compression == SearchCompression_None)
+    {
+        result = search_feed_plain(in, in_size, scanner, token, member_size);
+    }
+    else if (compression == SearchCompression_Gzip)
+    {
+        size bgzf_size = 0;
+        size header_size = search_gzip_header_size(in, in_size, &bgzf_size);
+        if (header_size < 0)
+            return SearchStatus_Corrupt;
+
+        Inflater* inflater = worker->inflater;
+        inflate_init(inflater, in + header_size, in_size - header_size, worker->inflate_window,
+                     SEARCH_INFLATE_WINDOW, true);
+        b32 done = false;
+        u32 crc = 0;
+        u64 out_size = 0;
+        for (;;)
+        {
+            InflateResult inflated = inflate_next(inflater);
+            if (inflated.status == InflateStatus_Error)
+            {
+                result = SearchStatus_Corrupt;
+                break;
+            }
+            crc = inflate_crc32(crc, inflated.data, inflated.size);
+            out_size += (u64)inflated.size;
+            search_scanner_feed(scanner, inflated.data, inflated.size);
+            done = inflated.status == InflateStatus_Done;
+            if (done || search_scanner_satisfied(scanner))
+                break;
+            if (cancel_token_is_cancelled(token))
+            {
+                result = SearchStatus_Cancelled;
+                break;
+            }
+        }
+
+        *member_size = header_size + inflate_input_used(inflater) + GZIP_TRAILER_SIZE;
+        if (result == SearchStatus_Ok && *member_size > in_size && !search_scanner_satisfied(scanner))
+        {
+            result = SearchStatus_Corrupt;
+        }
+        else if (result == SearchStatus_Ok && done && *member_size <= in_size)
+        {
+            u8* trailer = in + *member_size - GZIP_TRAILER_SIZE;
+            u32 expected_crc = trailer[0] | ((u32)trailer[1] << 8) | ((u32)trailer[2] << 16) | ((u32)trailer[3] << 24);
+            u32 expected_size = trailer[4] | ((u32)trailer[5] << 8) | ((u32)trailer[6] << 16) | ((u32)trailer[7] << 24);
+            if (crc != expected_crc || (u32)out_size != expected_size)
+                result = SearchStatus_BadChecksum;
+        }
+    }
+    else
+    {
+        if (zstd_is_skippable_frame(in, in_size))
+        {
+            *member_size = zstd_frame_size(in, in_size);
+            return (*member_size > 0) ? SearchStatus_Ok : SearchStatus_Corrupt;
+        }
+
+        ZstdFrameHeader header;
+        if (!zstd_read_frame_header(in, in_size, &header))
+            return SearchStatus_Corrupt;
+
+        // Take the roomy window if it fits and the smallest one that works if it doesn't
+        Arena* arena = &worker->arena;
+        size available = arena->bytes - arena->used;
+        size window_size = zstd_window_buffer_size(&header);
+        if (window_size > available)
+            window_size = zstd_min_window_buffer_size(&header);
+        if (header.dictionary_id || window_size < 0 || window_size > available)
+            return SearchStatus_Unsupported;
+
+        u8* window = push_array(arena, window_size, u8);
+        ZstdDecoder* zstd = worker->zstd;
+        zstd_init(zstd, in, in_size, window, window_size);
+        for (;;)
+        {
+            ZstdResult decoded = zstd_next(zstd);
+            if (decoded.status == ZstdStatus_Error)
+            {
+                result = SearchStatus_Corrupt;
+                break;
+            }
+            search_scanner_feed(scanner, decoded.data, decoded.size);
+            if (decoded.status == ZstdStatus_BadChecksum)
+            {
+                result = SearchStatus_BadChecksum;
+                break;
+            }
+            if (decoded.status == ZstdStatus_Done || search_scanner_satisfied(scanner))
+                break;
+            if (cancel_token_is_cancelled(token))
+            {
+                result = SearchStatus_Cancelled;
+                break;
+            }
+        }
+        *member_size = zstd->in_pos;
+        arena_pop(arena, window_size);
+    }
+
+    return result;
+}
+
+// Decompresses members or frames one after another until the input runs out or the scanner is satisfied
+internal SearchStatus search_decode_stream(SearchWorker* worker, SearchCompression compression, u8* in,
+                                           size in_size, SearchScanner* scanner, CancelToken* token)
+{
+    SearchStatus result = SearchStatus_Ok;
+    b32 bad_checksum = false;
+    size pos = 0;
+    while (pos < in_size && result == SearchStatus_Ok && !search_scanner_satisfied(scanner))
+    {
+        // Like gzip itself, ignore whatever follows the last member if it isn't another one
+        if (compression == SearchCompression_Gzip && pos > 0 &&
+            search_detect_compression(in + pos, in_size - pos) != SearchCompression_Gzip)
+        {
+            break;
+        }
+
+        size member_size = 0;
+        result = search_decode_member(worker, compression, in + pos, in_size - pos, scanner, token, &member_size);
+        pos += member_size;
+
+        // The member still decoded, so the rest of the stream is searched too
+        if (result == SearchStatus_BadChecksum)
+        {
+            bad_checksum = true;
+            result = SearchStatus_Ok;
+        }
+    }
+    if (result == SearchStatus_Ok && bad_checksum)
+        result = SearchStatus_BadChecksum;
+    return result;
+}
+
+//
+// Splitting
+//
+
+internal inline SearchUnit* search_push_unit(SearchUnitArray* units)
+{
+    return (units->count < units->capacity) ? &units->data[units->count++] : 0;
+}
+
+// Finds the independent pieces of a compressed file. Returns the number found, or 0 if the file can't be split.
+internal size search_split_units(Arena* arena, SearchCompression compression, u8* in, size in_size,
+                                 SearchUnitArray* units)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    // Reserved up front so running out of room only means the file isn't split
+    zero_struct(*units);
+    b32 splittable = array_reserve(arena, units, (arena->bytes - arena->used)/2/(size)sizeof(SearchUnit));
+    if (compression == SearchCompression_Gzip)
+    {
+        // Only BGZF members say how big they are. Any other member has to be inflated to find where it ends.
+        for (size pos = 0; pos < in_size && splittable;)
+        {
+            size bgzf_size = 0;
+            SearchUnit* unit = 0;
+            if (search_gzip_header_size(in + pos, in_size - pos, &bgzf_size) < 0 || bgzf_size == 0 ||
+                bgzf_size > in_size - pos || !(unit = search_push_unit(units)))
+            {
+                splittable = false;
+                break;
+            }
+            unit->offset = pos;
+            unit->size = bgzf_size;
+            pos += bgzf_size;
+        }
+    }
+    else
+    {
+        // NOTE(lucas): A seek table lists every frame's size, so nothing but the table has to be touched. Without
+        // one, frame sizes come from walking the block headers, which pages in the whole file once, but the
+        // decoders that follow find it in the page cache.
+        size table_size = 0;
+        size frame_count = 0;
+        size entry_size = 0;
+        if (in_size >= 8 + ZSTD_SEEK_TABLE_FOOTER_SIZE)
+        {
+            u8* footer = in + in_size - ZSTD_SEEK_TABLE_FOOTER_SIZE;
+            u32 magic = footer[5] | ((u32)footer[6] << 8) | ((u32)footer[7] << 16) | ((u32)footer[8] << 24);
+            if (magic == ZSTD_SEEKABLE_MAGIC)
+            {
+                frame_count = footer[0] | ((size)footer[1] << 8) | ((size)footer[2] << 16) | ((size)footer[3] << 24);
+                entry_size = (footer[4] & 0x80) ? 12 : 8;
+                table_size = 8 + frame_count*entry_size + ZSTD_SEEK_TABLE_FOOTER_SIZE;
+            }
+        }
+
+        u8* table = in + in_size - table_size;
+        if (table_size && table_size <= in_size &&
+            (table[0] | ((u32)table[1] << 8) | ((u32)table[2] << 16) | ((u32)table[3] << 24)) ==
+            ZSTD_SEEK_TABLE_MAGIC)
+        {
+            size pos = 0;
+            for (size i = 0; i < frame_count && splittable; ++i)
+            {
+                u8* entry = table + 8 + i*entry_size;
+                size frame_size = entry[0] | ((size)entry[1] << 8) | ((size)entry[2] << 16) | ((size)entry[3] << 24);
+                SearchUnit* unit = search_push_unit(units);
+                if (!unit || frame_size > in_size - table_size - pos)
+                {
+                    splittable = false;
+                    break;
+                }
+                unit->offset = pos;
+                unit->size = frame_size;
+                pos += frame_size;
+            }
+        }
+        else
+        {
+            for (size pos = 0; pos < in_size && splittable;)
+            {
+                size frame_size = zstd_frame_size(in + pos, in_size - pos);
+                if (frame_size <= 0)
+                {
+                    splittable = false;
+                    break;
+                }
+                if (!zstd_is_skippable_frame(in + pos, in_size - pos))
+                {
+                    SearchUnit* unit = search_push_unit(units);
+                    if (!unit)
+                    {
+                        splittable = false;
+                        break;
+                    }
+                    unit->offset = pos;
+                    unit->size = frame_size;
+                }
+                pos += frame_size;
+            }
+        }
+    }
+
+    PROFILE_FUNCTION_END();
+    return splittable ? units->count : 0;
+}
+
+internal void search_range_collect(SearchMatch* match, void* data)
+{
+    SearchRange* range = (SearchRange*)data;
+    if (range->matches.count < range->matches.capacity)
+        range->matches.data[range->matches.count++] = *match;
+    else
+        range->overflowed = true;
+}
+
+// Scans the range's units, then carries on into the next range until every match that starts in this one is seen
+internal void search_range_scan(SearchRange* range, SearchScanner* scanner)
+{
+    b32 bad_checksum = false;
+    for (size i = range->first_unit; i < range->end_unit && range->status == SearchStatus_Ok; ++i)
+    {
+        SearchUnit* unit = &range->units[i];
+        size member_size = 0;
+        range->status = search_decode_member(range->worker, range->compression, range->in + unit->offset,
+                                             unit->size, scanner, range->query->token, &member_size);
+        if (range->status == SearchStatus_BadChecksum)
+        {
+            bad_checksum = true;
+            range->status = SearchStatus_Ok;
+        }
+    }
+
+    // Where the range ends, before anything past it is fed in
+    scanner->end = scanner->offset;
+    range->end_offset = scanner->offset;
+    search_scanner_line_state(scanner, &range->end_newlines, &range->end_line_start);
+
+    if (range->status == SearchStatus_Ok && range->end_unit < range->unit_count)
+    {
+        size next = range->units[range->end_unit].offset;
+        search_decode_stream(range->worker, range->compression, range->in + next, range->in_size - next, scanner,
+                             range->query->token);
+    }
+    range->match_count = scanner->match_count;
+    range->resume = scanner->resume;
+    if (range->status == SearchStatus_Ok && bad_checksum)
+        range->status = SearchStatus_BadChecksum;
+}
+
+internal void search_range_job(void* data)
+{
+    SearchRange* range = (SearchRange*)data;
+
+    // All of the match arena up front, so running out of it is noticed instead of asserting
+    Arena* matches = &range->worker->matches;
+    arena_clear(matches);
+    zero_struct(range->matches);
+    array_reserve(matches, &range->matches, matches->bytes/(size)sizeof(SearchMatch));
+
+    SearchScanner scanner;
+    search_scanner_init(&scanner, range->query, range->kind, range->file_index);
+    scanner.first_line = 0;
+    scanner.on_match = search_range_collect;
+    scanner.match_data = range;
+    search_range_scan(range, &scanner);
+}
+
+// Searches the units on every worker, in ranges of about the same amount of input with at least one unit each
+internal void search_ranges_parallel(SearchContext* context, SearchQuery* query, SearchCompression compression,
+                                     u8* in, size in_size, SearchUnitArray units, u32 file_index,
+                                     SearchFileResult* result)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    Arena* scratch = &context->scratch;
+    size unit_count = units.count;
+    u32 range_count = (unit_count < (size)context->worker_count) ? (u32)unit_count : context->worker_count;
+    SearchRange* ranges = push_array(scratch, range_count, SearchRange);
+    u64 total = (u64)(units.data[unit_count - 1].offset + units.data[unit_count - 1].size);
+    size unit = 0;
+    for (u32 i = 0; i < range_count; ++i)
+    {
+        SearchRange* range = &ranges[i];
+        zero_struct(*range);
+        range->worker = &context->workers[i];
+        range->query = query;
+        range->compression = compression;
+        range->kind = result->kind;
+        range->in = in;
+        range->in_size = in_size;
+        range->units = units.data;
+        range->unit_count = unit_count;
+        range->file_index = file_index;
+        range->first_unit = unit;
+
+        u64 target = total*(i + 1)/range_count;
+        size last_unit = unit_count - (range_count - i - 1);
+        do
+        {
+            ++unit;
+        } while (unit < last_unit && (u64)(units.data[unit].offset + units.data[unit].size) <= target);
+        range->end_unit = (i == range_count - 1) ? unit_count : unit;
+    }
+
+    for (u32 i = 1; i < range_count; ++i)
+        work_queue_add(context->queue, search_range_job, &ranges[i]);
+    search_range_job(&ranges[0]);
+    work_queue_complete_all(context->queue);
+
+    /*
+     * NOTE(lucas): Each range counted from zero, so its matches are moved by everything before it. A match on the
+     * range's first line gets its column from where that line really started. Matches don't overlap, but a range
+     * couldn't know whether one from the range before reached into it, and a range that held too many matches to
+     * keep doesn't have them. Either way it is searched again here, now that it is known where it starts.
+     */
+    u64 base = 0;
+    u64 newlines = 0;
+    u64 line_start = 0;
+    u64 resume = 0;
+    u64 match_count = 0;
+    result->status = SearchStatus_Ok;
+    b32 bad_checksum = false;
+    for (u32 i = 0; i < range_count && result->status == SearchStatus_Ok; ++i)
+    {
+        SearchRange* range = &ranges[i];
+        b32 rescan = range->overflowed || (range->matches.count && base + range->matches.data[0].offset < resume);
+        if (rescan)
+        {
+            SearchScanner scanner;
+            search_scanner_init(&scanner, query, result->kind, file_index);
+            scanner.offset = base;
+            scanner.counted = base;
+            scanner.newlines = newlines;
+            scanner.line_start = line_start;
+            scanner.resume = resume;
+
+            range->worker = &context->workers[0];
+            range->status = SearchStatus_Ok;
+            search_range_scan(range, &scanner);
+
+            base = range->end_offset;
+            newlines = range->end_newlines;
+            line_start = range->end_line_start;
+            resume = scanner.resume;
+        }
+        else
+        {
+            for (size j = 0; j < range->matches.count; ++j)
+            {
+                SearchMatch match = range->matches.data[j];
+                match.offset += base;
+                if (match.line == 0)
+                {
+                    u64 column = match.offset - line_start + 1;
+                    match.column = (column > 0xFFFFFFFFull) ? 0xFFFFFFFFu : (u32)column;
+                }
+                match.line += newlines + 1;
+                if (query->on_match)
+                    query->on_match(&match, query->match_data);
+            }
+            if (range->matches.count)
+                resume = base + range->resume;
+
+            if (range->end_newlines)
+                line_start = base + range->end_line_start;
+            newlines += range->end_newlines;
+            base += range->end_offset;
+        }
+
+        match_count += range->match_count;
+        result->status = range->status;
+        if (result->status == SearchStatus_BadChecksum)
+        {
+            bad_checksum = true;
+            result->status = SearchStatus_Ok;
+        }
+    }
+    if (result->status == SearchStatus_Ok && bad_checksum)
+        result->status = SearchStatus_BadChecksum;
+
+    result->bytes_searched = base;
+    result->match_count = match_count;
+    result->range_count = range_count;
+
+    PROFILE_FUNCTION_END();
+}
+
+// Searches the independent pieces of a compressed file on every worker. Returns false if it can't be split.
+internal b32 search_compressed_parallel(SearchContext* context, SearchQuery* query, SearchCompression compression,
+                                       u8* in, size in_size, u32 file_index, SearchFileResult* result)
+{
+    arena_clear(&context->scratch);
+    SearchUnitArray units;
+    if (search_split_units(&context->scratch, compression, in, in_size, &units) < 2)
+        return false;
+
+    search_ranges_parallel(context, query, compression, in, in_size, units, file_index, result);
+    return true;
+}
+
+// Searches a plain file in a range per worker. The cuts are aligned but otherwise fall anywhere, even mid-line.
+internal void search_plain_parallel(SearchContext* context, SearchQuery* query, u8* in, size in_size, u32 file_index,
+                                    SearchFileResult* result)
+{
+    arena_clear(&context->scratch);
+    SearchUnitArray units = {0};
+    units.capacity = context->worker_count;
+    units.data = push_array(&context->scratch, units.capacity, SearchUnit);
+
+    size start = 0;
+    for (u32 i = 0; i < context->worker_count; ++i)
+    {
+        size end = in_size*(i + 1)/context->worker_count & ~((size)SEARCH_PLAIN_RANGE_ALIGN - 1);
+        if (i == context->worker_count - 1)
+            end = in_size;
+        SearchUnit* unit = search_push_unit(&units);
+        unit->offset = start;
+        unit->size = end - start;
+        start = end;
+    }
+
+    search_ranges_parallel(context, query, SearchCompression_None, in, in_size, units, file_index, result);
+    result->bytes_read = (u64)in_size;
+}
+
+// Plain files in any encoding, since the cuts are aligned and so start on a UTF-16 unit. A search that stops early
+// is better off reading from the start.
+internal inline b32 search_should_split_plain(SearchContext* context, SearchQuery* query, size file_size)
+{
+    return context->worker_count > 1 && file_size >= (size)SEARCH_PARALLEL_MIN_PLAIN_SIZE && !query->max_count;
+}
+
+internal SearchFileResult search_compressed(SearchContext* context, SearchQuery* query, SearchCompression compression,
+                                            u8* in, size in_size, u32 file_index)
+{
+    SearchFileResult result;
+    zero_struct(result);
+    result.compression = compression;
+    result.bytes_read = (u64)in_size;
+
+    b32 parallel = context->worker_count > 1 && in_size >= (size)SEARCH_PARALLEL_MIN_SIZE && !query->max_count;
+    if (!parallel || !search_compressed_parallel(context, query, compression, in, in_size, file_index, &result))
+    {
+        SearchScanner scanner;
+        search_scanner_init(&scanner, query, SearchFileKind_Text, file_index);
+        result.status = search_decode_stream(&context->workers[0], compression, in, in_size, &scanner, query->token);
+        result.bytes_searched = scanner.offset;
+        result.match_count = scanner.match_count;
+        result.range_count = 1;
+    }
+    return result;
+}
+
+// Classifies a file from its head. Returns false if it is binary and should be skipped.
+internal b32 search_classify_head(SearchQuery* query, SearchFileResult* result, u8* head, size head_size)
+{
+    result->kind = search_classify(head, head_size);
+    if (result->kind == SearchFileKind_Binary && !query->include_binary)
+    {
+        result->skipped = true;
+        return false;
+    }
+    return true;
+}
+
+SearchFileResult search_memory(SearchContext* context, SearchQuery* query, u8* data, size data_size, u32 file_index)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    size head_size = (data_size < (size)SEARCH_SNIFF_SIZE) ? data_size : (size)SEARCH_SNIFF_SIZE;
+    SearchCompression compression = search_detect_compression(data, head_size);
+    SearchFileResult result;
+    if (compression != SearchCompression_None)
+    {
+        result = search_compressed(context, query, compression, data, data_size, file_index);
+        result.file_size = (u64)data_size;
+    }
+    else
+    {
+        zero_struct(result);
+        result.file_size = (u64)data_size;
+        result.range_count = 1;
+
+        if (!search_classify_head(query, &result, data, head_size))
+        {
+            result.bytes_read = (u64)head_size;
+        }
+        else if (search_should_split_plain(context, query, data_size))
+        {
+            search_plain_parallel(context, query, data, data_size, file_index, &result);
+        }
+        else
+        {
+            SearchScanner scanner;
+            search_scanner_init(&scanner, query, result.kind, file_index);
+            for (size pos = 0; pos < data_size && !search_scanner_satisfied(&scanner); pos += SEARCH_CHUNK_SIZE)
+            {
+                if (cancel_token_is_cancelled(query->token))
+                {
+                    result.status = SearchStatus_Cancelled;
+                    break;
+                }
+                size chunk = (data_size - pos < (size)SEARCH_CHUNK_SIZE) ? data_size - pos : (size)SEARCH_CHUNK_SIZE;
+                search_scanner_feed(&scanner, data + pos, chunk);
+                result.bytes_read += (u64)chunk;
+            }
+            result.bytes_searched = scanner.offset;
+            result.match_count = scanner.match_count;
+        }
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+SearchFileResult search_file(SearchContext* context, SearchQuery* query, char* filename, u32 file_index)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    SearchFileResult result;
+    zero_struct(result);
+    result.range_count = 1;
+
+    size file_size = file_exists(filename) ? file_get_size(filename) : -1;
+    void* file = (file_size > 0) ? file_open_read(filename) : 0;
+    if (file_size < 0 || (file_size > 0 && !file))
+        result.status = SearchStatus_Unreadable;
+
+    if (file)
+    {
+        // NOTE(lucas): The first few KB say whether the file is compressed, and if not, whether it is worth reading
+        // at all. Nothing past them is read or mapped until both are known.
+        SearchWorker* worker = &context->workers[0];
+        u8* buffer = worker->read_buffer;
+        size filled = (file_size < (size)SEARCH_SNIFF_SIZE) ? file_size : (size)SEARCH_SNIFF_SIZE;
+        size remaining = file_size - filled;
+        if (file_read_stream(file, buffer, filled) != filled)
+        {
+            filled = 0;
+            remaining = 0;
+            result.status = SearchStatus_Unreadable;
+        }
+        result.file_size = (u64)file_size;
+
+        SearchCompression compression = search_detect_compression(buffer, filled);
+        if (compression != SearchCompression_None)
+        {
+            // NOTE(lucas): Decompressors want all of their input at once, so compressed files are mapped instead.
+            // Only the pages being decompressed stay resident, so memory use still doesn't grow with the file.
+            file_close(file);
+            file = 0;
+
+            FileMapping mapping = file_map(filename);
+            if (mapping.data)
+            {
+                result = search_compressed(context, query, compression, mapping.data, mapping.size, file_index);
+                file_unmap(&mapping);
+            }
+            else
+            {
+                result.status = SearchStatus_Unreadable;
+            }
+            result.file_size = (u64)file_size;
+        }
+        else if (!search_classify_head(query, &result, buffer, filled))
+        {
+            result.bytes_read = (u64)filled;
+        }
+        else if (search_should_split_plain(context, query, file_size))
+        {
+            // NOTE(lucas): Mapped like compressed files, so every worker can read its own range of it at once
+            file_close(file);
+            file = 0;
+
+            FileMapping mapping = file_map(filename);
+            if (mapping.data)
+            {
+                search_plain_parallel(context, query, mapping.data, mapping.size, file_index, &result);
+                file_unmap(&mapping);
+            }
+            else
+            {
+                result.status = SearchStatus_Unreadable;
+            }
+        }
+        else
+        {
+            SearchScanner scanner;
+            search_scanner_init(&scanner, query, result.kind, file_index);
+            for (;;)
+            {
+                size wanted = (size)SEARCH_CHUNK_SIZE - filled;
+                if (wanted > remaining)
+                    wanted = remaining;
+                if (wanted > 0)
+                {
+                    // A file that shrinks while it is read just ends early
+                    size got = file_read_stream(file, buffer + filled, wanted);
+                    filled += got;
+                    remaining = (got == wanted) ? remaining - wanted : 0;
+                }
+
+                search_scanner_feed(&scanner, buffer, filled);
+                result.bytes_read += (u64)filled;
+                filled = 0;
+                if (remaining <= 0 || search_scanner_satisfied(&scanner))
+                    break;
+                if (cancel_token_is_cancelled(query->token))
+                {
+                    result.status = SearchStatus_Cancelled;
+                    break;
+                }
+            }
+            result.bytes_searched = scanner.offset;
+            result.match_count = scanner.match_count;
+        }
+
+        if (file)
+            file_close(file);
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+void search_summary_add(SearchSummary* summary, SearchFileResult* result)
+{
+    if (result->skipped)
+    {
+        ++summary->files_skipped_binary;
+        summary->bytes_skipped += result->file_size - result->bytes_read;
+    }
+    else if (result->status == SearchStatus_Ok || result->status == SearchStatus_Cancelled)
+    {
+        ++summary->files_searched;
+    }
+    else
+    {
+        ++summary->files_failed;
+    }
+
+    if (search_is_utf16(result->kind) || result->kind == SearchFileKind_Latin1)
+        ++summary->files_encoded;
+    summary->bytes_read += result->bytes_read;
+    summary->bytes_searched += result->bytes_searched;
+    summary->match_count += result->match_count;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include "channel.h"
+#include "grapple_memory.h"
+#include "inflate.h"
+#include "str.h"
+#include "thread.h"
+#include "types.h"
+#include "zstd.h"
+
+/*
+ * NOTE(lucas): Content search. Files are read a chunk at a time and each chunk is handed to a scanner, which finds
+ * the needle and keeps track of offsets and line numbers as it goes. Compressed files (gzip and zstd, recognized by
+ * their magic numbers rather than their names) are mapped and decompressed a block at a time into a fixed window,
+ * so searching a compressed file takes the same memory as searching a plain one, and matches are reported at their
+ * offsets in the decompressed data.
+ *
+ * A match can straddle two chunks. The scanner keeps the last max_length - 1 bytes it was fed and checks them
+ * against the start of the next chunk, so chunks never have to overlap.
+ *
+ * Case-insensitive searches never copy or convert the data. ASCII letters are compared with their case bit (0x20)
+ * set on the lanes that hold a letter of the needle. Unicode simple case folding turns the start of the needle into
+ * the few literals a match can start with, every case of its first code points, which are looked for at once, and
+ * matches are checked from there a code point at a time. A folded match can take more or fewer bytes than the
+ * needle, so the scanner works with the longest it can be.
+ *
+ * Before anything else, the first SEARCH_SNIFF_SIZE bytes of a file are classified (search_classify). Binary files
+ * are skipped without reading the rest of them. UTF-16 and Latin-1 files are searched as they are, for the needle
+ * written the way they would write it, so they cost no more than UTF-8. Offsets and columns are the file's own
+ * bytes. UTF-16 matches only count if they start on a unit, at an even offset, and lines end at a 0x000A unit.
+ *
+ * Files made of independent pieces (BGZF gzip members, which say how long they are, or zstd frames, ideally with a
+ * seek table) are split into ranges that are decompressed and searched on different workers. Each range counts
+ * lines from zero and its matches are held until the ranges before it are done, then fixed up and reported in
+ * file order. Big plain files are mapped and split the same way, a range per worker, anywhere at all: a range's
+ * scanner reads on past its end far enough to see matches that start inside it, so nothing is lost at the seams.
+ */
+
+#define SEARCH_CHUNK_SIZE MEGABYTES(1)
+#define SEARCH_SNIFF_SIZE KILOBYTES(4)   // Read before deciding how to read the rest
+#define SEARCH_MAX_NEEDLE KILOBYTES(4)
+#define SEARCH_MAX_MATCH (SEARCH_MAX_NEEDLE*3) // Folded, k also matches the 3 byte Kelvin sign
+#define SEARCH_MAX_ENCODED (SEARCH_MAX_NEEDLE*2) // UTF-16 takes two bytes for each byte of ASCII
+#define SEARCH_MAX_LITERALS 8 // Ways a case-folded match can start
+#define SEARCH_MAX_LITERAL 16
+#define SEARCH_INFLATE_WINDOW MEGABYTES(1)
+#define SEARCH_PARALLEL_MIN_SIZE MEGABYTES(1) // Smaller compressed files aren't worth splitting
+#define SEARCH_PARALLEL_MIN_PLAIN_SIZE MEGABYTES(16) // Smaller plain files are read in one pass
+#define SEARCH_PLAIN_RANGE_ALIGN KILOBYTES(64)
+
+// Per worker. Sized for zstd windows up to 32 MB, which covers everything but --long and --ultra.
+#define SEARCH_WORKER_MEMORY MEGABYTES(40)
+#define SEARCH_RANGE_MATCH_MEMORY MEGABYTES(8)
+#define SEARCH_SCRATCH_MEMORY MEGABYTES(8)
+
+typedef enum
+{
+    SearchCompression_None = 0,
+    SearchCompression_Gzip,
+    SearchCompression_Zstd,
+} SearchCompression;
+
+typedef enum
+{
+    SearchFileKind_Text = 0, // Including UTF-8, and compressed files, which aren't classified
+    SearchFileKind_Binary,
+    SearchFileKind_Utf16Le,
+    SearchFileKind_Utf16Be,
+    SearchFileKind_Latin1,   // ISO 8859-1, for text that isn't UTF-8
+} SearchFileKind;
+
+typedef enum
+{
+    SearchCase_Sensitive = 0,
+    SearchCase_Ascii,   // A to Z match a to z, and every other byte only itself
+    SearchCase_Unicode, // Simple case folding (CaseFolding.txt statuses C and S), in any of the encodings
+} SearchCase;
+
+typedef enum
+{
+    SearchStatus_Ok = 0,
+    SearchStatus_Unreadable,  // Missing, not a regular file, or could not be opened or mapped
+    SearchStatus_Corrupt,     // Compressed data that did not decode. Matches before the damage are still reported.
+    SearchStatus_Unsupported, // Compressed with a zstd dictionary or a window too large for SEARCH_WORKER_MEMORY
+    SearchStatus_Cancelled,
+    SearchStatus_BadChecksum, // A gzip member or zstd frame decoded, but not to what its checksum says. Still searched.
+} SearchStatus;
+
+typedef struct
+{
+    u64 offset;     // In the uncompressed data
+    u64 line;       // Starting at 1
+    u32 column;     // In bytes, two per UTF-16 unit, starting at 1. Saturates on absurdly long lines.
+    u32 file_index;
+} SearchMatch;
+
+typedef void SearchMatchCallback(SearchMatch* match, void* data);
+
+typedef struct
+{
+    s8 needle; // At most SEARCH_MAX_NEEDLE bytes
+    SearchCase match_case;
+    SearchMatchCallback* on_match;
+    void* match_data;
+    CancelToken* token; // Optional
+    b32 include_binary; // Search binary files byte for byte instead of skipping them
+    u64 max_count;      // Stop reading a file once it has this many matches. 0 for no limit.
+} SearchQuery;
+
+typedef struct
+{
+    SearchStatus status;
+    SearchCompression compression;
+    SearchFileKind kind;
+    b32 skipped;        // Binary, so only the head was read
+    u64 file_size;
+    u64 bytes_read;     // From disk, so compressed bytes for compressed files
+    u64 bytes_searched; // Uncompressed
+    u64 match_count;
+    u32 range_count;    // Ranges the file was split into, 1 when it was searched in one go
+} SearchFileResult;
+
+// Totals over many files, for the end of a search
+typedef struct
+{
+    u64 files_searched;
+    u64 files_skipped_binary;
+    u64 files_encoded;    // UTF-16 and Latin-1
+    u64 files_failed;     // Any status other than Ok or Cancelled
+    u64 bytes_read;
+    u64 bytes_searched;
+    u64 bytes_skipped;    // Sizes of skipped files, less the head that was read to classify them
+    u64 match_count;
+} SearchSummary;
+
+typedef struct
+{
+    b32 big_endian;
+    b32 at_start;       // Still looking for a byte order mark
+    u32 high_surrogate; // Waiting for its low half
+    b32 has_odd_byte;   // Half a unit left over from the last call
+    u8 odd_byte;
+} SearchTranscoder;
+
+// A needle made ready to be looked for in one kind of file
+typedef struct
+{
+    s8 needle;             // UTF-8
+    SearchFileKind kind;   // Text and binary files are searched for the needle's own bytes
+    SearchCase match_case; // Unicode needles whose letters only have cases in ASCII are searched as Ascii
+    b32 impossible;        // The needle can't be written in kind, like Greek in Latin-1, so nothing matches
+    size unit;             // Matches start at a multiple of it: 2 for UTF-16, 1 otherwise
+    size max_length;       // Of a match, which is the encoded length unless folding changes code points' lengths
+
+    // Sensitive and Ascii: the needle as kind writes it, and for Ascii the bit that makes each byte lowercase (0x20)
+    // where it is an ASCII letter, which encoded has in lower case
+    size length;
+    u8 encoded[SEARCH_MAX_ENCODED];
+    u8 case_bits[SEARCH_MAX_ENCODED];
+
+    // Unicode: every way the needle's first code points can be written, with ASCII in lower case. Each match starts
+    // with one of them and goes on with the needle from rest.
+    size rest;
+    u32 literal_count;
+    u8 literal_lengths[SEARCH_MAX_LITERALS];
+    u8 literals[SEARCH_MAX_LITERALS][SEARCH_MAX_LITERAL];
+    u8 literal_case_bits[SEARCH_MAX_LITERALS][SEARCH_MAX_LITERAL];
+} SearchPattern;
+
+typedef struct
+{
+    SearchPattern pattern;
+    u64 offset;       // Of the next byte fed in
+    u64 counted;      // Lines are counted up to here, which trails offset by the carry
+    u64 newlines;     // Before counted
+    u64 line_start;   // Offset of the first byte of the line counted is on
+    u64 first_line;   // Line number of the first byte fed in
+    u64 resume;       // Matches don't overlap, so none can start before this
+    u64 end;          // No matches are reported at or after this. U64_MAX normally.
+    u64 max_count;    // No matches are looked for once there are this many. U64_MAX normally.
+    u64 match_count;
+    u32 file_index;
+
+    SearchMatchCallback* on_match;
+    void* match_data;
+
+    size carry_size;
+    u8 carry[SEARCH_MAX_MATCH];
+} SearchScanner;
+
+// What one thread needs to read and decompress a file
+typedef struct
+{
+    Arena arena;
+    u8* read_buffer;
+    Inflater* inflater;
+    u8* inflate_window;
+    ZstdDecoder* zstd;
+    Arena matches; // Held matches of a parallel range
+} SearchWorker;
+
+typedef struct
+{
+    WorkQueue* queue; // Optional
+    u32 worker_count;
+    SearchWorker* workers; // The first one belongs to the thread calling search_file
+    Arena scratch;
+} SearchContext;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sets up a worker for the calling thread and one for each thread of the queue, if there is one
+SearchContext* search_context_create(Arena* arena, WorkQueue* queue);
+
+SearchCompression search_detect_compression(u8* head, size head_size);
+
+// Looks for byte order marks, NUL bytes and control bytes in the head of a file
+SearchFileKind search_classify(u8* head, size head_size);
+
+// Searches one file, calling query->on_match for every match in file order on the calling thread
+SearchFileResult search_file(SearchContext* context, SearchQuery* query, char* filename, u32 file_index);
+
+// Searches data that is already in memory, decompressing it first if it is compressed
+SearchFileResult search_memory(SearchContext* context, SearchQuery* query, u8* data, size data_size,
+                               u32 file_index);
+
+void search_summary_add(SearchSummary* summary, SearchFileResult* result);
+
+// The scanner on its own, for callers that produce the data themselves. kind is what search_classify said the data
+// is, or SearchFileKind_Text to search for the needle's own bytes. UTF-16 has to be fed in whole units, but for
+// the last piece.
+void search_scanner_init(SearchScanner* scanner, SearchQuery* query, SearchFileKind kind, u32 file_index);
+void search_scanner_feed(SearchScanner* scanner, u8* data, size data_size);
+
+// For showing text from UTF-16 and Latin-1 files. Converts UTF-16 to UTF-8 in pieces of any size, even odd ones.
+// out needs room for in_size*3/2 + 8 bytes.
+void search_transcoder_init(SearchTranscoder* transcoder, SearchFileKind kind);
+size search_transcode_utf16(SearchTranscoder* transcoder, u8* in, size in_size, u8* out);
+
+// out needs room for in_size*2 bytes
+size search_transcode_latin1(u8* in, size in_size, u8* out);
+
+// Finds the first occurrence of needle in haystack, or returns 0
+u8* search_find(u8* haystack, size haystack_size, s8 needle);
+
+void search_pattern_init(SearchPattern* pattern, s8 needle, SearchCase match_case, SearchFileKind kind);
+
+// Finds the first match that fits in haystack and sets match_length to how long it is, or returns 0. UTF-16 matches
+// can be found at odd offsets, which the caller has to skip.
+u8* search_pattern_find(SearchPattern* pattern, u8* haystack, size haystack_size, size* match_length);
+u64 search_count_newlines(u8* data, size data_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,1030 @@
+#include "atomic.h"
+#include "channel.h"
+#include "containers.h"
+#include "file.h"
+#include "profiler.h"
+#include "search/daemon.h"
+#include "search/replace.h"
+#include "search/search.h"
+#include "search/search_cli.h"
+#include "search/walk.h"
+#include "thread.h"
+#include "timer.h"
+
+#include <stdarg.h> // va_list
+#include <stdio.h> // vsnprintf
+#include <stdlib.h> // strtoull
+#include <string.h> // memchr, memcpy, memset, strcmp, strlen
+
+ARRAY_TYPE(SearchCliPathArray, s8);
+
+typedef struct
+{
+    u32 worker;
+    size offset; // Into the worker's output
+    size length;
+    b32 deferred; // Searched on its own when its turn comes to be written
+    SearchFileResult result;
+} SearchCliFile;
+
+typedef struct SearchCli SearchCli;
+
+typedef struct
+{
+    SearchCli* cli;
+    SearchContext* context;
+    ReplaceWorker* replacer;
+    u32 index;
+    Arena output;
+    SearchCliWriter writer;
+} SearchCliWorker;
+
+struct SearchCli
+{
+    SearchCliFormat format;
+    SearchCliMode mode;
+    b32 show_stats;
+    b32 use_daemon;
+    b32 dry_run;
+    SearchQuery query; // Copied by each search, which sets its own callback
+    ReplaceQuery replace;
+    CancelToken stop;  // Set once the output can't be written
+
+    Arena arena;
+    SearchCliPathArray paths; // Null-terminated
+    size display_skip;        // Leading "./" left off the walked paths when no path was given
+    WalkStats walk_stats;
+    SearchMatchArray daemon_matches;
+    SearchSummary summary;
+    u64 files_with_matches;
+
+    WorkQueue* queue;
+    SearchContext* big_context; // With the queue, for big files
+    u32 worker_count;
+    SearchCliWorker* workers;
+    SearchCliFile* files; // Of the round
+    u32 round_start;
+    u32 round_end;
+    volatile u32 next_file;
+
+    SearchCliWriter out;
+};
+
+internal void search_cli_print_error(char* format, ...)
+{
+    char buffer[1024];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length > (int)sizeof(buffer) - 1)
+        length = (int)sizeof(buffer) - 1;
+    if (length > 0)
+        file_write_stream(file_get_stderr(), buffer, length);
+}
+
+internal void search_cli_print_usage(void)
+{
+    search_cli_print_error(
+        "Usage: grapple search [options] PATTERN [PATH...]\n"
+        "  -c, --count                Print the number of matches in each file that has any\n"
+        "  -l, --files-with-matches   Print the files that match, stopping at each one's first match\n"
+        "  -m, --max-count N          Stop reading a file after N matches\n"
+        "  -i, --ignore-case          Match letters in any case, with Unicode simple case folding\n"
+        "  -g, --glob GLOB            Only search files matching GLOB, or skip them if it starts with '!'\n"
+        "      --hidden               Search hidden files and directories\n"
+        "      --no-ignore            Don't read .gitignore and .ignore files\n"
+        "      --binary               Search binary files instead of skipping them\n"
+        "      --json                 Write one JSON object per line\n"
+        "      --stats                Finish with totals for the walk and the search\n"
+        "      --daemon               Ask the daemon serving the directory, if one is running\n"
+        "Matches in gzip and zstd files are printed without the text of their line.\n");
+}
+
+internal void search_cli_print_replace_usage(void)
+{
+    search_cli_print_error(
+        "Usage: grapple replace [options] PATTERN REPLACEMENT [PATH...]\n"
+        "  -n, --dry-run              Print the diff that would make the change instead of making it\n"
+        "  -g, --glob GLOB            Only change files matching GLOB, or skip them if it starts with '!'\n"
+        "      --hidden               Change hidden files and directories\n"
+        "      --no-ignore            Don't read .gitignore and .ignore files\n"
+        "      --binary               Change binary files instead of skipping them\n"
+        "      --json                 Write one JSON object per line\n"
+        "      --stats                Finish with totals for the walk and the search\n");
+}
+
+//
+// Output
+//
+
+internal void search_cli_flush(SearchCliWriter* writer)
+{
+    if (writer->handle && writer->used && !writer->failed)
+        writer->failed = !file_write_stream(writer->handle, writer->data, writer->used);
+    writer->used = 0;
+}
+
+internal void search_cli_write(SearchCliWriter* writer, void* data, size length)
+{
+    // An empty line can come with no data at all, and memcpy is only defined for real pointers
+    if (length == 0)
+        return;
+
+    if (writer->used + length > writer->capacity)
+    {
+        if (!writer->handle)
+        {
+            writer->overflowed = true;
+            return;
+        }
+
+        search_cli_flush(writer);
+        if (length > writer->capacity)
+        {
+            if (!writer->failed)
+                writer->failed = !file_write_stream(writer->handle, data, length);
+            return;
+        }
+    }
+    memcpy(writer->data + writer->used, data, (usize)length);
+    writer->used += length;
+}
+
+internal inline void search_cli_write_s8(SearchCliWriter* writer, s8 text)
+{
+    search_cli_write(writer, text.data, text.len);
+}
+
+internal void search_cli_write_u64(SearchCliWriter* writer, u64 value)
+{
+    u8 digits[20];
+    size count = 0;
+    do
+    {
+        digits[sizeof(digits) - 1 - count++] = (u8)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    search_cli_write(writer, digits + sizeof(digits) - count, count);
+}
+
+// Quotes text as a JSON string. Bytes from 0x80 up are passed through, so UTF-8 stays UTF-8.
+internal void search_cli_write_json_string(SearchCliWriter* writer, s8 text)
+{
+    search_cli_write_s8(writer, s8("\""));
+    size run_start = 0;
+    for (size i = 0; i < text.len; ++i)
+    {
+        u8 c = text.data[i];
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+
+        search_cli_write(writer, text.data + run_start, i - run_start);
+        run_start = i + 1;
+        if (c == '"' || c == '\\')
+        {
+            u8 escaped[2] = {'\\', c};
+            search_cli_write(writer, escaped, 2);
+        }
+        else if (c == '\n')
+            search_cli_write_s8(writer, s8("\\n"));
+        else if (c == '\t')
+            search_cli_write_s8(writer, s8("\\t"));
+        else if (c == '\r')
+            search_cli_write_s8(writer, s8("\\r"));
+        else
+        {
+            char* hex = "0123456789abcdef";
+            u8 escaped[6] = {'\\', 'u', '0', '0', (u8)hex[c >> 4], (u8)hex[c & 15]};
+            search_cli_write(writer, escaped, 6);
+        }
+    }
+    search_cli_write(writer, text.data + run_start, text.len - run_start);
+    search_cli_write_s8(writer, s8("\""));
+}
+
+// Whether the UTF-16 unit at offset is a newline
+internal inline b32 search_cli_is_newline_unit(SearchCliFileOutput* output, size offset)
+{
+    u8* unit = output->data + offset;
+    if (output->kind == SearchFileKind_Utf16Be)
+        return unit[0] == 0 && unit[1] == '\n';
+    return unit[0] == '\n' && unit[1] == 0;
+}
+
+/*
+ * NOTE(lucas): The line a match is on, without its line ending, cut to SEARCH_CLI_MAX_LINE characters' worth of the
+ * file. UTF-16 and Latin-1 files are searched as they are, and only the lines that are printed are converted to
+ * UTF-8, into buffer, which needs room for SEARCH_CLI_LINE_BUFFER bytes.
+ */
+internal s8 search_cli_match_line(SearchCliFileOutput* output, SearchMatch* match, u8* buffer)
+{
+    s8 result = {0};
+    if (!output->data || match->offset >= (u64)output->data_size)
+        return result;
+
+    b32 utf16 = (output->kind == SearchFileKind_Utf16Le || output->kind == SearchFileKind_Utf16Be);
+    size unit = utf16 ? 2 : 1;
+    size offset = (size)match->offset;
+    size start = offset - ((match->column != 0xFFFFFFFFu) ? (size)match->column - 1 : 0);
+    if (match->column == 0xFFFFFFFFu)
+    {
+        while (start >= unit && (utf16 ? !search_cli_is_newline_unit(output, start - unit)
+                                       : output->data[start - 1] != '\n'))
+        {
+            start -= unit;
+        }
+    }
+
+    size limit = output->data_size - start;
+    if (limit > (size)SEARCH_CLI_MAX_LINE*unit)
+        limit = (size)SEARCH_CLI_MAX_LINE*unit;
+    result.data = output->data + start;
+    result.len = limit;
+    if (utf16)
+    {
+        // Only the line's first unit can be a byte order mark, and only on the first line
+        SearchTranscoder transcoder;
+        search_transcoder_init(&transcoder, output->kind);
+        transcoder.at_start = (start == 0);
+        result.len = search_transcode_utf16(&transcoder, output->data + start, limit, buffer);
+        result.data = buffer;
+    }
+    else if (output->kind == SearchFileKind_Latin1)
+    {
+        result.len = search_transcode_latin1(output->data + start, limit, buffer);
+        result.data = buffer;
+    }
+
+    u8* end = (u8*)memchr(result.data, '\n', (usize)result.len);
+    if (end)
+        result.len = end - result.data;
+    if (result.len > 0 && result.data[result.len - 1] == '\r')
+        --result.len;
+    return result;
+}
+
+void search_cli_write_match(SearchCliFileOutput* output, SearchMatch* match)
+{
+    SearchCliWriter* writer = output->writer;
+    u8 buffer[SEARCH_CLI_LINE_BUFFER];
+    s8 line = search_cli_match_line(output, match, buffer);
+    if (output->format == SearchCliFormat_Json)
+    {
+        search_cli_write_s8(writer, s8("{\"type\":\"match\",\"path\":"));
+        search_cli_write_json_string(writer, output->path);
+        search_cli_write_s8(writer, s8(",\"line\":"));
+        search_cli_write_u64(writer, match->line);
+        search_cli_write_s8(writer, s8(",\"column\":"));
+        search_cli_write_u64(writer, match->column);
+        search_cli_write_s8(writer, s8(",\"offset\":"));
+        search_cli_write_u64(writer, match->offset);
+        search_cli_write_s8(writer, s8(",\"text\":"));
+        if (line.data)
+            search_cli_write_json_string(writer, line);
+        else
+            search_cli_write_s8(writer, s8("null"));
+        search_cli_write_s8(writer, s8("}\n"));
+    }
+    else
+    {
+        search_cli_write_s8(writer, output->path);
+        search_cli_write_s8(writer, s8(":"));
+        search_cli_write_u64(writer, match->line);
+        search_cli_write_s8(writer, s8(":"));
+        search_cli_write_u64(writer, match->column);
+        search_cli_write_s8(writer, s8(":"));
+        search_cli_write_s8(writer, line);
+        search_cli_write_s8(writer, s8("\n"));
+    }
+}
+
+internal void search_cli_on_match(SearchMatch* match, void* data)
+{
+    search_cli_write_match((SearchCliFileOutput*)data, match);
+}
+
+internal void search_cli_write_file_result(SearchCliFileOutput* output, SearchFileResult* result)
+{
+    SearchCliWriter* writer = output->writer;
+    if (!result->match_count || output->mode == SearchCliMode_Matches)
+        return;
+
+    b32 counted = (output->mode == SearchCliMode_Count || output->mode == SearchCliMode_Replace);
+    if (output->format == SearchCliFormat_Json)
+    {
+        search_cli_write_s8(writer, (output->mode == SearchCliMode_Count)   ? s8("{\"type\":\"count\",\"path\":") :
+                                    (output->mode == SearchCliMode_Replace) ? s8("{\"type\":\"replace\",\"path\":") :
+                                                                              s8("{\"type\":\"file\",\"path\":"));
+        search_cli_write_json_string(writer, output->path);
+        if (counted)
+        {
+            search_cli_write_s8(writer, s8(",\"count\":"));
+            search_cli_write_u64(writer, result->match_count);
+        }
+        search_cli_write_s8(writer, s8("}\n"));
+    }
+    else
+    {
+        search_cli_write_s8(writer, output->path);
+        if (counted)
+        {
+            search_cli_write_s8(writer, s8(":"));
+            search_cli_write_u64(writer, result->match_count);
+        }
+        search_cli_write_s8(writer, s8("\n"));
+    }
+}
+
+//
+// Searching
+//
+
+// Lines can only be printed from files whose bytes are their text, in whatever encoding
+internal void search_cli_set_text(SearchCliFileOutput* output, FileMapping* mapping)
+{
+    size head_size = (mapping->size < (size)SEARCH_SNIFF_SIZE) ? mapping->size : (size)SEARCH_SNIFF_SIZE;
+    if (search_detect_compression(mapping->data, head_size) == SearchCompression_None)
+    {
+        output->data = mapping->data;
+        output->data_size = mapping->size;
+        output->kind = search_classify(mapping->data, head_size);
+    }
+}
+
+//
+// Replacing
+//
+
+typedef struct
+{
+    SearchCliFileOutput* output;
+    s8 needle;
+    s8 replacement;
+    u64 covered;    // Matches before this are in a hunk already
+    i64 line_delta; // Lines added by the hunks so far, to number the new version's lines
+    b32 started;    // The file's header is written
+} SearchCliDiff;
+
+// Writes text with prefix at the start of each of its lines, where *line_start says whether it starts one
+internal void search_cli_write_prefixed(SearchCliWriter* writer, s8 text, u8 prefix, b32* line_start)
+{
+    while (text.len > 0)
+    {
+        if (*line_start)
+            search_cli_write(writer, &prefix, 1);
+        u8* newline = (u8*)memchr(text.data, '\n', (usize)text.len);
+        size length = newline ? newline - text.data + 1 : text.len;
+        search_cli_write(writer, text.data, length);
+        *line_start = (newline != 0);
+        text.data += length;
+        text.len -= length;
+    }
+}
+
+internal inline size search_cli_line_end(SearchCliFileOutput* output, size offset)
+{
+    u8* newline = (offset < output->data_size) ?
+        (u8*)memchr(output->data + offset, '\n', (usize)(output->data_size - offset)) : 0;
+    return newline ? newline - output->data : output->data_size;
+}
+
+/*
+ * NOTE(lucas): A hunk covers the lines from the one a match starts on to the one it ends on, and every match in
+ * them. They are found again here, the same way the scanner finds them, leftmost first and without overlapping, and
+ * the matches the scanner reports for them afterwards are skipped. A match that runs past the last line takes the
+ * hunk on to the line it ends on.
+ */
+internal void search_cli_on_diff_match(SearchMatch* match, void* data)
+{
+    SearchCliDiff* diff = (SearchCliDiff*)data;
+    SearchCliFileOutput* output = diff->output;
+    SearchCliWriter* writer = output->writer;
+    if (match->offset < diff->covered || match->offset >= (u64)output->data_size)
+        return;
+
+    u8* text = output->data;
+    size start = (size)match->offset;
+    while (start > 0 && text[start - 1] != '\n')
+        --start;
+    size end = search_cli_line_end(output, (size)match->offset + diff->needle.len);
+    u64 count = 0;
+    for (size at = (size)match->offset; at < end;)
+    {
+        size limit = end + diff->needle.len - 1;
+        if (limit > output->data_size)
+            limit = output->data_size;
+        u8* found = search_find(text + at, limit - at, diff->needle);
+        if (!found || found - text >= end)
+            break;
+        at = (found - text) + diff->needle.len;
+        if (at > end)
+            end = search_cli_line_end(output, at);
+        ++count;
+    }
+    diff->covered = (u64)end;
+
+    s8 before = {text + start, end - start};
+    u64 old_lines = search_count_newlines(before.data, before.len) + 1;
+    i64 added = (i64)search_count_newlines(diff->replacement.data, diff->replacement.len) -
+                (i64)search_count_newlines(diff->needle.data, diff->needle.len);
+    u64 new_lines = (u64)((i64)old_lines + (i64)count*added);
+
+    if (!diff->started)
+    {
+        search_cli_write_s8(writer, s8("--- a/"));
+        search_cli_write_s8(writer, output->path);
+        search_cli_write_s8(writer, s8("\n+++ b/"));
+        search_cli_write_s8(writer, output->path);
+        search_cli_write_s8(writer, s8("\n"));
+        diff->started = true;
+    }
+    search_cli_write_s8(writer, s8("@@ -"));
+    search_cli_write_u64(writer, match->line);
+    search_cli_write_s8(writer, s8(","));
+    search_cli_write_u64(writer, old_lines);
+    search_cli_write_s8(writer, s8(" +"));
+    search_cli_write_u64(writer, (u64)((i64)match->line + diff->line_delta));
+    search_cli_write_s8(writer, s8(","));
+    search_cli_write_u64(writer, new_lines);
+    search_cli_write_s8(writer, s8(" @@\n"));
+    diff->line_delta += (i64)new_lines - (i64)old_lines;
+
+    b32 line_start = true;
+    search_cli_write_prefixed(writer, before, '-', &line_start);
+    search_cli_write_s8(writer, s8("\n"));
+
+    line_start = true;
+    size at = start;
+    for (u64 i = 0; i < count; ++i)
+    {
+        u8* found = search_find(text + at, end - at, diff->needle);
+        search_cli_write_prefixed(writer, (s8){text + at, found - (text + at)}, '+', &line_start);
+        search_cli_write_prefixed(writer, diff->replacement, '+', &line_start);
+        at = (found - text) + diff->needle.len;
+    }
+    search_cli_write_prefixed(writer, (s8){text + at, end - at}, '+', &line_start);
+    if (line_start)
+        search_cli_write(writer, "+", 1);
+    search_cli_write_s8(writer, s8("\n"));
+}
+
+internal SearchFileResult search_cli_replace_dry_run(SearchCli* cli, SearchContext* context,
+                                                     SearchCliFileOutput* output, u32 index)
+{
+    s8 path = cli->paths.data[index];
+    SearchQuery query = cli->query;
+    query.token = &cli->stop;
+    SearchFileResult result;
+    FileMapping mapping = file_map((char*)path.data);
+    if (mapping.data)
+    {
+        // Files that replace_file leaves alone are left out
+        search_cli_set_text(output, &mapping);
+        zero_struct(result);
+        if (output->data && replace_is_supported(&cli->replace, output->kind))
+        {
+            SearchCliDiff diff = {0};
+            diff.output = output;
+            diff.needle = cli->replace.needle;
+            diff.replacement = cli->replace.replacement;
+            query.on_match = (output->format == SearchCliFormat_Plain) ? search_cli_on_diff_match : 0;
+            query.match_data = &diff;
+            result = search_memory(context, &query, mapping.data, mapping.size, index);
+        }
+        file_unmap(&mapping);
+    }
+    else
+    {
+        query.on_match = 0;
+        result = search_file(context, &query, (char*)path.data, index);
+    }
+    return result;
+}
+
+internal SearchFileResult search_cli_replace(SearchCli* cli, ReplaceWorker* replacer, s8 path)
+{
+    ReplaceQuery replace = cli->replace;
+    replace.token = &cli->stop;
+    ReplaceFileResult replaced = replace_file(replacer, &replace, (char*)path.data);
+
+    SearchFileResult result;
+    zero_struct(result);
+    result.range_count = 1;
+    result.skipped = replaced.skipped;
+    result.file_size = replaced.file_size;
+    result.bytes_read = replaced.bytes_read;
+    result.bytes_searched = replaced.bytes_read;
+    result.match_count = replaced.rewritten ? replaced.replacement_count : 0;
+
+    char* reason = 0;
+    switch (replaced.status)
+    {
+        case ReplaceStatus_Ok:
+        case ReplaceStatus_Unsupported: break;
+        case ReplaceStatus_Cancelled: result.status = SearchStatus_Cancelled; break;
+        case ReplaceStatus_Unreadable: reason = "could not be read"; break;
+        case ReplaceStatus_Unwritable: reason = "could not be rewritten"; break;
+        case ReplaceStatus_Changed: reason = "changed while it was being rewritten, so it was left as it was"; break;
+    }
+    if (reason)
+    {
+        result.status = SearchStatus_Unreadable;
+        search_cli_print_error("%s: %s\n", (char*)path.data, reason);
+    }
+    return result;
+}
+
+// Searches one file into writer. Printing lines needs the text at hand, so those files are mapped, while counts and
+// file names come from reading it as a stream, which can stop early.
+internal SearchFileResult search_cli_search(SearchCli* cli, SearchContext* context, ReplaceWorker* replacer,
+                                            SearchCliWriter* writer, u32 index)
+{
+    s8 path = cli->paths.data[index];
+    SearchCliFileOutput output = {0};
+    output.format = cli->format;
+    output.mode = cli->mode;
+    output.writer = writer;
+    output.path = (s8){path.data + cli->display_skip, path.len - cli->display_skip};
+
+    SearchFileResult result;
+    if (cli->mode == SearchCliMode_Replace)
+    {
+        if (cli->dry_run)
+            result = search_cli_replace_dry_run(cli, context, &output, index);
+        else
+            result = search_cli_replace(cli, replacer, path);
+
+        // The diff has said it all already
+        if (!cli->dry_run || output.format != SearchCliFormat_Plain)
+            search_cli_write_file_result(&output, &result);
+        return result;
+    }
+
+    SearchQuery query = cli->query;
+    query.token = &cli->stop;
+    FileMapping mapping = {0};
+    if (cli->mode == SearchCliMode_Matches)
+        mapping = file_map((char*)path.data);
+
+    if (mapping.data)
+    {
+        search_cli_set_text(&output, &mapping);
+        query.on_match = search_cli_on_match;
+        query.match_data = &output;
+        result = search_memory(context, &query, mapping.data, mapping.size, index);
+        file_unmap(&mapping);
+    }
+    else
+    {
+        // Empty and unreadable files end up here too, and come back with no matches or a failure
+        query.on_match = 0;
+        if (cli->mode == SearchCliMode_Files)
+            query.max_count = 1;
+        result = search_file(context, &query, (char*)path.data, index);
+    }
+
+    search_cli_write_file_result(&output, &result);
+    return result;
+}
+
+internal void search_cli_round_job(void* data)
+{
+    SearchCliWorker* worker = (SearchCliWorker*)data;
+    SearchCli* cli = worker->cli;
+    while (!cancel_token_is_cancelled(&cli->stop))
+    {
+        u32 index = atomic_add_u32(&cli->next_file, 1) - 1;
+        if (index >= cli->round_end)
+            break;
+
+        SearchCliFile* file = &cli->files[index - cli->round_start];
+        zero_struct(*file);
+        file->worker = worker->index;
+        file->offset = worker->writer.used;
+
+        // Files aren't split to be rewritten, so there is nothing to gain from waiting
+        char* path = (char*)cli->paths.data[index].data;
+        if (cli->mode != SearchCliMode_Replace && file_exists(path) &&
+            file_get_size(path) >= (size)SEARCH_PARALLEL_MIN_PLAIN_SIZE)
+        {
+            file->deferred = true;
+            continue;
+        }
+
+        // A file that has been rewritten is done, and its line is lost rather than it being rewritten again
+        file->result = search_cli_search(cli, worker->context, worker->replacer, &worker->writer, index);
+        if (worker->writer.overflowed && cli->mode == SearchCliMode_Replace && !cli->dry_run)
+        {
+            worker->writer.overflowed = false;
+            worker->writer.used = file->offset;
+        }
+        else if (worker->writer.overflowed)
+        {
+            // Given back, so the files after it still have room
+            worker->writer.overflowed = false;
+            worker->writer.used = file->offset;
+            file->deferred = true;
+        }
+        file->length = worker->writer.used - file->offset;
+    }
+}
+
+// Replacing prints its own reasons, since it has more ways to fail
+internal void search_cli_add_result(SearchCli* cli, SearchFileResult* result, u32 index)
+{
+    char* reason = 0;
+    switch (cli->mode == SearchCliMode_Replace ? SearchStatus_Ok : result->status)
+    {
+        case SearchStatus_Ok:
+        case SearchStatus_Cancelled: break;
+        case SearchStatus_Unreadable: reason = "could not be read"; break;
+        case SearchStatus_Corrupt: reason = "is corrupt, and was only searched up to the damage"; break;
+        case SearchStatus_Unsupported: reason = "is compressed in a way that can't be searched"; break;
+        case SearchStatus_BadChecksum: reason = "doesn't match its checksum, so what was searched may be wrong"; break;
+    }
+    if (reason)
+        search_cli_print_error("%s: %s\n", (char*)cli->paths.data[index].data + cli->display_skip, reason);
+
+    search_summary_add(&cli->summary, result);
+    if (result->match_count)
+        ++cli->files_with_matches;
+}
+
+internal void search_cli_run(SearchCli* cli)
+{
+    u32 path_count = (u32)cli->paths.count;
+    for (u32 start = 0; start < path_count && !cli->out.failed; start += SEARCH_CLI_ROUND_FILES)
+    {
+        cli->round_start = start;
+        cli->round_end = (path_count - start < SEARCH_CLI_ROUND_FILES) ? path_count : start + SEARCH_CLI_ROUND_FILES;
+        atomic_store_u32(&cli->next_file, start);
+        for (u32 i = 0; i < cli->worker_count; ++i)
+            cli->workers[i].writer.used = 0;
+
+        for (u32 i = 1; i < cli->worker_count; ++i)
+            work_queue_add(cli->queue, search_cli_round_job, &cli->workers[i]);
+        search_cli_round_job(&cli->workers[0]);
+        work_queue_complete_all(cli->queue);
+
+        for (u32 index = start; index < cli->round_end && !cli->out.failed; ++index)
+        {
+            SearchCliFile* file = &cli->files[index - start];
+            if (file->deferred)
+            {
+                file->result = search_cli_search(cli, cli->big_context, cli->workers[0].replacer, &cli->out, index);
+            }
+            else
+            {
+                SearchCliWorker* worker = &cli->workers[file->worker];
+                search_cli_write(&cli->out, worker->writer.data + file->offset, file->length);
+            }
+            search_cli_add_result(cli, &file->result, index);
+        }
+
+        if (cli->out.failed)
+            cancel_token_cancel(&cli->stop);
+    }
+    search_cli_flush(&cli->out);
+}
+
+internal void search_cli_add_path(char* path, size path_length, void* data)
+{
+    SearchCli* cli = (SearchCli*)data;
+    s8 copy = s8_alloc(&cli->arena, path_length + 1);
+    s8* slot = copy.data ? array_push(&cli->arena, &cli->paths) : 0;
+    if (!slot)
+        return;
+    memcpy(copy.data, path, (usize)path_length + 1);
+    copy.len = path_length;
+    *slot = copy;
+}
+
+internal void search_cli_write_stats(SearchCli* cli, f64 elapsed_ms)
+{
+    SearchSummary* summary = &cli->summary;
+    WalkStats* walk = &cli->walk_stats;
+    SearchCliWriter* out = &cli->out;
+    if (cli->format == SearchCliFormat_Json)
+    {
+        u64 values[] = {
+            summary->files_searched, cli->files_with_matches, summary->files_skipped_binary,
+            summary->files_encoded, summary->files_failed, summary->bytes_read, summary->bytes_searched,
+            summary->match_count, walk->directories_listed, walk->directories_pruned, walk->files_ignored,
+        };
+        s8 names[] = {
+            s8("{\"type\":\"summary\",\"files_searched\":"), s8(",\"files_with_matches\":"),
+            s8(",\"files_skipped_binary\":"), s8(",\"files_encoded\":"), s8(",\"files_failed\":"),
+            s8(",\"bytes_read\":"), s8(",\"bytes_searched\":"), s8(",\"match_count\":"),
+            s8(",\"directories_listed\":"), s8(",\"directories_pruned\":"), s8(",\"files_ignored\":"),
+        };
+        for (u32 i = 0; i < countof(values); ++i)
+        {
+            search_cli_write_s8(out, names[i]);
+            search_cli_write_u64(out, values[i]);
+        }
+        search_cli_write_s8(out, s8(",\"elapsed_ms\":"));
+        search_cli_write_u64(out, (u64)elapsed_ms);
+        search_cli_write_s8(out, s8("}\n"));
+        search_cli_flush(out);
+    }
+    else
+    {
+        search_cli_print_error("%llu matches in %llu files\n"
+                               "%llu files searched, %llu skipped as binary, %llu in UTF-16 or Latin-1, %llu failed\n"
+                               "%.1f MB read, %.1f MB searched\n"
+                               "%llu directories listed, %llu pruned, %llu files ignored\n"
+                               "%.1f ms\n",
+                               (unsigned long long)summary->match_count, (unsigned long long)cli->files_with_matches,
+                               (unsigned long long)summary->files_searched,
+                               (unsigned long long)summary->files_skipped_binary,
+                               (unsigned long long)summary->files_encoded,
+                               (unsigned long long)summary->files_failed,
+                               (f64)summary->bytes_read/(f64)MEGABYTES(1),
+                               (f64)summary->bytes_searched/(f64)MEGABYTES(1),
+                               (unsigned long long)walk->directories_listed,
+                               (unsigned long long)walk->directories_pruned,
+                               (unsigned long long)walk->files_ignored, elapsed_ms);
+    }
+}
+
+internal void search_cli_run_local(SearchCli* cli, Arena* arena, char** roots, int root_count, WalkOptions* options)
+{
+    // Files named outright are searched whatever they are called, as long as they exist
+    Arena walk_arena = arena_alloc(MEGABYTES(64));
+    for (int i = 0; i < root_count; ++i)
+    {
+        FileInfo info;
+        if (!file_get_info(roots[i], &info))
+        {
+            search_cli_print_error("%s: No such file or directory\n", roots[i]);
+            cli->summary.files_failed++;
+        }
+        else if (info.kind == FileEntryKind_Directory)
+        {
+            WalkStats stats = walk_tree(&walk_arena, roots[i], options, search_cli_add_path, cli);
+            cli->walk_stats.directories_listed += stats.directories_listed;
+            cli->walk_stats.directories_pruned += stats.directories_pruned;
+            cli->walk_stats.files_visited += stats.files_visited;
+            cli->walk_stats.files_ignored += stats.files_ignored;
+            cli->walk_stats.ignore_files_loaded += stats.ignore_files_loaded;
+        }
+        else
+        {
+            search_cli_add_path(roots[i], (size)strlen(roots[i]), cli);
+        }
+    }
+
+    u32 processor_count = thread_get_processor_count();
+    cli->queue = work_queue_create(arena, processor_count > 1 ? processor_count - 1 : 1);
+    cli->big_context = search_context_create(arena, cli->queue);
+    cli->worker_count = cli->queue->thread_count + 1;
+    cli->workers = push_array(arena, cli->worker_count, SearchCliWorker);
+    for (u32 i = 0; i < cli->worker_count; ++i)
+    {
+        SearchCliWorker* worker = &cli->workers[i];
+        zero_struct(*worker);
+        worker->cli = cli;
+        worker->index = i;
+        worker->context = search_context_create(arena, 0);
+        if (cli->mode == SearchCliMode_Replace)
+            worker->replacer = replace_worker_create(arena);
+        worker->output = arena_alloc(SEARCH_CLI_WORKER_OUTPUT);
+        worker->writer.data = worker->output.data;
+        worker->writer.capacity = worker->output.bytes;
+    }
+    cli->files = push_array(arena, SEARCH_CLI_ROUND_FILES, SearchCliFile);
+
+    search_cli_run(cli);
+}
+
+internal void search_cli_collect(SearchMatch* match, void* data)
+{
+    SearchCli* cli = (SearchCli*)data;
+    SearchMatch* slot = array_push(&cli->arena, &cli->daemon_matches);
+    if (slot)
+        *slot = *match;
+}
+
+/*
+ * NOTE(lucas): The daemon walks and searches, and its matches come through the ring in whatever order the workers
+ * found them, though each file's are in order since one worker searched it. They are gathered and put in file order
+ * with a counting sort, which keeps that order, before anything is written. Paths are printed under the root as it
+ * was given, as a local search would print them. Returns false, having written nothing, if the daemon couldn't
+ * finish, so the search can be run locally instead.
+ */
+internal b32 search_cli_run_daemon(SearchCli* cli, char* root, WalkOptions* options)
+{
+    DaemonClient client;
+    if (!daemon_client_connect(&client, root, options))
+        return false;
+
+    u32 generation = daemon_client_query(&client, cli->query.needle);
+    while (generation && !daemon_client_wait(&client, 10))
+        daemon_client_drain(&client, search_cli_collect, cli);
+    daemon_client_drain(&client, search_cli_collect, cli);
+
+    b32 result = generation && client.paths && !client.reply.stats.cancelled;
+    u32 file_count = client.paths ? client.paths->file_count : 0;
+    u32* starts = result ? push_array(&cli->arena, (size)file_count + 1, u32) : 0;
+    SearchMatch* sorted = result ? push_array(&cli->arena, cli->daemon_matches.count, SearchMatch) : 0;
+    result = result && starts && (sorted || !cli->daemon_matches.count);
+    for (size i = 0; result && i < cli->daemon_matches.count; ++i)
+        result = cli->daemon_matches.data[i].file_index < file_count;
+
+    if (result)
+    {
+        memset(starts, 0, ((usize)file_count + 1)*sizeof(u32));
+        for (size i = 0; i < cli->daemon_matches.count; ++i)
+            ++starts[cli->daemon_matches.data[i].file_index + 1];
+        for (u32 i = 0; i < file_count; ++i)
+            starts[i + 1] += starts[i];
+        for (size i = 0; i < cli->daemon_matches.count; ++i)
+            sorted[starts[cli->daemon_matches.data[i].file_index]++] = cli->daemon_matches.data[i];
+
+        char display[WALK_MAX_PATH*2];
+        size root_length = (size)strlen(root);
+        memcpy(display, root, (usize)root_length);
+        for (size i = 0; i < cli->daemon_matches.count && !cli->out.failed;)
+        {
+            u32 file_index = sorted[i].file_index;
+            size end = i;
+            while (end < cli->daemon_matches.count && sorted[end].file_index == file_index)
+                ++end;
+
+            s8 path = daemon_client_path(&client, file_index);
+            s8 under_root = {path.data + client.paths->root_length, path.len - client.paths->root_length};
+            if (under_root.len < 0 || root_length + under_root.len >= (size)sizeof(display))
+                under_root.len = 0;
+            memcpy(display + root_length, under_root.data, (usize)under_root.len);
+            size display_length = root_length + under_root.len;
+
+            SearchCliFileOutput output = {0};
+            output.format = cli->format;
+            output.mode = cli->mode;
+            output.writer = &cli->out;
+            output.path = (s8){(u8*)display + cli->display_skip, display_length - cli->display_skip};
+
+            SearchFileResult file_result;
+            zero_struct(file_result);
+            file_result.match_count = (u64)(end - i);
+            if (cli->query.max_count && file_result.match_count > cli->query.max_count)
+                file_result.match_count = cli->query.max_count;
+
+            if (cli->mode == SearchCliMode_Matches)
+            {
+                FileMapping mapping = file_map((char*)path.data);
+                if (mapping.data)
+                    search_cli_set_text(&output, &mapping);
+                for (u64 j = 0; j < file_result.match_count; ++j)
+                    search_cli_write_match(&output, &sorted[i + j]);
+                file_unmap(&mapping);
+            }
+            search_cli_write_file_result(&output, &file_result);
+
+            ++cli->files_with_matches;
+            cli->summary.match_count += file_result.match_count;
+            i = end;
+        }
+        search_cli_flush(&cli->out);
+
+        cli->summary.files_searched = client.reply.stats.files_searched;
+        cli->summary.bytes_searched = client.reply.stats.bytes_searched;
+    }
+
+    cli->daemon_matches.count = 0;
+    daemon_client_close(&client);
+    return result;
+}
+
+// "search" and "replace" take the same options, less the ones that only make sense for one of them
+internal int search_cli_run_command(int argc, char** argv, b32 replace)
+{
+    u64 start_ticks = timer_get_os_ticks();
+
+    SearchCli* cli = 0;
+    Arena arena = arena_alloc(MEGABYTES(1));
+    cli = push_struct(&arena, SearchCli);
+    zero_struct(*cli);
+    if (replace)
+        cli->mode = SearchCliMode_Replace;
+
+    WalkOptions options = {0};
+    s8 globs[SEARCH_CLI_MAX_GLOBS];
+    options.globs = globs;
+    char* pattern = 0;
+    char* replacement = 0;
+    char** roots = 0;
+    int root_count = 0;
+    for (int i = 0; i < argc; ++i)
+    {
+        char* arg = argv[i];
+        b32 has_value = i + 1 < argc;
+        if (pattern && replace && !replacement)
+            replacement = arg;
+        else if (pattern)
+        {
+            if (!roots)
+                roots = argv + i;
+            ++root_count;
+        }
+        else if (!replace && (strcmp(arg, "-c") == 0 || strcmp(arg, "--count") == 0))
+            cli->mode = SearchCliMode_Count;
+        else if (!replace && (strcmp(arg, "-l") == 0 || strcmp(arg, "--files-with-matches") == 0))
+            cli->mode = SearchCliMode_Files;
+        else if (!replace && (strcmp(arg, "-m") == 0 || strcmp(arg, "--max-count") == 0) && has_value)
+            cli->query.max_count = strtoull(argv[++i], 0, 10);
+        else if (!replace && (strcmp(arg, "-i") == 0 || strcmp(arg, "--ignore-case") == 0))
+            cli->query.match_case = SearchCase_Unicode;
+        else if (replace && (strcmp(arg, "-n") == 0 || strcmp(arg, "--dry-run") == 0))
+            cli->dry_run = true;
+        else if ((strcmp(arg, "-g") == 0 || strcmp(arg, "--glob") == 0) && has_value &&
+                 options.glob_count < SEARCH_CLI_MAX_GLOBS)
+        {
+            char* glob = argv[++i];
+            globs[options.glob_count++] = (s8){(u8*)glob, (size)strlen(glob)};
+        }
+        else if (strcmp(arg, "--hidden") == 0)
+            options.include_hidden = true;
+        else if (strcmp(arg, "--no-ignore") == 0)
+            options.no_ignore_files = true;
+        else if (strcmp(arg, "--binary") == 0)
+            cli->query.include_binary = true;
+        else if (strcmp(arg, "--json") == 0)
+            cli->format = SearchCliFormat_Json;
+        else if (strcmp(arg, "--stats") == 0)
+            cli->show_stats = true;
+        else if (!replace && strcmp(arg, "--daemon") == 0)
+            cli->use_daemon = true;
+        else if (strcmp(arg, "--") == 0 && has_value)
+            pattern = argv[++i];
+        else if (arg[0] == '-' && arg[1])
+        {
+            search_cli_print_error("Unknown option %s\n", arg);
+            if (replace)
+                search_cli_print_replace_usage();
+            else
+                search_cli_print_usage();
+            return 2;
+        }
+        else
+            pattern = arg;
+    }
+
+    size pattern_length = pattern ? (size)strlen(pattern) : 0;
+    if (pattern_length == 0 || pattern_length > (size)SEARCH_MAX_NEEDLE || (replace && !replacement))
+    {
+        if (replace)
+            search_cli_print_replace_usage();
+        else
+            search_cli_print_usage();
+        return 2;
+    }
+    cli->query.needle = (s8){(u8*)pattern, pattern_length};
+    cli->replace.needle = cli->query.needle;
+    cli->replace.replacement = replacement ? (s8){(u8*)replacement, (size)strlen(replacement)} : (s8){0};
+    cli->replace.include_binary = cli->query.include_binary;
+
+    char* default_root = ".";
+    if (!roots)
+    {
+        roots = &default_root;
+        root_count = 1;
+        cli->display_skip = 2;
+    }
+
+    cli->arena = arena_alloc(SEARCH_CLI_PATH_MEMORY);
+    Arena output_arena = arena_alloc(SEARCH_CLI_OUTPUT_SIZE);
+    cli->out.data = output_arena.data;
+    cli->out.capacity = output_arena.bytes;
+    cli->out.handle = file_get_stdout();
+
+    // NOTE(lucas): --daemon asks the daemon serving the root, if one is running, and searches directly if not. The
+    // daemon's queries are case-sensitive, so --ignore-case searches directly too.
+    b32 searched = cli->use_daemon && root_count == 1 && cli->query.match_case == SearchCase_Sensitive &&
+                   search_cli_run_daemon(cli, roots[0], &options);
+    if (!searched)
+        search_cli_run_local(cli, &arena, roots, root_count, &options);
+
+    if (cli->show_stats && !cli->out.failed)
+    {
+        f64 elapsed_ms = 1000.0*(f64)(timer_get_os_ticks() - start_ticks)/(f64)timer_get_os_frequency();
+        search_cli_write_stats(cli, elapsed_ms);
+    }
+
+    // Like grep, a file that couldn't be searched is an error even when others matched
+    int result = cli->summary.match_count ? 0 : 1;
+    if (cli->summary.files_failed)
+        result = 2;
+    return result;
+}
+
+int search_cli_main(int argc, char** argv)
+{
+    return search_cli_run_command(argc, argv, false);
+}
+
+int search_cli_replace_main(int argc, char** argv)
+{
+    return search_cli_run_command(argc, argv, true);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "grapple_memory.h"
+#include "search/search.h"
+#include "search/walk.h"
+#include "str.h"
+#include "thread.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): "grapple search" runs the search engine from the command line, without a window or a renderer, for
+ * scripts and pipelines:
+ *
+ *   grapple search [options] PATTERN [PATH...]
+ *
+ * Directories are walked with their ignore files as in the UI, and files named on the command line are searched
+ * whatever they are called. Files are searched in rounds of SEARCH_CLI_ROUND_FILES, each worker taking the next file
+ * and writing what it found to its own buffer, and each round is written out in walk order before the next starts.
+ * Big files are searched on their own between rounds, so they can be split between the workers. Output goes to
+ * stdout SEARCH_CLI_OUTPUT_SIZE bytes at a time, as "path:line:column:text" lines, one per match, or as NDJSON.
+ *
+ * Matches in gzip and zstd files are printed without their text, as "path:line:column:" or with "text":null. Those
+ * files are decompressed a window at a time, in ranges that are searched out of order, so by the time a match is
+ * printed the data it was found in is gone.
+ *
+ * --count only counts, so it never looks at the text around a match, and --files-with-matches stops reading a file
+ * at its first match. --ignore-case matches with Unicode simple case folding (search.h). --daemon hands the walk
+ * and the search to the daemon serving the directory (search/daemon.h), and only reads the files that matched, for
+ * their lines. The daemon only matches case for case, so --ignore-case doesn't use it.
+ *
+ *   grapple replace [options] PATTERN REPLACEMENT [PATH...]
+ *
+ * walks and reads the same way, and rewrites every file that matches with search/replace.h, printing each one's
+ * path and number of replacements. With --dry-run nothing is written, and the output is instead the unified diff
+ * that would make the change: a hunk for each line with matches, or each group of lines that matches span, with no
+ * lines of context.
+ */
+
+#define SEARCH_CLI_OUTPUT_SIZE MEGABYTES(1)
+#define SEARCH_CLI_ROUND_FILES 1024
+#define SEARCH_CLI_WORKER_OUTPUT MEGABYTES(64) // Per round. A file whose output doesn't fit is searched again alone.
+#define SEARCH_CLI_MAX_LINE 512                // Bytes of a matching line that are printed, or UTF-16 units
+#define SEARCH_CLI_LINE_BUFFER (SEARCH_CLI_MAX_LINE*3 + 8) // A line converted to UTF-8, 3 bytes per unit at most
+#define SEARCH_CLI_PATH_MEMORY MEGABYTES(512)  // Reserved for the walked paths, and only committed as it is used
+#define SEARCH_CLI_MAX_GLOBS 64
+
+typedef enum
+{
+    SearchCliFormat_Plain = 0,
+    SearchCliFormat_Json, // One object per line
+} SearchCliFormat;
+
+typedef enum
+{
+    SearchCliMode_Matches = 0,
+    SearchCliMode_Count,
+    SearchCliMode_Files, // Files with matches
+    SearchCliMode_Replace,
+} SearchCliMode;
+
+typedef struct
+{
+    u8* data;
+    size used;
+    size capacity;
+    void* handle;    // Flushed to when full. Without one, running out of room is an overflow.
+    b32 overflowed;
+    b32 failed;      // The reader went away
+} SearchCliWriter;
+
+typedef struct
+{
+    SearchCliFormat format;
+    SearchCliMode mode;
+    SearchCliWriter* writer;
+    s8 path;        // As printed
+    u8* data;       // The file's text if it is plain, for printing the lines that match
+    size data_size;
+    SearchFileKind kind; // What data is written in
+} SearchCliFileOutput;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// argv starts after "search". Returns the exit code: 0 if anything matched, 1 if nothing did, and 2 on bad arguments
+// or if any file couldn't be searched, which is printed to stderr as "path: reason".
+int search_cli_main(int argc, char** argv);
+
+// argv starts after "replace". Returns 0 if anything was replaced, or would have been with --dry-run, 1 if nothing
+// matched, and 2 on bad arguments or if any file couldn't be read or rewritten.
+int search_cli_replace_main(int argc, char** argv);
+
+void search_cli_write_match(SearchCliFileOutput* output, SearchMatch* match);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,493 @@
+#include "atomic.h"
+#include "containers.h"
+#include "file.h"
+#include "profiler.h"
+#include "search/snapshot.h"
+#include "search/walk.h"
+
+#include <string.h> // memcmp, memcpy, strlen
+
+#define SNAPSHOT_ALIGN(value) (((value) + 7) & ~(u64)7)
+
+u64 snapshot_options_hash(s8 root, WalkOptions* options)
+{
+    u64 result = hash_u64(s8_hash(root) ^ ((u64)(options->include_hidden != 0) << 1) ^
+                          (u64)(options->no_ignore_files != 0));
+    for (u32 i = 0; i < options->glob_count; ++i)
+        result = hash_u64(result ^ s8_hash(options->globs[i]));
+    return result;
+}
+
+// Roots are compared as given, less any trailing slashes
+internal s8 snapshot_trim_root(char* root)
+{
+    s8 result = {(u8*)root, (size)strlen(root)};
+    while (result.len > 0 && (result.data[result.len - 1] == '/' || result.data[result.len - 1] == '\\'))
+        --result.len;
+    return result;
+}
+
+//
+// Reading
+//
+
+b32 snapshot_from_memory(Snapshot* snapshot, u8* data, size data_size)
+{
+    zero_struct(*snapshot);
+    SnapshotHeader* header = (SnapshotHeader*)data;
+    if (data_size < (size)sizeof(SnapshotHeader) || header->magic != SNAPSHOT_MAGIC ||
+        header->version != SNAPSHOT_VERSION || header->file_size != (u64)data_size || header->node_count == 0)
+        return false;
+
+    u64 nodes_offset = SNAPSHOT_ALIGN(sizeof(SnapshotHeader) + (u64)header->root_length);
+    u64 directories_offset = nodes_offset + (u64)header->node_count*sizeof(SnapshotNode);
+    u64 names_offset = directories_offset + (u64)header->directory_count*sizeof(SnapshotDirectory);
+    if (names_offset + header->names_size != (u64)data_size)
+        return false;
+
+    SnapshotNode* nodes = (SnapshotNode*)(data + nodes_offset);
+    SnapshotDirectory* directories = (SnapshotDirectory*)(data + directories_offset);
+
+    // NOTE(lucas): Parents before children is what lets paths be built in one pass, so it is checked rather than
+    // trusted, along with everything else that would send a reader out of bounds
+    if (nodes[0].parent != SNAPSHOT_NO_PARENT || nodes[0].kind != FileEntryKind_Directory)
+        return false;
+    for (u32 i = 0; i < header->node_count; ++i)
+    {
+        SnapshotNode* node = &nodes[i];
+        if ((u64)node->name_offset + node->name_length > header->names_size || node->name_length > WALK_MAX_PATH)
+            return false;
+        if (i > 0 && (node->parent >= i || nodes[node->parent].kind != FileEntryKind_Directory))
+            return false;
+    }
+    for (u32 i = 0; i < header->directory_count; ++i)
+    {
+        if (directories[i].node >= header->node_count || nodes[directories[i].node].kind != FileEntryKind_Directory)
+            return false;
+    }
+
+    snapshot->header = header;
+    snapshot->root.data = data + sizeof(SnapshotHeader);
+    snapshot->root.len = header->root_length;
+    snapshot->nodes = nodes;
+    snapshot->directories = directories;
+    snapshot->names = data + names_offset;
+    return true;
+}
+
+b32 snapshot_open(Snapshot* snapshot, char* filename, char* root, WalkOptions* options)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    zero_struct(*snapshot);
+    FileMapping mapping = file_map(filename);
+    b32 result = mapping.data && snapshot_from_memory(snapshot, mapping.data, mapping.size);
+
+    s8 trimmed = snapshot_trim_root(root);
+    if (result && (!s8_equal(snapshot->root, trimmed) ||
+                   snapshot->header->options_hash != snapshot_options_hash(trimmed, options)))
+        result = false;
+
+    if (result)
+        snapshot->mapping = mapping;
+    else
+    {
+        file_unmap(&mapping);
+        zero_struct(*snapshot);
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+void snapshot_close(Snapshot* snapshot)
+{
+    file_unmap(&snapshot->mapping);
+    zero_struct(*snapshot);
+}
+
+void snapshot_for_each_file(Snapshot* snapshot, Arena* scratch, SnapshotFileCallback* visit, void* data)
+{
+    if (!snapshot->header)
+        return;
+
+    PROFILE_FUNCTION_BEGIN();
+
+    // NOTE(lucas): In pre-order everything between a directory and its next entry is inside the directory, so the
+    // start of the path buffer still holds the parent's path when a node is reached. Only the lengths are kept.
+    u32 node_count = snapshot->header->node_count;
+    u32* lengths = push_array(scratch, node_count, u32);
+    char path[WALK_MAX_PATH];
+    if (lengths)
+    {
+        lengths[0] = 0;
+        for (u32 i = 1; i < node_count; ++i)
+        {
+            SnapshotNode* node = &snapshot->nodes[i];
+            u32 length = lengths[node->parent];
+            u32 name_start = length ? length + 1 : 0;
+            lengths[i] = length;
+            if (length == 0xFFFFFFFFu || (u64)name_start + node->name_length >= WALK_MAX_PATH)
+            {
+                lengths[i] = 0xFFFFFFFFu; // Too long, along with everything under it
+                continue;
+            }
+
+            if (length)
+                path[length] = '/';
+            memcpy(path + name_start, snapshot->names + node->name_offset, node->name_length);
+            lengths[i] = name_start + node->name_length;
+            path[lengths[i]] = 0;
+
+            if (node->kind == FileEntryKind_File)
+            {
+                s8 file_path = {(u8*)path, lengths[i]};
+                visit(file_path, node, data);
+            }
+        }
+        arena_pop(scratch, (size)node_count*(size)sizeof(u32));
+    }
+
+    PROFILE_FUNCTION_END();
+}
+
+// Writes the root, then the node's path under it. Returns the length, or -1 if it doesn't fit.
+internal size snapshot_node_path(Snapshot* snapshot, u32 index, char* buffer, size capacity)
+{
+    size length = snapshot->root.len;
+    for (u32 i = index; i != 0; i = snapshot->nodes[i].parent)
+        length += 1 + snapshot->nodes[i].name_length;
+    if (length + 1 > capacity)
+        return -1;
+
+    memcpy(buffer, snapshot->root.data, (usize)snapshot->root.len);
+    buffer[length] = 0;
+    size end = length;
+    for (u32 i = index; i != 0; i = snapshot->nodes[i].parent)
+    {
+        SnapshotNode* node = &snapshot->nodes[i];
+        end -= node->name_length;
+        memcpy(buffer + end, snapshot->names + node->name_offset, node->name_length);
+        buffer[--end] = '/';
+    }
+    return length;
+}
+
+// path has room after it for an ignore file's name
+internal u64 snapshot_rules_modified(char* path, size length)
+{
+    char* names[] = {"/.gitignore", "/.ignore"};
+    u64 result = 0;
+    for (u32 i = 0; i < countof(names); ++i)
+    {
+        memcpy(path + length, names[i], strlen(names[i]) + 1);
+        FileInfo info;
+        if (file_get_info(path, &info) && info.modified > result)
+            result = info.modified;
+    }
+    path[length] = 0;
+    return result;
+}
+
+b32 snapshot_is_stale(Snapshot* snapshot)
+{
+    if (!snapshot->header)
+        return true;
+
+    PROFILE_FUNCTION_BEGIN();
+
+    b32 result = false;
+    char path[WALK_MAX_PATH + 16];
+    for (u32 i = 0; i < snapshot->header->directory_count && !result; ++i)
+    {
+        SnapshotDirectory* directory = &snapshot->directories[i];
+        SnapshotNode* node = &snapshot->nodes[directory->node];
+        size length = snapshot_node_path(snapshot, directory->node, path, WALK_MAX_PATH);
+        if (length < 0)
+            continue;
+
+        FileInfo info;
+        char* stat_path = length ? path : "/";
+        result = !file_get_info(stat_path, &info) || info.kind != FileEntryKind_Directory ||
+                 info.modified != node->modified;
+        if (!result && (snapshot->header->flags & SNAPSHOT_FLAG_RULES))
+            result = snapshot_rules_modified(path, length) != directory->rules_modified;
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+//
+// Writing
+//
+
+void snapshot_builder_init(SnapshotBuilder* builder, Arena* arena, s8 root, WalkOptions* options)
+{
+    zero_struct(builder->nodes);
+    zero_struct(builder->directories);
+    zero_struct(builder->names);
+    builder->arena = arena;
+    builder->file_count = 0;
+    builder->depth = 0;
+    builder->flags = options->no_ignore_files ? 0 : SNAPSHOT_FLAG_RULES;
+
+    while (root.len > 0 && (root.data[root.len - 1] == '/' || root.data[root.len - 1] == '\\'))
+        --root.len;
+    builder->root = s8_alloc(arena, root.len + 1);
+    memcpy(builder->root.data, root.data, (usize)root.len);
+    builder->root.data[root.len] = 0;
+    builder->root.len = root.len;
+    builder->options_hash = snapshot_options_hash(builder->root, options);
+
+    snapshot_name_map_init(&builder->interned, arena, 1024);
+}
+
+internal b32 snapshot_intern(SnapshotBuilder* builder, s8 name, u32* offset)
+{
+    u64 hash = s8_hash(name);
+    u32* existing = snapshot_name_map_get(&builder->interned, hash);
+    if (existing)
+    {
+        s8 stored = {builder->names.data + *existing, name.len};
+        if ((size)*existing + name.len <= builder->names.count && s8_equal(stored, name))
+        {
+            *offset = *existing;
+            return true;
+        }
+    }
+
+    // A hash collision keeps the first name and just stores this one again
+    size start = builder->names.count;
+    if (start + name.len > 0xFFFFFFFFll || !array_reserve(builder->arena, &builder->names, start + name.len))
+        return false;
+    memcpy(builder->names.data + start, name.data, (usize)name.len);
+    builder->names.count += name.len;
+    *offset = (u32)start;
+    if (!existing)
+        snapshot_name_map_put(&builder->interned, hash, *offset);
+    return true;
+}
+
+b32 snapshot_builder_add(SnapshotBuilder* builder, s8 path, FileInfo* info, u64 rules_modified)
+{
+    u32 parent = SNAPSHOT_NO_PARENT;
+    s8 name = path;
+    if (path.len == 0)
+    {
+        ASSERT(builder->nodes.count == 0, "Only the first node can be the root");
+        if (builder->nodes.count != 0)
+            return false;
+    }
+    else
+    {
+        size parent_length = 0;
+        for (size i = path.len; i > 0; --i)
+        {
+            if (path.data[i - 1] == '/')
+            {
+                parent_length = i - 1;
+                break;
+            }
+        }
+        name.data += parent_length ? parent_length + 1 : 0;
+        name.len -= parent_length ? parent_length + 1 : 0;
+
+        while (builder->depth > 0 && builder->stack_lengths[builder->depth - 1] != parent_length)
+            --builder->depth;
+        if (builder->depth == 0)
+            return false;
+        parent = builder->stack_nodes[builder->depth - 1];
+    }
+
+    u32 name_offset = 0;
+    if (!snapshot_intern(builder, name, &name_offset))
+        return false;
+
+    u32 index = (u32)builder->nodes.count;
+    SnapshotNode* node = array_push(builder->arena, &builder->nodes);
+    if (!node)
+        return false;
+    node->parent = parent;
+    node->name_offset = name_offset;
+    node->name_length = (u32)name.len;
+    node->kind = (u32)info->kind;
+    node->size = info->size;
+    node->modified = info->modified;
+    node->id = info->id;
+
+    if (info->kind == FileEntryKind_Directory)
+    {
+        SnapshotDirectory* directory = array_push(builder->arena, &builder->directories);
+        if (!directory || builder->depth == countof(builder->stack_nodes))
+            return false;
+        directory->node = index;
+        directory->reserved = 0;
+        directory->rules_modified = rules_modified;
+
+        builder->stack_nodes[builder->depth] = index;
+        builder->stack_lengths[builder->depth] = path.len;
+        ++builder->depth;
+    }
+    else
+        ++builder->file_count;
+    return true;
+}
+
+typedef struct
+{
+    SnapshotBuilder* builder;
+    size prefix_length; // Of the root and the slash after it
+} SnapshotCrawl;
+
+internal void snapshot_crawl_directory(char* path, size path_length, void* data)
+{
+    SnapshotCrawl* crawl = (SnapshotCrawl*)data;
+    SnapshotBuilder* builder = crawl->builder;
+
+    // A directory that can't be looked at is still added, so its entries have a parent. Its zero time will never
+    // match, so the next check finds the snapshot stale.
+    FileInfo info = {0};
+    char* stat_path = path_length ? path : "/";
+    file_get_info(stat_path, &info);
+    info.kind = FileEntryKind_Directory;
+
+    u64 rules_modified = 0;
+    if ((builder->flags & SNAPSHOT_FLAG_RULES) && path_length + 16 < WALK_MAX_PATH)
+        rules_modified = snapshot_rules_modified(path, path_length);
+
+    s8 relative = {0};
+    if (path_length >= crawl->prefix_length)
+    {
+        relative.data = (u8*)path + crawl->prefix_length;
+        relative.len = path_length - crawl->prefix_length;
+    }
+    snapshot_builder_add(builder, relative, &info, rules_modified);
+}
+
+internal void snapshot_crawl_file(char* path, size path_length, void* data)
+{
+    SnapshotCrawl* crawl = (SnapshotCrawl*)data;
+    FileInfo info;
+    if (file_get_info(path, &info) && info.kind == FileEntryKind_File)
+    {
+        s8 relative = {(u8*)path + crawl->prefix_length, path_length - crawl->prefix_length};
+        snapshot_builder_add(crawl->builder, relative, &info, 0);
+    }
+}
+
+WalkStats snapshot_crawl(SnapshotBuilder* builder, Arena* scratch, WalkOptions* options)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    WalkOptions crawl_options = *options;
+    crawl_options.on_directory = snapshot_crawl_directory;
+    SnapshotCrawl crawl = {builder, builder->root.len + 1};
+    WalkStats result = walk_tree(scratch, (char*)builder->root.data, &crawl_options, snapshot_crawl_file, &crawl);
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
+
+s8 snapshot_builder_finish(SnapshotBuilder* builder)
+{
+    s8 result = {0};
+    if (builder->nodes.count == 0)
+        return result;
+
+    u64 nodes_offset = SNAPSHOT_ALIGN(sizeof(SnapshotHeader) + (u64)builder->root.len);
+    u64 directories_offset = nodes_offset + (u64)builder->nodes.count*sizeof(SnapshotNode);
+    u64 names_offset = directories_offset + (u64)builder->directories.count*sizeof(SnapshotDirectory);
+    u64 file_size = names_offset + (u64)builder->names.count;
+
+    arena_align(builder->arena, 8);
+    u8* data = push_array(builder->arena, (size)file_size, u8);
+    if (!data)
+        return result;
+
+    SnapshotHeader* header = (SnapshotHeader*)data;
+    zero_struct(*header);
+    header->magic = SNAPSHOT_MAGIC;
+    header->version = SNAPSHOT_VERSION;
+    header->file_size = file_size;
+    header->options_hash = builder->options_hash;
+    header->root_length = (u32)builder->root.len;
+    header->node_count = (u32)builder->nodes.count;
+    header->directory_count = (u32)builder->directories.count;
+    header->file_count = builder->file_count;
+    header->names_size = (u64)builder->names.count;
+    header->flags = builder->flags;
+
+    u8* root = data + sizeof(SnapshotHeader);
+    memcpy(root, builder->root.data, (usize)builder->root.len);
+    memset(root + builder->root.len, 0, (usize)(nodes_offset - sizeof(SnapshotHeader) - (u64)builder->root.len));
+    memcpy(data + nodes_offset, builder->nodes.data, (usize)builder->nodes.count*sizeof(SnapshotNode));
+    memcpy(data + directories_offset, builder->directories.data,
+           (usize)builder->directories.count*sizeof(SnapshotDirectory));
+    memcpy(data + names_offset, builder->names.data, (usize)builder->names.count);
+
+    result.data = data;
+    result.len = (size)file_size;
+    return result;
+}
+
+b32 snapshot_write(s8 image, char* filename)
+{
+    char temp[WALK_MAX_PATH];
+    size length = (size)strlen(filename);
+    if (!image.data || length + 5 > WALK_MAX_PATH)
+        return false;
+    memcpy(temp, filename, (usize)length);
+    memcpy(temp + length, ".tmp", 5);
+
+    // The paths in it are no one else's business, whatever the permissions of the tree they came from
+    void* file = file_open(temp, FileMode_Create|FileMode_Private);
+    if (!file)
+        return false;
+    b32 written = file_write(file, image.data, image.len) == image.len && file_flush(file);
+    file_close(file);
+
+    b32 result = written && file_replace(temp, filename);
+    if (!result)
+        file_delete(temp);
+    return result;
+}
+
+//
+// Background refresh
+//
+
+void snapshot_refresh_init(SnapshotRefresh* refresh, char* root, char* filename, WalkOptions* options,
+                           Snapshot* current)
+{
+    zero_struct(*refresh);
+    refresh->root = root;
+    refresh->filename = filename;
+    refresh->options = options;
+    refresh->current = current;
+    refresh->arena = arena_alloc(SNAPSHOT_BUILD_MEMORY);
+    refresh->scratch = arena_alloc(SNAPSHOT_SCRATCH_MEMORY);
+}
+
+void snapshot_refresh_job(void* data)
+{
+    SnapshotRefresh* refresh = (SnapshotRefresh*)data;
+    refresh->changed = snapshot_is_stale(refresh->current);
+    refresh->written = false;
+    zero_struct(refresh->image);
+    zero_struct(refresh->stats);
+
+    if (refresh->changed && refresh->arena.data && refresh->scratch.data)
+    {
+        arena_clear(&refresh->arena);
+        arena_clear(&refresh->scratch);
+        SnapshotBuilder* builder = push_struct(&refresh->arena, SnapshotBuilder);
+        s8 root = {(u8*)refresh->root, (size)strlen(refresh->root)};
+        snapshot_builder_init(builder, &refresh->arena, root, refresh->options);
+        refresh->stats = snapshot_crawl(builder, &refresh->scratch, refresh->options);
+        refresh->image = snapshot_builder_finish(builder);
+        refresh->written = snapshot_write(refresh->image, refresh->filename);
+    }
+
+    atomic_store_u32(&refresh->done, 1);
+}
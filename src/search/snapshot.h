@@ -0,0 +1,155 @@
+#pragma once
+
+#include "containers.h"
+#include "file.h"
+#include "grapple_memory.h"
+#include "search/walk.h"
+#include "str.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): A snapshot is the last crawl of a tree, saved so the next launch can show it straight away instead of
+ * walking and statting everything first. The file is mapped and used in place:
+ *
+ *   SnapshotHeader
+ *   root path, padded to 8 bytes
+ *   SnapshotNode[node_count]            Pre-order, so a node's parent always comes before it. Node 0 is the root.
+ *   SnapshotDirectory[directory_count]  Every directory node, with what it takes to tell whether it changed
+ *   names                               Path components, each stored once however many times it appears
+ *
+ * Adding or removing an entry changes its directory's modification time, and editing an ignore file changes the
+ * ignore file's, so a snapshot is still good if neither has changed for any of its directories. Checking that costs
+ * a few stats per directory rather than one per file, and is done in the background while the snapshot is shown.
+ * Files changed in place are not noticed, so sizes and times can be stale. Names never are.
+ *
+ * Snapshots are written to a temporary file and moved over the old one, so a reader never sees half of one.
+ */
+
+#define SNAPSHOT_MAGIC 0x50414E53 // "SNAP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_NO_PARENT 0xFFFFFFFFu
+#define SNAPSHOT_BUILD_MEMORY MEGABYTES(512) // Reserved for a crawl, and only committed as it is used
+#define SNAPSHOT_SCRATCH_MEMORY MEGABYTES(64)
+
+#define SNAPSHOT_FLAG_RULES (1 << 0) // Directories were stamped with their ignore files
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u64 file_size;
+    u64 options_hash; // Of the root and the walk options, which have to match for the snapshot to be used
+    u32 root_length;
+    u32 node_count;
+    u32 directory_count;
+    u32 file_count;
+    u64 names_size;
+    u32 flags;
+    u32 reserved;
+} SnapshotHeader;
+
+typedef struct
+{
+    u32 parent;
+    u32 name_offset;
+    u32 name_length;
+    u32 kind; // FileEntryKind
+    u64 size;
+    u64 modified;
+    u64 id;
+} SnapshotNode;
+
+typedef struct
+{
+    u32 node;
+    u32 reserved;
+    u64 rules_modified; // The newer of its .gitignore and .ignore's modification times, 0 without either
+} SnapshotDirectory;
+
+typedef struct
+{
+    FileMapping mapping; // Empty unless the snapshot was opened from a file
+    SnapshotHeader* header;
+    s8 root;
+    SnapshotNode* nodes;
+    SnapshotDirectory* directories;
+    u8* names;
+} Snapshot;
+
+HASH_MAP_DEFINE(SnapshotNameMap, snapshot_name_map, u64, u32, hash_u64, hash_u64_equal)
+ARRAY_TYPE(SnapshotNodeArray, SnapshotNode);
+ARRAY_TYPE(SnapshotDirectoryArray, SnapshotDirectory);
+ARRAY_TYPE(SnapshotNameArray, u8);
+
+typedef struct
+{
+    Arena* arena;
+    s8 root; // Null-terminated
+    u64 options_hash;
+    u32 flags;
+    SnapshotNodeArray nodes;
+    SnapshotDirectoryArray directories;
+    SnapshotNameArray names;
+    SnapshotNameMap interned; // Hash of a name to its offset in names
+    u32 file_count;
+
+    // The directories from the root to the last one added, for finding parents
+    u32 depth;
+    u32 stack_nodes[WALK_MAX_PATH/2];
+    size stack_lengths[WALK_MAX_PATH/2];
+} SnapshotBuilder;
+
+typedef void SnapshotFileCallback(s8 path, SnapshotNode* node, void* data);
+
+// Crawls and saves on a worker. done is set once it has finished, and if the tree had changed, image holds the new
+// snapshot, which has also been written to filename.
+typedef struct
+{
+    char* root;
+    char* filename;
+    WalkOptions* options;
+    Snapshot* current; // May have no nodes, which counts as changed
+    Arena arena;       // For the image, reused by every refresh
+    Arena scratch;     // For walking
+
+    volatile u32 done;
+    b32 changed;
+    b32 written;
+    s8 image;
+    WalkStats stats;
+} SnapshotRefresh;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Maps filename and checks it is a snapshot of root crawled with options. Returns false, leaving the snapshot
+// empty, if it is missing, damaged or of something else.
+b32 snapshot_open(Snapshot* snapshot, char* filename, char* root, WalkOptions* options);
+b32 snapshot_from_memory(Snapshot* snapshot, u8* data, size data_size);
+void snapshot_close(Snapshot* snapshot);
+
+// Paths are relative to the root, and only valid during the callback
+void snapshot_for_each_file(Snapshot* snapshot, Arena* scratch, SnapshotFileCallback* visit, void* data);
+
+// Returns true if a directory was added to, removed from or had its ignore files edited since the crawl
+b32 snapshot_is_stale(Snapshot* snapshot);
+
+u64 snapshot_options_hash(s8 root, WalkOptions* options);
+
+// Nodes are added in pre-order with paths relative to the root, the root itself being the empty path
+void snapshot_builder_init(SnapshotBuilder* builder, Arena* arena, s8 root, WalkOptions* options);
+b32 snapshot_builder_add(SnapshotBuilder* builder, s8 path, FileInfo* info, u64 rules_modified);
+WalkStats snapshot_crawl(SnapshotBuilder* builder, Arena* scratch, WalkOptions* options);
+s8 snapshot_builder_finish(SnapshotBuilder* builder);
+
+// Writes to a temporary file next to filename and moves it into place
+b32 snapshot_write(s8 image, char* filename);
+
+void snapshot_refresh_init(SnapshotRefresh* refresh, char* root, char* filename, WalkOptions* options,
+                           Snapshot* current);
+void snapshot_refresh_job(void* data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,237 @@
+#include "containers.h"
+#include "file.h"
+#include "profiler.h"
+#include "search/ignore.h"
+#include "search/walk.h"
+
+#include <string.h> // memcpy, strlen
+
+#define WALK_MAX_IGNORE_FILE MEGABYTES(1) // Anything bigger is not an ignore file anyone wrote by hand
+
+typedef struct WalkScope
+{
+    IgnoreMatcher matcher;
+    size prefix_length; // Of the directory's path and the slash after it
+    struct WalkScope* parent;
+} WalkScope;
+
+typedef struct
+{
+    s8 name;
+    FileEntryKind kind;
+} WalkEntry;
+
+ARRAY_TYPE(WalkEntryArray, WalkEntry);
+
+typedef struct
+{
+    Arena* arena;
+    WalkOptions* options;
+    WalkFileCallback* on_file;
+    void* data;
+
+    IgnoreMatcher user;
+    b32 has_user_globs;
+    b32 has_user_includes; // Files have to match one of these
+    size root_prefix_length;
+
+    WalkStats stats;
+    char path[WALK_MAX_PATH];
+} Walker;
+
+typedef struct
+{
+    Arena* arena;
+    WalkEntryArray* entries;
+} WalkListContext;
+
+internal void walk_collect_entry(FileEntry* entry, void* data)
+{
+    WalkListContext* context = (WalkListContext*)data;
+    s8 name = s8_alloc(context->arena, entry->name_length);
+    WalkEntry* item = name.data ? array_push(context->arena, context->entries) : 0;
+    if (!item)
+        return;
+    memcpy(name.data, entry->name, (usize)entry->name_length);
+    item->name = name;
+    item->kind = entry->kind;
+}
+
+// Adds the rules in the directory's ignore file, if it has one. Returns true if it did.
+internal b32 walk_load_ignore_file(Walker* walker, size dir_length, char* file_name, IgnoreMatcher* matcher)
+{
+    size name_length = (size)strlen(file_name);
+    if (dir_length + 1 + name_length + 1 > WALK_MAX_PATH)
+        return false;
+
+    char* path = walker->path;
+    path[dir_length] = '/';
+    memcpy(path + dir_length + 1, file_name, (usize)name_length + 1);
+
+    b32 result = false;
+    size file_size = file_exists(path) ? file_get_size(path) : 0;
+    if (file_size > 0 && file_size <= (size)WALK_MAX_IGNORE_FILE &&
+        file_size <= walker->arena->bytes - walker->arena->used)
+    {
+        void* file = file_open_read(path);
+        if (file)
+        {
+            s8 text = s8_alloc(walker->arena, file_size);
+            text.len = file_read_stream(file, text.data, file_size);
+            file_close(file);
+            result = ignore_add_rules(matcher, text);
+            ++walker->stats.ignore_files_loaded;
+        }
+    }
+
+    path[dir_length] = 0;
+    return result;
+}
+
+internal b32 walk_is_ignored(Walker* walker, WalkScope* scope, size path_length, s8 name, b32 is_dir)
+{
+    // Includes are about files, so directories only have to get past the excludes
+    b32 included = is_dir || !walker->has_user_includes;
+    if (walker->has_user_globs)
+    {
+        s8 path = {(u8*)walker->path + walker->root_prefix_length, path_length - walker->root_prefix_length};
+        IgnoreMatch match = ignore_match(&walker->user, path, name, is_dir);
+        if (match == IgnoreMatch_Ignore)
+            return true;
+        included |= (match == IgnoreMatch_Include);
+    }
+
+    for (; scope; scope = scope->parent)
+    {
+        s8 path = {(u8*)walker->path + scope->prefix_length, path_length - scope->prefix_length};
+        IgnoreMatch match = ignore_match(&scope->matcher, path, name, is_dir);
+        if (match != IgnoreMatch_None)
+            return match == IgnoreMatch_Ignore || !included;
+    }
+
+    return !included;
+}
+
+internal void walk_directory(Walker* walker, size dir_length, WalkScope* scope)
+{
+    Arena* arena = walker->arena;
+    size saved_used = arena->used;
+    char* path = walker->path;
+
+    if (!walker->options->no_ignore_files)
+    {
+        WalkScope* own = push_struct(arena, WalkScope);
+        if (own && ignore_matcher_init(&own->matcher, arena))
+        {
+            b32 loaded = walk_load_ignore_file(walker, dir_length, ".gitignore", &own->matcher);
+            loaded |= walk_load_ignore_file(walker, dir_length, ".ignore", &own->matcher);
+            if (loaded)
+            {
+                own->prefix_length = dir_length + 1;
+                own->parent = scope;
+                scope = own;
+            }
+        }
+    }
+
+    if (walker->options->on_directory)
+        walker->options->on_directory(path, dir_length, walker->data);
+
+    WalkEntryArray entries = {0};
+    WalkListContext context = {arena, &entries};
+    char* list_path = dir_length ? path : "/";
+    if (file_list_directory(list_path, walk_collect_entry, &context))
+        ++walker->stats.directories_listed;
+
+    for (size i = 0; i < entries.count; ++i)
+    {
+        WalkEntry* entry = &entries.data[i];
+        b32 is_dir = (entry->kind == FileEntryKind_Directory);
+        size path_length = dir_length + 1 + entry->name.len;
+        if (entry->kind == FileEntryKind_Other || path_length + 1 > WALK_MAX_PATH)
+            continue;
+
+        b32 hidden = (entry->name.data[0] == '.');
+        b32 is_git = is_dir && s8_equal(entry->name, s8(".git"));
+        path[dir_length] = '/';
+        memcpy(path + dir_length + 1, entry->name.data, (usize)entry->name.len);
+        path[path_length] = 0;
+
+        if (is_git || (hidden && !walker->options->include_hidden) ||
+            walk_is_ignored(walker, scope, path_length, entry->name, is_dir))
+        {
+            if (is_dir)
+                ++walker->stats.directories_pruned;
+            else
+                ++walker->stats.files_ignored;
+        }
+        else if (is_dir)
+        {
+            walk_directory(walker, path_length, scope);
+        }
+        else
+        {
+            ++walker->stats.files_visited;
+            walker->on_file(path, path_length, walker->data);
+        }
+    }
+
+    path[dir_length] = 0;
+    arena_pop(arena, arena->used - saved_used);
+}
+
+WalkStats walk_tree(Arena* arena, char* root, WalkOptions* options, WalkFileCallback* on_file, void* data)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    size saved_used = arena->used;
+    Walker* walker = push_struct(arena, Walker);
+    zero_struct(walker->stats);
+    walker->arena = arena;
+    walker->options = options;
+    walker->on_file = on_file;
+    walker->data = data;
+
+    // NOTE(lucas): User globs are stored as ignore rules turned around: "*.c" becomes "!*.c", so matching it
+    // includes the file, and "!*.o" becomes "*.o".
+    walker->has_user_globs = options->glob_count > 0;
+    walker->has_user_includes = false;
+    if (walker->has_user_globs)
+    {
+        ignore_matcher_init(&walker->user, arena);
+        for (u32 i = 0; i < options->glob_count; ++i)
+        {
+            s8 glob = options->globs[i];
+            if (glob.len > 0 && glob.data[0] == '!')
+            {
+                s8 rule = {glob.data + 1, glob.len - 1};
+                ignore_add_rule(&walker->user, rule);
+            }
+            else if (glob.len > 0)
+            {
+                s8 rule = s8_alloc(arena, glob.len + 1);
+                rule.data[0] = '!';
+                memcpy(rule.data + 1, glob.data, (usize)glob.len);
+                ignore_add_rule(&walker->user, rule);
+                walker->has_user_includes = true;
+            }
+        }
+    }
+
+    size root_length = (size)strlen(root);
+    while (root_length > 0 && (root[root_length - 1] == '/' || root[root_length - 1] == '\\'))
+        --root_length;
+    if (root_length + 1 < WALK_MAX_PATH)
+    {
+        memcpy(walker->path, root, (usize)root_length);
+        walker->path[root_length] = 0;
+        walker->root_prefix_length = root_length + 1;
+        walk_directory(walker, root_length, 0);
+    }
+
+    WalkStats result = walker->stats;
+    arena_pop(arena, arena->used - saved_used);
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
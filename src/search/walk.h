@@ -0,0 +1,52 @@
+#pragma once
+
+#include "grapple_memory.h"
+#include "search/ignore.h"
+#include "str.h"
+#include "types.h"
+
+/*
+ * NOTE(lucas): Directory traversal with ignore rules. Each directory's .gitignore and .ignore are compiled into one
+ * matcher when the directory is entered (.ignore rules come later, so they win), and an entry is checked against
+ * the deepest matcher first, then its parents. Ignored directories are never listed, so nothing under
+ * node_modules/ or build/ is even looked at.
+ *
+ * User globs narrow down what the ignore files leave. A glob includes the files it matches and skips every other
+ * file, as with grep's --include. A glob starting with '!' skips what it matches, directories included.
+ *
+ * Hidden entries (names starting with '.') are skipped unless asked for. .git is always skipped.
+ */
+
+#define WALK_MAX_PATH 4096
+
+// path is null-terminated and only valid during the callback
+typedef void WalkFileCallback(char* path, size path_length, void* data);
+
+typedef struct
+{
+    s8* globs;
+    u32 glob_count;
+    b32 include_hidden;
+    b32 no_ignore_files; // Don't read .gitignore and .ignore
+    WalkFileCallback* on_directory; // Optional. Called with walk_tree's data for each directory before its entries.
+} WalkOptions;
+
+typedef struct
+{
+    u64 directories_listed;
+    u64 directories_pruned;
+    u64 files_visited;
+    u64 files_ignored;
+    u64 ignore_files_loaded;
+} WalkStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Calls on_file for every file under root that isn't ignored. The arena is used for scratch and given back.
+WalkStats walk_tree(Arena* arena, char* root, WalkOptions* options, WalkFileCallback* on_file, void* data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -5,6 +5,7 @@
 
 #include <stdarg.h> // varargs
 #include <stdio.h> // vsnprintf
+#include <string.h> // memcmp, memcpy
 
 #define s8(s) (s8){(u8*)s, lengthof(s)}
 typedef struct
@@ -17,7 +18,7 @@ internal inline s8 s8_alloc(Arena* arena, size len)
 {
     s8 result = {0};
     result.data = push_array(arena, len, u8);
-    result.len = len;
+    result.len = result.data ? len : 0;
     return result;
 }
 
@@ -28,11 +29,59 @@ internal inline s8 s8_format(Arena* arena, const char* format, ...)
     size len = (size)vsnprintf(NULL, 0, format, args);
     va_end(args);
 
-    s8 result = s8_alloc(arena, len);
+    // vsnprintf always writes a terminator, so make room for it and give the byte back afterwards
+    s8 result = s8_alloc(arena, len+1);
+    if (!result.data)
+        return result;
 
     va_start(args, format);
-    vsnprintf((char*)result.data, len+1, format, args);
+    vsnprintf((char*)result.data, (usize)(len+1), format, args);
     va_end(args);
 
+    arena_pop(arena, 1);
+    result.len = len;
+    return result;
+}
+
+internal inline b32 s8_equal(s8 a, s8 b)
+{
+    b32 result = (a.len == b.len) && (a.len == 0 || memcmp(a.data, b.data, (usize)a.len) == 0);
     return result;
 }
+
+// NOTE(lucas): Fast non-cryptographic hash for hash map keys. Eight bytes are mixed in per multiply, and a final
+// avalanche spreads every input bit over the whole result so both the low bits (slot index) and the high bits
+// (control byte) are usable. Not suitable for anything that has to resist adversarial input.
+internal inline u64 s8_hash(s8 str)
+{
+    u64 k = 0x9E3779B97F4A7C15ull;
+    u64 h = 0xCBF29CE484222325ull ^ ((u64)str.len*k);
+    u8* p = str.data;
+    size remaining = str.len;
+
+    while (remaining >= 8)
+    {
+        u64 chunk;
+        memcpy(&chunk, p, 8);
+        h = (h ^ chunk)*k;
+        h ^= h >> 32;
+        p += 8;
+        remaining -= 8;
+    }
+
+    if (remaining)
+    {
+        u64 chunk = 0;
+        memcpy(&chunk, p, (usize)remaining);
+        h = (h ^ chunk)*k;
+        h ^= h >> 32;
+    }
+
+    // Murmur3 finalizer
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
@@ -0,0 +1,89 @@
+#include "thread.h"
+#include "atomic.h"
+#include "profiler.h"
+
+#ifdef _WIN32
+    #include "platform/windows/win32_thread.c"
+#elif defined(__linux__)
+    #include "platform/linux/linux_thread.c"
+#else
+    #error "Unsupported platform!"
+#endif
+
+// Returns true if there was nothing to do
+internal b32 work_queue_do_next_entry(WorkQueue* queue)
+{
+    b32 should_sleep = false;
+
+    u32 original_next_entry_to_read = atomic_load_u32(&queue->next_entry_to_read);
+    u32 new_next_entry_to_read = (original_next_entry_to_read + 1) % WORK_QUEUE_MAX_ENTRIES;
+    if (original_next_entry_to_read != atomic_load_u32(&queue->next_entry_to_write))
+    {
+        // Copy the entry before claiming it. Once the read index moves, the producer may reuse the slot.
+        WorkQueueEntry entry = queue->entries[original_next_entry_to_read];
+        if (atomic_compare_exchange_u32(&queue->next_entry_to_read, original_next_entry_to_read,
+                                        new_next_entry_to_read))
+        {
+            entry.callback(entry.data);
+            atomic_add_u32(&queue->completion_count, 1);
+        }
+    }
+    else
+    {
+        should_sleep = true;
+    }
+
+    return should_sleep;
+}
+
+internal void work_queue_thread_proc(void* data)
+{
+    WorkQueue* queue = (WorkQueue*)data;
+    PROFILE_THREAD_NAME("worker");
+
+    for (;;)
+    {
+        if (work_queue_do_next_entry(queue))
+            semaphore_wait(queue->semaphore);
+    }
+}
+
+WorkQueue* work_queue_create(Arena* arena, u32 thread_count)
+{
+    WorkQueue* queue = push_struct(arena, WorkQueue);
+    zero_struct(*queue);
+    queue->semaphore = semaphore_create(arena, 0);
+
+    for (u32 i = 0; i < thread_count; ++i)
+    {
+        if (thread_create(work_queue_thread_proc, queue))
+            ++queue->thread_count;
+    }
+
+    return queue;
+}
+
+void work_queue_add(WorkQueue* queue, WorkQueueCallback* callback, void* data)
+{
+    u32 next_entry_to_write = queue->next_entry_to_write;
+    u32 new_next_entry_to_write = (next_entry_to_write + 1) % WORK_QUEUE_MAX_ENTRIES;
+    ASSERT(new_next_entry_to_write != atomic_load_u32(&queue->next_entry_to_read), "Work queue is full");
+
+    WorkQueueEntry* entry = &queue->entries[next_entry_to_write];
+    entry->callback = callback;
+    entry->data = data;
+    ++queue->completion_goal;
+
+    // Publishing the write index makes the entry visible to workers
+    atomic_store_u32(&queue->next_entry_to_write, new_next_entry_to_write);
+    semaphore_signal(queue->semaphore);
+}
+
+void work_queue_complete_all(WorkQueue* queue)
+{
+    while (queue->completion_goal != atomic_load_u32(&queue->completion_count))
+        work_queue_do_next_entry(queue);
+
+    queue->completion_goal = 0;
+    atomic_store_u32(&queue->completion_count, 0);
+}
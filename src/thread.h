@@ -0,0 +1,45 @@
+#pragma once
+
+#include "grapple_memory.h"
+#include "types.h"
+
+typedef struct Semaphore Semaphore; // Opaque OS semaphore
+typedef void ThreadProc(void* data);
+
+u32 thread_get_processor_count(void);
+b32 thread_create(ThreadProc* proc, void* data); // Threads are detached and run until the process exits
+void thread_sleep(u32 milliseconds);
+
+Semaphore* semaphore_create(Arena* arena, u32 initial_count);
+void semaphore_wait(Semaphore* semaphore);
+void semaphore_signal(Semaphore* semaphore);
+
+/*
+ * NOTE(lucas): Work queue with a single producer and any number of worker threads.
+ * Only the thread that created the queue may add work. Workers sleep on a semaphore while the queue is empty.
+ * work_queue_complete_all also runs entries on the calling thread until everything added so far is done.
+ */
+#define WORK_QUEUE_MAX_ENTRIES 256
+
+typedef void WorkQueueCallback(void* data);
+
+typedef struct
+{
+    WorkQueueCallback* callback;
+    void* data;
+} WorkQueueEntry;
+
+typedef struct
+{
+    volatile u32 completion_goal;
+    volatile u32 completion_count;
+    volatile u32 next_entry_to_write;
+    volatile u32 next_entry_to_read;
+    Semaphore* semaphore;
+    u32 thread_count;
+    WorkQueueEntry entries[WORK_QUEUE_MAX_ENTRIES];
+} WorkQueue;
+
+WorkQueue* work_queue_create(Arena* arena, u32 thread_count);
+void work_queue_add(WorkQueue* queue, WorkQueueCallback* callback, void* data);
+void work_queue_complete_all(WorkQueue* queue);
@@ -0,0 +1,9 @@
+#include "timer.h"
+
+#ifdef _WIN32
+    #include "platform/windows/win32_timer.c"
+#elif defined(__linux__)
+    #include "platform/linux/linux_timer.c"
+#else
+    #error "Unsupported platform!"
+#endif
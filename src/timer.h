@@ -0,0 +1,44 @@
+#pragma once
+
+#include "types.h"
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+// OS timer: QueryPerformanceCounter on Windows, clock_gettime(CLOCK_MONOTONIC) elsewhere.
+// Always available and safe to compare across threads, but comparatively slow to read.
+u64 timer_get_os_ticks(void);
+u64 timer_get_os_frequency(void);
+
+// CPU timer: the time stamp counter where available. Reading it costs a few nanoseconds, so it is
+// what the profiler and benchmarks use. The frequency must be measured against the OS timer.
+internal inline u64 timer_read_cpu(void)
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    u64 result = __rdtsc();
+#else
+    u64 result = timer_get_os_ticks();
+#endif
+    return result;
+}
+
+internal u64 timer_estimate_cpu_frequency(u64 milliseconds_to_wait)
+{
+    u64 os_freq = timer_get_os_frequency();
+    u64 os_wait_time = os_freq*milliseconds_to_wait / 1000;
+
+    u64 cpu_start = timer_read_cpu();
+    u64 os_start = timer_get_os_ticks();
+    u64 os_elapsed = 0;
+    while (os_elapsed < os_wait_time)
+        os_elapsed = timer_get_os_ticks() - os_start;
+    u64 cpu_elapsed = timer_read_cpu() - cpu_start;
+
+    u64 result = 0;
+    if (os_elapsed)
+        result = os_freq*cpu_elapsed / os_elapsed;
+    return result;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define countof(array) (sizeof((array)) / sizeof((array)[0]))
@@ -14,6 +15,12 @@
 #define persist  static
 #define global   static
 
+#if defined(_MSC_VER)
+    #define per_thread __declspec(thread)
+#else
+    #define per_thread __thread
+#endif
+
 #define true  1
 #define false 0
 
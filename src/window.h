@@ -7,6 +7,7 @@ typedef struct
     int width;
     int height;
     b32 open;
+    b32 needs_redraw; // Set when the OS asks for the window contents, e.g. after it is first shown
 
     // Timing information used to calculate delta seconds for each frame.
     // Not intended to be accessed
@@ -14,4 +15,8 @@ typedef struct
     i64 prev_frame_ticks;
 
     void* ptr; // OS handle to window
+    void* wake_event; // Signaled by window_wake to end an input_wait early
 } Window;
+
+// Safe to call from any thread. Background work calls this after producing something the UI should show.
+void window_wake(Window* window);
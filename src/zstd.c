@@ -0,0 +1,1236 @@
+#include "zstd.h"
+#include "grapple_memory.h"
+#include "profiler.h"
+
+#include <string.h> // memcpy, memmove, memset
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define ZSTD_SSE2 1
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// Bytes a wide match copy may write past the end of the match
+#define ZSTD_COPY_SLACK 16
+
+#define ZSTD_MAX_LITERAL_LENGTH_SYMBOL 35
+#define ZSTD_MAX_MATCH_LENGTH_SYMBOL 52
+#define ZSTD_MAX_OFFSET_SYMBOL 31
+#define ZSTD_WEIGHT_MAX_LOG 6
+
+global const u32 zstd_literal_length_base[36] =
+{
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512,
+    1024, 2048, 4096, 8192, 16384, 32768, 65536
+};
+global const u8 zstd_literal_length_extra[36] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+};
+global const u32 zstd_match_length_base[53] =
+{
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32,
+    33, 34, 35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051, 4099, 8195, 16387, 32771, 65539
+};
+global const u8 zstd_match_length_extra[53] =
+{
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2,
+    3, 3, 4, 4, 5, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+};
+
+// Default distributions for blocks that do not send their own. -1 means "less than 1".
+global const i16 zstd_default_literal_lengths[36] =
+{
+    4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1, -1, -1, -1, -1
+};
+global const i16 zstd_default_match_lengths[53] =
+{
+    1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, -1, -1
+};
+global const i16 zstd_default_offsets[29] =
+{
+    1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1
+};
+
+internal inline u32 zstd_highest_bit(u32 value)
+{
+    ASSERT(value, "zstd_highest_bit is undefined for 0");
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanReverse(&index, value);
+    return (u32)index;
+#else
+    return 31 - (u32)__builtin_clz(value);
+#endif
+}
+
+internal inline u64 zstd_read_le(u8* in, u32 bytes)
+{
+    u64 result = 0;
+    for (u32 i = 0; i < bytes; ++i)
+        result |= (u64)in[i] << (8*i);
+    return result;
+}
+
+//
+// XXH64, with a seed of zero, which is all the content checksum uses
+//
+
+#define ZSTD_XXH_PRIME1 0x9E3779B185EBCA87ull
+#define ZSTD_XXH_PRIME2 0xC2B2AE3D27D4EB4Full
+#define ZSTD_XXH_PRIME3 0x165667B19E3779F9ull
+#define ZSTD_XXH_PRIME4 0x85EBCA77C2B2AE63ull
+#define ZSTD_XXH_PRIME5 0x27D4EB2F165667C5ull
+
+internal inline u64 zstd_rotate_left(u64 value, u32 bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+internal inline u64 zstd_xxh_round(u64 lane, u64 input)
+{
+    lane += input*ZSTD_XXH_PRIME2;
+    lane = zstd_rotate_left(lane, 31);
+    return lane*ZSTD_XXH_PRIME1;
+}
+
+internal inline u64 zstd_xxh_merge(u64 hash, u64 lane)
+{
+    hash ^= zstd_xxh_round(0, lane);
+    return hash*ZSTD_XXH_PRIME1 + ZSTD_XXH_PRIME4;
+}
+
+internal inline u64 zstd_read_u64(u8* in)
+{
+    u64 result;
+    memcpy(&result, in, sizeof(result));
+    return result;
+}
+
+internal inline u32 zstd_read_u32(u8* in)
+{
+    u32 result;
+    memcpy(&result, in, sizeof(result));
+    return result;
+}
+
+internal void zstd_checksum_init(ZstdChecksum* checksum)
+{
+    checksum->lanes[0] = ZSTD_XXH_PRIME1 + ZSTD_XXH_PRIME2;
+    checksum->lanes[1] = ZSTD_XXH_PRIME2;
+    checksum->lanes[2] = 0;
+    checksum->lanes[3] = 0 - ZSTD_XXH_PRIME1;
+    checksum->total = 0;
+    checksum->pending_size = 0;
+}
+
+// Hashes whole stripes of 32 bytes, and returns how many bytes it took
+internal size zstd_checksum_stripes(ZstdChecksum* checksum, u8* data, size data_size)
+{
+    u64 lane0 = checksum->lanes[0];
+    u64 lane1 = checksum->lanes[1];
+    u64 lane2 = checksum->lanes[2];
+    u64 lane3 = checksum->lanes[3];
+    size pos = 0;
+    for (; pos + 32 <= data_size; pos += 32)
+    {
+        lane0 = zstd_xxh_round(lane0, zstd_read_u64(data + pos));
+        lane1 = zstd_xxh_round(lane1, zstd_read_u64(data + pos + 8));
+        lane2 = zstd_xxh_round(lane2, zstd_read_u64(data + pos + 16));
+        lane3 = zstd_xxh_round(lane3, zstd_read_u64(data + pos + 24));
+    }
+    checksum->lanes[0] = lane0;
+    checksum->lanes[1] = lane1;
+    checksum->lanes[2] = lane2;
+    checksum->lanes[3] = lane3;
+    return pos;
+}
+
+internal void zstd_checksum_update(ZstdChecksum* checksum, u8* data, size data_size)
+{
+    checksum->total += (u64)data_size;
+    if (checksum->pending_size)
+    {
+        size wanted = 32 - (size)checksum->pending_size;
+        size taken = (data_size < wanted) ? data_size : wanted;
+        memcpy(checksum->pending + checksum->pending_size, data, (usize)taken);
+        checksum->pending_size += (u32)taken;
+        data += taken;
+        data_size -= taken;
+        if (checksum->pending_size < 32)
+            return;
+        zstd_checksum_stripes(checksum, checksum->pending, 32);
+        checksum->pending_size = 0;
+    }
+
+    size used = zstd_checksum_stripes(checksum, data, data_size);
+    memcpy(checksum->pending, data + used, (usize)(data_size - used));
+    checksum->pending_size = (u32)(data_size - used);
+}
+
+internal u64 zstd_checksum_digest(ZstdChecksum* checksum)
+{
+    u64* lanes = checksum->lanes;
+    u64 hash = 0;
+    if (checksum->total >= 32)
+    {
+        hash = zstd_rotate_left(lanes[0], 1) + zstd_rotate_left(lanes[1], 7) + zstd_rotate_left(lanes[2], 12) +
+               zstd_rotate_left(lanes[3], 18);
+        for (u32 i = 0; i < 4; ++i)
+            hash = zstd_xxh_merge(hash, lanes[i]);
+    }
+    else
+    {
+        hash = lanes[2] + ZSTD_XXH_PRIME5;
+    }
+    hash += checksum->total;
+
+    u8* tail = checksum->pending;
+    u32 remaining = checksum->pending_size;
+    for (; remaining >= 8; remaining -= 8, tail += 8)
+    {
+        hash ^= zstd_xxh_round(0, zstd_read_u64(tail));
+        hash = zstd_rotate_left(hash, 27)*ZSTD_XXH_PRIME1 + ZSTD_XXH_PRIME4;
+    }
+    if (remaining >= 4)
+    {
+        hash ^= (u64)zstd_read_u32(tail)*ZSTD_XXH_PRIME1;
+        hash = zstd_rotate_left(hash, 23)*ZSTD_XXH_PRIME2 + ZSTD_XXH_PRIME3;
+        remaining -= 4;
+        tail += 4;
+    }
+    for (; remaining > 0; --remaining, ++tail)
+    {
+        hash ^= (u64)*tail*ZSTD_XXH_PRIME5;
+        hash = zstd_rotate_left(hash, 11)*ZSTD_XXH_PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= ZSTD_XXH_PRIME2;
+    hash ^= hash >> 29;
+    hash *= ZSTD_XXH_PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+//
+// NOTE(lucas): Huffman and FSE streams are written forwards and read backwards, starting from the last byte, whose
+// highest set bit marks where the data begins. The container holds eight bytes and bits are taken from the top.
+// Reading past the start of the stream leaves consumed above 64, which is how the end of a stream is detected and
+// how corrupt streams are caught once decoding is done. Nothing read in that state is used to index memory.
+//
+typedef struct
+{
+    u8* start;
+    u8* ptr; // The container was loaded from ptr[0..8)
+    u64 container;
+    u32 consumed;
+} ZstdBits;
+
+internal b32 zstd_bits_init(ZstdBits* bits, u8* in, size in_size)
+{
+    if (in_size < 1 || in[in_size - 1] == 0)
+        return false;
+
+    bits->start = in;
+    if (in_size >= 8)
+    {
+        bits->ptr = in + in_size - 8;
+        memcpy(&bits->container, bits->ptr, sizeof(bits->container));
+        bits->consumed = 0;
+    }
+    else
+    {
+        // The missing high bytes count as already read
+        bits->ptr = in;
+        bits->container = zstd_read_le(in, (u32)in_size);
+        bits->consumed = (u32)(8 - in_size)*8;
+    }
+    bits->consumed += 8 - zstd_highest_bit(in[in_size - 1]);
+    return true;
+}
+
+// Afterwards at least 57 bits are available, unless the container already reaches the start of the stream
+internal inline void zstd_bits_reload(ZstdBits* bits)
+{
+    if (bits->consumed > 64)
+        return;
+
+    if (bits->ptr - bits->start >= 8)
+    {
+        bits->ptr -= bits->consumed >> 3;
+        bits->consumed &= 7;
+    }
+    else if (bits->ptr == bits->start)
+    {
+        return;
+    }
+    else
+    {
+        size step = bits->consumed >> 3;
+        if (step > bits->ptr - bits->start)
+            step = bits->ptr - bits->start;
+        bits->ptr -= step;
+        bits->consumed -= (u32)step*8;
+    }
+    memcpy(&bits->container, bits->ptr, sizeof(bits->container));
+}
+
+internal inline u32 zstd_bits_peek(ZstdBits* bits, u32 count)
+{
+    // Shifting in two steps keeps a count of 0 defined
+    u32 result = (u32)(((bits->container << (bits->consumed & 63)) >> 1) >> ((63 - count) & 63));
+    return result;
+}
+
+internal inline u32 zstd_bits_read(ZstdBits* bits, u32 count)
+{
+    u32 result = zstd_bits_peek(bits, count);
+    bits->consumed += count;
+    return result;
+}
+
+internal inline b32 zstd_bits_overflowed(ZstdBits* bits)
+{
+    return bits->consumed > 64;
+}
+
+// True if every bit has been read and no more
+internal inline b32 zstd_bits_finished(ZstdBits* bits)
+{
+    return bits->ptr == bits->start && bits->consumed == 64;
+}
+
+//
+// FSE tables
+//
+
+// Spreads each symbol over its share of the states and works out how each state moves to the next
+internal b32 zstd_build_fse_table(i16* counts, u32 symbol_count, u32 log, ZstdFseEntry* table)
+{
+    u32 table_size = 1u << log;
+    u32 high = table_size - 1;
+    u16 next_state[256];
+
+    // "Less than 1" symbols get a single state each at the top of the table
+    for (u32 symbol = 0; symbol < symbol_count; ++symbol)
+    {
+        if (counts[symbol] == -1)
+        {
+            table[high--].symbol = (u8)symbol;
+            next_state[symbol] = 1;
+        }
+        else
+        {
+            next_state[symbol] = (u16)counts[symbol];
+        }
+    }
+
+    u32 step = (table_size >> 1) + (table_size >> 3) + 3;
+    u32 mask = table_size - 1;
+    u32 position = 0;
+    for (u32 symbol = 0; symbol < symbol_count; ++symbol)
+    {
+        for (i32 i = 0; i < counts[symbol]; ++i)
+        {
+            table[position].symbol = (u8)symbol;
+            do
+            {
+                position = (position + step) & mask;
+            } while (position > high);
+        }
+    }
+    if (position != 0)
+        return false;
+
+    for (u32 state = 0; state < table_size; ++state)
+    {
+        u32 symbol = table[state].symbol;
+        u32 next = next_state[symbol]++;
+        u32 bits = log - zstd_highest_bit(next);
+        table[state].bits = (u8)bits;
+        table[state].base = (u16)((next << bits) - table_size);
+    }
+    return true;
+}
+
+internal inline u32 zstd_peek_forward(u8* in, size in_size, size bit_pos)
+{
+    size byte = bit_pos >> 3;
+    u64 value = 0;
+    if (byte + 4 <= in_size)
+        value = zstd_read_le(in + byte, 4);
+    else if (byte < in_size)
+        value = zstd_read_le(in + byte, (u32)(in_size - byte));
+    return (u32)(value >> (bit_pos & 7));
+}
+
+// Reads a table description, which is written forwards, and builds the table. Returns the number of bytes read or
+// -1 if the description is invalid.
+internal size zstd_read_fse_table(u8* in, size in_size, u32 max_symbol, u32 max_log, ZstdFseEntry* table, u32* log)
+{
+    if (in_size < 1)
+        return -1;
+
+    u32 table_log = (in[0] & 15) + 5;
+    if (table_log > max_log)
+        return -1;
+
+    i16 counts[256];
+    size bit_pos = 4;
+    i32 remaining = (1 << table_log) + 1;
+    i32 threshold = 1 << table_log;
+    u32 bits = table_log + 1;
+    u32 symbol = 0;
+    while (remaining > 1 && symbol <= max_symbol)
+    {
+        // Small values take one bit less, which is how the description stays compact
+        u32 value = zstd_peek_forward(in, in_size, bit_pos);
+        i32 max = 2*threshold - 1 - remaining;
+        i32 count;
+        if ((i32)(value & (u32)(threshold - 1)) < max)
+        {
+            count = (i32)(value & (u32)(threshold - 1));
+            bit_pos += bits - 1;
+        }
+        else
+        {
+            count = (i32)(value & (u32)(2*threshold - 1));
+            if (count >= threshold)
+                count -= max;
+            bit_pos += bits;
+        }
+
+        --count;
+        remaining -= (count < 0) ? -count : count;
+        counts[symbol++] = (i16)count;
+
+        // A zero is followed by two bit counts of further zeros, where 3 means another count follows
+        if (count == 0)
+        {
+            for (;;)
+            {
+                u32 repeat = zstd_peek_forward(in, in_size, bit_pos) & 3;
+                bit_pos += 2;
+                for (u32 i = 0; i < repeat; ++i)
+                {
+                    if (symbol > max_symbol)
+                        return -1;
+                    counts[symbol++] = 0;
+                }
+                if (repeat != 3)
+                    break;
+            }
+        }
+
+        while (remaining < threshold)
+        {
+            --bits;
+            threshold >>= 1;
+        }
+    }
+
+    if (remaining != 1 || bit_pos > in_size*8)
+        return -1;
+    if (!zstd_build_fse_table(counts, symbol, table_log, table))
+        return -1;
+
+    *log = table_log;
+    return (bit_pos + 7) >> 3;
+}
+
+internal void zstd_build_default_table(const i16* defaults, u32 count, u32 log, ZstdFseEntry* table)
+{
+    i16 counts[64];
+    memcpy(counts, defaults, count*sizeof(i16));
+    b32 built = zstd_build_fse_table(counts, count, log, table);
+    ASSERT(built, "Default distribution does not fill its table");
+    (void)built;
+}
+
+//
+// Literals
+//
+
+// Huffman weights can themselves be FSE compressed, as two interleaved states over one stream. Returns the number
+// of weights or -1.
+internal i32 zstd_decode_weights(u8* in, size in_size, u8* weights)
+{
+    ZstdFseEntry table[1 << ZSTD_WEIGHT_MAX_LOG];
+    u32 log = 0;
+    size header_size = zstd_read_fse_table(in, in_size, 15, ZSTD_WEIGHT_MAX_LOG, table, &log);
+    if (header_size < 0)
+        return -1;
+
+    ZstdBits bits;
+    if (!zstd_bits_init(&bits, in + header_size, in_size - header_size))
+        return -1;
+
+    u32 state1 = zstd_bits_read(&bits, log);
+    u32 state2 = zstd_bits_read(&bits, log);
+    i32 count = 0;
+    for (;;)
+    {
+        // Whichever state is due when the stream runs out contributes one last symbol
+        if (count > 253)
+            return -1;
+        weights[count++] = table[state1].symbol;
+        zstd_bits_reload(&bits);
+        state1 = table[state1].base + zstd_bits_read(&bits, table[state1].bits);
+        if (zstd_bits_overflowed(&bits))
+        {
+            weights[count++] = table[state2].symbol;
+            break;
+        }
+
+        weights[count++] = table[state2].symbol;
+        zstd_bits_reload(&bits);
+        state2 = table[state2].base + zstd_bits_read(&bits, table[state2].bits);
+        if (zstd_bits_overflowed(&bits))
+        {
+            weights[count++] = table[state1].symbol;
+            break;
+        }
+    }
+    return count;
+}
+
+// Returns the size of the tree description or -1
+internal size zstd_read_huffman_table(ZstdDecoder* d, u8* in, size in_size)
+{
+    if (in_size < 1)
+        return -1;
+
+    u8 weights[256];
+    i32 weight_count = 0;
+    size result = 0;
+    u32 header = in[0];
+    if (header >= 128)
+    {
+        // Four bits per weight, first weight in the high half
+        weight_count = (i32)header - 127;
+        result = 1 + (weight_count + 1)/2;
+        if (result > in_size)
+            return -1;
+        for (i32 i = 0; i < weight_count; ++i)
+            weights[i] = (i & 1) ? (in[1 + i/2] & 15) : (in[1 + i/2] >> 4);
+    }
+    else
+    {
+        result = 1 + header;
+        if (result > in_size)
+            return -1;
+        weight_count = zstd_decode_weights(in + 1, header, weights);
+        if (weight_count < 0)
+            return -1;
+    }
+
+    // The last weight is implied by the others filling a power of two
+    u32 total = 0;
+    for (i32 i = 0; i < weight_count; ++i)
+    {
+        if (weights[i] > ZSTD_HUFFMAN_MAX_BITS)
+            return -1;
+        if (weights[i])
+            total += 1u << (weights[i] - 1);
+    }
+    if (total == 0)
+        return -1;
+    u32 max_bits = zstd_highest_bit(total) + 1;
+    u32 rest = (1u << max_bits) - total;
+    if (max_bits > ZSTD_HUFFMAN_MAX_BITS || (rest & (rest - 1)))
+        return -1;
+    weights[weight_count++] = (u8)(zstd_highest_bit(rest) + 1);
+
+    // Codes are handed out from the lowest weight (longest code) up, and each symbol fills 2^(weight - 1) entries
+    // of a table indexed by the next max_bits bits of the stream
+    u32 rank_count[ZSTD_HUFFMAN_MAX_BITS + 2] = {0};
+    for (i32 i = 0; i < weight_count; ++i)
+        ++rank_count[weights[i]];
+    u32 position[ZSTD_HUFFMAN_MAX_BITS + 2] = {0};
+    u32 next = 0;
+    for (u32 weight = 1; weight <= max_bits; ++weight)
+    {
+        position[weight] = next;
+        next += rank_count[weight] << (weight - 1);
+    }
+
+    for (i32 symbol = 0; symbol < weight_count; ++symbol)
+    {
+        u32 weight = weights[symbol];
+        if (!weight)
+            continue;
+        ZstdHuffmanEntry entry = {(u8)symbol, (u8)(max_bits + 1 - weight)};
+        u32 length = 1u << (weight - 1);
+        for (u32 i = 0; i < length; ++i)
+            d->huffman[position[weight] + i] = entry;
+        position[weight] += length;
+    }
+
+    d->huffman_bits = max_bits;
+    d->has_huffman = true;
+    return result;
+}
+
+internal b32 zstd_decode_huffman_stream(ZstdDecoder* d, u8* in, size in_size, u8* out, size count)
+{
+    ZstdBits bits;
+    if (!zstd_bits_init(&bits, in, in_size))
+        return false;
+
+    ZstdHuffmanEntry* table = d->huffman;
+    u32 max_bits = d->huffman_bits;
+    size i = 0;
+
+    // Four symbols of at most 11 bits fit in one refill
+    for (; i + 4 <= count; i += 4)
+    {
+        zstd_bits_reload(&bits);
+        for (u32 j = 0; j < 4; ++j)
+        {
+            ZstdHuffmanEntry entry = table[zstd_bits_peek(&bits, max_bits)];
+            out[i + j] = entry.symbol;
+            bits.consumed += entry.bits;
+        }
+    }
+    for (; i < count; ++i)
+    {
+        zstd_bits_reload(&bits);
+        ZstdHuffmanEntry entry = table[zstd_bits_peek(&bits, max_bits)];
+        out[i] = entry.symbol;
+        bits.consumed += entry.bits;
+    }
+
+    return zstd_bits_finished(&bits);
+}
+
+// Returns the number of bytes the literals section takes, or -1. Raw literals are used in place.
+internal size zstd_decode_literals(ZstdDecoder* d, u8* in, size in_size, u8** literals, size* literal_count)
+{
+    if (in_size < 1)
+        return -1;
+
+    u32 type = in[0] & 3;
+    u32 size_format = (in[0] >> 2) & 3;
+    if (type <= 1)
+    {
+        // Raw or RLE
+        size header_size = 1;
+        u32 regenerated = in[0] >> 3;
+        if (size_format == 1)
+        {
+            header_size = 2;
+            if (in_size < 2)
+                return -1;
+            regenerated = (in[0] >> 4) + ((u32)in[1] << 4);
+        }
+        else if (size_format == 3)
+        {
+            header_size = 3;
+            if (in_size < 3)
+                return -1;
+            regenerated = (in[0] >> 4) + ((u32)in[1] << 4) + ((u32)in[2] << 12);
+        }
+        if (regenerated > ZSTD_BLOCK_MAX)
+            return -1;
+
+        *literal_count = regenerated;
+        if (type == 0)
+        {
+            if (header_size + regenerated > in_size)
+                return -1;
+            *literals = in + header_size;
+            return header_size + regenerated;
+        }
+
+        if (header_size + 1 > in_size)
+            return -1;
+        memset(d->literals, in[header_size], regenerated);
+        *literals = d->literals;
+        return header_size + 1;
+    }
+
+    // Huffman compressed, with a new tree or the one from the last block
+    size header_size = 3 + (size_format == 2) + 2*(size_format == 3);
+    if (in_size < header_size)
+        return -1;
+    u64 header = zstd_read_le(in, (u32)header_size);
+    u32 stream_count = (size_format == 0) ? 1 : 4;
+    u32 regenerated = 0;
+    size compressed = 0;
+    if (size_format <= 1)
+    {
+        regenerated = (u32)(header >> 4) & 0x3FF;
+        compressed = (size)(header >> 14) & 0x3FF;
+    }
+    else if (size_format == 2)
+    {
+        regenerated = (u32)(header >> 4) & 0x3FFF;
+        compressed = (size)(header >> 18) & 0x3FFF;
+    }
+    else
+    {
+        regenerated = (u32)(header >> 4) & 0x3FFFF;
+        compressed = (size)(header >> 22) & 0x3FFFF;
+    }
+    if (regenerated > ZSTD_BLOCK_MAX || header_size + compressed > in_size)
+        return -1;
+
+    u8* streams = in + header_size;
+    size streams_size = compressed;
+    if (type == 2)
+    {
+        size tree_size = zstd_read_huffman_table(d, streams, streams_size);
+        if (tree_size < 0)
+            return -1;
+        streams += tree_size;
+        streams_size -= tree_size;
+    }
+    else if (!d->has_huffman)
+    {
+        return -1;
+    }
+
+    u8* out = d->literals;
+    if (stream_count == 1)
+    {
+        if (!zstd_decode_huffman_stream(d, streams, streams_size, out, regenerated))
+            return -1;
+    }
+    else
+    {
+        // A jump table gives the sizes of the first three streams, and each stream but the last decodes a quarter
+        // of the literals, rounded up
+        if (streams_size < 6)
+            return -1;
+        size sizes[4];
+        sizes[0] = (size)zstd_read_le(streams, 2);
+        sizes[1] = (size)zstd_read_le(streams + 2, 2);
+        sizes[2] = (size)zstd_read_le(streams + 4, 2);
+        sizes[3] = streams_size - 6 - sizes[0] - sizes[1] - sizes[2];
+        size segment = (regenerated + 3) / 4;
+        if (sizes[3] < 1 || 3*segment > (size)regenerated)
+            return -1;
+
+        u8* stream = streams + 6;
+        for (u32 i = 0; i < 4; ++i)
+        {
+            size count = (i < 3) ? segment : regenerated - 3*segment;
+            if (!zstd_decode_huffman_stream(d, stream, sizes[i], out + i*segment, count))
+                return -1;
+            stream += sizes[i];
+        }
+    }
+
+    *literals = out;
+    *literal_count = regenerated;
+    return header_size + compressed;
+}
+
+//
+// Sequences
+//
+
+typedef enum
+{
+    ZstdMode_Predefined = 0,
+    ZstdMode_Rle,
+    ZstdMode_Compressed,
+    ZstdMode_Repeat,
+} ZstdTableMode;
+
+// Returns the number of bytes the table took, or -1
+internal size zstd_read_sequence_table(ZstdDecoder* d, u32 mode, u8* in, size in_size, ZstdFseEntry* table,
+                                       u32* log, const i16* defaults, u32 default_count, u32 default_log,
+                                       u32 max_symbol, u32 max_log)
+{
+    size result = 0;
+    switch (mode)
+    {
+        case ZstdMode_Predefined:
+        {
+            zstd_build_default_table(defaults, default_count, default_log, table);
+            *log = default_log;
+        } break;
+
+        case ZstdMode_Rle:
+        {
+            if (in_size < 1 || in[0] > max_symbol)
+                return -1;
+            table[0].symbol = in[0];
+            table[0].bits = 0;
+            table[0].base = 0;
+            *log = 0;
+            result = 1;
+        } break;
+
+        case ZstdMode_Compressed:
+        {
+            result = zstd_read_fse_table(in, in_size, max_symbol, max_log, table, log);
+        } break;
+
+        case ZstdMode_Repeat:
+        {
+            if (!d->has_sequence_tables)
+                return -1;
+        } break;
+    }
+    return result;
+}
+
+internal inline void zstd_copy_match(u8* dst, size offset, size length)
+{
+    u8* src = dst - offset;
+    if (offset >= 16)
+    {
+#ifdef ZSTD_SSE2
+        for (size i = 0; i < length; i += 16)
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_loadu_si128((__m128i*)(src + i)));
+#else
+        for (size i = 0; i < length; i += 8)
+        {
+            u64 chunk;
+            memcpy(&chunk, src + i, 8);
+            memcpy(dst + i, &chunk, 8);
+        }
+#endif
+    }
+    else if (offset == 1)
+    {
+        memset(dst, src[0], (usize)length);
+    }
+    else
+    {
+        for (size i = 0; i < length; ++i)
+            dst[i] = src[i];
+    }
+}
+
+// Runs the block's sequences, each a run of literals followed by a match, into the window. Returns the number of
+// bytes produced or -1.
+internal size zstd_decode_sequences(ZstdDecoder* d, u8* in, size in_size, u8* literals, size literal_count,
+                                    size out_limit)
+{
+    if (in_size < 1)
+        return -1;
+
+    u32 count = in[0];
+    size pos = 1;
+    if (count >= 128)
+    {
+        if (count < 255)
+        {
+            if (in_size < 2)
+                return -1;
+            count = ((count - 128) << 8) + in[1];
+            pos = 2;
+        }
+        else
+        {
+            if (in_size < 3)
+                return -1;
+            count = in[1] + ((u32)in[2] << 8) + 0x7F00;
+            pos = 3;
+        }
+    }
+
+    u8* out_start = d->window + d->out_pos;
+    u8* out = out_start;
+    u8* out_end = out_start + out_limit;
+    u8* literal = literals;
+    u8* literal_end = literals + literal_count;
+
+    if (count)
+    {
+        if (pos >= in_size)
+            return -1;
+        u32 modes = in[pos++];
+        if (modes & 3)
+            return -1;
+
+        size used = zstd_read_sequence_table(d, modes >> 6, in + pos, in_size - pos, d->literal_lengths,
+                                             &d->literal_length_log, zstd_default_literal_lengths,
+                                             countof(zstd_default_literal_lengths), 6,
+                                             ZSTD_MAX_LITERAL_LENGTH_SYMBOL, ZSTD_LITERAL_LENGTH_MAX_LOG);
+        if (used < 0)
+            return -1;
+        pos += used;
+        used = zstd_read_sequence_table(d, (modes >> 4) & 3, in + pos, in_size - pos, d->offsets, &d->offset_log,
+                                        zstd_default_offsets, countof(zstd_default_offsets), 5,
+                                        ZSTD_MAX_OFFSET_SYMBOL, ZSTD_OFFSET_MAX_LOG);
+        if (used < 0)
+            return -1;
+        pos += used;
+        used = zstd_read_sequence_table(d, (modes >> 2) & 3, in + pos, in_size - pos, d->match_lengths,
+                                        &d->match_length_log, zstd_default_match_lengths,
+                                        countof(zstd_default_match_lengths), 6,
+                                        ZSTD_MAX_MATCH_LENGTH_SYMBOL, ZSTD_MATCH_LENGTH_MAX_LOG);
+        if (used < 0)
+            return -1;
+        pos += used;
+        d->has_sequence_tables = true;
+
+        ZstdBits bits;
+        if (!zstd_bits_init(&bits, in + pos, in_size - pos))
+            return -1;
+
+        u32 literal_length_state = zstd_bits_read(&bits, d->literal_length_log);
+        u32 offset_state = zstd_bits_read(&bits, d->offset_log);
+        u32 match_length_state = zstd_bits_read(&bits, d->match_length_log);
+        u32* repeat = d->repeat_offsets;
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            ZstdFseEntry literal_length_entry = d->literal_lengths[literal_length_state];
+            ZstdFseEntry match_length_entry = d->match_lengths[match_length_state];
+            ZstdFseEntry offset_entry = d->offsets[offset_state];
+
+            // Extra bits come in the order offset, match length, literal length
+            zstd_bits_reload(&bits);
+            u32 offset_code = offset_entry.symbol;
+            u32 offset_value = (1u << offset_code) + zstd_bits_read(&bits, offset_code);
+            zstd_bits_reload(&bits);
+            size match_length = zstd_match_length_base[match_length_entry.symbol] +
+                                zstd_bits_read(&bits, zstd_match_length_extra[match_length_entry.symbol]);
+            size literal_length = zstd_literal_length_base[literal_length_entry.symbol] +
+                                  zstd_bits_read(&bits, zstd_literal_length_extra[literal_length_entry.symbol]);
+
+            // NOTE(lucas): Offset values 1-3 pick one of the last three offsets, shifted by one when there are no
+            // literals, where 3 then means one less than the most recent. Anything else is a new offset.
+            u32 offset = 0;
+            if (offset_value > 3)
+            {
+                offset = offset_value - 3;
+                repeat[2] = repeat[1];
+                repeat[1] = repeat[0];
+                repeat[0] = offset;
+            }
+            else
+            {
+                u32 index = offset_value - 1 + (literal_length == 0);
+                if (index == 0)
+                {
+                    offset = repeat[0];
+                }
+                else
+                {
+                    offset = (index == 3) ? repeat[0] - 1 : repeat[index];
+                    if (index != 1)
+                        repeat[2] = repeat[1];
+                    repeat[1] = repeat[0];
+                    repeat[0] = offset;
+                }
+            }
+
+            // States are updated in the order literal length, match length, offset
+            if (i + 1 < count)
+            {
+                zstd_bits_reload(&bits);
+                literal_length_state = literal_length_entry.base +
+                                       zstd_bits_read(&bits, literal_length_entry.bits);
+                match_length_state = match_length_entry.base + zstd_bits_read(&bits, match_length_entry.bits);
+                offset_state = offset_entry.base + zstd_bits_read(&bits, offset_entry.bits);
+            }
+
+            if (literal_length > literal_end - literal || literal_length + match_length > out_end - out)
+                return -1;
+            memcpy(out, literal, (usize)literal_length);
+            out += literal_length;
+            literal += literal_length;
+
+            if (offset == 0 || offset > out - d->window)
+                return -1;
+            zstd_copy_match(out, offset, match_length);
+            out += match_length;
+        }
+
+        if (!zstd_bits_finished(&bits))
+            return -1;
+    }
+
+    // Whatever literals are left over follow the last sequence
+    size rest = literal_end - literal;
+    if (rest > out_end - out)
+        return -1;
+    memcpy(out, literal, (usize)rest);
+    out += rest;
+
+    return out - out_start;
+}
+
+//
+// Frames
+//
+
+b32 zstd_read_frame_header(u8* in, size in_size, ZstdFrameHeader* header)
+{
+    if (in_size < 5 || (u32)zstd_read_le(in, 4) != ZSTD_MAGIC)
+        return false;
+
+    u32 descriptor = in[4];
+    u32 content_size_flag = descriptor >> 6;
+    b32 single_segment = (descriptor >> 5) & 1;
+    u32 dictionary_flag = descriptor & 3;
+    if (descriptor & 8) // Reserved
+        return false;
+
+    persist const u32 dictionary_sizes[4] = {0, 1, 2, 4};
+    persist const u32 content_sizes[4] = {0, 2, 4, 8};
+    u32 dictionary_bytes = dictionary_sizes[dictionary_flag];
+    u32 content_bytes = content_sizes[content_size_flag];
+    if (single_segment && content_size_flag == 0)
+        content_bytes = 1;
+
+    size pos = 5;
+    u64 window_size = 0;
+    if (!single_segment)
+    {
+        if (pos >= in_size)
+            return false;
+        u32 exponent = in[pos] >> 3;
+        u32 mantissa = in[pos] & 7;
+        u64 window_base = 1ull << (10 + exponent);
+        window_size = window_base + (window_base/8)*mantissa;
+        ++pos;
+    }
+    if (pos + dictionary_bytes + content_bytes > in_size)
+        return false;
+
+    header->dictionary_id = (u32)zstd_read_le(in + pos, dictionary_bytes);
+    pos += dictionary_bytes;
+
+    header->content_size = ZSTD_UNKNOWN_CONTENT_SIZE;
+    if (content_bytes)
+    {
+        header->content_size = zstd_read_le(in + pos, content_bytes);
+        if (content_bytes == 2)
+            header->content_size += 256;
+    }
+    pos += content_bytes;
+
+    // A single segment frame has no window, and its matches can reach back to the start of the content
+    header->window_size = single_segment ? header->content_size : window_size;
+    header->header_size = (u32)pos;
+    header->has_checksum = (descriptor >> 2) & 1;
+    return true;
+}
+
+size zstd_window_buffer_size(ZstdFrameHeader* header)
+{
+    if (header->window_size > ZSTD_MAX_WINDOW)
+        return -1;
+
+    // Blocks are never larger than the window, so twice the window always has room for the history and a block
+    u64 result = 2*header->window_size;
+    if (header->content_size != ZSTD_UNKNOWN_CONTENT_SIZE && header->content_size < result)
+        result = header->content_size;
+    return (size)result + ZSTD_COPY_SLACK;
+}
+
+size zstd_min_window_buffer_size(ZstdFrameHeader* header)
+{
+    if (header->window_size > ZSTD_MAX_WINDOW)
+        return -1;
+
+    u64 block_max = (header->window_size < ZSTD_BLOCK_MAX) ? header->window_size : ZSTD_BLOCK_MAX;
+    u64 result = header->window_size + block_max;
+    if (header->content_size != ZSTD_UNKNOWN_CONTENT_SIZE && header->content_size < result)
+        result = header->content_size;
+    return (size)result + ZSTD_COPY_SLACK;
+}
+
+b32 zstd_is_skippable_frame(u8* in, size in_size)
+{
+    return in_size >= 8 && ((u32)zstd_read_le(in, 4) & ZSTD_SKIPPABLE_MASK) == ZSTD_SKIPPABLE_MAGIC;
+}
+
+size zstd_frame_size(u8* in, size in_size)
+{
+    if (zstd_is_skippable_frame(in, in_size))
+    {
+        size result = 8 + (size)zstd_read_le(in + 4, 4);
+        return (result <= in_size) ? result : -1;
+    }
+
+    ZstdFrameHeader header;
+    if (!zstd_read_frame_header(in, in_size, &header))
+        return -1;
+
+    size pos = header.header_size;
+    for (;;)
+    {
+        if (pos + 3 > in_size)
+            return -1;
+        u32 block_header = (u32)zstd_read_le(in + pos, 3);
+        u32 type = (block_header >> 1) & 3;
+        pos += 3 + ((type == 1) ? 1 : (block_header >> 3));
+        if (type == 3)
+            return -1;
+        if (block_header & 1)
+            break;
+    }
+    if (header.has_checksum)
+        pos += 4;
+    return (pos <= in_size) ? pos : -1;
+}
+
+void zstd_init(ZstdDecoder* decoder, u8* in, size in_size, u8* window, size window_size)
+{
+    decoder->in = in;
+    decoder->in_size = in_size;
+    decoder->in_pos = 0;
+    decoder->status = ZstdStatus_Ok;
+    decoder->frame_out = 0;
+    zstd_checksum_init(&decoder->checksum);
+
+    decoder->window = window;
+    decoder->window_size = window_size;
+    decoder->out_pos = 0;
+
+    decoder->repeat_offsets[0] = 1;
+    decoder->repeat_offsets[1] = 4;
+    decoder->repeat_offsets[2] = 8;
+    decoder->has_huffman = false;
+    decoder->has_sequence_tables = false;
+
+    ZstdFrameHeader* header = &decoder->header;
+    if (!zstd_read_frame_header(in, in_size, header) || header->dictionary_id != 0 ||
+        header->window_size > ZSTD_MAX_WINDOW)
+    {
+        // TODO(lucas): Dictionaries, if anything we search ever uses them
+        decoder->status = ZstdStatus_Error;
+        return;
+    }
+    decoder->in_pos = header->header_size;
+}
+
+ZstdResult zstd_next(ZstdDecoder* d)
+{
+    PROFILE_FUNCTION_BEGIN();
+
+    ZstdResult result = {0};
+    result.status = d->status;
+    if (d->status != ZstdStatus_Ok)
+    {
+        PROFILE_FUNCTION_END();
+        return result;
+    }
+
+    result.status = ZstdStatus_Error;
+    u8* in = d->in;
+    u32 block_header = 0;
+    if (d->in_pos + 3 <= d->in_size)
+    {
+        block_header = (u32)zstd_read_le(in + d->in_pos, 3);
+        d->in_pos += 3;
+    }
+    else
+    {
+        d->status = ZstdStatus_Error;
+        PROFILE_FUNCTION_END();
+        return result;
+    }
+    b32 last_block = block_header & 1;
+    u32 type = (block_header >> 1) & 3;
+    size block_size = block_header >> 3;
+
+    // Make room for the largest block this frame can still have
+    u64 block_max = (d->header.window_size < ZSTD_BLOCK_MAX) ? d->header.window_size : ZSTD_BLOCK_MAX;
+    if (d->header.content_size != ZSTD_UNKNOWN_CONTENT_SIZE && d->header.content_size - d->frame_out < block_max)
+        block_max = d->header.content_size - d->frame_out;
+    size need = (size)block_max + ZSTD_COPY_SLACK;
+    if (d->out_pos + need > d->window_size)
+    {
+        size history = d->out_pos;
+        if ((u64)history > d->header.window_size)
+            history = (size)d->header.window_size;
+        memmove(d->window, d->window + d->out_pos - history, (usize)history);
+        d->out_pos = history;
+    }
+
+    size produced = -1;
+    if (d->out_pos + need <= d->window_size && d->frame_out <= d->header.content_size)
+    {
+        u8* out = d->window + d->out_pos;
+        size available = d->in_size - d->in_pos;
+        switch (type)
+        {
+            case 0: // Raw
+            {
+                if (block_size <= (size)block_max && block_size <= available)
+                {
+                    memcpy(out, in + d->in_pos, (usize)block_size);
+                    d->in_pos += block_size;
+                    produced = block_size;
+                }
+            } break;
+
+            case 1: // RLE
+            {
+                if (block_size <= (size)block_max && available >= 1)
+                {
+                    memset(out, in[d->in_pos], (usize)block_size);
+                    d->in_pos += 1;
+                    produced = block_size;
+                }
+            } break;
+
+            case 2: // Compressed
+            {
+                if (block_size <= (size)ZSTD_BLOCK_MAX && block_size <= available)
+                {
+                    u8* literals = 0;
+                    size literal_count = 0;
+                    size used = zstd_decode_literals(d, in + d->in_pos, block_size, &literals, &literal_count);
+                    if (used >= 0)
+                    {
+                        produced = zstd_decode_sequences(d, in + d->in_pos + used, block_size - used, literals,
+                                                         literal_count, (size)block_max);
+                    }
+                    d->in_pos += block_size;
+                }
+            } break;
+        }
+    }
+
+    if (produced < 0)
+    {
+        d->status = ZstdStatus_Error;
+        PROFILE_FUNCTION_END();
+        return result;
+    }
+
+    result.data = d->window + d->out_pos;
+    result.size = produced;
+    d->out_pos += produced;
+    d->frame_out += produced;
+    result.status = ZstdStatus_Ok;
+    if (d->header.has_checksum)
+        zstd_checksum_update(&d->checksum, result.data, result.size);
+
+    if (last_block)
+    {
+        b32 complete = (d->header.content_size == ZSTD_UNKNOWN_CONTENT_SIZE ||
+                        d->header.content_size == d->frame_out);
+        b32 matches = true;
+        if (d->header.has_checksum)
+        {
+            // The low 32 bits of the XXH64 of the content
+            complete = complete && d->in_pos + 4 <= d->in_size;
+            if (complete)
+                matches = zstd_read_u32(in + d->in_pos) == (u32)zstd_checksum_digest(&d->checksum);
+            d->in_pos += 4;
+        }
+        complete = complete && d->in_pos <= d->in_size;
+
+        result.status = !complete ? ZstdStatus_Error : matches ? ZstdStatus_Done : ZstdStatus_BadChecksum;
+        d->status = result.status;
+    }
+
+    PROFILE_FUNCTION_END();
+    return result;
+}
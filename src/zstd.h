@@ -0,0 +1,134 @@
+#pragma once
+
+#include "types.h"
+
+/*
+ * NOTE(lucas): Zstandard decoder (RFC 8878), built the same way as the inflater.
+ *
+ * One frame is decoded at a time, and the whole compressed frame has to be in memory. Output goes into a
+ * caller-provided window, and zstd_next returns each block (at most ZSTD_BLOCK_MAX bytes) as it is decoded. When
+ * the window cannot fit another block, the last window_size bytes of the frame's history are moved to the front.
+ * zstd_window_buffer_size says how big the window has to be for a frame.
+ *
+ * Everything but dictionaries is supported. Frames with a content checksum have their output hashed with XXH64 as
+ * it is produced, and end with ZstdStatus_BadChecksum instead of ZstdStatus_Done if it doesn't match.
+ */
+
+#define ZSTD_MAGIC 0xFD2FB528u
+#define ZSTD_SKIPPABLE_MAGIC 0x184D2A50u // The low four bits are free
+#define ZSTD_SKIPPABLE_MASK 0xFFFFFFF0u
+#define ZSTD_BLOCK_MAX KILOBYTES(128)
+#define ZSTD_MAX_WINDOW MEGABYTES(128) // The largest window zstd decodes without being asked to
+#define ZSTD_UNKNOWN_CONTENT_SIZE ((u64)-1)
+
+#define ZSTD_HUFFMAN_MAX_BITS 11
+#define ZSTD_LITERAL_LENGTH_MAX_LOG 9
+#define ZSTD_MATCH_LENGTH_MAX_LOG 9
+#define ZSTD_OFFSET_MAX_LOG 8
+
+typedef struct
+{
+    u64 content_size; // ZSTD_UNKNOWN_CONTENT_SIZE if the frame does not say
+    u64 window_size;  // How far back matches can reach
+    u32 header_size;
+    u32 dictionary_id;
+    b32 has_checksum;
+} ZstdFrameHeader;
+
+typedef struct
+{
+    u16 base;  // Added to the bits read for the next state
+    u8 symbol;
+    u8 bits;
+} ZstdFseEntry;
+
+typedef struct
+{
+    u8 symbol;
+    u8 bits;
+} ZstdHuffmanEntry;
+
+typedef enum
+{
+    ZstdStatus_Ok = 0,  // Produced a block, call again for more
+    ZstdStatus_Done,    // Reached the end of the frame
+    ZstdStatus_Error,   // Corrupt, truncated or unsupported input
+    ZstdStatus_BadChecksum, // Reached the end of the frame, but the output doesn't match the frame's checksum
+} ZstdStatus;
+
+// XXH64 over a stream, hashing 32 bytes at a time and holding on to what's left over until the next update
+typedef struct
+{
+    u64 lanes[4];
+    u64 total;
+    u8 pending[32];
+    u32 pending_size;
+} ZstdChecksum;
+
+typedef struct
+{
+    u8* in;
+    size in_size;
+    size in_pos;
+
+    ZstdFrameHeader header;
+    ZstdStatus status;
+    u64 frame_out; // Bytes decoded so far in this frame
+    ZstdChecksum checksum; // Only kept for frames that have one
+
+    u8* window;
+    size window_size;
+    size out_pos;
+
+    u32 repeat_offsets[3];
+
+    // Tables carry over between blocks that repeat them
+    b32 has_huffman;
+    u32 huffman_bits;
+    ZstdHuffmanEntry huffman[1 << ZSTD_HUFFMAN_MAX_BITS];
+
+    u32 literal_length_log;
+    u32 match_length_log;
+    u32 offset_log;
+    b32 has_sequence_tables;
+    ZstdFseEntry literal_lengths[1 << ZSTD_LITERAL_LENGTH_MAX_LOG];
+    ZstdFseEntry match_lengths[1 << ZSTD_MATCH_LENGTH_MAX_LOG];
+    ZstdFseEntry offsets[1 << ZSTD_OFFSET_MAX_LOG];
+
+    u8 literals[ZSTD_BLOCK_MAX];
+} ZstdDecoder;
+
+typedef struct
+{
+    ZstdStatus status;
+    u8* data;
+    size size;
+} ZstdResult;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Returns false if in does not start with a valid frame header. Skippable frames are not frames here.
+b32 zstd_read_frame_header(u8* in, size in_size, ZstdFrameHeader* header);
+
+// Size of the window zstd_init needs for the frame, which is a little more than twice its window size so the
+// history only has to be moved every window_size bytes. Returns -1 if the window is larger than ZSTD_MAX_WINDOW.
+size zstd_window_buffer_size(ZstdFrameHeader* header);
+
+// The smallest window that works, with room for the history and one block. Every block then moves the history.
+size zstd_min_window_buffer_size(ZstdFrameHeader* header);
+
+// Compressed size of the frame or skippable frame at the start of in, found by walking the block headers without
+// decoding anything. Returns -1 if it is not a frame or is truncated.
+size zstd_frame_size(u8* in, size in_size);
+b32 zstd_is_skippable_frame(u8* in, size in_size);
+
+// in must start with a frame header. Once zstd_next returns ZstdStatus_Done, in_pos is the size of the frame.
+void zstd_init(ZstdDecoder* decoder, u8* in, size in_size, u8* window, size window_size);
+// The data and size of the last block are still valid when the status is ZstdStatus_BadChecksum.
+ZstdResult zstd_next(ZstdDecoder* decoder);
+
+#ifdef __cplusplus
+}
+#endif